@@ -45,6 +45,11 @@ cbuffer CONSTANT_BUFFER_INSTANCE : register(CONSTANT_BUFFER_REGISTER_INSTANCE)
     bool UseMetallicMap;
     bool UseRoughnessMap;
     bool UseAmbientOcclusionMap;
+
+    // compact vertex: position is normalized in the mesh bound, normal and tangent are octahedral encoded snorm
+    bool UseCompactVertex;
+    float3 PositionScale;
+    float3 PositionOffset;
 }
 
 struct PSInput
@@ -72,11 +77,20 @@ PSInput vs_main(VSInput_P3F_N3F_T2F_T2F vertex)
 {
     PSInput output;
 
+    float3 position = vertex.position * PositionScale + PositionOffset;
+    float3 normal = vertex.normal;
+    float3 tangent = vertex.tangent;
+    if(UseCompactVertex)
+    {
+        normal = unpack_normal(vertex.normal.xy * 0.5 + 0.5);
+        tangent = unpack_normal(vertex.tangent.xy * 0.5 + 0.5);
+    }
+
     // ref: UnityShader入门精要 section 4.7
     // we use the transpose of the inverse model matrix to transform the normal
-    output.position_ws = mul(Model, float4(vertex.position, 1));
-    output.normal_ws = mul(transpose(InvModel), float4(vertex.normal, 0)).xyz;
-    output.tangent_ws = mul(transpose(InvModel), float4(vertex.tangent, 0)).xyz;
+    output.position_ws = mul(Model, float4(position, 1));
+    output.normal_ws = mul(transpose(InvModel), float4(normal, 0)).xyz;
+    output.tangent_ws = mul(transpose(InvModel), float4(tangent, 0)).xyz;
 
     float4 position_vs = mul(View, output.position_ws);
     output.position = mul(Projection, position_vs);
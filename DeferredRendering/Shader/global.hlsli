@@ -56,12 +56,13 @@ cbuffer CONSTANT_BUFFER_GLOBAL : register(b2)
     float Time;
 }
 
+// also fed by the compact vertex format, whose normal and tangent are octahedral encoded in xy. the color is unused and left out
+// so that both formats provide all the elements of the input signature
 struct VSInput_P3F_N3F_T2F_T2F
 {
     float3 position : POSITION;
     float3 normal : NORMAL;
     float3 tangent : TANGENT0;
-    float3 color : COLOR0;
     float2 uv : TEXCOORD0;
 };
 
@@ -1,8 +1,19 @@
 #pragma once
+#include <cstdint>
 #include <string>
 
 namespace MRenderer 
 {
+    // memory of the current process in bytes
+    struct ProcessMemory
+    {
+        std::uint64_t Resident;        // working set
+        std::uint64_t PeakResident;    // peak working set since the process started
+        std::uint64_t Committed;       // private bytes
+    };
+
+    ProcessMemory QueryProcessMemory();
+
     bool core_dump(std::wstring& path, _EXCEPTION_POINTERS* exc_ptr);
 
     void PlateformInitialize();
@@ -12,24 +12,34 @@ namespace MRenderer
              mNear(near_plane), mFar(far_plane), mRoll(0), mYaw(0), mPitch(0),
              mViewSpaceTransform(Matrix4x4::Identity())
         {
+            mProjection = ProjectionMatrix1(mFov, mRatio, mNear, mFar);
+            InverseMatrixBatch(&mProjection, &mInverseProjection, 1);
+            UpdateViewMatrix();
         }
 
         inline void Move(const Vector3& delta_pos) 
         {
             mViewSpaceTransform.Translate(delta_pos);
+            UpdateViewMatrix();
         }
 
         void Rotate(float roll, float yaw, float pitch);
 
-        inline Matrix4x4 GetWorldMatrix() const { return mViewSpaceTransform;} // view space to world space
-        inline Matrix4x4 GetLocalSpaceMatrix() const { return mViewSpaceTransform.QuickInverse();} // world space to view space
-        inline Matrix4x4 GetProjectionMatrix() const { return ProjectionMatrix1(mFov, mRatio, mNear, mFar);}
+        inline const Matrix4x4& GetWorldMatrix() const { return mViewSpaceTransform;} // view space to world space
+        inline const Matrix4x4& GetLocalSpaceMatrix() const { return mLocalSpaceTransform;} // world space to view space
+        inline const Matrix4x4& GetProjectionMatrix() const { return mProjection;}
+        inline const Matrix4x4& GetInverseProjectionMatrix() const { return mInverseProjection;}
+        inline const Matrix4x4& GetViewProjectionMatrix() const { return mViewProjection;}
         inline Vector3 GetTranslation() const { return mViewSpaceTransform.GetTranslation(); }
         inline float Near() const { return mNear; }
         inline float Far() const { return mFar; }
         inline float Fov() const { return mFov; }
         inline float Ratio() const { return mRatio; }
 
+    protected:
+        // the derived matrices are cached, they are read several times per frame but only change when the camera moves
+        void UpdateViewMatrix();
+
     protected:
         float mFov;
         float mRatio;
@@ -41,5 +51,9 @@ namespace MRenderer
         float mPitch;
 
         Matrix4x4 mViewSpaceTransform;
+        Matrix4x4 mLocalSpaceTransform;
+        Matrix4x4 mProjection;
+        Matrix4x4 mInverseProjection;
+        Matrix4x4 mViewProjection;
     };
 }
\ No newline at end of file
@@ -82,8 +82,8 @@ namespace MRenderer
         // draw screen
         void DrawScreen(ShadingState* shading_state);
 
-        // draw a single mesh
-        void DrawMesh(ShadingState* shading_state, EVertexFormat vertex_format, DeviceVertexBuffer* vertices, DeviceIndexBuffer* indicies, uint32 index_begin, uint32 index_count);
+        // draw a single mesh, @base_vertex is added to the indices
+        void DrawMesh(ShadingState* shading_state, EVertexFormat vertex_format, DeviceVertexBuffer* vertices, DeviceIndexBuffer* indicies, uint32 index_begin, uint32 index_count, uint32 base_vertex = 0);
 
         // copy gpu resource from @src to @dest
         void CopyTexture(D3D12Resource* src, D3D12Resource* dest);
@@ -160,7 +160,7 @@ namespace MRenderer
         D3D12ResourceAllocator& operator=(const D3D12ResourceAllocator&) = delete;
 
         std::shared_ptr<DeviceVertexBuffer> CreateVertexBuffer(const void* data, uint32 count, uint32 stride);
-        std::shared_ptr<DeviceIndexBuffer> CreateIndexBuffer(const void* data, uint32 data_size);
+        std::shared_ptr<DeviceIndexBuffer> CreateIndexBuffer(const void* data, uint32 data_size, uint32 index_stride = sizeof(uint32));
         std::shared_ptr<DeviceStructuredBuffer> CreateStructuredBuffer(uint32 data_size, uint32 stride, const void* initial_data = nullptr);
         std::shared_ptr<DeviceTexture2D> CreateTexture2D(uint32 width, uint32 height, uint32 mip_level, ETextureFormat format, ETexture2DFlag flag, uint32 mip_chain_mem_size = 0, const void* mip_chain = nullptr);
         std::shared_ptr<DeviceTexture2DArray> CreateTextureCube(uint32 width, uint32 height, uint32 mip_level, ETextureFormat format, bool unorder_access = false, uint32 mip_chain_mem_size = 0, const std::array<const void*, NumCubeMapFaces>* mip_chains = nullptr);
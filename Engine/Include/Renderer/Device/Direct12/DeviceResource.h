@@ -398,8 +398,7 @@ namespace MRenderer
 
         inline const uint32 IndiciesCount() const
         {
-            ASSERT(mView.Format == DXGI_FORMAT_R32_UINT);
-            return mView.SizeInBytes / sizeof(uint32);
+            return mView.SizeInBytes / (mView.Format == DXGI_FORMAT_R16_UINT ? sizeof(uint16) : sizeof(uint32));
         }
 
     protected:
@@ -3,6 +3,7 @@
 #include "Renderer/Pipeline/IPipeline.h"
 #include "Renderer/Scene.h"
 #include "Renderer/Camera.h"
+#include "Resource/IBLBaker.h"
 
 namespace MRenderer 
 {
@@ -43,6 +44,9 @@ namespace MRenderer
         // we assert that the smallest mip size is the a multiple of the @DispatchGroupSize, so we don't need to do the size check in compute shader
         static_assert((MinimumMipSize % DispatchGroupSize == 0 ) && (MinimumMipSize > DispatchGroupSize));
 
+        // the map baked by @IBLBaker when the sky box was imported is copied over the dispatches
+        static_assert(PreFilterEnvMapSize == IBLBaker::PrefilteredMapSize && PreFilterEnvMapMipsLevel == IBLBaker::PrefilteredMapMipLevels);
+
         struct ConstantBuffer
         {
             float Roughness;
@@ -78,6 +82,7 @@ namespace MRenderer
         };
 
         static constexpr uint32 TextureResolution = 512;
+        static_assert(TextureResolution == IBLBaker::BRDFLutSize);
     public:
         PrecomputeBRDFPass()
             : mReady(false)
@@ -128,12 +133,22 @@ namespace MRenderer
 
         void Execute(FGContext* context) override;
 
-        void DrawModel(D3D12CommandList* cmd, SceneModel* obj);
+        // draw the sub meshes of the lod of @obj picked by its size on screen, only the ranges of their visible meshlets if the mesh has meshlets.
+        // @projection_scale is the (1, 1) element of the projection matrix
+        void DrawModel(D3D12CommandList* cmd, SceneModel* obj, const Matrix4x4& view_projection, const Vector3& camera_position, float projection_scale);
+
+    protected:
+        // rasterize the visible occluders and remove the models hidden behind them from @mVisibleModels
+        void CullOccludedModel(const Matrix4x4& view_projection);
 
     protected:
         ShadingState mShadingState;
         PipelineStateDesc mPipelineStateDesc;
         FrustumCullStatus mCullingStatus;
+        std::vector<SceneModel*> mVisibleModels;
+        std::vector<int> mCulledIndices;    // the scratch of @Scene::CullModel, kept to avoid a heap allocation every frame
+        OcclusionBuffer mOcclusionBuffer;
+        std::vector<SubMeshData> mDrawRanges;
     };
 
     class DeferredShadingPass : public GraphicsPass
@@ -69,7 +69,8 @@ namespace MRenderer
     public:
         ConstantBufferInstance() 
             :Albedo(1.0f, 1.0f, 1.0f), Emission(0.0f), Roughness(1.0f), Metallic(0.0f), UseAlbedoMap(false),
-            UseNormalMap(false), UseMetallicMap(false), UseRoughnessMap(false), UseAmbientOcclusionMap(false)
+            UseNormalMap(false), UseMetallicMap(false), UseRoughnessMap(false), UseAmbientOcclusionMap(false), UseCompactVertex(false),
+            PositionScale(1.0f, 1.0f, 1.0f), _Padding(0.0f), PositionOffset(0.0f, 0.0f, 0.0f)
         {
         }
 
@@ -87,6 +88,19 @@ namespace MRenderer
         BOOL UseMetallicMap;
         BOOL UseRoughnessMap;
         BOOL UseAmbientOcclusionMap;
+
+        // the vertices of @CompactVertexFormat are decoded in the vertex shader, their positions are normalized in the bound of the mesh
+        BOOL UseCompactVertex;
+        Vector3 PositionScale;
+        float _Padding;
+        Vector3 PositionOffset;
+
+        inline void SetVertexFormat(EVertexFormat format, const AABB& mesh_bound)
+        {
+            UseCompactVertex = format == CompactVertexFormat;
+            PositionScale = UseCompactVertex ? mesh_bound.Size() : Vector3(1.0f, 1.0f, 1.0f);
+            PositionOffset = UseCompactVertex ? mesh_bound.Min : Vector3(0.0f, 0.0f, 0.0f);
+        }
     };
 
     struct ShaderParameter
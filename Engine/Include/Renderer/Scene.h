@@ -4,6 +4,7 @@
 #include "Resource/ResourceDef.h"
 #include "Utils/MathLib.h"
 #include "Utils/LooseOctree.h"
+#include "Utils/Transform.h"
 
 namespace MRenderer 
 {
@@ -13,47 +14,55 @@ namespace MRenderer
     public:
         SceneObject();
         SceneObject(std::string_view name);
-        virtual ~SceneObject() = default;
+        virtual ~SceneObject();
 
         SceneObject(const SceneObject&) = delete;
         SceneObject& operator=(const SceneObject&) = delete;
         SceneObject(SceneObject&& other);
         SceneObject& operator=(SceneObject other);
 
-        inline const Matrix4x4& GetWorldMatrix() const { return mModelMatrix;}
+        // world matrices are refreshed by @Scene::UpdateTransform, the setters below only take effect after that
+        inline const Matrix4x4& GetWorldMatrix() const { return TransformStore::Instance().GetWorldMatrix(mTransform); }
+        inline const Matrix4x4& GetInverseWorldMatrix() const { return TransformStore::Instance().GetInverseWorldMatrix(mTransform); }
         inline DeviceConstantBuffer* GetConstantBuffer() { return mConstantBuffer.get(); }
-        inline Vector3 GetTranslation() const { return mTranslation; }
-        inline Vector3 GetRotation() const { return mRotation; }
-        inline Vector3 GetScale() const { return mScale; }
+        inline Vector3 GetTranslation() const { return TransformStore::Instance().GetTranslation(mTransform); }
+        inline Vector3 GetRotation() const { return TransformStore::Instance().GetRotation(mTransform); }   // euler angles in radian
+        inline Vector3 GetScale() const { return TransformStore::Instance().GetScale(mTransform); }
         inline AABB GetLocalBound() const { return mLocalBound; }
         inline AABB GetWorldBound() const { return GetWorldMatrix() * mLocalBound; }
 
         void SetWorldMatrix(const Matrix4x4& matrix)
         {
-            mModelMatrix = matrix;
-            mTranslation = matrix.GetTranslation();
-            mRotation = matrix.GetRotation().GetEulerAngle();
-            mScale = matrix.GetScale();
+            TransformStore& store = TransformStore::Instance();
+            store.SetWorldMatrix(mTransform, matrix);
+
+            mTranslation = store.GetTranslation(mTransform);
+            mRotation = ToSerializedRotation(store.GetRotation(mTransform));
+            mScale = store.GetScale(mTransform);
         }
 
         void SetTranslation(const Vector3& translation)
         {
             mTranslation = translation;
-            mModelMatrix.SetTranslation(translation);
-
-            mOnTransformChanged.Broadcast(translation);
+            TransformStore::Instance().SetTranslation(mTransform, translation);
         }
 
+        // euler angles in radian
         void SetRotation(const Vector3& rotation)
         {
-            mRotation = rotation;
-            mModelMatrix.SetRotation(rotation.x, rotation.y, rotation.z);
+            mRotation = ToSerializedRotation(rotation);
+            TransformStore::Instance().SetRotation(mTransform, rotation);
         }
 
+        // the rotation is in radian in the transform store and the accessors, only the serialized @mRotation is in degree for editing.
+        // these two are the only conversions between them
+        static Vector3 ToSerializedRotation(const Vector3& rotation) { return rotation * Rad2Deg; }
+        static Vector3 FromSerializedRotation(const Vector3& rotation) { return rotation * Deg2Rad; }
+
         void SetScale(const Vector3& scale)
         {
             mScale = scale;
-            mModelMatrix.SetScale(scale);
+            TransformStore::Instance().SetScale(mTransform, scale);
         }
 
         void PostDeserialized();
@@ -62,21 +71,28 @@ namespace MRenderer
         {
             using std::swap;
             swap(lhs.mName, rhs.mName);
-            swap(lhs.mModelMatrix, rhs.mModelMatrix);
+            swap(lhs.mTranslation, rhs.mTranslation);
+            swap(lhs.mRotation, rhs.mRotation);
+            swap(lhs.mScale, rhs.mScale);
+            swap(lhs.mTransform, rhs.mTransform);
             swap(lhs.mConstantBuffer, rhs.mConstantBuffer);
+
+            TransformStore::Instance().SetOwner(lhs.mTransform, &lhs);
+            TransformStore::Instance().SetOwner(rhs.mTransform, &rhs);
         }
 
     public:
         // serializable member
         std::string mName;
-        Vector3 mTranslation; // split the matrix into these components for convenient editing
+        Vector3 mTranslation; // copy of the components in the transform store for serialization and convenient editing, see @ToSerializedRotation
         Vector3 mRotation;  
         Vector3 mScale;
 
         // runtime member
         AABB mLocalBound;
-        Matrix4x4 mModelMatrix = Matrix4x4::Identity();
+        TransformHandle mTransform;
 
+        // broadcasted by @Scene::UpdateTransform after the world matrix is updated
         Event<Vector3> mOnTransformChanged;
         std::shared_ptr<DeviceConstantBuffer> mConstantBuffer;
     };
@@ -93,6 +109,7 @@ namespace MRenderer
         }
 
         inline ModelResource* GetModel() { return mModel.get(); }
+        inline bool IsOccluder() const { return mOccluder; }
 
         void SetModel(const std::shared_ptr<ModelResource>& res);
         void PostDeserialized();
@@ -102,12 +119,16 @@ namespace MRenderer
             swap(static_cast<SceneObject&>(lhs), static_cast<SceneObject&>(rhs));
             std::swap(lhs.mModel, rhs.mModel);
             std::swap(lhs.mLocalBound, rhs.mLocalBound);
+            std::swap(lhs.mOccluder, rhs.mOccluder);
         }
 
     public:
         // serializable member
         std::string mModelFilePath;
 
+        // rasterized into the occlusion buffer before the other visible models are tested against it
+        bool mOccluder = false;
+
         // runtime member
         std::shared_ptr<ModelResource> mModel;
     };
@@ -193,6 +214,9 @@ namespace MRenderer
         constexpr static EResourceFormat ResourceFormat = EResourceFormat_Json;
         constexpr static float WorldBound = 1000.0f;
 
+        // the scene objects create their constant buffers when constructed, see @DeviceDecodedResource
+        constexpr static bool DecodeOnDevice = true;
+
     public:
         Scene();
         Scene(std::string_view repo_path);
@@ -225,6 +249,19 @@ namespace MRenderer
             );
         }
 
+        // collect the models in the scene that intersect with the frustum volume into @output, the order is unspecified.
+        // @indices is the scratch of the caller, so the views culled at the same time don't share it
+        void CullModel(const FrustumVolume& volume, std::vector<SceneModel*>& output, std::vector<int>& indices)
+        {
+            mOctreeSceneModel.FrustumCull(volume, indices);
+
+            output.resize(indices.size());
+            for (size_t i = 0; i < indices.size(); i++)
+            {
+                output[i] = mSceneModel[indices[i]].get();
+            }
+        }
+
         // call @func for each light in the scene that intersects with the frustum volume
         void CullLight(const FrustumVolume& volume, ContainCallback<SceneLight*> func)
         {
@@ -239,6 +276,10 @@ namespace MRenderer
         inline CubeMapResource* GetSkyBox() { return mSkyBox.get();}
         void SetSkyBox(const std::shared_ptr<CubeMapResource>& res);
 
+        // recompute the world matrices of the objects moved since last call, then broadcast their @mOnTransformChanged
+        // so that the octrees are kept in sync. it should be called once per frame before rendering
+        void UpdateTransform();
+
         void PostDeserialized();
 
     protected:
@@ -255,12 +296,38 @@ namespace MRenderer
         {
             const AABB& bound = obj.GetWorldBound();
             LooseOctree<int>::OctreeElement* element = octree.AddObject(bound, index);
+            BindOctreeElementInternal(octree, obj, element);
+        }
 
+        // build @octree with all the objects in @container at once, much faster than adding them one by one
+        template<typename T>
+        void BuildOctreeInternal(LooseOctree<int>& octree, std::vector<std::unique_ptr<T>>& container)
+        {
+            std::vector<AABB> bounds(container.size());
+            std::vector<int> indices(container.size());
+            for (size_t i = 0; i < container.size(); i++)
+            {
+                bounds[i] = container[i]->GetWorldBound();
+                indices[i] = static_cast<int>(i);
+            }
+
+            std::vector<LooseOctree<int>::OctreeElement*> elements = octree.Build(bounds, indices);
+            for (size_t i = 0; i < container.size(); i++)
+            {
+                ASSERT(elements[i]);
+                BindOctreeElementInternal(octree, *container[i], elements[i]);
+            }
+        }
+
+        // keep the octree element in sync with the transform of @obj
+        template<typename T>
+        void BindOctreeElementInternal(LooseOctree<int>& octree, T& obj, LooseOctree<int>::OctreeElement* element)
+        {
             obj.mOnTransformChanged.AddFunc(
                 [&, element](Vector3 translation) mutable
                 {
                     AABB world_aabb = obj.GetWorldBound();
-                    octree.UpdateElement(element, world_aabb);
+                    element = octree.UpdateElement(element, world_aabb);
                 }
             );
         }
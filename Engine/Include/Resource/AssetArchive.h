@@ -0,0 +1,95 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Utils/MappedFile.h"
+
+namespace MRenderer
+{
+    enum EArchiveCodec : uint16
+    {
+        EArchiveCodec_None = 0,     // stored, read in place from the mapping
+        EArchiveCodec_LZ = 1,       // see @LZCodec
+    };
+
+    struct ArchivePackStats
+    {
+        uint32 NumEntries;
+        uint32 NumCompressed;
+        uint64 RawBytes;        // of the packed files
+        uint64 ArchiveBytes;
+    };
+
+    // the loose .json and .bin files of a repo folder packed into one file, so that the startup maps one file and reads it sequentially
+    // instead of opening a file per resource. the layout is
+    // [header][entries][hash buckets][names][padding][entry data]...
+    // the buckets are an open addressing table of entry indices keyed by the hash of the normalized path. the data of each entry begins
+    // at a page boundary, so the payloads aligned in a .bin file stay aligned in the mapping, see @BinaryData::PayloadAlignment
+    class AssetArchive
+    {
+    public:
+        static constexpr uint32 Magic = 0x3141524D; // "MRA1"
+        static constexpr uint32 CurrentVersion = 1;
+        static constexpr uint32 EntryAlignment = 4096;
+        static constexpr uint32 EmptyBucket = UINT32_MAX;
+
+        struct Header
+        {
+            uint32 Tag = Magic;
+            uint32 Version = CurrentVersion;
+            uint32 NumEntries = 0;
+            uint32 NumBuckets = 0;      // power of 2, at least twice the entries
+            uint32 NamesSize = 0;
+            uint32 _Padding[3] = {};
+        };
+
+        struct Entry
+        {
+            uint64 Hash = 0;
+            uint64 Offset = 0;          // from the beginning of the archive
+            uint32 Size = 0;            // stored bytes
+            uint32 RawSize = 0;         // bytes of the file
+            uint32 NameOffset = 0;      // the path, to tell apart the paths of the same hash
+            uint16 NameSize = 0;
+            EArchiveCodec Codec = EArchiveCodec_None;
+        };
+
+        static_assert(sizeof(Header) == 32 && sizeof(Entry) == 32);
+
+    public:
+        // nullptr if the file is missing or isn't a valid archive
+        static std::shared_ptr<AssetArchive> Open(std::string_view path);
+
+        // pack the .json and .bin files under @folder, named by their path relative to the working directory like the repo paths are. with
+        // @compress the entries are compressed unless it saves less than an eighth of them. the files are read a batch at a time and
+        // streamed to the archive
+        static bool Pack(std::string_view folder, std::string_view archive_path, bool compress, ArchivePackStats* out_stats = nullptr);
+
+        // separators are '/' whatever the platform, and the "." and ".." are resolved
+        static std::string NormalizePath(std::string_view path);
+        static uint64 HashPath(std::string_view normalized_path);
+
+        // nullptr if @path isn't packed
+        const Entry* Find(std::string_view path) const;
+
+        // the bytes of @entry, in place in the mapping if it's stored, otherwise decompressed into @out_storage. nullptr if corrupted
+        const uint8* Read(const Entry& entry, std::vector<uint8>& out_storage) const;
+
+        inline uint32 NumEntries() const { return mHeader->NumEntries; }
+        inline const std::shared_ptr<MappedFile>& File() const { return mFile; }
+
+    protected:
+        AssetArchive() = default;
+
+        std::string_view EntryName(const Entry& entry) const;
+
+    protected:
+        std::shared_ptr<MappedFile> mFile;
+        const Header* mHeader = nullptr;
+        const Entry* mEntries = nullptr;
+        const uint32* mBuckets = nullptr;
+        const char* mNames = nullptr;
+    };
+}
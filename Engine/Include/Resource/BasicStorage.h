@@ -32,6 +32,28 @@ namespace MRenderer
 
     class BinaryData
     {
+    public:
+        // payloads are dumped aligned to @PayloadAlignment from the beginning of the file, so that a view into the mapped file can be handed
+        // straight to the upload. the flag is set in the dumped size of the aligned payloads, the files dumped before are still loadable
+        static constexpr uint32 PayloadAlignment = 64;
+        static constexpr uint32 AlignedPayloadFlag = 1u << 31;
+
+        // the payloads dumped inside a @CompressionScope are split in blocks compressed with @LZCodec, which decode independently on the
+        // workers straight into the loaded data. the compressed payloads can't be viewed in place, they are decoded even from a mapped file
+        static constexpr uint32 CompressedPayloadFlag = 1u << 30;
+        static constexpr uint32 CompressionBlockSize = 256 * 1024;
+
+        // the binary data serialized on this thread while the scope lives are compressed if @compress
+        class CompressionScope
+        {
+        public:
+            explicit CompressionScope(bool compress);
+            ~CompressionScope();
+
+        protected:
+            bool mPrevious;
+        };
+
     public:
         BinaryData();
         explicit BinaryData(uint32 size);
@@ -43,11 +65,14 @@ namespace MRenderer
         
         ~BinaryData();
 
+        // non-owning view of the @size bytes at @data inside @source, nothing is copied and @source stays mapped as long as the view lives
+        static BinaryData View(std::shared_ptr<MappedFile> source, const void* data, uint32 size);
 
         inline const void* GetData() const { return mData; }
         inline void* GetData() { return mData; }
         inline uint32 GetSize() const { return mSize; }
         inline uint32 Empty() const { return mData == nullptr; }
+        inline bool IsView() const { return mSource != nullptr; }
         inline void Reset() { BinaryData temp = std::move(*this); }
         inline const void* Offset(uint32 offset) const 
         {
@@ -61,14 +86,28 @@ namespace MRenderer
 
             swap(lhs.mSize, rhs.mSize);
             swap(lhs.mData, rhs.mData);
+            swap(lhs.mSource, rhs.mSource);
         }
 
+        // write @size bytes of @data aligned to @PayloadAlignment, the payload read back is either aligned or one dumped before, in place
+        static void WritePayload(RingBuffer& rb, const void* data, uint32 size);
+        static const uint8* ReadPayload(RingBuffer& rb, uint32& out_size);
+
+        // [raw size | flags][number of blocks][stored size of each block][blocks], a block that doesn't compress is stored as is.
+        // a payload with a corrupted block is read back empty and counted in @NumCorruptedPayloads
+        static void WriteCompressedPayload(RingBuffer& rb, const void* data, uint32 size);
+        static BinaryData ReadCompressedPayload(RingBuffer& rb, bool parallel = true);
+
+        // the compressed payloads that failed to decompress on this thread so far, the loader rejects the assets that read any
+        static uint32 NumCorruptedPayloads();
+
         static void BinarySerialize(RingBuffer& rb, const BinaryData& binary);
         static void BinaryDeserialize(RingBuffer& rb, BinaryData& out);
 
     protected:
         uint32 mSize;
         void* mData;
+        std::shared_ptr<MappedFile> mSource;
     };
 
     struct SubMeshData
@@ -82,6 +121,92 @@ namespace MRenderer
         uint32 IndicesCount = 0;
     };
 
+    // a cluster of triangles of a sub mesh, drawn as a range of the index buffer. see @MeshOptimizer::BuildMeshlets
+    struct MeshletData
+    {
+        static constexpr uint32 MaxVertices = 64;
+        static constexpr uint32 MaxTriangles = 124;
+
+        uint32 Index = 0;
+        uint32 IndicesCount = 0;
+
+        AABB Bound;
+        Vector3 Center;         // bounding sphere
+        float Radius = 0;
+
+        // normal cone, the meshlet is back facing when viewed from inside the cone of -@ConeAxis at @Center
+        // @ConeCutoff is the sine of the half angle of the normal cone, 1 if the normals spread over a hemisphere
+        Vector3 ConeAxis;
+        float ConeCutoff = 1;
+    };
+
+    // the meshlets are serialized as a tagged chunk at the end of @MeshData, so that the meshes dumped before meshlets are still loadable
+    struct MeshletChunk
+    {
+        static constexpr uint32 Tag = 0x30544C4D; // "MLT0"
+
+        std::vector<MeshletData> Meshlets;
+
+        static void BinarySerialize(RingBuffer& rb, const MeshletChunk& chunk);
+        static void BinaryDeserialize(RingBuffer& rb, MeshletChunk& out);
+    };
+
+    // a simplified version of all the sub meshes, its triangles are appended to the index buffer after the full resolution ones
+    struct MeshLodData
+    {
+        // the lod is drawn when the bounding sphere of the mesh covers less than this fraction of the screen height, see @MeshSimplifier::BuildLods
+        float ScreenSize = 0;
+
+        // largest distance from the full resolution surface, in the units of the vertex positions
+        float Error = 0;
+    };
+
+    // the lods are serialized as a tagged chunk at the end of @MeshData like @MeshletChunk
+    struct MeshLodChunk
+    {
+        static constexpr uint32 Tag = 0x30444F4C; // "LOD0"
+
+        // the lods after the full resolution one, from the most to the least detailed
+        std::vector<MeshLodData> Lods;
+
+        // sub meshes of each lod, lod i + 1 owns the ranges [i * number of sub meshes, (i + 1) * number of sub meshes)
+        std::vector<SubMeshData> SubMeshes;
+
+        // 0 is the full resolution mesh, the screen sizes of the lods are decreasing
+        inline uint32 SelectLod(float screen_size) const
+        {
+            uint32 lod = 0;
+            while (lod < Lods.size() && screen_size < Lods[lod].ScreenSize)
+            {
+                lod++;
+            }
+            return lod;
+        }
+
+        static void BinarySerialize(RingBuffer& rb, const MeshLodChunk& chunk);
+        static void BinaryDeserialize(RingBuffer& rb, MeshLodChunk& out);
+    };
+
+    // the index buffer is narrowed to 16 bits when every sub mesh spans less than 65536 vertices, the indices of a sub mesh are then
+    // relative to its base vertex. serialized as a tagged chunk at the end of @MeshData like @MeshletChunk, missing for 32 bits indices
+    struct IndexFormatChunk
+    {
+        static constexpr uint32 Tag = 0x30584449; // "IDX0"
+
+        uint32 IndexStride = sizeof(uint32);
+
+        // base vertex of each sub mesh, the lods of a sub mesh share its base vertex. empty for 32 bits indices
+        std::vector<uint32> BaseVertices;
+
+        inline uint32 GetBaseVertex(uint32 sub_mesh) const
+        {
+            return BaseVertices.empty() ? 0 : BaseVertices[sub_mesh % BaseVertices.size()];
+        }
+
+        static void BinarySerialize(RingBuffer& rb, const IndexFormatChunk& chunk);
+        static void BinaryDeserialize(RingBuffer& rb, IndexFormatChunk& out);
+    };
+
     using IndexType = uint32;
 
     class MeshData
@@ -146,7 +271,12 @@ namespace MRenderer
 
         inline uint32 IndiciesCount() const
         {
-            return static_cast<uint32>(mIndicies.GetSize() / sizeof(uint32));
+            return static_cast<uint32>(mIndicies.GetSize() / mIndexFormat.IndexStride);
+        }
+
+        inline uint32 IndexStride() const
+        {
+            return mIndexFormat.IndexStride;
         }
 
         inline const std::vector<SubMeshData>& GetSubMeshs() const
@@ -164,6 +294,39 @@ namespace MRenderer
             return mBound;
         }
 
+        // empty if the mesh is not split into meshlets
+        inline const std::vector<MeshletData>& GetMeshlets() const
+        {
+            return mMeshlets.Meshlets;
+        }
+
+        inline void SetMeshlets(std::vector<MeshletData> meshlets)
+        {
+            mMeshlets.Meshlets = std::move(meshlets);
+        }
+
+        // empty if the mesh doesn't have lods
+        inline const MeshLodChunk& GetLods() const
+        {
+            return mLods;
+        }
+
+        inline void SetLods(MeshLodChunk lods)
+        {
+            mLods = std::move(lods);
+        }
+
+        inline const IndexFormatChunk& GetIndexFormat() const
+        {
+            return mIndexFormat;
+        }
+
+        // @mIndicies must already be encoded in @index_format, see @VertexCompression::EncodeIndices
+        inline void SetIndexFormat(IndexFormatChunk index_format)
+        {
+            mIndexFormat = std::move(index_format);
+        }
+
         friend void swap(MeshData& lhs, MeshData& rhs)
         {
             using std::swap;
@@ -172,6 +335,9 @@ namespace MRenderer
             swap(lhs.mVertices, rhs.mVertices);
             swap(lhs.mSubMeshes, rhs.mSubMeshes);
             swap(lhs.mBound, rhs.mBound);
+            swap(lhs.mMeshlets, rhs.mMeshlets);
+            swap(lhs.mLods, rhs.mLods);
+            swap(lhs.mIndexFormat, rhs.mIndexFormat);
         }
 
     public:
@@ -180,6 +346,9 @@ namespace MRenderer
         BinaryData mVertices;
         BinaryData mIndicies;
         std::vector<SubMeshData> mSubMeshes;
+        MeshletChunk mMeshlets;
+        MeshLodChunk mLods;
+        IndexFormatChunk mIndexFormat;
     };
 
     struct MipmapLayout
@@ -192,6 +361,9 @@ namespace MRenderer
 
     struct TextureInfo
     {
+        // set in the dumped format of the textures dumped since @BlockCompression, their @EBlockFormat follows the info, none if uncompressed
+        static constexpr uint8 BlockFormatFlag = 0x80;
+
         uint16 Width;
         uint16 Height;
         uint16 Depth; // depth part is not implemented yet, just a placeholder
@@ -307,6 +479,7 @@ namespace MRenderer
     public:
         CubeMapTextureData() = default;
 
+        // the sh is projected once here when the cube map is imported, it's serialized with the faces so a load only reads it back
         explicit CubeMapTextureData(std::array<TextureData, NumCubeMapFaces>&& data)
             : mData(std::move(data))
         {
@@ -327,4 +500,14 @@ namespace MRenderer
         std::array<TextureData, NumCubeMapFaces> mData;
         SH2CoefficientsPack mSHCoefficients;
     };
+
+    // the image based lighting of a cube map baked on the cpu, see @IBLBaker. the lut is kept raw, its 2 half channels aren't block compressed.
+    // the diffuse irradiance isn't baked, it's evaluated from @CubeMapTextureData::mSHCoefficients at runtime
+    class IBLTextureData
+    {
+    public:
+        std::array<TextureData, NumCubeMapFaces> mPrefilteredMap;
+        TextureInfo mBRDFLutInfo;
+        BinaryData mBRDFLut;
+    };
 }
\ No newline at end of file
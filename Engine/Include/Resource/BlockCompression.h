@@ -0,0 +1,67 @@
+#pragma once
+#include <string_view>
+#include <vector>
+
+#include "Fundation.h"
+
+namespace MRenderer
+{
+    enum EBlockFormat : uint8
+    {
+        EBlockFormat_None,  // not block compressed, the textures dumped before @BlockCompression are BC1 or BC6H from DirectXTex
+        EBlockFormat_BC1,   // opaque rgb, 8 bytes per block
+        EBlockFormat_BC3,   // rgb of BC1 and alpha of BC4, 16 bytes per block
+        EBlockFormat_BC5,   // red and green of two BC4, for the normal maps, 16 bytes per block
+        EBlockFormat_BC7,   // rgba, 16 bytes per block
+        EBlockFormat_BC6H,  // unsigned half float rgb of the hdr textures, 16 bytes per block
+        EBlockFormat_Count,
+    };
+
+    enum EBlockQuality : uint8
+    {
+        EBlockQuality_Fast,     // the endpoints are fit once along the principal axis, BC6H projects the pixels on it for the indices
+        EBlockQuality_Normal,   // refined by least squares, BC7 also tries the two subsets mode on the most promising partitions
+        EBlockQuality_Slow,     // refined longer and searched around, BC7 tries every partition
+        EBlockQuality_Count,
+    };
+
+    std::string_view GetBlockFormatName(EBlockFormat format);
+    std::string_view GetBlockQualityName(EBlockQuality quality);
+
+    // portable encoder and decoder of the block compressed formats for the rgba8 pixels, and the rgba half pixels of BC6H, so the assets can
+    // be cooked without a d3d device. the blocks are encoded in parallel on the workers, and the pixels are matched against the palettes 8
+    // at a time with avx, 4 with sse otherwise. BC7 is encoded with mode 6, and with mode 1 for the opaque blocks, the decoder reads every
+    // mode but the three subsets ones. BC6H is encoded in mode 11 only, the one region mode without the delta transform, and decoded in
+    // every mode, which also decodes the BC6H of DirectXTex
+    // ref: https://learn.microsoft.com/en-us/windows/win32/direct3d10/d3d10-graphics-programming-guide-resources-block-compression
+    // ref: https://learn.microsoft.com/en-us/windows/win32/direct3d11/bc7-format
+    // ref: https://learn.microsoft.com/en-us/windows/win32/direct3d11/bc6h-format
+    class BlockCompression
+    {
+    public:
+        static constexpr uint32 BlockDimension = 4;
+        static constexpr uint32 PixelsPerBlock = BlockDimension * BlockDimension;
+        static constexpr uint32 BlocksPerJob = 64;
+
+        static uint32 BlockSize(EBlockFormat format);
+
+        // the bytes of a pixel encoded or decoded, 8 for the rgba half of BC6H, whose alpha is ignored and decoded as 1
+        static uint32 PixelSize(EBlockFormat format);
+
+        // the mips smaller than a block take a whole block
+        static uint32 EncodedSize(uint32 width, uint32 height, uint32 mip_levels, EBlockFormat format);
+
+        // @pixels is a mip chain of rgba8, or rgba half for BC6H, packed as @CalculateTextureSize, the mips are encoded one after another
+        static std::vector<uint8> Encode(const uint8* pixels, uint32 width, uint32 height, uint32 mip_levels, EBlockFormat format, EBlockQuality quality);
+
+        // decode into a mip chain of @PixelSize pixels, false if a block is in a mode this decoder can't read, which is decoded as black
+        static bool Decode(const uint8* blocks, uint32 width, uint32 height, uint32 mip_levels, EBlockFormat format, uint8* out_pixels);
+
+        // @pixels are the 16 pixels of a block in row order
+        static void EncodeBlock(const uint8* pixels, EBlockFormat format, EBlockQuality quality, uint8* out_block);
+        static bool DecodeBlock(const uint8* block, EBlockFormat format, uint8* out_pixels);
+
+        // peak signal to noise ratio in decibels of the first @num_channels of two rgba8 images, infinite if they are the same
+        static double PSNR(const uint8* a, const uint8* b, uint32 num_pixels, uint32 num_channels);
+    };
+}
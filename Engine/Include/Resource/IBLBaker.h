@@ -0,0 +1,40 @@
+#pragma once
+#include <array>
+#include <string>
+#include <string_view>
+
+#include "Fundation.h"
+#include "Resource/BasicStorage.h"
+
+namespace MRenderer
+{
+    // bakes the image based lighting of a cube map on the workers when it's imported, which @PreFilterEnvMapPass and @PrecomputeBRDFPass
+    // compute on the gpu at startup otherwise: the ggx prefiltered mips the reflections are sampled from by roughness, and the split sum lut
+    // of the brdf by roughness and n.v. the diffuse irradiance is evaluated from the sh of the cube map at runtime
+    // ref: https://cdn2.unrealengine.com/Resources/files/2013SiggraphPresentationsNotes-26915738.pdf section. Image-Based Lighting
+    class IBLBaker
+    {
+    public:
+        static constexpr uint32 PrefilteredMapSize = 512;
+        static constexpr uint32 PrefilteredMapMipLevels = 5;
+        static constexpr uint32 BRDFLutSize = 512;
+        static constexpr uint32 RowsPerJob = 8;
+
+        // the samples are read from the mip of the cube map whose texels cover their solid angle, so fewer of them than on the gpu are smooth
+        static constexpr uint32 PrefilterSampleCount = 256;
+        static constexpr uint32 BRDFSampleCount = 1024;
+
+        // the baked data is dumped next to the data of the cube map
+        static std::string BakedDataPath(std::string_view cube_map_data_path);
+
+        static IBLTextureData Bake(const CubeMapTextureData& cube_map);
+
+        // half rgba faces whose mip i is filtered for the roughness i / (@mip_levels - 1), the mirror one is the cube map resampled.
+        // the faces of @cube_map are float or half rgba with their mips
+        static std::array<TextureData, NumCubeMapFaces> PrefilterEnvironmentMap(const std::array<TextureData, NumCubeMapFaces>& cube_map, uint32 size,
+            uint32 mip_levels, uint32 sample_count = PrefilterSampleCount);
+
+        // the scale and the bias of f0 in the split sum in 2 halves per texel, the roughness along x and n.v along y
+        static BinaryData IntegrateBRDF(uint32 size, uint32 sample_count = BRDFSampleCount);
+    };
+}
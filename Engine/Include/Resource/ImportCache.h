@@ -0,0 +1,80 @@
+#pragma once
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "Fundation.h"
+
+namespace MRenderer
+{
+    // a source file read by an import, the size and the write time let the unchanged files skip the hashing
+    struct ImportDependency
+    {
+        std::string Path;
+        uint64 Size = 0;
+        int64 WriteTime = 0;
+        uint64 Hash = 0;
+    };
+
+    // an import started by another one, like the textures of the materials of a model
+    struct ImportChild
+    {
+        std::string Source;
+        std::string RepoPath;
+    };
+
+    // the imports done before, keyed by the repo path of the imported resource. an import is skipped when the content of every source file
+    // it read and its settings are the same as the last time, and the files it wrote are still there. the imports started by another one
+    // are records of their own, so a changed texture of a model is imported again without the model.
+    // the records are kept in a json file next to the asset folder, so that they aren't packed, see @AssetArchive
+    class ImportCache
+    {
+    public:
+        // bump it when the import pipeline changes its outputs, every record is outdated then
+        static constexpr uint32 ImporterVersion = 4;
+        static constexpr std::string_view DefaultCachePath = "ImportCache.json";
+
+        struct Record
+        {
+            uint64 Settings = 0;
+            std::vector<ImportDependency> Dependencies;
+            std::vector<std::string> Outputs;
+            std::vector<ImportChild> Children;
+        };
+
+    public:
+        // the cache at @DefaultCachePath
+        static ImportCache& Instance();
+
+        explicit ImportCache(std::string_view cache_path);
+
+        static uint64 HashBytes(const void* data, uint64 size, uint64 seed = 0);
+        static std::optional<uint64> HashFile(std::string_view path);
+        static uint64 HashCombine(uint64 seed, uint64 value);
+
+        // true if @repo_path was imported with @settings from the same content as its sources have now, and its outputs all exist
+        bool IsUpToDate(std::string_view repo_path, uint64 settings);
+
+        // record the import of @repo_path, the @dependencies are hashed now
+        void Update(std::string_view repo_path, uint64 settings, const std::vector<std::string>& dependencies, const std::vector<std::string>& outputs,
+            const std::vector<ImportChild>& children = {});
+
+        void Invalidate(std::string_view repo_path);
+
+        // empty if @repo_path was never imported
+        std::vector<ImportChild> Children(std::string_view repo_path);
+
+        bool Save();
+
+    protected:
+        void Load();
+
+    protected:
+        std::string mCachePath;
+        std::unordered_map<std::string, Record> mRecords;
+        std::mutex mMutex;
+    };
+}
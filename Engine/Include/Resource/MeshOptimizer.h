@@ -0,0 +1,79 @@
+#pragma once
+#include <span>
+#include <vector>
+
+#include "Resource/BasicStorage.h"
+
+namespace MRenderer
+{
+    // vertices are welded if each component of their attributes differ less than these values
+    struct WeldTolerance
+    {
+        float Position = 1e-5f;
+        float Normal = 1e-3f;
+        float Color = 1e-3f;
+        float TexCoord = 1e-5f;
+    };
+
+    // result of simulating a FIFO post transform vertex cache over an index buffer
+    struct VertexCacheStatistics
+    {
+        uint32 NumTransformed = 0;  // cache misses, each of them runs the vertex shader
+        float ACMR = 0;             // average cache miss ratio, transformed vertices per triangle. 3 is the worst, about 0.5 for a regular grid
+        float ATVR = 0;             // average transformed to vertex ratio, transformed vertices per referenced vertex. 1 is the optimum
+    };
+
+    // offline optimizations of the imported meshes, all of them run in parallel on the job system
+    class MeshOptimizer
+    {
+    public:
+        // vertices are processed in chunks of this size
+        static constexpr uint32 MinVerticesPerJob = 16384;
+
+        // merge the vertices that have the same position, normal, color and texture coordinate, and build the index buffer referring to them.
+        // the attributes are quantized to a grid of @tolerance, so two vertices closer than @tolerance may still be kept apart if
+        // they fall into different cells. the welded vertex keeps the attributes of its first occurrence, the per face tangents of the
+        // merged vertices are averaged and orthogonalized to the normal. @out_indices[i] is the welded vertex of @vertices[i]
+        static void WeldVertices(const std::vector<StandardVertex>& vertices, const WeldTolerance& tolerance, std::vector<StandardVertex>& out_vertices, std::vector<uint32>& out_indices);
+
+        // size of the cache used by @OptimizeOverdraw and the default of @AnalyzeVertexCache, close to what the hardware has
+        static constexpr uint32 FifoCacheSize = 16;
+
+        // @OptimizeOverdraw may make the cache miss ratio of its clusters this much worse than the cache optimized order
+        static constexpr float DefaultOverdrawThreshold = 1.05f;
+
+        // count the vertex shader invocations of drawing @indices with a FIFO cache of @cache_size entries
+        static VertexCacheStatistics AnalyzeVertexCache(std::span<const uint32> indices, uint32 cache_size = FifoCacheSize);
+
+        // reorder the triangles for the post transform vertex cache with Forsyth's greedy algorithm, the winding is kept.
+        // ref: https://tomforsyth1000.github.io/papers/fast_vert_cache_opt.html
+        static void OptimizeVertexCache(std::span<uint32> indices);
+
+        // reorder the cache optimized triangles so that the ones facing outwards are drawn first, which reduces the overdraw
+        // from most view directions. the triangles are split into clusters that keep the cache miss ratio within @threshold,
+        // the clusters are then sorted by how far they face away from the center of the mesh.
+        // ref: Sander et al. 2007, Fast Triangle Reordering for Vertex Locality and Reduced Overdraw
+        static void OptimizeOverdraw(std::span<uint32> indices, const std::vector<StandardVertex>& vertices, float threshold = DefaultOverdrawThreshold);
+
+        // reorder the vertices in the order they are first referenced by @indices so that the vertex fetch is mostly sequential,
+        // the vertices not referenced are removed
+        static void OptimizeVertexFetch(std::vector<StandardVertex>& vertices, std::vector<uint32>& indices);
+
+        // a triangle not adjacent to the meshlet being built starts a new one, if the meshlet has at least this many triangles
+        static constexpr uint32 MinMeshletTriangles = MeshletData::MaxTriangles / 4;
+
+        // split the triangles of @indices into meshlets of at most @MeshletData::MaxVertices vertices and @MeshletData::MaxTriangles triangles,
+        // and reorder them so that each meshlet is a contiguous range. a meshlet grows greedily by the adjacent triangle adding the fewest
+        // vertices, new meshlets are seeded next to the previous one. the triangles of each meshlet are then ordered for the vertex cache.
+        // @index_offset is the position of @indices in the index buffer, the bounds of the appended meshlets are not computed.
+        // ref: https://github.com/zeux/meshoptimizer/blob/master/src/clusterizer.cpp
+        static void BuildMeshlets(const std::vector<StandardVertex>& vertices, std::span<uint32> indices, uint32 index_offset, std::vector<MeshletData>& out_meshlets);
+
+        // bounding box, bounding sphere and normal cone of the triangles in @meshlet's index range
+        static void ComputeMeshletBounds(const std::vector<StandardVertex>& vertices, const std::vector<uint32>& indices, MeshletData& meshlet);
+
+        // vertex cache and overdraw optimization of each sub mesh in parallel, optionally followed by splitting them into meshlets,
+        // then the vertex fetch optimization. the sub mesh ranges stay the same, @out_meshlets are sorted by their index range
+        static void OptimizeMesh(std::vector<StandardVertex>& vertices, std::vector<uint32>& indices, const std::vector<SubMeshData>& sub_meshes, std::vector<MeshletData>* out_meshlets = nullptr);
+    };
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <array>
+#include <span>
+#include <vector>
+
+#include "Resource/BasicStorage.h"
+
+namespace MRenderer
+{
+    // quadric error metric simplification of the imported meshes, used to build their lods
+    class MeshSimplifier
+    {
+    public:
+        // fraction of the triangles of the full resolution mesh kept by each lod
+        static constexpr std::array<float, 3> DefaultLodRatios = { 0.5f, 0.25f, 0.125f };
+
+        // the lod thresholds keep the simplification error below this many pixels on a screen of @ReferenceScreenHeight pixels
+        static constexpr float MaxPixelError = 1.0f;
+        static constexpr float ReferenceScreenHeight = 1080.0f;
+
+        // collapse the edges of the triangles in @indices by increasing quadric error until at most @target_index_count indices are left,
+        // or the next collapse would move the surface further than @target_error. a collapse moves a vertex onto one of its neighbours,
+        // so only the indices are rewritten and the vertices are shared with the original mesh. vertices on an open border can only
+        // slide along it, vertices on an attribute seam and the ones flagged in @locked_vertices are kept.
+        // returns the error of the result, the distances are in the units of the vertex positions.
+        // ref: Garland and Heckbert 1997, Surface Simplification Using Quadric Error Metrics
+        // ref: https://github.com/zeux/meshoptimizer/blob/master/src/simplifier.cpp
+        static float Simplify(const std::vector<StandardVertex>& vertices, std::span<const uint32> indices, uint32 target_index_count, float target_error,
+            std::vector<uint32>& out_indices, std::span<const uint8> locked_vertices = {});
+
+        // simplify all the sub meshes for each ratio of @ratios in parallel, each lod starts from the previous one.
+        // the triangles of the lods are ordered for the vertex cache and appended to @indices, the vertices shared by several sub meshes
+        // are locked so that no crack opens between them. the chain stops early once a lod barely removes any triangle
+        static void BuildLods(const std::vector<StandardVertex>& vertices, std::vector<uint32>& indices, const std::vector<SubMeshData>& sub_meshes,
+            std::span<const float> ratios, MeshLodChunk& out_lods);
+    };
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <array>
+#include <string_view>
+
+#include "Fundation.h"
+#include "Resource/BasicStorage.h"
+
+namespace MRenderer
+{
+    enum EMipFilter : uint8
+    {
+        EMipFilter_Box,         // the average of 2x2 pixels
+        EMipFilter_Kaiser,      // sinc windowed by kaiser over 3 texels of the smaller mip, sharper than the box
+        EMipFilter_Lanczos,     // lanczos 3, the sharpest, rings a little around the hard edges
+        EMipFilter_Count,
+    };
+
+    std::string_view GetMipFilterName(EMipFilter filter);
+
+    // builds the mip chain of a texture on the cpu, each mip from the one above it, in place in the buffer laid out as @CalculateMipmapLayout.
+    // a mip is filtered in bands of rows on the workers, the rows are filtered vertically into a row of floats, then horizontally into the
+    // smaller mip, 8 floats at a time with avx, 4 with sse otherwise. the texels past the edges repeat the edge ones, so the faces of a cube
+    // map don't bleed into each other
+    class MipGenerator
+    {
+    public:
+        static constexpr uint32 RowsPerJob = 8;
+
+        // 8 bits unorm channels, and float or half rgba
+        static bool IsSupported(ETextureFormat format);
+
+        // fill the mips after the first of @mip_chain, which is filled. with @srgb the 8 bits colors are filtered in linear space, the alpha
+        // is always linear
+        static void Generate(void* mip_chain, uint32 width, uint32 height, uint32 mip_levels, ETextureFormat format, EMipFilter filter, bool srgb);
+        static void Generate(TextureData& texture, EMipFilter filter, bool srgb);
+
+        // the mips of the 6 faces are filtered together, one mip level of all the faces at a time
+        static void GenerateCubeMap(const std::array<void*, NumCubeMapFaces>& mip_chains, uint32 width, uint32 height, uint32 mip_levels, ETextureFormat format,
+            EMipFilter filter, bool srgb);
+        static void GenerateCubeMap(std::array<TextureData, NumCubeMapFaces>& faces, EMipFilter filter, bool srgb);
+    };
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <string_view>
+#include <vector>
+
+#include "Fundation.h"
+#include "Resource/tiny_obj_loader.h"
+
+namespace MRenderer
+{
+    // indices of a face corner into @ObjMesh's attribute arrays, -1 if the corner doesn't have the attribute
+    struct ObjIndex
+    {
+        int32 Position;
+        int32 TexCoord;
+        int32 Normal;
+    };
+
+    // triangulated content of an .obj file
+    struct ObjMesh
+    {
+        std::vector<float> Positions;   // 3 floats per position
+        std::vector<float> Normals;     // 3 floats per normal
+        std::vector<float> TexCoords;   // 2 floats per texture coordinate
+        std::vector<ObjIndex> Indices;  // 3 corners per triangle
+        std::vector<int32> MaterialIds; // 1 material per triangle, index of @Materials
+
+        // materials of the mtllib files, faces before any usemtl use a default material appended at the end
+        std::vector<tinyobj::material_t> Materials;
+        std::vector<std::string> MaterialLibPaths;  // the mtllib files found
+
+        inline uint32 NumTriangles() const { return static_cast<uint32>(MaterialIds.size()); }
+    };
+
+    // multithreaded replacement of tinyobj::LoadObj for big files.
+    // the file is split into chunks at line boundaries which are parsed in parallel on the job system,
+    // the chunks are then merged into preallocated arrays in parallel with the relative indices and materials resolved.
+    // supports v, vt, vn, f, usemtl and mtllib, other statements are ignored.
+    // quads are split along the shorter diagonal like tinyobj, polygons with more corners are triangulated as a fan
+    class ObjParser
+    {
+    public:
+        // chunks smaller than this don't worth the cost of scheduling jobs
+        static constexpr uint32 MinChunkSize = 1 << 20;
+
+        // parse the file at @file_path, mtllib files are searched in @material_folder
+        static bool Load(std::string_view file_path, std::string_view material_folder, ObjMesh& out_mesh);
+
+        // parse the content of an .obj file already in memory
+        static bool Parse(std::string_view text, std::string_view material_folder, ObjMesh& out_mesh);
+    };
+}
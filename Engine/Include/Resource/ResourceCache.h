@@ -0,0 +1,135 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "Fundation.h"
+#include "Resource/ResourceDef.h"
+
+namespace MRenderer
+{
+    enum EResourceCategory
+    {
+        EResourceCategory_Mesh,
+        EResourceCategory_Texture,
+        EResourceCategory_CubeMap,
+        EResourceCategory_Material,
+        EResourceCategory_Model,
+        EResourceCategory_Other,
+        EResourceCategory_Count,
+    };
+
+    std::string_view GetResourceCategoryName(EResourceCategory category);
+
+    template<typename T>
+    constexpr EResourceCategory GetResourceCategory()
+    {
+        if constexpr (std::is_same_v<T, MeshResource>)
+        {
+            return EResourceCategory_Mesh;
+        }
+        else if constexpr (std::is_same_v<T, TextureResource>)
+        {
+            return EResourceCategory_Texture;
+        }
+        else if constexpr (std::is_same_v<T, CubeMapResource>)
+        {
+            return EResourceCategory_CubeMap;
+        }
+        else if constexpr (std::is_same_v<T, MaterialResource>)
+        {
+            return EResourceCategory_Material;
+        }
+        else if constexpr (std::is_same_v<T, ModelResource>)
+        {
+            return EResourceCategory_Model;
+        }
+        else
+        {
+            return EResourceCategory_Other;
+        }
+    }
+
+    struct ResourceCacheStats
+    {
+        struct Category
+        {
+            uint32 NumResources;
+            uint32 NumUnreferenced;
+            uint64 Bytes;
+            uint64 UnreferencedBytes;
+        };
+
+        std::array<Category, EResourceCategory_Count> Categories;
+        uint64 Budget;
+        uint64 Bytes;
+        uint64 UnreferencedBytes;
+        uint64 NumHits;
+        uint64 NumMisses;
+        uint64 NumEvictions;
+        uint64 EvictedBytes;
+    };
+
+    // the loaded resources by repo path. the cache keeps them resident, but hands out handles that it only weakly references, so a resource
+    // nobody else holds is known to be unreferenced. the unreferenced ones are kept while the cache fits in the budget, and the least
+    // recently used are evicted first. the referenced ones are never evicted, even over the budget
+    class ResourceCache
+    {
+    public:
+        static constexpr uint64 DefaultBudget = 1024ull << 20;
+
+        explicit ResourceCache(uint64 budget = DefaultBudget);
+
+        // the handle of the resource, null if it isn't cached
+        std::shared_ptr<IResource> Find(std::string_view repo_path);
+
+        // cache a loaded resource, its size is @IResource::GetResidentSize at this point. return its handle
+        std::shared_ptr<IResource> Insert(std::string_view repo_path, std::shared_ptr<IResource> resource, EResourceCategory category);
+
+        // evict the least recently used unreferenced resources until the cache fits in the budget, return the number of evicted resources.
+        // the device resources are released here, so it's called on the device thread
+        uint32 Trim();
+
+        inline void SetBudget(uint64 budget) { mBudget = budget; }
+        inline uint64 GetBudget() const { return mBudget; }
+
+        ResourceCacheStats GetStats();
+
+    protected:
+        struct Entry
+        {
+            std::shared_ptr<IResource> Resource;
+            std::weak_ptr<IResource> Handle;
+            EResourceCategory Category;
+            uint64 Size;
+
+            // set when the handle is taken and when it's released, on any thread
+            std::atomic<uint64> LastUse;
+        };
+
+        // stamp the release of the last handle, and drop the entry, which the weak reference to the handle would keep otherwise
+        struct HandleDeleter
+        {
+            void operator()(IResource*) const;
+
+            mutable std::shared_ptr<Entry> Owner;
+        };
+
+        // @mMutex is held
+        std::shared_ptr<IResource> AcquireHandle(const std::shared_ptr<Entry>& entry);
+
+    protected:
+        std::unordered_map<std::string, std::shared_ptr<Entry>> mEntries;
+        std::atomic<uint64> mBudget;
+        uint64 mBytes = 0;
+        uint64 mNumHits = 0;
+        uint64 mNumMisses = 0;
+        uint64 mNumEvictions = 0;
+        uint64 mEvictedBytes = 0;
+        std::mutex mMutex;
+    };
+}
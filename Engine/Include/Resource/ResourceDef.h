@@ -1,4 +1,5 @@
 #pragma once
+#include <span>
 #include <vector>
 #include <unordered_map>
 #include <string>
@@ -6,6 +7,7 @@
 
 #include "Fundation.h"
 #include "Utils/MathLib.h"
+#include "Utils/Occlusion.h"
 #include "Renderer/Device/Direct12/DeviceResource.h"
 #include "Renderer/Pipeline/IPipeline.h"
 #include "Resource/BasicStorage.h"
@@ -52,9 +54,13 @@ namespace MRenderer
         inline std::string_view GetRepoPath() const{ return mRepoPath;}
         inline void SetRepoPath(std::string_view repo_path) { mRepoPath = repo_path;}
 
+        // bytes of the data the resource keeps loaded, its device buffers and textures included, see @ResourceCache
+        inline uint64 GetResidentSize() const { return mResidentSize; }
+
     public:
         // runtime member
         std::string mRepoPath;
+        uint64 mResidentSize = 0;
     };
 
     class MeshResource : public IResource
@@ -72,11 +78,32 @@ namespace MRenderer
         inline const EVertexFormat GetVertexFormat() const { return mVertexFormat; }
         inline const AABB& GetBound() const { return mBound; }
         inline const std::vector<SubMeshData>& GetSubMeshes() { return mSubMeshes; }
+        inline const std::vector<MeshletData>& GetMeshlets() const { return mMeshlets; }
+        inline const MeshLodChunk& GetLods() const { return mLods; }
+
+        // the indices of a sub mesh, or of one of its lods, are relative to this vertex
+        inline uint32 GetBaseVertex(uint32 sub_mesh) const { return mIndexFormat.GetBaseVertex(sub_mesh); }
 
+        // sub meshes of @lod, the meshlets only cover the full resolution ones
+        inline std::span<const SubMeshData> GetSubMeshes(uint32 lod) const
+        {
+            if (lod == 0)
+            {
+                return mSubMeshes;
+            }
+            return std::span<const SubMeshData>(mLods.SubMeshes).subspan((lod - 1) * mSubMeshes.size(), mSubMeshes.size());
+        }
+
+        // cpu side positions for occlusion culling, decoded with the rest of the mesh data so the render thread never reads the disk
+        inline const OccluderMesh& GetOccluderMesh() const { return mOccluderMesh; }
+
+        // the data is decoded here, and the buffers are created on the device thread, see @ResourceLoader::DeferToDevice
         void PostDeserialized();
 
     protected:
-        void AllocateGPUResource();
+        MeshData LoadMeshData();
+        void AllocateGPUResource(const MeshData& mesh_data);
+        static OccluderMesh BuildOccluderMesh(const MeshData& mesh_data);
 
     public:
         // serializable member
@@ -89,6 +116,10 @@ namespace MRenderer
         EVertexFormat mVertexFormat;
         AABB mBound;
         std::vector<SubMeshData> mSubMeshes;
+        std::vector<MeshletData> mMeshlets;
+        MeshLodChunk mLods;
+        IndexFormatChunk mIndexFormat;
+        OccluderMesh mOccluderMesh;
     };
 
 
@@ -104,14 +135,15 @@ namespace MRenderer
             : IResource(), mTexturePath(texture_path)
         {
             SetRepoPath(repo_path);
-            AllocateGPUResource();
+            AllocateGPUResource(LoadTextureData());
         }
 
         void PostDeserialized();
         inline DeviceTexture2D* Resource() { ASSERT(mDeviceTexture); return mDeviceTexture.get(); }
 
     protected:
-        void AllocateGPUResource();
+        TextureData LoadTextureData();
+        void AllocateGPUResource(const TextureData& tex);
 
     public:
         // serializable member
@@ -135,7 +167,8 @@ namespace MRenderer
             SetRepoPath(repo_path);
 
             CubeMapTextureData texture = ReadTextureFile();
-            AllocateGPUResource(texture);
+            IBLTextureData baked;
+            AllocateGPUResource(texture, ReadBakedFile(baked) ? &baked : nullptr);
         }
 
         void PostDeserialized();
@@ -144,8 +177,13 @@ namespace MRenderer
         inline const SH2CoefficientsPack& GetSHCoefficients() const { return mSHCoefficients;}
         CubeMapTextureData ReadTextureFile();
 
+        // the image based lighting baked when the cube map was imported, null if it was imported before it was baked
+        inline DeviceTexture2DArray* PrefilteredMap() { return mDevicePrefilteredMap.get(); }
+        inline DeviceTexture2D* BRDFLut() { return mDeviceBRDFLut.get(); }
+        bool ReadBakedFile(IBLTextureData& out_baked);
+
     protected:
-        void AllocateGPUResource(const CubeMapTextureData& texture);
+        void AllocateGPUResource(const CubeMapTextureData& texture, const IBLTextureData* baked);
 
     public:
         // serializable member
@@ -153,6 +191,8 @@ namespace MRenderer
         
         // runtime member
         std::shared_ptr<DeviceTexture2DArray> mDeviceTexture2DArray;
+        std::shared_ptr<DeviceTexture2DArray> mDevicePrefilteredMap;
+        std::shared_ptr<DeviceTexture2D> mDeviceBRDFLut;
         SH2CoefficientsPack mSHCoefficients;
     };
 
@@ -1,6 +1,16 @@
 #pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
 #include <string>
+#include <thread>
 #include "DirectXTex.h"
+#include "Resource/AssetArchive.h"
+#include "Resource/BlockCompression.h"
+#include "Resource/ResourceCache.h"
 #include "Resource/ResourceDef.h"
 #include "Utils/Serialization.h"
 
@@ -10,16 +20,82 @@ namespace MRenderer
     template<typename T>
     concept ResourceClass = ReflectedClass<T> && std::is_default_constructible_v<T> && std::is_base_of_v<IResource, T>;
 
+    // the resources that create device objects while being deserialized, they are decoded on the device thread rather than on a worker
+    template<typename T>
+    concept DeviceDecodedResource = requires { requires T::DecodeOnDevice; };
+
+    // the prefetched resources are decoded when no visible one is waiting
+    enum ELoadPriority
+    {
+        ELoadPriority_Visible,
+        ELoadPriority_Prefetch,
+        ELoadPriority_Count,
+    };
+
+    struct ResourceLoadRequest;
+
+    // a resource referenced by the one being loaded, see @ResourceLoader::LoadDependency.
+    // its request is kept to be promoted along with the referencing one, null if it was loaded already
+    struct ResourceDependency
+    {
+        std::shared_ptr<ResourceLoadRequest> Request;
+        std::function<bool()> IsReady;
+    };
+
+    // a resource being loaded by @ResourceLoader::LoadResourceAsync. its json and binary data are decoded on a worker, the work that touches
+    // the device is queued in @DeviceWork and done by @ResourceLoader::ProcessUploads once the resources it references are loaded
+    struct ResourceLoadRequest
+    {
+        std::string RepoPath;
+        std::atomic<ELoadPriority> Priority = ELoadPriority_Visible;
+        EResourceCategory Category = EResourceCategory_Other;
+        bool DecodeOnDevice = false;
+
+        std::function<std::shared_ptr<IResource>()> Decode;
+        std::function<void(const std::shared_ptr<IResource>&)> Fulfill;
+
+        std::shared_ptr<IResource> Resource;
+        std::vector<ResourceDependency> Dependencies;   // under @ResourceLoader::mMutex
+        std::vector<std::function<void()>> DeviceWork;
+    };
+
+    // wall time of each stage of @ResourceLoader::ImportModel in milliseconds
+    struct ModelImportTimings
+    {
+        double Parse;       // parse the obj file and load the materials
+        double Split;       // split the triangles into sub meshes by material
+        double Tangent;
+        double Bound;       // recenter, scale and calculate the bound
+        double Weld;        // merge the shared vertices and build the index buffer
+        double Optimize;    // reorder the indices and vertices for the vertex cache, overdraw and vertex fetch
+        double Lod;         // simplify the sub meshes into the lod chain
+        double Compress;    // encode the compact vertices and narrow the indices
+        double Write;       // dump the mesh data
+        double Materials;   // import the textures and dump the materials
+        uint32 NumTriangles;
+        uint32 NumMaterials;
+        uint32 NumVertices;         // before welding, 3 per triangle
+        uint32 NumWeldedVertices;
+        float ACMR;                 // post transform cache misses per triangle of the optimized mesh
+        uint32 NumLods;             // besides the full resolution mesh
+        uint32 MeshBytes;           // vertex and index buffers before the compression
+        uint32 CompressedMeshBytes;
+    };
+
     class ResourceLoader 
     {
+    public:
+        static constexpr std::string_view DefaultArchivePath = "Asset.pak";
+
     public:
         static ResourceLoader& Instance();
 
-        // import .obj file
-        static std::shared_ptr<ModelResource> ImportModel(std::string_view file_path, std::string_view repo_path, float scale = 1.0f, bool flip_uv_y=false);
+        // import .obj file, every stage runs in parallel on the job system
+        static std::shared_ptr<ModelResource> ImportModel(std::string_view file_path, std::string_view repo_path, float scale = 1.0f, bool flip_uv_y=false, ModelImportTimings* out_timings=nullptr);
         
-        // import .jpg .png .hdr image
-        static std::shared_ptr<TextureResource> ImportTexture(std::string_view file_path, std::string_view repo_path, ETextureFormat foramt=ETextureFormat_None);
+        // import .jpg .png .hdr image, the ldr images are encoded in @block_format, the hdr ones in BC6H
+        static std::shared_ptr<TextureResource> ImportTexture(std::string_view file_path, std::string_view repo_path, ETextureFormat foramt=ETextureFormat_None,
+            EBlockFormat block_format=EBlockFormat_BC1, EBlockQuality quality=EBlockQuality_Normal);
 
         // import cubemap folder
         static std::shared_ptr<CubeMapResource> ImportCubeMap(std::string_view file_path, std::string_view repo_path);
@@ -27,9 +103,10 @@ namespace MRenderer
         // create unit sphere model
         static std::shared_ptr<ModelResource> CreateStandardSphereModel(std::string_view repo_path);
         
-        static std::optional<TextureData> LoadImageFile(std::string_view path, ETextureFormat foramt=ETextureFormat_None);
-        static std::optional<TextureData> LoadWICImageFile(std::string_view local_path, ETextureFormat format=ETextureFormat_None);
-        static std::optional<TextureData> LoadHDRImageFile(std::string_view local_path);
+        // without @generate_mips the mips the @MipGenerator can filter are left for the caller, e.g. to filter the faces of a cube map together
+        static std::optional<TextureData> LoadImageFile(std::string_view path, ETextureFormat foramt=ETextureFormat_None, bool generate_mips=true);
+        static std::optional<TextureData> LoadWICImageFile(std::string_view local_path, ETextureFormat format=ETextureFormat_None, bool generate_mips=true);
+        static std::optional<TextureData> LoadHDRImageFile(std::string_view local_path, bool generate_mips=true);
         static std::array<TextureData, NumCubeMapFaces> LoadCubeMap(std::string_view path);
         static std::optional<nlohmann::json> LoadJsonFile(std::string_view path);
 
@@ -47,31 +124,39 @@ namespace MRenderer
             namespace fs = std::filesystem;
             fs::path file_path = fs::path(repo_path).replace_extension(".bin");
 
+            BinaryData::CompressionScope compression(mCompressPayloads);
             BinarySerializer serializer;
             serializer.LoadObject(resource);
             return serializer.DumpFile(file_path.string());
         }
 
         // Create a resource object of type T from a binary file.
+        // the file is memory mapped by default and the binary data of @out_resource are views into it, see @BinarySerializer::LoadFile.
+        // false if the file can't be read or any of its compressed payloads is corrupted
         template<ReflectedClass T>
-        bool LoadBinary(T& out_resource, std::string_view repo_path)
+        bool LoadBinary(T& out_resource, std::string_view repo_path, bool memory_mapped = true)
         {
             namespace fs = std::filesystem;
             fs::path file_path = fs::path(repo_path).replace_extension(".bin");
 
+            // the decompressed archive entry is read in place too
             BinarySerializer serializer;
-            if (serializer.LoadFile(file_path.string()))
-            {
-                serializer.DumpObject(out_resource);
-                ASSERT(serializer.Size() == 0);
-                return true;
-            }
-            else
+            std::vector<uint8> storage;
+            if (!LoadArchivedBinary(serializer, file_path.string(), memory_mapped, storage) && !serializer.LoadFile(file_path.string(), memory_mapped))
             {
                 return false;
             }
+
+            // the payloads are decoded on this thread, a corrupted one is read back empty instead of failing the deserialization
+            uint32 num_corrupted = BinaryData::NumCorruptedPayloads();
+            serializer.DumpObject(out_resource);
+            ASSERT(serializer.Size() == 0);
+            return BinaryData::NumCorruptedPayloads() == num_corrupted;
         };
 
+        // whether the binary file of @repo_path is packed or on disk, the optional ones are checked before @LoadBinary reports them corrupted
+        bool BinaryExists(std::string_view repo_path) const;
+
         template<ReflectedClass T>
         bool DumpJson(T& resource, std::string_view repo_path)
         {
@@ -102,8 +187,12 @@ namespace MRenderer
             namespace fs = std::filesystem;
             fs::path file_path = fs::path(repo_path).replace_extension(".json");
 
-            // load the json file
-            std::optional<nlohmann::json> json = LoadJsonFile(file_path.string());
+            // load the json file, from the archive if it's packed
+            std::optional<nlohmann::json> json = LoadArchivedJson(file_path.string());
+            if (!json.has_value())
+            {
+                json = LoadJsonFile(file_path.string());
+            }
             ASSERT(json.has_value());
 
             // deserialize the json file and return the @resource
@@ -111,28 +200,81 @@ namespace MRenderer
             return true;
         }
 
+        // load the resource synchronously, the device thread only, see @LoadResourceAsync
         template<ResourceClass T>
         std::shared_ptr<T> LoadResource(std::string_view repo_path)
         {
-
             TimeScope _scope(std::format("LoadResource {}", repo_path));
+            return WaitResource(LoadResourceAsync<T>(repo_path));
+        }
 
-            auto it = mResourceCache.find(repo_path);
-            if (it != mResourceCache.end())
+        // load the resource on the workers, the concurrent requests of a same resource share one load.
+        // the resources it references are loaded along with the same priority, it's ready once they all are and its device objects are
+        // created by @ProcessUploads on the device thread
+        template<ResourceClass T>
+        std::shared_future<std::shared_ptr<T>> LoadResourceAsync(std::string_view repo_path, ELoadPriority priority = ELoadPriority_Visible)
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            return LoadResourceLocked<T>(repo_path, priority, nullptr);
+        }
+
+        // load a resource referenced by the one being loaded, from its PostDeserialized. it's loaded with the same priority and promoted
+        // along with it, the referencing one isn't ready until it is. outside of a load it's loaded right away, on the device thread only
+        template<ResourceClass T>
+        std::shared_future<std::shared_ptr<T>> LoadDependency(std::string_view repo_path)
+        {
+            ResourceLoadRequest* request = CurrentLoadRequest();
+            if (!request)
             {
-                std::shared_ptr<T> ret = std::static_pointer_cast<T>(it->second);
-                ASSERT(ret);
-                return ret;
+                ASSERT(IsDeviceThread() && "Load Dependencies Outside Of A Load On The Device Thread");
+                std::shared_future<std::shared_ptr<T>> future = LoadResourceAsync<T>(repo_path);
+                WaitResource(future);
+                return future;
             }
 
-            // deserialized it from json file
-            std::shared_ptr<T> resource = std::make_shared<T>();
-            LoadJson(*resource, repo_path);
+            std::lock_guard<std::mutex> lock(mMutex);
+            std::shared_ptr<ResourceLoadRequest> dependency;
+            std::shared_future<std::shared_ptr<T>> future = LoadResourceLocked<T>(repo_path, request->Priority, &dependency);
+            request->Dependencies.push_back(ResourceDependency{ .Request = std::move(dependency), .IsReady = [future]() { return IsReady(future); } });
+            return future;
+        }
 
-            // cache the resource
-            mResourceCache[repo_path] = resource;
-            resource->SetRepoPath(repo_path);
-            return resource;
+        // run @work on the device thread once the dependencies of the resource being loaded are loaded, from its PostDeserialized.
+        // outside of a load it's run right away
+        void DeferToDevice(std::function<void()> work);
+
+        // the device thread processes the uploads meanwhile, the other threads wait for it to process them on its frames
+        template<typename T>
+        std::shared_ptr<T> WaitResource(const std::shared_future<std::shared_ptr<T>>& future)
+        {
+            ASSERT(!CurrentLoadRequest() && "Use LoadDependency While Loading A Resource");
+            if (!IsDeviceThread())
+            {
+                return future.get();
+            }
+
+            while (!IsReady(future))
+            {
+                PumpUploads();
+            }
+            return future.get();
+        }
+
+        // finish the decoded resources whose dependencies are loaded, on the thread that owns the device between its BeginFrame and EndFrame.
+        // return the number of resources loaded
+        uint32 ProcessUploads();
+
+        // the thread that owns the device and processes the uploads, the first one to wait on a load unless it's bound before
+        void BindDeviceThread();
+        bool IsDeviceThread();
+
+        // the request decoded on this thread, null outside of a load
+        static ResourceLoadRequest* CurrentLoadRequest();
+
+        template<typename T>
+        static bool IsReady(const std::shared_future<T>& future)
+        {
+            return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
         }
 
         template<ResourceClass T>
@@ -141,13 +283,115 @@ namespace MRenderer
             return DumpJson(res, res.GetRepoPath());
         }
 
+        // the binary data of the resources dumped from now on are block compressed, see @BinaryData::CompressedPayloadFlag
+        inline void SetCompressPayloads(bool compress) { mCompressPayloads = compress; }
+        inline bool CompressPayloads() const { return mCompressPayloads; }
+
+        // resolve the repo paths through the archive at @path before the loose files, see @AssetArchive.
+        // the files imported since the archive was packed are still loaded, but the packed ones shadow their loose copies
+        bool MountArchive(std::string_view path);
+        inline const std::shared_ptr<AssetArchive>& GetArchive() const { return mArchive; }
+
+        // the loaded resources, the unreferenced ones are evicted over its budget whenever resources are loaded
+        inline ResourceCache& GetResourceCache() { return mResourceCache; }
+
     protected:
         ResourceLoader() = default;
 
+        // false if no archive is mounted or @file_path isn't packed
+        bool LoadArchivedBinary(BinarySerializer& serializer, std::string_view file_path, bool memory_mapped, std::vector<uint8>& out_storage);
+        std::optional<nlohmann::json> LoadArchivedJson(std::string_view file_path);
+
         static std::string GenerateDataPath(std::string_view path);
-        static TextureData GenerateImageMipmaps(const DirectX::Image* mip_0);
+        static TextureData GenerateImageMipmaps(const DirectX::Image* mip_0, bool generate_mips=true);
+
+        // @LoadResourceAsync with @mMutex held, @out_request is set to the request unless the resource was loaded already
+        template<ResourceClass T>
+        std::shared_future<std::shared_ptr<T>> LoadResourceLocked(std::string_view repo_path, ELoadPriority priority, std::shared_ptr<ResourceLoadRequest>* out_request)
+        {
+            using Future = std::shared_future<std::shared_ptr<T>>;
+
+            std::string key(repo_path);
+
+            std::shared_ptr<IResource> cached = mResourceCache.Find(key);
+            if (cached)
+            {
+                std::shared_ptr<T> ret = std::static_pointer_cast<T>(cached);
+                ASSERT(ret);
+
+                std::promise<std::shared_ptr<T>> promise;
+                promise.set_value(std::move(ret));
+                return promise.get_future().share();
+            }
+
+            auto pending = mPendingLoads.find(key);
+            if (pending != mPendingLoads.end())
+            {
+                Promote(pending->second.Request, priority);
+                if (out_request)
+                {
+                    *out_request = pending->second.Request;
+                }
+                return *std::static_pointer_cast<Future>(pending->second.Future);
+            }
+
+            std::shared_ptr<std::promise<std::shared_ptr<T>>> promise = std::make_shared<std::promise<std::shared_ptr<T>>>();
+            std::shared_ptr<Future> future = std::make_shared<Future>(promise->get_future().share());
+
+            std::shared_ptr<ResourceLoadRequest> request = std::make_shared<ResourceLoadRequest>();
+            request->RepoPath = key;
+            request->Priority = priority;
+            request->Category = GetResourceCategory<T>();
+            request->DecodeOnDevice = DeviceDecodedResource<T>;
+            request->Decode = [this, key]()
+                {
+                    // deserialized it from json file
+                    std::shared_ptr<T> resource = std::make_shared<T>();
+                    resource->SetRepoPath(key);
+                    LoadJson(*resource, key);
+                    return std::static_pointer_cast<IResource>(resource);
+                };
+            request->Fulfill = [promise](const std::shared_ptr<IResource>& resource)
+                {
+                    promise->set_value(std::static_pointer_cast<T>(resource));
+                };
+
+            if (out_request)
+            {
+                *out_request = request;
+            }
+            mPendingLoads.emplace(key, PendingLoad{ .Request = request, .Future = future });
+            Enqueue(std::move(request));
+            return *future;
+        }
+
+        // @mMutex is held
+        void Enqueue(std::shared_ptr<ResourceLoadRequest> request);
+        void Promote(const std::shared_ptr<ResourceLoadRequest>& request, ELoadPriority priority);
+
+        // the job dispatched for each request, it decodes the most urgent one queued
+        void DecodeNext();
+        static void DecodeRequest(ResourceLoadRequest& request);
+
+        // process the uploads, or wait for a decode to finish if there is none
+        void PumpUploads();
 
     protected:
-        std::unordered_map<std::string_view, std::shared_ptr<IResource>> mResourceCache;
+        struct PendingLoad
+        {
+            std::shared_ptr<ResourceLoadRequest> Request;
+            std::shared_ptr<void> Future;   // std::shared_future<std::shared_ptr<T>> of the requested type
+        };
+
+        ResourceCache mResourceCache;
+        std::unordered_map<std::string, PendingLoad> mPendingLoads;
+        std::deque<std::shared_ptr<ResourceLoadRequest>> mDecodeQueues[ELoadPriority_Count];
+        std::vector<std::shared_ptr<ResourceLoadRequest>> mUploadQueue;
+        std::mutex mMutex;
+        std::condition_variable mEventDecoded;
+        std::atomic<std::thread::id> mDeviceThread;
+
+        std::shared_ptr<AssetArchive> mArchive;
+        bool mCompressPayloads = false;
     };
 }
\ No newline at end of file
@@ -1,4 +1,4 @@
-#include <d3d11.h>
+#include "Resource/BlockCompression.h"
 #include "Resource/ResourceDef.h"
 #include "DirectXTex.h"
 
@@ -13,23 +13,56 @@ namespace MRenderer
         static const DXGI_FORMAT LDRTextureBCFormat = DXGI_FORMAT_BC1_UNORM;
         static const DXGI_FORMAT HDRTextureBCFormat = DXGI_FORMAT_BC6H_UF16;
 
+        // the block format and quality of the textures compressed on this thread, see @TextureData::BinarySerialize
+        class SettingsScope
+        {
+        public:
+            SettingsScope(EBlockFormat format, EBlockQuality quality);
+
+            // keep the format of the enclosing scope
+            explicit SettingsScope(EBlockQuality quality);
+            ~SettingsScope();
+
+        protected:
+            EBlockFormat mPreviousFormat;
+            EBlockQuality mPreviousQuality;
+        };
+
     public:
         static TextureCompressor* Instance();
 
-        void Compress(uint32 width, uint32 height, uint32 mip_levels, ETextureFormat format, uint32 data_size, const uint8* data_ptr, CompressionHandler on_complete);
-        void Decompress(uint32 width, uint32 height, uint32 mip_levels, ETextureFormat format, uint32 data_size, const uint8* data_ptr, CompressionHandler on_complete);
+        // the block format the textures of @format are compressed in on this thread, the setting for the 8 bits unorm ones, BC6H for the
+        // float rgba ones, and none for the others, which are stored uncompressed
+        static EBlockFormat GetBlockFormat(ETextureFormat format);
+        static EBlockQuality GetBlockQuality();
+
+        // encoded with @BlockCompression on the workers, @block_format none hands the pixels over as they are
+        void Compress(uint32 width, uint32 height, uint32 mip_levels, ETextureFormat format, uint32 data_size, const uint8* data_ptr, CompressionHandler on_complete,
+            EBlockFormat block_format = EBlockFormat_None, EBlockQuality quality = EBlockQuality_Normal);
+
+        // the textures compressed with DirectXTex are BC1 unless they are hdr, they are decoded by @BlockCompression but the BC1 of the formats
+        // it doesn't take, which DirectXTex decompresses
+        void Decompress(uint32 width, uint32 height, uint32 mip_levels, ETextureFormat format, uint32 data_size, const uint8* data_ptr, CompressionHandler on_complete,
+            EBlockFormat block_format = EBlockFormat_None);
 
     protected:
-        TextureCompressor();
+        TextureCompressor() = default;
+
+        static std::vector<uint8> ExpandToRGBA8(uint32 num_pixels, ETextureFormat format, const uint8* data_ptr);
+        static std::vector<uint8> NarrowFromRGBA8(uint32 num_pixels, ETextureFormat format, const uint8* data_ptr);
+
+        // the rgba half pixels BC6H is encoded from and decoded into
+        static std::vector<uint8> ConvertToRGBA16F(uint32 num_pixels, ETextureFormat format, const uint8* data_ptr);
+        static std::vector<uint8> ConvertFromRGBA16F(uint32 num_pixels, ETextureFormat format, const uint8* data_ptr);
 
-        void TextureCompressInternal(uint32 width, uint32 height, uint32 mip_levels, DXGI_FORMAT orignal_format, DXGI_FORMAT compressed_format, uint32 data_size, const uint8* data_ptr, CompressionHandler on_complete);
         void TextureDecompressInternal(uint32 width, uint32 height, uint32 mip_levels, DXGI_FORMAT original_format, DXGI_FORMAT compressed_format, uint32 data_size, const uint8* data_ptr, CompressionHandler on_complete);
 
+        // 8 bits unorm channels, the formats @BlockCompression encodes
+        static bool IsByteFormat(ETextureFormat format);
+
+        // float rgba, the formats encoded in BC6H
+        static bool IsHalfConvertibleFormat(ETextureFormat format);
         static DXGI_FORMAT GetCompressedFormat(DXGI_FORMAT format);
         static bool IsHDRFormat(DXGI_FORMAT format);
-    protected:
-        // directxtex BC6H compress don't support D3D12, so we need to create d3d11 device here for gpu BC6H compression
-        ComPtr<ID3D11Device> mDevice;
-        ComPtr<ID3D11DeviceContext> mContext;
     };
 }
\ No newline at end of file
@@ -0,0 +1,39 @@
+#pragma once
+#include <vector>
+
+#include "Resource/BasicStorage.h"
+
+namespace MRenderer
+{
+    // conversion of the imported meshes between @StandardVertex and the 20 bytes @CompactVertex, and narrowing of their index buffers.
+    // positions are quantized to 16 bits in the bound of the mesh, the unit vectors are octahedral encoded into 2 snorm16, the texture
+    // coordinates are half floats and the color is dropped, since the importer always sets it to white
+    class VertexCompression
+    {
+    public:
+        static constexpr uint32 MinVerticesPerJob = 16384;
+
+        // the largest vertex span of a sub mesh with 16 bits indices, 0xFFFF is left out as it's the strip cut value
+        static constexpr uint32 MaxShortIndexSpan = 0xFFFF;
+
+        // map the unit vector @v onto the octahedron and unfold it into a square, the 4 nearest snorm16 points are tried and the one
+        // decoded closest to @v is kept. a zero vector is encoded as +z
+        // ref: Cigolle et al. 2014, A Survey of Efficient Representations for Independent Unit Vectors
+        static void EncodeOctahedral(const Vector3& v, int16* out_encoded);
+        static Vector3 DecodeOctahedral(const int16* encoded);
+
+        static CompactVertex EncodeVertex(const StandardVertex& vertex, const AABB& bound);
+        static StandardVertex DecodeVertex(const CompactVertex& vertex, const AABB& bound);
+
+        // encode @vertices in parallel into a vertex buffer of @CompactVertexFormat, @bound must contain all the positions
+        static BinaryData EncodeVertices(const std::vector<StandardVertex>& vertices, const AABB& bound);
+
+        // narrow @indices to 16 bits if each sub mesh, together with its lods, spans less than @MaxShortIndexSpan vertices, the indices are
+        // then stored relative to the lowest vertex of their sub mesh. otherwise the indices are copied as is. @out_format describes the result
+        static BinaryData EncodeIndices(const std::vector<uint32>& indices, const std::vector<SubMeshData>& sub_meshes, const MeshLodChunk& lods, IndexFormatChunk& out_format);
+
+        // positions and absolute 32 bits indices of @mesh whatever its formats are, for the cpu side users like the occlusion culling
+        static void DecodePositions(const MeshData& mesh, std::vector<Vector3>& out_positions);
+        static void DecodeIndices(const MeshData& mesh, std::vector<uint32>& out_indices);
+    };
+}
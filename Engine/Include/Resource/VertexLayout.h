@@ -11,6 +11,7 @@ namespace MRenderer
         EVertexFormat_None = 0,
         EVertexFormat_P3F_T2F = 1,
         EVertexFormat_P3F_N3F_T3F_C3F_T2F = 2,
+        EVertexFormat_P4U16_N2S16_T2S16_T2H = 3,
     };
 
 
@@ -53,6 +54,26 @@ namespace MRenderer
         Vector2 TexCoord0;
     };
 
+    // compact version of @EVertexFormat_P3F_N3F_T3F_C3F_T2F without the color, see @VertexCompression
+    template<>
+    struct Vertex<EVertexFormat_P4U16_N2S16_T2S16_T2H>
+    {
+        static constexpr D3D12_INPUT_ELEMENT_DESC VertexLayout[] =
+        {
+            { "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+            { "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, 8, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+            { "TANGENT", 0, DXGI_FORMAT_R16G16_SNORM, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+            { "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, 16 , D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+        };
+
+        static constexpr size_t NumLayoutElements = std::size(VertexLayout);
+
+        uint16 Position[4];     // normalized in the bound of the mesh, w is padding
+        int16 Normal[2];        // octahedral encoded
+        int16 Tangent[2];       // octahedral encoded
+        uint16 TexCoord0[2];    // half float
+    };
+
     struct VertexDefination
     {
         EVertexFormat Format;
@@ -77,11 +98,15 @@ namespace MRenderer
     constexpr EVertexFormat StandardVertexFormat = EVertexFormat_P3F_N3F_T3F_C3F_T2F;
     using StandardVertex = Vertex<StandardVertexFormat>;
 
+    constexpr EVertexFormat CompactVertexFormat = EVertexFormat_P4U16_N2S16_T2S16_T2H;
+    using CompactVertex = Vertex<CompactVertexFormat>;
+
     // look-up table for convert EVertexFormat to VertexDeclaration
     constexpr std::array VertexDeclarationsTable = {
         VertexDefination(), // for EVertexFormat_None
         DeclareVertex<EVertexFormat_P3F_T2F>(),
-        DeclareVertex<EVertexFormat_P3F_N3F_T3F_C3F_T2F>()
+        DeclareVertex<EVertexFormat_P3F_N3F_T3F_C3F_T2F>(),
+        DeclareVertex<EVertexFormat_P4U16_N2S16_T2S16_T2H>()
     };
 
     inline const VertexDefination& GetVertexLayout(EVertexFormat format)
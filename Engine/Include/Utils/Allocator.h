@@ -216,6 +216,15 @@ namespace MRenderer
             data_ptr = nullptr;
         }
 
+        // allocate the first page with @capacity blocks instead of @DEFAULT_CAPACITY, it does nothing if there is a page already
+        void Reserve(size_t capacity)
+        {
+            if (mPages.empty() && capacity > 0)
+            {
+                _Expand(capacity);
+            }
+        }
+
         void Clear() 
         {
             for (Page& page : mPages) 
@@ -287,9 +296,12 @@ namespace MRenderer
         }
 
     protected:
-        void _Expand()
+        void _Expand(size_t capacity = 0)
         {
-            size_t capacity = mPages.empty() ? DEFAULT_CAPACITY : static_cast<size_t>(mPages.back().Capacity * 1.5);
+            if (capacity == 0)
+            {
+                capacity = mPages.empty() ? DEFAULT_CAPACITY : std::max(static_cast<size_t>(mPages.back().Capacity * 1.5), size_t(2));
+            }
 
             // allocate memory
             Block* blocks = reinterpret_cast<Block*>(_aligned_malloc(sizeof(Block) * capacity, alignof(Block)));
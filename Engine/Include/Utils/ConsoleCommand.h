@@ -29,6 +29,77 @@ namespace MRenderer
             mParser.add<std::string>("output", 'o', "Repository File Path", true, "");
             mParser.add<float>("scale", 's', "Model Scale", false, 1.0f);
             mParser.add<bool>("flip_uv_y", 'y', "Flip UV Y axis", false, false);
+            mParser.add<bool>("compress", 'c', "Compress The Binary Data", false, false);
+        }
+
+        void Execute() override;
+    };
+
+    // import obj file to a temporary directory and report the time of each stage of the import pipeline
+    class BenchmarkImportModelCommand : public ConsoleCommand
+    {
+    public:
+        BenchmarkImportModelCommand()
+        {
+            mParser.add<std::string>("file", 'f', "Model File Path", true, "");
+            mParser.add<float>("scale", 's', "Model Scale", false, 1.0f);
+            mParser.add<bool>("flip_uv_y", 'y', "Flip UV Y axis", false, false);
+            mParser.add<int>("rounds", 'n', "Number Of Imports", false, 1);
+            mParser.add<bool>("baseline", 'b', "Also Time tinyobj::LoadObj", false, false);
+        }
+
+        void Execute() override;
+    };
+
+    // load the meshes and the textures of the resources under a folder, memory mapped and then copied, and report the load time and the
+    // memory of each way
+    class BenchmarkLoadCommand : public ConsoleCommand
+    {
+    public:
+        BenchmarkLoadCommand()
+        {
+            mParser.add<std::string>("folder", 'f', "Resource Folder Path", true, "");
+        }
+
+        void Execute() override;
+    };
+
+    // compress the binary files under a folder as block compressed payloads, and report the ratio and the decode speed on one thread and
+    // on the workers, see @BinaryData::CompressedPayloadFlag
+    class BenchmarkCompressionCommand : public ConsoleCommand
+    {
+    public:
+        BenchmarkCompressionCommand()
+        {
+            mParser.add<std::string>("folder", 'f', "Resource Folder Path", false, "Asset");
+            mParser.add<int>("rounds", 'n', "Number Of Decodes", false, 5);
+        }
+
+        void Execute() override;
+    };
+
+    // pack the resources of a repo folder into an archive, which is mounted at startup if it's at @ResourceLoader::DefaultArchivePath
+    class PackArchiveCommand : public ConsoleCommand
+    {
+    public:
+        PackArchiveCommand()
+        {
+            mParser.add<std::string>("folder", 'f', "Resource Folder Path", false, "Asset");
+            mParser.add<std::string>("output", 'o', "Archive File Path", false, "Asset.pak");
+            mParser.add<bool>("compress", 'c', "Compress The Entries", false, false);
+        }
+
+        void Execute() override;
+    };
+
+    // report the cached resources by category, a budget evicts the unreferenced ones down to it, see @ResourceCache
+    class ResourceCacheCommand : public ConsoleCommand
+    {
+    public:
+        ResourceCacheCommand()
+        {
+            mParser.add<int>("budget", 'b', "Cache Budget In MB, Negative Keeps The Current One", false, -1);
+            mParser.add<bool>("trim", 't', "Evict The Unreferenced Resources Over The Budget", false, false);
         }
 
         void Execute() override;
@@ -42,6 +113,8 @@ namespace MRenderer
             mParser.add<std::string>("file", 'f', "Model File Path", true, "");
             mParser.add<std::string>("output", 'o', "Repository File Path", true, "");
             mParser.add<int>("format", 'm', "DXGI Format", true, ETextureFormat_None);
+            mParser.add<std::string>("block", 'b', "Block Format Of LDR Images: BC1, BC3, BC5, BC7", false, "BC1");
+            mParser.add<std::string>("quality", 'q', "Block Compression Quality: Fast, Normal, Slow", false, "Normal");
         }
 
         void Execute() override;
@@ -91,6 +164,11 @@ namespace MRenderer
         CommandExecutor() 
         {
             mCommandMap["ImportModel"] = std::make_unique<ImportModelCommand>();
+            mCommandMap["BenchmarkImportModel"] = std::make_unique<BenchmarkImportModelCommand>();
+            mCommandMap["BenchmarkLoad"] = std::make_unique<BenchmarkLoadCommand>();
+            mCommandMap["BenchmarkCompression"] = std::make_unique<BenchmarkCompressionCommand>();
+            mCommandMap["PackArchive"] = std::make_unique<PackArchiveCommand>();
+            mCommandMap["ResourceCache"] = std::make_unique<ResourceCacheCommand>();
             mCommandMap["ImportTexture"] = std::make_unique<ImportTextureCommand>();
             mCommandMap["ImportCubeMap"] = std::make_unique<ImportCubeMapCommand>();
             mCommandMap["CreateSphereModel"] = std::make_unique<CreateSphereModelCommand>();
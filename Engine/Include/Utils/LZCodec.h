@@ -0,0 +1,32 @@
+#pragma once
+#include <vector>
+
+#include "Fundation.h"
+
+namespace MRenderer
+{
+    // byte oriented LZ77 with the block layout of LZ4, fast to decode and good enough for the json and the mesh data of the archives.
+    // a block is a list of sequences [token][literal length][literals][offset][match length], the token holds 4 bits of each length and
+    // a nibble of 15 continues in the following bytes. the last sequence has literals only
+    // ref: https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md
+    class LZCodec
+    {
+    public:
+        static constexpr uint32 MinMatch = 4;
+        static constexpr uint32 MaxOffset = 0xFFFF;
+        static constexpr uint32 HashBits = 16;
+
+        // the largest size @Compress may return for @size bytes, when nothing matches
+        static constexpr uint32 CompressBound(uint32 size)
+        {
+            return size + size / 255 + 16;
+        }
+
+        // compress @size bytes of @src into @dst of at least @CompressBound bytes, returns the compressed size
+        static uint32 Compress(const uint8* src, uint32 size, uint8* dst);
+        static std::vector<uint8> Compress(const uint8* src, uint32 size);
+
+        // false if @src is corrupted or doesn't decode to exactly @raw_size bytes, @dst is never written past @raw_size
+        static bool Decompress(const uint8* src, uint32 size, uint8* dst, uint32 raw_size);
+    };
+}
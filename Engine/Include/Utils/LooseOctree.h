@@ -1,5 +1,11 @@
+#pragma once
 #include "Utils/MathLib.h"
 #include "Utils/Allocator.h"
+#include "Utils/Thread.h"
+
+#include <bit>
+#include <mutex>
+#include <span>
 
 namespace MRenderer 
 {
@@ -32,6 +38,20 @@ namespace MRenderer
 
         static_assert(LooseBound >= 1.0f && LooseBound <= 1.5f);
 
+        // subtrees at this depth are culled on worker threads in parallel, the levels above are culled on the calling thread
+        static constexpr uint32 CullFanOutDepth = 2;
+
+        // below this number of elements, culling in parallel costs more than it saves
+        static constexpr uint32 ParallelCullThreshold = 2048;
+        static constexpr uint32 NoFanOut = std::numeric_limits<uint32>::max();
+
+        // layout of the sort key for @Build, a morton code truncated at the depth the object stops at, followed by the depth
+        // |31 ... 8|7 .. 4|3 .. 0|
+        // | octants| empty| depth|
+        static constexpr uint32 BuildKeyDepthBits = 4;
+        static constexpr uint32 BuildKeyOctantShift = 32 - 3;
+        static_assert(MaxDepth * 3 + BuildKeyDepthBits <= 32 && MaxDepth < (1 << BuildKeyDepthBits));
+
     public:
         // Index for referencing an element in the octree
         struct OctreeElement
@@ -40,16 +60,19 @@ namespace MRenderer
         public:
 
             template<typename... Args>
-            OctreeElement(int node_index, const AABB& bound, Args&&... args)
+            OctreeElement(uint32 node_index, const AABB& bound, Args&&... args)
                 : NodeIndex(node_index), Bound(bound), Object(args...) {
             }
 
             T& operator->() { return Object; }
 
         protected:
-            int NodeIndex;
+            uint32 NodeIndex;
             AABB Bound;
             T Object;
+
+            // index in the SoA bound cache for culling
+            uint32 CullIndex = 0;
         };
 
     protected:
@@ -78,6 +101,15 @@ namespace MRenderer
         // we use ElementsIndex to refer the actual vector rather than nest std::vector in OctreeNode, so the size of OctreeNode is 32 bytes, and we can fit 2 objects in a cache line
         static_assert(sizeof(OctreeNode) == 32);
 
+        // elements of the cull cache are stored in depth first order, so a node's own elements come first,
+        // followed by the elements of its subtrees. a subtree that is completely inside the frustum is one contiguous range
+        struct CullNode
+        {
+            uint32 ElementBegin;
+            uint32 ElementEnd;
+            uint32 SubtreeEnd;
+        };
+
 
     public:
         LooseOctree(float size)
@@ -94,6 +126,7 @@ namespace MRenderer
             OctreeElement* element = AddObjectInternal(0, bound, std::forward<Args>(args)...);
             ASSERT(element);
             
+            mCullCacheDirty = true;
             return element;
         }
 
@@ -102,6 +135,8 @@ namespace MRenderer
             CheckElementId(element);
             mElementTable[mNodeTable[element->NodeIndex].ElementsIndex].Free(element);
             element = nullptr;
+
+            mCullCacheDirty = true;
         }
 
         OctreeElement* UpdateElement(OctreeElement* element, AABB new_bound)
@@ -112,22 +147,121 @@ namespace MRenderer
             {
                 // the octree node can keep the object if it's still in bound
                 element->Bound = new_bound;
+
+                // the layout of the cull cache doesn't change, just patch the bound
+                if (!mCullCacheDirty)
+                {
+                    mCullElementBounds.Set(element->CullIndex, new_bound);
+                }
                 return element;
             }
             else
             {
                 // otherwise, remove and re-add it
+                T object = std::move(element->Object);
                 RemoveElement(element);
-                return AddObjectInternal(0, element->Bound, std::move(element->Object));
+                return AddObjectInternal(0, new_bound, std::move(object));
             }
         }
 
+        // build the tree from scratch with all the objects at once, the existing objects are discarded
+        // 1. each object gets a key from the octants its center falls into on the way down, until its bound no longer fits into the child.
+        //    it's the morton code of the center, truncated at the depth where the object stays
+        // 2. keys are radix sorted in parallel, so that objects of a subtree are contiguous, and objects staying in a node precede the ones in its children
+        // 3. nodes and elements are emitted top-down from the sorted ranges in one pass, a node is subdivided if it holds more than @MaxCapacityToSplit objects
+        // the result is an ordinary octree, @AddObject and @UpdateElement keep working on it.
+        // returns the element of each object in the same order as @bounds, objects outside of the octree get nullptr
+        std::vector<OctreeElement*> Build(std::span<const AABB> bounds, std::span<const T> objects)
+        {
+            ASSERT(bounds.size() == objects.size());
+
+            mNodeTable.clear();
+            mElementTable.clear();
+            mNodeTable.emplace_back(mBound, -1, 0);
+            mElementTable.emplace_back();
+            mCullCacheDirty = true;
+
+            uint32 num_objects = static_cast<uint32>(bounds.size());
+            std::vector<OctreeElement*> elements(num_objects, nullptr);
+
+            // pack the key in the high 32 bits and the object index in the low 32 bits
+            std::vector<uint64> items(num_objects);
+            JobHandle handle = TaskScheduler::Instance().ParallelFor(num_objects, 1024,
+                [&](uint32 begin, uint32 end)
+                {
+                    for (uint32 i = begin; i < end; i++)
+                    {
+                        items[i] = (static_cast<uint64>(CalculateBuildKey(bounds[i])) << 32) | i;
+                    }
+                }
+            );
+            TaskScheduler::Instance().Wait(handle);
+
+            // objects outside of the octree are marked with the invalid key
+            std::erase_if(items, [](uint64 item) { return (item >> 32) == InvalidBuildKey; });
+            ParallelRadixSort(items, 32, 64);
+
+            if (!items.empty())
+            {
+                BuildNode(0, 0, items.data(), items.data() + items.size(), bounds, objects, elements);
+            }
+
+            return elements;
+        }
+
         template<typename Func>
         void FrustumCull(const FrustumVolume& Frustum, const Func& func)
         {
             FrustumCullInternal(Frustum, 0, func);
         }
 
+        // collect the objects that intersect with the frustum into @output
+        // 1. nodes and elements are tested 8 at a time against the SoA copy of their bounds
+        // 2. subtrees completely inside the frustum are copied out without testing their elements
+        // 3. subtrees at @CullFanOutDepth are culled on workers, each into its own output array
+        // the order of the output is unspecified. views may be culled at the same time, e.g. the shadow ones on workers, as long as the
+        // tree isn't changed meanwhile, the scratch of a cull is its own
+        void FrustumCull(const FrustumVolume& frustum, std::vector<T>& output)
+            requires std::is_copy_constructible_v<T>
+        {
+            output.clear();
+            RebuildCullCache();
+
+            if (!frustum.Contains(mBound))
+            {
+                return;
+            }
+
+            bool parallel = mCullElementObjects.size() >= ParallelCullThreshold;
+
+            std::vector<uint32> subtrees;
+            CullNodeSIMD(frustum, 0, 0, parallel ? CullFanOutDepth : NoFanOut, output, subtrees);
+
+            if (subtrees.empty())
+            {
+                return;
+            }
+
+            uint32 num_subtrees = static_cast<uint32>(subtrees.size());
+            std::vector<std::vector<T>> outputs(num_subtrees);
+
+            JobHandle handle = TaskScheduler::Instance().ParallelFor(num_subtrees, 1,
+                [&](uint32 begin, uint32 end)
+                {
+                    for (uint32 i = begin; i < end; i++)
+                    {
+                        CullNodeSIMD(frustum, subtrees[i], 0, NoFanOut, outputs[i], subtrees);
+                    }
+                }
+            );
+            TaskScheduler::Instance().Wait(handle);
+
+            for (uint32 i = 0; i < num_subtrees; i++)
+            {
+                output.insert(output.end(), outputs[i].begin(), outputs[i].end());
+            }
+        }
+
     protected:
         template<typename... Args>
         OctreeElement* AddObjectInternal(int node_index, const AABB& bound, Args&&... args)
@@ -177,61 +311,72 @@ namespace MRenderer
         {
             int child_index = static_cast<int>(mNodeTable.size());
             AABB bound = mNodeTable[node_index].Bound;
-            Vector3 center = bound.Center();
-            Vector3 half_size = bound.Size() * 0.5f;
-
 
             for (uint32 i = 0; i < NumOctreeLeaf; i++)
             {
-                // the distribution of the children:
-                /*    6-------7
-                     /|      /|
-                    2-+-----3 |
-                    | |     | |   y
-                    | 4-----+-5   | z
-                    |/      |/    |/
-                    0-------1     +--x
-
-                         zyx
-                    0: 0x000
-                    1: 0x001
-                    2: 0x010
-                    3: 0x011
-                    4: 0x100
-                    5: 0x101
-                    6: 0x110
-                    7: 0x111
-
-                    // child node only expand in one direction of the basis axis
-                    // sometheing like this
-                    |--------|---|
-                    |        |   |
-                    |--------|---|  y
-                    |        |   |  ^
-                    |        |   |  |
-                    |        |   |  |
-                    |--------|---|  ------> x
-                */
-
-                Vector3 max =
-                {
-                    i & 0x1 ? bound.Max.x : center.x,
-                    i & 0x2 ? bound.Max.y : center.y,
-                    i & 0x4 ? bound.Max.z : center.z
-                };
-
-                Vector3 min = max - half_size;
-                mNodeTable.emplace_back(AABB(min, max), -1, static_cast<int>(mElementTable.size()));
+                mNodeTable.emplace_back(ChildBound(bound, i), -1, static_cast<int>(mElementTable.size()));
                 mElementTable.emplace_back();
             }
 
             mNodeTable[node_index].Children = child_index;
         }
 
+        // the bound of the @i th child of a node with @bound
+        static AABB ChildBound(const AABB& bound, uint32 i)
+        {
+            Vector3 center = bound.Center();
+            Vector3 half_size = bound.Size() * 0.5f;
+
+            // the distribution of the children:
+            /*    6-------7
+                 /|      /|
+                2-+-----3 |
+                | |     | |   y
+                | 4-----+-5   | z
+                |/      |/    |/
+                0-------1     +--x
+
+                     zyx
+                0: 0x000
+                1: 0x001
+                2: 0x010
+                3: 0x011
+                4: 0x100
+                5: 0x101
+                6: 0x110
+                7: 0x111
+
+                // child node only expand in one direction of the basis axis
+                // sometheing like this
+                |--------|---|
+                |        |   |
+                |--------|---|  y
+                |        |   |  ^
+                |        |   |  |
+                |        |   |  |
+                |--------|---|  ------> x
+            */
+
+            Vector3 max =
+            {
+                i & 0x1 ? bound.Max.x : center.x,
+                i & 0x2 ? bound.Max.y : center.y,
+                i & 0x4 ? bound.Max.z : center.z
+            };
+
+            Vector3 min = max - half_size;
+            return AABB(min, max);
+        }
+
         // find the closest child node that near this AABB
         uint32 FindBestFitChild(int node_index, const AABB& bound)
         {
-            Vector3 vec = bound.Center() - mNodeTable[node_index].Bound.Center();
+            return FindBestFitOctant(mNodeTable[node_index].Bound, bound) + mNodeTable[node_index].Children;
+        }
+
+        static uint32 FindBestFitOctant(const AABB& node_bound, const AABB& bound)
+        {
+            Vector3 vec = bound.Center() - node_bound.Center();
             uint32 index = 0;
             
             if (vec.x >= 0)
@@ -249,7 +394,112 @@ namespace MRenderer
                 index |= 0x4;
             }
 
-            return index + mNodeTable[node_index].Children;
+            return index;
+        }
+
+        static constexpr uint32 InvalidBuildKey = std::numeric_limits<uint32>::max();
+
+        // walk down the same way as @AddObjectInternal does, see @Build
+        // it's the hot loop of @Build, so @ChildBound, @FindBestFitOctant and @AABB::Contain are expanded here with scalar math,
+        // the operations are the same as theirs, so the results are bit exact
+        uint32 CalculateBuildKey(const AABB& bound) const
+        {
+            if (!mBound.Contain(bound))
+            {
+                return InvalidBuildKey;
+            }
+
+            const float bound_min[3] = { bound.Min.x, bound.Min.y, bound.Min.z };
+            const float bound_max[3] = { bound.Max.x, bound.Max.y, bound.Max.z };
+            float node_min[3] = { mBound.Min.x, mBound.Min.y, mBound.Min.z };
+            float node_max[3] = { mBound.Max.x, mBound.Max.y, mBound.Max.z };
+
+            float bound_center[3];
+            for (uint32 axis = 0; axis < 3; axis++)
+            {
+                bound_center[axis] = (bound_min[axis] + bound_max[axis]) * 0.5f;
+            }
+
+            uint32 key = 0;
+            uint32 depth = 0;
+            for (; depth < MaxDepth; depth++)
+            {
+                uint32 octant = 0;
+                float child_min[3];
+                float child_max[3];
+                bool contain = true;
+
+                for (uint32 axis = 0; axis < 3; axis++)
+                {
+                    float center = (node_min[axis] + node_max[axis]) * 0.5f;
+                    float half_size = (node_max[axis] - node_min[axis]) * 0.5f;
+
+                    bool positive = bound_center[axis] - center >= 0;
+                    octant |= positive << axis;
+
+                    child_max[axis] = positive ? node_max[axis] : center;
+                    child_min[axis] = child_max[axis] - half_size;
+                    contain &= bound_min[axis] > child_min[axis] && bound_max[axis] < child_max[axis];
+                }
+
+                if (!contain)
+                {
+                    break;
+                }
+
+                key |= octant << (BuildKeyOctantShift - depth * 3);
+                std::copy_n(child_min, 3, node_min);
+                std::copy_n(child_max, 3, node_max);
+            }
+
+            return key | depth;
+        }
+
+        static inline uint32 BuildKeyDepth(uint64 item) { return static_cast<uint32>(item >> 32) & ((1 << BuildKeyDepthBits) - 1); }
+        static inline uint32 BuildKeyOctant(uint64 item, uint32 depth) { return static_cast<uint32>(item >> (32 + BuildKeyOctantShift - depth * 3)) & 0x7; }
+
+        // emit node @node_index at @depth with the sorted objects in [@begin, @end)
+        void BuildNode(int node_index, uint32 depth, const uint64* begin, const uint64* end, std::span<const AABB> bounds, std::span<const T> objects, std::vector<OctreeElement*>& elements)
+        {
+            bool subdivide = end - begin > MaxCapacityToSplit && mNodeTable[node_index].Bound.Width() > MinNodeSize;
+
+            // objects that can't go deeper stay in this node, they come first in the range
+            const uint64* it = begin;
+            while (it != end && (!subdivide || BuildKeyDepth(*it) == depth))
+            {
+                it++;
+            }
+
+            ElementTable& table = mElementTable[mNodeTable[node_index].ElementsIndex];
+            table.Reserve(it - begin);
+            for (const uint64* item = begin; item != it; item++)
+            {
+                uint32 index = static_cast<uint32>(*item);
+                elements[index] = table.Allocate(node_index, bounds[index], objects[index]);
+            }
+
+            if (it == end)
+            {
+                return;
+            }
+
+            SubDivide(node_index);
+            int child_index = mNodeTable[node_index].Children;
+
+            // the rest are grouped by their octant at this depth
+            while (it != end)
+            {
+                uint32 octant = BuildKeyOctant(*it, depth);
+
+                const uint64* child_end = it;
+                while (child_end != end && BuildKeyOctant(*child_end, depth) == octant)
+                {
+                    child_end++;
+                }
+
+                BuildNode(child_index + octant, depth + 1, it, child_end, bounds, objects, elements);
+                it = child_end;
+            }
         }
 
     protected:
@@ -276,6 +526,114 @@ namespace MRenderer
             }
         }
 
+        // cull a node which is known to intersect with the frustum, subtrees at @fan_out_depth are deferred to @out_subtrees
+        void CullNodeSIMD(const FrustumVolume& frustum, uint32 node_index, uint32 depth, uint32 fan_out_depth, std::vector<T>& output, std::vector<uint32>& out_subtrees)
+        {
+            const CullNode& cull_node = mCullNodes[node_index];
+
+            for (uint32 i = cull_node.ElementBegin; i < cull_node.ElementEnd; i += AABBSoA::Stride)
+            {
+                uint32 inside_mask;
+                uint32 visible_mask = frustum.Contains8(mCullElementBounds, i, inside_mask);
+
+                // mask off the elements that belong to the other nodes
+                uint32 count = std::min(cull_node.ElementEnd - i, AABBSoA::Stride);
+                visible_mask &= (1u << count) - 1;
+
+                for (; visible_mask; visible_mask &= visible_mask - 1)
+                {
+                    output.push_back(mCullElementObjects[i + std::countr_zero(visible_mask)]);
+                }
+            }
+
+            const OctreeNode& node = mNodeTable[node_index];
+            if (node.IsLeaf())
+            {
+                return;
+            }
+
+            // children are allocated contiguously, so all of them can be tested at once
+            static_assert(NumOctreeLeaf == AABBSoA::Stride);
+
+            uint32 inside_mask;
+            uint32 visible_mask = frustum.Contains8(mCullNodeBounds, node.Children, inside_mask);
+            for (; visible_mask; visible_mask &= visible_mask - 1)
+            {
+                uint32 i = std::countr_zero(visible_mask);
+                uint32 child_index = node.Children + i;
+
+                if (inside_mask & (1u << i))
+                {
+                    const CullNode& child = mCullNodes[child_index];
+                    output.insert(output.end(), mCullElementObjects.begin() + child.ElementBegin, mCullElementObjects.begin() + child.SubtreeEnd);
+                }
+                else if (depth + 1 == fan_out_depth)
+                {
+                    out_subtrees.push_back(child_index);
+                }
+                else
+                {
+                    CullNodeSIMD(frustum, child_index, depth + 1, fan_out_depth, output, out_subtrees);
+                }
+            }
+        }
+
+        // rebuild the SoA bounds of nodes and elements if the structure of the tree has changed, the first of the culls at the same time does it
+        void RebuildCullCache()
+        {
+            std::lock_guard<std::mutex> lock(mCullCacheMutex);
+            if (!mCullCacheDirty)
+            {
+                return;
+            }
+
+            uint32 num_nodes = static_cast<uint32>(mNodeTable.size());
+            mCullNodes.resize(num_nodes);
+            mCullNodeBounds.Resize(num_nodes);
+            for (uint32 i = 0; i < num_nodes; i++)
+            {
+                mCullNodeBounds.Set(i, mNodeTable[i].Bound);
+            }
+
+            uint32 num_elements = 0;
+            for (const ElementTable& table : mElementTable)
+            {
+                num_elements += static_cast<uint32>(table.Size());
+            }
+
+            mCullElementBounds.Resize(num_elements);
+            mCullElementObjects.clear();
+            mCullElementObjects.reserve(num_elements);
+
+            RebuildCullCacheInternal(0);
+            mCullCacheDirty = false;
+        }
+
+        void RebuildCullCacheInternal(uint32 node_index)
+        {
+            const OctreeNode& node = mNodeTable[node_index];
+            CullNode& cull_node = mCullNodes[node_index];
+
+            cull_node.ElementBegin = static_cast<uint32>(mCullElementObjects.size());
+            for (OctreeElement& element : mElementTable[node.ElementsIndex])
+            {
+                element.CullIndex = static_cast<uint32>(mCullElementObjects.size());
+                mCullElementBounds.Set(element.CullIndex, element.Bound);
+                mCullElementObjects.push_back(element.Object);
+            }
+            cull_node.ElementEnd = static_cast<uint32>(mCullElementObjects.size());
+
+            if (!node.IsLeaf())
+            {
+                for (uint32 i = 0; i < NumOctreeLeaf; i++)
+                {
+                    RebuildCullCacheInternal(node.Children + i);
+                }
+            }
+
+            cull_node.SubtreeEnd = static_cast<uint32>(mCullElementObjects.size());
+        }
+
         inline void CheckElementId(OctreeElement* element) 
         {
             ASSERT(element->NodeIndex < mNodeTable.size() && mElementTable[mNodeTable[element->NodeIndex].ElementsIndex].Validate(element));
@@ -290,5 +648,13 @@ namespace MRenderer
         std::vector<OctreeNode> mNodeTable;
         std::vector<ElementTable> mElementTable;
         ElementTable mTempPool; // temporary pool for subdived process, it's declared as member to avoid heap allocation when subdiveding node
+
+        // SoA copy of the bounds for @FrustumCull, it's rebuilt lazily after the structure of the tree changes
+        bool mCullCacheDirty = true;
+        std::mutex mCullCacheMutex;
+        std::vector<CullNode> mCullNodes;
+        AABBSoA mCullNodeBounds;            // indexed by node index
+        AABBSoA mCullElementBounds;         // indexed by @OctreeElement::CullIndex
+        std::vector<T> mCullElementObjects; // same as above
     };
 }
\ No newline at end of file
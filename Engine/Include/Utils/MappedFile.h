@@ -0,0 +1,41 @@
+#pragma once
+#include <memory>
+#include <string_view>
+
+#include "Fundation.h"
+
+namespace MRenderer
+{
+    // a whole file mapped copy on write into the address space, the pages are only read from disk when they are touched and the ones written
+    // to stay private to the process. views into the file hold a shared_ptr of it to keep the mapping alive, see @BinaryData::View
+    class MappedFile
+    {
+    public:
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        ~MappedFile();
+
+        // nullptr if the file can't be opened or is empty
+        static std::shared_ptr<MappedFile> Open(std::string_view path);
+
+        inline const uint8* Data() const { return mData; }
+        inline uint8* Data() { return mData; }
+        inline uint32 Size() const { return mSize; }
+
+        // ask the os to read the whole file in ahead of the page faults, in one sequential read instead of a fault per page
+        void Prefetch() const;
+
+    protected:
+        MappedFile() = default;
+
+    protected:
+        uint8* mData = nullptr;
+        uint32 mSize = 0;
+
+#if defined(_WIN32)
+        void* mFile = nullptr;
+        void* mMapping = nullptr;
+#endif
+    };
+}
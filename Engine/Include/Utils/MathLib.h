@@ -3,6 +3,7 @@
 #include "Constexpr.h"
 
 #include <sstream>
+#include <vector>
 #include <smmintrin.h>
 
 namespace MRenderer
@@ -65,6 +66,83 @@ namespace MRenderer
         return i;
     }
 
+    // register resident 4-wide float vector, a thin wrapper of __m128 for the hot math code.
+    // unlike @Vector it never round trips through memory, a 3d vector is packed in the first 3 lanes and
+    // the *3 functions ignore the w lane. loads and stores of @Vector2 / @Vector3 only touch their own 8 / 12 bytes
+    struct Vec4f
+    {
+    public:
+        Vec4f()
+            : m(_mm_setzero_ps())
+        {
+        }
+
+        Vec4f(__m128 m)
+            : m(m)
+        {
+        }
+
+        Vec4f(float x, float y, float z, float w)
+            : m(_mm_setr_ps(x, y, z, w))
+        {
+        }
+
+        static inline Vec4f Splat(float value) { return _mm_set1_ps(value); }
+
+        static inline Vec4f Load2(const float* src) { return _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(src))); }
+        static inline Vec4f Load3(const float* src) { return _mm_movelh_ps(Load2(src).m, _mm_load_ss(src + 2)); }
+        static inline Vec4f Load4(const float* src) { return _mm_loadu_ps(src); }
+
+        inline void Store2(float* dst) const { _mm_store_sd(reinterpret_cast<double*>(dst), _mm_castps_pd(m)); }
+        inline void Store3(float* dst) const { Store2(dst); _mm_store_ss(dst + 2, _mm_movehl_ps(m, m)); }
+        inline void Store4(float* dst) const { _mm_storeu_ps(dst, m); }
+
+        inline float X() const { return _mm_cvtss_f32(m); }
+        inline float Y() const { return _mm_cvtss_f32(_mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 1, 1, 1))); }
+        inline float Z() const { return _mm_cvtss_f32(_mm_movehl_ps(m, m)); }
+        inline float W() const { return _mm_cvtss_f32(_mm_shuffle_ps(m, m, _MM_SHUFFLE(3, 3, 3, 3))); }
+
+        // broadcast lane @I to all lanes
+        template<uint32 I> requires (I < 4)
+        inline Vec4f Splat() const { return _mm_shuffle_ps(m, m, _MM_SHUFFLE(I, I, I, I)); }
+
+        inline Vec4f operator+ (Vec4f other) const { return _mm_add_ps(m, other.m); }
+        inline Vec4f operator- (Vec4f other) const { return _mm_sub_ps(m, other.m); }
+        inline Vec4f operator* (Vec4f other) const { return _mm_mul_ps(m, other.m); }
+        inline Vec4f operator/ (Vec4f other) const { return _mm_div_ps(m, other.m); }
+        inline Vec4f operator* (float scale) const { return _mm_mul_ps(m, _mm_set1_ps(scale)); }
+        inline Vec4f operator/ (float scale) const { return _mm_div_ps(m, _mm_set1_ps(scale)); }
+        inline Vec4f operator- () const { return _mm_sub_ps(_mm_setzero_ps(), m); }
+
+        // the dot product is broadcast to all lanes, so it can be used as an operand without shuffling
+        inline Vec4f Dot3(Vec4f other) const { return _mm_dp_ps(m, other.m, 0x7F); }
+        inline Vec4f Dot4(Vec4f other) const { return _mm_dp_ps(m, other.m, 0xFF); }
+
+        // w lane of the result is 0
+        inline Vec4f Cross3(Vec4f other) const
+        {
+            // a.yzx * b.zxy - a.zxy * b.yzx, rearranged to shuffle only 3 times
+            __m128 a_yzx = _mm_shuffle_ps(m, m, _MM_SHUFFLE(3, 0, 2, 1));
+            __m128 b_yzx = _mm_shuffle_ps(other.m, other.m, _MM_SHUFFLE(3, 0, 2, 1));
+            __m128 c = _mm_sub_ps(_mm_mul_ps(m, b_yzx), _mm_mul_ps(a_yzx, other.m));
+            return _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1));
+        }
+
+        inline Vec4f Length3() const { return _mm_sqrt_ps(Dot3(*this).m); }
+        inline Vec4f Normalize3() const { return _mm_div_ps(m, Length3().m); }
+
+        inline Vec4f Abs() const { return _mm_andnot_ps(_mm_set1_ps(-0.0f), m); }
+
+        static inline Vec4f Min(Vec4f a, Vec4f b) { return _mm_min_ps(a.m, b.m); }
+        static inline Vec4f Max(Vec4f a, Vec4f b) { return _mm_max_ps(a.m, b.m); }
+
+        // bit i is set if lane i of @a is less than lane i of @b
+        static inline uint32 LessMask(Vec4f a, Vec4f b) { return _mm_movemask_ps(_mm_cmplt_ps(a.m, b.m)); }
+
+    public:
+        __m128 m;
+    };
+
     // require SSE 4.1
     // see also: https://www.intel.com/content/www/us/en/docs/intrinsics-guide/index.html#ssetechs=SSE,SSE2,SSE3
     template<uint32 N> struct Vector;
@@ -135,10 +213,7 @@ namespace MRenderer
             // e.g 0x71 means dot product the first 3 elements and store the result in the first element of the returened __m128
             constexpr uint32 imm8 = (((1 << N) - 1) << 4) | 0x1;
             lhs = _mm_dp_ps(lhs, rhs, imm8);
-
-            float* staging = StagingBuffer();
-            _mm_store_ps(staging, lhs);
-            return staging[0];
+            return _mm_cvtss_f32(lhs);
         }
 
         std::string ToString() const
@@ -260,21 +335,23 @@ namespace MRenderer
         }
 
 
-        // copy this vector to a __m128
+        // copy this vector to a __m128, the unused lanes are 0
         inline __m128 Store() const
         {
-            // The size and alignment of Vector2 and Vector3 are not 16 bytes.
-            // They need a 16-byte aligned staging buffer to create __m128.
-            if constexpr (N != 4)
+            const float* m = reinterpret_cast<const float*>(this);
+
+            // Vector2 and Vector3 are not 16 bytes, they are loaded with partial loads so that no byte beyond the vector is read
+            if constexpr (N == 2)
             {
-                float* staging = StagingBuffer();
-                memcpy(staging, this, VectorSize);
-                return _mm_load_ps(staging);
+                return Vec4f::Load2(m).m;
+            }
+            else if constexpr (N == 3)
+            {
+                return Vec4f::Load3(m).m;
             }
             // Vector4's size and alignment is 16 bytes, it can creat __m128 directly
             else 
             {
-                const float* m = reinterpret_cast<const float*>(this);
                 return _mm_load_ps(m);
             }
         }
@@ -282,19 +359,34 @@ namespace MRenderer
         // copy src __m128 value to this vector
         inline void Load(__m128 src)
         {
-            if constexpr (N != 4)
+            float* m = reinterpret_cast<float*>(this);
+
+            if constexpr (N == 2)
+            {
+                Vec4f(src).Store2(m);
+            }
+            else if constexpr (N == 3)
             {
-                float* staging = StagingBuffer();
-                _mm_store_ps(staging, src);
-                memcpy(this, staging, VectorSize);
+                Vec4f(src).Store3(m);
             }
             else 
             {
-                float* m = reinterpret_cast<float*>(this);
                 _mm_store_ps(m, src);
             }
         }
 
+        inline Vec4f ToVec4f() const
+        {
+            return Store();
+        }
+
+        static inline VecType FromVec4f(Vec4f vec)
+        {
+            VecType ret;
+            ret.Load(vec.m);
+            return ret;
+        }
+
     public:
         static VecType Clamp(const VecType& vec, const VecType& min, const VecType& max)
         {
@@ -336,17 +428,6 @@ namespace MRenderer
             return ret;
         }
 
-    protected:
-        // 16 byte aligned float[4] staging buffer, it's used as input for _mm_load_ps and output for _mm_store_ps
-        // since they require input or output to be 16 byte aligned
-        static float* StagingBuffer()
-        {
-            static thread_local struct alignas(alignof(__m128)) {
-                float m[4];
-            } staging;
-
-            return staging.m;
-        }
     };
 
     template<>
@@ -519,40 +600,38 @@ namespace MRenderer
 
         inline VectorType operator* (const VectorType& other) const
         {
-            VectorType ret;
+            // M * v = v.x * column0 + v.y * column1 + ..., i.e. transpose the rows and accumulate, no horizontal add is needed
+            __m128 rows[4] = { StoreRow(0), StoreRow(1), StoreRow(2), Row == 4 ? StoreRow(Row - 1) : _mm_setzero_ps() };
+            _MM_TRANSPOSE4_PS(rows[0], rows[1], rows[2], rows[3]);
 
-            for (uint32 r = 0; r < Row; r++)
+            Vec4f vec = other.ToVec4f();
+            Vec4f ret = Vec4f(rows[0]) * vec.Splat<0>() + Vec4f(rows[1]) * vec.Splat<1>() + Vec4f(rows[2]) * vec.Splat<2>();
+            if constexpr (Row == 4)
             {
-                __m128 lhs = StoreRow(r);
-                __m128 rhs = other.Store();
-
-                lhs = _mm_dp_ps(lhs, rhs, imm8);
-
-                float* staging = StagingBuffer();
-                _mm_store_ps(staging, lhs);
-
-                ret.At(r) = staging[0];
+                ret = ret + Vec4f(rows[3]) * vec.Splat<3>();
             }
-            return ret;
+
+            return VectorType::FromVec4f(ret);
         }
 
         MatrixType operator* (const MatrixType& other) const
         {
             MatrixType ret;
+            float* m = reinterpret_cast<float*>(&ret);
 
+            // row r of the result is the sum of the rows of @other weighted by row r of this matrix
             for (uint32 r = 0; r < Row; r++)
             {
-                for (uint32 c = 0; c < Column; c++)
+                Vec4f lhs = StoreRow(r);
+                Vec4f sum = lhs.Splat<0>() * other.StoreRow(0) + lhs.Splat<1>() * other.StoreRow(1) + lhs.Splat<2>() * other.StoreRow(2);
+                if constexpr (Row == 4)
                 {
-                    __m128 lhs = StoreRow(r);
-                    __m128 rhs = other.StoreColumn(c);
-
-                    lhs = _mm_dp_ps(lhs, rhs, imm8);
-
-                    float* staging = StagingBuffer();
-                    _mm_store_ps(staging, lhs);
-
-                    ret.At(r, c) = staging[0];
+                    sum = sum + lhs.Splat<3>() * other.StoreRow(3);
+                    _mm_store_ps(m + r * Row, sum.m);
+                }
+                else
+                {
+                    sum.Store3(m + r * Row);
                 }
             }
 
@@ -568,45 +647,16 @@ namespace MRenderer
         __m128 StoreRow(uint32 row) const
         {
             ASSERT(row >= 0 && row < Row);
-            const float* m = reinterpret_cast<const float*>(this);
+            const float* row_base = reinterpret_cast<const float*>(this) + row * Row;
 
             if constexpr (Row != 4)
             {
-                float* staging = StagingBuffer();
-                memcpy(staging, m + row * Row, RowSize);
-
-                return _mm_load_ps(staging);
+                return Vec4f::Load3(row_base).m;
             }
             else 
             {
-                const float* row_base = m + row * Row;
                 return _mm_load_ps(row_base);
             }
-
-        }
-
-        __m128 StoreColumn(uint32 column) const
-        {
-            ASSERT(column >= 0 && column < Column);
-            const float* m = reinterpret_cast<const float*>(this);
-
-            float* staging = StagingBuffer();
-            for (uint32 i = 0; i < Row; i++)
-            {
-                staging[i] = *(m + i * Row + column);
-            }
-
-            return _mm_load_ps(staging);
-        }
-
-        float* StagingBuffer() const
-        {
-            // 16 bytes aligned staging buffer for load/store __m128
-            static thread_local struct alignas(alignof(__m128)) {
-                float m[4];
-            } staging;
-
-            return staging.m;
         }
     };
 
@@ -794,10 +844,11 @@ namespace MRenderer
             Vector3 scale = GetScale();
             scale = { 1.0f / scale.x, 1.0f / scale.y, 1.0f / scale.z };
 
+            // M^-1 = S^-1 * R^T, row i of R^T is scaled by 1 / scale[i]
             Matrix3x3 inv_m = {
-                rotation.At(0, 0) * scale.x, rotation.At(0, 1) * scale.y, rotation.At(0, 2) * scale.z,
-                rotation.At(1, 0) * scale.x, rotation.At(1, 1) * scale.y, rotation.At(1, 2) * scale.z,
-                rotation.At(2, 0) * scale.x, rotation.At(2, 1) * scale.y, rotation.At(2, 2) * scale.z
+                rotation.At(0, 0) * scale.x, rotation.At(0, 1) * scale.x, rotation.At(0, 2) * scale.x,
+                rotation.At(1, 0) * scale.y, rotation.At(1, 1) * scale.y, rotation.At(1, 2) * scale.y,
+                rotation.At(2, 0) * scale.z, rotation.At(2, 1) * scale.z, rotation.At(2, 2) * scale.z
             };
 
             Vector3 inv_translation = inv_m * Vector3(m[3], m[7], m[11]);
@@ -1013,6 +1064,53 @@ namespace MRenderer
 
     AABB operator* (const Matrix4x4& mat, const AABB& aabb);
 
+    // structure of arrays layout of AABB, so that a group of AABBs can be tested with SIMD at once
+    // each array is padded with @Stride extra elements, so it's always safe to load @Stride elements from a valid index
+    struct AABBSoA
+    {
+        static constexpr uint32 Stride = 8;
+
+        void Resize(uint32 size)
+        {
+            mSize = size;
+            MinX.assign(size + Stride, 0);
+            MinY.assign(size + Stride, 0);
+            MinZ.assign(size + Stride, 0);
+            MaxX.assign(size + Stride, 0);
+            MaxY.assign(size + Stride, 0);
+            MaxZ.assign(size + Stride, 0);
+        }
+
+        inline uint32 Size() const { return mSize; }
+
+        inline void Set(uint32 index, const AABB& bound)
+        {
+            ASSERT(index < mSize);
+            MinX[index] = bound.Min.x;
+            MinY[index] = bound.Min.y;
+            MinZ[index] = bound.Min.z;
+            MaxX[index] = bound.Max.x;
+            MaxY[index] = bound.Max.y;
+            MaxZ[index] = bound.Max.z;
+        }
+
+        inline AABB Get(uint32 index) const
+        {
+            ASSERT(index < mSize);
+            return AABB({ MinX[index], MinY[index], MinZ[index] }, { MaxX[index], MaxY[index], MaxZ[index] });
+        }
+
+        std::vector<float> MinX;
+        std::vector<float> MinY;
+        std::vector<float> MinZ;
+        std::vector<float> MaxX;
+        std::vector<float> MaxY;
+        std::vector<float> MaxZ;
+
+    protected:
+        uint32 mSize = 0;
+    };
+
     struct FrustumVolume
     {
         // plane function dot(N, P) + D = 0, when P satisfy all plane function evaluates above 0, it's inside the Frustum
@@ -1056,34 +1154,46 @@ namespace MRenderer
 
         bool Contains(const AABB& bound) const 
         {
-            Vector3 center = bound.Center(); 
-            Vector3 extent = bound.Size() * 0.5f;
-            for (uint32 i = 0; i < 6; i++)
+            Vec4f min = bound.Min.ToVec4f();
+            Vec4f max = bound.Max.ToVec4f();
+            Vec4f center = (min + max) * 0.5f;
+            Vec4f extent = (max - min) * 0.5f;
+
+            // ref: https://gdbooks.gitbooks.io/3dcollisions/content/Chapter2/static_aabb_plane.html
+            // there are eight possible diagnoal vector, we choose the one thas has the largest projection distance.
+            // AABB are above the plane if the half-length of its diagnoal projected onto the plane's normal is greater than the distance from center to the plane
+            // @center_distance > @half_diagnoal_projection => AABB above the plane
+            // @center_distance < -@half_diagnoal_projection => AABB below the plane, i.e it's outside of the frustum
+            // @center_distance >= -@half_diagnoal_projection & @center_distance <= @half_diagnoal_projection => AABB intersect with the plane
+            // the planes are transposed, so that lane i holds plane i (and plane 4 + i), 4 planes are tested at a time
+            auto below = [&](const Vector4* planes)
             {
-                const Vector4 plane = Planes[i];
-
-                // ref: https://gdbooks.gitbooks.io/3dcollisions/content/Chapter2/static_aabb_plane.html
-                // there are eight possible diagnoal vector, we choose the one thas has the largest projection distance
-                float half_diagnoal_projection = abs(plane.x * extent.x) + abs(plane.y * extent.y) + abs(plane.z * extent.z);
-                float center_distance = plane.Dot(Vector4(center, 1));
-
-                // AABB are above the plane if the half-length of its diagnoal projected onto the plane's normal is greater than the distance from center to the plane
-                // @center_distance > @half_diagnoal_projection => AABB above the plane
-                // @center_distance < -@half_diagnoal_projection => AABB below the plane, i.e it's outside of the frustum
-                // @center_distance >= -@half_diagnoal_projection & @center_distance <= @half_diagnoal_projection => AABB intersect with the plane
-                if (center_distance < -half_diagnoal_projection) 
-                {
-                    return false;
-                }
-            }
-            return true;
+                __m128 x = planes[0].Store(), y = planes[1].Store(), z = planes[2].Store(), w = planes[3].Store();
+                _MM_TRANSPOSE4_PS(x, y, z, w);
+
+                Vec4f center_distance = Vec4f(x) * center.Splat<0>() + Vec4f(y) * center.Splat<1>() + Vec4f(z) * center.Splat<2>() + w;
+                Vec4f half_diagnoal_projection = Vec4f(x).Abs() * extent.Splat<0>() + Vec4f(y).Abs() * extent.Splat<1>() + Vec4f(z).Abs() * extent.Splat<2>();
+                return Vec4f::LessMask(center_distance, -half_diagnoal_projection);
+            };
+
+            // the last group tests the near and far planes twice
+            const Vector4 last_planes[4] = { Planes[4], Planes[5], Planes[4], Planes[5] };
+            return (below(Planes) | below(last_planes)) == 0;
         }
+
+        // AVX version of @Contains(const AABB&), test the 8 AABBs in @bounds starting from @begin
+        // bit i of the return value is set if the (@begin + i)th AABB is not outside of the frustum,
+        // bit i of @inside_mask is set if it's completely inside the frustum. caller should mask off the bits beyond the size of @bounds
+        uint32 Contains8(const AABBSoA& bounds, uint32 begin, uint32& inside_mask) const;
     };
 
     struct FrustumCullStatus
     {
         uint32 NumDrawCall;
         uint32 NumCulled;
+        uint32 NumOccluded;
+        uint32 NumMeshletCulled;
+        uint32 NumLodDrawCall;
     };
 
     template<uint32 N>
@@ -1122,4 +1232,23 @@ namespace MRenderer
 
     // calculate the direction of a cubemap point which is represented by @index(slice index), @u, @v (uv coordinate)
     Vector3 CalcCubeMapDirection(uint32 index, float u, float v);
+
+    // ieee 754 binary16, rounded to nearest even. overflow results in infinity
+    uint16 FloatToHalf(float value);
+    float HalfToFloat(uint16 value);
+
+    // batch kernels, process 2 matrices or 8 points per iteration with AVX. @output can be the same array as @input
+
+    // general 4x4 inverse by the 2x2 block matrix method, a singular matrix results in identity like @Matrix4x4::Inverse
+    // ref: https://lxjk.github.io/2017/09/03/Fast-4x4-Matrix-Inverse-with-SSE-SIMD-Explained.html
+    void InverseMatrixBatch(const Matrix4x4* input, Matrix4x4* output, uint32 count);
+
+    // only valid for the combination of rotation, scale and translation matrix, same as @Matrix4x4::QuickInverse
+    void InverseTRSMatrixBatch(const Matrix4x4* input, Matrix4x4* output, uint32 count);
+
+    // @matrix * (p, 1) for each point p, the last row of @matrix is ignored
+    void TransformPointBatch(const Matrix4x4& matrix, const Vector3* input, Vector3* output, uint32 count);
+
+    // @matrix * v for each vector v
+    void TransformVectorBatch(const Matrix4x4& matrix, const Vector4* input, Vector4* output, uint32 count);
 }
@@ -0,0 +1,43 @@
+#pragma once
+#include <span>
+#include <vector>
+
+#include "Utils/MathLib.h"
+#include "Resource/BasicStorage.h"
+
+namespace MRenderer
+{
+    struct MeshletCullStatus
+    {
+        uint32 NumMeshlets = 0;
+        uint32 NumFrustumCulled = 0;
+        uint32 NumBackfaceCulled = 0;
+        uint32 NumRanges = 0;     // index ranges left to draw
+        uint32 NumIndices = 0;    // indices of the visible meshlets
+    };
+
+    // CPU culling of the meshlets of a mesh instance against the view frustum and their normal cones.
+    // the tests happen in the object space of the mesh, the visible meshlets are emitted as ranges of the index buffer
+    class MeshletCulling
+    {
+    public:
+        // @frustum and @camera_position in the object space of the mesh
+        MeshletCulling(const FrustumVolume& frustum, const Vector3& camera_position)
+            :mFrustum(frustum), mCameraPosition(camera_position)
+        {
+        }
+
+        // the normal cone test is only conservative if @world scales uniformly
+        static MeshletCulling FromWorld(const Matrix4x4& view_projection, const Vector3& camera_position, const Matrix4x4& world, const Matrix4x4& inv_world);
+
+        bool IsVisible(const MeshletData& meshlet, MeshletCullStatus& status) const;
+
+        // append the index ranges of the visible meshlets of @sub_mesh to @out_ranges, @meshlets are all the meshlets of the mesh.
+        // consecutive visible meshlets are merged into a single range, so a fully visible sub mesh is still a single draw call
+        void Cull(std::span<const MeshletData> meshlets, const SubMeshData& sub_mesh, std::vector<SubMeshData>& out_ranges, MeshletCullStatus& status) const;
+
+    protected:
+        FrustumVolume mFrustum;
+        Vector3 mCameraPosition;
+    };
+}
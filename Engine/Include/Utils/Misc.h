@@ -10,9 +10,12 @@
 #include <filesystem>
 #include <cerrno>
 #include <fstream>
+#include <memory>
 
 namespace MRenderer 
 {
+    class MappedFile;
+
     struct UUID
     {
         static constexpr uint64 BitMask = 0b000000001000010000100001000000000000; // mask off the "-" character
@@ -66,6 +69,15 @@ namespace MRenderer
 
         inline void Reset() 
         {
+            // an attached buffer is dropped, the next write allocates an owned one
+            if (mAttached)
+            {
+                mBuffer = nullptr;
+                mCapacity = 0;
+                mAttached = false;
+                mSource.reset();
+            }
+
             mBegin = mEnd = 0;
             mFull = false;
         }
@@ -73,6 +85,11 @@ namespace MRenderer
         inline uint32 Capacity() const { return mCapacity;}
         inline const uint8* Data() const { return mBuffer; }
 
+        // read the @size bytes at @data in place instead of copying them, the buffer is full and can't be written until it's reset.
+        // @source is the mapping @data lives in if any, the deserializers hold it to hand out views instead of copies
+        void Attach(const uint8* data, uint32 size, std::shared_ptr<MappedFile> source = nullptr);
+        inline const std::shared_ptr<MappedFile>& Source() const { return mSource; }
+
         const uint8* Peek(uint32 size);
         const uint8* Read(uint32 size);
         void Write(const uint8* data, uint32 size);
@@ -92,6 +109,10 @@ namespace MRenderer
         uint32 mBegin = 0;
         uint32 mEnd = 0;
         bool mFull = true;
+
+        // @mBuffer isn't owned when attached
+        bool mAttached = false;
+        std::shared_ptr<MappedFile> mSource;
     };
 
     std::string ToString(const std::wstring_view& str);
@@ -0,0 +1,69 @@
+#pragma once
+#include <vector>
+
+#include "Utils/MathLib.h"
+
+namespace MRenderer
+{
+    // position-only copy of a mesh, rasterized by @OcclusionBuffer
+    struct OccluderMesh
+    {
+        // gather the positions from an interleaved vertex stream, position must be the first element of the vertex
+        static OccluderMesh FromVertices(const void* vertices, uint32 num_vertices, uint32 stride, const uint32* indices, uint32 num_indices);
+
+        // 12 triangles of @bound
+        static OccluderMesh FromBound(const AABB& bound);
+
+        inline bool Empty() const { return Indices.empty(); }
+
+        // x, y, z of each vertex
+        std::vector<float> Positions;
+        std::vector<uint32> Indices;
+    };
+
+    // low resolution software depth buffer for CPU occlusion culling.
+    // occluders are rasterized with AVX edge functions, then a max depth mip chain is built on top of it,
+    // an AABB is occluded if its nearest depth is behind the farthest occluder depth in the texels it covers.
+    // it assumes the ndc.z -> [0, 1] convention of @ProjectionMatrix1.
+    // ref: https://www.intel.com/content/www/us/en/developer/articles/technical/masked-software-occlusion-culling.html
+    // ref: https://fgiesen.wordpress.com/2013/02/10/optimizing-the-basic-rasterizer/
+    class OcclusionBuffer
+    {
+    public:
+        static constexpr uint32 Width = 256;
+        static constexpr uint32 Height = 128;
+        static constexpr uint32 NumMips = 8;
+
+        OcclusionBuffer();
+
+        // reset the depth to the far plane and set the view projection matrix used by the following calls
+        void Clear(const Matrix4x4& view_projection);
+
+        // rasterize @mesh transformed by @world, triangles are clipped against the near plane, both faces are drawn
+        void RasterizeOccluder(const OccluderMesh& mesh, const Matrix4x4& world);
+
+        // build the max depth mip chain, must be called after all occluders are rasterized and before @IsOccluded
+        void BuildHierarchy();
+
+        // test a world space bound against the hierarchy, bounds crossing the near plane are never occluded
+        bool IsOccluded(const AABB& bound) const;
+
+        inline float GetDepth(uint32 x, uint32 y, uint32 mip = 0) const
+        {
+            ASSERT(mip < NumMips && x < MipWidth(mip) && y < MipHeight(mip));
+            return mMips[mip][y * MipWidth(mip) + x];
+        }
+
+        static constexpr uint32 MipWidth(uint32 mip) { return Width >> mip; }
+        static constexpr uint32 MipHeight(uint32 mip) { return Height >> mip; }
+
+    protected:
+        // @v is screen space position with z = ndc depth
+        void RasterizeTriangle(const float* v0, const float* v1, const float* v2);
+
+    protected:
+        Matrix4x4 mViewProjection;
+        std::vector<float> mMips[NumMips];
+        bool mHierarchyDirty;
+    };
+}
@@ -7,7 +7,8 @@ namespace MRenderer
 {
     BEGIN_REFLEFCT_ENUM(EVertexFormat)
         REFLECT_ENUM_VALUE(EVertexFormat_P3F_N3F_T3F_C3F_T2F),
-        REFLECT_ENUM_VALUE(EVertexFormat_P3F_N3F_T3F_C3F_T2F)
+        REFLECT_ENUM_VALUE(EVertexFormat_P3F_N3F_T3F_C3F_T2F),
+        REFLECT_ENUM_VALUE(EVertexFormat_P4U16_N2S16_T2S16_T2H)
     END_REFLECT_ENUM
 
     BEGIN_REFLEFCT_ENUM(ETextureFormat)
@@ -62,7 +63,10 @@ namespace MRenderer
         REFLECT_FIELD(mBound, true),
         REFLECT_FIELD(mVertices, true),
         REFLECT_FIELD(mIndicies, true),
-        REFLECT_FIELD(mSubMeshes, true)
+        REFLECT_FIELD(mSubMeshes, true),
+        REFLECT_FIELD(mMeshlets, true),
+        REFLECT_FIELD(mLods, true),
+        REFLECT_FIELD(mIndexFormat, true)
     END_REFLECT_CLASS
 
     BEGIN_REFLECT_CLASS(TextureInfo, void)
@@ -83,6 +87,12 @@ namespace MRenderer
         REFLECT_FIELD(mSHCoefficients, true)
     END_REFLECT_CLASS
 
+    BEGIN_REFLECT_CLASS(IBLTextureData, void)
+        REFLECT_FIELD(mPrefilteredMap, true),
+        REFLECT_FIELD(mBRDFLutInfo, true),
+        REFLECT_FIELD(mBRDFLut, true)
+    END_REFLECT_CLASS
+
     BEGIN_REFLECT_CLASS(IResource, void)
         REFLECT_FIELD(mRepoPath, false)
     END_REFLECT_CLASS
@@ -102,7 +112,9 @@ namespace MRenderer
     BEGIN_REFLECT_CLASS(CubeMapResource, IResource)
         REFLECT_FIELD(mTexturePath, true),
         REFLECT_FIELD(mSHCoefficients, false),
-        REFLECT_FIELD(mDeviceTexture2DArray, false)
+        REFLECT_FIELD(mDeviceTexture2DArray, false),
+        REFLECT_FIELD(mDevicePrefilteredMap, false),
+        REFLECT_FIELD(mDeviceBRDFLut, false)
     END_REFLECT_CLASS
 
     BEGIN_REFLECT_CLASS(MaterialResource, IResource)
@@ -125,7 +137,7 @@ namespace MRenderer
         REFLECT_FIELD(mTranslation, true),
         REFLECT_FIELD(mRotation, true),
         REFLECT_FIELD(mScale, true),
-        REFLECT_FIELD(mModelMatrix, false),
+        REFLECT_FIELD(mTransform, false),
         REFLECT_FIELD(mConstantBuffer, false)
     END_REFLECT_CLASS
 
@@ -136,7 +148,8 @@ namespace MRenderer
     END_REFLECT_CLASS
 
     BEGIN_REFLECT_CLASS(SceneModel, SceneObject)
-        REFLECT_FIELD(mModelFilePath, true)
+        REFLECT_FIELD(mModelFilePath, true),
+        REFLECT_FIELD(mOccluder, true)
     END_REFLECT_CLASS
 
     BEGIN_REFLECT_CLASS(Scene, IResource)
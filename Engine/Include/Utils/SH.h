@@ -2,7 +2,6 @@
 #include "Fundation.h"
 #include "MathLib.h"
 #include <array>
-#include <random>
 
 namespace MRenderer 
 {
@@ -37,7 +36,7 @@ namespace MRenderer
     class SHBaker 
     {    
     public:
-        static constexpr uint32 SampleCount = 100000;
+        static constexpr uint32 RowsPerJob = 8;
 
         // SH basis function
         // warn: make sure dir is unit vector, this function won't do normalization for efficiency
@@ -49,10 +48,12 @@ namespace MRenderer
         // SH coefficients for cos(theta) function
         static float CosineSHCoefficients(int l);
 
-        // calculate 2 order SH coefficients from cubemap, which can be used for approximate environment irradiance
+        // calculate 2 order SH coefficients from cubemap, which can be used for approximate environment irradiance.
+        // every texel of the first mip is integrated with its exact solid angle, the same row of the 6 faces in a job, so the result is
+        // the same on every run. the faces are float or half rgba
         static void ProjectEnvironmentMap(const std::array<TextureData, 6>& cube_map, SH2Coefficients& out_sh_r, SH2Coefficients& out_sh_g, SH2Coefficients& out_sh_b);
 
-        // generate irradiance map from cube map
+        // generate irradiance map from cube map, float rgba faces whose rows are filled on the workers
         static std::array<TextureData, 6> GenerateIrradianceMap(const std::array<TextureData, 6>& cube_map, uint32 map_size, bool debug=false);
 
         // irradiance approximation is a polynomial. this function will merge the polynomial terms as much as possible.
@@ -6,6 +6,7 @@
 
 #include "Resource/json.hpp"
 #include "Misc.h"
+#include "Utils/MappedFile.h"
 #include "Utils/ReflectionDef.h"
 
 namespace MRenderer 
@@ -521,6 +522,19 @@ namespace MRenderer::JsonSerialization
 
 namespace MRenderer
 {
+    // the dumped binary files begin with this header, the files dumped before it have none and are read as version 0.
+    // version 1 aligns the payloads of @BinaryData, see @BinaryData::PayloadAlignment
+    // version 2 may block compress them, see @BinaryData::CompressedPayloadFlag
+    // version 3 may encode the textures in other block formats than BC1 and BC6H, see @TextureInfo::BlockFormatFlag
+    struct BinaryFileHeader
+    {
+        static constexpr uint32 Magic = 0x3142524D; // "MRB1"
+        static constexpr uint32 CurrentVersion = 3;
+
+        uint32 Tag = Magic;
+        uint32 Version = CurrentVersion;
+    };
+
     class BinarySerializer
     {
     public:
@@ -530,8 +544,22 @@ namespace MRenderer
             ASSERT(LoadFile(filepath));
         }
 
-        bool LoadFile(std::string_view filepath)
+        // the file is mapped and deserialized in place by default, the binary data are then views into the mapping instead of copies.
+        // otherwise it's read into the buffer
+        bool LoadFile(std::string_view filepath, bool memory_mapped = true)
         {
+            if (memory_mapped)
+            {
+                std::shared_ptr<MappedFile> file = MappedFile::Open(filepath);
+                if (!file)
+                {
+                    Log("Asset Corrupted ", filepath);
+                    return false;
+                }
+
+                return LoadMemory(file->Data(), file->Size(), file);
+            }
+
             std::optional<std::ifstream> file = ReadFile(filepath, true);
             ASSERT(file.has_value());
 
@@ -549,12 +577,34 @@ namespace MRenderer
             file.value().read(reinterpret_cast<char*>(buffer.data()), file_size);
 
             mBuffer.Write(buffer.data(), static_cast<uint32>(file_size));
-            return true;
+            return ReadHeader();
+        }
+
+        // deserialize the @size bytes at @data in place, they must outlive the deserialization. @source is the mapping they live in if any,
+        // the binary data are then views into it, see @LoadFile
+        bool LoadMemory(const uint8* data, uint32 size, std::shared_ptr<MappedFile> source = nullptr)
+        {
+            if (size == 0)
+            {
+                Log("Asset Corrupted");
+                return false;
+            }
+
+            mBuffer.Attach(data, size, std::move(source));
+            return ReadHeader();
         }
 
         template<typename T>
         void LoadObject(const T& obj)
         {
+            // the header goes first, the payload alignment is relative to the beginning of the file
+            if (mBuffer.Occupied() == 0)
+            {
+                BinaryFileHeader header;
+                mBuffer.Write(header.Tag);
+                mBuffer.Write(header.Version);
+            }
+
             BinarySerialization::Serialize(mBuffer, obj);
         }
 
@@ -590,7 +640,34 @@ namespace MRenderer
             return mBuffer.Data();
         }
 
+        // version of the loaded file
+        inline uint32 Version() const
+        {
+            return mVersion;
+        }
+
+    protected:
+        bool ReadHeader()
+        {
+            mVersion = 0;
+            if (mBuffer.Occupied() < sizeof(BinaryFileHeader) || *reinterpret_cast<const uint32*>(mBuffer.Peek(sizeof(uint32))) != BinaryFileHeader::Magic)
+            {
+                return true;
+            }
+
+            mBuffer.Read(sizeof(uint32));
+            mVersion = mBuffer.Read<uint32>();
+            if (mVersion > BinaryFileHeader::CurrentVersion)
+            {
+                Log("Asset Version ", mVersion, " Is Not Supported");
+                mBuffer.Reset();
+                return false;
+            }
+            return true;
+        }
+
     protected:
         RingBuffer mBuffer;
+        uint32 mVersion = 0;
     };
 }
\ No newline at end of file
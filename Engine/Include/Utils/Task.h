@@ -0,0 +1,605 @@
+#pragma once
+#include <atomic>
+#include <exception>
+#include <future>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Fundation.h"
+
+
+namespace MRenderer
+{
+    // per-thread free list of fixed size memory blocks for T
+    // 1. allocation and deallocation only touch the free list of current thread, so no synchronization is needed
+    // 2. objects are often freed on a different thread than the one allocates them(e.g. task states), so surplus
+    //    blocks are moved to a shared depot in batches, threads with an empty free list refill from there
+    // 3. the free list itself is trivially destructible, so it's still usable while other thread_local objects are being destructed
+    // ref: https://google.github.io/tcmalloc/design.html (the transfer cache)
+    template<typename T>
+    class ThreadLocalPool
+    {
+        static constexpr uint32 BatchSize = 32;
+
+        union Block
+        {
+            Block* Next;
+            alignas(T) std::byte Data[sizeof(T)];
+        };
+
+        struct FreeList
+        {
+            Block* Head;
+            uint32 Count;
+            bool Destructed;
+        };
+
+        // each entry is a linked list of blocks
+        struct Depot
+        {
+            std::mutex Mutex;
+            std::vector<Block*> Batches;
+        };
+
+        // give the cached blocks to the depot on thread exit
+        struct FreeListCleaner
+        {
+            ~FreeListCleaner()
+            {
+                if (tFreeList.Head)
+                {
+                    Depot& depot = GetDepot();
+                    std::lock_guard guard(depot.Mutex);
+                    depot.Batches.push_back(tFreeList.Head);
+                }
+                tFreeList = { nullptr, 0, true };
+            }
+        };
+
+    public:
+        template<typename... Args>
+        static T* New(Args&&... args)
+        {
+            if (!tFreeList.Head)
+            {
+                Refill();
+            }
+
+            Block* block = tFreeList.Head;
+            if (block)
+            {
+                tFreeList.Head = block->Next;
+                tFreeList.Count--;
+            }
+            else
+            {
+                block = new Block;
+            }
+
+            return new(block->Data) T(std::forward<Args>(args)...);
+        }
+
+        static void Delete(T* ptr)
+        {
+            ptr->~T();
+
+            Block* block = reinterpret_cast<Block*>(ptr);
+            if (tFreeList.Destructed)
+            {
+                delete block;
+                return;
+            }
+
+            // make sure the cleaner is constructed on this thread before the first block is cached
+            static_cast<void>(&tCleaner);
+
+            block->Next = tFreeList.Head;
+            tFreeList.Head = block;
+            tFreeList.Count++;
+
+            if (tFreeList.Count >= BatchSize * 2)
+            {
+                Flush();
+            }
+        }
+
+    protected:
+        // the depot is never destructed, threads may still return blocks to it during static destruction
+        static Depot& GetDepot()
+        {
+            static Depot* depot = new Depot;
+            return *depot;
+        }
+
+        // take a batch from the depot
+        static void Refill()
+        {
+            if (tFreeList.Destructed)
+            {
+                return;
+            }
+
+            Depot& depot = GetDepot();
+            std::lock_guard guard(depot.Mutex);
+            if (depot.Batches.empty())
+            {
+                return;
+            }
+
+            Block* head = depot.Batches.back();
+            depot.Batches.pop_back();
+
+            uint32 count = 0;
+            for (Block* block = head; block; block = block->Next)
+            {
+                count++;
+            }
+
+            static_cast<void>(&tCleaner);
+            tFreeList.Head = head;
+            tFreeList.Count = count;
+        }
+
+        // move a batch to the depot
+        static void Flush()
+        {
+            Block* head = tFreeList.Head;
+            Block* tail = head;
+            for (uint32 i = 1; i < BatchSize; i++)
+            {
+                tail = tail->Next;
+            }
+
+            tFreeList.Head = tail->Next;
+            tFreeList.Count -= BatchSize;
+            tail->Next = nullptr;
+
+            Depot& depot = GetDepot();
+            std::lock_guard guard(depot.Mutex);
+            depot.Batches.push_back(head);
+        }
+
+    protected:
+        inline static thread_local FreeList tFreeList = {};
+        inline static thread_local FreeListCleaner tCleaner;
+    };
+
+
+    // move-only type-erased void() callable
+    // callables no larger than @InlineSize are stored in place, the bigger ones fall back to heap allocation
+    class Task
+    {
+    public:
+        static constexpr uint32 InlineSize = 48;
+        static constexpr uint32 InlineAlignment = alignof(std::max_align_t);
+
+    protected:
+        struct VTable
+        {
+            void (*Invoke)(void* storage);
+            void (*Move)(void* dst, void* src);
+            void (*Destroy)(void* storage);
+        };
+
+        template<typename Fn>
+        static constexpr bool StoreInline = sizeof(Fn) <= InlineSize && alignof(Fn) <= InlineAlignment && std::is_nothrow_move_constructible_v<Fn>;
+
+        template<typename Fn>
+        static constexpr VTable InlineVTable =
+        {
+            [](void* storage) { (*static_cast<Fn*>(storage))(); },
+            [](void* dst, void* src) { new(dst) Fn(std::move(*static_cast<Fn*>(src))); static_cast<Fn*>(src)->~Fn(); },
+            [](void* storage) { static_cast<Fn*>(storage)->~Fn(); },
+        };
+
+        template<typename Fn>
+        static constexpr VTable HeapVTable =
+        {
+            [](void* storage) { (**static_cast<Fn**>(storage))(); },
+            [](void* dst, void* src) { *static_cast<Fn**>(dst) = *static_cast<Fn**>(src); },
+            [](void* storage) { delete *static_cast<Fn**>(storage); },
+        };
+
+    public:
+        Task() = default;
+
+        template<typename Fn>
+            requires (!std::is_same_v<std::decay_t<Fn>, Task> && std::is_invocable_v<std::decay_t<Fn>&>)
+        Task(Fn&& func)
+        {
+            using Callable = std::decay_t<Fn>;
+
+            if constexpr (StoreInline<Callable>)
+            {
+                new(mStorage) Callable(std::forward<Fn>(func));
+                mVTable = &InlineVTable<Callable>;
+            }
+            else
+            {
+                *reinterpret_cast<Callable**>(mStorage) = new Callable(std::forward<Fn>(func));
+                mVTable = &HeapVTable<Callable>;
+            }
+        }
+
+        Task(Task&& other) noexcept
+        {
+            *this = std::move(other);
+        }
+
+        Task& operator=(Task&& other) noexcept
+        {
+            if (this != &other)
+            {
+                Reset();
+                if (other.mVTable)
+                {
+                    other.mVTable->Move(mStorage, other.mStorage);
+                    mVTable = other.mVTable;
+                    other.mVTable = nullptr;
+                }
+            }
+            return *this;
+        }
+
+        Task(const Task&) = delete;
+        Task& operator=(const Task&) = delete;
+
+        ~Task()
+        {
+            Reset();
+        }
+
+        inline void operator()()
+        {
+            ASSERT(mVTable);
+            mVTable->Invoke(mStorage);
+        }
+
+        inline explicit operator bool() const { return mVTable != nullptr; }
+
+        inline void Reset()
+        {
+            if (mVTable)
+            {
+                mVTable->Destroy(mStorage);
+                mVTable = nullptr;
+            }
+        }
+
+    protected:
+        alignas(InlineAlignment) std::byte mStorage[InlineSize];
+        const VTable* mVTable = nullptr;
+    };
+
+    static_assert(sizeof(Task) == 64, "task is expected to fit in a cache line");
+
+
+    // shared state between TaskPromise and TaskFuture, allocated from ThreadLocalPool
+    // T can't be a reference, return a pointer or std::reference_wrapper instead
+    template<typename T>
+    class TaskState
+    {
+        static_assert(!std::is_reference_v<T>, "reference result is not supported");
+
+        enum Status : uint32
+        {
+            Status_Pending = 0,
+            Status_Waiting = 1,
+            Status_Ready = 2,
+        };
+
+        struct Empty {};
+        using ValueType = std::conditional_t<std::is_void_v<T>, Empty, T>;
+
+    public:
+        TaskState() = default;
+
+        static TaskState* Create()
+        {
+            return ThreadLocalPool<TaskState>::New();
+        }
+
+        inline void AddRef()
+        {
+            mRefCount.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        inline void Release()
+        {
+            if (mRefCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                ThreadLocalPool<TaskState>::Delete(this);
+            }
+        }
+
+        template<typename... Args>
+        void SetValue(Args&&... args)
+        {
+            mValue.emplace(std::forward<Args>(args)...);
+            Notify();
+        }
+
+        void SetException(std::exception_ptr exception)
+        {
+            mException = std::move(exception);
+            Notify();
+        }
+
+        inline bool IsReady() const
+        {
+            return mStatus.load(std::memory_order_acquire) == Status_Ready;
+        }
+
+        void Wait()
+        {
+            uint32 status = mStatus.load(std::memory_order_acquire);
+            if (status == Status_Ready)
+            {
+                return;
+            }
+
+            // tell the producer there is a waiter, so it knows to wake us up
+            if (status == Status_Pending)
+            {
+                mStatus.compare_exchange_strong(status, Status_Waiting, std::memory_order_acq_rel);
+            }
+
+            while ((status = mStatus.load(std::memory_order_acquire)) != Status_Ready)
+            {
+                mStatus.wait(status, std::memory_order_acquire);
+            }
+        }
+
+        T Get()
+        {
+            Wait();
+
+            if (mException)
+            {
+                std::rethrow_exception(mException);
+            }
+
+            if constexpr (!std::is_void_v<T>)
+            {
+                return std::move(*mValue);
+            }
+        }
+
+    protected:
+        void Notify()
+        {
+            // only pay for the wake up call when somebody is actually waiting
+            if (mStatus.exchange(Status_Ready, std::memory_order_acq_rel) == Status_Waiting)
+            {
+                mStatus.notify_all();
+            }
+        }
+
+    protected:
+        // one reference for the promise and one for the future
+        std::atomic<uint32> mRefCount = 2;
+        std::atomic<uint32> mStatus = Status_Pending;
+        std::optional<ValueType> mValue;
+        std::exception_ptr mException;
+    };
+
+
+    // std::future like handle of the result of a scheduled task, move-only
+    template<typename T>
+    class TaskFuture
+    {
+        template<typename U> friend class TaskPromise;
+
+    public:
+        TaskFuture() = default;
+
+        TaskFuture(TaskFuture&& other) noexcept
+            :mState(std::exchange(other.mState, nullptr))
+        {
+        }
+
+        TaskFuture& operator=(TaskFuture&& other) noexcept
+        {
+            if (this != &other)
+            {
+                Reset();
+                mState = std::exchange(other.mState, nullptr);
+            }
+            return *this;
+        }
+
+        TaskFuture(const TaskFuture&) = delete;
+        TaskFuture& operator=(const TaskFuture&) = delete;
+
+        ~TaskFuture()
+        {
+            Reset();
+        }
+
+        inline bool valid() const { return mState != nullptr; }
+        inline bool IsReady() const { ASSERT(mState); return mState->IsReady(); }
+
+        inline void wait() const
+        {
+            ASSERT(mState);
+            mState->Wait();
+        }
+
+        // block until the task is done and take its result, the future becomes invalid afterward
+        T get()
+        {
+            ASSERT(mState);
+
+            struct ReleaseGuard
+            {
+                TaskFuture* Owner;
+                ~ReleaseGuard() { Owner->Reset(); }
+            } guard{ this };
+
+            return mState->Get();
+        }
+
+    protected:
+        explicit TaskFuture(TaskState<T>* state)
+            :mState(state)
+        {
+        }
+
+        inline void Reset()
+        {
+            if (mState)
+            {
+                mState->Release();
+                mState = nullptr;
+            }
+        }
+
+    protected:
+        TaskState<T>* mState = nullptr;
+    };
+
+
+    // the producer side of TaskFuture, the future receives std::future_errc::broken_promise if the promise is destroyed unfulfilled
+    template<typename T>
+    class TaskPromise
+    {
+    public:
+        TaskPromise()
+            :mState(TaskState<T>::Create())
+        {
+        }
+
+        TaskPromise(TaskPromise&& other) noexcept
+            :mState(std::exchange(other.mState, nullptr)), mFutureRetrieved(other.mFutureRetrieved)
+        {
+        }
+
+        TaskPromise& operator=(TaskPromise&&) = delete;
+        TaskPromise(const TaskPromise&) = delete;
+        TaskPromise& operator=(const TaskPromise&) = delete;
+
+        ~TaskPromise()
+        {
+            if (!mState)
+            {
+                return;
+            }
+
+            if (!mState->IsReady())
+            {
+                mState->SetException(std::make_exception_ptr(std::future_error(std::future_errc::broken_promise)));
+            }
+
+            mState->Release();
+
+            // nobody took the future, drop its reference as well
+            if (!mFutureRetrieved)
+            {
+                mState->Release();
+            }
+        }
+
+        TaskFuture<T> GetFuture()
+        {
+            ASSERT(mState && !mFutureRetrieved);
+            mFutureRetrieved = true;
+            return TaskFuture<T>(mState);
+        }
+
+        // call @func with @args and store the result or the exception it throws
+        template<typename Fn, typename... Args>
+        void Invoke(Fn& func, Args&... args)
+        {
+            ASSERT(mState);
+            try
+            {
+                if constexpr (std::is_void_v<T>)
+                {
+                    std::invoke(func, args...);
+                    mState->SetValue();
+                }
+                else
+                {
+                    mState->SetValue(std::invoke(func, args...));
+                }
+            }
+            catch (...)
+            {
+                mState->SetException(std::current_exception());
+            }
+        }
+
+    protected:
+        TaskState<T>* mState;
+        bool mFutureRetrieved = false;
+    };
+
+
+    // FIFO of tasks on a growable ring buffer, no allocation once the capacity is reached
+    class TaskRingQueue
+    {
+        static constexpr uint32 InitialCapacity = 64;
+
+    public:
+        TaskRingQueue() = default;
+        TaskRingQueue(const TaskRingQueue&) = delete;
+        TaskRingQueue& operator=(const TaskRingQueue&) = delete;
+
+        inline bool Empty() const { return mSize == 0; }
+        inline uint32 Size() const { return mSize; }
+
+        void Push(Task&& task)
+        {
+            if (mSize == mTasks.size())
+            {
+                Grow();
+            }
+
+            uint32 tail = (mHead + mSize) & (static_cast<uint32>(mTasks.size()) - 1);
+            mTasks[tail] = std::move(task);
+            mSize++;
+        }
+
+        Task Pop()
+        {
+            ASSERT(mSize > 0);
+            Task task = std::move(mTasks[mHead]);
+            mHead = (mHead + 1) & (static_cast<uint32>(mTasks.size()) - 1);
+            mSize--;
+            return task;
+        }
+
+        void Clear()
+        {
+            while (!Empty())
+            {
+                Pop();
+            }
+        }
+
+    protected:
+        void Grow()
+        {
+            // capacity stays power of two, so that wrapping around is a mask
+            uint32 capacity = mTasks.empty() ? InitialCapacity : static_cast<uint32>(mTasks.size()) * 2;
+            std::vector<Task> tasks(capacity);
+
+            for (uint32 i = 0; i < mSize; i++)
+            {
+                tasks[i] = std::move(mTasks[(mHead + i) & (static_cast<uint32>(mTasks.size()) - 1)]);
+            }
+
+            mTasks.swap(tasks);
+            mHead = 0;
+        }
+
+    protected:
+        std::vector<Task> mTasks;
+        uint32 mHead = 0;
+        uint32 mSize = 0;
+    };
+}
@@ -5,8 +5,12 @@
 #include <functional>
 #include <queue>
 #include <future>
+#include <atomic>
+#include <array>
+#include <span>
 
 #include "Fundation.h"
+#include "Utils/Task.h"
 
 
 namespace MRenderer
@@ -14,9 +18,6 @@ namespace MRenderer
 
     class TaskQueue
     {
-    protected:
-        using Task = std::function<void()>;
-
     public:
         TaskQueue() {};
 
@@ -27,46 +28,55 @@ namespace MRenderer
         inline uint32 GetNumTaks()
         { 
             std::lock_guard<std::mutex> lock(mMutexTask);
-            return static_cast<uint32>(mTasks.size());
+            return mTasks.Size();
         };
 
         // schedule function for later execution, @args will be passed by value, use std::ref if you want to pass by reference
         template<typename Fn, typename... Args>
         auto Schedule(Fn func, Args&&... args)
         {
-            ASSERT(!mClosed);
-
-            using RetureType = std::invoke_result_t<Fn, Args...>;
-            using Task = std::packaged_task<RetureType(Args...)>;
-
-            auto ptr = std::make_shared<Task>(func); // packaged_task needs to be alive and unmoved untill the task is done
+            using ReturnType = std::invoke_result_t<Fn&, std::decay_t<Args>&...>;
 
-            while (!mMutexTask.try_lock())
-                std::this_thread::yield();// spin lock, for avoid blocking the caller thread
+            // the promise lives inside the task, the shared state comes from a per-thread pool
+            TaskPromise<ReturnType> promise;
+            TaskFuture<ReturnType> future = promise.GetFuture();
 
-            // we use std::function<void()> to store all the different tasks,
-            // so the packaged_task needs to be wrapped in lambda to fit into the std::function<void()> variable
-            mTasks.push(
-                [=]() mutable
+            Push(
+                [promise = std::move(promise), func = std::move(func), ...args = std::forward<Args>(args)]() mutable
                 {
-                    (*ptr)(args...);
+                    promise.Invoke(func, args...);
                 }
             );
 
-            mMutexTask.unlock();
-
-            // notify a worker to execute task
-            mEventNewTask.notify_one();
+            return future;
+        }
 
-            return ptr->get_future();
+        // fire-and-forget version of @Schedule, no future and no shared state
+        template<typename Fn, typename... Args>
+        void Dispatch(Fn func, Args&&... args)
+        {
+            if constexpr (sizeof...(Args) == 0)
+            {
+                Push(Task(std::move(func)));
+            }
+            else
+            {
+                Push(
+                    [func = std::move(func), ...args = std::forward<Args>(args)]() mutable
+                    {
+                        std::invoke(func, args...);
+                    }
+                );
+            }
         }
     
     protected:
         static void TaskWorker(TaskQueue* owner);
+        void Push(Task&& task);
     
     protected:
         bool mClosed = false;
-        std::queue<Task> mTasks;
+        TaskRingQueue mTasks;
         std::mutex mMutexTask;
         std::condition_variable mEventNewTask;
     };
@@ -101,6 +111,267 @@ namespace MRenderer
         std::thread mThread;
     };
 
+    // Chase-Lev work stealing deque
+    // the owner thread pushes and pops at the bottom end, other threads steal from the top end.
+    // ref: https://www.dre.vanderbilt.edu/~schmidt/PDF/work-stealing-dequeue.pdf
+    // ref: https://fzn.fr/readings/ppopp13.pdf (memory orders for weak memory models)
+    template<typename T, uint32 Capacity>
+        requires (std::is_pointer_v<T> && (Capacity & (Capacity - 1)) == 0)
+    class WorkStealingQueue
+    {
+        static constexpr int64 Mask = Capacity - 1;
+
+    public:
+        WorkStealingQueue() = default;
+
+        WorkStealingQueue(const WorkStealingQueue&) = delete;
+        WorkStealingQueue& operator=(const WorkStealingQueue&) = delete;
+
+        // owner thread only, return false if the queue is full
+        bool Push(T item)
+        {
+            int64 bottom = mBottom.load(std::memory_order_relaxed);
+            int64 top = mTop.load(std::memory_order_acquire);
+
+            if (bottom - top >= static_cast<int64>(Capacity))
+            {
+                return false;
+            }
+
+            mBuffer[bottom & Mask].store(item, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            mBottom.store(bottom + 1, std::memory_order_relaxed);
+            return true;
+        }
+
+        // owner thread only
+        T Pop()
+        {
+            int64 bottom = mBottom.load(std::memory_order_relaxed) - 1;
+            mBottom.store(bottom, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64 top = mTop.load(std::memory_order_relaxed);
+
+            if (top > bottom)
+            {
+                // queue is empty, restore the bottom
+                mBottom.store(bottom + 1, std::memory_order_relaxed);
+                return nullptr;
+            }
+
+            T item = mBuffer[bottom & Mask].load(std::memory_order_relaxed);
+            if (top == bottom)
+            {
+                // the last item, compete with the thieves
+                if (!mTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                {
+                    item = nullptr;
+                }
+                mBottom.store(bottom + 1, std::memory_order_relaxed);
+            }
+            return item;
+        }
+
+        // any thread
+        T Steal()
+        {
+            int64 top = mTop.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64 bottom = mBottom.load(std::memory_order_acquire);
+
+            if (top >= bottom)
+            {
+                return nullptr;
+            }
+
+            T item = mBuffer[top & Mask].load(std::memory_order_relaxed);
+            if (!mTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            {
+                // lost the race to another thief or the owner
+                return nullptr;
+            }
+            return item;
+        }
+
+        inline uint32 Size() const
+        {
+            int64 size = mBottom.load(std::memory_order_relaxed) - mTop.load(std::memory_order_relaxed);
+            return static_cast<uint32>(std::max<int64>(size, 0));
+        }
+
+    protected:
+        // top and bottom are written by different threads, keep them in different cache lines
+        alignas(64) std::atomic<int64> mTop = 0;
+        alignas(64) std::atomic<int64> mBottom = 0;
+        alignas(64) std::array<std::atomic<T>, Capacity> mBuffer;
+    };
+
+    class JobSystem;
+    struct Job;
+
+    // counts the unfinished jobs of a submission, jobs depend on it will be submitted once it reaches zero
+    class JobCounter
+    {
+        friend class JobSystem;
+    public:
+        JobCounter(uint32 num_jobs)
+            :mPending(num_jobs)
+        {
+        }
+
+        inline bool IsComplete() const { return mPending.load(std::memory_order_acquire) == 0; }
+
+    protected:
+        std::atomic<uint32> mPending;
+        std::mutex mMutexContinuation;
+        std::vector<Job*> mContinuations;
+    };
+
+    // a reference to a group of scheduled jobs, empty handle is treated as completed
+    class JobHandle
+    {
+        friend class JobSystem;
+    public:
+        JobHandle() = default;
+
+        inline bool IsComplete() const { return !mCounter || mCounter->IsComplete(); }
+        inline bool Empty() const { return mCounter == nullptr; }
+
+    protected:
+        JobHandle(std::shared_ptr<JobCounter> counter)
+            :mCounter(std::move(counter))
+        {
+        }
+
+    protected:
+        std::shared_ptr<JobCounter> mCounter;
+    };
+
+    struct Job
+    {
+        Job(Task func, std::shared_ptr<JobCounter> counter, uint32 dependencies)
+            :Func(std::move(func)), Counter(std::move(counter)), Dependencies(dependencies)
+        {
+        }
+
+        Task Func;
+        std::shared_ptr<JobCounter> Counter; // null for dispatched jobs that nobody waits on
+
+        // number of unfinished dependencies, plus one for the submission itself
+        std::atomic<uint32> Dependencies;
+    };
+
+    // work stealing job system
+    // 1. each worker owns a lock-free deque, jobs scheduled on a worker are pushed into its own deque
+    // 2. jobs scheduled from other threads go to a shared injection queue
+    // 3. idle worker steals jobs from a random victim, and sleeps if there is nothing to do
+    // 4. waiting on a JobHandle executes other jobs instead of blocking the thread
+    class JobSystem
+    {
+        static constexpr uint32 QueueCapacity = 4096;
+        static constexpr uint32 SpinCountBeforeSleep = 64;
+
+        using JobQueue = WorkStealingQueue<Job*, QueueCapacity>;
+        using JobPool = ThreadLocalPool<Job>;
+
+    public:
+        JobSystem(uint32 num_workers);
+        ~JobSystem();
+
+        JobSystem(const JobSystem&) = delete;
+        JobSystem& operator=(const JobSystem&) = delete;
+
+        inline uint32 NumWorkers() const { return static_cast<uint32>(mWorkers.size()); }
+
+        // schedule @func, it won't be executed until all the @dependencies are completed
+        JobHandle Schedule(Task func, std::span<const JobHandle> dependencies = {});
+
+        inline JobHandle Schedule(Task func, const JobHandle& dependency)
+        {
+            return Schedule(std::move(func), std::span<const JobHandle>(&dependency, 1));
+        }
+
+        // fire-and-forget, no counter is created so there is nothing to wait on
+        void Dispatch(Task func);
+
+        // split [0, @count) into batches of @batch_size and call @func(begin, end) for each batch in parallel
+        template<typename Fn>
+        JobHandle ParallelFor(uint32 count, uint32 batch_size, Fn func, const JobHandle& dependency = {})
+        {
+            ASSERT(batch_size > 0);
+
+            uint32 num_batches = (count + batch_size - 1) / batch_size;
+            if (num_batches == 0)
+            {
+                return JobHandle();
+            }
+
+            auto counter = std::make_shared<JobCounter>(num_batches);
+            for (uint32 i = 0; i < num_batches; i++)
+            {
+                uint32 begin = i * batch_size;
+                uint32 end = std::min(begin + batch_size, count);
+
+                Job* job = JobPool::New(Task([=]() { func(begin, end); }), counter, 1);
+                AddDependency(job, dependency);
+                ReleaseDependency(job);
+            }
+
+            return JobHandle(std::move(counter));
+        }
+
+        // schedule @func and return its result through TaskFuture, @args will be passed by value
+        template<typename Fn, typename... Args>
+        auto ScheduleTask(Fn func, Args&&... args)
+        {
+            using ReturnType = std::invoke_result_t<Fn&, std::decay_t<Args>&...>;
+
+            TaskPromise<ReturnType> promise;
+            TaskFuture<ReturnType> future = promise.GetFuture();
+
+            Dispatch(
+                [promise = std::move(promise), func = std::move(func), ...args = std::forward<Args>(args)]() mutable
+                {
+                    promise.Invoke(func, args...);
+                }
+            );
+
+            return future;
+        }
+
+        // execute other jobs until @handle is completed
+        void Wait(const JobHandle& handle);
+
+        // index of the current thread in the job system, return NumWorkers() for threads not owned by this job system
+        uint32 ThreadIndex() const;
+
+    protected:
+        void WorkerMain(uint32 index);
+
+        void Submit(Job* job);
+        Job* FindJob();
+        void Execute(Job* job);
+
+        void AddDependency(Job* job, const JobHandle& dependency);
+        void ReleaseDependency(Job* job);
+
+    protected:
+        std::atomic<bool> mClosed = false;
+
+        std::vector<std::unique_ptr<JobQueue>> mQueues;
+        std::vector<std::thread> mWorkers;
+
+        // jobs scheduled from threads that not owned by this job system
+        std::queue<Job*> mInjectionQueue;
+        std::mutex mMutexInjection;
+
+        // for putting idle workers to sleep
+        std::atomic<uint32> mNumPendingJobs = 0;
+        std::atomic<uint32> mNumSleeping = 0;
+        std::mutex mMutexSleep;
+        std::condition_variable mEventNewJob;
+    };
+
     class TaskScheduler
     {
     protected:
@@ -117,33 +388,73 @@ namespace MRenderer
         }
 
         template<typename Fn, typename... Args>
-        std::future<std::invoke_result_t<Fn, Args...>> ExecuteOnMainThread(Fn&& func, Args&&... args)
+        auto ExecuteOnMainThread(Fn&& func, Args&&... args)
         {
             return mTickThread.Schedule(std::forward<Fn>(func), std::forward<Args>(args)...);
         }
 
         template<typename Fn, typename... Args>
-        std::future<std::invoke_result_t<Fn, Args...>> ExecuteOnRenderThread(Fn&& func, Args&&... args)
+        auto ExecuteOnRenderThread(Fn&& func, Args&&... args)
         {
             return mDeviceThread.Schedule(std::forward<Fn>(func), std::forward<Args>(args)...);
         }
 
         template<typename Fn, typename... Args>
-        std::future<std::invoke_result_t<Fn, Args...>> ExecuteOnDeviceThread(Fn&& func, Args&&... args)
+        auto ExecuteOnDeviceThread(Fn&& func, Args&&... args)
         {
             return mDeviceThread.Schedule(std::forward<Fn>(func), std::forward<Args>(args)...);
         }
 
         template<typename Fn, typename... Args>
-        std::future<std::invoke_result_t<Fn, Args...>> ExecuteOnWorker(Fn&& func, Args&&... args)
+        auto ExecuteOnWorker(Fn&& func, Args&&... args)
+        {
+            return mJobSystem.ScheduleTask(std::forward<Fn>(func), std::forward<Args>(args)...);
+        }
+
+        // for long-running or blocking tasks, they would stall a job worker and every thread that waits on it
+        template<typename Fn, typename... Args>
+        auto ExecuteOnBackgroundThread(Fn&& func, Args&&... args)
         {
-            return mWorkerThreads.Schedule(std::forward<Fn>(func), std::forward<Args>(args)...);
+            return mBackgroundThread.Schedule(std::forward<Fn>(func), std::forward<Args>(args)...);
         }
 
+        // fire-and-forget variants, cheaper since no future is created
+        template<typename Fn, typename... Args>
+        void DispatchOnMainThread(Fn&& func, Args&&... args)
+        {
+            mTickThread.Dispatch(std::forward<Fn>(func), std::forward<Args>(args)...);
+        }
+
+        template<typename Fn, typename... Args>
+        void DispatchOnDeviceThread(Fn&& func, Args&&... args)
+        {
+            mDeviceThread.Dispatch(std::forward<Fn>(func), std::forward<Args>(args)...);
+        }
+
+        template<typename Fn>
+        void DispatchOnWorker(Fn&& func)
+        {
+            mJobSystem.Dispatch(Task(std::forward<Fn>(func)));
+        }
+
+        template<typename Fn>
+        JobHandle ParallelFor(uint32 count, uint32 batch_size, Fn&& func, const JobHandle& dependency = {})
+        {
+            return mJobSystem.ParallelFor(count, batch_size, std::forward<Fn>(func), dependency);
+        }
+
+        inline void Wait(const JobHandle& handle) { mJobSystem.Wait(handle); }
+        inline JobSystem& GetJobSystem() { return mJobSystem; }
+
     private:
         TaskThread mTickThread;
         TaskThread mRenderThread;
         TaskThread mDeviceThread;
-        ThreadPool mWorkerThreads;
+        TaskThread mBackgroundThread;
+        JobSystem mJobSystem;
     };
+
+    // stable LSD radix sort of @items by their bits in [@bit_begin, @bit_end), 8 bits per pass
+    // each pass builds per-chunk histograms and scatters the chunks on the job system in parallel
+    void ParallelRadixSort(std::vector<uint64>& items, uint32 bit_begin = 0, uint32 bit_end = 64);
 }
\ No newline at end of file
@@ -0,0 +1,78 @@
+#pragma once
+#include <vector>
+
+#include "Utils/MathLib.h"
+
+namespace MRenderer
+{
+    using TransformHandle = uint32;
+
+    // structure of arrays storage of translation, rotation and scale of the scene objects.
+    // setters only write the components and mark the entry dirty, @Update recomputes the world and inverse world
+    // matrices of the dirty entries in batch, 8 entries at a time with AVX, and splits big batches to the job system.
+    // it's not thread safe, all the setters and @Update should be called from the same thread.
+    class TransformStore
+    {
+    public:
+        static constexpr TransformHandle InvalidHandle = ~0u;
+
+        // updating less entries than this doesn't worth the cost of scheduling jobs
+        static constexpr uint32 MinParallelUpdate = 2048;
+        static constexpr uint32 UpdateBatchSize = 512;
+
+        static TransformStore& Instance()
+        {
+            static TransformStore instance;
+            return instance;
+        }
+
+        // identity transform, @owner is an opaque pointer returned by @GetOwner
+        TransformHandle Allocate(void* owner = nullptr);
+        void Free(TransformHandle handle);
+
+        inline void* GetOwner(TransformHandle handle) const { ASSERT(handle < Capacity()); return mOwners[handle]; }
+        inline void SetOwner(TransformHandle handle, void* owner) { ASSERT(handle < Capacity()); mOwners[handle] = owner; }
+
+        void SetTranslation(TransformHandle handle, const Vector3& translation);
+        // euler angles in radian, same order as @Matrix4x4::SetRotation
+        void SetRotation(TransformHandle handle, const Vector3& rotation);
+        void SetScale(TransformHandle handle, const Vector3& scale);
+
+        // decompose @matrix into translation, rotation and scale, shear is lost
+        void SetWorldMatrix(TransformHandle handle, const Matrix4x4& matrix);
+
+        inline Vector3 GetTranslation(TransformHandle handle) const { ASSERT(handle < Capacity()); return Vector3(mTranslationX[handle], mTranslationY[handle], mTranslationZ[handle]); }
+        inline Vector3 GetRotation(TransformHandle handle) const { ASSERT(handle < Capacity()); return Vector3(mRotationX[handle], mRotationY[handle], mRotationZ[handle]); }
+        inline Vector3 GetScale(TransformHandle handle) const { ASSERT(handle < Capacity()); return Vector3(mScaleX[handle], mScaleY[handle], mScaleZ[handle]); }
+
+        // matrices are only refreshed by @Update, they are stale while the entry is dirty
+        inline const Matrix4x4& GetWorldMatrix(TransformHandle handle) const { ASSERT(handle < Capacity()); return mWorld[handle]; }
+        inline const Matrix4x4& GetInverseWorldMatrix(TransformHandle handle) const { ASSERT(handle < Capacity()); return mInverseWorld[handle]; }
+
+        inline bool IsDirty(TransformHandle handle) const { ASSERT(handle < Capacity()); return mDirtyBits[handle / 64] & (1ull << (handle % 64)); }
+
+        // recompute the matrices of all dirty entries, return the handles that are updated
+        const std::vector<TransformHandle>& Update();
+
+        inline uint32 Capacity() const { return static_cast<uint32>(mOwners.size()); }
+        inline uint32 Size() const { return Capacity() - static_cast<uint32>(mFreeHandles.size()); }
+
+    protected:
+        void MarkDirty(TransformHandle handle);
+
+        // recompute the matrices of @handles[@begin, @end)
+        void UpdateRange(uint32 begin, uint32 end);
+
+    protected:
+        std::vector<float> mTranslationX, mTranslationY, mTranslationZ;
+        std::vector<float> mRotationX, mRotationY, mRotationZ;
+        std::vector<float> mScaleX, mScaleY, mScaleZ;
+        std::vector<Matrix4x4> mWorld;
+        std::vector<Matrix4x4> mInverseWorld;
+        std::vector<void*> mOwners;
+
+        std::vector<uint64> mDirtyBits;
+        std::vector<TransformHandle> mFreeHandles;
+        std::vector<TransformHandle> mUpdated;
+    };
+}
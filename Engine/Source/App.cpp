@@ -94,6 +94,16 @@ namespace MRenderer
         mDevice = std::make_unique<D3D12Device>(mClientWidth, mClientHeight);
         mDevice->BeginFrame();
 
+        // the uploads are processed here and in @Render, the imports run by the console wait for them on their thread
+        ResourceLoader::Instance().BindDeviceThread();
+
+        // the packed assets are read before the loose files, see PackArchiveCommand
+        if (std::filesystem::exists(ResourceLoader::DefaultArchivePath))
+        {
+            ResourceLoader::Instance().MountArchive(ResourceLoader::DefaultArchivePath);
+        }
+
+        // the models, materials and textures of the scene are decoded in parallel on the workers, and uploaded here as they finish
         mScene = ResourceLoader::Instance().LoadResource<Scene>("Asset/Scene/main.json");
 
         mCamera = std::make_unique<Camera>(0.333f * PI, mClientWidth, mClientHeight, 0.1F, 1000.0F);
@@ -142,11 +152,20 @@ namespace MRenderer
 
         delta_pos = mCamera->GetWorldMatrix() * Vector4(delta_pos * 0.05F, 0);
         mCamera->Move(delta_pos);
+
+        if (mScene)
+        {
+            mScene->UpdateTransform();
+        }
     }
 
     void App::Render(const GameTimer& gt)
     {
         mDevice->BeginFrame();
+
+        // the resources loaded asynchronously are uploaded with the frame
+        ResourceLoader::Instance().ProcessUploads();
+
         D3D12CommandList* list = mRenderScheduler->ExecutePipeline(mScene.get(), mCamera.get(), &mTimer);
         mDevice->EndFrame(list);
     }
@@ -393,6 +412,9 @@ namespace MRenderer
                 "    fps: " + std::to_string(fps) +
                 "    time" + std::to_string(mTimer.TotalTime()) +
                 " culled: " + std::to_string(culling_status.NumCulled) +
+                " occluded: " + std::to_string(culling_status.NumOccluded) +
+                " meshlets culled: " + std::to_string(culling_status.NumMeshletCulled) +
+                " lod: " + std::to_string(culling_status.NumLodDrawCall) +
                 " drawed: " + std::to_string(culling_status.NumDrawCall);
 
             SetWindowText(mhMainWnd, windowText.c_str());
@@ -1,9 +1,11 @@
 #include <Windows.h>
 #include <DbgHelp.h>
+#include <Psapi.h>
 #include "Plateform/Windows/WindowsUtils.h"
 
 // Ensure that the dbghelp.lib library is linked.
 #pragma comment(lib, "dbghelp.lib")
+#pragma comment(lib, "psapi.lib")
 namespace MRenderer
 {
     std::string WorkingDirectory() {
@@ -13,6 +15,13 @@ namespace MRenderer
         return std::string(buffer).substr(0, pos);
     }
 
+    ProcessMemory QueryProcessMemory()
+    {
+        PROCESS_MEMORY_COUNTERS_EX counters = {};
+        GetProcessMemoryInfo(GetCurrentProcess(), reinterpret_cast<PROCESS_MEMORY_COUNTERS*>(&counters), sizeof(counters));
+        return ProcessMemory{ counters.WorkingSetSize, counters.PeakWorkingSetSize, counters.PrivateUsage };
+    }
+
     bool core_dump(std::string& path, _EXCEPTION_POINTERS* exc_ptr) {
         HANDLE hFile = CreateFile(path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
         if (hFile == INVALID_HANDLE_VALUE) {
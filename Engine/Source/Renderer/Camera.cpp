@@ -9,5 +9,12 @@ namespace MRenderer
         mPitch += pitch;
 
         mViewSpaceTransform.SetRotation(Matrix3x3::FromEulerAngle(mRoll, mYaw, mPitch));
+        UpdateViewMatrix();
+    }
+
+    void Camera::UpdateViewMatrix()
+    {
+        InverseTRSMatrixBatch(&mViewSpaceTransform, &mLocalSpaceTransform, 1);
+        mViewProjection = mProjection * mLocalSpaceTransform;
     }
 }
@@ -96,7 +96,7 @@ namespace MRenderer
         GetCommandList()->DrawIndexedInstanced(vertices->VertexCount(), 1, 0, 0, 0);
     }
 
-    void D3D12CommandList::DrawMesh(ShadingState* shading_state, EVertexFormat vertex_format, DeviceVertexBuffer* vertices, DeviceIndexBuffer* indicies, uint32 index_begin, uint32 index_count)
+    void D3D12CommandList::DrawMesh(ShadingState* shading_state, EVertexFormat vertex_format, DeviceVertexBuffer* vertices, DeviceIndexBuffer* indicies, uint32 index_begin, uint32 index_count, uint32 base_vertex)
     {
         // mesh
         SetGeometry(vertices, indicies);
@@ -110,7 +110,7 @@ namespace MRenderer
         SetResourceBinding(shading_state->GetResourceBinding(), false);
 
         // issue draw call
-        GetCommandList()->DrawIndexedInstanced(index_count, 1, index_begin, 0, 0);
+        GetCommandList()->DrawIndexedInstanced(index_count, 1, index_begin, static_cast<INT>(base_vertex), 0);
     }
 
     void D3D12CommandList::Dispatch(ShadingState* shading_state, uint32 thread_group_count_x, uint32 thread_group_count_y, uint32 thread_group_count_z)
@@ -244,9 +244,10 @@ namespace MRenderer
         return std::make_shared<DeviceVertexBuffer>(std::move(resource), vbv);
     }
 
-    std::shared_ptr<DeviceIndexBuffer> D3D12ResourceAllocator::CreateIndexBuffer(const void* data, uint32 data_size)
+    std::shared_ptr<DeviceIndexBuffer> D3D12ResourceAllocator::CreateIndexBuffer(const void* data, uint32 data_size, uint32 index_stride)
     {  
-        ASSERT(data_size % sizeof(IndexType) == 0);
+        ASSERT(index_stride == sizeof(uint16) || index_stride == sizeof(uint32));
+        ASSERT(data_size % index_stride == 0);
 
         const D3D12_RESOURCE_STATES InitialState = D3D12_RESOURCE_STATE_INDEX_BUFFER;
         D3D12Resource resource = CreateDeviceBuffer(data_size, false, data, InitialState);
@@ -255,7 +256,7 @@ namespace MRenderer
         D3D12_INDEX_BUFFER_VIEW ibv = {};
         ibv.BufferLocation = resource.Resource()->GetGPUVirtualAddress();
         ibv.SizeInBytes = data_size;
-        ibv.Format = DXGI_FORMAT_R32_UINT; // index format is fixed to DXGI_FORMAT_R32_UINT
+        ibv.Format = index_stride == sizeof(uint16) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
         
         return std::make_shared<DeviceIndexBuffer>(std::move(resource), ibv);
     }
@@ -3,6 +3,7 @@
 #include "Resource/ResourceLoader.h"
 #include "Renderer/Scene.h"
 #include "Renderer/Device/Direct12/D3D12CommandList.h"
+#include "Utils/MeshletCulling.h"
 #include "pix3.h"
 
 #define PIXScope(cmd, name) PIXScopedEvent((cmd)->GetCommandList(), PIX_COLOR_DEFAULT, name);
@@ -14,6 +15,14 @@ namespace MRenderer
         return AlignUp(texture_size, thread_group_size) / thread_group_size;
     }
 
+    // fraction of the screen height covered by the bounding sphere of @bound, @projection_scale is the (1, 1) element of the projection matrix
+    inline float ProjectedScreenSize(const AABB& bound, const Vector3& camera_position, float projection_scale)
+    {
+        float radius = bound.Size().Length() * 0.5f;
+        float distance = (bound.Center() - camera_position).Length();
+        return distance > radius ? radius * projection_scale / distance : 1.0f;
+    }
+
     DeferredRenderPipeline::DeferredRenderPipeline()
         :IRenderPipeline()
     {
@@ -84,6 +93,13 @@ namespace MRenderer
             
             PIXScope(context->CommandList, "Precompute PrefilterEnvMap Pass");
 
+            CubeMapResource* sky_box = context->Scene->GetSkyBox();
+            if (sky_box && sky_box->PrefilteredMap())
+            {
+                context->CommandList->CopyTexture(sky_box->PrefilteredMap()->Resource(), mPrefilterEnvMap->Resource());
+                return;
+            }
+
             for (uint32 i = 0; i < PreFilterEnvMapMipsLevel; i++)
             {
                 ShadingState& shading_state = mShadingState[i];
@@ -122,6 +138,13 @@ namespace MRenderer
 
             PIXScope(context->CommandList, "Precompute BRDF Pass");
 
+            CubeMapResource* sky_box = context->Scene->GetSkyBox();
+            if (sky_box && sky_box->BRDFLut())
+            {
+                context->CommandList->CopyTexture(sky_box->BRDFLut()->Resource(), mPrecomputeBRDF->Resource());
+                return;
+            }
+
             constexpr uint32 ThreadGroupSize = 8;
             constexpr uint32 ThreadGroupCount = 512 / ThreadGroupSize;
 
@@ -139,27 +162,97 @@ namespace MRenderer
     {
         PIXScope(context->CommandList, "Gbuffer Pass");
 
-        FrustumVolume volume = FrustumVolume::FromMatrix(context->Camera->GetProjectionMatrix() * context->Camera->GetLocalSpaceMatrix());
+        const Matrix4x4& view_projection = context->Camera->GetViewProjectionMatrix();
+        FrustumVolume volume = FrustumVolume::FromMatrix(view_projection);
 
         mCullingStatus = {};
-        context->Scene->CullModel(volume,
-            [&](SceneModel* model)
+        context->Scene->CullModel(volume, mVisibleModels, mCulledIndices);
+        CullOccludedModel(view_projection);
+
+        Vector3 camera_position = context->Camera->GetWorldMatrix().GetTranslation();
+        float projection_scale = context->Camera->GetProjectionMatrix().At(1, 1);
+        for (SceneModel* model : mVisibleModels)
+        {
+            DrawModel(context->CommandList, model, view_projection, camera_position, projection_scale);
+        }
+
+        mCullingStatus.NumCulled = context->Scene->GetMeshCount() - mCullingStatus.NumDrawCall - mCullingStatus.NumOccluded;
+    }
+
+    void GBufferPass::CullOccludedModel(const Matrix4x4& view_projection)
+    {
+        mOcclusionBuffer.Clear(view_projection);
+
+        bool has_occluder = false;
+        for (SceneModel* model : mVisibleModels)
+        {
+            if (model->IsOccluder())
             {
-                DrawModel(context->CommandList, model);
+                mOcclusionBuffer.RasterizeOccluder(model->GetModel()->GetMeshResource()->GetOccluderMesh(), model->GetWorldMatrix());
+                has_occluder = true;
             }
-        );
+        }
+
+        if (!has_occluder)
+        {
+            return;
+        }
+
+        mOcclusionBuffer.BuildHierarchy();
+
+        // occluders are always drawn, testing them against themselves is pointless
+        std::erase_if(mVisibleModels,
+            [this](SceneModel* model)
+            {
+                if (model->IsOccluder() || !mOcclusionBuffer.IsOccluded(model->GetWorldBound()))
+                {
+                    return false;
+                }
 
-        mCullingStatus.NumCulled = context->Scene->GetMeshCount() - mCullingStatus.NumDrawCall;
+                mCullingStatus.NumOccluded += static_cast<uint32>(model->GetModel()->GetMeshResource()->GetSubMeshes().size());
+                return true;
+            }
+        );
     }
 
-    void GBufferPass::DrawModel(D3D12CommandList* cmd, SceneModel* obj)
+    void GBufferPass::DrawModel(D3D12CommandList* cmd, SceneModel* obj, const Matrix4x4& view_projection, const Vector3& camera_position, float projection_scale)
     {
         MeshResource* mesh = obj->GetModel()->GetMeshResource();
+        const std::vector<MeshletData>& meshlets = mesh->GetMeshlets();
+        MeshletCulling meshlet_culling = MeshletCulling::FromWorld(view_projection, camera_position, obj->GetWorldMatrix(), obj->GetInverseWorldMatrix());
+
+        uint32 lod = mesh->GetLods().SelectLod(ProjectedScreenSize(obj->GetWorldBound(), camera_position, projection_scale));
+        std::span<const SubMeshData> sub_meshes = mesh->GetSubMeshes(lod);
         
         // issue draw call
-        for (uint32 i = 0; i < mesh->GetSubMeshes().size(); i++)
+        for (uint32 i = 0; i < sub_meshes.size(); i++)
         {
+            const SubMeshData& sub_mesh = sub_meshes[i];
+            if (sub_mesh.IndicesCount == 0)
+            {
+                continue;
+            }
+
+            // meshes imported before meshlets are drawn as a whole, so are the lods since the meshlets only split the full resolution triangles
+            mDrawRanges.clear();
+            if (meshlets.empty() || lod > 0)
+            {
+                mDrawRanges.push_back(sub_mesh);
+            }
+            else
+            {
+                MeshletCullStatus meshlet_status;
+                meshlet_culling.Cull(meshlets, sub_mesh, mDrawRanges, meshlet_status);
+                mCullingStatus.NumMeshletCulled += meshlet_status.NumFrustumCulled + meshlet_status.NumBackfaceCulled;
+            }
+
+            if (mDrawRanges.empty())
+            {
+                continue;
+            }
+
             mCullingStatus.NumDrawCall++;
+            mCullingStatus.NumLodDrawCall += lod > 0;
 
             // update per object constant buffer
             MaterialResource* material = obj->GetModel()->GetMaterial(i);
@@ -170,7 +263,8 @@ namespace MRenderer
             // copy shader parameters from parameter table to constant buffer
             material->ApplyShaderParameter(cb, shading_state->GetShader(), ConstantBufferInstance::SemanticName);
             cb.Model = obj->GetWorldMatrix(),
-            cb.InvModel = obj->GetWorldMatrix().Inverse(),
+            cb.InvModel = obj->GetInverseWorldMatrix(),
+            cb.SetVertexFormat(mesh->GetVertexFormat(), mesh->GetBound());
 
             obj->GetConstantBuffer()->CommitData(cb);
             cmd->SetGrphicsConstant(EConstantBufferType_Instance, obj->GetConstantBuffer()->GetCurrendConstantBufferView());
@@ -179,8 +273,10 @@ namespace MRenderer
             cmd->SetGraphicsPipelineState(mesh->GetVertexFormat(), &mPipelineStateDesc, &mPassPsoDesc, shading_state->GetShader());
             
             // issue drawcall
-            const SubMeshData& sub_mesh = mesh->GetSubMeshes()[i];
-            cmd->DrawMesh(shading_state, mesh->GetVertexFormat(), mesh->GetVertexBuffer(), mesh->GetIndexBuffer(), sub_mesh.Index, sub_mesh.IndicesCount);
+            for (const SubMeshData& range : mDrawRanges)
+            {
+                cmd->DrawMesh(shading_state, mesh->GetVertexFormat(), mesh->GetVertexBuffer(), mesh->GetIndexBuffer(), range.Index, range.IndicesCount, mesh->GetBaseVertex(i));
+            }
         }
     }
 
@@ -221,7 +317,7 @@ namespace MRenderer
             // frustum culling point lights
             ASSERT(context->Scene->GetLightCount() <= MaxSceneLights);
 
-            FrustumVolume volume = FrustumVolume::FromMatrix(context->Camera->GetProjectionMatrix() * context->Camera->GetLocalSpaceMatrix());
+            FrustumVolume volume = FrustumVolume::FromMatrix(context->Camera->GetViewProjectionMatrix());
             std::array<PointLight, MaxSceneLights> lights;
 
             int i = 0;
@@ -25,7 +25,7 @@ namespace MRenderer
                     .InvView = camera->GetWorldMatrix(),
                     .View = camera->GetLocalSpaceMatrix(),
                     .Projection = camera->GetProjectionMatrix(),
-                    .InvProjection = camera->GetProjectionMatrix().Inverse(),
+                    .InvProjection = camera->GetInverseProjectionMatrix(),
                     .CameraPos = camera->GetTranslation(),
                     .Ratio = camera->Ratio(),
                     .Resolution = Vector2(static_cast<float>(GD3D12Device->Width()), static_cast<float>(GD3D12Device->Height())),
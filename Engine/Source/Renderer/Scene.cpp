@@ -5,11 +5,16 @@
 
 namespace MRenderer{
     SceneObject::SceneObject()
-        :mScale(1.0, 1.0, 1.0)
+        :mScale(1.0, 1.0, 1.0), mTransform(TransformStore::Instance().Allocate(this))
     {
         mConstantBuffer = GD3D12ResourceAllocator->CreateConstBuffer(sizeof(ConstantBufferInstance));
     }
 
+    SceneObject::~SceneObject()
+    {
+        TransformStore::Instance().Free(mTransform);
+    }
+
     SceneObject::SceneObject(std::string_view name)
         :SceneObject()
     {
@@ -30,9 +35,10 @@ namespace MRenderer{
 
     void SceneObject::PostDeserialized()
     {
-        mModelMatrix.SetRotation(mRotation.x * Deg2Rad, mRotation.y * Deg2Rad, mRotation.z * Deg2Rad);
-        mModelMatrix.SetTranslation(mTranslation);
-        mModelMatrix.SetScale(mScale);
+        TransformStore& store = TransformStore::Instance();
+        store.SetTranslation(mTransform, mTranslation);
+        store.SetRotation(mTransform, FromSerializedRotation(mRotation));
+        store.SetScale(mTransform, mScale);
     }
 
     void SceneModel::SetModel(const std::shared_ptr<ModelResource>& res)
@@ -46,9 +52,11 @@ namespace MRenderer{
     {
         SceneObject::PostDeserialized();
 
+        // the models of a scene are loaded all at once, see @ResourceLoader::LoadDependency
         if (!mModel)
         {
-            SetModel(ResourceLoader::Instance().LoadResource<ModelResource>(mModelFilePath));
+            std::shared_future<std::shared_ptr<ModelResource>> model = ResourceLoader::Instance().LoadDependency<ModelResource>(mModelFilePath);
+            ResourceLoader::Instance().DeferToDevice([this, model]() { SetModel(model.get()); });
         }
     }
 
@@ -82,19 +90,39 @@ namespace MRenderer{
 
     void Scene::PostDeserialized()
     {
+        std::shared_future<std::shared_ptr<CubeMapResource>> sky_box;
         if (!mSkyBoxPath.empty()) 
         {
-            mSkyBox = ResourceLoader::Instance().LoadResource<CubeMapResource>(mSkyBoxPath);
+            sky_box = ResourceLoader::Instance().LoadDependency<CubeMapResource>(mSkyBoxPath);
         }
 
-        for (int i = 0; i < mSceneModel.size(); i++) 
-        {
-            AddOctreeElementInternal(mOctreeSceneModel, *mSceneModel[i], i);
-        }
+        // after the models are set, since they give the bounds
+        ResourceLoader::Instance().DeferToDevice(
+            [this, sky_box]()
+            {
+                if (sky_box.valid())
+                {
+                    mSkyBox = sky_box.get();
+                }
+
+                // the octrees are built from the world matrices
+                UpdateTransform();
 
-        for (int i = 0; i < mSceneLight.size(); i++)
+                BuildOctreeInternal(mOctreeSceneModel, mSceneModel);
+                BuildOctreeInternal(mOctreeSceneLight, mSceneLight);
+            }
+        );
+    }
+
+    void Scene::UpdateTransform()
+    {
+        TransformStore& store = TransformStore::Instance();
+        for (TransformHandle handle : store.Update())
         {
-            AddOctreeElementInternal(mOctreeSceneLight, *mSceneLight[i], i);
+            if (SceneObject* obj = static_cast<SceneObject*>(store.GetOwner(handle)))
+            {
+                obj->mOnTransformChanged.Broadcast(obj->GetTranslation());
+            }
         }
     }
 
@@ -0,0 +1,279 @@
+#include "Resource/AssetArchive.h"
+#include "Utils/LZCodec.h"
+#include "Utils/Misc.h"
+#include "Utils/Thread.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
+namespace MRenderer
+{
+    // the raw bytes @AssetArchive::Pack reads before it compresses and writes them, a larger file is a batch of its own
+    static constexpr uint64 PackBatchSize = 64 * 1024 * 1024;
+
+    static inline uint64 AlignEntryOffset(uint64 offset)
+    {
+        return (offset + AssetArchive::EntryAlignment - 1) & ~uint64(AssetArchive::EntryAlignment - 1);
+    }
+
+    static inline bool IsPackedExtension(const std::filesystem::path& path)
+    {
+        return path.extension() == ".json" || path.extension() == ".bin";
+    }
+
+    std::string AssetArchive::NormalizePath(std::string_view path)
+    {
+        // the repo paths mix both separators
+        std::string generic(path);
+        std::replace(generic.begin(), generic.end(), '\\', '/');
+        return std::filesystem::path(generic).lexically_normal().generic_string();
+    }
+
+    uint64 AssetArchive::HashPath(std::string_view normalized_path)
+    {
+        // FNV-1a
+        uint64 hash = 14695981039346656037ull;
+        for (char c : normalized_path)
+        {
+            hash = (hash ^ static_cast<uint8>(c)) * 1099511628211ull;
+        }
+        return hash;
+    }
+
+    std::shared_ptr<AssetArchive> AssetArchive::Open(std::string_view path)
+    {
+        std::shared_ptr<MappedFile> file = MappedFile::Open(path);
+        if (!file || file->Size() < sizeof(Header))
+        {
+            return nullptr;
+        }
+
+        const Header* header = reinterpret_cast<const Header*>(file->Data());
+        if (header->Tag != Magic || header->Version > CurrentVersion)
+        {
+            Log("Archive ", path, " Is Not Supported");
+            return nullptr;
+        }
+
+        uint64 tables_size = sizeof(Header) + uint64(header->NumEntries) * sizeof(Entry) + uint64(header->NumBuckets) * sizeof(uint32) + header->NamesSize;
+        bool power_of_2 = header->NumBuckets > 0 && (header->NumBuckets & (header->NumBuckets - 1)) == 0;
+        if (!power_of_2 || header->NumBuckets < header->NumEntries || tables_size > file->Size())
+        {
+            Log("Archive ", path, " Is Corrupted");
+            return nullptr;
+        }
+
+        std::shared_ptr<AssetArchive> archive(new AssetArchive());
+        archive->mHeader = header;
+        archive->mEntries = reinterpret_cast<const Entry*>(header + 1);
+        archive->mBuckets = reinterpret_cast<const uint32*>(archive->mEntries + header->NumEntries);
+        archive->mNames = reinterpret_cast<const char*>(archive->mBuckets + header->NumBuckets);
+
+        // the whole archive is read in one go, rather than a page fault at a time as the resources are loaded
+        file->Prefetch();
+        archive->mFile = std::move(file);
+        return archive;
+    }
+
+    std::string_view AssetArchive::EntryName(const Entry& entry) const
+    {
+        if (uint64(entry.NameOffset) + entry.NameSize > mHeader->NamesSize)
+        {
+            return {};
+        }
+        return std::string_view(mNames + entry.NameOffset, entry.NameSize);
+    }
+
+    const AssetArchive::Entry* AssetArchive::Find(std::string_view path) const
+    {
+        std::string normalized = NormalizePath(path);
+        uint64 hash = HashPath(normalized);
+
+        uint32 mask = mHeader->NumBuckets - 1;
+        for (uint32 i = 0, bucket = static_cast<uint32>(hash) & mask; i < mHeader->NumBuckets; i++, bucket = (bucket + 1) & mask)
+        {
+            uint32 index = mBuckets[bucket];
+            if (index == EmptyBucket || index >= mHeader->NumEntries)
+            {
+                return nullptr;
+            }
+
+            const Entry& entry = mEntries[index];
+            if (entry.Hash == hash && EntryName(entry) == normalized)
+            {
+                return &entry;
+            }
+        }
+        return nullptr;
+    }
+
+    const uint8* AssetArchive::Read(const Entry& entry, std::vector<uint8>& out_storage) const
+    {
+        if (entry.Offset + entry.Size > mFile->Size())
+        {
+            return nullptr;
+        }
+
+        const uint8* data = mFile->Data() + entry.Offset;
+        switch (entry.Codec)
+        {
+        case EArchiveCodec_None:
+            return entry.Size == entry.RawSize ? data : nullptr;
+        case EArchiveCodec_LZ:
+            out_storage.resize(entry.RawSize);
+            return LZCodec::Decompress(data, entry.Size, out_storage.data(), entry.RawSize) ? out_storage.data() : nullptr;
+        default:
+            return nullptr;
+        }
+    }
+
+    bool AssetArchive::Pack(std::string_view folder, std::string_view archive_path, bool compress, ArchivePackStats* out_stats)
+    {
+        namespace fs = std::filesystem;
+
+        if (!fs::is_directory(folder))
+        {
+            Log("Pack failed, ", folder, " Is Not A Folder");
+            return false;
+        }
+
+        // only the resources the loader reads, the archive may be written inside the folder
+        std::vector<fs::path> files;
+        for (const fs::directory_entry& it : fs::recursive_directory_iterator(folder))
+        {
+            if (it.is_regular_file() && IsPackedExtension(it.path()) && !(fs::exists(archive_path) && fs::equivalent(it.path(), archive_path)))
+            {
+                files.push_back(it.path());
+            }
+        }
+        std::sort(files.begin(), files.end());
+
+        Header header;
+        header.NumEntries = static_cast<uint32>(files.size());
+        header.NumBuckets = 1;
+        while (header.NumBuckets < header.NumEntries * 2)
+        {
+            header.NumBuckets *= 2;
+        }
+
+        // the table is known before any file is read but the stored sizes, it's written once the entries are
+        std::vector<Entry> entries(header.NumEntries);
+        std::vector<uint32> buckets(header.NumBuckets, EmptyBucket);
+        std::string names_data;
+        for (uint32 i = 0; i < header.NumEntries; i++)
+        {
+            std::string name = NormalizePath(fs::relative(files[i], fs::current_path()).string());
+            if (name.size() > UINT16_MAX)
+            {
+                Log("Pack failed, Path Is Too Long ", name);
+                return false;
+            }
+
+            Entry& entry = entries[i];
+            entry.Hash = HashPath(name);
+            entry.NameOffset = static_cast<uint32>(names_data.size());
+            entry.NameSize = static_cast<uint16>(name.size());
+            names_data += name;
+
+            uint32 mask = header.NumBuckets - 1;
+            uint32 bucket = static_cast<uint32>(entry.Hash) & mask;
+            while (buckets[bucket] != EmptyBucket)
+            {
+                bucket = (bucket + 1) & mask;
+            }
+            buckets[bucket] = i;
+        }
+        header.NamesSize = static_cast<uint32>(names_data.size());
+
+        std::optional<std::ofstream> file = WriteFile(archive_path, true);
+        if (!file.has_value())
+        {
+            Log("Pack failed, Can't Write ", archive_path);
+            return false;
+        }
+
+        std::ofstream& out = file.value();
+        const std::vector<char> zeros(EntryAlignment, 0);
+        uint64 offset = AlignEntryOffset(sizeof(Header) + entries.size() * sizeof(Entry) + buckets.size() * sizeof(uint32) + names_data.size());
+        out.seekp(offset);
+
+        // the files are read and compressed a batch at a time and written in order, only one batch is held in memory
+        std::vector<std::vector<uint8>> contents;
+        for (uint32 batch_begin = 0; batch_begin < header.NumEntries;)
+        {
+            uint32 batch_end = batch_begin;
+            uint64 batch_bytes = 0;
+            contents.clear();
+            while (batch_end < header.NumEntries && (batch_end == batch_begin || batch_bytes < PackBatchSize))
+            {
+                std::optional<std::ifstream> in = ReadFile(files[batch_end].string(), true);
+                ASSERT(in.has_value());
+                std::vector<uint8>& content = contents.emplace_back(std::istreambuf_iterator<char>(in.value()), std::istreambuf_iterator<char>());
+                entries[batch_end].RawSize = static_cast<uint32>(content.size());
+                batch_bytes += content.size();
+                batch_end++;
+            }
+
+            if (compress)
+            {
+                TaskScheduler& scheduler = TaskScheduler::Instance();
+                JobHandle compression = scheduler.ParallelFor(batch_end - batch_begin, 1,
+                    [&](uint32 begin, uint32 end)
+                    {
+                        for (uint32 i = begin; i < end; i++)
+                        {
+                            uint32 raw_size = entries[batch_begin + i].RawSize;
+                            std::vector<uint8> compressed = LZCodec::Compress(contents[i].data(), raw_size);
+                            if (compressed.size() < raw_size - raw_size / 8)
+                            {
+                                contents[i] = std::move(compressed);
+                                entries[batch_begin + i].Codec = EArchiveCodec_LZ;
+                            }
+                        }
+                    }
+                );
+                scheduler.Wait(compression);
+            }
+
+            for (uint32 i = batch_begin; i < batch_end; i++)
+            {
+                const std::vector<uint8>& content = contents[i - batch_begin];
+                entries[i].Offset = offset;
+                entries[i].Size = static_cast<uint32>(content.size());
+                out.write(zeros.data(), offset - static_cast<uint64>(out.tellp()));
+                out.write(reinterpret_cast<const char*>(content.data()), content.size());
+                offset = AlignEntryOffset(offset + content.size());
+            }
+            batch_begin = batch_end;
+        }
+
+        // the archive is mapped whole, see @MappedFile
+        uint64 archive_size = static_cast<uint64>(out.tellp());
+        if (archive_size > UINT32_MAX)
+        {
+            out.close();
+            fs::remove(archive_path);
+            Log("Pack failed, Archive Is Larger Than 4GB");
+            return false;
+        }
+
+        out.seekp(0);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+        out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(Entry));
+        out.write(reinterpret_cast<const char*>(buckets.data()), buckets.size() * sizeof(uint32));
+        out.write(names_data.data(), names_data.size());
+        out.flush();
+
+        if (out_stats)
+        {
+            *out_stats = ArchivePackStats{ .NumEntries = header.NumEntries, .ArchiveBytes = archive_size };
+            for (const Entry& entry : entries)
+            {
+                out_stats->NumCompressed += entry.Codec == EArchiveCodec_LZ;
+                out_stats->RawBytes += entry.RawSize;
+            }
+        }
+        return true;
+    }
+}
@@ -1,6 +1,9 @@
 #include "Resource/BasicStorage.h"
 #include "Resource/TextureCompression.h"
+#include "Utils/LZCodec.h"
+#include "Utils/MappedFile.h"
 #include "Utils/Serialization.h"
+#include "Utils/Thread.h"
 
 namespace MRenderer
 {
@@ -36,6 +39,20 @@ namespace MRenderer
         return static_cast<uint32>(DirectX::BitsPerPixel(format) / CHAR_BIT);
     }
 
+    static thread_local bool tCompressPayloads = false;
+    static thread_local uint32 tNumCorruptedPayloads = 0;
+
+    BinaryData::CompressionScope::CompressionScope(bool compress)
+        :mPrevious(tCompressPayloads)
+    {
+        tCompressPayloads = compress;
+    }
+
+    BinaryData::CompressionScope::~CompressionScope()
+    {
+        tCompressPayloads = mPrevious;
+    }
+
     BinaryData::BinaryData()
         :mSize(0), mData(nullptr)
     {
@@ -57,12 +74,27 @@ namespace MRenderer
     {
         if (mData != nullptr)
         {
-            free(mData);
+            if (!mSource)
+            {
+                free(mData);
+            }
             mData = nullptr;
             mSize = 0;
         }
     }
 
+    BinaryData BinaryData::View(std::shared_ptr<MappedFile> source, const void* data, uint32 size)
+    {
+        ASSERT(source && data >= source->Data() && static_cast<const uint8*>(data) + size <= source->Data() + source->Size());
+
+        // the mapping is copy on write, writing through the view doesn't touch the file
+        BinaryData view;
+        view.mSize = size;
+        view.mData = const_cast<void*>(data);
+        view.mSource = std::move(source);
+        return view;
+    }
+
     BinaryData::BinaryData(BinaryData&& other)
         :BinaryData()
     {
@@ -75,18 +107,264 @@ namespace MRenderer
         return *this;
     }
 
+    void BinaryData::WritePayload(RingBuffer& rb, const void* data, uint32 size)
+    {
+        ASSERT(size < AlignedPayloadFlag);
+
+        // [size | flag][padding][zeros][payload], the offset is relative to the beginning of the buffer, which is the beginning of the file
+        uint32 payload_offset = rb.Occupied() + 2 * sizeof(uint32);
+        uint32 padding = AlignUp(payload_offset, PayloadAlignment) - payload_offset;
+
+        static constexpr uint8 Zeros[PayloadAlignment] = {};
+        rb.Write(size | AlignedPayloadFlag);
+        rb.Write(padding);
+        rb.Write(Zeros, padding);
+        rb.Write(static_cast<const uint8*>(data), size);
+    }
+
+    const uint8* BinaryData::ReadPayload(RingBuffer& rb, uint32& out_size)
+    {
+        // the payloads dumped before the alignment are [size][payload]
+        out_size = rb.Read<uint32>();
+        ASSERT(!(out_size & CompressedPayloadFlag) && "the compressed payloads aren't readable in place, see @ReadCompressedPayload");
+        if (out_size & AlignedPayloadFlag)
+        {
+            out_size &= ~AlignedPayloadFlag;
+            uint32 padding = rb.Read<uint32>();
+            rb.Read(padding);
+        }
+        return rb.Read(out_size);
+    }
+
+    void BinaryData::WriteCompressedPayload(RingBuffer& rb, const void* data, uint32 size)
+    {
+        ASSERT(size < CompressedPayloadFlag);
+
+        const uint8* src = static_cast<const uint8*>(data);
+        uint32 num_blocks = (size + CompressionBlockSize - 1) / CompressionBlockSize;
+        std::vector<std::vector<uint8>> blocks(num_blocks);
+
+        TaskScheduler& scheduler = TaskScheduler::Instance();
+        JobHandle compression = scheduler.ParallelFor(num_blocks, 1,
+            [&](uint32 begin, uint32 end)
+            {
+                for (uint32 i = begin; i < end; i++)
+                {
+                    uint32 offset = i * CompressionBlockSize;
+                    uint32 block_size = std::min(CompressionBlockSize, size - offset);
+                    blocks[i] = LZCodec::Compress(src + offset, block_size);
+                    if (blocks[i].size() >= block_size)
+                    {
+                        blocks[i].assign(src + offset, src + offset + block_size);
+                    }
+                }
+            }
+        );
+        scheduler.Wait(compression);
+
+        rb.Write(size | CompressedPayloadFlag);
+        rb.Write(num_blocks);
+        for (const std::vector<uint8>& block : blocks)
+        {
+            rb.Write(static_cast<uint32>(block.size()));
+        }
+        for (const std::vector<uint8>& block : blocks)
+        {
+            rb.Write(block.data(), static_cast<uint32>(block.size()));
+        }
+    }
+
+    BinaryData BinaryData::ReadCompressedPayload(RingBuffer& rb, bool parallel)
+    {
+        uint32 size = rb.Read<uint32>();
+        ASSERT(size & CompressedPayloadFlag);
+        size &= ~CompressedPayloadFlag;
+
+        uint32 num_blocks = rb.Read<uint32>();
+        ASSERT(num_blocks == (size + CompressionBlockSize - 1) / CompressionBlockSize);
+
+        // the pointer returned by @RingBuffer::Read may not outlive the next read, the stored sizes are copied
+        std::vector<uint32> stored_sizes(num_blocks);
+        memcpy(stored_sizes.data(), rb.Read(num_blocks * sizeof(uint32)), num_blocks * sizeof(uint32));
+
+        std::vector<uint32> stored_offsets(num_blocks);
+        uint32 stored_size = 0;
+        for (uint32 i = 0; i < num_blocks; i++)
+        {
+            stored_offsets[i] = stored_size;
+            stored_size += stored_sizes[i];
+        }
+        const uint8* stored = rb.Read(stored_size);
+
+        // every block is decoded into its place in @out, nothing is staged
+        BinaryData out(size);
+        std::atomic<uint32> num_corrupted = 0;
+        auto decode = [&](uint32 begin, uint32 end)
+            {
+                for (uint32 i = begin; i < end; i++)
+                {
+                    uint8* dst = static_cast<uint8*>(out.mData) + i * CompressionBlockSize;
+                    uint32 block_size = std::min(CompressionBlockSize, size - i * CompressionBlockSize);
+                    if (stored_sizes[i] == block_size)
+                    {
+                        memcpy(dst, stored + stored_offsets[i], block_size);
+                    }
+                    else if (!LZCodec::Decompress(stored + stored_offsets[i], stored_sizes[i], dst, block_size))
+                    {
+                        num_corrupted++;
+                    }
+                }
+            };
+
+        if (parallel && num_blocks > 1)
+        {
+            TaskScheduler& scheduler = TaskScheduler::Instance();
+            scheduler.Wait(scheduler.ParallelFor(num_blocks, 1, decode));
+        }
+        else
+        {
+            decode(0, num_blocks);
+        }
+
+        if (num_corrupted > 0)
+        {
+            Log("Asset Corrupted, ", num_corrupted.load(), " Blocks Failed To Decompress");
+            tNumCorruptedPayloads++;
+            return BinaryData();
+        }
+        return out;
+    }
+
+    uint32 BinaryData::NumCorruptedPayloads()
+    {
+        return tNumCorruptedPayloads;
+    }
+
     void BinaryData::BinarySerialize(RingBuffer& rb, const BinaryData& binary)
     {
-        rb.Write(binary.mSize);
-        rb.Write(reinterpret_cast<const uint8*>(binary.mData), binary.mSize);
+        if (tCompressPayloads)
+        {
+            WriteCompressedPayload(rb, binary.mData, binary.mSize);
+        }
+        else
+        {
+            WritePayload(rb, binary.mData, binary.mSize);
+        }
     }
 
     void BinaryData::BinaryDeserialize(RingBuffer& rb, BinaryData& out)
     {
-        uint32 size = rb.Read<uint32>();
-        const void* buffer = rb.Read(size);
+        if (*reinterpret_cast<const uint32*>(rb.Peek(sizeof(uint32))) & CompressedPayloadFlag)
+        {
+            out = ReadCompressedPayload(rb);
+            return;
+        }
+
+        uint32 size;
+        const uint8* buffer = ReadPayload(rb, size);
+
+        // read in place from a mapped file
+        if (rb.Source() && size > 0)
+        {
+            out = BinaryData::View(rb.Source(), buffer, size);
+        }
+        else
+        {
+            out = BinaryData(buffer, size);
+        }
+    }
+
+    void MeshletChunk::BinarySerialize(RingBuffer& rb, const MeshletChunk& chunk)
+    {
+        if (chunk.Meshlets.empty())
+        {
+            return;
+        }
+
+        rb.Write(Tag);
+        rb.Write(static_cast<uint32>(chunk.Meshlets.size()));
+        rb.Write(reinterpret_cast<const uint8*>(chunk.Meshlets.data()), static_cast<uint32>(chunk.Meshlets.size() * sizeof(MeshletData)));
+    }
+
+    void MeshletChunk::BinaryDeserialize(RingBuffer& rb, MeshletChunk& out)
+    {
+        out.Meshlets.clear();
+
+        // nothing left, the mesh was dumped without meshlets
+        if (rb.Occupied() < sizeof(uint32) || *reinterpret_cast<const uint32*>(rb.Peek(sizeof(uint32))) != Tag)
+        {
+            return;
+        }
+
+        rb.Read<uint32>();
+        uint32 count = rb.Read<uint32>();
+        out.Meshlets.resize(count);
+        memcpy(out.Meshlets.data(), rb.Read(count * sizeof(MeshletData)), count * sizeof(MeshletData));
+    }
+
+    void MeshLodChunk::BinarySerialize(RingBuffer& rb, const MeshLodChunk& chunk)
+    {
+        if (chunk.Lods.empty())
+        {
+            return;
+        }
 
-        out = BinaryData(buffer, size);
+        rb.Write(Tag);
+        rb.Write(static_cast<uint32>(chunk.Lods.size()));
+        rb.Write(static_cast<uint32>(chunk.SubMeshes.size()));
+        rb.Write(reinterpret_cast<const uint8*>(chunk.Lods.data()), static_cast<uint32>(chunk.Lods.size() * sizeof(MeshLodData)));
+        rb.Write(reinterpret_cast<const uint8*>(chunk.SubMeshes.data()), static_cast<uint32>(chunk.SubMeshes.size() * sizeof(SubMeshData)));
+    }
+
+    void MeshLodChunk::BinaryDeserialize(RingBuffer& rb, MeshLodChunk& out)
+    {
+        out.Lods.clear();
+        out.SubMeshes.clear();
+
+        // nothing left, the mesh was dumped without lods
+        if (rb.Occupied() < sizeof(uint32) || *reinterpret_cast<const uint32*>(rb.Peek(sizeof(uint32))) != Tag)
+        {
+            return;
+        }
+
+        rb.Read<uint32>();
+        uint32 num_lods = rb.Read<uint32>();
+        uint32 num_sub_meshes = rb.Read<uint32>();
+        out.Lods.resize(num_lods);
+        out.SubMeshes.resize(num_sub_meshes);
+        memcpy(out.Lods.data(), rb.Read(num_lods * sizeof(MeshLodData)), num_lods * sizeof(MeshLodData));
+        memcpy(out.SubMeshes.data(), rb.Read(num_sub_meshes * sizeof(SubMeshData)), num_sub_meshes * sizeof(SubMeshData));
+    }
+
+    void IndexFormatChunk::BinarySerialize(RingBuffer& rb, const IndexFormatChunk& chunk)
+    {
+        if (chunk.IndexStride == sizeof(uint32))
+        {
+            return;
+        }
+
+        rb.Write(Tag);
+        rb.Write(chunk.IndexStride);
+        rb.Write(static_cast<uint32>(chunk.BaseVertices.size()));
+        rb.Write(reinterpret_cast<const uint8*>(chunk.BaseVertices.data()), static_cast<uint32>(chunk.BaseVertices.size() * sizeof(uint32)));
+    }
+
+    void IndexFormatChunk::BinaryDeserialize(RingBuffer& rb, IndexFormatChunk& out)
+    {
+        out.IndexStride = sizeof(uint32);
+        out.BaseVertices.clear();
+
+        // nothing left, the indices are 32 bits
+        if (rb.Occupied() < sizeof(uint32) || *reinterpret_cast<const uint32*>(rb.Peek(sizeof(uint32))) != Tag)
+        {
+            return;
+        }
+
+        rb.Read<uint32>();
+        out.IndexStride = rb.Read<uint32>();
+        uint32 count = rb.Read<uint32>();
+        out.BaseVertices.resize(count);
+        memcpy(out.BaseVertices.data(), rb.Read(count * sizeof(uint32)), count * sizeof(uint32));
     }
 
     MeshData::MeshData(MeshData&& rhs)
@@ -160,13 +438,18 @@ namespace MRenderer
 
     void TextureData::BinarySerialize(RingBuffer& rb, const TextureData& texture_data)
     {
+        EBlockFormat block_format = TextureCompressor::GetBlockFormat(texture_data.mInfo.Format);
         TextureCompressor::Instance()->Compress(texture_data.mInfo.Width, texture_data.mInfo.Height, texture_data.MipLevels(), texture_data.mInfo.Format, texture_data.mData.GetSize(), static_cast<const uint8*>(texture_data.mData.GetData()),
             [&](uint32 size, const uint8* data)
             {
-                BinarySerialization::Serialize(rb, texture_data.mInfo);
-                rb.Write<uint32>(size);
-                rb.Write(data, size);
-            }
+                TextureInfo info = texture_data.mInfo;
+                info.Format = static_cast<ETextureFormat>(info.Format | TextureInfo::BlockFormatFlag);
+
+                BinarySerialization::Serialize(rb, info);
+                BinarySerialization::Serialize(rb, static_cast<uint8>(block_format));
+                BinaryData::WritePayload(rb, data, size);
+            },
+            block_format, TextureCompressor::GetBlockQuality()
         );
     }
 
@@ -176,14 +459,33 @@ namespace MRenderer
 
         BinarySerialization::Deserialize(rb, out_texture_data.mInfo);
 
-        uint32 compressed_size = rb.Read<uint32>();
-        const uint8* pixels = rb.Read(compressed_size);
+        EBlockFormat block_format = EBlockFormat_None;
+        bool flagged = out_texture_data.mInfo.Format & TextureInfo::BlockFormatFlag;
+        if (flagged)
+        {
+            uint8 format;
+            BinarySerialization::Deserialize(rb, format);
+            block_format = static_cast<EBlockFormat>(format);
+            out_texture_data.mInfo.Format = static_cast<ETextureFormat>(out_texture_data.mInfo.Format & ~TextureInfo::BlockFormatFlag);
+        }
+
+        // the compressed pixels are decompressed straight from the mapped file
+        uint32 compressed_size;
+        const uint8* pixels = BinaryData::ReadPayload(rb, compressed_size);
+
+        // the formats @BlockCompression doesn't take are stored uncompressed, the unflagged ones were compressed by DirectXTex
+        if (flagged && block_format == EBlockFormat_None)
+        {
+            out_texture_data.mData = BinaryData(pixels, compressed_size);
+            return;
+        }
 
         TextureCompressor::Instance()->Decompress(out_texture_data.mInfo.Width, out_texture_data.mInfo.Height, out_texture_data.mInfo.MipLevels, out_texture_data.mInfo.Format, compressed_size, pixels,
             [&](uint32 size, const uint8* data)
             {
                 out_texture_data.mData = BinaryData(data, size);
-            }
+            },
+            block_format
         );
     }
 
@@ -0,0 +1,1851 @@
+#include "Resource/BlockCompression.h"
+#include "Utils/Thread.h"
+
+#include <immintrin.h>
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace MRenderer
+{
+    constexpr uint32 PixelsPerBlock = BlockCompression::PixelsPerBlock;
+    constexpr uint32 AllPixels = 0xFFFF;
+
+    // the pixels of a block by channel, so the kernels load 8 pixels of a channel at once
+    struct alignas(32) BlockPixels
+    {
+        float Channels[4][PixelsPerBlock];
+    };
+
+    // the colors interpolated between the endpoints of a block or of a subset
+    struct BlockPalette
+    {
+        float Colors[16][4];
+        uint32 NumColors;
+    };
+
+    // the bits of a block from the lowest bit of its first byte, BC7 packs its fields this way
+    class BlockBitWriter
+    {
+    public:
+        explicit BlockBitWriter(uint8* block)
+            :mBlock(block), mPosition(0)
+        {
+            memset(block, 0, 16);
+        }
+
+        void Write(uint32 value, uint32 num_bits)
+        {
+            for (uint32 i = 0; i < num_bits; i++, mPosition++)
+            {
+                mBlock[mPosition >> 3] |= static_cast<uint8>(((value >> i) & 1) << (mPosition & 7));
+            }
+        }
+
+    protected:
+        uint8* mBlock;
+        uint32 mPosition;
+    };
+
+    class BlockBitReader
+    {
+    public:
+        explicit BlockBitReader(const uint8* block)
+            :mBlock(block), mPosition(0)
+        {
+        }
+
+        uint32 Read(uint32 num_bits)
+        {
+            uint32 value = 0;
+            for (uint32 i = 0; i < num_bits; i++, mPosition++)
+            {
+                value |= ((mBlock[mPosition >> 3] >> (mPosition & 7)) & 1u) << i;
+            }
+            return value;
+        }
+
+    protected:
+        const uint8* mBlock;
+        uint32 mPosition;
+    };
+
+    // ref: https://learn.microsoft.com/en-us/windows/win32/direct3d11/bc7-format-mode-reference
+    struct BC7ModeInfo
+    {
+        uint8 NumSubsets;
+        uint8 PartitionBits;
+        uint8 RotationBits;
+        uint8 IndexSelectionBits;
+        uint8 ColorBits;
+        uint8 AlphaBits;
+        uint8 EndpointPBits;    // one p bit per endpoint
+        uint8 SharedPBits;      // one p bit per subset
+        uint8 IndexBits;
+        uint8 SecondaryIndexBits;
+    };
+
+    static constexpr BC7ModeInfo BC7Modes[8] =
+    {
+        { 3, 4, 0, 0, 4, 0, 1, 0, 3, 0 },
+        { 2, 6, 0, 0, 6, 0, 0, 1, 3, 0 },
+        { 3, 6, 0, 0, 5, 0, 0, 0, 2, 0 },
+        { 2, 6, 0, 0, 7, 0, 1, 0, 2, 0 },
+        { 1, 0, 2, 1, 5, 6, 0, 0, 2, 3 },
+        { 1, 0, 2, 0, 7, 8, 0, 0, 2, 2 },
+        { 1, 0, 0, 0, 7, 7, 1, 0, 4, 0 },
+        { 2, 6, 0, 0, 5, 5, 1, 0, 2, 0 },
+    };
+
+    static constexpr uint8 BC7Weights2[4] = { 0, 21, 43, 64 };
+    static constexpr uint8 BC7Weights3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+    static constexpr uint8 BC7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    // the pixels of the second subset of the two subsets partitions
+    static constexpr uint16 BC7Partitions2[64] =
+    {
+        0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80, 0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8, 0xFF00, 0xFFF0, 0xF000,
+        0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE, 0x088C, 0x3110, 0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C,
+        0xAAAA, 0xF0F0, 0x5A5A, 0x33CC, 0x3C3C, 0x55AA, 0x9696, 0xA55A, 0x73CE, 0x13C8, 0x324C, 0x3BDC, 0x6996, 0xC33C, 0x9966, 0x0660,
+        0x0272, 0x04E4, 0x4E40, 0x2720, 0xC936, 0x936C, 0x39C6, 0x639C, 0x9336, 0x9CC6, 0x817E, 0xE718, 0xCCF0, 0x0FCC, 0x7744, 0xEE22,
+    };
+
+    // the pixel of the second subset whose index has one bit less, the first subset's is always the first pixel
+    static constexpr uint8 BC7Anchors2[64] =
+    {
+        15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+        15, 2, 8, 2, 2, 8, 8, 15, 2, 8, 2, 2, 8, 8, 2, 2,
+        15, 15, 6, 8, 2, 8, 15, 15, 2, 8, 2, 2, 2, 15, 15, 6,
+        6, 2, 6, 8, 15, 15, 2, 2, 15, 15, 15, 15, 15, 2, 2, 15,
+    };
+
+    static inline const uint8* BC7Weights(uint32 index_bits)
+    {
+        return index_bits == 2 ? BC7Weights2 : (index_bits == 3 ? BC7Weights3 : BC7Weights4);
+    }
+
+    static inline uint32 BC7Interpolate(uint32 e0, uint32 e1, uint32 weight)
+    {
+        return ((64 - weight) * e0 + weight * e1 + 32) >> 6;
+    }
+
+    // replicate the highest bits into the lowest ones, at least 4 bits
+    static inline uint32 ExpandBits(uint32 value, uint32 num_bits)
+    {
+        return num_bits >= 8 ? value : (value << (8 - num_bits)) | (value >> (2 * num_bits - 8));
+    }
+
+    static inline uint32 SubsetMask(uint32 partition, uint32 subset)
+    {
+        return subset == 0 ? (~BC7Partitions2[partition] & AllPixels) : BC7Partitions2[partition];
+    }
+
+    static void LoadBlock(const uint8* pixels, BlockPixels& out_block)
+    {
+        for (uint32 i = 0; i < PixelsPerBlock; i++)
+        {
+            for (uint32 c = 0; c < 4; c++)
+            {
+                out_block.Channels[c][i] = pixels[i * 4 + c];
+            }
+        }
+    }
+
+    // the index of the nearest palette color of each pixel in @mask, compared on the first @num_channels. return the sum of their squared distances
+    static float FindIndices(const BlockPixels& block, const BlockPalette& palette, uint32 num_channels, uint32 mask, uint8* out_indices)
+    {
+#if defined(__AVX__)
+        constexpr uint32 Width = 8;
+#else
+        constexpr uint32 Width = 4;
+#endif
+        float error = 0.0f;
+        for (uint32 begin = 0; begin < PixelsPerBlock; begin += Width)
+        {
+            if (((mask >> begin) & ((1u << Width) - 1)) == 0)
+            {
+                continue;
+            }
+
+            alignas(32) float distances[Width];
+            alignas(32) float indices[Width];
+#if defined(__AVX__)
+            __m256 pixels[4];
+            for (uint32 c = 0; c < num_channels; c++)
+            {
+                pixels[c] = _mm256_load_ps(block.Channels[c] + begin);
+            }
+
+            __m256 best_distance = _mm256_set1_ps(FLT_MAX);
+            __m256 best_index = _mm256_setzero_ps();
+            for (uint32 i = 0; i < palette.NumColors; i++)
+            {
+                __m256 distance = _mm256_setzero_ps();
+                for (uint32 c = 0; c < num_channels; c++)
+                {
+                    __m256 d = _mm256_sub_ps(pixels[c], _mm256_set1_ps(palette.Colors[i][c]));
+                    distance = _mm256_add_ps(distance, _mm256_mul_ps(d, d));
+                }
+
+                __m256 closer = _mm256_cmp_ps(distance, best_distance, _CMP_LT_OQ);
+                best_distance = _mm256_min_ps(distance, best_distance);
+                best_index = _mm256_blendv_ps(best_index, _mm256_set1_ps(static_cast<float>(i)), closer);
+            }
+            _mm256_store_ps(distances, best_distance);
+            _mm256_store_ps(indices, best_index);
+#else
+            __m128 pixels[4];
+            for (uint32 c = 0; c < num_channels; c++)
+            {
+                pixels[c] = _mm_load_ps(block.Channels[c] + begin);
+            }
+
+            __m128 best_distance = _mm_set1_ps(FLT_MAX);
+            __m128 best_index = _mm_setzero_ps();
+            for (uint32 i = 0; i < palette.NumColors; i++)
+            {
+                __m128 distance = _mm_setzero_ps();
+                for (uint32 c = 0; c < num_channels; c++)
+                {
+                    __m128 d = _mm_sub_ps(pixels[c], _mm_set1_ps(palette.Colors[i][c]));
+                    distance = _mm_add_ps(distance, _mm_mul_ps(d, d));
+                }
+
+                __m128 closer = _mm_cmplt_ps(distance, best_distance);
+                best_distance = _mm_min_ps(distance, best_distance);
+                best_index = _mm_or_ps(_mm_and_ps(closer, _mm_set1_ps(static_cast<float>(i))), _mm_andnot_ps(closer, best_index));
+            }
+            _mm_store_ps(distances, best_distance);
+            _mm_store_ps(indices, best_index);
+#endif
+            for (uint32 i = 0; i < Width; i++)
+            {
+                if (mask & (1u << (begin + i)))
+                {
+                    out_indices[begin + i] = static_cast<uint8>(indices[i]);
+                    error += distances[i];
+                }
+            }
+        }
+        return error;
+    }
+
+    // the mean and the principal axis of the pixels in @mask, by power iteration on their covariance
+    static void FitLine(const BlockPixels& block, uint32 num_channels, uint32 mask, float* out_mean, float* out_axis)
+    {
+        float mean[4] = {};
+        uint32 count = 0;
+        for (uint32 i = 0; i < PixelsPerBlock; i++)
+        {
+            if (mask & (1u << i))
+            {
+                for (uint32 c = 0; c < num_channels; c++)
+                {
+                    mean[c] += block.Channels[c][i];
+                }
+                count++;
+            }
+        }
+
+        for (uint32 c = 0; c < num_channels; c++)
+        {
+            out_mean[c] = mean[c] / std::max(count, 1u);
+        }
+
+        float covariance[4][4] = {};
+        for (uint32 i = 0; i < PixelsPerBlock; i++)
+        {
+            if (mask & (1u << i))
+            {
+                for (uint32 a = 0; a < num_channels; a++)
+                {
+                    for (uint32 b = 0; b < num_channels; b++)
+                    {
+                        covariance[a][b] += (block.Channels[a][i] - out_mean[a]) * (block.Channels[b][i] - out_mean[b]);
+                    }
+                }
+            }
+        }
+
+        // start from the row of the widest channel, which can't be orthogonal to the principal axis unless the covariance is zero
+        uint32 widest = 0;
+        for (uint32 c = 1; c < num_channels; c++)
+        {
+            widest = covariance[c][c] > covariance[widest][widest] ? c : widest;
+        }
+
+        float axis[4] = {};
+        for (uint32 c = 0; c < num_channels; c++)
+        {
+            axis[c] = covariance[widest][c];
+        }
+
+        for (uint32 iteration = 0; iteration < 8; iteration++)
+        {
+            float next[4] = {};
+            float largest = 0.0f;
+            for (uint32 a = 0; a < num_channels; a++)
+            {
+                for (uint32 b = 0; b < num_channels; b++)
+                {
+                    next[a] += covariance[a][b] * axis[b];
+                }
+                largest = std::max(largest, std::abs(next[a]));
+            }
+
+            if (largest <= 0.0f)
+            {
+                break;
+            }
+
+            for (uint32 c = 0; c < num_channels; c++)
+            {
+                axis[c] = next[c] / largest;
+            }
+        }
+
+        float length = 0.0f;
+        for (uint32 c = 0; c < num_channels; c++)
+        {
+            length += axis[c] * axis[c];
+        }
+        length = std::sqrt(length);
+
+        for (uint32 c = 0; c < num_channels; c++)
+        {
+            out_axis[c] = length > 0.0f ? axis[c] / length : 0.0f;
+        }
+    }
+
+    // the ends of the principal axis over the pixels in @mask
+    static void FitEndpoints(const BlockPixels& block, uint32 num_channels, uint32 mask, float* out_e0, float* out_e1)
+    {
+        float mean[4];
+        float axis[4];
+        FitLine(block, num_channels, mask, mean, axis);
+
+        float min_t = FLT_MAX;
+        float max_t = -FLT_MAX;
+        for (uint32 i = 0; i < PixelsPerBlock; i++)
+        {
+            if (mask & (1u << i))
+            {
+                float t = 0.0f;
+                for (uint32 c = 0; c < num_channels; c++)
+                {
+                    t += (block.Channels[c][i] - mean[c]) * axis[c];
+                }
+                min_t = std::min(min_t, t);
+                max_t = std::max(max_t, t);
+            }
+        }
+
+        for (uint32 c = 0; c < num_channels; c++)
+        {
+            out_e0[c] = std::clamp(mean[c] + axis[c] * min_t, 0.0f, 255.0f);
+            out_e1[c] = std::clamp(mean[c] + axis[c] * max_t, 0.0f, 255.0f);
+        }
+    }
+
+    // the squared distance of the pixels in @mask to their principal axis, how well a single subset can fit them
+    static float LineResidual(const BlockPixels& block, uint32 num_channels, uint32 mask)
+    {
+        float mean[4];
+        float axis[4];
+        FitLine(block, num_channels, mask, mean, axis);
+
+        float residual = 0.0f;
+        for (uint32 i = 0; i < PixelsPerBlock; i++)
+        {
+            if (mask & (1u << i))
+            {
+                float d[4];
+                float t = 0.0f;
+                for (uint32 c = 0; c < num_channels; c++)
+                {
+                    d[c] = block.Channels[c][i] - mean[c];
+                    t += d[c] * axis[c];
+                }
+                for (uint32 c = 0; c < num_channels; c++)
+                {
+                    residual += (d[c] - t * axis[c]) * (d[c] - t * axis[c]);
+                }
+            }
+        }
+        return residual;
+    }
+
+    // the endpoints minimizing the squared error of the pixels in @mask, @weights are how far each pixel is interpolated toward @out_e1.
+    // false if the weights are all the same, the endpoints can't be told apart then
+    static bool SolveEndpoints(const BlockPixels& block, uint32 num_channels, uint32 mask, const float* weights, float* out_e0, float* out_e1)
+    {
+        float aa = 0.0f;
+        float ab = 0.0f;
+        float bb = 0.0f;
+        float ax[4] = {};
+        float bx[4] = {};
+        for (uint32 i = 0; i < PixelsPerBlock; i++)
+        {
+            if (mask & (1u << i))
+            {
+                float t = weights[i];
+                float s = 1.0f - t;
+                aa += s * s;
+                ab += s * t;
+                bb += t * t;
+                for (uint32 c = 0; c < num_channels; c++)
+                {
+                    ax[c] += s * block.Channels[c][i];
+                    bx[c] += t * block.Channels[c][i];
+                }
+            }
+        }
+
+        float determinant = aa * bb - ab * ab;
+        if (std::abs(determinant) < 1e-6f)
+        {
+            return false;
+        }
+
+        for (uint32 c = 0; c < num_channels; c++)
+        {
+            out_e0[c] = std::clamp((bb * ax[c] - ab * bx[c]) / determinant, 0.0f, 255.0f);
+            out_e1[c] = std::clamp((aa * bx[c] - ab * ax[c]) / determinant, 0.0f, 255.0f);
+        }
+        return true;
+    }
+
+    static inline uint16 QuantizeRGB565(const float* color)
+    {
+        uint32 r = static_cast<uint32>(std::lround(color[0] * 31.0f / 255.0f));
+        uint32 g = static_cast<uint32>(std::lround(color[1] * 63.0f / 255.0f));
+        uint32 b = static_cast<uint32>(std::lround(color[2] * 31.0f / 255.0f));
+        return static_cast<uint16>((r << 11) | (g << 5) | b);
+    }
+
+    static inline void ExpandRGB565(uint16 color, uint32* out_color)
+    {
+        uint32 r = (color >> 11) & 31;
+        uint32 g = (color >> 5) & 63;
+        uint32 b = color & 31;
+        out_color[0] = (r << 3) | (r >> 2);
+        out_color[1] = (g << 2) | (g >> 4);
+        out_color[2] = (b << 3) | (b >> 2);
+    }
+
+    // move a channel of a 565 color by @step, false if it leaves the range
+    static inline bool StepRGB565(uint16& color, uint32 channel, int32 step)
+    {
+        constexpr uint32 Shifts[3] = { 11, 5, 0 };
+        constexpr int32 Limits[3] = { 31, 63, 31 };
+
+        int32 value = ((color >> Shifts[channel]) & Limits[channel]) + step;
+        if (value < 0 || value > Limits[channel])
+        {
+            return false;
+        }
+
+        color = static_cast<uint16>((color & ~(Limits[channel] << Shifts[channel])) | (value << Shifts[channel]));
+        return true;
+    }
+
+    // the 4 colors of a BC1 color block, in the 3 colors mode the last one is transparent black
+    static void BuildBC1Palette(uint16 color0, uint16 color1, bool four_colors, uint32 (*out_colors)[4])
+    {
+        uint32 c0[3];
+        uint32 c1[3];
+        ExpandRGB565(color0, c0);
+        ExpandRGB565(color1, c1);
+
+        for (uint32 c = 0; c < 3; c++)
+        {
+            out_colors[0][c] = c0[c];
+            out_colors[1][c] = c1[c];
+            out_colors[2][c] = four_colors ? (2 * c0[c] + c1[c]) / 3 : (c0[c] + c1[c]) / 2;
+            out_colors[3][c] = four_colors ? (c0[c] + 2 * c1[c]) / 3 : 0;
+        }
+
+        out_colors[0][3] = out_colors[1][3] = out_colors[2][3] = 255;
+        out_colors[3][3] = four_colors ? 255 : 0;
+    }
+
+    // the weight of the second endpoint of each BC1 index
+    static constexpr float BC1Weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+    static float EvaluateBC1(const BlockPixels& block, uint16 color0, uint16 color1, uint8* out_indices)
+    {
+        uint32 colors[4][4];
+        BuildBC1Palette(color0, color1, true, colors);
+
+        // the same endpoints are written in the 3 colors mode, where only the first color is the same
+        BlockPalette palette;
+        palette.NumColors = color0 == color1 ? 1 : 4;
+        for (uint32 i = 0; i < palette.NumColors; i++)
+        {
+            for (uint32 c = 0; c < 3; c++)
+            {
+                palette.Colors[i][c] = static_cast<float>(colors[i][c]);
+            }
+        }
+        return FindIndices(block, palette, 3, AllPixels, out_indices);
+    }
+
+    // the color block of BC1 and BC3, always in the 4 colors mode, so BC1 is opaque
+    static void EncodeBC1Color(const BlockPixels& block, EBlockQuality quality, uint8* out_block)
+    {
+        float e0[4];
+        float e1[4];
+        FitEndpoints(block, 3, AllPixels, e0, e1);
+
+        uint16 best_colors[2] = { QuantizeRGB565(e1), QuantizeRGB565(e0) };
+        uint8 best_indices[PixelsPerBlock];
+        float best_error = EvaluateBC1(block, best_colors[0], best_colors[1], best_indices);
+
+        auto try_colors = [&](uint16 color0, uint16 color1)
+        {
+            uint8 indices[PixelsPerBlock];
+            float error = EvaluateBC1(block, color0, color1, indices);
+            if (error < best_error)
+            {
+                best_error = error;
+                best_colors[0] = color0;
+                best_colors[1] = color1;
+                memcpy(best_indices, indices, PixelsPerBlock);
+                return true;
+            }
+            return false;
+        };
+
+        // least squares on the indices of the best endpoints so far
+        uint32 num_refinements = quality == EBlockQuality_Fast ? 0 : (quality == EBlockQuality_Normal ? 2 : 4);
+        for (uint32 i = 0; i < num_refinements && best_error > 0.0f; i++)
+        {
+            float weights[PixelsPerBlock];
+            for (uint32 p = 0; p < PixelsPerBlock; p++)
+            {
+                weights[p] = BC1Weights[best_indices[p]];
+            }
+
+            if (!SolveEndpoints(block, 3, AllPixels, weights, e0, e1) || !try_colors(QuantizeRGB565(e0), QuantizeRGB565(e1)))
+            {
+                break;
+            }
+        }
+
+        // then the neighbouring endpoints one channel at a time, which also splits the flat blocks between two close colors
+        uint32 num_rounds = quality == EBlockQuality_Fast ? 0 : (quality == EBlockQuality_Normal ? 2 : 16);
+        for (uint32 round = 0; round < num_rounds && best_error > 0.0f; round++)
+        {
+            bool improved = false;
+            for (uint32 component = 0; component < 6; component++)
+            {
+                for (int32 step : { -1, 1 })
+                {
+                    uint16 colors[2] = { best_colors[0], best_colors[1] };
+                    if (StepRGB565(colors[component / 3], component % 3, step))
+                    {
+                        improved |= try_colors(colors[0], colors[1]);
+                    }
+                }
+            }
+
+            if (!improved)
+            {
+                break;
+            }
+        }
+
+        // the 4 colors mode takes the greater endpoint first, swapping them swaps the indices 0 and 1, and 2 and 3
+        if (best_colors[0] < best_colors[1])
+        {
+            std::swap(best_colors[0], best_colors[1]);
+            for (uint32 p = 0; p < PixelsPerBlock; p++)
+            {
+                best_indices[p] ^= 1;
+            }
+        }
+        else if (best_colors[0] == best_colors[1])
+        {
+            memset(best_indices, 0, PixelsPerBlock);
+        }
+
+        uint32 bits = 0;
+        for (uint32 p = 0; p < PixelsPerBlock; p++)
+        {
+            bits |= static_cast<uint32>(best_indices[p]) << (2 * p);
+        }
+
+        memcpy(out_block, &best_colors[0], 2);
+        memcpy(out_block + 2, &best_colors[1], 2);
+        memcpy(out_block + 4, &bits, 4);
+    }
+
+    static void DecodeBC1Color(const uint8* block, bool force_four_colors, uint8* out_pixels)
+    {
+        uint16 color0;
+        uint16 color1;
+        uint32 bits;
+        memcpy(&color0, block, 2);
+        memcpy(&color1, block + 2, 2);
+        memcpy(&bits, block + 4, 4);
+
+        uint32 colors[4][4];
+        BuildBC1Palette(color0, color1, force_four_colors || color0 > color1, colors);
+        for (uint32 p = 0; p < PixelsPerBlock; p++)
+        {
+            uint32 index = (bits >> (2 * p)) & 3;
+            for (uint32 c = 0; c < 4; c++)
+            {
+                out_pixels[p * 4 + c] = static_cast<uint8>(colors[index][c]);
+            }
+        }
+    }
+
+    // the 8 values of a BC4 block, in the 6 values mode the last two are 0 and 255
+    static void BuildBC4Palette(uint32 value0, uint32 value1, uint32* out_values)
+    {
+        out_values[0] = value0;
+        out_values[1] = value1;
+        if (value0 > value1)
+        {
+            for (uint32 i = 2; i < 8; i++)
+            {
+                out_values[i] = ((8 - i) * value0 + (i - 1) * value1 + 3) / 7;
+            }
+        }
+        else
+        {
+            for (uint32 i = 2; i < 6; i++)
+            {
+                out_values[i] = ((6 - i) * value0 + (i - 1) * value1 + 2) / 5;
+            }
+            out_values[6] = 0;
+            out_values[7] = 255;
+        }
+    }
+
+    static uint32 EvaluateBC4(const uint8* values, uint32 value0, uint32 value1, uint8* out_indices)
+    {
+        uint32 palette[8];
+        BuildBC4Palette(value0, value1, palette);
+
+        uint32 error = 0;
+        for (uint32 p = 0; p < PixelsPerBlock; p++)
+        {
+            uint32 best_distance = std::numeric_limits<uint32>::max();
+            for (uint32 i = 0; i < 8; i++)
+            {
+                int32 d = static_cast<int32>(values[p]) - static_cast<int32>(palette[i]);
+                if (static_cast<uint32>(d * d) < best_distance)
+                {
+                    best_distance = d * d;
+                    out_indices[p] = static_cast<uint8>(i);
+                }
+            }
+            error += best_distance;
+        }
+        return error;
+    }
+
+    static void EncodeBC4(const uint8* values, EBlockQuality quality, uint8* out_block)
+    {
+        int32 min_value = 255;
+        int32 max_value = 0;
+        int32 inner_min = 255;
+        int32 inner_max = 0;
+        for (uint32 p = 0; p < PixelsPerBlock; p++)
+        {
+            min_value = std::min<int32>(min_value, values[p]);
+            max_value = std::max<int32>(max_value, values[p]);
+            if (values[p] != 0 && values[p] != 255)
+            {
+                inner_min = std::min<int32>(inner_min, values[p]);
+                inner_max = std::max<int32>(inner_max, values[p]);
+            }
+        }
+
+        uint32 best_values[2] = { static_cast<uint32>(max_value), static_cast<uint32>(min_value) };
+        uint8 best_indices[PixelsPerBlock];
+        uint32 best_error = EvaluateBC4(values, best_values[0], best_values[1], best_indices);
+
+        auto try_values = [&](int32 value0, int32 value1)
+        {
+            uint8 indices[PixelsPerBlock];
+            uint32 error = EvaluateBC4(values, value0, value1, indices);
+            if (error < best_error)
+            {
+                best_error = error;
+                best_values[0] = value0;
+                best_values[1] = value1;
+                memcpy(best_indices, indices, PixelsPerBlock);
+            }
+        };
+
+        if (quality != EBlockQuality_Fast && best_error > 0)
+        {
+            // the endpoints inset into the range, in the 8 values mode, and around the values between 0 and 255 in the 6 values mode
+            int32 radius = quality == EBlockQuality_Normal ? 1 : 3;
+            for (int32 d0 = -radius; d0 <= radius; d0++)
+            {
+                for (int32 d1 = -radius; d1 <= radius; d1++)
+                {
+                    int32 value0 = std::clamp(max_value + d0, 0, 255);
+                    int32 value1 = std::clamp(min_value + d1, 0, 255);
+                    if (value0 > value1)
+                    {
+                        try_values(value0, value1);
+                    }
+
+                    if (inner_min <= inner_max)
+                    {
+                        value0 = std::clamp(inner_min + d0, 0, 255);
+                        value1 = std::clamp(inner_max + d1, 0, 255);
+                        if (value0 <= value1)
+                        {
+                            try_values(value0, value1);
+                        }
+                    }
+                }
+            }
+        }
+
+        uint64 bits = 0;
+        for (uint32 p = 0; p < PixelsPerBlock; p++)
+        {
+            bits |= static_cast<uint64>(best_indices[p]) << (3 * p);
+        }
+
+        out_block[0] = static_cast<uint8>(best_values[0]);
+        out_block[1] = static_cast<uint8>(best_values[1]);
+        for (uint32 i = 0; i < 6; i++)
+        {
+            out_block[2 + i] = static_cast<uint8>(bits >> (8 * i));
+        }
+    }
+
+    // decode into @out_values with a stride of a pixel
+    static void DecodeBC4(const uint8* block, uint8* out_values)
+    {
+        uint32 palette[8];
+        BuildBC4Palette(block[0], block[1], palette);
+
+        uint64 bits = 0;
+        for (uint32 i = 0; i < 6; i++)
+        {
+            bits |= static_cast<uint64>(block[2 + i]) << (8 * i);
+        }
+
+        for (uint32 p = 0; p < PixelsPerBlock; p++)
+        {
+            out_values[p * 4] = static_cast<uint8>(palette[(bits >> (3 * p)) & 7]);
+        }
+    }
+
+    // the endpoint values of a BC7 mode 6 block are 7 bits and a p bit, so 8 bits with the p bit at the bottom
+    static void QuantizeMode6(const float* endpoint, uint32 p_bit, uint32* out_values)
+    {
+        for (uint32 c = 0; c < 4; c++)
+        {
+            int32 value = static_cast<int32>(std::lround((endpoint[c] - p_bit) * 0.5f));
+            out_values[c] = std::clamp(value, 0, 127) * 2 + p_bit;
+        }
+    }
+
+    static float QuantizationError(const float* endpoint, const uint32* values, uint32 num_channels)
+    {
+        float error = 0.0f;
+        for (uint32 c = 0; c < num_channels; c++)
+        {
+            error += (endpoint[c] - values[c]) * (endpoint[c] - values[c]);
+        }
+        return error;
+    }
+
+    struct BC7Mode6Block
+    {
+        uint32 Endpoints[2][4];
+        uint8 Indices[PixelsPerBlock];
+        float Error = FLT_MAX;
+    };
+
+    static float EvaluateMode6(const BlockPixels& block, const uint32 (*endpoints)[4], uint8* out_indices)
+    {
+        BlockPalette palette;
+        palette.NumColors = 16;
+        for (uint32 i = 0; i < 16; i++)
+        {
+            for (uint32 c = 0; c < 4; c++)
+            {
+                palette.Colors[i][c] = static_cast<float>(BC7Interpolate(endpoints[0][c], endpoints[1][c], BC7Weights4[i]));
+            }
+        }
+        return FindIndices(block, palette, 4, AllPixels, out_indices);
+    }
+
+    static bool TryMode6(const BlockPixels& block, const float* e0, const float* e1, EBlockQuality quality, BC7Mode6Block& best)
+    {
+        // the fast quality takes the nearest p bit of each endpoint, the others try the 4 of them
+        uint32 p_bits[2][2] = { { 0, 1 }, { 0, 1 } };
+        uint32 num_p_bits = 2;
+        if (quality == EBlockQuality_Fast)
+        {
+            for (uint32 e = 0; e < 2; e++)
+            {
+                const float* endpoint = e == 0 ? e0 : e1;
+                uint32 values[2][4];
+                QuantizeMode6(endpoint, 0, values[0]);
+                QuantizeMode6(endpoint, 1, values[1]);
+                p_bits[e][0] = QuantizationError(endpoint, values[0], 4) <= QuantizationError(endpoint, values[1], 4) ? 0 : 1;
+            }
+            num_p_bits = 1;
+        }
+
+        bool improved = false;
+        for (uint32 i = 0; i < num_p_bits; i++)
+        {
+            for (uint32 j = 0; j < num_p_bits; j++)
+            {
+                BC7Mode6Block candidate;
+                QuantizeMode6(e0, p_bits[0][i], candidate.Endpoints[0]);
+                QuantizeMode6(e1, p_bits[1][j], candidate.Endpoints[1]);
+                candidate.Error = EvaluateMode6(block, candidate.Endpoints, candidate.Indices);
+                if (candidate.Error < best.Error)
+                {
+                    best = candidate;
+                    improved = true;
+                }
+            }
+        }
+        return improved;
+    }
+
+    // one subset of rgba, 7 bits endpoints with a p bit each and 4 bits indices
+    static float EncodeBC7Mode6(const BlockPixels& block, EBlockQuality quality, uint8* out_block)
+    {
+        float e0[4];
+        float e1[4];
+        FitEndpoints(block, 4, AllPixels, e0, e1);
+
+        BC7Mode6Block best;
+        TryMode6(block, e0, e1, quality, best);
+
+        uint32 num_refinements = quality == EBlockQuality_Fast ? 0 : (quality == EBlockQuality_Normal ? 2 : 4);
+        for (uint32 i = 0; i < num_refinements && best.Error > 0.0f; i++)
+        {
+            float weights[PixelsPerBlock];
+            for (uint32 p = 0; p < PixelsPerBlock; p++)
+            {
+                weights[p] = BC7Weights4[best.Indices[p]] / 64.0f;
+            }
+
+            if (!SolveEndpoints(block, 4, AllPixels, weights, e0, e1) || !TryMode6(block, e0, e1, quality, best))
+            {
+                break;
+            }
+        }
+
+        // the highest bit of the first index is implied to be 0
+        if (best.Indices[0] & 8)
+        {
+            std::swap(best.Endpoints[0], best.Endpoints[1]);
+            for (uint32 p = 0; p < PixelsPerBlock; p++)
+            {
+                best.Indices[p] = 15 - best.Indices[p];
+            }
+        }
+
+        BlockBitWriter writer(out_block);
+        writer.Write(1 << 6, 7);
+        for (uint32 c = 0; c < 4; c++)
+        {
+            writer.Write(best.Endpoints[0][c] >> 1, 7);
+            writer.Write(best.Endpoints[1][c] >> 1, 7);
+        }
+        writer.Write(best.Endpoints[0][0] & 1, 1);
+        writer.Write(best.Endpoints[1][0] & 1, 1);
+        for (uint32 p = 0; p < PixelsPerBlock; p++)
+        {
+            writer.Write(best.Indices[p], p == 0 ? 3 : 4);
+        }
+        return best.Error;
+    }
+
+    // the endpoint values of a BC7 mode 1 block are 6 bits and a p bit shared by the subset, 7 bits with the p bit at the bottom
+    static void QuantizeMode1(const float* endpoint, uint32 p_bit, uint32* out_values)
+    {
+        for (uint32 c = 0; c < 3; c++)
+        {
+            // the nearest of the 3 closest codes once expanded to 8 bits
+            int32 center = static_cast<int32>(std::lround((endpoint[c] * 127.0f / 255.0f - p_bit) * 0.5f));
+            float best_distance = FLT_MAX;
+            for (int32 code = std::max(center - 1, 0); code <= std::min(center + 1, 63); code++)
+            {
+                uint32 value = code * 2 + p_bit;
+                float distance = std::abs(static_cast<float>(ExpandBits(value, 7)) - endpoint[c]);
+                if (distance < best_distance)
+                {
+                    best_distance = distance;
+                    out_values[c] = value;
+                }
+            }
+        }
+    }
+
+    struct BC7Mode1Block
+    {
+        uint32 Partition = 0;
+        uint32 Endpoints[2][2][3];  // subset, endpoint, channel
+        uint8 Indices[PixelsPerBlock];
+        float Error = FLT_MAX;
+    };
+
+    struct BC7Mode1Subset
+    {
+        uint32 Endpoints[2][3];
+        uint8 Indices[PixelsPerBlock];
+        float Error = FLT_MAX;
+    };
+
+    static bool TryMode1Subset(const BlockPixels& block, uint32 mask, const float* e0, const float* e1, BC7Mode1Subset& best)
+    {
+        bool improved = false;
+        for (uint32 p_bit = 0; p_bit < 2; p_bit++)
+        {
+            BC7Mode1Subset candidate;
+            QuantizeMode1(e0, p_bit, candidate.Endpoints[0]);
+            QuantizeMode1(e1, p_bit, candidate.Endpoints[1]);
+
+            BlockPalette palette;
+            palette.NumColors = 8;
+            for (uint32 i = 0; i < 8; i++)
+            {
+                for (uint32 c = 0; c < 3; c++)
+                {
+                    palette.Colors[i][c] = static_cast<float>(BC7Interpolate(ExpandBits(candidate.Endpoints[0][c], 7), ExpandBits(candidate.Endpoints[1][c], 7), BC7Weights3[i]));
+                }
+            }
+
+            candidate.Error = FindIndices(block, palette, 3, mask, candidate.Indices);
+            if (candidate.Error < best.Error)
+            {
+                best = candidate;
+                improved = true;
+            }
+        }
+        return improved;
+    }
+
+    static void EncodeMode1Partition(const BlockPixels& block, uint32 partition, EBlockQuality quality, BC7Mode1Block& out_block)
+    {
+        out_block.Partition = partition;
+        out_block.Error = 0.0f;
+
+        uint32 num_refinements = quality == EBlockQuality_Normal ? 1 : 3;
+        for (uint32 subset = 0; subset < 2; subset++)
+        {
+            uint32 mask = SubsetMask(partition, subset);
+
+            float e0[4];
+            float e1[4];
+            FitEndpoints(block, 3, mask, e0, e1);
+
+            BC7Mode1Subset best;
+            TryMode1Subset(block, mask, e0, e1, best);
+            for (uint32 i = 0; i < num_refinements && best.Error > 0.0f; i++)
+            {
+                float weights[PixelsPerBlock] = {};
+                for (uint32 p = 0; p < PixelsPerBlock; p++)
+                {
+                    if (mask & (1u << p))
+                    {
+                        weights[p] = BC7Weights3[best.Indices[p]] / 64.0f;
+                    }
+                }
+
+                if (!SolveEndpoints(block, 3, mask, weights, e0, e1) || !TryMode1Subset(block, mask, e0, e1, best))
+                {
+                    break;
+                }
+            }
+
+            memcpy(out_block.Endpoints[subset], best.Endpoints, sizeof(best.Endpoints));
+            for (uint32 p = 0; p < PixelsPerBlock; p++)
+            {
+                if (mask & (1u << p))
+                {
+                    out_block.Indices[p] = best.Indices[p];
+                }
+            }
+            out_block.Error += best.Error;
+        }
+    }
+
+    // two subsets of opaque rgb, 6 bits endpoints with a p bit shared by each subset and 3 bits indices. the partitions are ranked by how
+    // far their subsets are from a line, then the most promising ones are encoded
+    static float EncodeBC7Mode1(const BlockPixels& block, EBlockQuality quality, uint8* out_block)
+    {
+        constexpr uint32 NumPartitions = 64;
+
+        std::pair<float, uint32> ranks[NumPartitions];
+        for (uint32 partition = 0; partition < NumPartitions; partition++)
+        {
+            ranks[partition] = { LineResidual(block, 3, SubsetMask(partition, 0)) + LineResidual(block, 3, SubsetMask(partition, 1)), partition };
+        }
+
+        uint32 num_candidates = quality == EBlockQuality_Slow ? NumPartitions : 4;
+        std::partial_sort(ranks, ranks + num_candidates, ranks + NumPartitions);
+
+        BC7Mode1Block best;
+        for (uint32 i = 0; i < num_candidates; i++)
+        {
+            BC7Mode1Block candidate;
+            EncodeMode1Partition(block, ranks[i].second, quality, candidate);
+            if (candidate.Error < best.Error)
+            {
+                best = candidate;
+            }
+        }
+
+        // the highest bit of the index of each anchor is implied to be 0
+        uint16 subsets = BC7Partitions2[best.Partition];
+        uint32 anchors[2] = { 0, BC7Anchors2[best.Partition] };
+        for (uint32 subset = 0; subset < 2; subset++)
+        {
+            if (best.Indices[anchors[subset]] & 4)
+            {
+                std::swap(best.Endpoints[subset][0], best.Endpoints[subset][1]);
+                for (uint32 p = 0; p < PixelsPerBlock; p++)
+                {
+                    if (((subsets >> p) & 1) == subset)
+                    {
+                        best.Indices[p] = 7 - best.Indices[p];
+                    }
+                }
+            }
+        }
+
+        BlockBitWriter writer(out_block);
+        writer.Write(1 << 1, 2);
+        writer.Write(best.Partition, 6);
+        for (uint32 c = 0; c < 3; c++)
+        {
+            for (uint32 subset = 0; subset < 2; subset++)
+            {
+                writer.Write(best.Endpoints[subset][0][c] >> 1, 6);
+                writer.Write(best.Endpoints[subset][1][c] >> 1, 6);
+            }
+        }
+        writer.Write(best.Endpoints[0][0][0] & 1, 1);
+        writer.Write(best.Endpoints[1][0][0] & 1, 1);
+        for (uint32 p = 0; p < PixelsPerBlock; p++)
+        {
+            writer.Write(best.Indices[p], p == anchors[0] || p == anchors[1] ? 2 : 3);
+        }
+        return best.Error;
+    }
+
+    static void EncodeBC7(const BlockPixels& block, EBlockQuality quality, uint8* out_block)
+    {
+        float error = EncodeBC7Mode6(block, quality, out_block);
+        if (quality == EBlockQuality_Fast || error <= 0.0f)
+        {
+            return;
+        }
+
+        // mode 1 leaves the alpha out, it's the better fit for the opaque blocks of two colors
+        for (uint32 p = 0; p < PixelsPerBlock; p++)
+        {
+            if (block.Channels[3][p] != 255.0f)
+            {
+                return;
+            }
+        }
+
+        uint8 mode1_block[16];
+        if (EncodeBC7Mode1(block, quality, mode1_block) < error)
+        {
+            memcpy(out_block, mode1_block, 16);
+        }
+    }
+
+    static bool DecodeBC7(const uint8* block, uint8* out_pixels)
+    {
+        uint32 mode = 0;
+        while (mode < 8 && (block[0] & (1u << mode)) == 0)
+        {
+            mode++;
+        }
+
+        // the reserved mode, and the three subsets modes whose partitions aren't tabled here
+        if (mode == 8 || BC7Modes[mode].NumSubsets == 3)
+        {
+            memset(out_pixels, 0, PixelsPerBlock * 4);
+            return false;
+        }
+
+        const BC7ModeInfo& info = BC7Modes[mode];
+        BlockBitReader reader(block);
+        reader.Read(mode + 1);
+        uint32 partition = reader.Read(info.PartitionBits);
+        uint32 rotation = reader.Read(info.RotationBits);
+        uint32 index_selection = reader.Read(info.IndexSelectionBits);
+
+        uint32 num_endpoints = info.NumSubsets * 2;
+        uint32 endpoints[4][4];
+        for (uint32 c = 0; c < 3; c++)
+        {
+            for (uint32 e = 0; e < num_endpoints; e++)
+            {
+                endpoints[e][c] = reader.Read(info.ColorBits);
+            }
+        }
+        for (uint32 e = 0; e < num_endpoints; e++)
+        {
+            endpoints[e][3] = info.AlphaBits > 0 ? reader.Read(info.AlphaBits) : 255;
+        }
+
+        uint32 color_bits = info.ColorBits;
+        uint32 alpha_bits = info.AlphaBits;
+        if (info.EndpointPBits > 0 || info.SharedPBits > 0)
+        {
+            for (uint32 e = 0; e < num_endpoints; e++)
+            {
+                uint32 p_bit = (info.EndpointPBits > 0 || e % 2 == 0) ? reader.Read(1) : 0;
+                if (info.SharedPBits > 0 && e % 2 == 1)
+                {
+                    p_bit = endpoints[e - 1][0] & 1;
+                }
+
+                for (uint32 c = 0; c < 4; c++)
+                {
+                    if (c < 3 || alpha_bits > 0)
+                    {
+                        endpoints[e][c] = (endpoints[e][c] << 1) | p_bit;
+                    }
+                }
+            }
+            color_bits++;
+            alpha_bits += alpha_bits > 0 ? 1 : 0;
+        }
+
+        for (uint32 e = 0; e < num_endpoints; e++)
+        {
+            for (uint32 c = 0; c < 3; c++)
+            {
+                endpoints[e][c] = ExpandBits(endpoints[e][c], color_bits);
+            }
+            if (alpha_bits > 0)
+            {
+                endpoints[e][3] = ExpandBits(endpoints[e][3], alpha_bits);
+            }
+        }
+
+        uint16 subsets = info.NumSubsets == 2 ? BC7Partitions2[partition] : 0;
+        uint32 anchor = info.NumSubsets == 2 ? BC7Anchors2[partition] : 0;
+        uint32 indices[PixelsPerBlock];
+        uint32 secondary_indices[PixelsPerBlock] = {};
+        for (uint32 p = 0; p < PixelsPerBlock; p++)
+        {
+            indices[p] = reader.Read(info.IndexBits - (p == 0 || p == anchor ? 1 : 0));
+        }
+        if (info.SecondaryIndexBits > 0)
+        {
+            for (uint32 p = 0; p < PixelsPerBlock; p++)
+            {
+                secondary_indices[p] = reader.Read(info.SecondaryIndexBits - (p == 0 ? 1 : 0));
+            }
+        }
+
+        // with two index sets the color takes the primary one unless the index selection bit swaps them
+        const uint8* color_weights = BC7Weights(info.IndexBits);
+        const uint8* alpha_weights = BC7Weights(info.SecondaryIndexBits > 0 ? info.SecondaryIndexBits : info.IndexBits);
+        const uint32* color_indices = indices;
+        const uint32* alpha_indices = info.SecondaryIndexBits > 0 ? secondary_indices : indices;
+        if (index_selection)
+        {
+            std::swap(color_weights, alpha_weights);
+            std::swap(color_indices, alpha_indices);
+        }
+
+        for (uint32 p = 0; p < PixelsPerBlock; p++)
+        {
+            uint32 subset = (subsets >> p) & 1;
+            const uint32* e0 = endpoints[subset * 2];
+            const uint32* e1 = endpoints[subset * 2 + 1];
+
+            uint8* pixel = out_pixels + p * 4;
+            for (uint32 c = 0; c < 3; c++)
+            {
+                pixel[c] = static_cast<uint8>(BC7Interpolate(e0[c], e1[c], color_weights[color_indices[p]]));
+            }
+            pixel[3] = static_cast<uint8>(BC7Interpolate(e0[3], e1[3], alpha_weights[alpha_indices[p]]));
+
+            if (rotation > 0)
+            {
+                std::swap(pixel[3], pixel[rotation - 1]);
+            }
+        }
+        return true;
+    }
+
+    // the half floats of BC6H UF16 are compared by their bits, which are close to logarithmic, scaled to the range of the ldr formats so the
+    // same fitting helpers take them. the largest is the largest finite half
+    constexpr uint32 BC6HMaxHalf = 0x7BFF;
+    constexpr float BC6HScale = 255.0f / BC6HMaxHalf;
+    constexpr uint16 BC6HOpaqueAlpha = 0x3C00;
+
+    // the unsigned format has no sign, the negatives and nan are 0 and the infinity is the largest half
+    static inline uint32 ClampUF16(uint16 half)
+    {
+        if ((half & 0x8000) || half > 0x7C00)
+        {
+            return 0;
+        }
+        return std::min<uint32>(half, BC6HMaxHalf);
+    }
+
+    static void LoadBC6HBlock(const uint8* pixels, BlockPixels& out_block)
+    {
+        for (uint32 i = 0; i < PixelsPerBlock; i++)
+        {
+            uint16 half[4];
+            memcpy(half, pixels + i * 8, 8);
+            for (uint32 c = 0; c < 3; c++)
+            {
+                out_block.Channels[c][i] = ClampUF16(half[c]) * BC6HScale;
+            }
+            out_block.Channels[3][i] = 0.0f;
+        }
+    }
+
+    // the endpoints, 10 bits in mode 11, are expanded to 16 bits before the interpolation, the ends of the range stay the ends
+    static inline uint32 BC6HUnquantize(uint32 value, uint32 num_bits = 10)
+    {
+        if (num_bits >= 15 || value == 0)
+        {
+            return value;
+        }
+        return value == (1u << num_bits) - 1 ? 0xFFFF : ((value << 16) + 0x8000) >> num_bits;
+    }
+
+    // the interpolated 16 bits are scaled by 31/64 into the bits of a half, 0xFFFF becomes the largest half
+    static inline uint32 BC6HInterpolate(uint32 e0, uint32 e1, uint32 weight)
+    {
+        return (BC7Interpolate(e0, e1, weight) * 31) >> 6;
+    }
+
+    // the nearest of the 3 closest codes once decoded, for each channel of an endpoint in the scaled domain
+    static void QuantizeBC6H(const float* endpoint, uint32* out_values)
+    {
+        for (uint32 c = 0; c < 3; c++)
+        {
+            float half = endpoint[c] / BC6HScale;
+            int32 center = static_cast<int32>(std::lround((half * 64.0f / 31.0f - 32.0f) / 64.0f));
+            float best_distance = FLT_MAX;
+            for (int32 code = std::clamp(center - 1, 0, 1023); code <= std::clamp(center + 1, 0, 1023); code++)
+            {
+                float distance = std::abs(static_cast<float>((BC6HUnquantize(code) * 31) >> 6) - half);
+                if (distance < best_distance)
+                {
+                    best_distance = distance;
+                    out_values[c] = code;
+                }
+            }
+        }
+    }
+
+    struct BC6HBlock
+    {
+        uint32 Endpoints[2][3];
+        uint8 Indices[PixelsPerBlock];
+        float Error = FLT_MAX;
+    };
+
+    static void BuildBC6HPalette(const uint32 (*endpoints)[3], BlockPalette& out_palette)
+    {
+        out_palette.NumColors = 16;
+        for (uint32 c = 0; c < 3; c++)
+        {
+            uint32 e0 = BC6HUnquantize(endpoints[0][c]);
+            uint32 e1 = BC6HUnquantize(endpoints[1][c]);
+            for (uint32 i = 0; i < 16; i++)
+            {
+                out_palette.Colors[i][c] = BC6HInterpolate(e0, e1, BC7Weights4[i]) * BC6HScale;
+            }
+        }
+    }
+
+    // the fast quality projects the pixels on the line between the decoded endpoints and takes the nearest weight, instead of measuring the
+    // distance to every color of the palette
+    static void ProjectBC6H(const BlockPixels& block, const uint32 (*endpoints)[3], uint8* out_indices)
+    {
+        BlockPalette palette;
+        BuildBC6HPalette(endpoints, palette);
+
+        float axis[3];
+        float length = 0.0f;
+        for (uint32 c = 0; c < 3; c++)
+        {
+            axis[c] = palette.Colors[15][c] - palette.Colors[0][c];
+            length += axis[c] * axis[c];
+        }
+
+        if (length <= 0.0f)
+        {
+            memset(out_indices, 0, PixelsPerBlock);
+            return;
+        }
+
+        for (uint32 p = 0; p < PixelsPerBlock; p++)
+        {
+            float t = 0.0f;
+            for (uint32 c = 0; c < 3; c++)
+            {
+                t += (block.Channels[c][p] - palette.Colors[0][c]) * axis[c];
+            }
+            float weight = std::clamp(t / length, 0.0f, 1.0f) * 64.0f;
+
+            // the weights are nearly uniform, the nearest one is next to the rounded one
+            int32 center = static_cast<int32>(std::lround(weight * 15.0f / 64.0f));
+            uint32 index = center;
+            for (int32 i = std::max(center - 1, 0); i <= std::min(center + 1, 15); i++)
+            {
+                index = std::abs(BC7Weights4[i] - weight) < std::abs(BC7Weights4[index] - weight) ? i : index;
+            }
+            out_indices[p] = static_cast<uint8>(index);
+        }
+    }
+
+    static bool TryBC6H(const BlockPixels& block, const uint32 (*endpoints)[3], BC6HBlock& best)
+    {
+        BlockPalette palette;
+        BuildBC6HPalette(endpoints, palette);
+
+        BC6HBlock candidate;
+        memcpy(candidate.Endpoints, endpoints, sizeof(candidate.Endpoints));
+        candidate.Error = FindIndices(block, palette, 3, AllPixels, candidate.Indices);
+        if (candidate.Error < best.Error)
+        {
+            best = candidate;
+            return true;
+        }
+        return false;
+    }
+
+    // one region of unsigned rgb in mode 11, 10 bits endpoints without the delta transform and 4 bits indices
+    // ref: https://learn.microsoft.com/en-us/windows/win32/direct3d11/bc6h-format
+    static void EncodeBC6H(const BlockPixels& block, EBlockQuality quality, uint8* out_block)
+    {
+        float e0[4];
+        float e1[4];
+        FitEndpoints(block, 3, AllPixels, e0, e1);
+
+        BC6HBlock best;
+        QuantizeBC6H(e0, best.Endpoints[0]);
+        QuantizeBC6H(e1, best.Endpoints[1]);
+
+        if (quality == EBlockQuality_Fast)
+        {
+            ProjectBC6H(block, best.Endpoints, best.Indices);
+        }
+        else
+        {
+            uint32 endpoints[2][3];
+            memcpy(endpoints, best.Endpoints, sizeof(endpoints));
+            TryBC6H(block, endpoints, best);
+
+            uint32 num_refinements = quality == EBlockQuality_Normal ? 2 : 4;
+            for (uint32 i = 0; i < num_refinements && best.Error > 0.0f; i++)
+            {
+                float weights[PixelsPerBlock];
+                for (uint32 p = 0; p < PixelsPerBlock; p++)
+                {
+                    weights[p] = BC7Weights4[best.Indices[p]] / 64.0f;
+                }
+
+                if (!SolveEndpoints(block, 3, AllPixels, weights, e0, e1))
+                {
+                    break;
+                }
+
+                QuantizeBC6H(e0, endpoints[0]);
+                QuantizeBC6H(e1, endpoints[1]);
+                if (!TryBC6H(block, endpoints, best))
+                {
+                    break;
+                }
+            }
+
+            // then the neighbouring codes one channel at a time
+            uint32 num_rounds = quality == EBlockQuality_Normal ? 0 : 8;
+            for (uint32 round = 0; round < num_rounds && best.Error > 0.0f; round++)
+            {
+                bool improved = false;
+                for (uint32 component = 0; component < 6; component++)
+                {
+                    for (int32 step : { -1, 1 })
+                    {
+                        memcpy(endpoints, best.Endpoints, sizeof(endpoints));
+                        int32 value = static_cast<int32>(endpoints[component / 3][component % 3]) + step;
+                        if (value >= 0 && value <= 1023)
+                        {
+                            endpoints[component / 3][component % 3] = value;
+                            improved |= TryBC6H(block, endpoints, best);
+                        }
+                    }
+                }
+
+                if (!improved)
+                {
+                    break;
+                }
+            }
+        }
+
+        // the highest bit of the first index is implied to be 0
+        if (best.Indices[0] & 8)
+        {
+            std::swap(best.Endpoints[0], best.Endpoints[1]);
+            for (uint32 p = 0; p < PixelsPerBlock; p++)
+            {
+                best.Indices[p] = 15 - best.Indices[p];
+            }
+        }
+
+        BlockBitWriter writer(out_block);
+        writer.Write(0x03, 5);
+        for (uint32 e = 0; e < 2; e++)
+        {
+            for (uint32 c = 0; c < 3; c++)
+            {
+                writer.Write(best.Endpoints[e][c], 10);
+            }
+        }
+        for (uint32 p = 0; p < PixelsPerBlock; p++)
+        {
+            writer.Write(best.Indices[p], p == 0 ? 3 : 4);
+        }
+    }
+
+    // the endpoints of the BC6H header, w and x are the ends of the first region, y and z the ones of the second
+    enum EBC6HField : uint8
+    {
+        RW, GW, BW,
+        RX, GX, BX,
+        RY, GY, BY,
+        RZ, GZ, BZ,
+    };
+
+    // @NumBits bits of the header, the lowest first, from bit @Shift of @Field. the fields spread over the header out of order
+    struct BC6HBitRun
+    {
+        uint8 Field;
+        uint8 Shift;
+        uint8 NumBits;
+    };
+
+    // the endpoints after the first are deltas of @DeltaBits when @Transformed, the header ends at the first empty run
+    // ref: https://learn.microsoft.com/en-us/windows/win32/direct3d11/bc6h-format
+    struct BC6HModeInfo
+    {
+        uint8 NumRegions;
+        bool Transformed;
+        uint8 EndpointBits;
+        uint8 DeltaBits[3];
+        BC6HBitRun Runs[25];
+    };
+
+    // the modes 1 to 14 of the reference, after their 2 or 5 bits code
+    static constexpr BC6HModeInfo BC6HModes[14] =
+    {
+        { 2, true, 10, { 5, 5, 5 }, {
+            { GY, 4, 1 }, { BY, 4, 1 }, { BZ, 4, 1 }, { RW, 0, 10 }, { GW, 0, 10 }, { BW, 0, 10 }, { RX, 0, 5 }, { GZ, 4, 1 }, { GY, 0, 4 },
+            { GX, 0, 5 }, { BZ, 0, 1 }, { GZ, 0, 4 }, { BX, 0, 5 }, { BZ, 1, 1 }, { BY, 0, 4 }, { RY, 0, 5 }, { BZ, 2, 1 }, { RZ, 0, 5 },
+            { BZ, 3, 1 } } },
+        { 2, true, 7, { 6, 6, 6 }, {
+            { GY, 5, 1 }, { GZ, 4, 1 }, { GZ, 5, 1 }, { RW, 0, 7 }, { BZ, 0, 1 }, { BZ, 1, 1 }, { BY, 4, 1 }, { GW, 0, 7 }, { BY, 5, 1 },
+            { BZ, 2, 1 }, { GY, 4, 1 }, { BW, 0, 7 }, { BZ, 3, 1 }, { BZ, 5, 1 }, { BZ, 4, 1 }, { RX, 0, 6 }, { GY, 0, 4 }, { GX, 0, 6 },
+            { GZ, 0, 4 }, { BX, 0, 6 }, { BY, 0, 4 }, { RY, 0, 6 }, { RZ, 0, 6 } } },
+        { 2, true, 11, { 5, 4, 4 }, {
+            { RW, 0, 10 }, { GW, 0, 10 }, { BW, 0, 10 }, { RX, 0, 5 }, { RW, 10, 1 }, { GY, 0, 4 }, { GX, 0, 4 }, { GW, 10, 1 }, { BZ, 0, 1 },
+            { GZ, 0, 4 }, { BX, 0, 4 }, { BW, 10, 1 }, { BZ, 1, 1 }, { BY, 0, 4 }, { RY, 0, 5 }, { BZ, 2, 1 }, { RZ, 0, 5 }, { BZ, 3, 1 } } },
+        { 2, true, 11, { 4, 5, 4 }, {
+            { RW, 0, 10 }, { GW, 0, 10 }, { BW, 0, 10 }, { RX, 0, 4 }, { RW, 10, 1 }, { GZ, 4, 1 }, { GY, 0, 4 }, { GX, 0, 5 }, { GW, 10, 1 },
+            { GZ, 0, 4 }, { BX, 0, 4 }, { BW, 10, 1 }, { BZ, 1, 1 }, { BY, 0, 4 }, { RY, 0, 4 }, { BZ, 0, 1 }, { BZ, 2, 1 }, { RZ, 0, 4 },
+            { GY, 4, 1 }, { BZ, 3, 1 } } },
+        { 2, true, 11, { 4, 4, 5 }, {
+            { RW, 0, 10 }, { GW, 0, 10 }, { BW, 0, 10 }, { RX, 0, 4 }, { RW, 10, 1 }, { BY, 4, 1 }, { GY, 0, 4 }, { GX, 0, 4 }, { GW, 10, 1 },
+            { BZ, 0, 1 }, { GZ, 0, 4 }, { BX, 0, 5 }, { BW, 10, 1 }, { BY, 0, 4 }, { RY, 0, 4 }, { BZ, 1, 1 }, { BZ, 2, 1 }, { RZ, 0, 4 },
+            { BZ, 4, 1 }, { BZ, 3, 1 } } },
+        { 2, true, 9, { 5, 5, 5 }, {
+            { RW, 0, 9 }, { BY, 4, 1 }, { GW, 0, 9 }, { GY, 4, 1 }, { BW, 0, 9 }, { BZ, 4, 1 }, { RX, 0, 5 }, { GZ, 4, 1 }, { GY, 0, 4 },
+            { GX, 0, 5 }, { BZ, 0, 1 }, { GZ, 0, 4 }, { BX, 0, 5 }, { BZ, 1, 1 }, { BY, 0, 4 }, { RY, 0, 5 }, { BZ, 2, 1 }, { RZ, 0, 5 },
+            { BZ, 3, 1 } } },
+        { 2, true, 8, { 6, 5, 5 }, {
+            { RW, 0, 8 }, { GZ, 4, 1 }, { BY, 4, 1 }, { GW, 0, 8 }, { BZ, 2, 1 }, { GY, 4, 1 }, { BW, 0, 8 }, { BZ, 3, 1 }, { BZ, 4, 1 },
+            { RX, 0, 6 }, { GY, 0, 4 }, { GX, 0, 5 }, { BZ, 0, 1 }, { GZ, 0, 4 }, { BX, 0, 5 }, { BZ, 1, 1 }, { BY, 0, 4 }, { RY, 0, 6 },
+            { RZ, 0, 6 } } },
+        { 2, true, 8, { 5, 6, 5 }, {
+            { RW, 0, 8 }, { BZ, 0, 1 }, { BY, 4, 1 }, { GW, 0, 8 }, { GY, 5, 1 }, { GY, 4, 1 }, { BW, 0, 8 }, { GZ, 5, 1 }, { BZ, 4, 1 },
+            { RX, 0, 5 }, { GZ, 4, 1 }, { GY, 0, 4 }, { GX, 0, 6 }, { GZ, 0, 4 }, { BX, 0, 5 }, { BZ, 1, 1 }, { BY, 0, 4 }, { RY, 0, 5 },
+            { BZ, 2, 1 }, { RZ, 0, 5 }, { BZ, 3, 1 } } },
+        { 2, true, 8, { 5, 5, 6 }, {
+            { RW, 0, 8 }, { BZ, 1, 1 }, { BY, 4, 1 }, { GW, 0, 8 }, { BY, 5, 1 }, { GY, 4, 1 }, { BW, 0, 8 }, { BZ, 5, 1 }, { BZ, 4, 1 },
+            { RX, 0, 5 }, { GZ, 4, 1 }, { GY, 0, 4 }, { GX, 0, 5 }, { BZ, 0, 1 }, { GZ, 0, 4 }, { BX, 0, 6 }, { BY, 0, 4 }, { RY, 0, 5 },
+            { BZ, 2, 1 }, { RZ, 0, 5 }, { BZ, 3, 1 } } },
+        { 2, false, 6, { 6, 6, 6 }, {
+            { RW, 0, 6 }, { GZ, 4, 1 }, { BZ, 0, 1 }, { BZ, 1, 1 }, { BY, 4, 1 }, { GW, 0, 6 }, { GY, 5, 1 }, { BY, 5, 1 }, { BZ, 2, 1 },
+            { GY, 4, 1 }, { BW, 0, 6 }, { GZ, 5, 1 }, { BZ, 3, 1 }, { BZ, 5, 1 }, { BZ, 4, 1 }, { RX, 0, 6 }, { GY, 0, 4 }, { GX, 0, 6 },
+            { GZ, 0, 4 }, { BX, 0, 6 }, { BY, 0, 4 }, { RY, 0, 6 }, { RZ, 0, 6 } } },
+        { 1, false, 10, { 10, 10, 10 }, {
+            { RW, 0, 10 }, { GW, 0, 10 }, { BW, 0, 10 }, { RX, 0, 10 }, { GX, 0, 10 }, { BX, 0, 10 } } },
+        { 1, true, 11, { 9, 9, 9 }, {
+            { RW, 0, 10 }, { GW, 0, 10 }, { BW, 0, 10 }, { RX, 0, 9 }, { RW, 10, 1 }, { GX, 0, 9 }, { GW, 10, 1 }, { BX, 0, 9 }, { BW, 10, 1 } } },
+        // the highest bits of the first endpoint are reversed in the last two modes
+        { 1, true, 12, { 8, 8, 8 }, {
+            { RW, 0, 10 }, { GW, 0, 10 }, { BW, 0, 10 }, { RX, 0, 8 }, { RW, 11, 1 }, { RW, 10, 1 }, { GX, 0, 8 }, { GW, 11, 1 }, { GW, 10, 1 },
+            { BX, 0, 8 }, { BW, 11, 1 }, { BW, 10, 1 } } },
+        { 1, true, 16, { 4, 4, 4 }, {
+            { RW, 0, 10 }, { GW, 0, 10 }, { BW, 0, 10 }, { RX, 0, 4 }, { RW, 15, 1 }, { RW, 14, 1 }, { RW, 13, 1 }, { RW, 12, 1 }, { RW, 11, 1 },
+            { RW, 10, 1 }, { GX, 0, 4 }, { GW, 15, 1 }, { GW, 14, 1 }, { GW, 13, 1 }, { GW, 12, 1 }, { GW, 11, 1 }, { GW, 10, 1 }, { BX, 0, 4 },
+            { BW, 15, 1 }, { BW, 14, 1 }, { BW, 13, 1 }, { BW, 12, 1 }, { BW, 11, 1 }, { BW, 10, 1 } } },
+    };
+
+    static inline int32 SignExtend(uint32 value, uint32 num_bits)
+    {
+        return static_cast<int32>(value << (32 - num_bits)) >> (32 - num_bits);
+    }
+
+    // the two regions modes take the first 32 partitions of BC7, the reserved modes are decoded as black
+    static bool DecodeBC6H(const uint8* block, uint8* out_pixels)
+    {
+        // the modes 1 and 2 have a 2 bits code, the others 5 bits whose lowest 2 are 10 for the two regions modes and 11 for the one region
+        // ones, which are reserved past mode 14
+        BlockBitReader reader(block);
+        uint32 mode = reader.Read(2);
+        if (mode >= 2)
+        {
+            uint32 code = mode | (reader.Read(3) << 2);
+            mode = (code & 3) == 2 ? 2 + (code >> 2) : 10 + (code >> 2);
+        }
+        if (mode >= 14)
+        {
+            memset(out_pixels, 0, PixelsPerBlock * 8);
+            return false;
+        }
+
+        const BC6HModeInfo& info = BC6HModes[mode];
+        uint32 fields[12] = {};
+        for (const BC6HBitRun& run : info.Runs)
+        {
+            if (run.NumBits == 0)
+            {
+                break;
+            }
+            fields[run.Field] |= reader.Read(run.NumBits) << run.Shift;
+        }
+        uint32 partition = info.NumRegions == 2 ? reader.Read(5) : 0;
+
+        // the deltas are signed even in the unsigned format, the sums wrap around the endpoint bits
+        uint32 num_endpoints = info.NumRegions * 2;
+        uint32 endpoint_mask = (1u << info.EndpointBits) - 1;
+        uint32 endpoints[4][3];
+        for (uint32 e = 0; e < num_endpoints; e++)
+        {
+            for (uint32 c = 0; c < 3; c++)
+            {
+                uint32 value = fields[e * 3 + c];
+                if (info.Transformed && e > 0)
+                {
+                    value = (fields[c] + static_cast<uint32>(SignExtend(value, info.DeltaBits[c]))) & endpoint_mask;
+                }
+                endpoints[e][c] = BC6HUnquantize(value, info.EndpointBits);
+            }
+        }
+
+        uint16 regions = info.NumRegions == 2 ? BC7Partitions2[partition] : 0;
+        uint32 anchor = info.NumRegions == 2 ? BC7Anchors2[partition] : 0;
+        uint32 index_bits = info.NumRegions == 2 ? 3 : 4;
+        const uint8* weights = BC7Weights(index_bits);
+        for (uint32 p = 0; p < PixelsPerBlock; p++)
+        {
+            uint32 index = reader.Read(index_bits - (p == 0 || p == anchor ? 1 : 0));
+            uint32 region = (regions >> p) & 1;
+
+            uint16 half[4];
+            for (uint32 c = 0; c < 3; c++)
+            {
+                half[c] = static_cast<uint16>(BC6HInterpolate(endpoints[region * 2][c], endpoints[region * 2 + 1][c], weights[index]));
+            }
+            half[3] = BC6HOpaqueAlpha;
+            memcpy(out_pixels + p * 8, half, 8);
+        }
+        return true;
+    }
+
+    std::string_view GetBlockFormatName(EBlockFormat format)
+    {
+        switch (format)
+        {
+        case EBlockFormat_BC1:
+            return "BC1";
+        case EBlockFormat_BC3:
+            return "BC3";
+        case EBlockFormat_BC5:
+            return "BC5";
+        case EBlockFormat_BC7:
+            return "BC7";
+        case EBlockFormat_BC6H:
+            return "BC6H";
+        default:
+            return "None";
+        }
+    }
+
+    std::string_view GetBlockQualityName(EBlockQuality quality)
+    {
+        switch (quality)
+        {
+        case EBlockQuality_Fast:
+            return "Fast";
+        case EBlockQuality_Slow:
+            return "Slow";
+        default:
+            return "Normal";
+        }
+    }
+
+    uint32 BlockCompression::BlockSize(EBlockFormat format)
+    {
+        switch (format)
+        {
+        case EBlockFormat_BC1:
+            return 8;
+        case EBlockFormat_BC3:
+        case EBlockFormat_BC5:
+        case EBlockFormat_BC7:
+        case EBlockFormat_BC6H:
+            return 16;
+        default:
+            ASSERT(false);
+            return 0;
+        }
+    }
+
+    uint32 BlockCompression::PixelSize(EBlockFormat format)
+    {
+        return format == EBlockFormat_BC6H ? 8 : 4;
+    }
+
+    // the first block of each mip, and the total number of blocks at the end
+    static std::vector<uint32> MipBlockOffsets(uint32 width, uint32 height, uint32 mip_levels)
+    {
+        std::vector<uint32> offsets(mip_levels + 1, 0);
+        for (uint32 mip = 0; mip < mip_levels; mip++)
+        {
+            uint32 blocks_x = (std::max(width >> mip, 1u) + BlockCompression::BlockDimension - 1) / BlockCompression::BlockDimension;
+            uint32 blocks_y = (std::max(height >> mip, 1u) + BlockCompression::BlockDimension - 1) / BlockCompression::BlockDimension;
+            offsets[mip + 1] = offsets[mip] + blocks_x * blocks_y;
+        }
+        return offsets;
+    }
+
+    // call @func(block, mip_pixels, mip_width, mip_height, x, y) for every block of the mip chain in parallel, the blocks of all the mips are
+    // numbered together so the small mips don't leave the workers idle
+    template<typename Fn>
+    static void ForEachBlock(uint32 width, uint32 height, uint32 mip_levels, Fn func)
+    {
+        std::vector<uint32> block_offsets = MipBlockOffsets(width, height, mip_levels);
+        std::vector<uint32> pixel_offsets(mip_levels, 0);
+        for (uint32 mip = 1; mip < mip_levels; mip++)
+        {
+            pixel_offsets[mip] = pixel_offsets[mip - 1] + std::max(width >> (mip - 1), 1u) * std::max(height >> (mip - 1), 1u);
+        }
+
+        TaskScheduler& scheduler = TaskScheduler::Instance();
+        scheduler.Wait(scheduler.ParallelFor(block_offsets.back(), BlockCompression::BlocksPerJob,
+            [&](uint32 begin, uint32 end)
+            {
+                uint32 mip = static_cast<uint32>(std::upper_bound(block_offsets.begin(), block_offsets.end(), begin) - block_offsets.begin()) - 1;
+                for (uint32 i = begin; i < end; i++)
+                {
+                    while (i >= block_offsets[mip + 1])
+                    {
+                        mip++;
+                    }
+
+                    uint32 mip_width = std::max(width >> mip, 1u);
+                    uint32 mip_height = std::max(height >> mip, 1u);
+                    uint32 blocks_x = (mip_width + BlockCompression::BlockDimension - 1) / BlockCompression::BlockDimension;
+                    uint32 block = i - block_offsets[mip];
+                    func(i, pixel_offsets[mip], mip_width, mip_height, block % blocks_x * BlockCompression::BlockDimension, block / blocks_x * BlockCompression::BlockDimension);
+                }
+            }
+        ));
+    }
+
+    uint32 BlockCompression::EncodedSize(uint32 width, uint32 height, uint32 mip_levels, EBlockFormat format)
+    {
+        return MipBlockOffsets(width, height, mip_levels).back() * BlockSize(format);
+    }
+
+    std::vector<uint8> BlockCompression::Encode(const uint8* pixels, uint32 width, uint32 height, uint32 mip_levels, EBlockFormat format, EBlockQuality quality)
+    {
+        uint32 block_size = BlockSize(format);
+        uint32 pixel_size = PixelSize(format);
+        std::vector<uint8> blocks(EncodedSize(width, height, mip_levels, format));
+
+        ForEachBlock(width, height, mip_levels,
+            [&](uint32 block, uint32 pixel_offset, uint32 mip_width, uint32 mip_height, uint32 x, uint32 y)
+            {
+                // the pixels past the edges of the mip repeat the last row and column
+                uint8 block_pixels[PixelsPerBlock * 8];
+                for (uint32 j = 0; j < BlockDimension; j++)
+                {
+                    for (uint32 i = 0; i < BlockDimension; i++)
+                    {
+                        uint32 source = pixel_offset + std::min(y + j, mip_height - 1) * mip_width + std::min(x + i, mip_width - 1);
+                        memcpy(block_pixels + (j * BlockDimension + i) * pixel_size, pixels + source * pixel_size, pixel_size);
+                    }
+                }
+                EncodeBlock(block_pixels, format, quality, blocks.data() + block * block_size);
+            }
+        );
+        return blocks;
+    }
+
+    bool BlockCompression::Decode(const uint8* blocks, uint32 width, uint32 height, uint32 mip_levels, EBlockFormat format, uint8* out_pixels)
+    {
+        uint32 block_size = BlockSize(format);
+        uint32 pixel_size = PixelSize(format);
+        std::atomic<uint32> num_failed = 0;
+
+        ForEachBlock(width, height, mip_levels,
+            [&](uint32 block, uint32 pixel_offset, uint32 mip_width, uint32 mip_height, uint32 x, uint32 y)
+            {
+                uint8 block_pixels[PixelsPerBlock * 8];
+                if (!DecodeBlock(blocks + block * block_size, format, block_pixels))
+                {
+                    num_failed++;
+                }
+
+                for (uint32 j = 0; j < BlockDimension && y + j < mip_height; j++)
+                {
+                    uint32 num_pixels = std::min(BlockDimension, mip_width - x);
+                    memcpy(out_pixels + (pixel_offset + (y + j) * mip_width + x) * pixel_size, block_pixels + j * BlockDimension * pixel_size, num_pixels * pixel_size);
+                }
+            }
+        );
+        return num_failed == 0;
+    }
+
+    void BlockCompression::EncodeBlock(const uint8* pixels, EBlockFormat format, EBlockQuality quality, uint8* out_block)
+    {
+        switch (format)
+        {
+        case EBlockFormat_BC1:
+        case EBlockFormat_BC3:
+        {
+            BlockPixels block;
+            LoadBlock(pixels, block);
+
+            if (format == EBlockFormat_BC3)
+            {
+                uint8 alpha[PixelsPerBlock];
+                for (uint32 p = 0; p < PixelsPerBlock; p++)
+                {
+                    alpha[p] = pixels[p * 4 + 3];
+                }
+                EncodeBC4(alpha, quality, out_block);
+                out_block += 8;
+            }
+            EncodeBC1Color(block, quality, out_block);
+            break;
+        }
+        case EBlockFormat_BC5:
+        {
+            for (uint32 c = 0; c < 2; c++)
+            {
+                uint8 values[PixelsPerBlock];
+                for (uint32 p = 0; p < PixelsPerBlock; p++)
+                {
+                    values[p] = pixels[p * 4 + c];
+                }
+                EncodeBC4(values, quality, out_block + c * 8);
+            }
+            break;
+        }
+        case EBlockFormat_BC7:
+        {
+            BlockPixels block;
+            LoadBlock(pixels, block);
+            EncodeBC7(block, quality, out_block);
+            break;
+        }
+        case EBlockFormat_BC6H:
+        {
+            BlockPixels block;
+            LoadBC6HBlock(pixels, block);
+            EncodeBC6H(block, quality, out_block);
+            break;
+        }
+        default:
+            ASSERT(false);
+            break;
+        }
+    }
+
+    bool BlockCompression::DecodeBlock(const uint8* block, EBlockFormat format, uint8* out_pixels)
+    {
+        switch (format)
+        {
+        case EBlockFormat_BC1:
+            DecodeBC1Color(block, false, out_pixels);
+            return true;
+        case EBlockFormat_BC3:
+            DecodeBC1Color(block + 8, true, out_pixels);
+            DecodeBC4(block, out_pixels + 3);
+            return true;
+        case EBlockFormat_BC5:
+            DecodeBC4(block, out_pixels);
+            DecodeBC4(block + 8, out_pixels + 1);
+            for (uint32 p = 0; p < PixelsPerBlock; p++)
+            {
+                out_pixels[p * 4 + 2] = 0;
+                out_pixels[p * 4 + 3] = 255;
+            }
+            return true;
+        case EBlockFormat_BC7:
+            return DecodeBC7(block, out_pixels);
+        case EBlockFormat_BC6H:
+            return DecodeBC6H(block, out_pixels);
+        default:
+            ASSERT(false);
+            return false;
+        }
+    }
+
+    double BlockCompression::PSNR(const uint8* a, const uint8* b, uint32 num_pixels, uint32 num_channels)
+    {
+        uint64 sum = 0;
+        for (uint32 p = 0; p < num_pixels; p++)
+        {
+            for (uint32 c = 0; c < num_channels; c++)
+            {
+                int32 d = static_cast<int32>(a[p * 4 + c]) - static_cast<int32>(b[p * 4 + c]);
+                sum += static_cast<uint64>(d * d);
+            }
+        }
+
+        if (sum == 0)
+        {
+            return std::numeric_limits<double>::infinity();
+        }
+
+        double mse = static_cast<double>(sum) / (static_cast<double>(num_pixels) * num_channels);
+        return 10.0 * std::log10(255.0 * 255.0 / mse);
+    }
+}
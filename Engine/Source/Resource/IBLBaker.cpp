@@ -0,0 +1,368 @@
+#include "Resource/IBLBaker.h"
+#include "Utils/MathLib.h"
+#include "Utils/Thread.h"
+
+#include <immintrin.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <format>
+#include <vector>
+
+namespace MRenderer
+{
+    // the faces of the cube map being prefiltered and where their mips begin
+    struct PrefilterSource
+    {
+        std::array<const uint8*, NumCubeMapFaces> Faces;
+        std::vector<uint32> MipOffsets;
+        uint32 Size;
+        uint32 MipLevels;
+        bool Half;
+    };
+
+    // a sample around +z, since n = v when prefiltering, its direction, weight and mip only depend on the roughness
+    struct PrefilterSample
+    {
+        float Direction[3];
+        float Weight;
+        float Lod;
+    };
+
+    // point @i of the @n points of the hammersley sequence, the same as hammersley in brdf.hlsli
+    // ref: https://learnopengl.com/PBR/IBL/Specular-IBL
+    static Vector2 Hammersley(uint32 i, uint32 n)
+    {
+        uint32 bits = i;
+        bits = (bits << 16u) | (bits >> 16u);
+        bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+        bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+        bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+        bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+        return Vector2(static_cast<float>(i) / static_cast<float>(n), static_cast<float>(bits) * 2.3283064365386963e-10f);
+    }
+
+    // the microfacet normal around +z of the ggx distribution for @xi, the same as ggx_important_sample in brdf.hlsli
+    static Vector3 ImportanceSampleGGX(float roughness, const Vector2& xi)
+    {
+        float a = roughness * roughness;
+        float phi = 2 * PI * xi.x;
+        float cos_theta = sqrt((1 - xi.y) / (1 + (a * a - 1) * xi.y));
+        float sin_theta = sqrt(1 - cos_theta * cos_theta);
+        return Vector3(sin_theta * cos(phi), sin_theta * sin(phi), cos_theta);
+    }
+
+    static float DistributionGGX(float n_dot_h, float roughness)
+    {
+        float a = roughness * roughness;
+        float t = n_dot_h * n_dot_h * (a * a - 1) + 1;
+        return a * a / std::max(PI * t * t, 1e-6f);
+    }
+
+    // the incident directions of the ggx lobe and the mips they are read from, by the solid angle a sample covers over the one of a texel
+    // ref: https://developer.nvidia.com/gpugems/gpugems3/part-iii-rendering/chapter-20-gpu-based-importance-sampling section. 20.4
+    static std::vector<PrefilterSample> GeneratePrefilterSamples(float roughness, uint32 sample_count, uint32 source_size, float min_lod)
+    {
+        float texel_solid_angle = 4 * PI / (NumCubeMapFaces * source_size * source_size);
+
+        std::vector<PrefilterSample> samples;
+        for (uint32 i = 0; i < sample_count; i++)
+        {
+            Vector3 h = ImportanceSampleGGX(roughness, Hammersley(i, sample_count));
+
+            // l is v = +z reflected around h
+            float n_dot_l = 2 * h.z * h.z - 1;
+            if (n_dot_l <= 0)
+            {
+                continue;
+            }
+
+            float pdf = DistributionGGX(h.z, roughness) * h.z / (4 * h.z + 0.0001f);
+            float sample_solid_angle = 1.0f / (sample_count * pdf + 0.0001f);
+            float lod = std::max(0.5f * std::log2(sample_solid_angle / texel_solid_angle), min_lod);
+            samples.push_back({ { 2 * h.z * h.x, 2 * h.z * h.y, n_dot_l }, n_dot_l, lod });
+        }
+        return samples;
+    }
+
+    static void LoadTexel(const PrefilterSource& source, const uint8* mip, uint32 index, float* out_color)
+    {
+        if (source.Half)
+        {
+            const uint16* pixel = reinterpret_cast<const uint16*>(mip) + index * 4;
+            for (uint32 c = 0; c < 3; c++)
+            {
+                out_color[c] = HalfToFloat(pixel[c]);
+            }
+            return;
+        }
+
+        const float* pixel = reinterpret_cast<const float*>(mip) + index * 4;
+        for (uint32 c = 0; c < 3; c++)
+        {
+            out_color[c] = pixel[c];
+        }
+    }
+
+    // @out_color += @weight * the bilinear sample of a mip of a face, the texels past the edges of the face repeat the edge ones
+    static void SampleBilinear(const PrefilterSource& source, uint32 face, uint32 mip, float u, float v, float weight, float* out_color)
+    {
+        int32 size = source.Size >> mip;
+        const uint8* pixels = source.Faces[face] + source.MipOffsets[mip];
+
+        float x = u * size - 0.5f;
+        float y = v * size - 0.5f;
+        float floor_x = floor(x);
+        float floor_y = floor(y);
+        float tx = x - floor_x;
+        float ty = y - floor_y;
+
+        int32 x0 = std::clamp(static_cast<int32>(floor_x), 0, size - 1);
+        int32 x1 = std::clamp(static_cast<int32>(floor_x) + 1, 0, size - 1);
+        int32 y0 = std::clamp(static_cast<int32>(floor_y), 0, size - 1);
+        int32 y1 = std::clamp(static_cast<int32>(floor_y) + 1, 0, size - 1);
+
+        const uint32 indices[4] = { static_cast<uint32>(y0 * size + x0), static_cast<uint32>(y0 * size + x1), static_cast<uint32>(y1 * size + x0), static_cast<uint32>(y1 * size + x1) };
+        const float weights[4] = { (1 - tx) * (1 - ty), tx * (1 - ty), (1 - tx) * ty, tx * ty };
+        for (uint32 i = 0; i < 4; i++)
+        {
+            float texel[3];
+            LoadTexel(source, pixels, indices[i], texel);
+            for (uint32 c = 0; c < 3; c++)
+            {
+                out_color[c] += texel[c] * weights[i] * weight;
+            }
+        }
+    }
+
+    // @out_color += @weight * the trilinear sample of the cube map in @dir
+    static void SampleCubeMap(const PrefilterSource& source, const Vector3& dir, float lod, float weight, float* out_color)
+    {
+        uint32 face;
+        Vector2 tc;
+        CalcCubeMapCoordinate(dir, face, tc);
+
+        lod = std::clamp(lod, 0.0f, static_cast<float>(source.MipLevels - 1));
+        uint32 mip = static_cast<uint32>(lod);
+        float t = lod - mip;
+
+        SampleBilinear(source, face, mip, tc.x, tc.y, weight * (1 - t), out_color);
+        if (t > 0)
+        {
+            SampleBilinear(source, face, mip + 1, tc.x, tc.y, weight * t, out_color);
+        }
+    }
+
+    std::string IBLBaker::BakedDataPath(std::string_view cube_map_data_path)
+    {
+        return std::format("{}_ibl", cube_map_data_path);
+    }
+
+    IBLTextureData IBLBaker::Bake(const CubeMapTextureData& cube_map)
+    {
+        IBLTextureData baked;
+        baked.mPrefilteredMap = PrefilterEnvironmentMap(cube_map.Data(), PrefilteredMapSize, PrefilteredMapMipLevels);
+        baked.mBRDFLutInfo = TextureInfo{ .Width = BRDFLutSize, .Height = BRDFLutSize, .Depth = 1, .MipLevels = 1, .Format = ETextureFormat_R16G16_FLOAT };
+        baked.mBRDFLut = IntegrateBRDF(BRDFLutSize);
+        return baked;
+    }
+
+    // the same as env_map_gen.hlsl, but the mirror mip reads the mip of the cube map of its size, and the rougher ones the mips of the
+    // solid angles of the samples against the texels of the cube map, not of the prefiltered one
+    std::array<TextureData, NumCubeMapFaces> IBLBaker::PrefilterEnvironmentMap(const std::array<TextureData, NumCubeMapFaces>& cube_map, uint32 size,
+        uint32 mip_levels, uint32 sample_count)
+    {
+        const TextureData& face_0 = cube_map[0];
+        ASSERT(face_0.Width() == face_0.Height());
+        ASSERT(face_0.Format() == ETextureFormat_R32G32B32A32_FLOAT || face_0.Format() == ETextureFormat_R16G16B16A16_FLOAT);
+
+        PrefilterSource source;
+        source.Size = face_0.Width();
+        source.MipLevels = face_0.MipLevels();
+        source.Half = face_0.Format() == ETextureFormat_R16G16B16A16_FLOAT;
+        for (uint32 face = 0; face < NumCubeMapFaces; face++)
+        {
+            ASSERT(cube_map[face].mInfo == face_0.mInfo);
+            source.Faces[face] = static_cast<const uint8*>(cube_map[face].Data());
+        }
+        for (uint32 mip = 0; mip < source.MipLevels; mip++)
+        {
+            source.MipOffsets.push_back(CalculateMipmapLayout(source.Size, source.Size, source.MipLevels, GetPixelSize(face_0.Format()), mip).BaseOffset);
+        }
+
+        const ETextureFormat format = ETextureFormat_R16G16B16A16_FLOAT;
+        std::array<TextureData, NumCubeMapFaces> prefiltered;
+        for (TextureData& face : prefiltered)
+        {
+            face = TextureData(size, size, mip_levels, format);
+        }
+
+        TaskScheduler& scheduler = TaskScheduler::Instance();
+        for (uint32 mip = 0; mip < mip_levels; mip++)
+        {
+            MipmapLayout layout = CalculateMipmapLayout(size, size, mip_levels, GetPixelSize(format), mip);
+            float roughness = mip_levels > 1 ? static_cast<float>(mip) / static_cast<float>(mip_levels - 1) : 0.0f;
+
+            // the samples don't read the mips finer than the texels they are filtered into
+            float min_lod = std::max(std::log2(static_cast<float>(source.Size) / static_cast<float>(layout.Width)), 0.0f);
+            std::vector<PrefilterSample> samples = GeneratePrefilterSamples(roughness, sample_count, source.Size, min_lod);
+
+            scheduler.Wait(scheduler.ParallelFor(NumCubeMapFaces * layout.Height, RowsPerJob,
+                [&](uint32 begin, uint32 end)
+                {
+                    for (uint32 row = begin; row < end; row++)
+                    {
+                        uint32 face = row / layout.Height;
+                        uint32 y = row % layout.Height;
+                        uint16* pixels = reinterpret_cast<uint16*>(static_cast<uint8*>(prefiltered[face].mData.GetData()) + layout.BaseOffset) + y * layout.Width * 4;
+                        for (uint32 x = 0; x < layout.Width; x++)
+                        {
+                            float u = (2.0f * x + 1) / layout.Width - 1;
+                            float v = (2.0f * y + 1) / layout.Height - 1;
+                            Vector3 n = CalcCubeMapDirection(face, u, v);
+
+                            float color[3] = {};
+                            if (roughness == 0.0f)
+                            {
+                                SampleCubeMap(source, n, min_lod, 1.0f, color);
+                            }
+                            else
+                            {
+                                // the same tangent space as ggx_important_sample in brdf.hlsli
+                                Vector3 up = std::abs(n.z) < 0.999f ? Vector3(0, 0, 1) : Vector3(1, 0, 0);
+                                Vector3 tangent = Vector3(n.y * up.z - n.z * up.y, n.z * up.x - n.x * up.z, n.x * up.y - n.y * up.x).GetNormalized();
+                                Vector3 bitangent(n.y * tangent.z - n.z * tangent.y, n.z * tangent.x - n.x * tangent.z, n.x * tangent.y - n.y * tangent.x);
+
+                                // the n.l weighted average of the samples rather than the plain monte carlo estimate, as the ue4 notes do
+                                float total_weight = 0;
+                                for (const PrefilterSample& sample : samples)
+                                {
+                                    const float* l = sample.Direction;
+                                    Vector3 dir(
+                                        tangent.x * l[0] + bitangent.x * l[1] + n.x * l[2],
+                                        tangent.y * l[0] + bitangent.y * l[1] + n.y * l[2],
+                                        tangent.z * l[0] + bitangent.z * l[1] + n.z * l[2]
+                                    );
+                                    SampleCubeMap(source, dir, sample.Lod, sample.Weight, color);
+                                    total_weight += sample.Weight;
+                                }
+
+                                for (float& channel : color)
+                                {
+                                    channel /= total_weight;
+                                }
+                            }
+
+                            const uint16 pixel[4] = { FloatToHalf(color[0]), FloatToHalf(color[1]), FloatToHalf(color[2]), FloatToHalf(1.0f) };
+                            memcpy(pixels + x * 4, pixel, sizeof(pixel));
+                        }
+                    }
+                }
+            ));
+        }
+        return prefiltered;
+    }
+
+    static float GeometrySchlickGGX(float n_dot_v, float k)
+    {
+        return n_dot_v / std::max(n_dot_v * (1 - k) + k, 1e-6f);
+    }
+
+    // the same as precompute_brdf.hlsl, v is in the xz plane so the samples only need the x and z of their microfacet normals.
+    // a job integrates columns of the lut, which share the microfacet normals of their roughness
+    // ref: https://learnopengl.com/PBR/IBL/Specular-IBL
+    BinaryData IBLBaker::IntegrateBRDF(uint32 size, uint32 sample_count)
+    {
+        BinaryData lut(size * size * 2 * sizeof(uint16));
+        uint16* texels = static_cast<uint16*>(lut.GetData());
+
+        TaskScheduler& scheduler = TaskScheduler::Instance();
+        scheduler.Wait(scheduler.ParallelFor(size, RowsPerJob,
+            [&](uint32 begin, uint32 end)
+            {
+                std::vector<float> hx(sample_count);
+                std::vector<float> hz(sample_count);
+                for (uint32 x = begin; x < end; x++)
+                {
+                    float roughness = static_cast<float>(x) / static_cast<float>(size - 1);
+                    float k = roughness * roughness / 2;
+                    for (uint32 i = 0; i < sample_count; i++)
+                    {
+                        Vector3 h = ImportanceSampleGGX(roughness, Hammersley(i, sample_count));
+                        hx[i] = h.x;
+                        hz[i] = h.z;
+                    }
+
+                    for (uint32 y = 0; y < size; y++)
+                    {
+                        // n.v is in (0, 1], a grazing n.v of 0 would be black
+                        float n_dot_v = static_cast<float>(y + 1) / static_cast<float>(size);
+                        float vx = sqrt(1 - n_dot_v * n_dot_v);
+                        float vz = n_dot_v;
+                        float g_v = GeometrySchlickGGX(n_dot_v, k);
+
+                        float scale = 0;
+                        float bias = 0;
+                        uint32 i = 0;
+#if defined(__AVX__)
+                        __m256 scales = _mm256_setzero_ps();
+                        __m256 biases = _mm256_setzero_ps();
+                        const __m256 zero = _mm256_setzero_ps();
+                        const __m256 one = _mm256_set1_ps(1.0f);
+                        for (; i + 8 <= sample_count; i += 8)
+                        {
+                            __m256 h_x = _mm256_loadu_ps(hx.data() + i);
+                            __m256 h_z = _mm256_loadu_ps(hz.data() + i);
+
+                            __m256 v_dot_h = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(vx), h_x), _mm256_mul_ps(_mm256_set1_ps(vz), h_z));
+                            __m256 n_dot_l = _mm256_sub_ps(_mm256_mul_ps(_mm256_add_ps(v_dot_h, v_dot_h), h_z), _mm256_set1_ps(vz));
+                            __m256 visible = _mm256_cmp_ps(n_dot_l, zero, _CMP_GT_OQ);
+                            v_dot_h = _mm256_max_ps(v_dot_h, zero);
+
+                            __m256 g_l = _mm256_div_ps(n_dot_l, _mm256_max_ps(_mm256_add_ps(_mm256_mul_ps(n_dot_l, _mm256_set1_ps(1 - k)), _mm256_set1_ps(k)), _mm256_set1_ps(1e-6f)));
+                            __m256 g_vis = _mm256_div_ps(_mm256_mul_ps(_mm256_mul_ps(g_l, _mm256_set1_ps(g_v)), v_dot_h),
+                                _mm256_max_ps(_mm256_mul_ps(h_z, _mm256_set1_ps(n_dot_v)), _mm256_set1_ps(0.0001f)));
+                            g_vis = _mm256_and_ps(g_vis, visible);
+
+                            __m256 f = _mm256_sub_ps(one, v_dot_h);
+                            __m256 f2 = _mm256_mul_ps(f, f);
+                            __m256 fc = _mm256_mul_ps(_mm256_mul_ps(f2, f2), f);
+                            scales = _mm256_add_ps(scales, _mm256_mul_ps(_mm256_sub_ps(one, fc), g_vis));
+                            biases = _mm256_add_ps(biases, _mm256_mul_ps(fc, g_vis));
+                        }
+
+                        alignas(32) float lanes[2][8];
+                        _mm256_store_ps(lanes[0], scales);
+                        _mm256_store_ps(lanes[1], biases);
+                        for (uint32 lane = 0; lane < 8; lane++)
+                        {
+                            scale += lanes[0][lane];
+                            bias += lanes[1][lane];
+                        }
+#endif
+                        for (; i < sample_count; i++)
+                        {
+                            float v_dot_h = vx * hx[i] + vz * hz[i];
+                            float n_dot_l = 2 * v_dot_h * hz[i] - vz;
+                            if (n_dot_l <= 0)
+                            {
+                                continue;
+                            }
+
+                            v_dot_h = std::max(v_dot_h, 0.0f);
+                            float g_vis = GeometrySchlickGGX(n_dot_l, k) * g_v * v_dot_h / std::max(hz[i] * n_dot_v, 0.0001f);
+                            float fc = Pow(1 - v_dot_h, 5);
+                            scale += (1 - fc) * g_vis;
+                            bias += fc * g_vis;
+                        }
+
+                        uint16* texel = texels + (y * size + x) * 2;
+                        texel[0] = FloatToHalf(scale / sample_count);
+                        texel[1] = FloatToHalf(bias / sample_count);
+                    }
+                }
+            }
+        ));
+        return lut;
+    }
+}
@@ -0,0 +1,306 @@
+#include "Resource/ImportCache.h"
+#include "Resource/json.hpp"
+#include "Utils/Misc.h"
+
+#include <bit>
+#include <cstring>
+#include <filesystem>
+
+namespace MRenderer
+{
+    static inline uint64 MixHash(uint64 hash)
+    {
+        // finalizer of murmur3
+        hash ^= hash >> 33;
+        hash *= 0xFF51AFD7ED558CCDull;
+        hash ^= hash >> 33;
+        hash *= 0xC4CEB9FE1A85EC53ull;
+        hash ^= hash >> 33;
+        return hash;
+    }
+
+    static inline bool QueryFileStatus(const std::filesystem::path& path, uint64& out_size, int64& out_write_time)
+    {
+        std::error_code error;
+        out_size = std::filesystem::file_size(path, error);
+        if (error)
+        {
+            return false;
+        }
+
+        out_write_time = std::filesystem::last_write_time(path, error).time_since_epoch().count();
+        return !error;
+    }
+
+    ImportCache& ImportCache::Instance()
+    {
+        static ImportCache cache(DefaultCachePath);
+        return cache;
+    }
+
+    ImportCache::ImportCache(std::string_view cache_path)
+        :mCachePath(cache_path)
+    {
+        Load();
+    }
+
+    uint64 ImportCache::HashBytes(const void* data, uint64 size, uint64 seed)
+    {
+        constexpr uint64 K0 = 0x9E3779B97F4A7C15ull;
+        constexpr uint64 K1 = 0xC2B2AE3D27D4EB4Full;
+
+        // 8 bytes per multiply, the sources are hashed at the speed they are read
+        const uint8* bytes = static_cast<const uint8*>(data);
+        uint64 hash = seed ^ (size * K0);
+        uint64 i = 0;
+        for (; i + sizeof(uint64) <= size; i += sizeof(uint64))
+        {
+            uint64 word;
+            memcpy(&word, bytes + i, sizeof(uint64));
+            hash = std::rotl(hash ^ (word * K1), 31) * K0;
+        }
+
+        if (i < size)
+        {
+            uint64 tail = 0;
+            memcpy(&tail, bytes + i, size - i);
+            hash = std::rotl(hash ^ (tail * K1), 31) * K0;
+        }
+        return MixHash(hash);
+    }
+
+    std::optional<uint64> ImportCache::HashFile(std::string_view path)
+    {
+        constexpr uint32 ChunkSize = 1 << 20;
+
+        std::optional<std::ifstream> file = ReadFile(path, true);
+        if (!file.has_value())
+        {
+            return std::nullopt;
+        }
+
+        // each chunk seeds the next one
+        std::vector<char> chunk(ChunkSize);
+        uint64 hash = 0;
+        while (file.value())
+        {
+            file.value().read(chunk.data(), ChunkSize);
+            uint64 read = static_cast<uint64>(file.value().gcount());
+            if (read == 0)
+            {
+                break;
+            }
+            hash = HashBytes(chunk.data(), read, hash);
+        }
+        return hash;
+    }
+
+    uint64 ImportCache::HashCombine(uint64 seed, uint64 value)
+    {
+        return seed ^ (MixHash(value) + 0x9E3779B97F4A7C15ull + (seed << 6) + (seed >> 2));
+    }
+
+    bool ImportCache::IsUpToDate(std::string_view repo_path, uint64 settings)
+    {
+        namespace fs = std::filesystem;
+
+        // the record is copied out, so that the importers running in parallel don't wait for the hashing of each other's files
+        Record record;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+
+            auto it = mRecords.find(std::string(repo_path));
+            if (it == mRecords.end() || it->second.Settings != HashCombine(settings, ImporterVersion))
+            {
+                return false;
+            }
+            record = it->second;
+        }
+
+        for (const std::string& output : record.Outputs)
+        {
+            if (!fs::exists(output))
+            {
+                return false;
+            }
+        }
+
+        // a file touched without being changed is hashed once, then its new status is kept
+        bool touched = false;
+        for (ImportDependency& dependency : record.Dependencies)
+        {
+            uint64 size;
+            int64 write_time;
+            if (!QueryFileStatus(dependency.Path, size, write_time) || size != dependency.Size)
+            {
+                return false;
+            }
+
+            if (write_time != dependency.WriteTime)
+            {
+                std::optional<uint64> hash = HashFile(dependency.Path);
+                if (!hash.has_value() || hash.value() != dependency.Hash)
+                {
+                    return false;
+                }
+
+                dependency.WriteTime = write_time;
+                touched = true;
+            }
+        }
+
+        if (touched)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+
+                // the new write times are only kept if the record wasn't imported again meanwhile
+                auto it = mRecords.find(std::string(repo_path));
+                if (it == mRecords.end() || it->second.Settings != record.Settings || it->second.Dependencies.size() != record.Dependencies.size())
+                {
+                    return true;
+                }
+
+                for (uint32 i = 0; i < record.Dependencies.size(); i++)
+                {
+                    ImportDependency& dependency = it->second.Dependencies[i];
+                    if (dependency.Path == record.Dependencies[i].Path && dependency.Hash == record.Dependencies[i].Hash)
+                    {
+                        dependency.WriteTime = record.Dependencies[i].WriteTime;
+                    }
+                }
+            }
+            Save();
+        }
+        return true;
+    }
+
+    void ImportCache::Update(std::string_view repo_path, uint64 settings, const std::vector<std::string>& dependencies, const std::vector<std::string>& outputs,
+        const std::vector<ImportChild>& children/*={}*/)
+    {
+        Record record;
+        record.Settings = HashCombine(settings, ImporterVersion);
+        record.Outputs = outputs;
+        record.Children = children;
+
+        for (const std::string& path : dependencies)
+        {
+            ImportDependency dependency;
+            dependency.Path = path;
+
+            std::optional<uint64> hash = HashFile(path);
+            if (!hash.has_value() || !QueryFileStatus(path, dependency.Size, dependency.WriteTime))
+            {
+                // the import is done anyway, it's just not cached
+                Log("Import Cache Can't Read ", path);
+                Invalidate(repo_path);
+                return;
+            }
+            dependency.Hash = hash.value();
+            record.Dependencies.push_back(std::move(dependency));
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mRecords[std::string(repo_path)] = std::move(record);
+        }
+        Save();
+    }
+
+    void ImportCache::Invalidate(std::string_view repo_path)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (mRecords.erase(std::string(repo_path)) == 0)
+            {
+                return;
+            }
+        }
+        Save();
+    }
+
+    std::vector<ImportChild> ImportCache::Children(std::string_view repo_path)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        auto it = mRecords.find(std::string(repo_path));
+        return it != mRecords.end() ? it->second.Children : std::vector<ImportChild>();
+    }
+
+    bool ImportCache::Save()
+    {
+        nlohmann::json records = nlohmann::json::object();
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            for (const auto& [repo_path, record] : mRecords)
+            {
+                nlohmann::json& data = records[repo_path];
+                data["Settings"] = record.Settings;
+                data["Outputs"] = record.Outputs;
+
+                nlohmann::json& dependencies = data["Dependencies"] = nlohmann::json::array();
+                for (const ImportDependency& dependency : record.Dependencies)
+                {
+                    dependencies.push_back({ { "Path", dependency.Path }, { "Size", dependency.Size }, { "WriteTime", dependency.WriteTime }, { "Hash", dependency.Hash } });
+                }
+
+                nlohmann::json& children = data["Children"] = nlohmann::json::array();
+                for (const ImportChild& child : record.Children)
+                {
+                    children.push_back({ { "Source", child.Source }, { "RepoPath", child.RepoPath } });
+                }
+            }
+        }
+
+        std::optional<std::ofstream> file = WriteFile(mCachePath);
+        if (!file.has_value())
+        {
+            Log("Import Cache Can't Write ", mCachePath);
+            return false;
+        }
+
+        nlohmann::json json = { { "Version", ImporterVersion }, { "Records", std::move(records) } };
+        file.value() << json.dump(4);
+        return true;
+    }
+
+    void ImportCache::Load()
+    {
+        if (!std::filesystem::exists(mCachePath))
+        {
+            return;
+        }
+
+        std::optional<std::ifstream> file = ReadFile(mCachePath);
+        if (!file.has_value())
+        {
+            return;
+        }
+
+        // a corrupted cache is only a slower import
+        try {
+            nlohmann::json json = nlohmann::json::parse(file.value());
+            for (const auto& [repo_path, data] : json.at("Records").items())
+            {
+                Record& record = mRecords[repo_path];
+                record.Settings = data.at("Settings").get<uint64>();
+                record.Outputs = data.at("Outputs").get<std::vector<std::string>>();
+
+                for (const nlohmann::json& dependency : data.at("Dependencies"))
+                {
+                    record.Dependencies.push_back(ImportDependency{ .Path = dependency.at("Path").get<std::string>(), .Size = dependency.at("Size").get<uint64>(),
+                        .WriteTime = dependency.at("WriteTime").get<int64>(), .Hash = dependency.at("Hash").get<uint64>() });
+                }
+
+                for (const nlohmann::json& child : data.at("Children"))
+                {
+                    record.Children.push_back(ImportChild{ .Source = child.at("Source").get<std::string>(), .RepoPath = child.at("RepoPath").get<std::string>() });
+                }
+            }
+        }
+        catch (const nlohmann::json::exception& e) {
+            Log("Import Cache ", mCachePath, " Is Corrupted, ", e.what());
+            mRecords.clear();
+        }
+    }
+}
@@ -0,0 +1,866 @@
+#include "Resource/MeshOptimizer.h"
+#include "Utils/Thread.h"
+
+#include <array>
+#include <cmath>
+#include <numeric>
+
+namespace MRenderer
+{
+    // attributes quantized by the weld tolerance, vertices are welded if their keys are equal
+    using WeldKey = std::array<int32, 11>;
+
+    static inline int32 Quantize(float value, float inv_tolerance)
+    {
+        return static_cast<int32>(std::floor(value * inv_tolerance + 0.5f));
+    }
+
+    static inline uint32 HashWeldKey(const WeldKey& key)
+    {
+        // FNV-1a over the 32 bit words, followed by a final mix so that the high bits used by the radix sort are well distributed
+        uint32 hash = 2166136261u;
+        for (int32 value : key)
+        {
+            hash = (hash ^ static_cast<uint32>(value)) * 16777619u;
+        }
+        hash ^= hash >> 16;
+        hash *= 0x7feb352du;
+        hash ^= hash >> 15;
+        return hash;
+    }
+
+    // smallest and largest vertex referenced by @indices, the per range tables are indexed relative to the smallest one.
+    // after welding the vertices of a sub mesh are mostly contiguous, so the tables stay small
+    static std::pair<uint32, uint32> VertexRange(std::span<const uint32> indices)
+    {
+        if (indices.empty())
+        {
+            return { 0, 0 };
+        }
+        auto [min, max] = std::minmax_element(indices.begin(), indices.end());
+        return { *min, *max + 1 };
+    }
+
+    // a vertex is in the cache if less than @mSize vertices were loaded after it
+    class FifoCache
+    {
+    public:
+        FifoCache(uint32 num_vertices, uint32 size)
+            :mTimestamps(num_vertices, 0), mTime(size + 1), mSize(size)
+        {
+        }
+
+        // return true if the vertex is loaded into the cache
+        inline bool Access(uint32 vertex)
+        {
+            if (mTime - mTimestamps[vertex] > mSize)
+            {
+                mTimestamps[vertex] = mTime++;
+                return true;
+            }
+            return false;
+        }
+
+        inline void Flush()
+        {
+            mTime += mSize + 1;
+        }
+
+    private:
+        std::vector<uint32> mTimestamps;
+        uint32 mTime;
+        uint32 mSize;
+    };
+
+    // triangles around each vertex of an index range, vertices are relative to @vertex_begin.
+    // the first @Valences[v] triangles of vertex v are the ones not removed yet
+    struct TriangleAdjacency
+    {
+        TriangleAdjacency(std::span<const uint32> indices, uint32 vertex_begin, uint32 num_vertices)
+            :Valences(num_vertices, 0), Offsets(num_vertices + 1, 0), Triangles(indices.size())
+        {
+            for (uint32 index : indices)
+            {
+                Valences[index - vertex_begin]++;
+            }
+            std::inclusive_scan(Valences.begin(), Valences.end(), Offsets.begin() + 1);
+
+            std::vector<uint32> cursors(Offsets.begin(), Offsets.end() - 1);
+            for (uint32 i = 0; i < indices.size(); i++)
+            {
+                Triangles[cursors[indices[i] - vertex_begin]++] = i / 3;
+            }
+        }
+
+        inline std::span<const uint32> Live(uint32 vertex) const
+        {
+            return std::span<const uint32>(Triangles.data() + Offsets[vertex], Valences[vertex]);
+        }
+
+        // move @triangle behind the live triangles of @vertex
+        inline void Remove(uint32 vertex, uint32 triangle)
+        {
+            uint32* live = Triangles.data() + Offsets[vertex];
+            uint32 last = --Valences[vertex];
+            *std::find(live, live + last, triangle) = live[last];
+            live[last] = triangle;
+        }
+
+        std::vector<uint32> Valences;
+        std::vector<uint32> Offsets;
+        std::vector<uint32> Triangles;
+    };
+
+    // vertex scores of Forsyth's algorithm, with the constants of the paper
+    class ForsythScore
+    {
+    public:
+        static constexpr uint32 CacheSize = 32;
+        static constexpr uint32 MaxValence = 32;
+
+        ForsythScore()
+        {
+            for (uint32 i = 0; i < CacheSize; i++)
+            {
+                // the vertices of the last triangle get a fixed score, so the next triangle doesn't always share an edge with it
+                mCacheScores[i] = i < 3 ? 0.75f : std::pow(1.0f - static_cast<float>(i - 3) / (CacheSize - 3), 1.5f);
+            }
+
+            // boost the vertices with few triangles left, so that no lonely triangle is left behind
+            mValenceScores[0] = 0;
+            for (uint32 i = 1; i <= MaxValence; i++)
+            {
+                mValenceScores[i] = 2.0f / std::sqrt(static_cast<float>(i));
+            }
+        }
+
+        // @cache_position is -1 if the vertex is not in the cache, @valence is the number of triangles of the vertex not emitted yet
+        inline float Score(int32 cache_position, uint32 valence) const
+        {
+            if (valence == 0)
+            {
+                return -1.0f;
+            }
+
+            float score = cache_position < 0 ? 0 : mCacheScores[cache_position];
+            return score + mValenceScores[std::min(valence, MaxValence)];
+        }
+
+    private:
+        float mCacheScores[CacheSize];
+        float mValenceScores[MaxValence + 1];
+    };
+
+    void MeshOptimizer::WeldVertices(const std::vector<StandardVertex>& vertices, const WeldTolerance& tolerance, std::vector<StandardVertex>& out_vertices, std::vector<uint32>& out_indices)
+    {
+        ASSERT(tolerance.Position > 0 && tolerance.Normal > 0 && tolerance.Color > 0 && tolerance.TexCoord > 0);
+
+        TaskScheduler& scheduler = TaskScheduler::Instance();
+        uint32 size = static_cast<uint32>(vertices.size());
+        uint32 num_jobs = std::clamp(size / MinVerticesPerJob, 1u, scheduler.GetJobSystem().NumWorkers() + 1);
+        uint32 chunk_size = (size + num_jobs - 1) / num_jobs;
+
+        auto parallel_chunks = [&](auto&& func)
+        {
+            JobHandle handle = scheduler.ParallelFor(num_jobs, 1,
+                [&](uint32 begin, uint32 end)
+                {
+                    for (uint32 job = begin; job < end; job++)
+                    {
+                        func(job, job * chunk_size, std::min(size, (job + 1) * chunk_size));
+                    }
+                }
+            );
+            scheduler.Wait(handle);
+        };
+
+        // 1. quantize the attributes, items are (hash << 32 | vertex index)
+        std::vector<WeldKey> keys(size);
+        std::vector<uint64> items(size);
+        float inv_position = 1.0f / tolerance.Position;
+        float inv_normal = 1.0f / tolerance.Normal;
+        float inv_color = 1.0f / tolerance.Color;
+        float inv_tex_coord = 1.0f / tolerance.TexCoord;
+        parallel_chunks([&](uint32 job, uint32 begin, uint32 end)
+        {
+            for (uint32 i = begin; i < end; i++)
+            {
+                const StandardVertex& vertex = vertices[i];
+                keys[i] = {
+                    Quantize(vertex.Position.x, inv_position), Quantize(vertex.Position.y, inv_position), Quantize(vertex.Position.z, inv_position),
+                    Quantize(vertex.Normal.x, inv_normal), Quantize(vertex.Normal.y, inv_normal), Quantize(vertex.Normal.z, inv_normal),
+                    Quantize(vertex.Color.x, inv_color), Quantize(vertex.Color.y, inv_color), Quantize(vertex.Color.z, inv_color),
+                    Quantize(vertex.TexCoord0.x, inv_tex_coord), Quantize(vertex.TexCoord0.y, inv_tex_coord),
+                };
+                items[i] = static_cast<uint64>(HashWeldKey(keys[i])) << 32 | i;
+            }
+        });
+
+        // 2. group the vertices by hash, the sort is stable so the vertices in a group are in the input order
+        ParallelRadixSort(items, 32, 64);
+
+        // 3. in each group, map every vertex to the first vertex with the same key and sum up their tangents.
+        // a job handles the groups starting in its chunk, so all the vertices merged into a vertex are visited by the same job
+        std::vector<uint32> representatives(size);
+        std::vector<Vector3> tangent_sums(size);
+        parallel_chunks([&](uint32 job, uint32 begin, uint32 end)
+        {
+            auto hash_of = [&items](uint32 i) { return static_cast<uint32>(items[i] >> 32); };
+
+            uint32 group_begin = begin;
+            while (group_begin > 0 && group_begin < size && hash_of(group_begin) == hash_of(group_begin - 1))
+            {
+                group_begin++;
+            }
+
+            std::vector<uint32> distinct;
+            while (group_begin < end)
+            {
+                uint32 group_end = group_begin + 1;
+                while (group_end < size && hash_of(group_end) == hash_of(group_begin))
+                {
+                    group_end++;
+                }
+
+                // different keys with the same hash are rare, the distinct keys of a group are searched linearly
+                distinct.clear();
+                for (uint32 i = group_begin; i < group_end; i++)
+                {
+                    uint32 vertex = static_cast<uint32>(items[i]);
+                    uint32 representative = vertex;
+                    for (uint32 candidate : distinct)
+                    {
+                        if (keys[candidate] == keys[vertex])
+                        {
+                            representative = candidate;
+                            break;
+                        }
+                    }
+
+                    if (representative == vertex)
+                    {
+                        distinct.push_back(vertex);
+                        tangent_sums[vertex] = vertices[vertex].Tangent;
+                    }
+                    else
+                    {
+                        tangent_sums[representative] = Vector3::FromVec4f(tangent_sums[representative].ToVec4f() + vertices[vertex].Tangent.ToVec4f());
+                    }
+                    representatives[vertex] = representative;
+                }
+
+                group_begin = group_end;
+            }
+        });
+
+        // 4. the welded vertices keep the order of their first occurrence, prefix sum of the number of them in each chunk
+        std::vector<uint32> chunk_offsets(num_jobs);
+        parallel_chunks([&](uint32 job, uint32 begin, uint32 end)
+        {
+            uint32 count = 0;
+            for (uint32 i = begin; i < end; i++)
+            {
+                count += representatives[i] == i;
+            }
+            chunk_offsets[job] = count;
+        });
+
+        uint32 num_welded = 0;
+        for (uint32& offset : chunk_offsets)
+        {
+            uint32 count = offset;
+            offset = num_welded;
+            num_welded += count;
+        }
+
+        // 5. write the welded vertices with the averaged tangents, then remap the indices
+        std::vector<uint32> welded_indices(size);
+        out_vertices.resize(num_welded);
+        out_indices.resize(size);
+        parallel_chunks([&](uint32 job, uint32 begin, uint32 end)
+        {
+            uint32 next = chunk_offsets[job];
+            for (uint32 i = begin; i < end; i++)
+            {
+                if (representatives[i] != i)
+                {
+                    continue;
+                }
+
+                StandardVertex& vertex = out_vertices[next];
+                vertex = vertices[i];
+
+                // Gram-Schmidt, keep the first tangent if the sum vanishes, e.g. mirrored texture coordinates
+                Vec4f normal = vertex.Normal.ToVec4f();
+                Vec4f tangent = tangent_sums[i].ToVec4f();
+                tangent = tangent - normal * normal.Dot3(tangent);
+                if (tangent.Dot3(tangent).X() > 1e-12f)
+                {
+                    vertex.Tangent = Vector3::FromVec4f(tangent.Normalize3());
+                }
+
+                welded_indices[i] = next++;
+            }
+        });
+
+        parallel_chunks([&](uint32 job, uint32 begin, uint32 end)
+        {
+            for (uint32 i = begin; i < end; i++)
+            {
+                out_indices[i] = welded_indices[representatives[i]];
+            }
+        });
+    }
+
+    VertexCacheStatistics MeshOptimizer::AnalyzeVertexCache(std::span<const uint32> indices, uint32 cache_size)
+    {
+        VertexCacheStatistics statistics;
+        if (indices.empty())
+        {
+            return statistics;
+        }
+
+        auto [vertex_begin, vertex_end] = VertexRange(indices);
+        FifoCache cache(vertex_end - vertex_begin, cache_size);
+        std::vector<bool> referenced(vertex_end - vertex_begin, false);
+        uint32 num_referenced = 0;
+        for (uint32 index : indices)
+        {
+            uint32 vertex = index - vertex_begin;
+            statistics.NumTransformed += cache.Access(vertex);
+            if (!referenced[vertex])
+            {
+                referenced[vertex] = true;
+                num_referenced++;
+            }
+        }
+
+        statistics.ACMR = static_cast<float>(statistics.NumTransformed) / (indices.size() / 3);
+        statistics.ATVR = static_cast<float>(statistics.NumTransformed) / num_referenced;
+        return statistics;
+    }
+
+    void MeshOptimizer::OptimizeVertexCache(std::span<uint32> indices)
+    {
+        ASSERT(indices.size() % 3 == 0);
+
+        static const ForsythScore scores;
+        constexpr uint32 CacheSize = ForsythScore::CacheSize;
+
+        uint32 num_triangles = static_cast<uint32>(indices.size() / 3);
+        if (num_triangles < 2)
+        {
+            return;
+        }
+
+        // the live triangles are the ones not emitted yet
+        auto [vertex_begin, vertex_end] = VertexRange(indices);
+        uint32 num_vertices = vertex_end - vertex_begin;
+        TriangleAdjacency adjacency(indices, vertex_begin, num_vertices);
+
+        std::vector<float> vertex_scores(num_vertices);
+        for (uint32 v = 0; v < num_vertices; v++)
+        {
+            vertex_scores[v] = scores.Score(-1, adjacency.Valences[v]);
+        }
+
+        std::vector<float> triangle_scores(num_triangles);
+        for (uint32 t = 0; t < num_triangles; t++)
+        {
+            triangle_scores[t] = vertex_scores[indices[t * 3] - vertex_begin] + vertex_scores[indices[t * 3 + 1] - vertex_begin] + vertex_scores[indices[t * 3 + 2] - vertex_begin];
+        }
+
+        std::vector<uint32> output(indices.size());
+        std::vector<bool> emitted(num_triangles, false);
+
+        // the cache holds 3 more vertices while the emitted triangle is pushed in, they are evicted right after
+        std::array<uint32, CacheSize + 3> cache, new_cache;
+        uint32 cache_count = 0;
+
+        int32 best = static_cast<int32>(std::max_element(triangle_scores.begin(), triangle_scores.end()) - triangle_scores.begin());
+        uint32 dead_end_cursor = 0;
+        for (uint32 i = 0; i < num_triangles; i++)
+        {
+            // none of the cached vertices have triangles left, restart from the next triangle in the input order
+            if (best < 0)
+            {
+                while (emitted[dead_end_cursor])
+                {
+                    dead_end_cursor++;
+                }
+                best = static_cast<int32>(dead_end_cursor);
+            }
+
+            uint32 triangle = static_cast<uint32>(best);
+            emitted[triangle] = true;
+
+            uint32 new_count = 0;
+            for (uint32 k = 0; k < 3; k++)
+            {
+                uint32 index = indices[triangle * 3 + k];
+                output[i * 3 + k] = index;
+
+                uint32 vertex = index - vertex_begin;
+                adjacency.Remove(vertex, triangle);
+
+                if (std::find(new_cache.begin(), new_cache.begin() + new_count, vertex) == new_cache.begin() + new_count)
+                {
+                    new_cache[new_count++] = vertex;
+                }
+            }
+
+            // the cached vertices are distinct, only the ones of the triangle need to be skipped
+            uint32 triangle_count = new_count;
+            for (uint32 k = 0; k < cache_count; k++)
+            {
+                if (std::find(new_cache.begin(), new_cache.begin() + triangle_count, cache[k]) == new_cache.begin() + triangle_count)
+                {
+                    new_cache[new_count++] = cache[k];
+                }
+            }
+
+            // update the scores of the vertices in the cache, including the evicted ones, and the scores of their live triangles
+            for (uint32 k = 0; k < new_count; k++)
+            {
+                uint32 vertex = new_cache[k];
+                float score = scores.Score(k < CacheSize ? static_cast<int32>(k) : -1, adjacency.Valences[vertex]);
+                float delta = score - vertex_scores[vertex];
+                vertex_scores[vertex] = score;
+
+                for (uint32 live : adjacency.Live(vertex))
+                {
+                    triangle_scores[live] += delta;
+                }
+            }
+
+            std::swap(cache, new_cache);
+            cache_count = std::min(new_count, CacheSize);
+
+            // the next triangle is the best one among the live triangles of the cached vertices
+            // the vertices of a live triangle have positive scores
+            best = -1;
+            float best_score = 0;
+            for (uint32 k = 0; k < cache_count; k++)
+            {
+                for (uint32 live : adjacency.Live(cache[k]))
+                {
+                    if (triangle_scores[live] > best_score)
+                    {
+                        best_score = triangle_scores[live];
+                        best = static_cast<int32>(live);
+                    }
+                }
+            }
+        }
+
+        std::copy(output.begin(), output.end(), indices.begin());
+    }
+
+    void MeshOptimizer::OptimizeOverdraw(std::span<uint32> indices, const std::vector<StandardVertex>& vertices, float threshold)
+    {
+        ASSERT(indices.size() % 3 == 0);
+
+        uint32 num_triangles = static_cast<uint32>(indices.size() / 3);
+        if (num_triangles < 2)
+        {
+            return;
+        }
+
+        auto [vertex_begin, vertex_end] = VertexRange(indices);
+        FifoCache cache(vertex_end - vertex_begin, FifoCacheSize);
+        auto triangle_misses = [&](uint32 triangle)
+        {
+            return cache.Access(indices[triangle * 3] - vertex_begin) + cache.Access(indices[triangle * 3 + 1] - vertex_begin) + cache.Access(indices[triangle * 3 + 2] - vertex_begin);
+        };
+
+        // 1. hard boundaries, where all the vertices of a triangle miss the cache, the cache optimized order jumps to another part of the mesh there
+        std::vector<uint32> hard_clusters;
+        for (uint32 t = 0; t < num_triangles; t++)
+        {
+            if (triangle_misses(t) == 3 || t == 0)
+            {
+                hard_clusters.push_back(t);
+            }
+        }
+        hard_clusters.push_back(num_triangles);
+
+        // 2. soft boundaries, split a cluster once the miss ratio of the part since the last split is within @threshold of the whole cluster.
+        // the cache is flushed at each split, as the clusters may be drawn in any order
+        std::vector<uint32> clusters;
+        for (uint32 c = 0; c + 1 < hard_clusters.size(); c++)
+        {
+            uint32 begin = hard_clusters[c], end = hard_clusters[c + 1];
+
+            cache.Flush();
+            uint32 cluster_misses = 0;
+            for (uint32 t = begin; t < end; t++)
+            {
+                cluster_misses += triangle_misses(t);
+            }
+            float cluster_threshold = threshold * cluster_misses / (end - begin);
+
+            cache.Flush();
+            clusters.push_back(begin);
+            uint32 running_misses = 0, running_size = 0;
+            for (uint32 t = begin; t < end; t++)
+            {
+                running_misses += triangle_misses(t);
+                running_size++;
+                if (running_misses <= running_size * cluster_threshold && t + 1 < end)
+                {
+                    clusters.push_back(t + 1);
+                    cache.Flush();
+                    running_misses = running_size = 0;
+                }
+            }
+        }
+        uint32 num_clusters = static_cast<uint32>(clusters.size());
+        clusters.push_back(num_triangles);
+
+        // 3. area weighted centroid and normal of each cluster, and of the mesh
+        std::vector<Vector3> centroids(num_clusters), normals(num_clusters);
+        Vec4f mesh_centroid = Vec4f::Splat(0);
+        float mesh_area = 0;
+        for (uint32 c = 0; c < num_clusters; c++)
+        {
+            Vec4f centroid = Vec4f::Splat(0), normal = Vec4f::Splat(0);
+            float area = 0;
+            for (uint32 t = clusters[c]; t < clusters[c + 1]; t++)
+            {
+                Vec4f p0 = vertices[indices[t * 3]].Position.ToVec4f();
+                Vec4f p1 = vertices[indices[t * 3 + 1]].Position.ToVec4f();
+                Vec4f p2 = vertices[indices[t * 3 + 2]].Position.ToVec4f();
+
+                // the length of the cross product is twice the area
+                Vec4f cross = (p1 - p0).Cross3(p2 - p0);
+                float double_area = cross.Length3().X();
+
+                centroid = centroid + (p0 + p1 + p2) * (double_area / 3.0f);
+                normal = normal + cross;
+                area += double_area;
+            }
+
+            mesh_centroid = mesh_centroid + centroid;
+            mesh_area += area;
+
+            centroids[c] = Vector3::FromVec4f(area > 0 ? centroid / area : centroid);
+            float normal_length = normal.Length3().X();
+            normals[c] = Vector3::FromVec4f(normal_length > 0 ? normal / normal_length : normal);
+        }
+        mesh_centroid = mesh_area > 0 ? mesh_centroid / mesh_area : mesh_centroid;
+
+        // 4. draw the clusters facing away from the center first, they are likely in front of the others
+        std::vector<float> sort_keys(num_clusters);
+        for (uint32 c = 0; c < num_clusters; c++)
+        {
+            sort_keys[c] = (centroids[c].ToVec4f() - mesh_centroid).Dot3(normals[c].ToVec4f()).X();
+        }
+
+        std::vector<uint32> cluster_order(num_clusters);
+        std::iota(cluster_order.begin(), cluster_order.end(), 0);
+        std::stable_sort(cluster_order.begin(), cluster_order.end(), [&sort_keys](uint32 a, uint32 b) { return sort_keys[a] > sort_keys[b]; });
+
+        std::vector<uint32> output;
+        output.reserve(indices.size());
+        for (uint32 c : cluster_order)
+        {
+            output.insert(output.end(), indices.begin() + clusters[c] * 3, indices.begin() + clusters[c + 1] * 3);
+        }
+        std::copy(output.begin(), output.end(), indices.begin());
+    }
+
+    void MeshOptimizer::OptimizeVertexFetch(std::vector<StandardVertex>& vertices, std::vector<uint32>& indices)
+    {
+        constexpr uint32 Unreferenced = UINT32_MAX;
+
+        std::vector<uint32> remap(vertices.size(), Unreferenced);
+        uint32 num_referenced = 0;
+        for (uint32& index : indices)
+        {
+            if (remap[index] == Unreferenced)
+            {
+                remap[index] = num_referenced++;
+            }
+            index = remap[index];
+        }
+
+        std::vector<StandardVertex> reordered(num_referenced);
+        for (uint32 i = 0; i < vertices.size(); i++)
+        {
+            if (remap[i] != Unreferenced)
+            {
+                reordered[remap[i]] = vertices[i];
+            }
+        }
+        vertices = std::move(reordered);
+    }
+
+    void MeshOptimizer::OptimizeMesh(std::vector<StandardVertex>& vertices, std::vector<uint32>& indices, const std::vector<SubMeshData>& sub_meshes, std::vector<MeshletData>* out_meshlets)
+    {
+        std::vector<std::vector<MeshletData>> sub_mesh_meshlets(sub_meshes.size());
+
+        TaskScheduler& scheduler = TaskScheduler::Instance();
+        JobHandle handle = scheduler.ParallelFor(static_cast<uint32>(sub_meshes.size()), 1,
+            [&](uint32 begin, uint32 end)
+            {
+                for (uint32 i = begin; i < end; i++)
+                {
+                    std::span<uint32> range(indices.data() + sub_meshes[i].Index, sub_meshes[i].IndicesCount);
+                    OptimizeVertexCache(range);
+                    OptimizeOverdraw(range, vertices);
+
+                    // seeded in the overdraw order, so the meshlets facing outwards still come first
+                    if (out_meshlets)
+                    {
+                        BuildMeshlets(vertices, range, sub_meshes[i].Index, sub_mesh_meshlets[i]);
+                    }
+                }
+            }
+        );
+        scheduler.Wait(handle);
+
+        OptimizeVertexFetch(vertices, indices);
+
+        if (out_meshlets)
+        {
+            out_meshlets->clear();
+            for (std::vector<MeshletData>& meshlets : sub_mesh_meshlets)
+            {
+                for (MeshletData& meshlet : meshlets)
+                {
+                    ComputeMeshletBounds(vertices, indices, meshlet);
+                }
+                out_meshlets->insert(out_meshlets->end(), meshlets.begin(), meshlets.end());
+            }
+        }
+    }
+
+    void MeshOptimizer::BuildMeshlets(const std::vector<StandardVertex>& vertices, std::span<uint32> indices, uint32 index_offset, std::vector<MeshletData>& out_meshlets)
+    {
+        ASSERT(indices.size() % 3 == 0);
+
+        uint32 num_triangles = static_cast<uint32>(indices.size() / 3);
+        if (num_triangles == 0)
+        {
+            return;
+        }
+
+        // the live triangles are the ones not added to a meshlet yet
+        auto [vertex_begin, vertex_end] = VertexRange(indices);
+        TriangleAdjacency adjacency(indices, vertex_begin, vertex_end - vertex_begin);
+        std::vector<bool> added(num_triangles, false);
+
+        // vertices of the meshlet being built, @vertex_slots maps a vertex to its slot in @meshlet_vertices
+        constexpr uint8 NoSlot = 0xFF;
+        std::vector<uint8> vertex_slots(vertex_end - vertex_begin, NoSlot);
+        std::array<uint32, MeshletData::MaxVertices> meshlet_vertices;
+        uint32 num_meshlet_vertices = 0;
+        Vec4f position_sum = Vec4f::Splat(0);
+
+        // vertices of the last finished meshlet, new meshlets are seeded next to it so that the meshlets sweep over the mesh
+        std::array<uint32, MeshletData::MaxVertices> last_meshlet_vertices;
+        uint32 num_last_meshlet_vertices = 0;
+
+        std::vector<uint32> output;
+        output.reserve(indices.size());
+        uint32 meshlet_begin = 0;
+
+        auto num_new_vertices = [&](uint32 triangle)
+        {
+            uint32 a = indices[triangle * 3] - vertex_begin, b = indices[triangle * 3 + 1] - vertex_begin, c = indices[triangle * 3 + 2] - vertex_begin;
+            return (vertex_slots[a] == NoSlot) + (vertex_slots[b] == NoSlot && b != a) + (vertex_slots[c] == NoSlot && c != a && c != b);
+        };
+
+        auto distance_to_meshlet = [&](uint32 triangle)
+        {
+            Vec4f centroid = (vertices[indices[triangle * 3]].Position.ToVec4f() + vertices[indices[triangle * 3 + 1]].Position.ToVec4f() + vertices[indices[triangle * 3 + 2]].Position.ToVec4f()) * (1.0f / 3.0f);
+            Vec4f offset = centroid - position_sum / static_cast<float>(num_meshlet_vertices);
+            return offset.Dot3(offset).X();
+        };
+
+        // the triangles of a meshlet are ordered for the vertex cache with its local vertex indices, which keeps the tables of @OptimizeVertexCache small
+        auto finish_meshlet = [&]()
+        {
+            uint32 num_indices = static_cast<uint32>(output.size()) - meshlet_begin;
+            std::array<uint32, MeshletData::MaxTriangles * 3> local_indices;
+            for (uint32 i = 0; i < num_indices; i++)
+            {
+                local_indices[i] = vertex_slots[output[meshlet_begin + i] - vertex_begin];
+            }
+            OptimizeVertexCache(std::span<uint32>(local_indices.data(), num_indices));
+            for (uint32 i = 0; i < num_indices; i++)
+            {
+                output[meshlet_begin + i] = meshlet_vertices[local_indices[i]];
+            }
+
+            out_meshlets.push_back(MeshletData{ .Index = index_offset + meshlet_begin, .IndicesCount = num_indices });
+
+            for (uint32 i = 0; i < num_meshlet_vertices; i++)
+            {
+                vertex_slots[meshlet_vertices[i] - vertex_begin] = NoSlot;
+            }
+            last_meshlet_vertices = meshlet_vertices;
+            num_last_meshlet_vertices = num_meshlet_vertices;
+            num_meshlet_vertices = 0;
+            position_sum = Vec4f::Splat(0);
+            meshlet_begin = static_cast<uint32>(output.size());
+        };
+
+        // remaining triangles of the vertices of a triangle, the ones with few are on the border of the area left and are taken first to avoid leaving holes
+        auto num_live_triangles = [&](uint32 triangle)
+        {
+            return adjacency.Valences[indices[triangle * 3] - vertex_begin] + adjacency.Valences[indices[triangle * 3 + 1] - vertex_begin] + adjacency.Valences[indices[triangle * 3 + 2] - vertex_begin];
+        };
+
+        // the live triangle around @around_vertices adding the fewest vertices to the meshlet, then the one with the fewest live triangles,
+        // then the closest one to the meshlet to keep it round
+        auto find_best_triangle = [&](std::span<const uint32> around_vertices, uint32& out_num_new)
+        {
+            int32 best = -1;
+            uint32 best_new = 4, best_live = 0;
+            float best_distance = 0;
+            for (uint32 vertex : around_vertices)
+            {
+                for (uint32 triangle : adjacency.Live(vertex - vertex_begin))
+                {
+                    uint32 num_new = num_new_vertices(triangle);
+                    uint32 num_live = num_live_triangles(triangle);
+                    if (num_new > best_new || (num_new == best_new && num_live > best_live))
+                    {
+                        continue;
+                    }
+
+                    float distance = num_meshlet_vertices > 0 ? distance_to_meshlet(triangle) : 0;
+                    if (num_new < best_new || num_live < best_live || distance < best_distance)
+                    {
+                        best = static_cast<int32>(triangle);
+                        best_new = num_new;
+                        best_live = num_live;
+                        best_distance = distance;
+                    }
+                }
+            }
+            out_num_new = best_new;
+            return best;
+        };
+
+        uint32 seed_cursor = 0;
+        for (uint32 i = 0; i < num_triangles; i++)
+        {
+            uint32 best_new;
+            int32 best = find_best_triangle(std::span<const uint32>(meshlet_vertices.data(), num_meshlet_vertices), best_new);
+
+            // no adjacent triangle left, continue next to the last meshlet, or from the next triangle in the input order
+            bool disconnected = best < 0;
+            if (disconnected)
+            {
+                best = find_best_triangle(std::span<const uint32>(last_meshlet_vertices.data(), num_last_meshlet_vertices), best_new);
+            }
+            if (best < 0)
+            {
+                while (added[seed_cursor])
+                {
+                    seed_cursor++;
+                }
+                best = static_cast<int32>(seed_cursor);
+                best_new = num_new_vertices(seed_cursor);
+            }
+
+            uint32 triangle = static_cast<uint32>(best);
+            uint32 num_meshlet_triangles = (static_cast<uint32>(output.size()) - meshlet_begin) / 3;
+            bool full = num_meshlet_vertices + best_new > MeshletData::MaxVertices || num_meshlet_triangles == MeshletData::MaxTriangles;
+            if (full || (disconnected && num_meshlet_triangles >= MinMeshletTriangles))
+            {
+                finish_meshlet();
+            }
+
+            added[triangle] = true;
+            for (uint32 k = 0; k < 3; k++)
+            {
+                uint32 index = indices[triangle * 3 + k];
+                uint32 vertex = index - vertex_begin;
+                output.push_back(index);
+                adjacency.Remove(vertex, triangle);
+
+                if (vertex_slots[vertex] == NoSlot)
+                {
+                    vertex_slots[vertex] = static_cast<uint8>(num_meshlet_vertices);
+                    meshlet_vertices[num_meshlet_vertices++] = index;
+                    position_sum = position_sum + vertices[index].Position.ToVec4f();
+                }
+            }
+        }
+        finish_meshlet();
+
+        std::copy(output.begin(), output.end(), indices.begin());
+    }
+
+    void MeshOptimizer::ComputeMeshletBounds(const std::vector<StandardVertex>& vertices, const std::vector<uint32>& indices, MeshletData& meshlet)
+    {
+        ASSERT(meshlet.IndicesCount > 0 && meshlet.IndicesCount % 3 == 0);
+
+        // bounding box, and the bounding sphere around its center
+        Vec4f min = vertices[indices[meshlet.Index]].Position.ToVec4f(), max = min;
+        for (uint32 i = meshlet.Index; i < meshlet.Index + meshlet.IndicesCount; i++)
+        {
+            Vec4f position = vertices[indices[i]].Position.ToVec4f();
+            min = Vec4f::Min(min, position);
+            max = Vec4f::Max(max, position);
+        }
+
+        Vec4f center = (min + max) * 0.5f;
+        Vec4f max_distance = Vec4f::Splat(0);
+        for (uint32 i = meshlet.Index; i < meshlet.Index + meshlet.IndicesCount; i++)
+        {
+            Vec4f offset = vertices[indices[i]].Position.ToVec4f() - center;
+            max_distance = Vec4f::Max(max_distance, offset.Dot3(offset));
+        }
+
+        meshlet.Bound = AABB(Vector3::FromVec4f(min), Vector3::FromVec4f(max));
+        meshlet.Center = Vector3::FromVec4f(center);
+        meshlet.Radius = std::sqrt(max_distance.X());
+
+        // normal cone, the axis is the average of the triangle normals and the cone contains all of them
+        std::vector<Vec4f> normals;
+        normals.reserve(meshlet.IndicesCount / 3);
+        Vec4f axis = Vec4f::Splat(0);
+        for (uint32 t = meshlet.Index; t < meshlet.Index + meshlet.IndicesCount; t += 3)
+        {
+            Vec4f p0 = vertices[indices[t]].Position.ToVec4f();
+            Vec4f normal = (vertices[indices[t + 1]].Position.ToVec4f() - p0).Cross3(vertices[indices[t + 2]].Position.ToVec4f() - p0);
+
+            // degenerated triangles are invisible
+            float length = normal.Length3().X();
+            if (length > 0)
+            {
+                normals.push_back(normal / length);
+                axis = axis + normals.back();
+            }
+        }
+
+        meshlet.ConeAxis = Vector3(0, 0, 0);
+        meshlet.ConeCutoff = 1;
+
+        float axis_length = axis.Length3().X();
+        if (normals.empty() || axis_length == 0)
+        {
+            return;
+        }
+        axis = axis / axis_length;
+
+        float min_dot = 1;
+        for (Vec4f normal : normals)
+        {
+            min_dot = std::min(min_dot, normal.Dot3(axis).X());
+        }
+
+        // the cone is too wide to ever be back facing as a whole
+        if (min_dot <= 0.1f)
+        {
+            return;
+        }
+
+        meshlet.ConeAxis = Vector3::FromVec4f(axis);
+        meshlet.ConeCutoff = std::sqrt(1 - min_dot * min_dot);
+    }
+}
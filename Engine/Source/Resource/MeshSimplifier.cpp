@@ -0,0 +1,565 @@
+#include "Resource/MeshSimplifier.h"
+#include "Resource/MeshOptimizer.h"
+#include "Utils/Thread.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <numeric>
+#include <tuple>
+
+namespace MRenderer
+{
+    // the open edges are weighted more than the surface so that the silhouette of the borders is kept
+    static constexpr float BorderWeight = 10.0f;
+
+    // a lod removing less than this fraction of the triangles of the previous one ends the chain
+    static constexpr float MinLodReduction = 0.1f;
+
+    // symmetric 4x4 matrix of the squared distance to a set of weighted planes, q(p) = p^T A p + 2 b^T p + c.
+    // the terms are accumulated in double, the squared distances of a dense mesh are far below the float precision of the terms
+    struct Quadric
+    {
+        double A00 = 0, A11 = 0, A22 = 0, A10 = 0, A20 = 0, A21 = 0;
+        double B0 = 0, B1 = 0, B2 = 0;
+        double C = 0;
+        double Weight = 0;
+
+        static Quadric FromPlane(Vec4f normal, float distance, float weight)
+        {
+            float n[3];
+            normal.Store3(n);
+
+            Quadric q;
+            q.A00 = static_cast<double>(weight) * n[0] * n[0];
+            q.A11 = static_cast<double>(weight) * n[1] * n[1];
+            q.A22 = static_cast<double>(weight) * n[2] * n[2];
+            q.A10 = static_cast<double>(weight) * n[1] * n[0];
+            q.A20 = static_cast<double>(weight) * n[2] * n[0];
+            q.A21 = static_cast<double>(weight) * n[2] * n[1];
+            q.B0 = static_cast<double>(weight) * n[0] * distance;
+            q.B1 = static_cast<double>(weight) * n[1] * distance;
+            q.B2 = static_cast<double>(weight) * n[2] * distance;
+            q.C = static_cast<double>(weight) * distance * distance;
+            q.Weight = weight;
+            return q;
+        }
+
+        void operator+=(const Quadric& other)
+        {
+            A00 += other.A00; A11 += other.A11; A22 += other.A22;
+            A10 += other.A10; A20 += other.A20; A21 += other.A21;
+            B0 += other.B0; B1 += other.B1; B2 += other.B2;
+            C += other.C;
+            Weight += other.Weight;
+        }
+
+        // weighted mean of the squared distances from @p to the planes
+        float Error(const Vector3& p) const
+        {
+            double rx = A00 * p.x + A10 * p.y + A20 * p.z + 2 * B0;
+            double ry = A10 * p.x + A11 * p.y + A21 * p.z + 2 * B1;
+            double rz = A20 * p.x + A21 * p.y + A22 * p.z + 2 * B2;
+            double error = rx * p.x + ry * p.y + rz * p.z + C;
+            return Weight > 0 ? static_cast<float>(std::abs(error) / Weight) : 0;
+        }
+    };
+
+    enum EVertexKind : uint8
+    {
+        EVertexKind_Manifold,   // collapses onto any neighbour
+        EVertexKind_Border,     // on an open border, collapses along it
+        EVertexKind_Locked,     // on an attribute seam, a complex border or locked by the caller
+    };
+
+    // @out_remap[v] is the first vertex of @order at the same position as v, the vertices are relative to @vertex_begin
+    static void RemapPositions(const std::vector<StandardVertex>& vertices, uint32 vertex_begin, std::vector<uint32>& order, std::vector<uint32>& out_remap)
+    {
+        std::stable_sort(order.begin(), order.end(),
+            [&vertices, vertex_begin](uint32 a, uint32 b)
+            {
+                const Vector3& pa = vertices[vertex_begin + a].Position;
+                const Vector3& pb = vertices[vertex_begin + b].Position;
+                return std::tie(pa.x, pa.y, pa.z) < std::tie(pb.x, pb.y, pb.z);
+            }
+        );
+
+        uint32 first = 0;
+        for (uint32 i = 0; i < order.size(); i++)
+        {
+            const Vector3& p = vertices[vertex_begin + order[i]].Position;
+            const Vector3& q = vertices[vertex_begin + order[first]].Position;
+            if (p.x != q.x || p.y != q.y || p.z != q.z)
+            {
+                first = i;
+            }
+            out_remap[order[i]] = order[first];
+        }
+    }
+
+    // the triangles around each vertex, rebuilt after each pass of collapses
+    struct VertexTriangles
+    {
+        VertexTriangles(std::span<const uint32> indices, const std::vector<uint32>& remap, uint32 num_vertices)
+            :Offsets(num_vertices + 1, 0), Triangles(indices.size())
+        {
+            for (uint32 index : indices)
+            {
+                Offsets[remap[index] + 1]++;
+            }
+            std::inclusive_scan(Offsets.begin(), Offsets.end(), Offsets.begin());
+
+            std::vector<uint32> cursors(Offsets.begin(), Offsets.end() - 1);
+            for (uint32 i = 0; i < indices.size(); i++)
+            {
+                Triangles[cursors[remap[indices[i]]]++] = i / 3;
+            }
+        }
+
+        inline std::span<const uint32> Around(uint32 vertex) const
+        {
+            return std::span<const uint32>(Triangles.data() + Offsets[vertex], Offsets[vertex + 1] - Offsets[vertex]);
+        }
+
+        std::vector<uint32> Offsets;
+        std::vector<uint32> Triangles;
+    };
+
+    float MeshSimplifier::Simplify(const std::vector<StandardVertex>& vertices, std::span<const uint32> indices, uint32 target_index_count, float target_error,
+        std::vector<uint32>& out_indices, std::span<const uint8> locked_vertices/*={}*/)
+    {
+        ASSERT(indices.size() % 3 == 0);
+
+        out_indices.assign(indices.begin(), indices.end());
+        if (indices.size() <= target_index_count)
+        {
+            return 0;
+        }
+
+        // the tables are indexed relative to the smallest vertex, the indices are made local and restored at the end
+        auto [min_index, max_index] = std::minmax_element(indices.begin(), indices.end());
+        uint32 vertex_begin = *min_index;
+        uint32 num_vertices = *max_index + 1 - vertex_begin;
+        for (uint32& index : out_indices)
+        {
+            index -= vertex_begin;
+        }
+
+        // the positions are rescaled to the unit cube, which keeps the quadrics well conditioned
+        std::vector<uint8> referenced(num_vertices, 0);
+        Vec4f min = Vec4f::Splat(FLT_MAX), max = Vec4f::Splat(-FLT_MAX);
+        for (uint32 index : out_indices)
+        {
+            referenced[index] = 1;
+            min = Vec4f::Min(min, vertices[vertex_begin + index].Position.ToVec4f());
+            max = Vec4f::Max(max, vertices[vertex_begin + index].Position.ToVec4f());
+        }
+        Vector3 extent = Vector3::FromVec4f(max - min);
+        float scale = std::max({ extent.x, extent.y, extent.z });
+        float inv_scale = scale > 0 ? 1.0f / scale : 1.0f;
+
+        std::vector<Vector3> positions(num_vertices);
+        std::vector<uint32> order;
+        for (uint32 v = 0; v < num_vertices; v++)
+        {
+            if (referenced[v])
+            {
+                positions[v] = Vector3::FromVec4f((vertices[vertex_begin + v].Position.ToVec4f() - min) * inv_scale);
+                order.push_back(v);
+            }
+        }
+
+        // the topology is built on the positions, the vertices at a same position only differ by their attributes
+        std::vector<uint32> remap(num_vertices, 0);
+        RemapPositions(vertices, vertex_begin, order, remap);
+
+        std::vector<uint32> num_wedges(num_vertices, 0);
+        for (uint32 v : order)
+        {
+            num_wedges[remap[v]]++;
+        }
+
+        // an edge is open if no triangle has it in the opposite direction
+        VertexTriangles around(out_indices, remap, num_vertices);
+        auto has_edge = [&](uint32 from, uint32 to)
+        {
+            for (uint32 triangle : around.Around(from))
+            {
+                for (uint32 k = 0; k < 3; k++)
+                {
+                    if (remap[out_indices[triangle * 3 + k]] == from && remap[out_indices[triangle * 3 + (k + 1) % 3]] == to)
+                    {
+                        return true;
+                    }
+                }
+            }
+            return false;
+        };
+
+        constexpr uint32 NoVertex = ~0u;
+        std::vector<uint8> kinds(num_vertices, EVertexKind_Manifold);
+        std::vector<uint32> border_next(num_vertices, NoVertex), border_prev(num_vertices, NoVertex);
+        std::vector<uint32> num_open(num_vertices, 0);
+        std::vector<Quadric> quadrics(num_vertices);
+        for (uint32 i = 0; i < out_indices.size(); i += 3)
+        {
+            uint32 corners[3] = { remap[out_indices[i]], remap[out_indices[i + 1]], remap[out_indices[i + 2]] };
+            Vec4f p0 = positions[corners[0]].ToVec4f(), p1 = positions[corners[1]].ToVec4f(), p2 = positions[corners[2]].ToVec4f();
+            Vec4f normal = (p1 - p0).Cross3(p2 - p0);
+            float area = normal.Length3().X();
+            if (area == 0)
+            {
+                continue;
+            }
+            normal = normal / area;
+
+            Quadric plane = Quadric::FromPlane(normal, -normal.Dot3(p0).X(), area * 0.5f);
+            for (uint32 k = 0; k < 3; k++)
+            {
+                quadrics[corners[k]] += plane;
+            }
+
+            for (uint32 k = 0; k < 3; k++)
+            {
+                uint32 from = corners[k], to = corners[(k + 1) % 3];
+                if (has_edge(to, from))
+                {
+                    continue;
+                }
+
+                // the plane through the open edge perpendicular to the triangle
+                Vec4f pa = positions[from].ToVec4f(), pb = positions[to].ToVec4f();
+                Vec4f edge = pb - pa;
+                float length = edge.Length3().X();
+                Vec4f edge_normal = edge.Cross3(normal).Normalize3();
+                Quadric border = Quadric::FromPlane(edge_normal, -edge_normal.Dot3(pa).X(), length * length * BorderWeight);
+                quadrics[from] += border;
+                quadrics[to] += border;
+
+                border_next[from] = to;
+                border_prev[to] = from;
+                num_open[from]++;
+                num_open[to]++;
+            }
+        }
+
+        for (uint32 v : order)
+        {
+            uint32 position = remap[v];
+            if (locked_vertices.size() > vertex_begin + v && locked_vertices[vertex_begin + v])
+            {
+                kinds[position] = EVertexKind_Locked;
+            }
+        }
+        for (uint32 v : order)
+        {
+            if (remap[v] != v || kinds[v] == EVertexKind_Locked)
+            {
+                continue;
+            }
+
+            // a border vertex has exactly one open edge in and one out
+            if (num_wedges[v] > 1 || (num_open[v] != 0 && num_open[v] != 2) || (num_open[v] == 2 && (border_next[v] == NoVertex || border_prev[v] == NoVertex)))
+            {
+                kinds[v] = EVertexKind_Locked;
+            }
+            else if (num_open[v] == 2)
+            {
+                kinds[v] = EVertexKind_Border;
+            }
+        }
+
+        struct Collapse
+        {
+            uint32 From;    // position
+            uint32 To;      // vertex, its attributes are kept
+            float Error;
+        };
+
+        auto can_collapse = [&](uint32 from, uint32 to)
+        {
+            switch (kinds[from])
+            {
+            case EVertexKind_Manifold:
+                return true;
+            case EVertexKind_Border:
+                return to == border_next[from] || to == border_prev[from];
+            default:
+                return false;
+            }
+        };
+
+        // moving @from onto @to shouldn't turn the triangles around it by more than about 75 degrees, nor away from the normals of their corners.
+        // the second test stops the triangles from folding over after several passes
+        auto has_flip = [&](uint32 from, uint32 to)
+        {
+            Vec4f target = positions[to].ToVec4f();
+            for (uint32 triangle : around.Around(from))
+            {
+                uint32 corners[3] = { remap[out_indices[triangle * 3]], remap[out_indices[triangle * 3 + 1]], remap[out_indices[triangle * 3 + 2]] };
+                if (corners[0] == to || corners[1] == to || corners[2] == to)
+                {
+                    continue;
+                }
+
+                uint32 k = corners[0] == from ? 0 : (corners[1] == from ? 1 : 2);
+                Vec4f pa = positions[corners[k]].ToVec4f(), pb = positions[corners[(k + 1) % 3]].ToVec4f(), pc = positions[corners[(k + 2) % 3]].ToVec4f();
+                Vec4f before = (pb - pa).Cross3(pc - pa);
+                Vec4f after = (pb - target).Cross3(pc - target);
+                if (before.Dot3(after).X() <= 0.25f * std::sqrt(before.Dot3(before).X() * after.Dot3(after).X()))
+                {
+                    return true;
+                }
+
+                const Vector3& na = vertices[vertex_begin + to].Normal;
+                const Vector3& nb = vertices[vertex_begin + corners[(k + 1) % 3]].Normal;
+                const Vector3& nc = vertices[vertex_begin + corners[(k + 2) % 3]].Normal;
+                if (after.Dot3(na.ToVec4f()).X() < 0 || after.Dot3(nb.ToVec4f()).X() < 0 || after.Dot3(nc.ToVec4f()).X() < 0)
+                {
+                    return true;
+                }
+            }
+            return false;
+        };
+
+        float error_limit = target_error * inv_scale;
+        error_limit = error_limit * error_limit;
+        float result_error = 0;
+
+        std::vector<Collapse> collapses;
+        std::vector<uint32> collapse_target(num_vertices, NoVertex);
+        std::vector<uint8> touched(num_vertices, 0);
+        while (out_indices.size() > target_index_count)
+        {
+            // the cheaper direction of each edge, the inner edges are visited from both sides
+            collapses.clear();
+            for (uint32 i = 0; i < out_indices.size(); i += 3)
+            {
+                for (uint32 k = 0; k < 3; k++)
+                {
+                    uint32 v0 = out_indices[i + k], v1 = out_indices[i + (k + 1) % 3];
+                    uint32 p0 = remap[v0], p1 = remap[v1];
+                    if (p0 > p1 && border_next[p0] != p1)
+                    {
+                        continue;
+                    }
+
+                    float error01 = can_collapse(p0, p1) ? quadrics[p0].Error(positions[p1]) : FLT_MAX;
+                    float error10 = can_collapse(p1, p0) ? quadrics[p1].Error(positions[p0]) : FLT_MAX;
+                    float error = std::min(error01, error10);
+                    if (error != FLT_MAX && error <= error_limit)
+                    {
+                        collapses.push_back(error01 <= error10 ? Collapse{ p0, v1, error01 } : Collapse{ p1, v0, error10 });
+                    }
+                }
+            }
+
+            // a manifold collapse removes two triangles, a border one removes one. the triangles around a collapsed vertex don't change
+            // again in the same pass, so the collapses blocked by a previous one are not replaced by much worse ones, they wait for the next pass.
+            // only the collapses below the error goal are sorted
+            uint32 triangle_goal = static_cast<uint32>(out_indices.size() - target_index_count) / 3;
+            uint32 collapse_goal = triangle_goal / 2;
+            float error_goal = FLT_MAX;
+            if (collapse_goal < collapses.size())
+            {
+                std::nth_element(collapses.begin(), collapses.begin() + collapse_goal, collapses.end(), [](const Collapse& a, const Collapse& b) { return a.Error < b.Error; });
+                error_goal = collapses[collapse_goal].Error * 1.5f;
+            }
+
+            uint32 num_removed = 0;
+            std::fill(touched.begin(), touched.end(), 0);
+            auto perform_collapses = [&](auto begin, auto end)
+            {
+                std::sort(begin, end, [](const Collapse& a, const Collapse& b) { return a.Error < b.Error; });
+                for (auto collapse = begin; collapse != end && num_removed < triangle_goal; collapse++)
+                {
+                    uint32 from = collapse->From, to = remap[collapse->To];
+                    if (touched[from] || touched[to] || has_flip(from, to))
+                    {
+                        continue;
+                    }
+
+                    collapse_target[from] = collapse->To;
+                    quadrics[to] += quadrics[from];
+                    if (kinds[from] == EVertexKind_Border)
+                    {
+                        uint32 prev = border_prev[from], next = border_next[from];
+                        if (to == next)
+                        {
+                            border_prev[to] = prev;
+                            border_next[prev] = to;
+                        }
+                        else
+                        {
+                            border_next[to] = next;
+                            border_prev[next] = to;
+                        }
+                    }
+
+                    for (uint32 triangle : around.Around(from))
+                    {
+                        touched[remap[out_indices[triangle * 3]]] = touched[remap[out_indices[triangle * 3 + 1]]] = touched[remap[out_indices[triangle * 3 + 2]]] = 1;
+                    }
+                    result_error = std::max(result_error, collapse->Error);
+                    num_removed += kinds[from] == EVertexKind_Border ? 1 : 2;
+                }
+            };
+
+            auto below_goal = std::partition(collapses.begin(), collapses.end(), [error_goal](const Collapse& collapse) { return collapse.Error <= error_goal; });
+            perform_collapses(collapses.begin(), below_goal);
+
+            // all the cheap collapses would fold a triangle, go on with the expensive ones
+            if (num_removed == 0)
+            {
+                perform_collapses(below_goal, collapses.end());
+            }
+
+            if (num_removed == 0)
+            {
+                break;
+            }
+
+            // the collapsed vertices only have one wedge, the triangles with two corners at the same position are removed
+            uint32 num_indices = 0;
+            for (uint32 i = 0; i < out_indices.size(); i += 3)
+            {
+                uint32 triangle[3];
+                for (uint32 k = 0; k < 3; k++)
+                {
+                    uint32 v = out_indices[i + k];
+                    triangle[k] = collapse_target[v] != NoVertex ? collapse_target[v] : v;
+                }
+
+                uint32 p0 = remap[triangle[0]], p1 = remap[triangle[1]], p2 = remap[triangle[2]];
+                if (p0 != p1 && p1 != p2 && p0 != p2)
+                {
+                    out_indices[num_indices++] = triangle[0];
+                    out_indices[num_indices++] = triangle[1];
+                    out_indices[num_indices++] = triangle[2];
+                }
+            }
+            out_indices.resize(num_indices);
+
+            for (uint32 v = 0; v < num_vertices; v++)
+            {
+                collapse_target[v] = NoVertex;
+            }
+            around = VertexTriangles(out_indices, remap, num_vertices);
+        }
+
+        for (uint32& index : out_indices)
+        {
+            index += vertex_begin;
+        }
+        return std::sqrt(result_error) * scale;
+    }
+
+    void MeshSimplifier::BuildLods(const std::vector<StandardVertex>& vertices, std::vector<uint32>& indices, const std::vector<SubMeshData>& sub_meshes,
+        std::span<const float> ratios, MeshLodChunk& out_lods)
+    {
+        out_lods = MeshLodChunk{};
+        if (vertices.empty() || sub_meshes.empty() || ratios.empty())
+        {
+            return;
+        }
+
+        // the positions referenced by more than one sub mesh are on the seams between them
+        uint32 num_vertices = static_cast<uint32>(vertices.size());
+        std::vector<uint32> order(num_vertices);
+        std::iota(order.begin(), order.end(), 0);
+        std::vector<uint32> remap(num_vertices, 0);
+        RemapPositions(vertices, 0, order, remap);
+
+        constexpr uint32 NoSubMesh = ~0u;
+        std::vector<uint32> owners(num_vertices, NoSubMesh);
+        std::vector<uint8> locked(num_vertices, 0);
+        for (uint32 i = 0; i < sub_meshes.size(); i++)
+        {
+            for (uint32 k = sub_meshes[i].Index; k < sub_meshes[i].Index + sub_meshes[i].IndicesCount; k++)
+            {
+                uint32 position = remap[indices[k]];
+                if (owners[position] == NoSubMesh)
+                {
+                    owners[position] = i;
+                }
+                else if (owners[position] != i)
+                {
+                    locked[position] = 1;
+                }
+            }
+        }
+        for (uint32 v = 0; v < num_vertices; v++)
+        {
+            locked[v] = locked[remap[v]];
+        }
+
+        AABB bound(vertices[0].Position, vertices[0].Position);
+        for (const StandardVertex& vertex : vertices)
+        {
+            bound.Min = Vector3::Min(bound.Min, vertex.Position);
+            bound.Max = Vector3::Max(bound.Max, vertex.Position);
+        }
+        float diameter = (bound.Max - bound.Min).Length();
+
+        uint32 num_sub_meshes = static_cast<uint32>(sub_meshes.size());
+        std::vector<std::vector<uint32>> lod_indices(num_sub_meshes);
+        uint32 previous_count = 0;
+        for (uint32 i = 0; i < num_sub_meshes; i++)
+        {
+            lod_indices[i].assign(indices.begin() + sub_meshes[i].Index, indices.begin() + sub_meshes[i].Index + sub_meshes[i].IndicesCount);
+            previous_count += sub_meshes[i].IndicesCount;
+        }
+
+        TaskScheduler& scheduler = TaskScheduler::Instance();
+        std::vector<float> errors(num_sub_meshes, 0);
+        float previous_error = 0;
+        float previous_screen_size = 1;
+        for (float ratio : ratios)
+        {
+            // each lod simplifies the previous one, so their errors add up
+            JobHandle simplify = scheduler.ParallelFor(num_sub_meshes, 1,
+                [&](uint32 begin, uint32 end)
+                {
+                    for (uint32 i = begin; i < end; i++)
+                    {
+                        uint32 target = static_cast<uint32>(sub_meshes[i].IndicesCount * ratio) / 3 * 3;
+                        std::vector<uint32> simplified;
+                        errors[i] = Simplify(vertices, lod_indices[i], target, FLT_MAX, simplified, locked);
+                        MeshOptimizer::OptimizeVertexCache(simplified);
+                        lod_indices[i] = std::move(simplified);
+                    }
+                }
+            );
+            scheduler.Wait(simplify);
+
+            uint32 lod_count = 0;
+            for (const std::vector<uint32>& sub_mesh : lod_indices)
+            {
+                lod_count += static_cast<uint32>(sub_mesh.size());
+            }
+            if (lod_count > previous_count * (1 - MinLodReduction))
+            {
+                break;
+            }
+
+            for (const std::vector<uint32>& sub_mesh : lod_indices)
+            {
+                out_lods.SubMeshes.push_back(SubMeshData{ .Index = static_cast<uint32>(indices.size()), .IndicesCount = static_cast<uint32>(sub_mesh.size()) });
+                indices.insert(indices.end(), sub_mesh.begin(), sub_mesh.end());
+            }
+
+            // the lod is drawn when its error projects to less than @MaxPixelError, and no earlier than its share of the triangles
+            float error = previous_error + *std::max_element(errors.begin(), errors.end());
+            float screen_size = std::min(ratio, previous_screen_size);
+            if (error > 0 && diameter > 0)
+            {
+                screen_size = std::min(screen_size, MaxPixelError * diameter / (error * ReferenceScreenHeight));
+            }
+            out_lods.Lods.push_back(MeshLodData{ .ScreenSize = screen_size, .Error = error });
+
+            previous_count = lod_count;
+            previous_error = error;
+            previous_screen_size = screen_size;
+        }
+    }
+}
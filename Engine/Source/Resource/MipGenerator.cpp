@@ -0,0 +1,411 @@
+#include "Resource/MipGenerator.h"
+#include "Utils/MathLib.h"
+#include "Utils/Thread.h"
+
+#include <immintrin.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace MRenderer
+{
+    enum EMipTexel
+    {
+        EMipTexel_Byte,
+        EMipTexel_Half,
+        EMipTexel_Float,
+    };
+
+    struct MipFormat
+    {
+        EMipTexel Texel;
+        uint32 NumChannels;
+        uint32 PixelSize;
+    };
+
+    static bool GetMipFormat(ETextureFormat format, MipFormat& out_format)
+    {
+        switch (format)
+        {
+        case ETextureFormat_R8G8B8A8_UNORM:
+            out_format = { EMipTexel_Byte, 4, 4 };
+            return true;
+        case ETextureFormat_R8G8_UNORM:
+            out_format = { EMipTexel_Byte, 2, 2 };
+            return true;
+        case ETextureFormat_R8_UNORM:
+            out_format = { EMipTexel_Byte, 1, 1 };
+            return true;
+        case ETextureFormat_R16G16B16A16_FLOAT:
+            out_format = { EMipTexel_Half, 4, 8 };
+            return true;
+        case ETextureFormat_R32G32B32A32_FLOAT:
+            out_format = { EMipTexel_Float, 4, 16 };
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    // the weights of the source texels 2x + Offset + i of the destination texel x, the same for every texel since the mips halve
+    struct MipKernel
+    {
+        static constexpr uint32 MaxTaps = 12;
+
+        int32 Offset;
+        uint32 NumTaps;
+        float Weights[MaxTaps];
+    };
+
+    static double Sinc(double x)
+    {
+        return std::abs(x) < 1e-6 ? 1.0 : std::sin(PI * x) / (PI * x);
+    }
+
+    // the modified bessel function of the first kind of order 0, by its power series
+    static double BesselI0(double x)
+    {
+        double sum = 1.0;
+        double term = 1.0;
+        for (uint32 k = 1; k < 32 && term > sum * 1e-12; k++)
+        {
+            term *= (x * x / 4.0) / (k * k);
+            sum += term;
+        }
+        return sum;
+    }
+
+    // the windowed sincs are sampled at the centers of the source texels, in texels of the destination mip, and normalized so a flat
+    // texture stays flat
+    // ref: https://github.com/castano/nvidia-texture-tools/blob/master/src/nvimage/Filter.cpp
+    static MipKernel BuildKernel(EMipFilter filter)
+    {
+        constexpr double Radius = 3.0;
+        constexpr double KaiserAlpha = 4.0;
+
+        MipKernel kernel;
+        if (filter == EMipFilter_Box)
+        {
+            kernel.Offset = 0;
+            kernel.NumTaps = 2;
+            kernel.Weights[0] = kernel.Weights[1] = 0.5f;
+            return kernel;
+        }
+
+        kernel.Offset = 1 - static_cast<int32>(2 * Radius);
+        kernel.NumTaps = MipKernel::MaxTaps;
+
+        double weights[MipKernel::MaxTaps];
+        double sum = 0.0;
+        for (uint32 i = 0; i < kernel.NumTaps; i++)
+        {
+            double x = (kernel.Offset + static_cast<int32>(i) - 0.5) / 2.0;
+            double window = filter == EMipFilter_Kaiser ? BesselI0(KaiserAlpha * std::sqrt(std::max(1.0 - (x / Radius) * (x / Radius), 0.0))) / BesselI0(KaiserAlpha) : Sinc(x / Radius);
+            weights[i] = Sinc(x) * window;
+            sum += weights[i];
+        }
+
+        for (uint32 i = 0; i < kernel.NumTaps; i++)
+        {
+            kernel.Weights[i] = static_cast<float>(weights[i] / sum);
+        }
+        return kernel;
+    }
+
+    static const MipKernel& GetKernel(EMipFilter filter)
+    {
+        static const MipKernel Kernels[EMipFilter_Count] = { BuildKernel(EMipFilter_Box), BuildKernel(EMipFilter_Kaiser), BuildKernel(EMipFilter_Lanczos) };
+        return Kernels[filter];
+    }
+
+    // the 8 bits values to linear floats, and the linear floats quantized to 12 bits back to 8 bits srgb
+    // ref: https://en.wikipedia.org/wiki/SRGB
+    struct MipConversionTables
+    {
+        static constexpr uint32 EncodeSteps = 4096;
+
+        MipConversionTables()
+        {
+            for (uint32 i = 0; i < 256; i++)
+            {
+                float value = i / 255.0f;
+                Linear[i] = value;
+                SRGBToLinear[i] = value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+            }
+
+            for (uint32 i = 0; i < EncodeSteps; i++)
+            {
+                float value = static_cast<float>(i) / (EncodeSteps - 1);
+                float srgb = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+                LinearToSRGB[i] = static_cast<uint8>(std::lround(std::clamp(srgb, 0.0f, 1.0f) * 255.0f));
+            }
+        }
+
+        float Linear[256];
+        float SRGBToLinear[256];
+        uint8 LinearToSRGB[EncodeSteps];
+    };
+
+    static const MipConversionTables& GetConversionTables()
+    {
+        static const MipConversionTables Tables;
+        return Tables;
+    }
+
+    // a mip and the one it's filtered from
+    struct MipLevel
+    {
+        const uint8* Source;
+        uint8* Destination;
+        uint32 SourceWidth;
+        uint32 SourceHeight;
+        uint32 Width;
+    };
+
+    // the source rows of a band in floats and the rows around a row filtered vertically, reused by every band a worker filters
+    static thread_local std::vector<float> tSourceRows;
+    static thread_local std::vector<float> tFilteredRow;
+
+    // the floats of a source row of bytes or halves
+    static void LoadRow(const uint8* row, uint32 num_values, const MipFormat& format, bool srgb, float* out_values)
+    {
+        if (format.Texel == EMipTexel_Half)
+        {
+            const uint16* halves = reinterpret_cast<const uint16*>(row);
+            for (uint32 i = 0; i < num_values; i++)
+            {
+                out_values[i] = HalfToFloat(halves[i]);
+            }
+            return;
+        }
+
+        const MipConversionTables& tables = GetConversionTables();
+        const float* color_table = srgb ? tables.SRGBToLinear : tables.Linear;
+        for (uint32 i = 0; i < num_values; i++)
+        {
+            // the alpha is linear
+            bool alpha = format.NumChannels == 4 && (i & 3) == 3;
+            out_values[i] = alpha ? tables.Linear[row[i]] : color_table[row[i]];
+        }
+    }
+
+    // @out_values += @weight * @values
+    static void Accumulate(const float* values, float weight, uint32 num_values, float* out_values)
+    {
+        uint32 i = 0;
+#if defined(__AVX__)
+        __m256 weights = _mm256_set1_ps(weight);
+        for (; i + 8 <= num_values; i += 8)
+        {
+            __m256 sum = _mm256_add_ps(_mm256_loadu_ps(out_values + i), _mm256_mul_ps(_mm256_loadu_ps(values + i), weights));
+            _mm256_storeu_ps(out_values + i, sum);
+        }
+#else
+        __m128 weights = _mm_set1_ps(weight);
+        for (; i + 4 <= num_values; i += 4)
+        {
+            __m128 sum = _mm_add_ps(_mm_loadu_ps(out_values + i), _mm_mul_ps(_mm_loadu_ps(values + i), weights));
+            _mm_storeu_ps(out_values + i, sum);
+        }
+#endif
+        for (; i < num_values; i++)
+        {
+            out_values[i] += values[i] * weight;
+        }
+    }
+
+    static void StorePixel(const float* values, const MipFormat& format, bool srgb, uint8* out_pixel)
+    {
+        switch (format.Texel)
+        {
+        case EMipTexel_Byte:
+        {
+            const MipConversionTables& tables = GetConversionTables();
+            for (uint32 c = 0; c < format.NumChannels; c++)
+            {
+                float value = std::clamp(values[c], 0.0f, 1.0f);
+                bool alpha = format.NumChannels == 4 && c == 3;
+                out_pixel[c] = srgb && !alpha ? tables.LinearToSRGB[static_cast<uint32>(value * (MipConversionTables::EncodeSteps - 1) + 0.5f)] : static_cast<uint8>(value * 255.0f + 0.5f);
+            }
+            break;
+        }
+        case EMipTexel_Half:
+        {
+            uint16* halves = reinterpret_cast<uint16*>(out_pixel);
+            for (uint32 c = 0; c < format.NumChannels; c++)
+            {
+                halves[c] = FloatToHalf(values[c]);
+            }
+            break;
+        }
+        default:
+            memcpy(out_pixel, values, format.NumChannels * sizeof(float));
+            break;
+        }
+    }
+
+    // filter the rows [@begin, @end) of a mip. the source rows the band reads are converted to floats once, then the ones around each row
+    // are filtered vertically into a row of floats, and its texels around each destination texel horizontally
+    static void FilterRows(const MipLevel& level, const MipFormat& format, const MipKernel& kernel, bool srgb, uint32 begin, uint32 end)
+    {
+        int32 last_row = static_cast<int32>(level.SourceHeight) - 1;
+        int32 first_source = std::clamp(static_cast<int32>(2 * begin) + kernel.Offset, 0, last_row);
+        int32 last_source = std::clamp(static_cast<int32>(2 * (end - 1) + kernel.NumTaps - 1) + kernel.Offset, 0, last_row);
+
+        uint32 num_values = level.SourceWidth * format.NumChannels;
+        uint32 num_source_values = (last_source - first_source + 1) * num_values;
+        if (tFilteredRow.size() < num_values)
+        {
+            tFilteredRow.resize(num_values);
+        }
+
+        // the float textures are filtered in place
+        const float* source_rows = reinterpret_cast<const float*>(level.Source) + first_source * num_values;
+        if (format.Texel != EMipTexel_Float)
+        {
+            if (tSourceRows.size() < num_source_values)
+            {
+                tSourceRows.resize(num_source_values);
+            }
+
+            for (int32 row = first_source; row <= last_source; row++)
+            {
+                LoadRow(level.Source + row * level.SourceWidth * format.PixelSize, num_values, format, srgb, tSourceRows.data() + (row - first_source) * num_values);
+            }
+            source_rows = tSourceRows.data();
+        }
+
+        float* filtered = tFilteredRow.data();
+        int32 last_column = static_cast<int32>(level.SourceWidth) - 1;
+        for (uint32 y = begin; y < end; y++)
+        {
+            memset(filtered, 0, num_values * sizeof(float));
+            for (uint32 i = 0; i < kernel.NumTaps; i++)
+            {
+                int32 source_y = std::clamp(static_cast<int32>(2 * y + i) + kernel.Offset, 0, last_row);
+                Accumulate(source_rows + (source_y - first_source) * num_values, kernel.Weights[i], num_values, filtered);
+            }
+
+            uint8* destination = level.Destination + y * level.Width * format.PixelSize;
+            for (uint32 x = 0; x < level.Width; x++)
+            {
+                // only the taps of the texels at the edges are clamped
+                int32 first_tap = static_cast<int32>(2 * x) + kernel.Offset;
+                bool inside = first_tap >= 0 && first_tap + static_cast<int32>(kernel.NumTaps) - 1 <= last_column;
+
+                alignas(16) float pixel[4] = {};
+                if (format.NumChannels == 4)
+                {
+                    __m128 sum = _mm_setzero_ps();
+                    for (uint32 i = 0; i < kernel.NumTaps; i++)
+                    {
+                        int32 source_x = inside ? first_tap + i : std::clamp(first_tap + static_cast<int32>(i), 0, last_column);
+                        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(filtered + source_x * 4), _mm_set1_ps(kernel.Weights[i])));
+                    }
+                    _mm_store_ps(pixel, sum);
+                }
+                else
+                {
+                    for (uint32 i = 0; i < kernel.NumTaps; i++)
+                    {
+                        int32 source_x = inside ? first_tap + i : std::clamp(first_tap + static_cast<int32>(i), 0, last_column);
+                        for (uint32 c = 0; c < format.NumChannels; c++)
+                        {
+                            pixel[c] += filtered[source_x * format.NumChannels + c] * kernel.Weights[i];
+                        }
+                    }
+                }
+                StorePixel(pixel, format, srgb, destination + x * format.PixelSize);
+            }
+        }
+    }
+
+    // the mips of @num_chains chains of the same size, one mip level of all of them at a time since each mip is filtered from the previous one
+    static void GenerateChains(uint8* const* chains, uint32 num_chains, uint32 width, uint32 height, uint32 mip_levels, ETextureFormat format, EMipFilter filter, bool srgb)
+    {
+        MipFormat mip_format;
+        bool supported = GetMipFormat(format, mip_format);
+        ASSERT(supported && "the mips of the format aren't generated on the cpu");
+
+        const MipKernel& kernel = GetKernel(filter);
+        TaskScheduler& scheduler = TaskScheduler::Instance();
+        for (uint32 mip = 1; mip < mip_levels; mip++)
+        {
+            MipmapLayout source = CalculateMipmapLayout(width, height, mip_levels, mip_format.PixelSize, mip - 1);
+            MipmapLayout destination = CalculateMipmapLayout(width, height, mip_levels, mip_format.PixelSize, mip);
+
+            scheduler.Wait(scheduler.ParallelFor(num_chains * destination.Height, MipGenerator::RowsPerJob,
+                [&](uint32 begin, uint32 end)
+                {
+                    // a band may run over the end of a chain into the next one
+                    while (begin < end)
+                    {
+                        uint32 chain_index = begin / destination.Height;
+                        uint32 band_end = std::min(end, (chain_index + 1) * destination.Height);
+
+                        uint8* chain = chains[chain_index];
+                        MipLevel level{ chain + source.BaseOffset, chain + destination.BaseOffset, source.Width, source.Height, destination.Width };
+                        FilterRows(level, mip_format, kernel, srgb, begin % destination.Height, band_end - chain_index * destination.Height);
+                        begin = band_end;
+                    }
+                }
+            ));
+        }
+    }
+
+    std::string_view GetMipFilterName(EMipFilter filter)
+    {
+        switch (filter)
+        {
+        case EMipFilter_Box:
+            return "Box";
+        case EMipFilter_Kaiser:
+            return "Kaiser";
+        case EMipFilter_Lanczos:
+            return "Lanczos";
+        default:
+            return "None";
+        }
+    }
+
+    bool MipGenerator::IsSupported(ETextureFormat format)
+    {
+        MipFormat mip_format;
+        return GetMipFormat(format, mip_format);
+    }
+
+    void MipGenerator::Generate(void* mip_chain, uint32 width, uint32 height, uint32 mip_levels, ETextureFormat format, EMipFilter filter, bool srgb)
+    {
+        uint8* chain = static_cast<uint8*>(mip_chain);
+        GenerateChains(&chain, 1, width, height, mip_levels, format, filter, srgb);
+    }
+
+    void MipGenerator::Generate(TextureData& texture, EMipFilter filter, bool srgb)
+    {
+        ASSERT(!texture.mData.IsView() && "the mips are written in place");
+        Generate(texture.mData.GetData(), texture.Width(), texture.Height(), texture.MipLevels(), texture.Format(), filter, srgb);
+    }
+
+    void MipGenerator::GenerateCubeMap(const std::array<void*, NumCubeMapFaces>& mip_chains, uint32 width, uint32 height, uint32 mip_levels, ETextureFormat format,
+        EMipFilter filter, bool srgb)
+    {
+        uint8* chains[NumCubeMapFaces];
+        for (uint32 i = 0; i < NumCubeMapFaces; i++)
+        {
+            chains[i] = static_cast<uint8*>(mip_chains[i]);
+        }
+        GenerateChains(chains, NumCubeMapFaces, width, height, mip_levels, format, filter, srgb);
+    }
+
+    void MipGenerator::GenerateCubeMap(std::array<TextureData, NumCubeMapFaces>& faces, EMipFilter filter, bool srgb)
+    {
+        std::array<void*, NumCubeMapFaces> mip_chains;
+        for (uint32 i = 0; i < NumCubeMapFaces; i++)
+        {
+            ASSERT(faces[i].mInfo == faces[0].mInfo && !faces[i].mData.IsView());
+            mip_chains[i] = faces[i].mData.GetData();
+        }
+        GenerateCubeMap(mip_chains, faces[0].Width(), faces[0].Height(), faces[0].MipLevels(), faces[0].Format(), filter, srgb);
+    }
+}
@@ -0,0 +1,441 @@
+#include "Resource/ObjParser.h"
+#include "Utils/Misc.h"
+#include "Utils/Thread.h"
+
+#include <atomic>
+#include <charconv>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+namespace MRenderer
+{
+    // parse result of a part of the file, indices are global except the ones listed in @RelativeCorners
+    struct ObjChunk
+    {
+        std::vector<float> Positions;
+        std::vector<float> Normals;
+        std::vector<float> TexCoords;
+
+        // corners of all faces, the corners of face i are [@FaceEnds[i - 1], @FaceEnds[i])
+        std::vector<ObjIndex> Corners;
+        std::vector<uint32> FaceEnds;
+
+        // index of @MaterialNames for each face, -1 means the material set by the previous chunks
+        std::vector<int32> FaceMaterials;
+        std::vector<std::string> MaterialNames;
+        std::vector<std::string> MaterialLibs;
+
+        // corner * 3 + component of the negative indices, they are relative to the beginning of the chunk before merging
+        std::vector<uint32> RelativeCorners;
+
+        uint32 NumTriangles = 0;
+
+        // offsets in the merged arrays
+        uint32 PositionBase = 0;
+        uint32 NormalBase = 0;
+        uint32 TexCoordBase = 0;
+        uint32 TriangleBase = 0;
+
+        // material in effect at the beginning of the chunk, and the global material id of each of @MaterialNames
+        int32 InheritedMaterial = -1;
+        std::vector<int32> MaterialIds;
+    };
+
+    static inline bool IsSpace(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    static inline const char* SkipSpace(const char* p, const char* end)
+    {
+        while (p < end && IsSpace(*p))
+        {
+            p++;
+        }
+        return p;
+    }
+
+    static inline const char* ParseFloat(const char* p, const char* end, float& out)
+    {
+        p = SkipSpace(p, end);
+        if (p < end && *p == '+')
+        {
+            p++;
+        }
+
+        auto result = std::from_chars(p, end, out);
+        if (result.ec != std::errc())
+        {
+            out = 0;
+        }
+        return result.ptr;
+    }
+
+    static inline const char* ParseInt(const char* p, const char* end, int32& out)
+    {
+        if (p < end && *p == '+')
+        {
+            p++;
+        }
+
+        auto result = std::from_chars(p, end, out);
+        if (result.ec != std::errc())
+        {
+            out = 0;
+        }
+        return result.ptr;
+    }
+
+    // the rest of the line with the surrounding spaces trimmed
+    static inline std::string_view ParseName(const char* p, const char* end)
+    {
+        p = SkipSpace(p, end);
+        while (end > p && IsSpace(end[-1]))
+        {
+            end--;
+        }
+        return std::string_view(p, end - p);
+    }
+
+    // parse the lines in [@begin, @end)
+    static void ParseChunk(const char* begin, const char* end, ObjChunk& chunk)
+    {
+        // an index of the i-th component of the corner, 1 based or negative
+        auto add_index = [&chunk](int32 index, uint32 component, uint32 count) -> int32
+        {
+            if (index > 0)
+            {
+                return index - 1;
+            }
+            else if (index < 0)
+            {
+                chunk.RelativeCorners.push_back(static_cast<uint32>(chunk.Corners.size()) * 3 + component);
+                return static_cast<int32>(count) + index;
+            }
+            return -1;
+        };
+
+        const char* line = begin;
+        while (line < end)
+        {
+            const char* line_end = static_cast<const char*>(memchr(line, '\n', end - line));
+            line_end = line_end ? line_end : end;
+
+            const char* p = SkipSpace(line, line_end);
+            size_t length = line_end - p;
+
+            if (length >= 2 && p[0] == 'v' && IsSpace(p[1]))
+            {
+                float x, y, z;
+                p = ParseFloat(p + 2, line_end, x);
+                p = ParseFloat(p, line_end, y);
+                ParseFloat(p, line_end, z);
+                chunk.Positions.insert(chunk.Positions.end(), { x, y, z });
+            }
+            else if (length >= 3 && p[0] == 'v' && p[1] == 'n' && IsSpace(p[2]))
+            {
+                float x, y, z;
+                p = ParseFloat(p + 3, line_end, x);
+                p = ParseFloat(p, line_end, y);
+                ParseFloat(p, line_end, z);
+                chunk.Normals.insert(chunk.Normals.end(), { x, y, z });
+            }
+            else if (length >= 3 && p[0] == 'v' && p[1] == 't' && IsSpace(p[2]))
+            {
+                float u, v;
+                p = ParseFloat(p + 3, line_end, u);
+                ParseFloat(p, line_end, v);
+                chunk.TexCoords.insert(chunk.TexCoords.end(), { u, v });
+            }
+            else if (length >= 2 && p[0] == 'f' && IsSpace(p[1]))
+            {
+                uint32 face_begin = static_cast<uint32>(chunk.Corners.size());
+                p = SkipSpace(p + 2, line_end);
+                while (p < line_end)
+                {
+                    // v, v/vt, v//vn or v/vt/vn
+                    int32 v = 0, vt = 0, vn = 0;
+                    p = ParseInt(p, line_end, v);
+                    if (p < line_end && *p == '/')
+                    {
+                        p++;
+                        if (p < line_end && *p != '/')
+                        {
+                            p = ParseInt(p, line_end, vt);
+                        }
+                        if (p < line_end && *p == '/')
+                        {
+                            p = ParseInt(p + 1, line_end, vn);
+                        }
+                    }
+
+                    ObjIndex corner;
+                    corner.Position = add_index(v, 0, static_cast<uint32>(chunk.Positions.size() / 3));
+                    corner.TexCoord = add_index(vt, 1, static_cast<uint32>(chunk.TexCoords.size() / 2));
+                    corner.Normal = add_index(vn, 2, static_cast<uint32>(chunk.Normals.size() / 3));
+                    chunk.Corners.push_back(corner);
+
+                    // skip anything unexpected up to the next corner
+                    while (p < line_end && !IsSpace(*p))
+                    {
+                        p++;
+                    }
+                    p = SkipSpace(p, line_end);
+                }
+
+                uint32 num_corners = static_cast<uint32>(chunk.Corners.size()) - face_begin;
+                if (num_corners >= 3)
+                {
+                    chunk.FaceEnds.push_back(static_cast<uint32>(chunk.Corners.size()));
+                    chunk.FaceMaterials.push_back(chunk.MaterialNames.empty() ? -1 : static_cast<int32>(chunk.MaterialNames.size()) - 1);
+                    chunk.NumTriangles += num_corners - 2;
+                }
+                else
+                {
+                    // degenerated face, drop it together with its relative indices
+                    chunk.Corners.resize(face_begin);
+                    while (!chunk.RelativeCorners.empty() && chunk.RelativeCorners.back() >= face_begin * 3)
+                    {
+                        chunk.RelativeCorners.pop_back();
+                    }
+                }
+            }
+            else if (length > 7 && std::string_view(p, 6) == "usemtl" && IsSpace(p[6]))
+            {
+                chunk.MaterialNames.emplace_back(ParseName(p + 7, line_end));
+            }
+            else if (length > 7 && std::string_view(p, 6) == "mtllib" && IsSpace(p[6]))
+            {
+                chunk.MaterialLibs.emplace_back(ParseName(p + 7, line_end));
+            }
+
+            line = line_end + 1;
+        }
+    }
+
+    bool ObjParser::Load(std::string_view file_path, std::string_view material_folder, ObjMesh& out_mesh)
+    {
+        std::optional<std::ifstream> file = ReadFile(file_path, true);
+        if (!file)
+        {
+            Log("File :", file_path, "Is Not Exist");
+            return false;
+        }
+
+        file->seekg(0, std::ios::end);
+        std::string text(static_cast<size_t>(file->tellg()), '\0');
+        file->seekg(0, std::ios::beg);
+        file->read(text.data(), text.size());
+
+        return Parse(text, material_folder, out_mesh);
+    }
+
+    bool ObjParser::Parse(std::string_view text, std::string_view material_folder, ObjMesh& out_mesh)
+    {
+        TaskScheduler& scheduler = TaskScheduler::Instance();
+        uint32 size = static_cast<uint32>(text.size());
+        uint32 num_chunks = std::clamp(size / MinChunkSize, 1u, scheduler.GetJobSystem().NumWorkers() + 1);
+
+        // 1. split at line boundaries and parse the chunks in parallel
+        std::vector<const char*> chunk_begins(num_chunks + 1);
+        chunk_begins[0] = text.data();
+        chunk_begins[num_chunks] = text.data() + size;
+        for (uint32 i = 1; i < num_chunks; i++)
+        {
+            const char* split = std::max(text.data() + static_cast<size_t>(size) * i / num_chunks, chunk_begins[i - 1]);
+            const char* line_end = static_cast<const char*>(memchr(split, '\n', chunk_begins[num_chunks] - split));
+            chunk_begins[i] = line_end ? line_end + 1 : chunk_begins[num_chunks];
+        }
+
+        std::vector<ObjChunk> chunks(num_chunks);
+        JobHandle parse = scheduler.ParallelFor(num_chunks, 1,
+            [&](uint32 begin, uint32 end)
+            {
+                for (uint32 i = begin; i < end; i++)
+                {
+                    ParseChunk(chunk_begins[i], chunk_begins[i + 1], chunks[i]);
+                }
+            }
+        );
+        scheduler.Wait(parse);
+
+        // 2. load the material libraries in the order they appear
+        ObjMesh& mesh = out_mesh;
+        mesh = ObjMesh();
+        std::map<std::string, int> material_map;
+        std::vector<std::string> loaded_libs;
+        for (const ObjChunk& chunk : chunks)
+        {
+            for (const std::string& lib : chunk.MaterialLibs)
+            {
+                if (std::find(loaded_libs.begin(), loaded_libs.end(), lib) != loaded_libs.end())
+                {
+                    continue;
+                }
+                loaded_libs.push_back(lib);
+
+                std::filesystem::path lib_path = std::filesystem::path(material_folder) / lib;
+                std::ifstream lib_file(lib_path, std::ios::binary);
+                if (!lib_file)
+                {
+                    Log("Material Library :", lib_path.string(), "Is Not Exist");
+                    continue;
+                }
+
+                std::string warn, err;
+                tinyobj::LoadMtl(&material_map, &mesh.Materials, &lib_file, &warn, &err);
+                mesh.MaterialLibPaths.push_back(lib_path.string());
+            }
+        }
+
+        // 3. prefix sum of the sizes and the materials in effect at the beginning of each chunk.
+        // faces without a known material use the default material at the end of @Materials
+        const int32 default_material = static_cast<int32>(mesh.Materials.size());
+        uint32 num_positions = 0, num_normals = 0, num_tex_coords = 0, num_triangles = 0;
+        int32 current_material = default_material;
+        for (ObjChunk& chunk : chunks)
+        {
+            chunk.PositionBase = num_positions;
+            chunk.NormalBase = num_normals;
+            chunk.TexCoordBase = num_tex_coords;
+            chunk.TriangleBase = num_triangles;
+            num_positions += static_cast<uint32>(chunk.Positions.size() / 3);
+            num_normals += static_cast<uint32>(chunk.Normals.size() / 3);
+            num_tex_coords += static_cast<uint32>(chunk.TexCoords.size() / 2);
+            num_triangles += chunk.NumTriangles;
+
+            chunk.InheritedMaterial = current_material;
+            for (const std::string& name : chunk.MaterialNames)
+            {
+                auto it = material_map.find(name);
+                chunk.MaterialIds.push_back(it != material_map.end() ? it->second : default_material);
+            }
+            if (!chunk.MaterialIds.empty())
+            {
+                current_material = chunk.MaterialIds.back();
+            }
+        }
+
+        mesh.Positions.resize(num_positions * 3);
+        mesh.Normals.resize(num_normals * 3);
+        mesh.TexCoords.resize(num_tex_coords * 2);
+        mesh.Indices.resize(num_triangles * 3);
+        mesh.MaterialIds.resize(num_triangles);
+
+        // 4. copy the attributes to the merged arrays, they must be complete before the quads are split
+        JobHandle copy = scheduler.ParallelFor(num_chunks, 1,
+            [&](uint32 begin, uint32 end)
+            {
+                for (uint32 i = begin; i < end; i++)
+                {
+                    const ObjChunk& chunk = chunks[i];
+                    std::copy(chunk.Positions.begin(), chunk.Positions.end(), mesh.Positions.begin() + chunk.PositionBase * 3);
+                    std::copy(chunk.Normals.begin(), chunk.Normals.end(), mesh.Normals.begin() + chunk.NormalBase * 3);
+                    std::copy(chunk.TexCoords.begin(), chunk.TexCoords.end(), mesh.TexCoords.begin() + chunk.TexCoordBase * 2);
+                }
+            }
+        );
+        scheduler.Wait(copy);
+
+        // 5. resolve the indices and the materials, then triangulate each chunk to its slots
+        std::atomic<bool> invalid_index = false;
+        std::atomic<bool> use_default_material = false;
+        JobHandle triangulate = scheduler.ParallelFor(num_chunks, 1,
+            [&](uint32 begin, uint32 end)
+            {
+                for (uint32 i = begin; i < end; i++)
+                {
+                    ObjChunk& chunk = chunks[i];
+
+                    const uint32 bases[3] = { chunk.PositionBase, chunk.TexCoordBase, chunk.NormalBase };
+                    for (uint32 slot : chunk.RelativeCorners)
+                    {
+                        reinterpret_cast<int32*>(chunk.Corners.data())[slot] += bases[slot % 3];
+                    }
+
+                    bool chunk_invalid_index = false;
+                    for (const ObjIndex& corner : chunk.Corners)
+                    {
+                        chunk_invalid_index |= corner.Position < 0 || static_cast<uint32>(corner.Position) >= num_positions;
+                        chunk_invalid_index |= corner.TexCoord >= static_cast<int32>(num_tex_coords) || corner.Normal >= static_cast<int32>(num_normals);
+                    }
+                    if (chunk_invalid_index)
+                    {
+                        invalid_index = true;
+                        continue;
+                    }
+
+                    ObjIndex* indices = mesh.Indices.data() + chunk.TriangleBase * 3;
+                    int32* material_ids = mesh.MaterialIds.data() + chunk.TriangleBase;
+                    uint32 face_begin = 0;
+                    for (uint32 face = 0; face < chunk.FaceEnds.size(); face++)
+                    {
+                        const ObjIndex* corners = chunk.Corners.data() + face_begin;
+                        uint32 num_corners = chunk.FaceEnds[face] - face_begin;
+                        face_begin = chunk.FaceEnds[face];
+
+                        int32 local_material = chunk.FaceMaterials[face];
+                        int32 material = local_material < 0 ? chunk.InheritedMaterial : chunk.MaterialIds[local_material];
+
+                        if (num_corners == 4)
+                        {
+                            // split along the shorter diagonal, same as tinyobj
+                            auto distance = [&](const ObjIndex& a, const ObjIndex& b)
+                            {
+                                const float* pa = mesh.Positions.data() + a.Position * 3;
+                                const float* pb = mesh.Positions.data() + b.Position * 3;
+                                float dx = pa[0] - pb[0], dy = pa[1] - pb[1], dz = pa[2] - pb[2];
+                                return dx * dx + dy * dy + dz * dz;
+                            };
+
+                            if (distance(corners[0], corners[2]) < distance(corners[1], corners[3]))
+                            {
+                                *indices++ = corners[0]; *indices++ = corners[1]; *indices++ = corners[2];
+                                *indices++ = corners[0]; *indices++ = corners[2]; *indices++ = corners[3];
+                            }
+                            else
+                            {
+                                *indices++ = corners[0]; *indices++ = corners[1]; *indices++ = corners[3];
+                                *indices++ = corners[1]; *indices++ = corners[2]; *indices++ = corners[3];
+                            }
+                        }
+                        else
+                        {
+                            for (uint32 k = 2; k < num_corners; k++)
+                            {
+                                *indices++ = corners[0]; *indices++ = corners[k - 1]; *indices++ = corners[k];
+                            }
+                        }
+
+                        for (uint32 k = 2; k < num_corners; k++)
+                        {
+                            *material_ids++ = material;
+                        }
+
+                        if (material == default_material)
+                        {
+                            use_default_material = true;
+                        }
+                    }
+                }
+            }
+        );
+        scheduler.Wait(triangulate);
+
+        if (invalid_index)
+        {
+            Log("Obj File Has Face With Invalid Vertex Index");
+            return false;
+        }
+
+        if (use_default_material)
+        {
+            mesh.Materials.emplace_back();
+            mesh.Materials.back().name = "default";
+        }
+
+        return true;
+    }
+}
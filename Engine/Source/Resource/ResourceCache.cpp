@@ -0,0 +1,176 @@
+#include "Resource/ResourceCache.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace MRenderer
+{
+    // orders the uses of the cached resources, the clock may give two the same time
+    static std::atomic<uint64> UseCounter = 0;
+
+    static inline uint64 NextUse()
+    {
+        return UseCounter.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+    std::string_view GetResourceCategoryName(EResourceCategory category)
+    {
+        switch (category)
+        {
+        case EResourceCategory_Mesh:
+            return "Mesh";
+        case EResourceCategory_Texture:
+            return "Texture";
+        case EResourceCategory_CubeMap:
+            return "CubeMap";
+        case EResourceCategory_Material:
+            return "Material";
+        case EResourceCategory_Model:
+            return "Model";
+        default:
+            return "Other";
+        }
+    }
+
+    ResourceCache::ResourceCache(uint64 budget/*=DefaultBudget*/)
+        :mBudget(budget)
+    {
+    }
+
+    std::shared_ptr<IResource> ResourceCache::Find(std::string_view repo_path)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        auto it = mEntries.find(std::string(repo_path));
+        if (it == mEntries.end())
+        {
+            mNumMisses++;
+            return nullptr;
+        }
+
+        mNumHits++;
+        return AcquireHandle(it->second);
+    }
+
+    std::shared_ptr<IResource> ResourceCache::Insert(std::string_view repo_path, std::shared_ptr<IResource> resource, EResourceCategory category)
+    {
+        ASSERT(resource);
+
+        std::shared_ptr<Entry> entry = std::make_shared<Entry>();
+        entry->Size = resource->GetResidentSize();
+        entry->Category = category;
+        entry->Resource = std::move(resource);
+
+        // a reloaded resource replaces the cached one, which is released after the lock
+        std::shared_ptr<Entry> replaced;
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        std::shared_ptr<Entry>& slot = mEntries[std::string(repo_path)];
+        if (slot)
+        {
+            mBytes -= slot->Size;
+            replaced = std::move(slot);
+        }
+
+        slot = entry;
+        mBytes += entry->Size;
+        return AcquireHandle(entry);
+    }
+
+    std::shared_ptr<IResource> ResourceCache::AcquireHandle(const std::shared_ptr<Entry>& entry)
+    {
+        entry->LastUse = NextUse();
+
+        std::shared_ptr<IResource> handle = entry->Handle.lock();
+        if (!handle)
+        {
+            // the handle doesn't own the resource, the entry does, so releasing the last one only makes the resource unreferenced
+            handle = std::shared_ptr<IResource>(entry->Resource.get(), HandleDeleter{ .Owner = entry });
+            entry->Handle = handle;
+        }
+        return handle;
+    }
+
+    void ResourceCache::HandleDeleter::operator()(IResource*) const
+    {
+        Owner->LastUse = NextUse();
+        Owner.reset();
+    }
+
+    uint32 ResourceCache::Trim()
+    {
+        uint32 num_evicted = 0;
+        while (true)
+        {
+            std::vector<std::shared_ptr<Entry>> evicted;
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+
+                uint64 budget = mBudget;
+                if (mBytes <= budget)
+                {
+                    break;
+                }
+
+                // nobody holds a handle nor the resource itself
+                std::vector<std::pair<uint64, decltype(mEntries)::iterator>> candidates;
+                for (auto it = mEntries.begin(); it != mEntries.end(); ++it)
+                {
+                    if (it->second->Handle.expired() && it->second->Resource.use_count() == 1)
+                    {
+                        candidates.emplace_back(it->second->LastUse.load(), it);
+                    }
+                }
+                std::sort(candidates.begin(), candidates.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+                for (uint32 i = 0; i < candidates.size() && mBytes > budget; i++)
+                {
+                    std::shared_ptr<Entry>& entry = candidates[i].second->second;
+                    mBytes -= entry->Size;
+                    mNumEvictions++;
+                    mEvictedBytes += entry->Size;
+
+                    evicted.push_back(std::move(entry));
+                    mEntries.erase(candidates[i].second);
+                }
+            }
+
+            if (evicted.empty())
+            {
+                break;
+            }
+
+            // a released model releases its mesh and materials, they may be evicted in the next pass
+            num_evicted += static_cast<uint32>(evicted.size());
+        }
+        return num_evicted;
+    }
+
+    ResourceCacheStats ResourceCache::GetStats()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        ResourceCacheStats stats{};
+        stats.Budget = mBudget;
+        stats.NumHits = mNumHits;
+        stats.NumMisses = mNumMisses;
+        stats.NumEvictions = mNumEvictions;
+        stats.EvictedBytes = mEvictedBytes;
+
+        for (const auto& [repo_path, entry] : mEntries)
+        {
+            ResourceCacheStats::Category& category = stats.Categories[entry->Category];
+            category.NumResources++;
+            category.Bytes += entry->Size;
+            stats.Bytes += entry->Size;
+
+            if (entry->Handle.expired())
+            {
+                category.NumUnreferenced++;
+                category.UnreferencedBytes += entry->Size;
+                stats.UnreferencedBytes += entry->Size;
+            }
+        }
+        return stats;
+    }
+}
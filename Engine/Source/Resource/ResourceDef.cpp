@@ -3,14 +3,16 @@
 #include "Utils/Serialization.h"
 #include "Resource/Shader.h"
 #include "Resource/ResourceLoader.h"
+#include "Resource/IBLBaker.h"
 #include "Resource/TextureCompression.h"
+#include "Resource/VertexCompression.h"
 #include "Renderer/Device/Direct12/D3D12Device.h"
 #include "Resource/json.hpp"
 #include "format"
 
 namespace MRenderer
 {
-    void MeshResource::AllocateGPUResource()
+    MeshData MeshResource::LoadMeshData()
     {
         MeshData mesh_data;
         ResourceLoader::Instance().LoadBinary(mesh_data, mMeshPath);
@@ -18,7 +20,40 @@ namespace MRenderer
         mBound = mesh_data.Bound();
         mVertexFormat = mesh_data.Format();
         mSubMeshes = mesh_data.GetSubMeshs();
+        mMeshlets = mesh_data.GetMeshlets();
+        mLods = mesh_data.GetLods();
+        mIndexFormat = mesh_data.GetIndexFormat();
+        mOccluderMesh = BuildOccluderMesh(mesh_data);
+
+        // the device buffers and the cpu side data
+        mResidentSize = sizeof(MeshResource) + mesh_data.Vertices().GetSize() + mesh_data.Indicies().GetSize() + mSubMeshes.size() * sizeof(SubMeshData) +
+            mMeshlets.size() * sizeof(MeshletData) + mLods.SubMeshes.size() * sizeof(SubMeshData) +
+            mOccluderMesh.Positions.size() * sizeof(float) + mOccluderMesh.Indices.size() * sizeof(uint32);
+        return mesh_data;
+    }
 
+    OccluderMesh MeshResource::BuildOccluderMesh(const MeshData& mesh_data)
+    {
+        // the lods appended to the index buffer would be rasterized twice
+        const std::vector<SubMeshData>& lod_sub_meshes = mesh_data.GetLods().SubMeshes;
+        uint32 num_indices = lod_sub_meshes.empty() ? mesh_data.IndiciesCount() : lod_sub_meshes[0].Index;
+
+        std::vector<Vector3> positions;
+        std::vector<uint32> indices;
+        VertexCompression::DecodePositions(mesh_data, positions);
+        VertexCompression::DecodeIndices(mesh_data, indices);
+
+        return OccluderMesh::FromVertices(
+            positions.data(),
+            static_cast<uint32>(positions.size()),
+            sizeof(Vector3),
+            indices.data(),
+            num_indices
+        );
+    }
+
+    void MeshResource::AllocateGPUResource(const MeshData& mesh_data)
+    {
         VertexDefination layout = GetVertexLayout(mesh_data.Format());
         mDeviceVertexBuffer = GD3D12ResourceAllocator->CreateVertexBuffer(
             mesh_data.Vertices().GetData(),
@@ -28,7 +63,8 @@ namespace MRenderer
 
         mDeviceIndexBuffer = GD3D12ResourceAllocator->CreateIndexBuffer(
             mesh_data.Indicies().GetData(),
-            mesh_data.Indicies().GetSize()
+            mesh_data.Indicies().GetSize(),
+            mesh_data.IndexStride()
         );
     }
 
@@ -37,24 +73,34 @@ namespace MRenderer
         :IResource(), mMeshPath(mesh_path)
     {
         SetRepoPath(repo_path);
-        AllocateGPUResource();
+        AllocateGPUResource(LoadMeshData());
     }
 
     void MeshResource::PostDeserialized()
     {
-        AllocateGPUResource();
+        std::shared_ptr<MeshData> mesh_data = std::make_shared<MeshData>(LoadMeshData());
+        ResourceLoader::Instance().DeferToDevice([this, mesh_data]() { AllocateGPUResource(*mesh_data); });
     }
 
     void TextureResource::PostDeserialized()
     {
-        AllocateGPUResource();
+        std::shared_ptr<TextureData> tex = std::make_shared<TextureData>(LoadTextureData());
+        ResourceLoader::Instance().DeferToDevice([this, tex]() { AllocateGPUResource(*tex); });
     }
 
-    void TextureResource::AllocateGPUResource()
+    TextureData TextureResource::LoadTextureData()
     {
         TextureData tex;
-        ASSERT(ResourceLoader::Instance().LoadBinary(tex, mTexturePath));
+        if (!ResourceLoader::Instance().LoadBinary(tex, mTexturePath))
+        {
+            Log("Texture ", mTexturePath, " Failed To Load");
+        }
+        mResidentSize = sizeof(TextureResource) + tex.DataSize();
+        return tex;
+    }
 
+    void TextureResource::AllocateGPUResource(const TextureData& tex)
+    {
         mDeviceTexture = GD3D12ResourceAllocator->CreateTexture2D(
             tex.Width(),
             tex.Height(),
@@ -89,15 +135,35 @@ namespace MRenderer
     
     void MaterialResource::PostDeserialized()
     {
-        if (!mShaderPath.empty())
-        {
-            SetShader(mShaderPath);
-        }
+        mResidentSize = sizeof(MaterialResource) + mParameterTable.size() * sizeof(ShaderParameter);
 
+        // the textures are loaded along, the shader is compiled and they are bound on the device thread
+        std::vector<std::pair<std::string, std::shared_future<std::shared_ptr<TextureResource>>>> textures;
         for (auto& it : mTexturePath)
         {
-            SetTexture(it.first, it.second);
+            textures.emplace_back(it.first, ResourceLoader::Instance().LoadDependency<TextureResource>(it.second));
         }
+
+        ResourceLoader::Instance().DeferToDevice(
+            [this, textures = std::move(textures)]()
+            {
+                if (!mShaderPath.empty())
+                {
+                    SetShader(mShaderPath);
+                }
+
+                for (auto& [semantic_name, texture] : textures)
+                {
+                    std::shared_ptr<TextureResource> tex = texture.get();
+                    if (!tex)
+                    {
+                        Log(std::format("Load TextureResource Failed From: {}", mTexturePath[semantic_name]));
+                        continue;
+                    }
+                    SetTexture(semantic_name, tex);
+                }
+            }
+        );
     }
 
     void MaterialResource::SetShader(std::string filename)
@@ -151,15 +217,35 @@ namespace MRenderer
 
     void ModelResource::PostDeserialized()
     {
+        // the mesh and the materials are cached resources of their own
+        mResidentSize = sizeof(ModelResource);
+
+        std::shared_future<std::shared_ptr<MeshResource>> mesh;
         if (!mMeshPath.empty())
         {
-            mMeshResource = ResourceLoader::Instance().LoadResource<MeshResource>(mMeshPath);
+            mesh = ResourceLoader::Instance().LoadDependency<MeshResource>(mMeshPath);
         }
 
+        std::vector<std::shared_future<std::shared_ptr<MaterialResource>>> materials;
         for (auto& path : mMaterialPath)
         {
-            mMaterials.push_back(ResourceLoader::Instance().LoadResource<MaterialResource>(path));
+            materials.push_back(ResourceLoader::Instance().LoadDependency<MaterialResource>(path));
         }
+
+        ResourceLoader::Instance().DeferToDevice(
+            [this, mesh, materials = std::move(materials)]()
+            {
+                if (mesh.valid())
+                {
+                    mMeshResource = mesh.get();
+                }
+
+                for (auto& material : materials)
+                {
+                    mMaterials.push_back(material.get());
+                }
+            }
+        );
     }
 
     void ModelResource::SetMaterial(uint32 index, const std::shared_ptr<MaterialResource>& res)
@@ -186,11 +272,16 @@ namespace MRenderer
 
     void CubeMapResource::PostDeserialized()
     {
-        CubeMapTextureData texture = ReadTextureFile();
-        AllocateGPUResource(texture);
+        std::shared_ptr<CubeMapTextureData> texture = std::make_shared<CubeMapTextureData>(ReadTextureFile());
+        std::shared_ptr<IBLTextureData> baked = std::make_shared<IBLTextureData>();
+        if (!ReadBakedFile(*baked))
+        {
+            baked.reset();
+        }
+        ResourceLoader::Instance().DeferToDevice([this, texture, baked]() { AllocateGPUResource(*texture, baked.get()); });
     }
 
-    void CubeMapResource::AllocateGPUResource(const CubeMapTextureData& texture)
+    void CubeMapResource::AllocateGPUResource(const CubeMapTextureData& texture, const IBLTextureData* baked)
     {
         const TextureData& face0 = texture.Data()[0]; // texture format of 6 faces are the same.
 
@@ -209,6 +300,27 @@ namespace MRenderer
         mDeviceTexture2DArray = GD3D12ResourceAllocator->CreateTextureCube(face0.Width(), face0.Height(), face0.MipLevels(), face0.Format(), false, face0.DataSize(), &pixels);
         mDeviceTexture2DArray->Resource()->SetName(L"CubeMap");
         mSHCoefficients = texture.mSHCoefficients;
+        mResidentSize = sizeof(CubeMapResource) + uint64(face0.DataSize()) * NumCubeMapFaces;
+
+        // the irradiance keeps being evaluated from the sh at runtime, only the prefiltered map and the lut are uploaded
+        if (baked)
+        {
+            const TextureData& prefiltered0 = baked->mPrefilteredMap[0];
+            for (uint32 i = 0; i < NumCubeMapFaces; i++)
+            {
+                pixels[i] = baked->mPrefilteredMap[i].Data();
+            }
+            mDevicePrefilteredMap = GD3D12ResourceAllocator->CreateTextureCube(prefiltered0.Width(), prefiltered0.Height(), prefiltered0.MipLevels(), prefiltered0.Format(),
+                false, prefiltered0.DataSize(), &pixels);
+            mDevicePrefilteredMap->Resource()->SetName(L"PrefilteredCubeMap");
+
+            const TextureInfo& lut = baked->mBRDFLutInfo;
+            mDeviceBRDFLut = GD3D12ResourceAllocator->CreateTexture2D(lut.Width, lut.Height, lut.MipLevels, lut.Format, ETexture2DFlag_None,
+                baked->mBRDFLut.GetSize(), baked->mBRDFLut.GetData());
+            mDeviceBRDFLut->Resource()->SetName(L"BRDFLut");
+
+            mResidentSize += uint64(prefiltered0.DataSize()) * NumCubeMapFaces + baked->mBRDFLut.GetSize();
+        }
     }
 
     CubeMapTextureData CubeMapResource::ReadTextureFile()
@@ -217,4 +329,15 @@ namespace MRenderer
         ResourceLoader::Instance().LoadBinary(texture, mTexturePath);
         return texture;
     }
+
+    bool CubeMapResource::ReadBakedFile(IBLTextureData& out_baked)
+    {
+        // the cube maps imported before baking have no file, only a malformed one is reported
+        std::string baked_path = IBLBaker::BakedDataPath(mTexturePath);
+        if (!ResourceLoader::Instance().BinaryExists(baked_path))
+        {
+            return false;
+        }
+        return ResourceLoader::Instance().LoadBinary(out_baked, baked_path);
+    }
 }
\ No newline at end of file
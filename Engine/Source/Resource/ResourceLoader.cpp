@@ -1,23 +1,62 @@
 #include "Fundation.h"
 #include "Resource/ResourceLoader.h"
-#include "Resource/tiny_obj_loader.h"
+#include "Resource/ObjParser.h"
+#include "Resource/MeshOptimizer.h"
+#include "Resource/MeshSimplifier.h"
+#include "Resource/VertexCompression.h"
 #include "Resource/DefaultResource.h"
-
+#include "Resource/ImportCache.h"
+#include "Resource/IBLBaker.h"
+#include "Resource/MipGenerator.h"
+#include "Resource/TextureCompression.h"
+#include "Utils/Thread.h"
+
+#include <algorithm>
+#include <bit>
 #include <numeric>
 #include <filesystem>
+#include <chrono>
 
 
 namespace MRenderer 
 {
+    // same order as in the MSDN documentation
+    // ref: https://learn.microsoft.com/en-us/windows/win32/direct3d9/cubic-environment-mapping
+    static const char* CubeMapFileNames[NumCubeMapFaces] = { "px.hdr", "nx.hdr", "py.hdr", "ny.hdr", "pz.hdr", "nz.hdr" };
+
+    // the files written by @ResourceLoader::DumpBinary and @ResourceLoader::DumpJson
+    static inline std::string BinaryFilePath(std::string_view repo_path)
+    {
+        return std::filesystem::path(repo_path).replace_extension(".bin").string();
+    }
+
+    static inline std::string JsonFilePath(std::string_view repo_path)
+    {
+        return std::filesystem::path(repo_path).replace_extension(".json").string();
+    }
+
+    static inline uint64 TextureImportSettings(ETextureFormat format, EBlockFormat block_format = EBlockFormat_BC1, EBlockQuality quality = EBlockQuality_Normal)
+    {
+        return ImportCache::HashCombine(ImportCache::HashCombine(ImportCache::HashCombine(0, format), block_format), quality);
+    }
+
+    // the request of the resource whose PostDeserialized is running, see @ResourceLoader::LoadDependency
+    static thread_local ResourceLoadRequest* tLoadRequest = nullptr;
+
     ResourceLoader& ResourceLoader::Instance()
     {
         static ResourceLoader loader;
         return loader;
     }
 
-    std::shared_ptr<ModelResource> ResourceLoader::ImportModel(std::string_view file_path, std::string_view repo_path, float scale/*=1.0f*/, bool flip_uv_y/*=false*/)
+    std::shared_ptr<ModelResource> ResourceLoader::ImportModel(std::string_view file_path, std::string_view repo_path, float scale/*=1.0f*/, bool flip_uv_y/*=false*/, ModelImportTimings* out_timings/*=nullptr*/)
     {
         using std::filesystem::path;
+        using Clock = std::chrono::steady_clock;
+
+        constexpr uint32 MinTrianglesPerJob = 16384;
+        constexpr uint32 TangentBatchSize = 16384;
+        constexpr float RelativeWeldTolerance = 1e-5f;
 
         path source_path = path(file_path);
         path source_folder_path = source_path.parent_path();
@@ -28,135 +67,291 @@ namespace MRenderer
             return nullptr;
         }
 
-        tinyobj::attrib_t attrib;
-        std::vector<tinyobj::shape_t> shapes;
-        std::vector<tinyobj::material_t> materials;
-        std::string warn, err;
+        std::string trimmed_path = std::filesystem::path(repo_path).replace_extension("").string();
+        std::string mesh_path = trimmed_path + "_Mesh"; // trim extension
+        std::string model_path = std::format("{}_Model", trimmed_path);
+
+        // nothing is parsed again if neither the obj file, its material libraries nor the settings changed since the last import.
+        // the textures are imports of their own, only the changed ones are imported again
+        ImportCache& cache = ImportCache::Instance();
+        uint64 settings = ImportCache::HashCombine(ImportCache::HashCombine(0, std::bit_cast<uint32>(scale)), flip_uv_y);
+        settings = ImportCache::HashCombine(settings, ResourceLoader::Instance().CompressPayloads());
+        if (cache.IsUpToDate(model_path, settings))
+        {
+            for (const ImportChild& texture : cache.Children(model_path))
+            {
+                if (!cache.IsUpToDate(texture.RepoPath, TextureImportSettings(ETextureFormat_None)))
+                {
+                    ImportTexture(texture.Source, texture.RepoPath);
+                }
+            }
 
-        bool res = tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, file_path.data(), source_folder_path.string().data());
+            Log("Import skipped, ", file_path, " Is Up To Date");
+            return ResourceLoader::Instance().LoadResource<ModelResource>(model_path);
+        }
 
-        if (!warn.empty())
+        ModelImportTimings timings{};
+        auto stage_begin = Clock::now();
+        auto end_stage = [&stage_begin](double& stage_time)
         {
-            Log(warn);
-        }
+            auto now = Clock::now();
+            stage_time = std::chrono::duration<double, std::milli>(now - stage_begin).count();
+            stage_begin = now;
+        };
 
-        if (!err.empty())
+        // 1. parse the obj file in chunks on the job system
+        ObjMesh obj;
+        if (!ObjParser::Load(file_path, source_folder_path.string(), obj))
         {
-            Log(err);
+            Log("Parse Obj File Failed ", file_path);
+            return nullptr;
         }
+        end_stage(timings.Parse);
 
-        if (!res) {
-            Log("tinyobj::LoadObj Failed ", file_path);
+        if (obj.NumTriangles() == 0)
+        {
+            Log("Obj File Has No Triangle ", file_path);
             return nullptr;
         }
 
+        TaskScheduler& scheduler = TaskScheduler::Instance();
+        const std::vector<tinyobj::material_t>& materials = obj.Materials;
+        uint32 num_materials = static_cast<uint32>(materials.size());
+        uint32 num_triangles = obj.NumTriangles();
+        uint32 num_jobs = std::clamp(num_triangles / MinTrianglesPerJob, 1u, scheduler.GetJobSystem().NumWorkers() + 1);
+        uint32 chunk_size = (num_triangles + num_jobs - 1) / num_jobs;
+
         //ref: https://vulkan-tutorial.com/Loading_models
-        // meshes's size is equal to the size of materials, each element is a vertex group of the material
-        std::vector<std::vector<StandardVertex>> meshes; 
-        meshes.resize(materials.size());
-        Vector3 center;
-        AABB bound;
+        // 2. split the triangles by material, two triangles are in a same sub mesh if they have the same material.
+        // each job counts the triangles of its chunk per material, the prefix sum in material-major order gives the slots of each job in the
+        // output, so the jobs write their vertices in place and the triangle order of each material is kept
+        std::vector<std::vector<uint32>> offsets(num_jobs, std::vector<uint32>(num_materials, 0));
+        JobHandle histogram = scheduler.ParallelFor(num_jobs, 1,
+            [&](uint32 begin, uint32 end)
+            {
+                for (uint32 job = begin; job < end; job++)
+                {
+                    uint32 chunk_end = std::min(num_triangles, (job + 1) * chunk_size);
+                    for (uint32 i = job * chunk_size; i < chunk_end; i++)
+                    {
+                        offsets[job][obj.MaterialIds[i]]++;
+                    }
+                }
+            }
+        );
+        scheduler.Wait(histogram);
 
-        // collect each shape's vertex data, two triangles are in a same mesh if they have the same material_ids
-        for(auto& shape : shapes)
+        std::vector<SubMeshData> sub_meshes;
+        sub_meshes.reserve(num_materials);
+        uint32 index_begin = 0;
+        for (uint32 material = 0; material < num_materials; material++)
         {
-            for (uint32 i = 0; i < shape.mesh.indices.size(); i++) 
+            uint32 sub_mesh_begin = index_begin;
+            for (uint32 job = 0; job < num_jobs; job++)
             {
-                // since there are three material_ids for a single triangle, we will use the first vertex's material_ids as the material of this triangle
-                uint32 mat_index = shape.mesh.material_ids[i / 3];
-
-                auto index = shape.mesh.indices[i];
-
-                StandardVertex vertex = {
-                    // float array to vector3
-                    .Position = {
-                        attrib.vertices[3 * index.vertex_index + 0],
-                        attrib.vertices[3 * index.vertex_index + 1],
-                        attrib.vertices[3 * index.vertex_index + 2],
-                    },
-                    .Normal = Vector3{
-                        attrib.normals[3 * index.normal_index + 0],
-                        attrib.normals[3 * index.normal_index + 1],
-                        attrib.normals[3 * index.normal_index + 2],
-                    }.GetNormalized(),
-                    .Color = {1, 1, 1},
-                    .TexCoord0 = {
-                        attrib.texcoords[2 * index.texcoord_index + 0],
-                        attrib.texcoords[2 * index.texcoord_index + 1],
-                    }
-                };
+                uint32 count = offsets[job][material];
+                offsets[job][material] = index_begin;
+                index_begin += count * 3;
+            }
+            sub_meshes.push_back(SubMeshData{ .Index = sub_mesh_begin, .IndicesCount = index_begin - sub_mesh_begin });
+        }
 
-                if (flip_uv_y) 
+        std::vector<StandardVertex> vertices(num_triangles * 3);
+        std::vector<std::array<double, 3>> position_sums(num_jobs);
+        JobHandle split = scheduler.ParallelFor(num_jobs, 1,
+            [&](uint32 begin, uint32 end)
+            {
+                for (uint32 job = begin; job < end; job++)
                 {
-                    vertex.TexCoord0.y = 1.0f - vertex.TexCoord0.y;
+                    std::vector<uint32>& slots = offsets[job];
+                    std::array<double, 3>& sum = position_sums[job];
+                    sum = { 0, 0, 0 };
+
+                    uint32 chunk_end = std::min(num_triangles, (job + 1) * chunk_size);
+                    for (uint32 i = job * chunk_size; i < chunk_end; i++)
+                    {
+                        StandardVertex* triangle = vertices.data() + slots[obj.MaterialIds[i]];
+                        slots[obj.MaterialIds[i]] += 3;
+
+                        for (uint32 k = 0; k < 3; k++)
+                        {
+                            const ObjIndex& index = obj.Indices[i * 3 + k];
+                            StandardVertex& vertex = triangle[k];
+
+                            const float* position = obj.Positions.data() + index.Position * 3;
+                            vertex.Position = { position[0], position[1], position[2] };
+                            vertex.Color = { 1, 1, 1 };
+
+                            if (index.TexCoord >= 0)
+                            {
+                                const float* tex_coord = obj.TexCoords.data() + index.TexCoord * 2;
+                                vertex.TexCoord0 = { tex_coord[0], flip_uv_y ? 1.0f - tex_coord[1] : tex_coord[1] };
+                            }
+
+                            if (index.Normal >= 0)
+                            {
+                                const float* normal = obj.Normals.data() + index.Normal * 3;
+                                vertex.Normal = Vector3::FromVec4f(Vec4f::Load3(normal).Normalize3());
+                            }
+
+                            sum[0] += position[0];
+                            sum[1] += position[1];
+                            sum[2] += position[2];
+                        }
+
+                        // use the face normal if the obj file doesn't have one
+                        for (uint32 k = 0; k < 3; k++)
+                        {
+                            if (obj.Indices[i * 3 + k].Normal < 0)
+                            {
+                                Vec4f p0 = triangle[0].Position.ToVec4f();
+                                Vec4f normal = (triangle[1].Position.ToVec4f() - p0).Cross3(triangle[2].Position.ToVec4f() - p0);
+                                triangle[k].Normal = Vector3::FromVec4f(normal.Normalize3());
+                            }
+                        }
+                    }
                 }
+            }
+        );
+        scheduler.Wait(split);
+        end_stage(timings.Split);
+
+        // 3. calculate tangent
+        JobHandle tangent = scheduler.ParallelFor(num_triangles, TangentBatchSize,
+            [&](uint32 begin, uint32 end)
+            {
+                for (uint32 i = begin; i < end; i++)
+                {
+                    StandardVertex& v0 = vertices[i * 3];
+                    StandardVertex& v1 = vertices[i * 3 + 1];
+                    StandardVertex& v2 = vertices[i * 3 + 2];
+
+                    Vector3 tangent = CalculateTangent(v0.Position, v1.Position, v2.Position, v0.TexCoord0, v1.TexCoord0, v2.TexCoord0);
 
-                center = center + vertex.Position;
-                meshes[mat_index].push_back(vertex);
+                    v0.Tangent = tangent;
+                    v1.Tangent = tangent;
+                    v2.Tangent = tangent;
+                }
             }
-        }
+        );
+        scheduler.Wait(tangent);
+        end_stage(timings.Tangent);
 
-        // cacluate tangent
-        for (uint32 mesh_idx = 0; mesh_idx < meshes.size(); mesh_idx++) 
+        // 4. make the model vertex near to the origin, and calculate the bound of each chunk
+        double center_sum[3] = { 0, 0, 0 };
+        for (const auto& sum : position_sums)
         {
-            for(uint32 vertex_idx = 0; vertex_idx < meshes[mesh_idx].size(); vertex_idx += 3) 
+            center_sum[0] += sum[0];
+            center_sum[1] += sum[1];
+            center_sum[2] += sum[2];
+        }
+
+        uint32 num_vertices = static_cast<uint32>(vertices.size());
+        double inv_num_vertices = num_vertices ? 1.0 / num_vertices : 0.0;
+        Vector3 center(static_cast<float>(center_sum[0] * inv_num_vertices), static_cast<float>(center_sum[1] * inv_num_vertices), static_cast<float>(center_sum[2] * inv_num_vertices));
+
+        std::vector<AABB> bounds(num_jobs, AABB(Vector3(FLT_MAX, FLT_MAX, FLT_MAX), Vector3(-FLT_MAX, -FLT_MAX, -FLT_MAX)));
+        uint32 vertex_chunk_size = chunk_size * 3;
+        JobHandle transform = scheduler.ParallelFor(num_jobs, 1,
+            [&](uint32 begin, uint32 end)
             {
-                StandardVertex& v0 = meshes[mesh_idx][vertex_idx];
-                StandardVertex& v1 = meshes[mesh_idx][vertex_idx + 1];
-                StandardVertex& v2 = meshes[mesh_idx][vertex_idx + 2];
+                for (uint32 job = begin; job < end; job++)
+                {
+                    Vec4f min = bounds[job].Min.ToVec4f(), max = bounds[job].Max.ToVec4f();
+                    Vec4f offset = center.ToVec4f();
 
-                Vector3 tangent = CalculateTangent(v0.Position, v1.Position, v2.Position, v0.TexCoord0, v1.TexCoord0, v2.TexCoord0);
+                    uint32 chunk_end = std::min(num_vertices, (job + 1) * vertex_chunk_size);
+                    for (uint32 i = job * vertex_chunk_size; i < chunk_end; i++)
+                    {
+                        Vec4f position = (vertices[i].Position.ToVec4f() - offset) * scale;
+                        vertices[i].Position = Vector3::FromVec4f(position);
 
-                v0.Tangent = tangent;
-                v1.Tangent = tangent;
-                v2.Tangent = tangent;
+                        min = Vec4f::Min(min, position);
+                        max = Vec4f::Max(max, position);
+                    }
+
+                    bounds[job] = AABB(Vector3::FromVec4f(min), Vector3::FromVec4f(max));
+                }
             }
+        );
+        scheduler.Wait(transform);
+
+        AABB bound = bounds[0];
+        for (const AABB& job_bound : bounds)
+        {
+            bound.Min = Vector3::Min(bound.Min, job_bound.Min);
+            bound.Max = Vector3::Max(bound.Max, job_bound.Max);
         }
+        end_stage(timings.Bound);
+
+        // 5. weld the vertices shared by the triangles, the position tolerance is relative to the size of the model
+        WeldTolerance tolerance;
+        tolerance.Position = std::max({ bound.Width(), bound.Height(), bound.Depth(), 1e-3f }) * RelativeWeldTolerance;
 
-        std::vector<StandardVertex> vertices;
+        std::vector<StandardVertex> welded_vertices;
         std::vector<uint32> indicies;
-        std::vector<SubMeshData> sub_meshes;
+        MeshOptimizer::WeldVertices(vertices, tolerance, welded_vertices, indicies);
+        end_stage(timings.Weld);
 
-        // record sub mesh info, i.e the begin index and the count of the indices for each mesh
-        uint32 index_begin = 0;
-        for (auto& mesh : meshes) 
-        {
-            uint32 num_mesh_vertex = static_cast<uint32>(mesh.size());
-            sub_meshes.push_back(SubMeshData{.Index = index_begin, .IndicesCount = num_mesh_vertex });
-            index_begin += num_mesh_vertex;
+        Log(std::format("Weld {} vertices to {}, {:.1f}% of the vertex buffer is left", num_vertices, welded_vertices.size(), 100.0 * welded_vertices.size() / num_vertices));
 
-            vertices.insert(vertices.end(), mesh.begin(), mesh.end());
-        }
+        // 6. reorder the triangles of each sub mesh for the vertex cache and overdraw, split them into meshlets for culling, then reorder the vertices for the fetch
+        VertexCacheStatistics cache_before = MeshOptimizer::AnalyzeVertexCache(indicies);
+        std::vector<MeshletData> meshlets;
+        MeshOptimizer::OptimizeMesh(welded_vertices, indicies, sub_meshes, &meshlets);
+        VertexCacheStatistics cache_after = MeshOptimizer::AnalyzeVertexCache(indicies);
+        end_stage(timings.Optimize);
+
+        Log(std::format("Vertex cache ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}", cache_before.ACMR, cache_after.ACMR, cache_before.ATVR, cache_after.ATVR));
+        Log(std::format("Build {} meshlets, {:.1f} triangles per meshlet", meshlets.size(), meshlets.empty() ? 0.0 : static_cast<double>(indicies.size()) / 3 / meshlets.size()));
 
-        // make the model vertex near to the origin
-        center = center / static_cast<float>(vertices.size());
-        for (auto& vertex : vertices)
+        // 7. simplify the sub meshes into a chain of lods appended to the index buffer, after the vertex fetch optimization since they share the vertices
+        uint32 num_lod0_indices = static_cast<uint32>(indicies.size());
+        MeshLodChunk lods;
+        MeshSimplifier::BuildLods(welded_vertices, indicies, sub_meshes, MeshSimplifier::DefaultLodRatios, lods);
+        end_stage(timings.Lod);
+
+        for (uint32 lod = 0; lod < lods.Lods.size(); lod++)
         {
-            vertex.Position = vertex.Position - center;
-            vertex.Position = vertex.Position * scale;
+            uint32 lod_end = lod + 1 < lods.Lods.size() ? lods.SubMeshes[(lod + 1) * sub_meshes.size()].Index : static_cast<uint32>(indicies.size());
+            uint32 lod_indices = lod_end - lods.SubMeshes[lod * sub_meshes.size()].Index;
+            Log(std::format("Lod {}: {} triangles, {:.1f}% of the full resolution, error {:.5f}, below {:.3f} of the screen height", lod + 1, lod_indices / 3,
+                100.0 * lod_indices / num_lod0_indices, lods.Lods[lod].Error, lods.Lods[lod].ScreenSize));
+        }
 
-            // calculate the bound on the fly
-            bound.Min = Vector3::Min(bound.Min, vertex.Position);
-            bound.Max = Vector3::Max(bound.Max, vertex.Position);
-        };
+        // 8. quantize the vertices into the compact format and narrow the indices to 16 bits where the sub meshes are small enough
+        IndexFormatChunk index_format;
+        BinaryData compact_vertices = VertexCompression::EncodeVertices(welded_vertices, bound);
+        BinaryData compact_indices = VertexCompression::EncodeIndices(indicies, sub_meshes, lods, index_format);
+        end_stage(timings.Compress);
 
-        // generate indicies, no vertex sharing for now
-        indicies.resize(vertices.size());
-        std::iota(indicies.begin(), indicies.end(), 0);
+        timings.MeshBytes = static_cast<uint32>(welded_vertices.size() * sizeof(StandardVertex) + indicies.size() * sizeof(uint32));
+        timings.CompressedMeshBytes = compact_vertices.GetSize() + compact_indices.GetSize();
+        Log(std::format("Compress vertex and index buffers {} -> {} bytes, {:.1f}% smaller, {} bits indices", timings.MeshBytes, timings.CompressedMeshBytes,
+            100.0 - 100.0 * timings.CompressedMeshBytes / timings.MeshBytes, index_format.IndexStride * 8));
 
         // dump mesh data
-        std::string trimmed_path = std::filesystem::path(repo_path).replace_extension("").string();
-        std::string mesh_path = trimmed_path + "_Mesh"; // trim extension
         std::string mesh_data_path = GenerateDataPath(mesh_path);
 
-        MeshData mesh(StandardVertexFormat, vertices, indicies, sub_meshes, bound);
+        MeshData mesh(CompactVertexFormat, std::move(compact_vertices), std::move(compact_indices), sub_meshes, bound);
+        mesh.SetMeshlets(std::move(meshlets));
+        mesh.SetLods(std::move(lods));
+        mesh.SetIndexFormat(std::move(index_format));
         ASSERT(ResourceLoader::Instance().DumpBinary(mesh, mesh_data_path));
 
         // dump mesh resource
         auto mesh_resource = std::make_shared<MeshResource>(mesh_path, mesh_data_path);
         ASSERT(ResourceLoader::Instance().DumpResource(*mesh_resource));
+        end_stage(timings.Write);
         
-        // collect material and textures
+        // collect material and textures, the textures are recorded as the imports of the model
+        std::vector<ImportChild> textures;
+        auto import_texture = [&textures](const std::filesystem::path& texture_path, const std::string& texture_repo_path)
+        {
+            textures.push_back(ImportChild{ .Source = texture_path.string(), .RepoPath = texture_repo_path });
+            return ImportTexture(texture_path.string(), texture_repo_path);
+        };
+
         std::vector<std::shared_ptr<MaterialResource>> mats;
         for (uint32 i = 0; i < materials.size(); i++) 
         {
@@ -171,7 +366,7 @@ namespace MRenderer
             if (!obj_mat.diffuse_texname.empty()) 
             {
                 std::filesystem::path albedo_tex_path = source_folder_path / obj_mat.diffuse_texname; // map_Kd
-                std::shared_ptr<TextureResource> albedo_tex = ImportTexture(albedo_tex_path.string(), std::format("{}_{}", trimmed_path, obj_mat.diffuse_texname));
+                std::shared_ptr<TextureResource> albedo_tex = import_texture(albedo_tex_path, std::format("{}_{}", trimmed_path, obj_mat.diffuse_texname));
                 
                 material_resource->SetShaderParameter("UseAlbedoMap", ShaderParameter(static_cast<bool>(albedo_tex)));
                 if (albedo_tex) 
@@ -187,7 +382,7 @@ namespace MRenderer
             if (!obj_mat.normal_texname.empty())
             {
                 std::filesystem::path normal_tex_path = source_folder_path / obj_mat.normal_texname; // norm
-                std::shared_ptr<TextureResource> normal_tex = ImportTexture(normal_tex_path.string(), std::format("{}_{}", trimmed_path, obj_mat.normal_texname));
+                std::shared_ptr<TextureResource> normal_tex = import_texture(normal_tex_path, std::format("{}_{}", trimmed_path, obj_mat.normal_texname));
 
                 material_resource->SetShaderParameter("UseNormalMap", ShaderParameter(static_cast<bool>(normal_tex)));
                 if (normal_tex)
@@ -199,7 +394,7 @@ namespace MRenderer
             if (!obj_mat.roughness_texname.empty())
             {
                 std::filesystem::path roughness_tex_path = source_folder_path / obj_mat.roughness_texname; // map_Pr
-                std::shared_ptr<TextureResource> roughness_tex = ImportTexture(roughness_tex_path.string(), std::format("{}_{}", trimmed_path, obj_mat.roughness_texname));
+                std::shared_ptr<TextureResource> roughness_tex = import_texture(roughness_tex_path, std::format("{}_{}", trimmed_path, obj_mat.roughness_texname));
                 
                 material_resource->SetShaderParameter("UseRoughnessMap", ShaderParameter(static_cast<bool>(roughness_tex)));
                 if (roughness_tex)
@@ -215,7 +410,7 @@ namespace MRenderer
             if (!obj_mat.metallic_texname.empty())
             {
                 std::filesystem::path metallic_tex_path = source_folder_path / obj_mat.metallic_texname; // map_Pm
-                std::shared_ptr<TextureResource> metallic_tex = ImportTexture(metallic_tex_path.string(), std::format("{}_{}", trimmed_path, obj_mat.metallic_texname));
+                std::shared_ptr<TextureResource> metallic_tex = import_texture(metallic_tex_path, std::format("{}_{}", trimmed_path, obj_mat.metallic_texname));
                 
                 material_resource->SetShaderParameter("UseMetallicMap", ShaderParameter(true));
                 if (metallic_tex)
@@ -231,7 +426,7 @@ namespace MRenderer
             if (!obj_mat.ambient_texname.empty())
             {
                 std::filesystem::path ao_tex_path = source_folder_path / obj_mat.ambient_texname; // map_Ka
-                std::shared_ptr<TextureResource> ao_tex = ImportTexture(ao_tex_path.string(), std::format("{}_{}", trimmed_path, obj_mat.ambient_texname));
+                std::shared_ptr<TextureResource> ao_tex = import_texture(ao_tex_path, std::format("{}_{}", trimmed_path, obj_mat.ambient_texname));
 
                 material_resource->SetShaderParameter("UseAmbientOcclusionMap", ShaderParameter(true));
                 if (ao_tex)
@@ -243,13 +438,36 @@ namespace MRenderer
             mats.push_back(material_resource);
         }
 
-        auto model = std::make_shared<ModelResource>(std::format("{}_Model", trimmed_path), mesh_resource, mats);
+        auto model = std::make_shared<ModelResource>(model_path, mesh_resource, mats);
         ASSERT(ResourceLoader::Instance().DumpResource(*model));
+        end_stage(timings.Materials);
+
+        std::vector<std::string> dependencies = { std::string(file_path) };
+        dependencies.insert(dependencies.end(), obj.MaterialLibPaths.begin(), obj.MaterialLibPaths.end());
+
+        std::vector<std::string> outputs = { BinaryFilePath(mesh_data_path), JsonFilePath(mesh_path), JsonFilePath(model_path) };
+        for (const std::shared_ptr<MaterialResource>& material : mats)
+        {
+            outputs.push_back(JsonFilePath(material->GetRepoPath()));
+        }
+        cache.Update(model_path, settings, dependencies, outputs, textures);
+
+        if (out_timings)
+        {
+            timings.NumTriangles = num_triangles;
+            timings.NumMaterials = num_materials;
+            timings.NumVertices = num_vertices;
+            timings.NumWeldedVertices = static_cast<uint32>(welded_vertices.size());
+            timings.ACMR = cache_after.ACMR;
+            timings.NumLods = static_cast<uint32>(mesh_resource->GetLods().Lods.size());
+            *out_timings = timings;
+        }
 
         return model;
     }
 
-    std::shared_ptr<TextureResource> ResourceLoader::ImportTexture(std::string_view file_path, std::string_view repo_path, ETextureFormat foramt/*=ETextureFormat_None*/)
+    std::shared_ptr<TextureResource> ResourceLoader::ImportTexture(std::string_view file_path, std::string_view repo_path, ETextureFormat foramt/*=ETextureFormat_None*/,
+        EBlockFormat block_format/*=EBlockFormat_BC1*/, EBlockQuality quality/*=EBlockQuality_Normal*/)
     {
         namespace fs = std::filesystem;
 
@@ -259,20 +477,32 @@ namespace MRenderer
             return nullptr;
         }
 
+        // the image isn't decoded and compressed again if neither it nor the format changed since the last import
+        std::string texture_data_path = GenerateDataPath(repo_path);
+        ImportCache& cache = ImportCache::Instance();
+        uint64 settings = TextureImportSettings(foramt, block_format, quality);
+        if (cache.IsUpToDate(repo_path, settings))
+        {
+            return std::make_shared<TextureResource>(repo_path, texture_data_path);
+        }
+
         std::optional<TextureData> texture_data = LoadImageFile(file_path, foramt);
         if (!texture_data) 
         {
             return nullptr;
         }
 
-        // dump texture binary file
-        std::string texture_data_path = GenerateDataPath(repo_path);
-        ResourceLoader::Instance().DumpBinary(texture_data.value(), texture_data_path);
+        // dump texture binary file, the blocks are encoded on the workers
+        {
+            TextureCompressor::SettingsScope compression(block_format, quality);
+            ResourceLoader::Instance().DumpBinary(texture_data.value(), texture_data_path);
+        }
 
         // dump texture resource file
         std::shared_ptr<TextureResource> resource = std::make_shared<TextureResource>(repo_path, texture_data_path);
         ResourceLoader::Instance().DumpResource(*resource);
 
+        cache.Update(repo_path, settings, { std::string(file_path) }, { BinaryFilePath(texture_data_path), JsonFilePath(repo_path) });
         return resource;
     }
 
@@ -288,13 +518,37 @@ namespace MRenderer
 
         std::string cube_map_path = GenerateDataPath(repo_path);
 
-        // dump texture data
+        // the faces aren't loaded and compressed again if none of them changed since the last import
+        std::vector<std::string> dependencies;
+        for (const char* file_name : CubeMapFileNames)
+        {
+            dependencies.push_back((path(file_path) / file_name).string());
+        }
+
+        // the faces are encoded at the fast quality, the hdr ones in BC6H
+        ImportCache& cache = ImportCache::Instance();
+        uint64 settings = TextureImportSettings(ETextureFormat_None, EBlockFormat_BC6H, EBlockQuality_Fast);
+        if (cache.IsUpToDate(repo_path, settings))
+        {
+            return std::make_shared<CubeMapResource>(repo_path, cube_map_path);
+        }
+
+        // dump texture data, the 6 faces are encoded one after another, each on all the workers
         CubeMapTextureData texture(LoadCubeMap(file_path));
-        ResourceLoader::Instance().DumpBinary(texture, cube_map_path);
+        {
+            TextureCompressor::SettingsScope compression(EBlockQuality_Fast);
+            ResourceLoader::Instance().DumpBinary(texture, cube_map_path);
+
+            // the image based lighting is baked from the uncompressed faces, so the passes that compute it at startup copy it instead
+            IBLTextureData baked = IBLBaker::Bake(texture);
+            ResourceLoader::Instance().DumpBinary(baked, IBLBaker::BakedDataPath(cube_map_path));
+        }
 
         // dump resource file
         auto resource = std::make_shared<CubeMapResource>(repo_path, cube_map_path);
         ResourceLoader::Instance().DumpResource(*resource);
+
+        cache.Update(repo_path, settings, dependencies, { BinaryFilePath(cube_map_path), BinaryFilePath(IBLBaker::BakedDataPath(cube_map_path)), JsonFilePath(repo_path) });
         return resource;
     }
 
@@ -322,7 +576,7 @@ namespace MRenderer
         return model;
     }
 
-    std::optional<TextureData> ResourceLoader::LoadImageFile(std::string_view local_path, ETextureFormat format/*=ETextureFormat_None*/)
+    std::optional<TextureData> ResourceLoader::LoadImageFile(std::string_view local_path, ETextureFormat format/*=ETextureFormat_None*/, bool generate_mips/*=true*/)
     {
         using namespace DirectX;
         using std::filesystem::path;
@@ -339,11 +593,11 @@ namespace MRenderer
         path extension = path(local_path).extension();
         if (extension == ".png" || extension == ".jpg")
         {
-            return LoadWICImageFile(local_path, format);
+            return LoadWICImageFile(local_path, format, generate_mips);
         }
         else if(extension == ".hdr")
         {
-            return LoadHDRImageFile(local_path);
+            return LoadHDRImageFile(local_path, generate_mips);
         }
         else 
         {
@@ -352,7 +606,7 @@ namespace MRenderer
         }
     }
 
-    std::optional<TextureData> ResourceLoader::LoadWICImageFile(std::string_view local_path, ETextureFormat format/*=ETextureFormat_None*/)
+    std::optional<TextureData> ResourceLoader::LoadWICImageFile(std::string_view local_path, ETextureFormat format/*=ETextureFormat_None*/, bool generate_mips/*=true*/)
     {
         DirectX::ScratchImage image;
         ThrowIfFailed(DirectX::LoadFromWICFile(ToWString(local_path).data(), DirectX::WIC_FLAGS_NONE, nullptr, image));
@@ -375,10 +629,10 @@ namespace MRenderer
             base_slice = image.GetImage(0, 0, 0);
         }
 
-        return GenerateImageMipmaps(base_slice);
+        return GenerateImageMipmaps(base_slice, generate_mips);
     }
 
-    std::optional<TextureData> ResourceLoader::LoadHDRImageFile(std::string_view local_path)
+    std::optional<TextureData> ResourceLoader::LoadHDRImageFile(std::string_view local_path, bool generate_mips/*=true*/)
     {
         DirectX::ScratchImage image;
         HRESULT hr = DirectX::LoadFromHDRFile(
@@ -402,28 +656,40 @@ namespace MRenderer
             return std::nullopt;
         }
 
-        return GenerateImageMipmaps(base_slice);
+        return GenerateImageMipmaps(base_slice, generate_mips);
     }
 
     std::array<TextureData, NumCubeMapFaces> ResourceLoader::LoadCubeMap(std::string_view filepath)
     {
         using std::filesystem::path;
 
-        // same order as in the MSDN documentation
-        // ref: https://learn.microsoft.com/en-us/windows/win32/direct3d9/cubic-environment-mapping
         std::array<TextureData, 6> texture_data;
-        const char* file_names[] = { "px.hdr", "nx.hdr", "py.hdr", "ny.hdr", "pz.hdr", "nz.hdr" };
-        
         for (uint32 i = 0; i < 6; i++)
         {
-            path local_path = filepath / path(file_names[i]);
+            path local_path = filepath / path(CubeMapFileNames[i]);
             ASSERT(std::filesystem::exists(local_path));
 
-            std::optional<TextureData> tex = LoadImageFile(local_path.string());
+            std::optional<TextureData> tex = LoadImageFile(local_path.string(), ETextureFormat_None, false);
             ASSERT(tex.has_value());
 
             texture_data[i] = std::move(tex.value());
         }
+
+        // the mips of the 6 faces are filtered together on the workers, the formats the @MipGenerator can't filter got theirs from DirectXTex
+        DXGI_FORMAT format = static_cast<DXGI_FORMAT>(texture_data[0].Format());
+        ETextureFormat linear_format = static_cast<ETextureFormat>(DirectX::MakeLinear(format));
+        if (MipGenerator::IsSupported(linear_format))
+        {
+            std::array<void*, NumCubeMapFaces> mip_chains;
+            for (uint32 i = 0; i < NumCubeMapFaces; i++)
+            {
+                ASSERT(texture_data[i].mInfo == texture_data[0].mInfo);
+                mip_chains[i] = texture_data[i].mData.GetData();
+            }
+
+            const TextureData& face0 = texture_data[0];
+            MipGenerator::GenerateCubeMap(mip_chains, face0.Width(), face0.Height(), face0.MipLevels(), linear_format, EMipFilter_Kaiser, DirectX::IsSRGB(format));
+        }
         return texture_data;
     }
 
@@ -452,6 +718,256 @@ namespace MRenderer
         return std::nullopt;
     }
 
+    bool ResourceLoader::MountArchive(std::string_view path)
+    {
+        std::shared_ptr<AssetArchive> archive = AssetArchive::Open(path);
+        if (!archive)
+        {
+            Log("Mount failed, ", path, " Is Not A Valid Archive");
+            return false;
+        }
+
+        mArchive = std::move(archive);
+        Log("Archive ", path, " Mounted, ", mArchive->NumEntries(), " Entries");
+        return true;
+    }
+
+    bool ResourceLoader::BinaryExists(std::string_view repo_path) const
+    {
+        std::string file_path = std::filesystem::path(repo_path).replace_extension(".bin").string();
+        return (mArchive && mArchive->Find(file_path)) || std::filesystem::exists(file_path);
+    }
+
+    bool ResourceLoader::LoadArchivedBinary(BinarySerializer& serializer, std::string_view file_path, bool memory_mapped, std::vector<uint8>& out_storage)
+    {
+        const AssetArchive::Entry* entry = mArchive ? mArchive->Find(file_path) : nullptr;
+        if (!entry)
+        {
+            return false;
+        }
+
+        const uint8* data = mArchive->Read(*entry, out_storage);
+        if (!data)
+        {
+            Log("Archive Entry ", file_path, " Is Corrupted");
+            return false;
+        }
+
+        // the stored entries are views into the archive mapping, like the loose files are into theirs
+        bool in_place = memory_mapped && entry->Codec == EArchiveCodec_None;
+        return serializer.LoadMemory(data, entry->RawSize, in_place ? mArchive->File() : nullptr);
+    }
+
+    std::optional<nlohmann::json> ResourceLoader::LoadArchivedJson(std::string_view file_path)
+    {
+        const AssetArchive::Entry* entry = mArchive ? mArchive->Find(file_path) : nullptr;
+        if (!entry)
+        {
+            return std::nullopt;
+        }
+
+        std::vector<uint8> storage;
+        const uint8* data = mArchive->Read(*entry, storage);
+        if (!data)
+        {
+            Log("Archive Entry ", file_path, " Is Corrupted");
+            return std::nullopt;
+        }
+
+        try {
+            return nlohmann::json::parse(data, data + entry->RawSize, nullptr, true);
+        }
+        catch (const nlohmann::json::parse_error& e) {
+            Error("Json Parse Error: ", file_path);
+            Error(e.what());
+            ASSERT(false);
+        }
+
+        return std::nullopt;
+    }
+
+    ResourceLoadRequest* ResourceLoader::CurrentLoadRequest()
+    {
+        return tLoadRequest;
+    }
+
+    void ResourceLoader::DeferToDevice(std::function<void()> work)
+    {
+        if (ResourceLoadRequest* request = CurrentLoadRequest())
+        {
+            request->DeviceWork.push_back(std::move(work));
+        }
+        else
+        {
+            work();
+        }
+    }
+
+    void ResourceLoader::Enqueue(std::shared_ptr<ResourceLoadRequest> request)
+    {
+        if (request->DecodeOnDevice)
+        {
+            mUploadQueue.push_back(std::move(request));
+            mEventDecoded.notify_all();
+            return;
+        }
+
+        mDecodeQueues[request->Priority.load()].push_back(std::move(request));
+        TaskScheduler::Instance().DispatchOnWorker([this]() { DecodeNext(); });
+    }
+
+    void ResourceLoader::Promote(const std::shared_ptr<ResourceLoadRequest>& request, ELoadPriority priority)
+    {
+        ELoadPriority previous = request->Priority;
+        if (priority >= previous)
+        {
+            return;
+        }
+
+        // the dependencies registered from now on are promoted too
+        request->Priority = priority;
+
+        std::deque<std::shared_ptr<ResourceLoadRequest>>& queue = mDecodeQueues[previous];
+        auto it = std::find(queue.begin(), queue.end(), request);
+        if (it != queue.end())
+        {
+            queue.erase(it);
+            mDecodeQueues[priority].push_back(request);
+        }
+
+        // and the ones registered so far, a request referenced twice is already promoted on the second visit
+        for (const ResourceDependency& dependency : request->Dependencies)
+        {
+            if (dependency.Request)
+            {
+                Promote(dependency.Request, priority);
+            }
+        }
+    }
+
+    void ResourceLoader::DecodeNext()
+    {
+        std::shared_ptr<ResourceLoadRequest> request;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            for (std::deque<std::shared_ptr<ResourceLoadRequest>>& queue : mDecodeQueues)
+            {
+                if (!queue.empty())
+                {
+                    request = std::move(queue.front());
+                    queue.pop_front();
+                    break;
+                }
+            }
+        }
+
+        // a job is dispatched per request, so there is always one left
+        ASSERT(request);
+        DecodeRequest(*request);
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mUploadQueue.push_back(std::move(request));
+        }
+        mEventDecoded.notify_all();
+    }
+
+    void ResourceLoader::DecodeRequest(ResourceLoadRequest& request)
+    {
+        // nested when the worker runs another decode while it waits on a job, see @JobSystem::Wait
+        ResourceLoadRequest* outer = tLoadRequest;
+        tLoadRequest = &request;
+        request.Resource = request.Decode();
+        tLoadRequest = outer;
+    }
+
+    uint32 ResourceLoader::ProcessUploads()
+    {
+        ASSERT(IsDeviceThread() && "Process The Uploads On The Device Thread");
+
+        uint32 num_loaded = 0;
+        for (bool progress = true; progress;)
+        {
+            progress = false;
+
+            std::vector<std::shared_ptr<ResourceLoadRequest>> requests;
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                requests.swap(mUploadQueue);
+            }
+
+            // a resource is finished after the ones it references, so a texture, its material, then the model may finish in one pass
+            std::vector<std::shared_ptr<ResourceLoadRequest>> waiting;
+            for (std::shared_ptr<ResourceLoadRequest>& request : requests)
+            {
+                if (!request->Resource)
+                {
+                    DecodeRequest(*request);
+                    progress = true;
+                }
+
+                bool ready = std::all_of(request->Dependencies.begin(), request->Dependencies.end(), [](const ResourceDependency& dependency) { return dependency.IsReady(); });
+                if (!ready)
+                {
+                    waiting.push_back(std::move(request));
+                    continue;
+                }
+
+                for (const std::function<void()>& work : request->DeviceWork)
+                {
+                    work();
+                }
+
+                // cache the resource, what is handed out is its handle, see @ResourceCache
+                std::shared_ptr<IResource> handle;
+                {
+                    std::lock_guard<std::mutex> lock(mMutex);
+                    handle = mResourceCache.Insert(request->RepoPath, std::move(request->Resource), request->Category);
+                    mPendingLoads.erase(request->RepoPath);
+                }
+                request->Fulfill(handle);
+
+                num_loaded++;
+                progress = true;
+            }
+
+            std::lock_guard<std::mutex> lock(mMutex);
+            mUploadQueue.insert(mUploadQueue.end(), std::make_move_iterator(waiting.begin()), std::make_move_iterator(waiting.end()));
+        }
+
+        // the resources released since are evicted as the new ones come in
+        if (num_loaded > 0)
+        {
+            mResourceCache.Trim();
+        }
+        return num_loaded;
+    }
+
+    void ResourceLoader::BindDeviceThread()
+    {
+        mDeviceThread = std::this_thread::get_id();
+    }
+
+    bool ResourceLoader::IsDeviceThread()
+    {
+        // bound lazily to the first thread that asks, unless @BindDeviceThread did before
+        std::thread::id unbound;
+        std::thread::id current = std::this_thread::get_id();
+        return mDeviceThread.compare_exchange_strong(unbound, current) || unbound == current;
+    }
+
+    void ResourceLoader::PumpUploads()
+    {
+        if (ProcessUploads() > 0)
+        {
+            return;
+        }
+
+        // the timeout covers a decode finished between the two
+        std::unique_lock<std::mutex> lock(mMutex);
+        mEventDecoded.wait_for(lock, std::chrono::milliseconds(1));
+    }
+
     std::string ResourceLoader::GenerateDataPath(std::string_view path)
     {
         namespace fs = std::filesystem;
@@ -462,10 +978,34 @@ namespace MRenderer
         return data_path.string();
     }
 
-    TextureData ResourceLoader::GenerateImageMipmaps(const DirectX::Image* mip_0)
+    TextureData ResourceLoader::GenerateImageMipmaps(const DirectX::Image* mip_0, bool generate_mips/*=true*/)
     {
         ASSERT(mip_0 && mip_0->width && mip_0->height);
 
+        // the formats @MipGenerator supports are filtered on the workers in place, the srgb ones in linear space, and keep their format.
+        // without @generate_mips only the first mip is filled
+        ETextureFormat linear_format = static_cast<ETextureFormat>(DirectX::MakeLinear(mip_0->format));
+        if (MipGenerator::IsSupported(linear_format))
+        {
+            uint32 width = static_cast<uint32>(mip_0->width);
+            uint32 height = static_cast<uint32>(mip_0->height);
+            uint32 mip_levels = CalculateMaxMipLevels(width, height);
+            uint32 row_size = width * GetPixelSize(linear_format);
+
+            TextureData texture(static_cast<uint16>(height), static_cast<uint16>(width), static_cast<uint16>(mip_levels), static_cast<ETextureFormat>(mip_0->format));
+            uint8* pixels = static_cast<uint8*>(texture.mData.GetData());
+            for (uint32 y = 0; y < height; y++)
+            {
+                memcpy(pixels + y * row_size, mip_0->pixels + y * mip_0->rowPitch, row_size);
+            }
+
+            if (generate_mips)
+            {
+                MipGenerator::Generate(pixels, width, height, mip_levels, linear_format, EMipFilter_Kaiser, DirectX::IsSRGB(mip_0->format));
+            }
+            return texture;
+        }
+
         // generate mipmap by directxtex
         DirectX::ScratchImage mip_chain;
         ThrowIfFailed(GenerateMipMaps(*mip_0, DirectX::TEX_FILTER_DEFAULT, 0, mip_chain));
@@ -509,8 +1049,9 @@ namespace MRenderer
     // ref: introductionto 3d game programming with directx12 19.3
     Vector3 ResourceLoader::CalculateTangent(const Vector3& p0, const Vector3& p1, const Vector3& p2, const Vector2& t0, const Vector2& t1, const Vector2& t2)
     {
-        Vector3 e1 = p1 - p0;
-        Vector3 e2 = p2 - p0;
+        Vec4f position = p0.ToVec4f();
+        Vec4f e1 = p1.ToVec4f() - position;
+        Vec4f e2 = p2.ToVec4f() - position;
         Vector2 duv1 = t1 - t0;
         Vector2 duv2 = t2 - t0;
 
@@ -520,13 +1061,8 @@ namespace MRenderer
             return Vector3(1, 0, 0);
         }
 
-        Vector3 tangent = 
-        {
-            (duv2.y * e1.x - duv1.y * e2.x) / det,
-            (duv2.y * e1.y - duv1.y * e2.y) / det,
-            (duv2.y * e1.z - duv1.y * e2.z) / det
-        };
-
-        return tangent.GetNormalized();
+        // the 1 / det factor is dropped since the tangent is normalized anyway
+        Vec4f tangent = e1 * duv2.y - e2 * duv1.y;
+        return Vector3::FromVec4f(tangent.Normalize3());
     }
 }
\ No newline at end of file
@@ -1,4 +1,3 @@
-#include <d3d11.h>
 #include "Resource/TextureCompression.h"
 
 namespace MRenderer
@@ -21,26 +20,25 @@ namespace MRenderer
         }
     }
 
-    TextureCompressor::TextureCompressor()
+    static thread_local EBlockFormat tBlockFormat = EBlockFormat_BC1;
+    static thread_local EBlockQuality tBlockQuality = EBlockQuality_Normal;
+
+    TextureCompressor::SettingsScope::SettingsScope(EBlockFormat format, EBlockQuality quality)
+        :mPreviousFormat(tBlockFormat), mPreviousQuality(tBlockQuality)
     {
-        UINT flags = 0;
-        flags |= D3D11_CREATE_DEVICE_DEBUG;
+        tBlockFormat = format;
+        tBlockQuality = quality;
+    }
 
-        D3D_FEATURE_LEVEL feature_level = D3D_FEATURE_LEVEL_10_0;
+    TextureCompressor::SettingsScope::SettingsScope(EBlockQuality quality)
+        :SettingsScope(tBlockFormat, quality)
+    {
+    }
 
-        //BC6H requires d3d11 device
-        ThrowIfFailed(D3D11CreateDevice(
-            nullptr,
-            D3D_DRIVER_TYPE_HARDWARE,
-            nullptr,
-            flags,
-            &feature_level,
-            1,
-            D3D11_SDK_VERSION,
-            &mDevice,
-            nullptr,
-            &mContext
-        ));
+    TextureCompressor::SettingsScope::~SettingsScope()
+    {
+        tBlockFormat = mPreviousFormat;
+        tBlockQuality = mPreviousQuality;
     }
 
     TextureCompressor* TextureCompressor::Instance()
@@ -49,71 +47,187 @@ namespace MRenderer
         return &instance;
     }
 
-    void TextureCompressor::Compress(uint32 width, uint32 height, uint32 mip_levels, ETextureFormat format, uint32 data_size, const uint8* data_ptr, CompressionHandler on_complete)
+    bool TextureCompressor::IsByteFormat(ETextureFormat format)
     {
-        DXGI_FORMAT original_format = static_cast<DXGI_FORMAT>(format);
-        DXGI_FORMAT compressed_format = GetCompressedFormat(static_cast<DXGI_FORMAT>(format));
-        TextureCompressInternal(width, height, mip_levels, original_format, compressed_format, data_size, data_ptr, on_complete);
+        switch (format)
+        {
+        case ETextureFormat_R8G8B8A8_UNORM:
+        case ETextureFormat_R8G8_UNORM:
+        case ETextureFormat_R8_UNORM:
+            return true;
+        default:
+            return false;
+        }
     }
 
-    void TextureCompressor::Decompress(uint32 width, uint32 height, uint32 mip_levels, ETextureFormat format, uint32 data_size, const uint8* data_ptr, CompressionHandler on_complete)
+    bool TextureCompressor::IsHalfConvertibleFormat(ETextureFormat format)
     {
-        DXGI_FORMAT original_format = static_cast<DXGI_FORMAT>(format);
-        DXGI_FORMAT compressed_format = GetCompressedFormat(static_cast<DXGI_FORMAT>(format));
-        TextureDecompressInternal(width, height, mip_levels, original_format, compressed_format, data_size, data_ptr, on_complete);
+        return format == ETextureFormat_R32G32B32A32_FLOAT || format == ETextureFormat_R16G16B16A16_FLOAT;
     }
 
-    // ref: https://github.com/microsoft/DirectXTex/wiki/Compress
-    // BC1 format goes to this function
-    void TextureCompressor::TextureCompressInternal(uint32 width, uint32 height, uint32 mip_levels, DXGI_FORMAT orignal_format, DXGI_FORMAT compressed_format, uint32 data_size, const uint8* data_ptr, CompressionHandler on_complete)
+    EBlockFormat TextureCompressor::GetBlockFormat(ETextureFormat format)
     {
-        // we use block compression to store the image file
-        DirectX::ScratchImage raw_image;
-        ThrowIfFailed(raw_image.Initialize2D(orignal_format, width, height, 1, mip_levels));
+        // the setting is the format of the ldr textures, the hdr ones are BC6H
+        if (IsByteFormat(format))
+        {
+            return tBlockFormat == EBlockFormat_BC6H || tBlockFormat == EBlockFormat_None ? EBlockFormat_BC1 : tBlockFormat;
+        }
+        else if (IsHalfConvertibleFormat(format))
+        {
+            return EBlockFormat_BC6H;
+        }
+        return EBlockFormat_None;
+    }
 
-        uint32 mem_size = CalculateTextureSize(width, height, mip_levels, GetPixelSize(orignal_format));
-        ASSERT(raw_image.GetPixelsSize() == mem_size);
+    EBlockQuality TextureCompressor::GetBlockQuality()
+    {
+        return tBlockQuality;
+    }
 
-        memcpy(raw_image.GetPixels(), data_ptr, mem_size);
+    std::vector<uint8> TextureCompressor::ExpandToRGBA8(uint32 num_pixels, ETextureFormat format, const uint8* data_ptr)
+    {
+        uint32 num_channels = GetChannelCount(format);
 
-        // do the compression
-        DirectX::ScratchImage compressed;
-        if (compressed_format != HDRTextureBCFormat) 
+        // the missing channels are black and opaque
+        std::vector<uint8> pixels(num_pixels * 4, 0);
+        for (uint32 i = 0; i < num_pixels; i++)
+        {
+            memcpy(pixels.data() + i * 4, data_ptr + i * num_channels, num_channels);
+            pixels[i * 4 + 3] = num_channels == 4 ? pixels[i * 4 + 3] : 255;
+        }
+        return pixels;
+    }
+
+    std::vector<uint8> TextureCompressor::NarrowFromRGBA8(uint32 num_pixels, ETextureFormat format, const uint8* data_ptr)
+    {
+        uint32 num_channels = GetChannelCount(format);
+
+        std::vector<uint8> pixels(num_pixels * num_channels);
+        for (uint32 i = 0; i < num_pixels; i++)
+        {
+            memcpy(pixels.data() + i * num_channels, data_ptr + i * 4, num_channels);
+        }
+        return pixels;
+    }
+
+    std::vector<uint8> TextureCompressor::ConvertToRGBA16F(uint32 num_pixels, ETextureFormat format, const uint8* data_ptr)
+    {
+        std::vector<uint8> pixels(num_pixels * 8);
+        if (format == ETextureFormat_R16G16B16A16_FLOAT)
+        {
+            memcpy(pixels.data(), data_ptr, pixels.size());
+            return pixels;
+        }
+
+        const float* values = reinterpret_cast<const float*>(data_ptr);
+        uint16* halves = reinterpret_cast<uint16*>(pixels.data());
+        for (uint32 i = 0; i < num_pixels * 4; i++)
+        {
+            halves[i] = FloatToHalf(values[i]);
+        }
+        return pixels;
+    }
+
+    std::vector<uint8> TextureCompressor::ConvertFromRGBA16F(uint32 num_pixels, ETextureFormat format, const uint8* data_ptr)
+    {
+        if (format == ETextureFormat_R16G16B16A16_FLOAT)
+        {
+            return std::vector<uint8>(data_ptr, data_ptr + num_pixels * 8);
+        }
+
+        std::vector<uint8> pixels(num_pixels * 16);
+        const uint16* halves = reinterpret_cast<const uint16*>(data_ptr);
+        float* values = reinterpret_cast<float*>(pixels.data());
+        for (uint32 i = 0; i < num_pixels * 4; i++)
         {
-            ThrowIfFailed(
-                DirectX::Compress(
-                    raw_image.GetImages(),
-                    raw_image.GetImageCount(),
-                    raw_image.GetMetadata(),
-                    compressed_format,
-                    DirectX::TEX_COMPRESS_DEFAULT,
-                    DirectX::TEX_THRESHOLD_DEFAULT,
-                    compressed
-                )
-            );
+            values[i] = HalfToFloat(halves[i]);
         }
-        else 
+        return pixels;
+    }
+
+    void TextureCompressor::Compress(uint32 width, uint32 height, uint32 mip_levels, ETextureFormat format, uint32 data_size, const uint8* data_ptr, CompressionHandler on_complete,
+        EBlockFormat block_format/*=EBlockFormat_None*/, EBlockQuality quality/*=EBlockQuality_Normal*/)
+    {
+        if (block_format != EBlockFormat_None)
         {
-            // BC6H compression for HDR textures
-            ThrowIfFailed(
-                DirectX::Compress(
-                    mDevice.Get(),
-                    raw_image.GetImages(),
-                    raw_image.GetImageCount(), 
-                    raw_image.GetMetadata(),
-                    compressed_format,
-                    DirectX::TEX_COMPRESS_DEFAULT,
-                    DirectX::TEX_ALPHA_WEIGHT_DEFAULT,
-                    compressed
-                )
-            );
+            ASSERT(block_format == EBlockFormat_BC6H ? IsHalfConvertibleFormat(format) : IsByteFormat(format));
+
+            uint32 num_pixels = CalculateTextureSize(width, height, mip_levels, 1);
+            ASSERT(data_size == num_pixels * GetPixelSize(format));
+
+            std::vector<uint8> blocks;
+            if (block_format == EBlockFormat_BC6H)
+            {
+                std::vector<uint8> pixels = ConvertToRGBA16F(num_pixels, format, data_ptr);
+                blocks = BlockCompression::Encode(pixels.data(), width, height, mip_levels, block_format, quality);
+            }
+            else if (format == ETextureFormat_R8G8B8A8_UNORM)
+            {
+                blocks = BlockCompression::Encode(data_ptr, width, height, mip_levels, block_format, quality);
+            }
+            else
+            {
+                std::vector<uint8> pixels = ExpandToRGBA8(num_pixels, format, data_ptr);
+                blocks = BlockCompression::Encode(pixels.data(), width, height, mip_levels, block_format, quality);
+            }
+
+            on_complete(static_cast<uint32>(blocks.size()), blocks.data());
+            return;
         }
 
-        on_complete(static_cast<uint32>(compressed.GetPixelsSize()), compressed.GetPixels());
+        on_complete(data_size, data_ptr);
     }
 
+    void TextureCompressor::Decompress(uint32 width, uint32 height, uint32 mip_levels, ETextureFormat format, uint32 data_size, const uint8* data_ptr, CompressionHandler on_complete,
+        EBlockFormat block_format/*=EBlockFormat_None*/)
+    {
+        DXGI_FORMAT original_format = static_cast<DXGI_FORMAT>(format);
+        DXGI_FORMAT compressed_format = GetCompressedFormat(static_cast<DXGI_FORMAT>(format));
+
+        // the BC1 and BC6H of DirectXTex are decoded like any other
+        if (block_format == EBlockFormat_None && compressed_format == LDRTextureBCFormat && IsByteFormat(format))
+        {
+            block_format = EBlockFormat_BC1;
+        }
+        else if (block_format == EBlockFormat_None && compressed_format == HDRTextureBCFormat)
+        {
+            ASSERT(IsHalfConvertibleFormat(format) && "BC6H Is Only Decoded Into Float RGBA");
+            block_format = EBlockFormat_BC6H;
+        }
+
+        if (block_format != EBlockFormat_None)
+        {
+            ASSERT(data_size == BlockCompression::EncodedSize(width, height, mip_levels, block_format));
+
+            uint32 num_pixels = CalculateTextureSize(width, height, mip_levels, 1);
+            std::vector<uint8> pixels(num_pixels * BlockCompression::PixelSize(block_format));
+            if (!BlockCompression::Decode(data_ptr, width, height, mip_levels, block_format, pixels.data()))
+            {
+                Error("Texture Has Blocks Of A Reserved Or Unsupported Mode, Decoded As Black: ", GetBlockFormatName(block_format));
+                ASSERT(false);
+            }
+
+            if (block_format == EBlockFormat_BC6H)
+            {
+                pixels = ConvertFromRGBA16F(num_pixels, format, pixels.data());
+            }
+            else if (format != ETextureFormat_R8G8B8A8_UNORM)
+            {
+                pixels = NarrowFromRGBA8(num_pixels, format, pixels.data());
+            }
+
+            on_complete(static_cast<uint32>(pixels.size()), pixels.data());
+            return;
+        }
+
+        TextureDecompressInternal(width, height, mip_levels, original_format, compressed_format, data_size, data_ptr, on_complete);
+    }
+
+    // only the BC1 of the formats @BlockCompression doesn't take goes to this function
     void TextureCompressor::TextureDecompressInternal(uint32 width, uint32 height, uint32 mip_levels, DXGI_FORMAT original_format, DXGI_FORMAT compressed_format, uint32 data_size, const uint8* data_ptr, CompressionHandler on_complete)
     {
+        ASSERT(compressed_format == LDRTextureBCFormat);
+
         // basicly the inverse process of TextureCompressOnCPU
         DirectX::ScratchImage compressed;
         ThrowIfFailed(compressed.Initialize2D(compressed_format, width, height, 1, mip_levels));
@@ -0,0 +1,277 @@
+#include "Resource/VertexCompression.h"
+#include "Utils/Thread.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+namespace MRenderer
+{
+    static inline float SignNotZero(float value)
+    {
+        return value >= 0 ? 1.0f : -1.0f;
+    }
+
+    static inline float DecodeSnorm16(int16 value)
+    {
+        // same as the input assembler, -32768 and -32767 are both -1
+        return std::max(static_cast<float>(value) / 32767.0f, -1.0f);
+    }
+
+    static inline uint16 EncodeUnorm16(float value, float min, float extent)
+    {
+        float t = extent > 0 ? (value - min) / extent : 0.0f;
+        return static_cast<uint16>(std::lround(Clamp(t, 0.0f, 1.0f) * 65535.0f));
+    }
+
+    static inline float DecodeUnorm16(uint16 value, float min, float extent)
+    {
+        return min + static_cast<float>(value) / 65535.0f * extent;
+    }
+
+    void VertexCompression::EncodeOctahedral(const Vector3& v, int16* out_encoded)
+    {
+        float l1 = std::abs(v.x) + std::abs(v.y) + std::abs(v.z);
+        if (l1 == 0)
+        {
+            out_encoded[0] = 0;
+            out_encoded[1] = 0;
+            return;
+        }
+
+        float x = v.x / l1;
+        float y = v.y / l1;
+        if (v.z < 0)
+        {
+            float folded_x = (1 - std::abs(y)) * SignNotZero(x);
+            float folded_y = (1 - std::abs(x)) * SignNotZero(y);
+            x = folded_x;
+            y = folded_y;
+        }
+
+        // rounding each component independently isn't the closest point on the sphere, pick the best of the 4 neighbours.
+        // they are compared by distance, the cosine of such small angles is 1 in float
+        Vector3 n = v.GetNormalized();
+        float base_x = std::floor(Clamp(x, -1.0f, 1.0f) * 32767.0f);
+        float base_y = std::floor(Clamp(y, -1.0f, 1.0f) * 32767.0f);
+        float best_distance = FLT_MAX;
+        for (uint32 i = 0; i < 4; i++)
+        {
+            int16 candidate[2] =
+            {
+                static_cast<int16>(Clamp(base_x + (i & 1), -32767.0f, 32767.0f)),
+                static_cast<int16>(Clamp(base_y + (i >> 1), -32767.0f, 32767.0f)),
+            };
+
+            Vector3 error = DecodeOctahedral(candidate) - n;
+            float distance = error.x * error.x + error.y * error.y + error.z * error.z;
+            if (distance < best_distance)
+            {
+                best_distance = distance;
+                out_encoded[0] = candidate[0];
+                out_encoded[1] = candidate[1];
+            }
+        }
+    }
+
+    Vector3 VertexCompression::DecodeOctahedral(const int16* encoded)
+    {
+        // the shader does the same with the snorm values fetched by the input assembler, see gbuffer.hlsl
+        float x = DecodeSnorm16(encoded[0]);
+        float y = DecodeSnorm16(encoded[1]);
+        float z = 1 - std::abs(x) - std::abs(y);
+
+        float t = std::max(-z, 0.0f);
+        x += x >= 0 ? -t : t;
+        y += y >= 0 ? -t : t;
+        return Vector3(x, y, z).GetNormalized();
+    }
+
+    CompactVertex VertexCompression::EncodeVertex(const StandardVertex& vertex, const AABB& bound)
+    {
+        Vector3 extent = bound.Size();
+
+        CompactVertex compact;
+        compact.Position[0] = EncodeUnorm16(vertex.Position.x, bound.Min.x, extent.x);
+        compact.Position[1] = EncodeUnorm16(vertex.Position.y, bound.Min.y, extent.y);
+        compact.Position[2] = EncodeUnorm16(vertex.Position.z, bound.Min.z, extent.z);
+        compact.Position[3] = 0;
+        EncodeOctahedral(vertex.Normal, compact.Normal);
+        EncodeOctahedral(vertex.Tangent, compact.Tangent);
+        compact.TexCoord0[0] = FloatToHalf(vertex.TexCoord0.x);
+        compact.TexCoord0[1] = FloatToHalf(vertex.TexCoord0.y);
+        return compact;
+    }
+
+    StandardVertex VertexCompression::DecodeVertex(const CompactVertex& vertex, const AABB& bound)
+    {
+        Vector3 extent = bound.Size();
+
+        StandardVertex standard;
+        standard.Position = Vector3(
+            DecodeUnorm16(vertex.Position[0], bound.Min.x, extent.x),
+            DecodeUnorm16(vertex.Position[1], bound.Min.y, extent.y),
+            DecodeUnorm16(vertex.Position[2], bound.Min.z, extent.z)
+        );
+        standard.Normal = DecodeOctahedral(vertex.Normal);
+        standard.Tangent = DecodeOctahedral(vertex.Tangent);
+        standard.Color = Vector3(1, 1, 1);
+        standard.TexCoord0 = Vector2(HalfToFloat(vertex.TexCoord0[0]), HalfToFloat(vertex.TexCoord0[1]));
+        return standard;
+    }
+
+    BinaryData VertexCompression::EncodeVertices(const std::vector<StandardVertex>& vertices, const AABB& bound)
+    {
+        uint32 num_vertices = static_cast<uint32>(vertices.size());
+        BinaryData data(num_vertices * static_cast<uint32>(sizeof(CompactVertex)));
+        CompactVertex* compact = static_cast<CompactVertex*>(data.GetData());
+
+        TaskScheduler& scheduler = TaskScheduler::Instance();
+        JobHandle encode = scheduler.ParallelFor(num_vertices, MinVerticesPerJob,
+            [&](uint32 begin, uint32 end)
+            {
+                for (uint32 i = begin; i < end; i++)
+                {
+                    compact[i] = EncodeVertex(vertices[i], bound);
+                }
+            }
+        );
+        scheduler.Wait(encode);
+
+        return data;
+    }
+
+    BinaryData VertexCompression::EncodeIndices(const std::vector<uint32>& indices, const std::vector<SubMeshData>& sub_meshes, const MeshLodChunk& lods, IndexFormatChunk& out_format)
+    {
+        uint32 num_sub_meshes = static_cast<uint32>(sub_meshes.size());
+        std::vector<uint32> min_vertices(num_sub_meshes, UINT32_MAX);
+        std::vector<uint32> max_vertices(num_sub_meshes, 0);
+
+        // sub mesh i owns the ranges i, i + n, i + 2n... of the full resolution sub meshes followed by the ones of the lods
+        auto for_each_range = [&](auto&& fn)
+        {
+            for (uint32 i = 0; i < num_sub_meshes; i++)
+            {
+                fn(i, sub_meshes[i]);
+            }
+            for (uint32 i = 0; i < lods.SubMeshes.size(); i++)
+            {
+                fn(i % num_sub_meshes, lods.SubMeshes[i]);
+            }
+        };
+
+        uint64 num_covered = 0;
+        for_each_range(
+            [&](uint32 sub_mesh, const SubMeshData& range)
+            {
+                for (uint32 i = range.Index; i < range.Index + range.IndicesCount; i++)
+                {
+                    min_vertices[sub_mesh] = std::min(min_vertices[sub_mesh], indices[i]);
+                    max_vertices[sub_mesh] = std::max(max_vertices[sub_mesh], indices[i]);
+                }
+                num_covered += range.IndicesCount;
+            }
+        );
+
+        // an index out of every sub mesh would lose its base vertex
+        bool narrow = num_sub_meshes > 0 && num_covered == indices.size();
+        for (uint32 i = 0; i < num_sub_meshes && narrow; i++)
+        {
+            if (min_vertices[i] == UINT32_MAX)
+            {
+                min_vertices[i] = 0;
+            }
+            else if (max_vertices[i] - min_vertices[i] >= MaxShortIndexSpan)
+            {
+                narrow = false;
+            }
+        }
+
+        if (!narrow)
+        {
+            out_format = IndexFormatChunk{};
+            return BinaryData(indices.data(), static_cast<uint32>(indices.size() * sizeof(uint32)));
+        }
+
+        BinaryData data(static_cast<uint32>(indices.size() * sizeof(uint16)));
+        uint16* short_indices = static_cast<uint16*>(data.GetData());
+        for_each_range(
+            [&](uint32 sub_mesh, const SubMeshData& range)
+            {
+                for (uint32 i = range.Index; i < range.Index + range.IndicesCount; i++)
+                {
+                    short_indices[i] = static_cast<uint16>(indices[i] - min_vertices[sub_mesh]);
+                }
+            }
+        );
+
+        out_format.IndexStride = sizeof(uint16);
+        out_format.BaseVertices = std::move(min_vertices);
+        return data;
+    }
+
+    void VertexCompression::DecodePositions(const MeshData& mesh, std::vector<Vector3>& out_positions)
+    {
+        uint32 num_vertices = mesh.VerticesCount();
+        out_positions.resize(num_vertices);
+
+        const uint8* vertices = static_cast<const uint8*>(mesh.Vertices().GetData());
+        if (mesh.Format() == CompactVertexFormat)
+        {
+            const CompactVertex* compact = reinterpret_cast<const CompactVertex*>(vertices);
+            Vector3 extent = mesh.Bound().Size();
+            for (uint32 i = 0; i < num_vertices; i++)
+            {
+                out_positions[i] = Vector3(
+                    DecodeUnorm16(compact[i].Position[0], mesh.Bound().Min.x, extent.x),
+                    DecodeUnorm16(compact[i].Position[1], mesh.Bound().Min.y, extent.y),
+                    DecodeUnorm16(compact[i].Position[2], mesh.Bound().Min.z, extent.z)
+                );
+            }
+            return;
+        }
+
+        // the other formats start with a float3 position
+        uint32 stride = mesh.VertexStride();
+        for (uint32 i = 0; i < num_vertices; i++)
+        {
+            memcpy(&out_positions[i], vertices + i * stride, sizeof(Vector3));
+        }
+    }
+
+    void VertexCompression::DecodeIndices(const MeshData& mesh, std::vector<uint32>& out_indices)
+    {
+        uint32 num_indices = mesh.IndiciesCount();
+        out_indices.resize(num_indices);
+
+        if (mesh.IndexStride() == sizeof(uint32))
+        {
+            memcpy(out_indices.data(), mesh.Indicies().GetData(), num_indices * sizeof(uint32));
+            return;
+        }
+
+        const IndexFormatChunk& format = mesh.GetIndexFormat();
+        const uint16* short_indices = static_cast<const uint16*>(mesh.Indicies().GetData());
+        auto decode_range = [&](uint32 sub_mesh, const SubMeshData& range)
+        {
+            uint32 base_vertex = format.GetBaseVertex(sub_mesh);
+            for (uint32 i = range.Index; i < range.Index + range.IndicesCount; i++)
+            {
+                out_indices[i] = short_indices[i] + base_vertex;
+            }
+        };
+
+        const std::vector<SubMeshData>& sub_meshes = mesh.GetSubMeshs();
+        for (uint32 i = 0; i < sub_meshes.size(); i++)
+        {
+            decode_range(i, sub_meshes[i]);
+        }
+
+        const std::vector<SubMeshData>& lod_sub_meshes = mesh.GetLods().SubMeshes;
+        for (uint32 i = 0; i < lod_sub_meshes.size(); i++)
+        {
+            decode_range(i, lod_sub_meshes[i]);
+        }
+    }
+}
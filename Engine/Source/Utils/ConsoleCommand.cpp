@@ -1,4 +1,6 @@
 #include <algorithm>
+#include <chrono>
+#include <set>
 
 #include "Resource/ResourceLoader.h"
 #include "Renderer/Device/Direct12/D3D12CommandList.h"
@@ -6,6 +8,7 @@
 #include "DirectXTex.h"
 #include "Utils/ConsoleCommand.h"
 #include "Resource/DefaultResource.h"
+#include "Resource/tiny_obj_loader.h"
 
 namespace MRenderer 
 {
@@ -56,6 +59,7 @@ namespace MRenderer
         fs::path dest_path = mParser.get<std::string>("output");
         float model_scale = mParser.get<float>("scale");
         bool flip_uv_y = mParser.get<bool>("flip_uv_y");
+        bool compress = mParser.get<bool>("compress");
 
         // generate @repo_path like this [Asset/Model/CigarBox => Asset/Model/CigarBox/CigarBox]
         // so all the resources are saved in the same folder, something like this:
@@ -76,10 +80,308 @@ namespace MRenderer
             return;
         }
 
+        bool compress_payloads = ResourceLoader::Instance().CompressPayloads();
+        ResourceLoader::Instance().SetCompressPayloads(compress);
         ResourceLoader::ImportModel(source_path.string(), repo_path.string(), model_scale, flip_uv_y);
+        ResourceLoader::Instance().SetCompressPayloads(compress_payloads);
         Log("Import finish, Resource is saved to", repo_path);
     }
 
+    void BenchmarkImportModelCommand::Execute()
+    {
+        namespace fs = std::filesystem;
+        using Clock = std::chrono::steady_clock;
+
+        fs::path source_path = mParser.get<std::string>("file");
+        float model_scale = mParser.get<float>("scale");
+        bool flip_uv_y = mParser.get<bool>("flip_uv_y");
+        int rounds = std::max(mParser.get<int>("rounds"), 1);
+
+        if (source_path == "" || !fs::exists(source_path))
+        {
+            Log("Benchmark failed, File path is empty or not exist");
+            return;
+        }
+
+        if (mParser.get<bool>("baseline"))
+        {
+            tinyobj::attrib_t attrib;
+            std::vector<tinyobj::shape_t> shapes;
+            std::vector<tinyobj::material_t> materials;
+            std::string warn, err;
+
+            auto begin = Clock::now();
+            tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, source_path.string().data(), source_path.parent_path().string().data());
+            Log("tinyobj::LoadObj ", std::chrono::duration<double, std::milli>(Clock::now() - begin).count(), " ms");
+        }
+
+        // the imported resources are discarded
+        fs::path output_path = fs::temp_directory_path() / "MRendererImportBenchmark";
+        for (int round = 0; round < rounds; round++)
+        {
+            fs::remove_all(output_path);
+            fs::path repo_path = output_path / source_path.stem();
+
+            ModelImportTimings timings{};
+            auto begin = Clock::now();
+            if (!ResourceLoader::ImportModel(source_path.string(), repo_path.string(), model_scale, flip_uv_y, &timings))
+            {
+                Log("Benchmark failed, Import failed");
+                break;
+            }
+            double total = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+
+            Log(std::format("round {}: {} triangles, {} materials, {} -> {} vertices ({:.2f}x smaller), total {:.2f} ms", round, timings.NumTriangles, timings.NumMaterials,
+                timings.NumVertices, timings.NumWeldedVertices, static_cast<double>(timings.NumVertices) / timings.NumWeldedVertices, total));
+            Log(std::format("    parse {:.2f} ms, split {:.2f} ms, tangent {:.2f} ms, bound {:.2f} ms, weld {:.2f} ms, optimize {:.2f} ms (ACMR {:.3f}), lod {:.2f} ms ({} lods), compress {:.2f} ms ({} -> {} bytes), write {:.2f} ms, materials {:.2f} ms",
+                timings.Parse, timings.Split, timings.Tangent, timings.Bound, timings.Weld, timings.Optimize, timings.ACMR, timings.Lod, timings.NumLods,
+                timings.Compress, timings.MeshBytes, timings.CompressedMeshBytes, timings.Write, timings.Materials));
+        }
+        fs::remove_all(output_path);
+    }
+
+    // read a byte of every page, like the copy to the upload heap would
+    static uint64 TouchPages(const void* data, uint32 size)
+    {
+        const uint32 PageSize = 4096;
+
+        uint64 sum = 0;
+        const uint8* bytes = static_cast<const uint8*>(data);
+        for (uint32 offset = 0; offset < size; offset += PageSize)
+        {
+            sum += bytes[offset];
+        }
+        return sum;
+    }
+
+    void BenchmarkLoadCommand::Execute()
+    {
+        namespace fs = std::filesystem;
+        using Clock = std::chrono::steady_clock;
+
+        fs::path folder = mParser.get<std::string>("folder");
+        if (folder == "" || !fs::is_directory(folder))
+        {
+            Log("Benchmark failed, Folder path is empty or not exist");
+            return;
+        }
+
+        // the meshes, and the textures referenced by the materials so that the cube maps are left out
+        std::set<std::string> mesh_paths;
+        std::set<std::string> texture_paths;
+        for (const fs::directory_entry& entry : fs::recursive_directory_iterator(folder))
+        {
+            if (entry.path().extension() != ".json")
+            {
+                continue;
+            }
+
+            std::optional<nlohmann::json> json = ResourceLoader::LoadJsonFile(entry.path().string());
+            if (!json.has_value() || !json->is_object())
+            {
+                continue;
+            }
+
+            if (json->contains("mMeshPath") && (*json)["mMeshPath"].is_string() && !json->contains("mMaterialPath"))
+            {
+                mesh_paths.insert((*json)["mMeshPath"].get<std::string>());
+            }
+            else if (json->contains("mTexturePath") && (*json)["mTexturePath"].is_object())
+            {
+                for (auto& [name, texture_repo_path] : (*json)["mTexturePath"].items())
+                {
+                    std::string texture_json_path = fs::path(texture_repo_path.get<std::string>()).replace_extension(".json").string();
+                    std::optional<nlohmann::json> texture = ResourceLoader::LoadJsonFile(texture_json_path);
+                    if (texture.has_value() && texture->contains("mTexturePath") && (*texture)["mTexturePath"].is_string())
+                    {
+                        texture_paths.insert((*texture)["mTexturePath"].get<std::string>());
+                    }
+                }
+            }
+        }
+
+        uint64 file_bytes = 0;
+        for (const std::set<std::string>* paths : { &mesh_paths, &texture_paths })
+        {
+            for (const std::string& data_path : *paths)
+            {
+                file_bytes += fs::file_size(fs::path(data_path).replace_extension(".bin"));
+            }
+        }
+
+        const double MB = 1024.0 * 1024.0;
+        Log(std::format("{} meshes, {} textures, {:.2f} MB of binary files", mesh_paths.size(), texture_paths.size(), file_bytes / MB));
+
+        // the mapped loads go first since the peak working set never goes down
+        for (bool memory_mapped : { true, false })
+        {
+            ProcessMemory before = QueryProcessMemory();
+
+            auto begin = Clock::now();
+            std::vector<MeshData> meshes(mesh_paths.size());
+            std::vector<TextureData> textures(texture_paths.size());
+            uint32 index = 0;
+            for (const std::string& data_path : mesh_paths)
+            {
+                ResourceLoader::Instance().LoadBinary(meshes[index++], data_path, memory_mapped);
+            }
+            index = 0;
+            for (const std::string& data_path : texture_paths)
+            {
+                ResourceLoader::Instance().LoadBinary(textures[index++], data_path, memory_mapped);
+            }
+            double load = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+            ProcessMemory loaded = QueryProcessMemory();
+
+            begin = Clock::now();
+            uint64 checksum = 0;
+            for (const MeshData& mesh : meshes)
+            {
+                checksum += TouchPages(mesh.Vertices().GetData(), mesh.Vertices().GetSize());
+                checksum += TouchPages(mesh.Indicies().GetData(), mesh.Indicies().GetSize());
+            }
+            for (const TextureData& texture : textures)
+            {
+                checksum += TouchPages(texture.Data(), texture.DataSize());
+            }
+            double touch = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+            ProcessMemory touched = QueryProcessMemory();
+
+            Log(std::format("{}: load {:.2f} ms, touch {:.2f} ms (checksum {})", memory_mapped ? "mapped" : "copied", load, touch, checksum));
+            Log(std::format("    resident +{:.2f} MB after load, +{:.2f} MB after touch, peak {:.2f} -> {:.2f} MB, private +{:.2f} MB",
+                (static_cast<double>(loaded.Resident) - before.Resident) / MB, (static_cast<double>(touched.Resident) - before.Resident) / MB,
+                before.PeakResident / MB, touched.PeakResident / MB, (static_cast<double>(touched.Committed) - before.Committed) / MB));
+        }
+    }
+
+    void BenchmarkCompressionCommand::Execute()
+    {
+        namespace fs = std::filesystem;
+        using Clock = std::chrono::steady_clock;
+
+        fs::path folder = mParser.get<std::string>("folder");
+        int rounds = std::max(mParser.get<int>("rounds"), 1);
+        if (folder == "" || !fs::is_directory(folder))
+        {
+            Log("Benchmark failed, Folder path is empty or not exist");
+            return;
+        }
+
+        // each file as one payload, the meshes compress and the bc compressed textures mostly don't
+        uint64 raw_bytes = 0;
+        uint64 stored_bytes = 0;
+        std::vector<std::vector<uint8>> payloads;
+        auto begin = Clock::now();
+        for (const fs::directory_entry& entry : fs::recursive_directory_iterator(folder))
+        {
+            if (!entry.is_regular_file() || entry.path().extension() != ".bin")
+            {
+                continue;
+            }
+
+            std::optional<std::ifstream> file = ReadFile(entry.path().string(), true);
+            ASSERT(file.has_value());
+            std::vector<uint8> content((std::istreambuf_iterator<char>(file.value())), std::istreambuf_iterator<char>());
+
+            RingBuffer rb;
+            BinaryData::WriteCompressedPayload(rb, content.data(), static_cast<uint32>(content.size()));
+            payloads.push_back(rb.Dump());
+
+            raw_bytes += content.size();
+            stored_bytes += payloads.back().size();
+        }
+        double compress = std::chrono::duration<double>(Clock::now() - begin).count();
+
+        if (payloads.empty())
+        {
+            Log("Benchmark failed, No binary file under ", folder);
+            return;
+        }
+
+        const double MB = 1024.0 * 1024.0;
+        Log(std::format("{} files, {:.2f} MB -> {:.2f} MB, ratio {:.3f}, compress {:.1f} MB/s", payloads.size(), raw_bytes / MB, stored_bytes / MB,
+            static_cast<double>(stored_bytes) / raw_bytes, raw_bytes / MB / compress));
+
+        for (bool parallel : { false, true })
+        {
+            uint64 checksum = 0;
+            begin = Clock::now();
+            for (int i = 0; i < rounds; i++)
+            {
+                for (const std::vector<uint8>& payload : payloads)
+                {
+                    RingBuffer rb;
+                    rb.Attach(payload.data(), static_cast<uint32>(payload.size()));
+                    BinaryData data = BinaryData::ReadCompressedPayload(rb, parallel);
+                    checksum += data.GetSize() > 0 ? *static_cast<const uint8*>(data.Offset(data.GetSize() - 1)) : 0;
+                }
+            }
+            double decode = std::chrono::duration<double>(Clock::now() - begin).count();
+
+            Log(std::format("{}: decode {:.1f} MB/s (checksum {})", parallel ? "workers" : "one thread", raw_bytes * rounds / MB / decode, checksum));
+        }
+    }
+
+    void PackArchiveCommand::Execute()
+    {
+        using Clock = std::chrono::steady_clock;
+
+        auto folder = mParser.get<std::string>("folder");
+        auto output = mParser.get<std::string>("output");
+        bool compress = mParser.get<bool>("compress");
+
+        if (folder == "" || output == "")
+        {
+            Log("Pack failed, Folder path or output path is empty");
+            return;
+        }
+
+        ArchivePackStats stats{};
+        auto begin = Clock::now();
+        if (!AssetArchive::Pack(folder, output, compress, &stats))
+        {
+            return;
+        }
+        double total = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+
+        const double MB = 1024.0 * 1024.0;
+        Log(std::format("Pack finish, {} entries ({} compressed), {:.2f} MB -> {:.2f} MB, {:.2f} ms, saved to {}", stats.NumEntries, stats.NumCompressed,
+            stats.RawBytes / MB, stats.ArchiveBytes / MB, total, output));
+    }
+
+    void ResourceCacheCommand::Execute()
+    {
+        int budget = mParser.get<int>("budget");
+        bool trim = mParser.get<bool>("trim");
+
+        // the commands run on the main thread, which owns the device, so the evicted resources can be released here
+        ResourceCache& cache = ResourceLoader::Instance().GetResourceCache();
+        if (budget >= 0)
+        {
+            cache.SetBudget(static_cast<uint64>(budget) << 20);
+            trim = true;
+        }
+
+        if (trim)
+        {
+            Log("Evict ", cache.Trim(), " Resources");
+        }
+
+        const double MB = 1024.0 * 1024.0;
+        ResourceCacheStats stats = cache.GetStats();
+        Log(std::format("{:.2f} / {:.2f} MB, {:.2f} MB unreferenced, {} hits, {} misses, {} evicted ({:.2f} MB)", stats.Bytes / MB, stats.Budget / MB,
+            stats.UnreferencedBytes / MB, stats.NumHits, stats.NumMisses, stats.NumEvictions, stats.EvictedBytes / MB));
+
+        for (uint32 i = 0; i < EResourceCategory_Count; i++)
+        {
+            const ResourceCacheStats::Category& category = stats.Categories[i];
+            if (category.NumResources > 0)
+            {
+                Log(std::format("    {}: {} resources, {:.2f} MB, {} unreferenced ({:.2f} MB)", GetResourceCategoryName(static_cast<EResourceCategory>(i)),
+                    category.NumResources, category.Bytes / MB, category.NumUnreferenced, category.UnreferencedBytes / MB));
+            }
+        }
+    }
 
     void MRenderer::ImportTextureCommand::Execute()
     {
@@ -87,6 +389,8 @@ namespace MRenderer
         fs::path source_path = mParser.get<std::string>("file");
         fs::path dest_path = mParser.get<std::string>("output");
         int format = mParser.get<int>("format");
+        std::string block_name = mParser.get<std::string>("block");
+        std::string quality_name = mParser.get<std::string>("quality");
 
         if (source_path == "" || dest_path == "")
         {
@@ -94,13 +398,37 @@ namespace MRenderer
             return;
         }
 
+        EBlockFormat block_format = EBlockFormat_Count;
+        for (uint32 i = EBlockFormat_BC1; i < EBlockFormat_Count; i++)
+        {
+            if (GetBlockFormatName(static_cast<EBlockFormat>(i)) == block_name)
+            {
+                block_format = static_cast<EBlockFormat>(i);
+            }
+        }
+
+        EBlockQuality quality = EBlockQuality_Count;
+        for (uint32 i = 0; i < EBlockQuality_Count; i++)
+        {
+            if (GetBlockQualityName(static_cast<EBlockQuality>(i)) == quality_name)
+            {
+                quality = static_cast<EBlockQuality>(i);
+            }
+        }
+
+        if (block_format == EBlockFormat_Count || quality == EBlockQuality_Count)
+        {
+            Log("Import failed, unknown block format ", block_name, " or quality ", quality_name);
+            return;
+        }
+
         if (std::filesystem::exists(dest_path))
         {
             Log("Import failed, Output path is already occupied");
             return;
         }
 
-        ResourceLoader::ImportTexture(source_path.string(), dest_path.string(), static_cast<ETextureFormat>(format));
+        ResourceLoader::ImportTexture(source_path.string(), dest_path.string(), static_cast<ETextureFormat>(format), block_format, quality);
         Log("Import finish, Resource is saved to", dest_path);
     }
 
@@ -137,7 +465,7 @@ namespace MRenderer
     // note: command is executed on worker thread
     void CommandExecutor::StartReceivingCommand()
     {
-        auto future = TaskScheduler::Instance().ExecuteOnWorker(
+        auto future = TaskScheduler::Instance().ExecuteOnBackgroundThread(
             [&]() -> void {
                 const uint32 CommandStringBufferSize = 500;
 
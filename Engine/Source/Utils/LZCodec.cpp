@@ -0,0 +1,187 @@
+#include "Utils/LZCodec.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace MRenderer
+{
+    static inline uint32 Load32(const uint8* p)
+    {
+        uint32 value;
+        memcpy(&value, p, sizeof(uint32));
+        return value;
+    }
+
+    static inline uint32 HashSequence(uint32 sequence)
+    {
+        return (sequence * 2654435761u) >> (32 - LZCodec::HashBits);
+    }
+
+    // the part of @length that doesn't fit in the nibble of the token
+    static inline uint8* WriteLength(uint8* op, uint32 length)
+    {
+        for (; length >= 255; length -= 255)
+        {
+            *op++ = 255;
+        }
+        *op++ = static_cast<uint8>(length);
+        return op;
+    }
+
+    static inline bool ReadLength(const uint8*& ip, const uint8* iend, uint32& length)
+    {
+        uint8 byte;
+        do
+        {
+            if (ip == iend)
+            {
+                return false;
+            }
+            byte = *ip++;
+            length += byte;
+        } while (byte == 255);
+        return true;
+    }
+
+    static uint8* WriteSequence(uint8* op, const uint8* literals, uint32 num_literals, uint32 offset, uint32 match_length)
+    {
+        uint8* token = op++;
+        uint32 literal_nibble = std::min(num_literals, 15u);
+        if (num_literals >= 15)
+        {
+            op = WriteLength(op, num_literals - 15);
+        }
+        memcpy(op, literals, num_literals);
+        op += num_literals;
+
+        // the last sequence has no match
+        uint32 match_nibble = 0;
+        if (match_length > 0)
+        {
+            *op++ = static_cast<uint8>(offset);
+            *op++ = static_cast<uint8>(offset >> 8);
+
+            uint32 length = match_length - LZCodec::MinMatch;
+            match_nibble = std::min(length, 15u);
+            if (length >= 15)
+            {
+                op = WriteLength(op, length - 15);
+            }
+        }
+
+        *token = static_cast<uint8>(literal_nibble << 4 | match_nibble);
+        return op;
+    }
+
+    uint32 LZCodec::Compress(const uint8* src, uint32 size, uint8* dst)
+    {
+        // last position of each hashed 4 bytes sequence
+        std::vector<uint32> table(1u << HashBits, UINT32_MAX);
+
+        uint8* op = dst;
+        uint32 anchor = 0;
+        uint32 i = 0;
+        while (i + MinMatch <= size)
+        {
+            uint32 sequence = Load32(src + i);
+            uint32& slot = table[HashSequence(sequence)];
+            uint32 candidate = slot;
+            slot = i;
+
+            if (candidate == UINT32_MAX || i - candidate > MaxOffset || Load32(src + candidate) != sequence)
+            {
+                // skip faster through the data that doesn't compress
+                i += 1 + ((i - anchor) >> 6);
+                continue;
+            }
+
+            uint32 match_length = MinMatch;
+            while (i + match_length < size && src[candidate + match_length] == src[i + match_length])
+            {
+                match_length++;
+            }
+
+            op = WriteSequence(op, src + anchor, i - anchor, i - candidate, match_length);
+            i += match_length;
+            anchor = i;
+        }
+
+        op = WriteSequence(op, src + anchor, size - anchor, 0, 0);
+        return static_cast<uint32>(op - dst);
+    }
+
+    std::vector<uint8> LZCodec::Compress(const uint8* src, uint32 size)
+    {
+        std::vector<uint8> compressed(CompressBound(size));
+        compressed.resize(Compress(src, size, compressed.data()));
+        return compressed;
+    }
+
+    bool LZCodec::Decompress(const uint8* src, uint32 size, uint8* dst, uint32 raw_size)
+    {
+        const uint8* ip = src;
+        const uint8* iend = src + size;
+        uint8* op = dst;
+        uint8* oend = dst + raw_size;
+
+        while (ip < iend)
+        {
+            uint8 token = *ip++;
+
+            uint32 num_literals = token >> 4;
+            if (num_literals == 15 && !ReadLength(ip, iend, num_literals))
+            {
+                return false;
+            }
+            if (num_literals > static_cast<uint32>(iend - ip) || num_literals > static_cast<uint32>(oend - op))
+            {
+                return false;
+            }
+            memcpy(op, ip, num_literals);
+            ip += num_literals;
+            op += num_literals;
+
+            // the last sequence
+            if (ip == iend)
+            {
+                break;
+            }
+
+            if (iend - ip < 2)
+            {
+                return false;
+            }
+            uint32 offset = ip[0] | ip[1] << 8;
+            ip += 2;
+
+            uint32 match_length = token & 15;
+            if (match_length == 15 && !ReadLength(ip, iend, match_length))
+            {
+                return false;
+            }
+            match_length += MinMatch;
+
+            if (offset == 0 || offset > static_cast<uint32>(op - dst) || match_length > static_cast<uint32>(oend - op))
+            {
+                return false;
+            }
+
+            // the match overlaps the output when it repeats a run shorter than itself
+            const uint8* match = op - offset;
+            if (offset >= match_length)
+            {
+                memcpy(op, match, match_length);
+                op += match_length;
+            }
+            else
+            {
+                for (uint32 i = 0; i < match_length; i++)
+                {
+                    *op++ = match[i];
+                }
+            }
+        }
+
+        return op == oend;
+    }
+}
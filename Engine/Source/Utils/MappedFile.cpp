@@ -0,0 +1,112 @@
+#include <string>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "Utils/MappedFile.h"
+
+namespace MRenderer
+{
+#if defined(_WIN32)
+    std::shared_ptr<MappedFile> MappedFile::Open(std::string_view path)
+    {
+        HANDLE file = CreateFileA(std::string(path).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            return nullptr;
+        }
+
+        // the binary data sizes are 32 bits
+        LARGE_INTEGER file_size;
+        if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0 || file_size.QuadPart > UINT32_MAX)
+        {
+            CloseHandle(file);
+            return nullptr;
+        }
+
+        // copy on write, so that the views stay writable like the owned binary data
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+        void* data = mapping ? MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0) : nullptr;
+        if (data == nullptr)
+        {
+            if (mapping)
+            {
+                CloseHandle(mapping);
+            }
+            CloseHandle(file);
+            return nullptr;
+        }
+
+        std::shared_ptr<MappedFile> mapped(new MappedFile());
+        mapped->mData = static_cast<uint8*>(data);
+        mapped->mSize = static_cast<uint32>(file_size.QuadPart);
+        mapped->mFile = file;
+        mapped->mMapping = mapping;
+        return mapped;
+    }
+
+    void MappedFile::Prefetch() const
+    {
+        WIN32_MEMORY_RANGE_ENTRY range{ mData, mSize };
+        PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+    }
+
+    MappedFile::~MappedFile()
+    {
+        if (mData)
+        {
+            UnmapViewOfFile(mData);
+            CloseHandle(mMapping);
+            CloseHandle(mFile);
+        }
+    }
+#else
+    std::shared_ptr<MappedFile> MappedFile::Open(std::string_view path)
+    {
+        int file = open(std::string(path).c_str(), O_RDONLY);
+        if (file < 0)
+        {
+            return nullptr;
+        }
+
+        struct stat file_stat;
+        if (fstat(file, &file_stat) != 0 || file_stat.st_size == 0 || file_stat.st_size > UINT32_MAX)
+        {
+            close(file);
+            return nullptr;
+        }
+
+        // private mapping is copy on write, the file descriptor isn't needed once mapped
+        void* data = mmap(nullptr, file_stat.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+        close(file);
+        if (data == MAP_FAILED)
+        {
+            return nullptr;
+        }
+
+        std::shared_ptr<MappedFile> mapped(new MappedFile());
+        mapped->mData = static_cast<uint8*>(data);
+        mapped->mSize = static_cast<uint32>(file_stat.st_size);
+        return mapped;
+    }
+
+    void MappedFile::Prefetch() const
+    {
+        madvise(mData, mSize, MADV_WILLNEED);
+    }
+
+    MappedFile::~MappedFile()
+    {
+        if (mData)
+        {
+            munmap(mData, mSize);
+        }
+    }
+#endif
+}
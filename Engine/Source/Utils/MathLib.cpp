@@ -1,12 +1,80 @@
 #include "Utils/MathLib.h"
 
+#include <bit>
+#include <immintrin.h>
+
 namespace MRenderer
 {
+    // transforming only the min and max corner is wrong once there is rotation, the center and the extent are transformed instead,
+    // the new extent along each axis is the extent projected on the absolute value of the matrix row, the last row of @mat is ignored
+    // ref: Arvo, Transforming Axis-Aligned Bounding Boxes, Graphics Gems 1990
     AABB operator*(const Matrix4x4& mat, const AABB& aabb)
     {
-        Vector3 min = mat * Vector4(aabb.Min, 1);
-        Vector3 max = mat * Vector4(aabb.Max, 1);
-        return AABB(Vector3::Min(min, max), Vector3::Max(min, max));
+        __m128 column0 = _mm_load_ps(&mat.At(0, 0));
+        __m128 column1 = _mm_load_ps(&mat.At(1, 0));
+        __m128 column2 = _mm_load_ps(&mat.At(2, 0));
+        __m128 column3 = _mm_load_ps(&mat.At(3, 0));
+        _MM_TRANSPOSE4_PS(column0, column1, column2, column3);
+
+        Vec4f min = aabb.Min.ToVec4f();
+        Vec4f max = aabb.Max.ToVec4f();
+        Vec4f center = (min + max) * 0.5f;
+        Vec4f extent = (max - min) * 0.5f;
+
+        Vec4f new_center = Vec4f(column0) * center.Splat<0>() + Vec4f(column1) * center.Splat<1>() + Vec4f(column2) * center.Splat<2>() + column3;
+        Vec4f new_extent = Vec4f(column0).Abs() * extent.Splat<0>() + Vec4f(column1).Abs() * extent.Splat<1>() + Vec4f(column2).Abs() * extent.Splat<2>();
+
+        return AABB(Vector3::FromVec4f(new_center - new_extent), Vector3::FromVec4f(new_center + new_extent));
+    }
+
+    uint32 FrustumVolume::Contains8(const AABBSoA& bounds, uint32 begin, uint32& inside_mask) const
+    {
+        ASSERT(begin < bounds.Size());
+
+        const __m256 half = _mm256_set1_ps(0.5f);
+        const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+
+        __m256 min_x = _mm256_loadu_ps(bounds.MinX.data() + begin);
+        __m256 min_y = _mm256_loadu_ps(bounds.MinY.data() + begin);
+        __m256 min_z = _mm256_loadu_ps(bounds.MinZ.data() + begin);
+        __m256 max_x = _mm256_loadu_ps(bounds.MaxX.data() + begin);
+        __m256 max_y = _mm256_loadu_ps(bounds.MaxY.data() + begin);
+        __m256 max_z = _mm256_loadu_ps(bounds.MaxZ.data() + begin);
+
+        __m256 center_x = _mm256_mul_ps(_mm256_add_ps(min_x, max_x), half);
+        __m256 center_y = _mm256_mul_ps(_mm256_add_ps(min_y, max_y), half);
+        __m256 center_z = _mm256_mul_ps(_mm256_add_ps(min_z, max_z), half);
+        __m256 extent_x = _mm256_mul_ps(_mm256_sub_ps(max_x, min_x), half);
+        __m256 extent_y = _mm256_mul_ps(_mm256_sub_ps(max_y, min_y), half);
+        __m256 extent_z = _mm256_mul_ps(_mm256_sub_ps(max_z, min_z), half);
+
+        // same as the scalar version, but 8 AABBs per plane at a time
+        __m256 outside = _mm256_setzero_ps();
+        __m256 intersect = _mm256_setzero_ps();
+        for (uint32 i = 0; i < 6; i++)
+        {
+            __m256 plane_x = _mm256_set1_ps(Planes[i].x);
+            __m256 plane_y = _mm256_set1_ps(Planes[i].y);
+            __m256 plane_z = _mm256_set1_ps(Planes[i].z);
+            __m256 plane_w = _mm256_set1_ps(Planes[i].w);
+
+            __m256 center_distance = _mm256_add_ps(
+                _mm256_add_ps(_mm256_mul_ps(center_x, plane_x), _mm256_mul_ps(center_y, plane_y)),
+                _mm256_add_ps(_mm256_mul_ps(center_z, plane_z), plane_w)
+            );
+
+            __m256 half_diagnoal_projection = _mm256_add_ps(
+                _mm256_add_ps(_mm256_mul_ps(extent_x, _mm256_and_ps(plane_x, abs_mask)), _mm256_mul_ps(extent_y, _mm256_and_ps(plane_y, abs_mask))),
+                _mm256_mul_ps(extent_z, _mm256_and_ps(plane_z, abs_mask))
+            );
+
+            // below the plane => outside, not above the plane => intersect with the plane
+            outside = _mm256_or_ps(outside, _mm256_cmp_ps(center_distance, _mm256_sub_ps(_mm256_setzero_ps(), half_diagnoal_projection), _CMP_LT_OQ));
+            intersect = _mm256_or_ps(intersect, _mm256_cmp_ps(center_distance, half_diagnoal_projection, _CMP_LE_OQ));
+        }
+
+        inside_mask = ~static_cast<uint32>(_mm256_movemask_ps(intersect)) & 0xff;
+        return ~static_cast<uint32>(_mm256_movemask_ps(outside)) & 0xff;
     }
     // ndc.z -> [-1, 1]
     Matrix4x4 ProjectionMatrix0(float fov, float ratio, float near_z, float far_z)
@@ -157,4 +225,328 @@ namespace MRenderer
         UNEXPECTED("unexpected index");
         return Vector3();
     }
+
+    // the float is rebiased from exponent 127 to 15 and its mantissa is cut from 23 to 10 bits, the rounding carry may run into the exponent,
+    // which is still correct up to infinity. values below 2^-14 become denormals, whose mantissa carries the implicit bit shifted right
+    uint16 FloatToHalf(float value)
+    {
+        uint32 bits = std::bit_cast<uint32>(value);
+        uint32 sign = (bits >> 16) & 0x8000;
+        uint32 magnitude = bits & 0x7FFFFFFF;
+
+        // nan stays a quiet nan
+        if (magnitude >= 0x7F800000)
+        {
+            return static_cast<uint16>(sign | (magnitude > 0x7F800000 ? 0x7E00 : 0x7C00));
+        }
+
+        // 65520 is the halfway point between the largest half 65504 and 65536, it rounds to the even infinity
+        if (magnitude >= 0x477FF000)
+        {
+            return static_cast<uint16>(sign | 0x7C00);
+        }
+
+        uint32 half;
+        uint32 remainder;
+        uint32 halfway;
+        if (magnitude < 0x38800000)
+        {
+            // half of the smallest denormal 2^-24 or less rounds to zero
+            if (magnitude <= 0x33000000)
+            {
+                return static_cast<uint16>(sign);
+            }
+
+            uint32 shift = 126 - (magnitude >> 23);
+            uint32 mantissa = (magnitude & 0x7FFFFF) | 0x800000;
+            half = mantissa >> shift;
+            remainder = mantissa & ((1u << shift) - 1);
+            halfway = 1u << (shift - 1);
+        }
+        else
+        {
+            half = (magnitude - 0x38000000) >> 13;
+            remainder = magnitude & 0x1FFF;
+            halfway = 0x1000;
+        }
+
+        if (remainder > halfway || (remainder == halfway && (half & 1)))
+        {
+            half++;
+        }
+        return static_cast<uint16>(sign | half);
+    }
+
+    float HalfToFloat(uint16 value)
+    {
+        uint32 sign = static_cast<uint32>(value & 0x8000) << 16;
+        uint32 exponent = (value >> 10) & 0x1F;
+        uint32 mantissa = value & 0x3FF;
+
+        if (exponent == 0x1F)
+        {
+            return std::bit_cast<float>(sign | 0x7F800000 | (mantissa << 13));
+        }
+
+        if (exponent == 0)
+        {
+            // denormal, mantissa * 2^-24
+            float magnitude = static_cast<float>(mantissa) * (1.0f / 16777216.0f);
+            return sign ? -magnitude : magnitude;
+        }
+
+        return std::bit_cast<float>(sign | ((exponent + 112) << 23) | (mantissa << 13));
+    }
+
+    // pick a[x], a[y], b[z], b[w] in each 128 bits lane
+    template<uint32 x, uint32 y, uint32 z, uint32 w>
+    static inline __m256 Shuffle(__m256 a, __m256 b)
+    {
+        return _mm256_shuffle_ps(a, b, _MM_SHUFFLE(w, z, y, x));
+    }
+
+    template<uint32 x, uint32 y, uint32 z, uint32 w>
+    static inline __m256 Swizzle(__m256 a)
+    {
+        return _mm256_permute_ps(a, _MM_SHUFFLE(w, z, y, x));
+    }
+
+    // row @row of @a in the low 128 bits, of @b in the high 128 bits
+    static inline __m256 LoadRowPair(const Matrix4x4& a, const Matrix4x4& b, uint32 row)
+    {
+        return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(&a.At(row, 0))), _mm_loadu_ps(&b.At(row, 0)), 1);
+    }
+
+    static inline void StoreRowPair(Matrix4x4& a, Matrix4x4* b, uint32 row, __m256 value)
+    {
+        _mm_storeu_ps(&a.At(row, 0), _mm256_castps256_ps128(value));
+        if (b)
+        {
+            _mm_storeu_ps(&b->At(row, 0), _mm256_extractf128_ps(value, 1));
+        }
+    }
+
+    // 2x2 row major matrices packed in 4 floats, A * B, adj(A) * B, A * adj(B)
+    static inline __m256 Mat2Mul(__m256 a, __m256 b)
+    {
+        return _mm256_add_ps(_mm256_mul_ps(a, Swizzle<0, 3, 0, 3>(b)), _mm256_mul_ps(Swizzle<1, 0, 3, 2>(a), Swizzle<2, 1, 2, 1>(b)));
+    }
+
+    static inline __m256 Mat2AdjMul(__m256 a, __m256 b)
+    {
+        return _mm256_sub_ps(_mm256_mul_ps(Swizzle<3, 3, 0, 0>(a), b), _mm256_mul_ps(Swizzle<1, 1, 2, 2>(a), Swizzle<2, 3, 0, 1>(b)));
+    }
+
+    static inline __m256 Mat2MulAdj(__m256 a, __m256 b)
+    {
+        return _mm256_sub_ps(_mm256_mul_ps(a, Swizzle<3, 0, 3, 0>(b)), _mm256_mul_ps(Swizzle<1, 0, 3, 2>(a), Swizzle<2, 1, 2, 1>(b)));
+    }
+
+    void InverseMatrixBatch(const Matrix4x4* input, Matrix4x4* output, uint32 count)
+    {
+        // each 128 bits lane holds one matrix, all the shuffles below stay in lane
+        for (uint32 i = 0; i < count; i += 2)
+        {
+            const Matrix4x4& first = input[i];
+            const Matrix4x4& second = i + 1 < count ? input[i + 1] : input[i];
+
+            __m256 r0 = LoadRowPair(first, second, 0);
+            __m256 r1 = LoadRowPair(first, second, 1);
+            __m256 r2 = LoadRowPair(first, second, 2);
+            __m256 r3 = LoadRowPair(first, second, 3);
+
+            // | A B |
+            // | C D |
+            __m256 a = Shuffle<0, 1, 0, 1>(r0, r1);
+            __m256 b = Shuffle<2, 3, 2, 3>(r0, r1);
+            __m256 c = Shuffle<0, 1, 0, 1>(r2, r3);
+            __m256 d = Shuffle<2, 3, 2, 3>(r2, r3);
+
+            // (|A|, |B|, |C|, |D|)
+            __m256 det_sub = _mm256_sub_ps(
+                _mm256_mul_ps(Shuffle<0, 2, 0, 2>(r0, r2), Shuffle<1, 3, 1, 3>(r1, r3)),
+                _mm256_mul_ps(Shuffle<1, 3, 1, 3>(r0, r2), Shuffle<0, 2, 0, 2>(r1, r3))
+            );
+            __m256 det_a = Swizzle<0, 0, 0, 0>(det_sub);
+            __m256 det_b = Swizzle<1, 1, 1, 1>(det_sub);
+            __m256 det_c = Swizzle<2, 2, 2, 2>(det_sub);
+            __m256 det_d = Swizzle<3, 3, 3, 3>(det_sub);
+
+            __m256 d_c = Mat2AdjMul(d, c);
+            __m256 a_b = Mat2AdjMul(a, b);
+
+            // adjugates of the blocks of the inverse
+            __m256 x = _mm256_sub_ps(_mm256_mul_ps(det_d, a), Mat2Mul(b, d_c));
+            __m256 w = _mm256_sub_ps(_mm256_mul_ps(det_a, d), Mat2Mul(c, a_b));
+            __m256 y = _mm256_sub_ps(_mm256_mul_ps(det_b, c), Mat2MulAdj(d, a_b));
+            __m256 z = _mm256_sub_ps(_mm256_mul_ps(det_c, b), Mat2MulAdj(a, d_c));
+
+            // |M| = |A||D| + |B||C| - tr(adj(A)B adj(D)C)
+            __m256 trace = _mm256_mul_ps(a_b, Swizzle<0, 2, 1, 3>(d_c));
+            trace = _mm256_hadd_ps(trace, trace);
+            trace = _mm256_hadd_ps(trace, trace);
+            __m256 det = _mm256_sub_ps(_mm256_add_ps(_mm256_mul_ps(det_a, det_d), _mm256_mul_ps(det_b, det_c)), trace);
+
+            __m256 inv_det = _mm256_div_ps(_mm256_setr_ps(1, -1, -1, 1, 1, -1, -1, 1), det);
+            x = _mm256_mul_ps(x, inv_det);
+            y = _mm256_mul_ps(y, inv_det);
+            z = _mm256_mul_ps(z, inv_det);
+            w = _mm256_mul_ps(w, inv_det);
+
+            // undo the adjugate while storing
+            r0 = Shuffle<3, 1, 3, 1>(x, y);
+            r1 = Shuffle<2, 0, 2, 0>(x, y);
+            r2 = Shuffle<3, 1, 3, 1>(z, w);
+            r3 = Shuffle<2, 0, 2, 0>(z, w);
+
+            Matrix4x4* second_output = i + 1 < count ? &output[i + 1] : nullptr;
+            StoreRowPair(output[i], second_output, 0, r0);
+            StoreRowPair(output[i], second_output, 1, r1);
+            StoreRowPair(output[i], second_output, 2, r2);
+            StoreRowPair(output[i], second_output, 3, r3);
+
+            alignas(32) float dets[8];
+            _mm256_store_ps(dets, det);
+            if (dets[0] == 0)
+            {
+                output[i] = Matrix4x4::Identity();
+            }
+            if (second_output && dets[4] == 0)
+            {
+                *second_output = Matrix4x4::Identity();
+            }
+        }
+    }
+
+    void InverseTRSMatrixBatch(const Matrix4x4* input, Matrix4x4* output, uint32 count)
+    {
+        const __m256 last_row = _mm256_setr_ps(0, 0, 0, 1, 0, 0, 0, 1);
+
+        for (uint32 i = 0; i < count; i += 2)
+        {
+            const Matrix4x4& first = input[i];
+            const Matrix4x4& second = i + 1 < count ? input[i + 1] : input[i];
+
+            __m256 r0 = LoadRowPair(first, second, 0);
+            __m256 r1 = LoadRowPair(first, second, 1);
+            __m256 r2 = LoadRowPair(first, second, 2);
+
+            // transpose, the columns of the rotation and scale part and the translation
+            __m256 t0 = _mm256_unpacklo_ps(r0, r1);
+            __m256 t1 = _mm256_unpacklo_ps(r2, last_row);
+            __m256 t2 = _mm256_unpackhi_ps(r0, r1);
+            __m256 t3 = _mm256_unpackhi_ps(r2, last_row);
+            __m256 columns[3] = { Shuffle<0, 1, 0, 1>(t0, t1), Shuffle<2, 3, 2, 3>(t0, t1), Shuffle<0, 1, 0, 1>(t2, t3) };
+            __m256 translation = Shuffle<2, 3, 2, 3>(t2, t3);
+
+            // M = R * S, M^-1 = S^-1 * R^T = S^-2 * M^T, the squared scale is the squared length of each column
+            Matrix4x4* second_output = i + 1 < count ? &output[i + 1] : nullptr;
+            for (uint32 row = 0; row < 3; row++)
+            {
+                __m256 inv_row = _mm256_div_ps(columns[row], _mm256_dp_ps(columns[row], columns[row], 0x7F));
+                __m256 inv_translation = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_dp_ps(inv_row, translation, 0x7F));
+                StoreRowPair(output[i], second_output, row, _mm256_blend_ps(inv_row, inv_translation, 0x88));
+            }
+            StoreRowPair(output[i], second_output, 3, last_row);
+        }
+    }
+
+    void TransformPointBatch(const Matrix4x4& matrix, const Vector3* input, Vector3* output, uint32 count)
+    {
+        __m256 m[3][4];
+        for (uint32 r = 0; r < 3; r++)
+        {
+            for (uint32 c = 0; c < 4; c++)
+            {
+                m[r][c] = _mm256_set1_ps(matrix.At(r, c));
+            }
+        }
+
+        uint32 i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            // 8 packed xyz to 3 registers of x, y and z
+            // ref: https://www.intel.com/content/dam/develop/external/us/en/documents/normvec-181650.pdf
+            const float* src = &input[i].x;
+            __m256 m03 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(src + 0)), _mm_loadu_ps(src + 12), 1);
+            __m256 m14 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(src + 4)), _mm_loadu_ps(src + 16), 1);
+            __m256 m25 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(src + 8)), _mm_loadu_ps(src + 20), 1);
+
+            __m256 xy = _mm256_shuffle_ps(m14, m25, _MM_SHUFFLE(2, 1, 3, 2));
+            __m256 yz = _mm256_shuffle_ps(m03, m14, _MM_SHUFFLE(1, 0, 2, 1));
+            __m256 x = _mm256_shuffle_ps(m03, xy, _MM_SHUFFLE(2, 0, 3, 0));
+            __m256 y = _mm256_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0));
+            __m256 z = _mm256_shuffle_ps(yz, m25, _MM_SHUFFLE(3, 0, 3, 1));
+
+            __m256 out[3];
+            for (uint32 r = 0; r < 3; r++)
+            {
+                out[r] = _mm256_add_ps(
+                    _mm256_add_ps(_mm256_mul_ps(m[r][0], x), _mm256_mul_ps(m[r][1], y)),
+                    _mm256_add_ps(_mm256_mul_ps(m[r][2], z), m[r][3])
+                );
+            }
+
+            // and back
+            __m256 rxy = _mm256_shuffle_ps(out[0], out[1], _MM_SHUFFLE(2, 0, 2, 0));
+            __m256 ryz = _mm256_shuffle_ps(out[1], out[2], _MM_SHUFFLE(3, 1, 3, 1));
+            __m256 rzx = _mm256_shuffle_ps(out[2], out[0], _MM_SHUFFLE(3, 1, 2, 0));
+            __m256 r03 = _mm256_shuffle_ps(rxy, rzx, _MM_SHUFFLE(2, 0, 2, 0));
+            __m256 r14 = _mm256_shuffle_ps(ryz, rxy, _MM_SHUFFLE(3, 1, 2, 0));
+            __m256 r25 = _mm256_shuffle_ps(rzx, ryz, _MM_SHUFFLE(3, 1, 3, 1));
+
+            float* dst = &output[i].x;
+            _mm_storeu_ps(dst + 0, _mm256_castps256_ps128(r03));
+            _mm_storeu_ps(dst + 4, _mm256_castps256_ps128(r14));
+            _mm_storeu_ps(dst + 8, _mm256_castps256_ps128(r25));
+            _mm_storeu_ps(dst + 12, _mm256_extractf128_ps(r03, 1));
+            _mm_storeu_ps(dst + 16, _mm256_extractf128_ps(r14, 1));
+            _mm_storeu_ps(dst + 20, _mm256_extractf128_ps(r25, 1));
+        }
+
+        for (; i < count; i++)
+        {
+            Vector3 p = input[i];
+            output[i] = Vector3(
+                matrix.At(0, 0) * p.x + matrix.At(0, 1) * p.y + matrix.At(0, 2) * p.z + matrix.At(0, 3),
+                matrix.At(1, 0) * p.x + matrix.At(1, 1) * p.y + matrix.At(1, 2) * p.z + matrix.At(1, 3),
+                matrix.At(2, 0) * p.x + matrix.At(2, 1) * p.y + matrix.At(2, 2) * p.z + matrix.At(2, 3)
+            );
+        }
+    }
+
+    void TransformVectorBatch(const Matrix4x4& matrix, const Vector4* input, Vector4* output, uint32 count)
+    {
+        // columns of the matrix, duplicated in both 128 bits lanes
+        __m256 columns[4];
+        for (uint32 c = 0; c < 4; c++)
+        {
+            columns[c] = _mm256_setr_ps(
+                matrix.At(0, c), matrix.At(1, c), matrix.At(2, c), matrix.At(3, c),
+                matrix.At(0, c), matrix.At(1, c), matrix.At(2, c), matrix.At(3, c)
+            );
+        }
+
+        // 2 vectors at a time, M * v = v.x * column0 + v.y * column1 + v.z * column2 + v.w * column3
+        uint32 i = 0;
+        for (; i + 2 <= count; i += 2)
+        {
+            __m256 v = _mm256_loadu_ps(&input[i].x);
+            __m256 out = _mm256_add_ps(
+                _mm256_add_ps(_mm256_mul_ps(columns[0], Swizzle<0, 0, 0, 0>(v)), _mm256_mul_ps(columns[1], Swizzle<1, 1, 1, 1>(v))),
+                _mm256_add_ps(_mm256_mul_ps(columns[2], Swizzle<2, 2, 2, 2>(v)), _mm256_mul_ps(columns[3], Swizzle<3, 3, 3, 3>(v)))
+            );
+            _mm256_storeu_ps(&output[i].x, out);
+        }
+
+        if (i < count)
+        {
+            __m128 v = _mm_loadu_ps(&input[i].x);
+            __m128 out = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(_mm256_castps256_ps128(columns[0]), _mm_permute_ps(v, 0x00)), _mm_mul_ps(_mm256_castps256_ps128(columns[1]), _mm_permute_ps(v, 0x55))),
+                _mm_add_ps(_mm_mul_ps(_mm256_castps256_ps128(columns[2]), _mm_permute_ps(v, 0xAA)), _mm_mul_ps(_mm256_castps256_ps128(columns[3]), _mm_permute_ps(v, 0xFF)))
+            );
+            _mm_storeu_ps(&output[i].x, out);
+        }
+    }
 }
@@ -0,0 +1,62 @@
+#include "Utils/MeshletCulling.h"
+
+namespace MRenderer
+{
+    MeshletCulling MeshletCulling::FromWorld(const Matrix4x4& view_projection, const Vector3& camera_position, const Matrix4x4& world, const Matrix4x4& inv_world)
+    {
+        // planes of view_projection * world are the frustum planes in the object space
+        Vector4 local_camera = inv_world * Vector4(camera_position, 1.0f);
+        return MeshletCulling(FrustumVolume::FromMatrix(view_projection * world), Vector3(local_camera.x, local_camera.y, local_camera.z));
+    }
+
+    bool MeshletCulling::IsVisible(const MeshletData& meshlet, MeshletCullStatus& status) const
+    {
+        if (!mFrustum.Contains(meshlet.Bound))
+        {
+            status.NumFrustumCulled++;
+            return false;
+        }
+
+        // the camera is inside the back facing cone of all the triangles, with the bounding sphere accounting for the positions of the apexes
+        // ref: https://github.com/zeux/meshoptimizer#cluster-culling
+        Vec4f view = meshlet.Center.ToVec4f() - mCameraPosition.ToVec4f();
+        if (view.Dot3(meshlet.ConeAxis.ToVec4f()).X() >= meshlet.ConeCutoff * view.Length3().X() + meshlet.Radius)
+        {
+            status.NumBackfaceCulled++;
+            return false;
+        }
+
+        return true;
+    }
+
+    void MeshletCulling::Cull(std::span<const MeshletData> meshlets, const SubMeshData& sub_mesh, std::vector<SubMeshData>& out_ranges, MeshletCullStatus& status) const
+    {
+        // meshlets are sorted by their index range and don't cross the sub meshes
+        auto first = std::lower_bound(meshlets.begin(), meshlets.end(), sub_mesh.Index,
+            [](const MeshletData& meshlet, uint32 index) { return meshlet.Index < index; });
+
+        uint32 sub_mesh_end = sub_mesh.Index + sub_mesh.IndicesCount;
+        bool extend_last = false;
+        for (auto it = first; it != meshlets.end() && it->Index < sub_mesh_end; ++it)
+        {
+            status.NumMeshlets++;
+            if (!IsVisible(*it, status))
+            {
+                extend_last = false;
+                continue;
+            }
+
+            status.NumIndices += it->IndicesCount;
+            if (extend_last)
+            {
+                out_ranges.back().IndicesCount += it->IndicesCount;
+            }
+            else
+            {
+                out_ranges.push_back(SubMeshData{ .Index = it->Index, .IndicesCount = it->IndicesCount });
+                status.NumRanges++;
+                extend_last = true;
+            }
+        }
+    }
+}
@@ -57,8 +57,34 @@ namespace MRenderer
         return str;
     }
 
+    void RingBuffer::Attach(const uint8* data, uint32 size, std::shared_ptr<MappedFile> source)
+    {
+        ASSERT(size > 0);
+
+        if (mBuffer != nullptr && !mAttached)
+        {
+            free(mBuffer);
+        }
+
+        // reads never write through the buffer
+        mBuffer = const_cast<uint8*>(data);
+        mCapacity = size;
+        mBegin = mEnd = 0;
+        mFull = true;
+        mAttached = true;
+        mSource = std::move(source);
+    }
+
     void RingBuffer::Write(const uint8* data, uint32 size)
     {
+        ASSERT(!mAttached && "attached buffer is read only");
+
+        // the padding of the payloads can be empty, and the buffer may not be allocated yet
+        if (size == 0)
+        {
+            return;
+        }
+
         if (Avaliable() < size)
         {
             Extend(size);
@@ -89,6 +115,12 @@ namespace MRenderer
     {
         const uint8* ret = Peek(size);
 
+        // an empty read of a full buffer would empty it
+        if (size == 0)
+        {
+            return ret;
+        }
+
         mBegin = (mBegin + size) % mCapacity;
         mFull = false;
         return ret;
@@ -96,7 +128,7 @@ namespace MRenderer
 
     RingBuffer::~RingBuffer()
     {
-        if (mBuffer != nullptr) 
+        if (mBuffer != nullptr && !mAttached) 
         {
             free(mBuffer);
             mBuffer = nullptr;
@@ -0,0 +1,351 @@
+#include "Utils/Occlusion.h"
+
+#include <algorithm>
+#include <immintrin.h>
+
+namespace MRenderer
+{
+    OccluderMesh OccluderMesh::FromVertices(const void* vertices, uint32 num_vertices, uint32 stride, const uint32* indices, uint32 num_indices)
+    {
+        ASSERT(stride >= 3 * sizeof(float));
+
+        OccluderMesh mesh;
+        mesh.Positions.resize(num_vertices * 3);
+        const uint8* src = static_cast<const uint8*>(vertices);
+        for (uint32 i = 0; i < num_vertices; i++)
+        {
+            memcpy(mesh.Positions.data() + i * 3, src + i * stride, 3 * sizeof(float));
+        }
+
+        mesh.Indices.assign(indices, indices + num_indices);
+        return mesh;
+    }
+
+    OccluderMesh OccluderMesh::FromBound(const AABB& bound)
+    {
+        OccluderMesh mesh;
+        mesh.Positions.reserve(8 * 3);
+        for (uint32 i = 0; i < 8; i++)
+        {
+            mesh.Positions.push_back(i & 1 ? bound.Max.x : bound.Min.x);
+            mesh.Positions.push_back(i & 2 ? bound.Max.y : bound.Min.y);
+            mesh.Positions.push_back(i & 4 ? bound.Max.z : bound.Min.z);
+        }
+
+        // two triangles per face, vertex i has bit 0/1/2 set if it's on the max x/y/z side
+        mesh.Indices = {
+            0, 2, 6, 0, 6, 4,  // -x
+            1, 5, 7, 1, 7, 3,  // +x
+            0, 4, 5, 0, 5, 1,  // -y
+            2, 3, 7, 2, 7, 6,  // +y
+            0, 1, 3, 0, 3, 2,  // -z
+            4, 6, 7, 4, 7, 5,  // +z
+        };
+        return mesh;
+    }
+
+    OcclusionBuffer::OcclusionBuffer()
+        :mViewProjection(Matrix4x4::Identity()), mHierarchyDirty(true)
+    {
+        for (uint32 mip = 0; mip < NumMips; mip++)
+        {
+            mMips[mip].resize(MipWidth(mip) * MipHeight(mip), 1.0f);
+        }
+    }
+
+    void OcclusionBuffer::Clear(const Matrix4x4& view_projection)
+    {
+        mViewProjection = view_projection;
+        std::fill(mMips[0].begin(), mMips[0].end(), 1.0f);
+        mHierarchyDirty = true;
+    }
+
+    void OcclusionBuffer::RasterizeOccluder(const OccluderMesh& mesh, const Matrix4x4& world)
+    {
+        ASSERT(mesh.Indices.size() % 3 == 0);
+
+        Matrix4x4 matrix = mViewProjection * world;
+        float m[4][4];
+        for (uint32 r = 0; r < 4; r++)
+        {
+            for (uint32 c = 0; c < 4; c++)
+            {
+                m[r][c] = matrix.At(r, c);
+            }
+        }
+
+        // transform to clip space once per vertex
+        uint32 num_vertices = static_cast<uint32>(mesh.Positions.size() / 3);
+        std::vector<float> clip(num_vertices * 4);
+        for (uint32 i = 0; i < num_vertices; i++)
+        {
+            const float* p = mesh.Positions.data() + i * 3;
+            for (uint32 r = 0; r < 4; r++)
+            {
+                clip[i * 4 + r] = m[r][0] * p[0] + m[r][1] * p[1] + m[r][2] * p[2] + m[r][3];
+            }
+        }
+
+        auto to_screen = [](const float* c, float* out)
+        {
+            float inv_w = 1.0f / c[3];
+            out[0] = (c[0] * inv_w * 0.5f + 0.5f) * Width;
+            out[1] = (0.5f - c[1] * inv_w * 0.5f) * Height;
+            out[2] = c[2] * inv_w;
+        };
+
+        for (size_t i = 0; i < mesh.Indices.size(); i += 3)
+        {
+            const float* tri[3] = {
+                clip.data() + mesh.Indices[i + 0] * 4,
+                clip.data() + mesh.Indices[i + 1] * 4,
+                clip.data() + mesh.Indices[i + 2] * 4,
+            };
+
+            uint32 num_behind = (tri[0][2] < 0) + (tri[1][2] < 0) + (tri[2][2] < 0);
+            if (num_behind == 3)
+            {
+                continue;
+            }
+
+            if (num_behind == 0)
+            {
+                float s[3][3];
+                to_screen(tri[0], s[0]);
+                to_screen(tri[1], s[1]);
+                to_screen(tri[2], s[2]);
+                RasterizeTriangle(s[0], s[1], s[2]);
+                continue;
+            }
+
+            // clip the triangle against the near plane (z = 0), results in a triangle or a quad
+            float polygon[4][4];
+            uint32 num_polygon = 0;
+            for (uint32 k = 0; k < 3; k++)
+            {
+                const float* a = tri[k];
+                const float* b = tri[(k + 1) % 3];
+                if (a[2] >= 0)
+                {
+                    memcpy(polygon[num_polygon++], a, 4 * sizeof(float));
+                }
+
+                if ((a[2] < 0) != (b[2] < 0))
+                {
+                    float t = a[2] / (a[2] - b[2]);
+                    for (uint32 c = 0; c < 4; c++)
+                    {
+                        polygon[num_polygon][c] = a[c] + (b[c] - a[c]) * t;
+                    }
+                    num_polygon++;
+                }
+            }
+
+            float s[4][3];
+            for (uint32 k = 0; k < num_polygon; k++)
+            {
+                to_screen(polygon[k], s[k]);
+            }
+
+            for (uint32 k = 2; k < num_polygon; k++)
+            {
+                RasterizeTriangle(s[0], s[k - 1], s[k]);
+            }
+        }
+
+        mHierarchyDirty = true;
+    }
+
+    void OcclusionBuffer::RasterizeTriangle(const float* v0, const float* v1, const float* v2)
+    {
+        float area = (v1[0] - v0[0]) * (v2[1] - v0[1]) - (v1[1] - v0[1]) * (v2[0] - v0[0]);
+        if (area == 0 || std::isnan(area))
+        {
+            return;
+        }
+
+        // both faces are rasterized, flip the winding so that all edge functions are positive inside
+        if (area < 0)
+        {
+            std::swap(v1, v2);
+            area = -area;
+        }
+
+        float min_x = std::min({ v0[0], v1[0], v2[0] });
+        float max_x = std::max({ v0[0], v1[0], v2[0] });
+        float min_y = std::min({ v0[1], v1[1], v2[1] });
+        float max_y = std::max({ v0[1], v1[1], v2[1] });
+        if (max_x < 0 || max_y < 0 || min_x >= Width || min_y >= Height)
+        {
+            return;
+        }
+
+        // pixels are processed 8 at a time, so the first column is aligned down to 8
+        int begin_x = std::max(0, static_cast<int>(min_x)) & ~7;
+        int end_x = std::min(static_cast<int>(Width), static_cast<int>(max_x) + 1);
+        int begin_y = std::max(0, static_cast<int>(min_y));
+        int end_y = std::min(static_cast<int>(Height), static_cast<int>(max_y) + 1);
+
+        // edge function of edge ab: (a.y - b.y) * x + (b.x - a.x) * y + (a.x * b.y - a.y * b.x)
+        // e0 is the edge opposite to v0, so e0 / area is the barycentric weight of v0, same for e1 and e2
+        const float* edge_begin[3] = { v1, v2, v0 };
+        const float* edge_end[3] = { v2, v0, v1 };
+        float a[3], b[3], c[3];
+        for (uint32 i = 0; i < 3; i++)
+        {
+            a[i] = edge_begin[i][1] - edge_end[i][1];
+            b[i] = edge_end[i][0] - edge_begin[i][0];
+            c[i] = edge_begin[i][0] * edge_end[i][1] - edge_begin[i][1] * edge_end[i][0];
+        }
+
+        // depth is linear in screen space, z = za * x + zb * y + zc
+        float inv_area = 1.0f / area;
+        float za = (v0[2] * a[0] + v1[2] * a[1] + v2[2] * a[2]) * inv_area;
+        float zb = (v0[2] * b[0] + v1[2] * b[1] + v2[2] * b[2]) * inv_area;
+        float zc = (v0[2] * c[0] + v1[2] * c[1] + v2[2] * c[2]) * inv_area;
+
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 lane_offset = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+        const __m256 a0 = _mm256_set1_ps(a[0]), a1 = _mm256_set1_ps(a[1]), a2 = _mm256_set1_ps(a[2]);
+        const __m256 za8 = _mm256_set1_ps(za);
+
+        float* depth = mMips[0].data();
+        for (int y = begin_y; y < end_y; y++)
+        {
+            float pixel_y = y + 0.5f;
+            __m256 row0 = _mm256_set1_ps(b[0] * pixel_y + c[0]);
+            __m256 row1 = _mm256_set1_ps(b[1] * pixel_y + c[1]);
+            __m256 row2 = _mm256_set1_ps(b[2] * pixel_y + c[2]);
+            __m256 row_z = _mm256_set1_ps(zb * pixel_y + zc);
+
+            float* row = depth + y * Width;
+            for (int x = begin_x; x < end_x; x += 8)
+            {
+                __m256 pixel_x = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(x)), lane_offset);
+
+                // pixel centers on an edge are inside, so that there is no crack between adjacent triangles
+                __m256 e0 = _mm256_add_ps(_mm256_mul_ps(a0, pixel_x), row0);
+                __m256 e1 = _mm256_add_ps(_mm256_mul_ps(a1, pixel_x), row1);
+                __m256 e2 = _mm256_add_ps(_mm256_mul_ps(a2, pixel_x), row2);
+                __m256 inside = _mm256_and_ps(
+                    _mm256_cmp_ps(e0, zero, _CMP_GE_OQ),
+                    _mm256_and_ps(_mm256_cmp_ps(e1, zero, _CMP_GE_OQ), _mm256_cmp_ps(e2, zero, _CMP_GE_OQ))
+                );
+                if (_mm256_movemask_ps(inside) == 0)
+                {
+                    continue;
+                }
+
+                __m256 z = _mm256_add_ps(_mm256_mul_ps(za8, pixel_x), row_z);
+                __m256 old_z = _mm256_loadu_ps(row + x);
+                _mm256_storeu_ps(row + x, _mm256_blendv_ps(old_z, _mm256_min_ps(old_z, z), inside));
+            }
+        }
+    }
+
+    void OcclusionBuffer::BuildHierarchy()
+    {
+        for (uint32 mip = 1; mip < NumMips; mip++)
+        {
+            const float* src = mMips[mip - 1].data();
+            float* dst = mMips[mip].data();
+            uint32 src_width = MipWidth(mip - 1);
+            uint32 dst_width = MipWidth(mip);
+
+            for (uint32 y = 0; y < MipHeight(mip); y++)
+            {
+                const float* top = src + (y * 2) * src_width;
+                const float* bottom = top + src_width;
+                float* out = dst + y * dst_width;
+
+                uint32 x = 0;
+                // 8 source texels to 4 destination texels at a time
+                for (; x + 4 <= dst_width; x += 4)
+                {
+                    __m128 lo = _mm_max_ps(_mm_loadu_ps(top + x * 2), _mm_loadu_ps(bottom + x * 2));
+                    __m128 hi = _mm_max_ps(_mm_loadu_ps(top + x * 2 + 4), _mm_loadu_ps(bottom + x * 2 + 4));
+                    __m128 even = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0));
+                    __m128 odd = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1));
+                    _mm_storeu_ps(out + x, _mm_max_ps(even, odd));
+                }
+
+                for (; x < dst_width; x++)
+                {
+                    out[x] = std::max(std::max(top[x * 2], top[x * 2 + 1]), std::max(bottom[x * 2], bottom[x * 2 + 1]));
+                }
+            }
+        }
+
+        mHierarchyDirty = false;
+    }
+
+    bool OcclusionBuffer::IsOccluded(const AABB& bound) const
+    {
+        ASSERT(!mHierarchyDirty);
+
+        float min_x = std::numeric_limits<float>::max(), max_x = -std::numeric_limits<float>::max();
+        float min_y = std::numeric_limits<float>::max(), max_y = -std::numeric_limits<float>::max();
+        float min_z = std::numeric_limits<float>::max();
+        for (uint32 i = 0; i < 8; i++)
+        {
+            float p[3] = {
+                i & 1 ? bound.Max.x : bound.Min.x,
+                i & 2 ? bound.Max.y : bound.Min.y,
+                i & 4 ? bound.Max.z : bound.Min.z,
+            };
+
+            float clip[4];
+            for (uint32 r = 0; r < 4; r++)
+            {
+                clip[r] = mViewProjection.At(r, 0) * p[0] + mViewProjection.At(r, 1) * p[1] + mViewProjection.At(r, 2) * p[2] + mViewProjection.At(r, 3);
+            }
+
+            // the camera may be inside of the bound
+            if (clip[2] < 0 || clip[3] <= 0)
+            {
+                return false;
+            }
+
+            float inv_w = 1.0f / clip[3];
+            min_x = std::min(min_x, clip[0] * inv_w);
+            max_x = std::max(max_x, clip[0] * inv_w);
+            min_y = std::min(min_y, clip[1] * inv_w);
+            max_y = std::max(max_y, clip[1] * inv_w);
+            min_z = std::min(min_z, clip[2] * inv_w);
+        }
+
+        // screen space rectangle, y is flipped
+        float left = (min_x * 0.5f + 0.5f) * Width;
+        float right = (max_x * 0.5f + 0.5f) * Width;
+        float top = (0.5f - max_y * 0.5f) * Height;
+        float bottom = (0.5f - min_y * 0.5f) * Height;
+        if (right < 0 || bottom < 0 || left >= Width || top >= Height)
+        {
+            return false;
+        }
+
+        int x0 = std::max(0, static_cast<int>(left));
+        int x1 = std::min(static_cast<int>(Width) - 1, static_cast<int>(right));
+        int y0 = std::max(0, static_cast<int>(top));
+        int y1 = std::min(static_cast<int>(Height) - 1, static_cast<int>(bottom));
+
+        // pick the finest mip where the rectangle covers at most 2x2 texels
+        uint32 mip = 0;
+        while (mip + 1 < NumMips && ((x1 >> mip) - (x0 >> mip) > 1 || (y1 >> mip) - (y0 >> mip) > 1))
+        {
+            mip++;
+        }
+
+        for (int y = y0 >> mip; y <= (y1 >> mip); y++)
+        {
+            for (int x = x0 >> mip; x <= (x1 >> mip); x++)
+            {
+                if (min_z <= GetDepth(x, y, mip))
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+}
@@ -1,6 +1,12 @@
 #include "Utils/SH.h"
+#include "Utils/Thread.h"
 #include "Resource/BasicStorage.h"
 
+#include <immintrin.h>
+#include <cmath>
+#include <functional>
+#include <vector>
+
 namespace MRenderer
 {
     float SHBaker::SHBasisFunction(int n, Vector3 dir)
@@ -84,52 +90,257 @@ namespace MRenderer
         }
     }
 
+    // a face spans direction = Major + s * U + t * V for s, t in [-1, 1], the same as @CalcCubeMapDirection
+    struct CubeMapFaceAxes
+    {
+        float Major[3];
+        float U[3];
+        float V[3];
+    };
+
+    static constexpr CubeMapFaceAxes FaceAxes[NumCubeMapFaces] =
+    {
+        { { 1, 0, 0 }, { 0, 0, -1 }, { 0, -1, 0 } },
+        { { -1, 0, 0 }, { 0, 0, 1 }, { 0, -1, 0 } },
+        { { 0, 1, 0 }, { 1, 0, 0 }, { 0, 0, 1 } },
+        { { 0, -1, 0 }, { 1, 0, 0 }, { 0, 0, -1 } },
+        { { 0, 0, 1 }, { 1, 0, 0 }, { 0, -1, 0 } },
+        { { 0, 0, -1 }, { -1, 0, 0 }, { 0, -1, 0 } },
+    };
+
+    // the rgb of the radiance times the polynomials of the basis functions without their coefficients, see @SHBasisFunction
+    static constexpr uint32 NumProjectionSums = 3 * SH2Coefficients::CoefficientsCount;
+
+    // the rows of the faces in floats, and the positions and solid angles of the texels of a row, shared by the 6 faces
+    struct ProjectionRow
+    {
+        std::vector<float> Colors;
+        std::vector<float> S;
+        std::vector<float> InvLength;
+        std::vector<float> SolidAngles;
+        std::vector<float> Corners;
+    };
+
+    static thread_local ProjectionRow tProjectionRow;
+
+    // the solid angle of the rectangle from the center of a face to (@x, @y) on the plane at 1 from the center of the cube
+    // ref: https://www.rorydriscoll.com/2012/01/15/cubemap-texel-solid-angle/
+    static float AreaElement(float x, float y)
+    {
+        return atan2(x * y, sqrt(x * x + y * y + 1));
+    }
+
+    // the rgb of a row of a face, one channel after another
+    static void LoadFaceRow(const TextureData& face, uint32 y, float* out_colors)
+    {
+        uint32 width = face.Width();
+        float* red = out_colors;
+        float* green = out_colors + width;
+        float* blue = out_colors + width * 2;
+
+        if (face.Format() == ETextureFormat_R16G16B16A16_FLOAT)
+        {
+            const uint16* pixels = static_cast<const uint16*>(face.Data()) + y * width * 4;
+            for (uint32 x = 0; x < width; x++)
+            {
+                red[x] = HalfToFloat(pixels[x * 4]);
+                green[x] = HalfToFloat(pixels[x * 4 + 1]);
+                blue[x] = HalfToFloat(pixels[x * 4 + 2]);
+            }
+            return;
+        }
+
+        const float* pixels = static_cast<const float*>(face.Data()) + y * width * 4;
+        for (uint32 x = 0; x < width; x++)
+        {
+            red[x] = pixels[x * 4];
+            green[x] = pixels[x * 4 + 1];
+            blue[x] = pixels[x * 4 + 2];
+        }
+    }
+
+    // the sums of row @y of the 6 faces, the texels of the row have the same positions and solid angles on every face
+    static void ProjectRow(const std::array<TextureData, 6>& cube_map, uint32 y, ProjectionRow& row, double* out_sums)
+    {
+        uint32 width = cube_map[0].Width();
+        float rows = cube_map[0].Height();
+        float t = (2 * y + 1) / rows - 1;
+        float t0 = 2 * y / rows - 1;
+        float t1 = 2 * (y + 1) / rows - 1;
+
+        // the solid angle of a texel from the 4 corners of it
+        float* top = row.Corners.data();
+        float* bottom = top + width + 1;
+        for (uint32 x = 0; x <= width; x++)
+        {
+            float s = 2.0f * x / width - 1;
+            top[x] = AreaElement(s, t0);
+            bottom[x] = AreaElement(s, t1);
+        }
+
+        for (uint32 x = 0; x < width; x++)
+        {
+            float s = (2.0f * x + 1) / width - 1;
+            row.S[x] = s;
+            row.InvLength[x] = 1.0f / sqrt(s * s + t * t + 1);
+            row.SolidAngles[x] = top[x] - bottom[x] - top[x + 1] + bottom[x + 1];
+        }
+
+        float sums[NumProjectionSums] = {};
+        for (uint32 face = 0; face < NumCubeMapFaces; face++)
+        {
+            LoadFaceRow(cube_map[face], y, row.Colors.data());
+            const float* colors[3] = { row.Colors.data(), row.Colors.data() + width, row.Colors.data() + width * 2 };
+
+            // the direction of a texel is (@center + s * U) / length
+            const CubeMapFaceAxes& axes = FaceAxes[face];
+            float center[3];
+            for (uint32 i = 0; i < 3; i++)
+            {
+                center[i] = axes.Major[i] + t * axes.V[i];
+            }
+
+            uint32 x = 0;
+#if defined(__AVX__)
+            __m256 lane_sums[NumProjectionSums];
+            for (__m256& lane_sum : lane_sums)
+            {
+                lane_sum = _mm256_setzero_ps();
+            }
+
+            for (; x + 8 <= width; x += 8)
+            {
+                __m256 s = _mm256_loadu_ps(row.S.data() + x);
+                __m256 inv_length = _mm256_loadu_ps(row.InvLength.data() + x);
+                __m256 solid_angle = _mm256_loadu_ps(row.SolidAngles.data() + x);
+
+                __m256 dir[3];
+                for (uint32 i = 0; i < 3; i++)
+                {
+                    dir[i] = _mm256_mul_ps(_mm256_add_ps(_mm256_set1_ps(center[i]), _mm256_mul_ps(s, _mm256_set1_ps(axes.U[i]))), inv_length);
+                }
+
+                __m256 zz = _mm256_mul_ps(dir[2], dir[2]);
+                __m256 polynomials[SH2Coefficients::CoefficientsCount] =
+                {
+                    _mm256_set1_ps(1.0f),
+                    dir[1],
+                    dir[2],
+                    dir[0],
+                    _mm256_mul_ps(dir[0], dir[1]),
+                    _mm256_mul_ps(dir[1], dir[2]),
+                    _mm256_sub_ps(_mm256_add_ps(zz, _mm256_add_ps(zz, zz)), _mm256_set1_ps(1.0f)),
+                    _mm256_mul_ps(dir[0], dir[2]),
+                    _mm256_sub_ps(_mm256_mul_ps(dir[0], dir[0]), _mm256_mul_ps(dir[1], dir[1])),
+                };
+
+                for (uint32 c = 0; c < 3; c++)
+                {
+                    __m256 radiance = _mm256_mul_ps(_mm256_loadu_ps(colors[c] + x), solid_angle);
+                    for (uint32 n = 0; n < SH2Coefficients::CoefficientsCount; n++)
+                    {
+                        __m256& lane_sum = lane_sums[c * SH2Coefficients::CoefficientsCount + n];
+                        lane_sum = _mm256_add_ps(lane_sum, _mm256_mul_ps(radiance, polynomials[n]));
+                    }
+                }
+            }
+
+            for (uint32 i = 0; i < NumProjectionSums; i++)
+            {
+                alignas(32) float lanes[8];
+                _mm256_store_ps(lanes, lane_sums[i]);
+                sums[i] += ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) + ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+            }
+#endif
+            for (; x < width; x++)
+            {
+                float dir[3];
+                for (uint32 i = 0; i < 3; i++)
+                {
+                    dir[i] = (center[i] + row.S[x] * axes.U[i]) * row.InvLength[x];
+                }
+
+                float polynomials[SH2Coefficients::CoefficientsCount] =
+                {
+                    1.0f,
+                    dir[1],
+                    dir[2],
+                    dir[0],
+                    dir[0] * dir[1],
+                    dir[1] * dir[2],
+                    3 * dir[2] * dir[2] - 1,
+                    dir[0] * dir[2],
+                    dir[0] * dir[0] - dir[1] * dir[1],
+                };
+
+                for (uint32 c = 0; c < 3; c++)
+                {
+                    float radiance = colors[c][x] * row.SolidAngles[x];
+                    for (uint32 n = 0; n < SH2Coefficients::CoefficientsCount; n++)
+                    {
+                        sums[c * SH2Coefficients::CoefficientsCount + n] += radiance * polynomials[n];
+                    }
+                }
+            }
+        }
+
+        for (uint32 i = 0; i < NumProjectionSums; i++)
+        {
+            out_sums[i] = sums[i];
+        }
+    }
+
     void SHBaker::ProjectEnvironmentMap(const std::array<TextureData, 6>& cube_map, SH2Coefficients& out_sh_r, SH2Coefficients& out_sh_g, SH2Coefficients& out_sh_b)
     {
         out_sh_r = out_sh_g = out_sh_b = {};
         SH2Coefficients* coeffs[3] = { &out_sh_r, &out_sh_g, &out_sh_b };
 
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::uniform_real_distribution<float> rng(0.0F, 1.0F);
-
-        // project RGB channels to SH basis functions
-        const uint32 ChannelCount = 3;
-        for (uint32 channel_index = 0; channel_index < ChannelCount; channel_index++)
+        uint32 width = cube_map[0].Width();
+        uint32 height = cube_map[0].Height();
+        for (const TextureData& face : cube_map)
         {
-            SH2Coefficients& c = *coeffs[channel_index];
-
-            // calculate radiance SH coefficients
-            // we need to solve the integral of f(w) * Y(n) for each SH basis function
-            // we will use Monte Carlo integration and uniform PDF as importance sampling method to approximate this integral
-            for (uint32 i = 0; i < SampleCount; i++)
+            ASSERT(face.Width() == width && face.Height() == height && face.Format() == cube_map[0].Format());
+        }
+        ASSERT(cube_map[0].Format() == ETextureFormat_R32G32B32A32_FLOAT || cube_map[0].Format() == ETextureFormat_R16G16B16A16_FLOAT);
+
+        // calculate radiance SH coefficients
+        // we need to solve the integral of f(w) * Y(n) for each SH basis function, which is the sum of the texels times Y(n) of their centers
+        // weighted by their solid angles. the rows are summed in order after the jobs, so the result doesn't depend on how they ran
+        std::vector<double> row_sums(static_cast<size_t>(height) * NumProjectionSums);
+        TaskScheduler& scheduler = TaskScheduler::Instance();
+        scheduler.Wait(scheduler.ParallelFor(height, RowsPerJob,
+            [&](uint32 begin, uint32 end)
             {
-                // uniform sample on the unit sphere
-                // PDF(theta) = 0.5 * sin(theta)
-                // PDF(phi) = 1 / 2PI
-                // we will use inverse sampling method on these two PDF to generate uniformly distributed samples
-                // ref: http://www.bogotobogo.com/Algorithms/uniform_distribution_sphere.php
-                float phi = 2 * PI * rng(gen);
-                float theta = acosf(1 - 2 * rng(gen));
-                Vector3 dir = FromSphericalCoordinate(theta, phi);
-
-                // assume cube map is HDRI format, so we don't need gamma correction here
-                Vector4 color = CubeMapTextureData::Sample(cube_map, theta, phi);
-
-                for (uint32 co_index = 0; co_index < SH2Coefficients::CoefficientsCount; co_index++)
+                ProjectionRow& row = tProjectionRow;
+                row.Colors.resize(width * 3);
+                row.S.resize(width);
+                row.InvLength.resize(width);
+                row.SolidAngles.resize(width);
+                row.Corners.resize((width + 1) * 2);
+
+                for (uint32 y = begin; y < end; y++)
                 {
-                    float basis = SHBasisFunction(co_index, dir);
-                    c.Data[co_index] += color[channel_index] * basis;
+                    ProjectRow(cube_map, y, row, row_sums.data() + y * NumProjectionSums);
                 }
+            }
+        ));
 
+        double sums[NumProjectionSums] = {};
+        for (uint32 y = 0; y < height; y++)
+        {
+            for (uint32 i = 0; i < NumProjectionSums; i++)
+            {
+                sums[i] += row_sums[y * NumProjectionSums + i];
             }
+        }
 
-            // uniform distribution on unit sphere means there is a same probablity density for every solid angle,
-            // which is PDF(w) = 1 / total solid angle = 1 / (4 * PI)
-            // since it's a constant, we can apply 1 / PDF(w) to the integral result to get the final value
+        const uint32 ChannelCount = 3;
+        for (uint32 channel_index = 0; channel_index < ChannelCount; channel_index++)
+        {
+            SH2Coefficients& c = *coeffs[channel_index];
             for (uint32 co_index = 0; co_index < SH2Coefficients::CoefficientsCount; co_index++)
             {
-                c.Data[co_index] *= 4 * PI / SampleCount;
+                c.Data[co_index] = static_cast<float>(sums[channel_index * SH2Coefficients::CoefficientsCount + co_index]) * SHBasisFunctionCoefficient(co_index);
             }
 
             // calculate irradiance SH coefficients * basis function coefficients
@@ -152,7 +363,8 @@ namespace MRenderer
         }
     }
 
-    std::array<TextureData, 6> SHBaker::GenerateIrradianceMap(const std::array<TextureData, 6>& cube_map, uint32 map_size, bool debug)
+    // the texels of the faces are the irradiance of the directions of their centers, the rows are filled on the workers
+    static std::array<TextureData, 6> FillIrradianceMap(uint32 map_size, const std::function<Vector3(const Vector3&)>& irradiance)
     {
         const ETextureFormat format = ETextureFormat_R32G32B32A32_FLOAT;
         std::array<TextureData, 6> irradiance_map =
@@ -165,38 +377,46 @@ namespace MRenderer
             TextureData(map_size, map_size, 1, format),
         };
 
-        SH2Coefficients shr, shg, shb;
-        ProjectEnvironmentMap(cube_map, shr, shg, shb);
-
-        SH2CoefficientsPack pack = PackCubeMapSHCoefficient(shr, shg, shb);
-
-        for (uint32 i = 0; i < 6; i++) 
-        {
-            for (uint32 x = 0; x < map_size; x++)
+        TaskScheduler& scheduler = TaskScheduler::Instance();
+        scheduler.Wait(scheduler.ParallelFor(NumCubeMapFaces * map_size, SHBaker::RowsPerJob,
+            [&](uint32 begin, uint32 end)
             {
-                for (uint32 y = 0; y < map_size; y++)
+                for (uint32 row = begin; row < end; row++)
                 {
-                    float u = static_cast<float>(x) / static_cast<float>(map_size);
-                    float v = static_cast<float>(y) / static_cast<float>(map_size);
-
-                    Vector3 dir = CalcCubeMapDirection(i, u, v);
-                    Vector3 irradiance;
-                    if (debug)
+                    uint32 face = row / map_size;
+                    uint32 y = row % map_size;
+                    float* pixels = static_cast<float*>(irradiance_map[face].mData.GetData()) + y * map_size * 4;
+                    for (uint32 x = 0; x < map_size; x++)
                     {
-                        irradiance = CalcIrradiance2(shr, shg, shb, dir);
+                        float u = (2.0f * x + 1) / map_size - 1;
+                        float v = (2.0f * y + 1) / map_size - 1;
+                        Vector3 color = irradiance(CalcCubeMapDirection(face, u, v));
+
+                        pixels[x * 4] = color.x;
+                        pixels[x * 4 + 1] = color.y;
+                        pixels[x * 4 + 2] = color.z;
+                        pixels[x * 4 + 3] = 1.0f;
                     }
-                    else 
-                    {
-                        irradiance = CalcIrradiance(pack, dir);
-                    }
-
-                    irradiance_map[i].SetPixel(x, y, Vector4(irradiance, 1));
                 }
             }
-        }
+        ));
         return irradiance_map;
     }
 
+    std::array<TextureData, 6> SHBaker::GenerateIrradianceMap(const std::array<TextureData, 6>& cube_map, uint32 map_size, bool debug)
+    {
+        SH2Coefficients shr, shg, shb;
+        ProjectEnvironmentMap(cube_map, shr, shg, shb);
+
+        if (debug)
+        {
+            return FillIrradianceMap(map_size, [&](const Vector3& dir) { return CalcIrradiance2(shr, shg, shb, dir); });
+        }
+
+        SH2CoefficientsPack pack = PackCubeMapSHCoefficient(shr, shg, shb);
+        return FillIrradianceMap(map_size, [&](const Vector3& dir) { return CalcIrradiance(pack, dir); });
+    }
+
     // ref: https://zhuanlan.zhihu.com/p/144910975 Eq.4
     SH2CoefficientsPack SHBaker::PackCubeMapSHCoefficient(SH2Coefficients r, SH2Coefficients g, SH2Coefficients b)
     {
@@ -7,7 +7,7 @@ namespace MRenderer
         while (!owner->mClosed)
         {
             std::unique_lock guard(owner->mMutexTask);
-            while (owner->mTasks.empty())
+            while (owner->mTasks.Empty())
             {
                 owner->mEventNewTask.wait(guard);
 
@@ -17,14 +17,28 @@ namespace MRenderer
                 }
             }
 
-            auto task = owner->mTasks.front();
-            owner->mTasks.pop();
+            Task task = owner->mTasks.Pop();
             guard.unlock();
 
             task();
         }
     }
 
+    void TaskQueue::Push(Task&& task)
+    {
+        ASSERT(!mClosed);
+
+        while (!mMutexTask.try_lock())
+            std::this_thread::yield();// spin lock, for avoid blocking the caller thread
+
+        mTasks.Push(std::move(task));
+
+        mMutexTask.unlock();
+
+        // notify a worker to execute task
+        mEventNewTask.notify_one();
+    }
+
     ThreadPool::ThreadPool(size_t num_thread)
     {
         mThreads.resize(num_thread);
@@ -38,7 +52,7 @@ namespace MRenderer
     {
         std::unique_lock guard(mMutexTask);
 
-        std::queue<Task>().swap(mTasks);
+        mTasks.Clear();
         mClosed = true;
 
         guard.unlock();
@@ -65,7 +79,7 @@ namespace MRenderer
     {
         std::unique_lock guard(mMutexTask);
 
-        std::queue<Task>().swap(mTasks);
+        mTasks.Clear();
         mClosed = true;
 
         guard.unlock();
@@ -75,8 +89,343 @@ namespace MRenderer
         mThread.join();
     }
 
+    // the job system and the worker index of current thread
+    static thread_local JobSystem* tJobSystem = nullptr;
+    static thread_local uint32 tWorkerIndex = 0;
+
+    // cheap per-thread random number for choosing the steal victim
+    static uint32 XorShift()
+    {
+        static thread_local uint32 state = static_cast<uint32>(std::hash<std::thread::id>()(std::this_thread::get_id())) | 1;
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    JobSystem::JobSystem(uint32 num_workers)
+    {
+        num_workers = std::max(num_workers, 1u);
+
+        mQueues.resize(num_workers);
+        for (uint32 i = 0; i < num_workers; i++)
+        {
+            mQueues[i] = std::make_unique<JobQueue>();
+        }
+
+        // workers may start stealing from each other immediately, so create all the queues before launching them
+        mWorkers.resize(num_workers);
+        for (uint32 i = 0; i < num_workers; i++)
+        {
+            mWorkers[i] = std::thread(&JobSystem::WorkerMain, this, i);
+        }
+    }
+
+    JobSystem::~JobSystem()
+    {
+        {
+            std::lock_guard guard(mMutexSleep);
+            mClosed = true;
+        }
+        mEventNewJob.notify_all();
+
+        for (auto& worker : mWorkers)
+        {
+            if (worker.joinable())
+            {
+                worker.join();
+            }
+        }
+
+        // discard the jobs that never got a chance to run
+        while (!mInjectionQueue.empty())
+        {
+            JobPool::Delete(mInjectionQueue.front());
+            mInjectionQueue.pop();
+        }
+
+        for (auto& queue : mQueues)
+        {
+            while (Job* job = queue->Pop())
+            {
+                JobPool::Delete(job);
+            }
+        }
+    }
+
+    JobHandle JobSystem::Schedule(Task func, std::span<const JobHandle> dependencies)
+    {
+        auto counter = std::make_shared<JobCounter>(1);
+        Job* job = JobPool::New(std::move(func), counter, 1);
+
+        for (const JobHandle& dependency : dependencies)
+        {
+            AddDependency(job, dependency);
+        }
+        ReleaseDependency(job);
+
+        return JobHandle(std::move(counter));
+    }
+
+    void JobSystem::Dispatch(Task func)
+    {
+        Submit(JobPool::New(std::move(func), nullptr, 1));
+    }
+
+    void JobSystem::Wait(const JobHandle& handle)
+    {
+        while (!handle.IsComplete())
+        {
+            Job* job = FindJob();
+            if (job)
+            {
+                Execute(job);
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    uint32 JobSystem::ThreadIndex() const
+    {
+        return tJobSystem == this ? tWorkerIndex : NumWorkers();
+    }
+
+    void JobSystem::WorkerMain(uint32 index)
+    {
+        tJobSystem = this;
+        tWorkerIndex = index;
+
+        uint32 spin = 0;
+        while (!mClosed)
+        {
+            Job* job = FindJob();
+            if (job)
+            {
+                Execute(job);
+                spin = 0;
+                continue;
+            }
+
+            if (++spin < SpinCountBeforeSleep)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+
+            // nothing to do for a while, go to sleep until new job arrives
+            std::unique_lock guard(mMutexSleep);
+            mNumSleeping++;
+            mEventNewJob.wait(guard, [this]() { return mClosed || mNumPendingJobs.load() > 0; });
+            mNumSleeping--;
+            spin = 0;
+        }
+    }
+
+    void JobSystem::Submit(Job* job)
+    {
+        mNumPendingJobs++;
+
+        // push into the local deque if current thread is one of our workers, it's the fast path
+        bool pushed = tJobSystem == this && mQueues[tWorkerIndex]->Push(job);
+        if (!pushed)
+        {
+            std::lock_guard guard(mMutexInjection);
+            mInjectionQueue.push(job);
+        }
+
+        if (mNumSleeping.load() > 0)
+        {
+            // acquire the lock so the notification can't slip in between the predicate check and the wait of a worker
+            { std::lock_guard guard(mMutexSleep); }
+            mEventNewJob.notify_one();
+        }
+    }
+
+    Job* JobSystem::FindJob()
+    {
+        Job* job = nullptr;
+
+        // 1. local deque
+        if (tJobSystem == this)
+        {
+            job = mQueues[tWorkerIndex]->Pop();
+        }
+
+        // 2. jobs from external threads
+        if (!job && mNumPendingJobs.load(std::memory_order_relaxed) > 0)
+        {
+            std::lock_guard guard(mMutexInjection);
+            if (!mInjectionQueue.empty())
+            {
+                job = mInjectionQueue.front();
+                mInjectionQueue.pop();
+            }
+        }
+
+        // 3. steal from a random victim, then the others in order
+        if (!job)
+        {
+            uint32 num_queues = static_cast<uint32>(mQueues.size());
+            uint32 victim = XorShift() % num_queues;
+            for (uint32 i = 0; i < num_queues && !job; i++)
+            {
+                uint32 index = (victim + i) % num_queues;
+                if (tJobSystem != this || index != tWorkerIndex)
+                {
+                    job = mQueues[index]->Steal();
+                }
+            }
+        }
+
+        if (job)
+        {
+            mNumPendingJobs--;
+        }
+        return job;
+    }
+
+    void JobSystem::Execute(Job* job)
+    {
+        job->Func();
+
+        std::shared_ptr<JobCounter> counter = std::move(job->Counter);
+        JobPool::Delete(job);
+
+        if (counter && counter->mPending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            // the last job of this counter, release the jobs waiting on it
+            std::vector<Job*> continuations;
+            {
+                std::lock_guard guard(counter->mMutexContinuation);
+                continuations.swap(counter->mContinuations);
+            }
+
+            for (Job* continuation : continuations)
+            {
+                ReleaseDependency(continuation);
+            }
+        }
+    }
+
+    void JobSystem::AddDependency(Job* job, const JobHandle& dependency)
+    {
+        if (dependency.Empty())
+        {
+            return;
+        }
+
+        JobCounter* counter = dependency.mCounter.get();
+        std::lock_guard guard(counter->mMutexContinuation);
+
+        // check completion under the lock, otherwise the continuation list may have been consumed already
+        if (!counter->IsComplete())
+        {
+            job->Dependencies++;
+            counter->mContinuations.push_back(job);
+        }
+    }
+
+    void JobSystem::ReleaseDependency(Job* job)
+    {
+        if (job->Dependencies.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            Submit(job);
+        }
+    }
+
     TaskScheduler::TaskScheduler()
-        :mWorkerThreads(std::thread::hardware_concurrency())
+        :mJobSystem(std::thread::hardware_concurrency())
     {
     }
+
+    void ParallelRadixSort(std::vector<uint64>& items, uint32 bit_begin, uint32 bit_end)
+    {
+        constexpr uint32 RadixBits = 8;
+        constexpr uint32 NumBuckets = 1 << RadixBits;
+        constexpr uint32 MinItemsPerJob = 16384;
+
+        ASSERT(bit_begin < bit_end && bit_end <= 64);
+
+        uint32 size = static_cast<uint32>(items.size());
+        if (size <= 1)
+        {
+            return;
+        }
+
+        TaskScheduler& scheduler = TaskScheduler::Instance();
+        uint32 num_jobs = std::clamp(size / MinItemsPerJob, 1u, scheduler.GetJobSystem().NumWorkers() + 1);
+        uint32 chunk_size = (size + num_jobs - 1) / num_jobs;
+
+        std::vector<uint64> scratch(size);
+        std::vector<std::array<uint32, NumBuckets>> offsets(num_jobs);
+
+        for (uint32 shift = bit_begin; shift < bit_end; shift += RadixBits)
+        {
+            // the last pass may have less bits
+            uint64 digit_mask = (1ull << std::min(RadixBits, bit_end - shift)) - 1;
+
+            // 1. histogram of each chunk
+            JobHandle histogram = scheduler.ParallelFor(num_jobs, 1,
+                [&](uint32 begin, uint32 end)
+                {
+                    for (uint32 job = begin; job < end; job++)
+                    {
+                        std::array<uint32, NumBuckets>& counts = offsets[job];
+                        counts.fill(0);
+
+                        uint32 chunk_end = std::min(size, (job + 1) * chunk_size);
+                        for (uint32 i = job * chunk_size; i < chunk_end; i++)
+                        {
+                            counts[(items[i] >> shift) & digit_mask]++;
+                        }
+                    }
+                }
+            );
+            scheduler.Wait(histogram);
+
+            // 2. exclusive prefix sum in bucket-major order, so that items of earlier chunks stay in front, i.e. stable
+            uint32 sum = 0;
+            bool single_bucket = false;
+            for (uint32 bucket = 0; bucket < NumBuckets; bucket++)
+            {
+                uint32 bucket_begin = sum;
+                for (uint32 job = 0; job < num_jobs; job++)
+                {
+                    uint32 count = offsets[job][bucket];
+                    offsets[job][bucket] = sum;
+                    sum += count;
+                }
+                single_bucket |= sum - bucket_begin == size;
+            }
+
+            // all the items have the same digit, nothing to do in this pass
+            if (single_bucket)
+            {
+                continue;
+            }
+
+            // 3. scatter each chunk to its slots
+            JobHandle scatter = scheduler.ParallelFor(num_jobs, 1,
+                [&](uint32 begin, uint32 end)
+                {
+                    for (uint32 job = begin; job < end; job++)
+                    {
+                        std::array<uint32, NumBuckets>& slots = offsets[job];
+
+                        uint32 chunk_end = std::min(size, (job + 1) * chunk_size);
+                        for (uint32 i = job * chunk_size; i < chunk_end; i++)
+                        {
+                            scratch[slots[(items[i] >> shift) & digit_mask]++] = items[i];
+                        }
+                    }
+                }
+            );
+            scheduler.Wait(scatter);
+
+            items.swap(scratch);
+        }
+    }
 }
\ No newline at end of file
@@ -0,0 +1,231 @@
+#include "Utils/Transform.h"
+#include "Utils/Thread.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <immintrin.h>
+
+namespace MRenderer
+{
+    TransformHandle TransformStore::Allocate(void* owner)
+    {
+        TransformHandle handle;
+        if (!mFreeHandles.empty())
+        {
+            handle = mFreeHandles.back();
+            mFreeHandles.pop_back();
+        }
+        else
+        {
+            handle = Capacity();
+            for (auto* array : { &mTranslationX, &mTranslationY, &mTranslationZ, &mRotationX, &mRotationY, &mRotationZ, &mScaleX, &mScaleY, &mScaleZ })
+            {
+                array->emplace_back();
+            }
+            mWorld.emplace_back();
+            mInverseWorld.emplace_back();
+            mOwners.emplace_back();
+
+            if (handle / 64 >= mDirtyBits.size())
+            {
+                mDirtyBits.push_back(0);
+            }
+        }
+
+        mTranslationX[handle] = mTranslationY[handle] = mTranslationZ[handle] = 0;
+        mRotationX[handle] = mRotationY[handle] = mRotationZ[handle] = 0;
+        mScaleX[handle] = mScaleY[handle] = mScaleZ[handle] = 1;
+        mWorld[handle] = Matrix4x4::Identity();
+        mInverseWorld[handle] = Matrix4x4::Identity();
+        mOwners[handle] = owner;
+        return handle;
+    }
+
+    void TransformStore::Free(TransformHandle handle)
+    {
+        ASSERT(handle < Capacity());
+
+        mDirtyBits[handle / 64] &= ~(1ull << (handle % 64));
+        mOwners[handle] = nullptr;
+        mFreeHandles.push_back(handle);
+    }
+
+    void TransformStore::SetTranslation(TransformHandle handle, const Vector3& translation)
+    {
+        ASSERT(handle < Capacity());
+
+        mTranslationX[handle] = translation.x;
+        mTranslationY[handle] = translation.y;
+        mTranslationZ[handle] = translation.z;
+        MarkDirty(handle);
+    }
+
+    void TransformStore::SetRotation(TransformHandle handle, const Vector3& rotation)
+    {
+        ASSERT(handle < Capacity());
+
+        mRotationX[handle] = rotation.x;
+        mRotationY[handle] = rotation.y;
+        mRotationZ[handle] = rotation.z;
+        MarkDirty(handle);
+    }
+
+    void TransformStore::SetScale(TransformHandle handle, const Vector3& scale)
+    {
+        ASSERT(handle < Capacity());
+
+        mScaleX[handle] = scale.x;
+        mScaleY[handle] = scale.y;
+        mScaleZ[handle] = scale.z;
+        MarkDirty(handle);
+    }
+
+    void TransformStore::SetWorldMatrix(TransformHandle handle, const Matrix4x4& matrix)
+    {
+        Vector3 scale = matrix.GetScale();
+        Matrix3x3 rotation = matrix.GetRotation();
+
+        // inverse of @Matrix3x3::FromEulerAngle
+        Vector3 euler_angle = {
+            std::atan2(rotation.At(1, 0), rotation.At(0, 0)),
+            std::asin(std::clamp(-rotation.At(2, 0), -1.0f, 1.0f)),
+            std::atan2(rotation.At(2, 1), rotation.At(2, 2)),
+        };
+
+        SetTranslation(handle, matrix.GetTranslation());
+        SetRotation(handle, euler_angle);
+        SetScale(handle, scale);
+    }
+
+    void TransformStore::MarkDirty(TransformHandle handle)
+    {
+        mDirtyBits[handle / 64] |= 1ull << (handle % 64);
+    }
+
+    const std::vector<TransformHandle>& TransformStore::Update()
+    {
+        mUpdated.clear();
+        for (uint32 word = 0; word < mDirtyBits.size(); word++)
+        {
+            uint64 bits = mDirtyBits[word];
+            while (bits)
+            {
+                mUpdated.push_back(word * 64 + std::countr_zero(bits));
+                bits &= bits - 1;
+            }
+            mDirtyBits[word] = 0;
+        }
+
+        uint32 count = static_cast<uint32>(mUpdated.size());
+        if (count < MinParallelUpdate)
+        {
+            UpdateRange(0, count);
+        }
+        else
+        {
+            TaskScheduler& scheduler = TaskScheduler::Instance();
+            JobHandle job = scheduler.ParallelFor(count, UpdateBatchSize,
+                [this](uint32 begin, uint32 end)
+                {
+                    UpdateRange(begin, end);
+                }
+            );
+            scheduler.Wait(job);
+        }
+
+        return mUpdated;
+    }
+
+    void TransformStore::UpdateRange(uint32 begin, uint32 end)
+    {
+        constexpr uint32 Lanes = 8;
+
+        for (uint32 base = begin; base < end; base += Lanes)
+        {
+            uint32 num_lanes = std::min(Lanes, end - base);
+
+            // gather the components of 8 entries, the sine and cosine are scalar since there is no SIMD version of them
+            alignas(32) float sin_a[Lanes], cos_a[Lanes], sin_b[Lanes], cos_b[Lanes], sin_c[Lanes], cos_c[Lanes];
+            alignas(32) float tx[Lanes], ty[Lanes], tz[Lanes], sx[Lanes], sy[Lanes], sz[Lanes];
+            for (uint32 lane = 0; lane < Lanes; lane++)
+            {
+                // the unused lanes repeat the last entry
+                TransformHandle handle = mUpdated[base + std::min(lane, num_lanes - 1)];
+                sin_a[lane] = sin(mRotationX[handle]); cos_a[lane] = cos(mRotationX[handle]);
+                sin_b[lane] = sin(mRotationY[handle]); cos_b[lane] = cos(mRotationY[handle]);
+                sin_c[lane] = sin(mRotationZ[handle]); cos_c[lane] = cos(mRotationZ[handle]);
+                tx[lane] = mTranslationX[handle]; ty[lane] = mTranslationY[handle]; tz[lane] = mTranslationZ[handle];
+                sx[lane] = mScaleX[handle]; sy[lane] = mScaleY[handle]; sz[lane] = mScaleZ[handle];
+            }
+
+            __m256 sa = _mm256_load_ps(sin_a), ca = _mm256_load_ps(cos_a);
+            __m256 sb = _mm256_load_ps(sin_b), cb = _mm256_load_ps(cos_b);
+            __m256 sc = _mm256_load_ps(sin_c), cc = _mm256_load_ps(cos_c);
+
+            // rotation matrix of @Matrix3x3::FromEulerAngle
+            __m256 sb_sc = _mm256_mul_ps(sb, sc);
+            __m256 sb_cc = _mm256_mul_ps(sb, cc);
+            __m256 r[3][3] = {
+                {
+                    _mm256_mul_ps(ca, cb),
+                    _mm256_sub_ps(_mm256_mul_ps(ca, sb_sc), _mm256_mul_ps(sa, cc)),
+                    _mm256_add_ps(_mm256_mul_ps(ca, sb_cc), _mm256_mul_ps(sa, sc)),
+                },
+                {
+                    _mm256_mul_ps(sa, cb),
+                    _mm256_add_ps(_mm256_mul_ps(sa, sb_sc), _mm256_mul_ps(ca, cc)),
+                    _mm256_sub_ps(_mm256_mul_ps(sa, sb_cc), _mm256_mul_ps(ca, sc)),
+                },
+                {
+                    _mm256_sub_ps(_mm256_setzero_ps(), sb),
+                    _mm256_mul_ps(cb, sc),
+                    _mm256_mul_ps(cb, cc),
+                },
+            };
+
+            __m256 t[3] = { _mm256_load_ps(tx), _mm256_load_ps(ty), _mm256_load_ps(tz) };
+            __m256 s[3] = { _mm256_load_ps(sx), _mm256_load_ps(sy), _mm256_load_ps(sz) };
+            __m256 inv_s[3];
+            for (uint32 i = 0; i < 3; i++)
+            {
+                inv_s[i] = _mm256_div_ps(_mm256_set1_ps(1.0f), s[i]);
+            }
+
+            // world = [R * S | T], inverse world = [S^-1 * R^T | -S^-1 * R^T * T]
+            alignas(32) float world[3][4][Lanes];
+            alignas(32) float inverse_world[3][4][Lanes];
+            for (uint32 row = 0; row < 3; row++)
+            {
+                __m256 inv_t = _mm256_setzero_ps();
+                for (uint32 col = 0; col < 3; col++)
+                {
+                    _mm256_store_ps(world[row][col], _mm256_mul_ps(r[row][col], s[col]));
+
+                    __m256 inv = _mm256_mul_ps(r[col][row], inv_s[row]);
+                    _mm256_store_ps(inverse_world[row][col], inv);
+                    inv_t = _mm256_sub_ps(inv_t, _mm256_mul_ps(inv, t[col]));
+                }
+                _mm256_store_ps(world[row][3], t[row]);
+                _mm256_store_ps(inverse_world[row][3], inv_t);
+            }
+
+            for (uint32 lane = 0; lane < num_lanes; lane++)
+            {
+                TransformHandle handle = mUpdated[base + lane];
+                mWorld[handle] = Matrix4x4(
+                    world[0][0][lane], world[0][1][lane], world[0][2][lane], world[0][3][lane],
+                    world[1][0][lane], world[1][1][lane], world[1][2][lane], world[1][3][lane],
+                    world[2][0][lane], world[2][1][lane], world[2][2][lane], world[2][3][lane],
+                    0, 0, 0, 1
+                );
+                mInverseWorld[handle] = Matrix4x4(
+                    inverse_world[0][0][lane], inverse_world[0][1][lane], inverse_world[0][2][lane], inverse_world[0][3][lane],
+                    inverse_world[1][0][lane], inverse_world[1][1][lane], inverse_world[1][2][lane], inverse_world[1][3][lane],
+                    inverse_world[2][0][lane], inverse_world[2][1][lane], inverse_world[2][2][lane], inverse_world[2][3][lane],
+                    0, 0, 0, 1
+                );
+            }
+        }
+    }
+}
@@ -0,0 +1,175 @@
+#include "gtest/gtest.h"
+#include "Resource/AssetArchive.h"
+#include "Utils/LZCodec.h"
+#include "Utils/Misc.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <random>
+
+using namespace MRenderer;
+
+namespace
+{
+    std::vector<uint8> RoundTrip(const std::vector<uint8>& data)
+    {
+        std::vector<uint8> compressed = LZCodec::Compress(data.data(), static_cast<uint32>(data.size()));
+        EXPECT_LE(compressed.size(), LZCodec::CompressBound(static_cast<uint32>(data.size())));
+
+        std::vector<uint8> decompressed(data.size());
+        EXPECT_TRUE(LZCodec::Decompress(compressed.data(), static_cast<uint32>(compressed.size()), decompressed.data(), static_cast<uint32>(data.size())));
+        return decompressed;
+    }
+
+    void WriteBytes(const std::filesystem::path& path, const std::vector<uint8>& data)
+    {
+        std::filesystem::create_directories(path.parent_path());
+        std::ofstream file(path, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(data.data()), data.size());
+    }
+}
+
+TEST(AssetArchiveTest, LZCodecTest)
+{
+    std::mt19937 generator(17);
+    std::uniform_int_distribution<uint32> byte(0, 255);
+
+    std::vector<uint8> empty;
+    EXPECT_EQ(RoundTrip(empty), empty);
+
+    std::vector<uint8> tiny = { 1, 2, 3 };
+    EXPECT_EQ(RoundTrip(tiny), tiny);
+
+    // incompressible
+    std::vector<uint8> noise(100000);
+    for (uint8& value : noise)
+    {
+        value = static_cast<uint8>(byte(generator));
+    }
+    EXPECT_EQ(RoundTrip(noise), noise);
+
+    // runs shorter than the matches overlap the output, and the long lengths continue past the token
+    std::vector<uint8> runs;
+    for (uint32 i = 0; i < 2000; i++)
+    {
+        runs.insert(runs.end(), 1 + byte(generator) % 700, static_cast<uint8>(i % 3));
+        runs.push_back(static_cast<uint8>(byte(generator)));
+    }
+    std::vector<uint8> compressed_runs = LZCodec::Compress(runs.data(), static_cast<uint32>(runs.size()));
+    EXPECT_LT(compressed_runs.size(), runs.size() / 10);
+    EXPECT_EQ(RoundTrip(runs), runs);
+
+    // text with repeats further apart than the largest offset
+    std::string text;
+    while (text.size() < 300000)
+    {
+        text += "{ \"mTexturePath\": \"Asset/Model/Barrel\\\\Barrel_barrel_" + std::to_string(byte(generator)) + "_data\" },\n";
+    }
+    std::vector<uint8> json(text.begin(), text.end());
+    std::vector<uint8> compressed_json = LZCodec::Compress(json.data(), static_cast<uint32>(json.size()));
+    EXPECT_LT(compressed_json.size(), json.size() / 4);
+    EXPECT_EQ(RoundTrip(json), json);
+
+    // the wrong size and the corrupted data are rejected without writing past the output
+    std::vector<uint8> output(json.size() + 64, 0xCD);
+    EXPECT_FALSE(LZCodec::Decompress(compressed_json.data(), static_cast<uint32>(compressed_json.size()), output.data(), static_cast<uint32>(json.size() - 1)));
+    EXPECT_EQ(output[json.size() - 1], 0xCD);
+    EXPECT_FALSE(LZCodec::Decompress(compressed_json.data(), static_cast<uint32>(compressed_json.size()), output.data(), static_cast<uint32>(json.size() + 1)));
+    EXPECT_FALSE(LZCodec::Decompress(compressed_json.data(), static_cast<uint32>(compressed_json.size() / 2), output.data(), static_cast<uint32>(json.size())));
+
+    std::vector<uint8> bad_offset = { 0x10, 'a', 0x05, 0x00 };
+    EXPECT_FALSE(LZCodec::Decompress(bad_offset.data(), static_cast<uint32>(bad_offset.size()), output.data(), 5));
+
+    for (uint32 i = 0; i < 200; i++)
+    {
+        std::vector<uint8> garbage = compressed_runs;
+        garbage[byte(generator) % garbage.size()] ^= static_cast<uint8>(1 + byte(generator) % 255);
+        LZCodec::Decompress(garbage.data(), static_cast<uint32>(garbage.size()), output.data(), static_cast<uint32>(json.size()));
+        EXPECT_EQ(output[json.size()], 0xCD);
+    }
+}
+
+TEST(AssetArchiveTest, PackTest)
+{
+    namespace fs = std::filesystem;
+
+    // the names are relative to the working directory
+    fs::path folder = fs::current_path() / "MRendererArchiveTest";
+    fs::path archive_path = folder / "Test.pak";
+    fs::remove_all(folder);
+
+    std::mt19937 generator(19);
+    std::uniform_int_distribution<uint32> byte(0, 255);
+
+    std::vector<std::pair<std::string, std::vector<uint8>>> files;
+    for (uint32 i = 0; i < 50; i++)
+    {
+        // every third is noise that is left stored
+        std::vector<uint8> data(byte(generator) * 37);
+        for (uint32 j = 0; j < data.size(); j++)
+        {
+            data[j] = static_cast<uint8>(i % 3 == 0 ? byte(generator) : j / 64);
+        }
+
+        std::string name = "MRendererArchiveTest/Model_" + std::to_string(i % 4) + "/Mesh_" + std::to_string(i) + "_data.bin";
+        WriteBytes(fs::current_path() / name, data);
+        files.emplace_back(name, std::move(data));
+    }
+    WriteBytes(folder / "Empty.json", {});
+
+    // the scripts next to the assets aren't resources
+    WriteBytes(folder / "Model_0" / "Convert.py", std::vector<uint8>(100, 1));
+
+    // packed twice, so the archive inside the folder must be skipped
+    ArchivePackStats stats{};
+    ASSERT_TRUE(AssetArchive::Pack(folder.string(), archive_path.string(), false, nullptr));
+    ASSERT_TRUE(AssetArchive::Pack(folder.string(), archive_path.string(), true, &stats));
+    EXPECT_EQ(stats.NumEntries, files.size() + 1);
+    EXPECT_GT(stats.NumCompressed, 0u);
+    EXPECT_LT(stats.NumCompressed, files.size());
+
+    std::shared_ptr<AssetArchive> archive = AssetArchive::Open(archive_path.string());
+    ASSERT_TRUE(archive);
+    EXPECT_EQ(archive->NumEntries(), files.size() + 1);
+
+    uint32 num_compressed = 0;
+    for (const auto& [name, data] : files)
+    {
+        // the repo paths come with either separator
+        std::string repo_path = name;
+        std::replace(repo_path.begin(), repo_path.end(), '/', '\\');
+        const AssetArchive::Entry* entry = archive->Find(repo_path);
+        ASSERT_NE(entry, nullptr) << name;
+        EXPECT_EQ(entry->RawSize, data.size());
+        EXPECT_EQ(entry->Offset % AssetArchive::EntryAlignment, 0u);
+
+        std::vector<uint8> storage;
+        const uint8* read = archive->Read(*entry, storage);
+        ASSERT_NE(read, nullptr);
+        EXPECT_EQ(memcmp(read, data.data(), data.size()), 0) << name;
+
+        if (entry->Codec == EArchiveCodec_None)
+        {
+            EXPECT_EQ(read, archive->File()->Data() + entry->Offset);
+        }
+        num_compressed += entry->Codec == EArchiveCodec_LZ;
+    }
+    EXPECT_EQ(num_compressed, stats.NumCompressed);
+
+    const AssetArchive::Entry* empty = archive->Find("./MRendererArchiveTest/Model_0/../Empty.json");
+    ASSERT_NE(empty, nullptr);
+    EXPECT_EQ(empty->RawSize, 0u);
+
+    EXPECT_EQ(archive->Find("MRendererArchiveTest/Test.pak"), nullptr);
+    EXPECT_EQ(archive->Find("MRendererArchiveTest/Model_0/Convert.py"), nullptr);
+    EXPECT_EQ(archive->Find("MRendererArchiveTest/Model_0/Mesh_1_data.bin"), nullptr);
+    EXPECT_EQ(archive->Find("Asset/Model/Barrel/Barrel_Mesh.json"), nullptr);
+
+    archive.reset();
+    fs::remove_all(folder);
+
+    // not an archive
+    WriteBytes(archive_path, std::vector<uint8>(100, 7));
+    EXPECT_FALSE(AssetArchive::Open(archive_path.string()));
+    fs::remove_all(folder);
+}
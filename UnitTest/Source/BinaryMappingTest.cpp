@@ -0,0 +1,252 @@
+#include "gtest/gtest.h"
+#include "Resource/BasicStorage.h"
+#include "Utils/Serialization.h"
+#include <cstring>
+#include <filesystem>
+#include <numeric>
+
+using namespace MRenderer;
+
+namespace
+{
+    std::string TempFilePath(std::string_view name)
+    {
+        return (std::filesystem::temp_directory_path() / name).string();
+    }
+
+    MeshData CreateMesh()
+    {
+        std::vector<StandardVertex> vertices(1000);
+        for (uint32 i = 0; i < vertices.size(); i++)
+        {
+            vertices[i].Position = Vector3(static_cast<float>(i), 1, 2);
+        }
+
+        std::vector<uint32> indices(3000);
+        std::iota(indices.begin(), indices.end(), 0);
+        for (uint32& index : indices)
+        {
+            index %= 1000;
+        }
+
+        BinaryData vertex_data(vertices.data(), static_cast<uint32>(vertices.size() * sizeof(StandardVertex)));
+        BinaryData index_data(indices.data(), static_cast<uint32>(indices.size() * sizeof(uint32)));
+        return MeshData(StandardVertexFormat, std::move(vertex_data), std::move(index_data), { SubMeshData::Whole(3000) }, AABB(Vector3(0, 1, 2), Vector3(999, 1, 2)));
+    }
+
+    bool SameData(const BinaryData& lhs, const BinaryData& rhs)
+    {
+        return lhs.GetSize() == rhs.GetSize() && memcmp(lhs.GetData(), rhs.GetData(), lhs.GetSize()) == 0;
+    }
+}
+
+TEST(BinaryMappingTest, MappedMeshTest)
+{
+    std::string path = TempFilePath("MRendererMappedMesh.bin");
+    MeshData mesh = CreateMesh();
+    {
+        BinarySerializer serializer;
+        serializer.LoadObject(mesh);
+        ASSERT_TRUE(serializer.DumpFile(path));
+    }
+
+    MeshData mapped;
+    {
+        BinarySerializer serializer;
+        ASSERT_TRUE(serializer.LoadFile(path));
+        EXPECT_EQ(serializer.Version(), BinaryFileHeader::CurrentVersion);
+        serializer.DumpObject(mapped);
+        EXPECT_EQ(serializer.Size(), 0u);
+    }
+
+    // the views keep the file mapped after the serializer is gone, and are aligned for the upload
+    ASSERT_TRUE(mapped.Vertices().IsView());
+    ASSERT_TRUE(mapped.Indicies().IsView());
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(mapped.Vertices().GetData()) % BinaryData::PayloadAlignment, 0u);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(mapped.Indicies().GetData()) % BinaryData::PayloadAlignment, 0u);
+    EXPECT_TRUE(SameData(mapped.Vertices(), mesh.Vertices()));
+    EXPECT_TRUE(SameData(mapped.Indicies(), mesh.Indicies()));
+    EXPECT_EQ(mapped.GetSubMeshs().size(), 1u);
+    EXPECT_EQ(mapped.Bound().Max.x, 999.0f);
+
+    // the copied load reads the same thing into owned memory
+    MeshData copied;
+    {
+        BinarySerializer serializer;
+        ASSERT_TRUE(serializer.LoadFile(path, false));
+        serializer.DumpObject(copied);
+        EXPECT_EQ(serializer.Size(), 0u);
+    }
+    EXPECT_FALSE(copied.Vertices().IsView());
+    EXPECT_TRUE(SameData(copied.Vertices(), mesh.Vertices()));
+    EXPECT_TRUE(SameData(copied.Indicies(), mesh.Indicies()));
+
+    // the mapping is copy on write, writing through a view leaves the file as it is
+    static_cast<uint8*>(const_cast<void*>(mapped.Vertices().GetData()))[0] ^= 0xFF;
+
+    MeshData reloaded;
+    {
+        BinarySerializer serializer;
+        ASSERT_TRUE(serializer.LoadFile(path));
+        serializer.DumpObject(reloaded);
+    }
+    EXPECT_TRUE(SameData(reloaded.Vertices(), mesh.Vertices()));
+    EXPECT_FALSE(SameData(mapped.Vertices(), mesh.Vertices()));
+
+    // the views move along with the mapping
+    MeshData moved = std::move(reloaded);
+    reloaded = MeshData();
+    EXPECT_TRUE(moved.Indicies().IsView());
+    EXPECT_TRUE(SameData(moved.Indicies(), mesh.Indicies()));
+
+    std::filesystem::remove(path);
+}
+
+TEST(BinaryMappingTest, LegacyFileTest)
+{
+    // the binary files dumped before have no header and the payload directly follows its size
+    std::string path = TempFilePath("MRendererLegacyBinary.bin");
+    std::vector<uint8> payload(777);
+    std::iota(payload.begin(), payload.end(), 0);
+    {
+        RingBuffer rb;
+        rb.Write(static_cast<uint32>(payload.size()));
+        rb.Write(payload.data(), static_cast<uint32>(payload.size()));
+
+        std::vector<uint8> data = rb.Dump();
+        std::ofstream file(path, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(data.data()), data.size());
+    }
+
+    for (bool memory_mapped : { true, false })
+    {
+        BinarySerializer serializer;
+        ASSERT_TRUE(serializer.LoadFile(path, memory_mapped));
+        EXPECT_EQ(serializer.Version(), 0u);
+
+        BinaryData data;
+        serializer.DumpObject(data);
+        EXPECT_EQ(serializer.Size(), 0u);
+        EXPECT_EQ(data.IsView(), memory_mapped);
+        ASSERT_EQ(data.GetSize(), payload.size());
+        EXPECT_EQ(memcmp(data.GetData(), payload.data(), payload.size()), 0);
+    }
+
+    std::filesystem::remove(path);
+}
+
+TEST(BinaryMappingTest, PayloadAlignmentTest)
+{
+    // the padding depends on what is written before the payload
+    for (uint32 offset = 0; offset < BinaryData::PayloadAlignment + 3; offset++)
+    {
+        std::vector<uint8> prefix(offset, 0xAB);
+        std::vector<uint8> payload(offset * 5 + 1, static_cast<uint8>(offset));
+
+        RingBuffer rb;
+        rb.Write(prefix.data(), offset);
+        BinaryData::WritePayload(rb, payload.data(), static_cast<uint32>(payload.size()));
+
+        std::vector<uint8> data = rb.Dump();
+        rb.Attach(data.data(), static_cast<uint32>(data.size()));
+        rb.Read(offset);
+
+        uint32 size;
+        const uint8* read = BinaryData::ReadPayload(rb, size);
+        EXPECT_EQ((read - data.data()) % BinaryData::PayloadAlignment, 0) << offset;
+        ASSERT_EQ(size, payload.size());
+        EXPECT_EQ(memcmp(read, payload.data(), size), 0);
+        EXPECT_EQ(rb.Occupied(), 0u);
+
+        // not mapped, so it's copied
+        rb.Attach(data.data(), static_cast<uint32>(data.size()));
+        rb.Read(offset);
+        BinaryData copied;
+        BinaryData::BinaryDeserialize(rb, copied);
+        EXPECT_FALSE(copied.IsView());
+        EXPECT_EQ(memcmp(copied.GetData(), payload.data(), size), 0);
+    }
+}
+
+TEST(BinaryMappingTest, CompressedPayloadTest)
+{
+    // a few blocks, the last one partial, and a noise block that is stored as is
+    std::vector<uint8> payload(BinaryData::CompressionBlockSize * 3 + 1234);
+    for (uint32 i = 0; i < payload.size(); i++)
+    {
+        payload[i] = static_cast<uint8>(i / 16);
+    }
+    uint32 state = 1;
+    for (uint32 i = BinaryData::CompressionBlockSize; i < 2 * BinaryData::CompressionBlockSize; i++)
+    {
+        state = state * 1664525u + 1013904223u;
+        payload[i] = static_cast<uint8>(state >> 24);
+    }
+
+    for (uint32 size : { 0u, 100u, BinaryData::CompressionBlockSize, static_cast<uint32>(payload.size()) })
+    {
+        RingBuffer rb;
+        BinaryData::WriteCompressedPayload(rb, payload.data(), size);
+        EXPECT_LT(rb.Occupied(), size / 2 + BinaryData::CompressionBlockSize + 64) << size;
+
+        for (bool parallel : { false, true })
+        {
+            std::vector<uint8> data = rb.Dump();
+            RingBuffer read;
+            read.Attach(data.data(), static_cast<uint32>(data.size()));
+            BinaryData decoded = BinaryData::ReadCompressedPayload(read, parallel);
+            EXPECT_EQ(read.Occupied(), 0u);
+            ASSERT_EQ(decoded.GetSize(), size);
+            EXPECT_TRUE(size == 0 || memcmp(decoded.GetData(), payload.data(), size) == 0) << size;
+        }
+    }
+
+    // a corrupted block fails the whole payload instead of handing back partial data, the rest of the buffer is still consumed
+    {
+        RingBuffer rb;
+        BinaryData::WriteCompressedPayload(rb, payload.data(), BinaryData::CompressionBlockSize);
+        std::vector<uint8> data = rb.Dump();
+        const uint32 header_size = 3 * sizeof(uint32);
+        memset(data.data() + header_size, 0, data.size() - header_size);
+
+        uint32 num_corrupted = BinaryData::NumCorruptedPayloads();
+        RingBuffer read;
+        read.Attach(data.data(), static_cast<uint32>(data.size()));
+        BinaryData decoded = BinaryData::ReadCompressedPayload(read);
+        EXPECT_EQ(read.Occupied(), 0u);
+        EXPECT_EQ(decoded.GetSize(), 0u);
+        EXPECT_EQ(BinaryData::NumCorruptedPayloads(), num_corrupted + 1);
+    }
+
+    // the compressed mesh is decoded into owned memory even when it's mapped
+    std::string path = TempFilePath("MRendererCompressedMesh.bin");
+    MeshData mesh = CreateMesh();
+    {
+        BinaryData::CompressionScope compression(true);
+        BinarySerializer serializer;
+        serializer.LoadObject(mesh);
+        ASSERT_TRUE(serializer.DumpFile(path));
+    }
+
+    // the scope is over, this one isn't compressed
+    RingBuffer raw;
+    BinaryData::BinarySerialize(raw, mesh.Vertices());
+    EXPECT_TRUE(raw.Read<uint32>() & BinaryData::AlignedPayloadFlag);
+
+    for (bool memory_mapped : { true, false })
+    {
+        BinarySerializer serializer;
+        ASSERT_TRUE(serializer.LoadFile(path, memory_mapped));
+        EXPECT_EQ(serializer.Version(), BinaryFileHeader::CurrentVersion);
+
+        MeshData loaded;
+        serializer.DumpObject(loaded);
+        EXPECT_EQ(serializer.Size(), 0u);
+        EXPECT_FALSE(loaded.Vertices().IsView());
+        EXPECT_TRUE(SameData(loaded.Vertices(), mesh.Vertices()));
+        EXPECT_TRUE(SameData(loaded.Indicies(), mesh.Indicies()));
+    }
+    EXPECT_LT(std::filesystem::file_size(path), mesh.Vertices().GetSize() / 2);
+
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,566 @@
+#include "gtest/gtest.h"
+#include "Resource/BlockCompression.h"
+#include "Utils/MathLib.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <random>
+
+using namespace MRenderer;
+
+namespace
+{
+    // smooth gradients, noise, and hard edged rectangles, the alpha has its own gradient and edges
+    std::vector<uint8> GenerateImage(uint32 width, uint32 height, bool opaque)
+    {
+        std::mt19937 rng(7);
+        std::uniform_int_distribution<int> noise(-6, 6);
+
+        std::vector<uint8> pixels(width * height * 4);
+        for (uint32 y = 0; y < height; y++)
+        {
+            for (uint32 x = 0; x < width; x++)
+            {
+                bool edge = ((x / 24) + (y / 40)) % 5 == 0;
+                int r = static_cast<int>(128 + 100 * std::sin(x * 0.05) * std::cos(y * 0.03));
+                int g = static_cast<int>(x * 255 / width);
+                int b = edge ? 230 - r / 4 : static_cast<int>(y * 255 / height);
+                int a = opaque ? 255 : (edge ? 40 : static_cast<int>((x + y) * 255 / (width + height)));
+
+                uint8* pixel = pixels.data() + (y * width + x) * 4;
+                pixel[0] = static_cast<uint8>(std::clamp(r + noise(rng), 0, 255));
+                pixel[1] = static_cast<uint8>(std::clamp(g + noise(rng), 0, 255));
+                pixel[2] = static_cast<uint8>(std::clamp(b + noise(rng), 0, 255));
+                pixel[3] = static_cast<uint8>(a);
+            }
+        }
+        return pixels;
+    }
+
+    uint32 ComparedChannels(EBlockFormat format)
+    {
+        switch (format)
+        {
+        case EBlockFormat_BC1:
+            return 3;
+        case EBlockFormat_BC5:
+            return 2;
+        default:
+            return 4;
+        }
+    }
+
+    // a sky of rgba half, dim toward the horizon with a sun thousands of times brighter, and some noise
+    std::vector<uint16> GenerateHDRImage(uint32 width, uint32 height, uint32 seed)
+    {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> noise(0.95f, 1.05f);
+
+        std::vector<uint16> pixels(width * height * 4);
+        for (uint32 y = 0; y < height; y++)
+        {
+            for (uint32 x = 0; x < width; x++)
+            {
+                float u = (x + 0.5f) / width;
+                float v = (y + 0.5f) / height;
+                float distance = std::sqrt((u - 0.7f) * (u - 0.7f) + (v - 0.3f) * (v - 0.3f));
+                float sun = distance < 0.05f ? 4000.0f : 2.0f / (distance * 40.0f + 0.1f);
+                float color[3] = { 0.2f + 0.3f * v + sun, 0.4f + 0.4f * v + 0.9f * sun, 1.2f * (1.0f - v) + 0.7f * sun };
+
+                uint16* pixel = pixels.data() + (y * width + x) * 4;
+                for (uint32 c = 0; c < 3; c++)
+                {
+                    pixel[c] = FloatToHalf(color[c] * noise(rng));
+                }
+                pixel[3] = FloatToHalf(1.0f);
+            }
+        }
+        return pixels;
+    }
+
+    // the root mean square of the error relative to each channel, which is what the eye sees of an hdr image
+    double RelativeRMSE(const uint16* a, const uint16* b, uint32 num_pixels)
+    {
+        double sum = 0.0;
+        for (uint32 p = 0; p < num_pixels; p++)
+        {
+            for (uint32 c = 0; c < 3; c++)
+            {
+                double expected = HalfToFloat(a[p * 4 + c]);
+                double error = (HalfToFloat(b[p * 4 + c]) - expected) / (std::abs(expected) + 1e-3);
+                sum += error * error;
+            }
+        }
+        return std::sqrt(sum / (num_pixels * 3.0));
+    }
+
+    // a BC6H mode as the bit layout table of the reference lists it, the fields from the lowest bit of the block after the code. r0 and r1
+    // are the ends of the first region, r2 and r3 the ones of the second, [10:15] are reversed bits
+    // ref: https://learn.microsoft.com/en-us/windows/win32/direct3d11/bc6h-format
+    struct BC6HReferenceMode
+    {
+        uint32 Code;
+        uint32 CodeBits;
+        bool Transformed;
+        const char* Layout;
+    };
+
+    const BC6HReferenceMode BC6HReferenceModes[14] =
+    {
+        { 0x00, 2, true, "g2[4], b2[4], b3[4], r0[9:0], g0[9:0], b0[9:0], r1[4:0], g3[4], g2[3:0], g1[4:0], b3[0], g3[3:0], b1[4:0], b3[1], "
+            "b2[3:0], r2[4:0], b3[2], r3[4:0], b3[3]" },
+        { 0x01, 2, true, "g2[5], g3[4], g3[5], r0[6:0], b3[0], b3[1], b2[4], g0[6:0], b2[5], b3[2], g2[4], b0[6:0], b3[3], b3[5], b3[4], "
+            "r1[5:0], g2[3:0], g1[5:0], g3[3:0], b1[5:0], b2[3:0], r2[5:0], r3[5:0]" },
+        { 0x02, 5, true, "r0[9:0], g0[9:0], b0[9:0], r1[4:0], r0[10], g2[3:0], g1[3:0], g0[10], b3[0], g3[3:0], b1[3:0], b0[10], b3[1], "
+            "b2[3:0], r2[4:0], b3[2], r3[4:0], b3[3]" },
+        { 0x06, 5, true, "r0[9:0], g0[9:0], b0[9:0], r1[3:0], r0[10], g3[4], g2[3:0], g1[4:0], g0[10], g3[3:0], b1[3:0], b0[10], b3[1], "
+            "b2[3:0], r2[3:0], b3[0], b3[2], r3[3:0], g2[4], b3[3]" },
+        { 0x0A, 5, true, "r0[9:0], g0[9:0], b0[9:0], r1[3:0], r0[10], b2[4], g2[3:0], g1[3:0], g0[10], b3[0], g3[3:0], b1[4:0], b0[10], "
+            "b2[3:0], r2[3:0], b3[1], b3[2], r3[3:0], b3[4], b3[3]" },
+        { 0x0E, 5, true, "r0[8:0], b2[4], g0[8:0], g2[4], b0[8:0], b3[4], r1[4:0], g3[4], g2[3:0], g1[4:0], b3[0], g3[3:0], b1[4:0], b3[1], "
+            "b2[3:0], r2[4:0], b3[2], r3[4:0], b3[3]" },
+        { 0x12, 5, true, "r0[7:0], g3[4], b2[4], g0[7:0], b3[2], g2[4], b0[7:0], b3[3], b3[4], r1[5:0], g2[3:0], g1[4:0], b3[0], g3[3:0], "
+            "b1[4:0], b3[1], b2[3:0], r2[5:0], r3[5:0]" },
+        { 0x16, 5, true, "r0[7:0], b3[0], b2[4], g0[7:0], g2[5], g2[4], b0[7:0], g3[5], b3[4], r1[4:0], g3[4], g2[3:0], g1[5:0], g3[3:0], "
+            "b1[4:0], b3[1], b2[3:0], r2[4:0], b3[2], r3[4:0], b3[3]" },
+        { 0x1A, 5, true, "r0[7:0], b3[1], b2[4], g0[7:0], b2[5], g2[4], b0[7:0], b3[5], b3[4], r1[4:0], g3[4], g2[3:0], g1[4:0], b3[0], "
+            "g3[3:0], b1[5:0], b2[3:0], r2[4:0], b3[2], r3[4:0], b3[3]" },
+        { 0x1E, 5, false, "r0[5:0], g3[4], b3[0], b3[1], b2[4], g0[5:0], g2[5], b2[5], b3[2], g2[4], b0[5:0], g3[5], b3[3], b3[5], b3[4], "
+            "r1[5:0], g2[3:0], g1[5:0], g3[3:0], b1[5:0], b2[3:0], r2[5:0], r3[5:0]" },
+        { 0x03, 5, false, "r0[9:0], g0[9:0], b0[9:0], r1[9:0], g1[9:0], b1[9:0]" },
+        { 0x07, 5, true, "r0[9:0], g0[9:0], b0[9:0], r1[8:0], r0[10], g1[8:0], g0[10], b1[8:0], b0[10]" },
+        { 0x0B, 5, true, "r0[9:0], g0[9:0], b0[9:0], r1[7:0], r0[10:11], g1[7:0], g0[10:11], b1[7:0], b0[10:11]" },
+        { 0x0F, 5, true, "r0[9:0], g0[9:0], b0[9:0], r1[3:0], r0[10:15], g1[3:0], g0[10:15], b1[3:0], b0[10:15]" },
+    };
+
+    // the partitions of the two regions modes, the pixels of the second region, and the pixel of its index with one bit less
+    const uint16 BC6HReferencePartitions[32] =
+    {
+        0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80, 0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8, 0xFF00, 0xFFF0, 0xF000,
+        0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE, 0x088C, 0x3110, 0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C,
+    };
+    const uint32 BC6HReferenceAnchors[32] =
+    {
+        15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+        15, 2, 8, 2, 2, 8, 8, 15, 2, 8, 2, 2, 8, 8, 2, 2,
+    };
+
+    // call @func(endpoint, channel, bit) for each bit of the layout, in the order they are stored
+    template<typename Func>
+    void ForEachBC6HLayoutBit(const char* layout, Func&& func)
+    {
+        for (const char* token = layout; token; token = strchr(token, ','))
+        {
+            token += *token == ',' ? 2 : 0;
+
+            char channel;
+            uint32 endpoint, high, low;
+            if (sscanf(token, "%c%u[%u:%u]", &channel, &endpoint, &high, &low) == 3)
+            {
+                low = high;
+            }
+
+            uint32 c = channel == 'r' ? 0 : (channel == 'g' ? 1 : 2);
+            for (uint32 bit = low; ; bit = low < high ? bit + 1 : bit - 1)
+            {
+                func(endpoint, c, bit);
+                if (bit == high)
+                {
+                    break;
+                }
+            }
+        }
+    }
+
+    void EncodeBC6HReference(const BC6HReferenceMode& mode, const uint32 (*values)[3], uint32 partition, const uint32* indices, uint8* out_block)
+    {
+        memset(out_block, 0, 16);
+        uint32 position = 0;
+        auto write = [&](uint32 value, uint32 num_bits)
+            {
+                for (uint32 i = 0; i < num_bits; i++, position++)
+                {
+                    out_block[position / 8] |= ((value >> i) & 1) << (position % 8);
+                }
+            };
+
+        write(mode.Code, mode.CodeBits);
+        ForEachBC6HLayoutBit(mode.Layout, [&](uint32 endpoint, uint32 c, uint32 bit) { write(values[endpoint][c] >> bit, 1); });
+
+        bool two_regions = position == 77;
+        if (two_regions)
+        {
+            write(partition, 5);
+        }
+        for (uint32 p = 0; p < 16; p++)
+        {
+            bool anchor = p == 0 || (two_regions && p == BC6HReferenceAnchors[partition]);
+            write(indices[p], (two_regions ? 3 : 4) - (anchor ? 1 : 0));
+        }
+        EXPECT_EQ(position, 128u);
+    }
+
+    // the unsigned endpoint of @num_bits expanded to 16 bits
+    uint32 UnquantizeBC6HReference(uint32 value, uint32 num_bits)
+    {
+        if (num_bits >= 15)
+        {
+            return value;
+        }
+        else if (value == 0)
+        {
+            return 0;
+        }
+        else if (value == (1u << num_bits) - 1)
+        {
+            return 0xFFFF;
+        }
+        return ((value << 16) + 0x8000) >> num_bits;
+    }
+
+    double RoundTripPSNR(const std::vector<uint8>& pixels, uint32 width, uint32 height, EBlockFormat format, EBlockQuality quality)
+    {
+        std::vector<uint8> blocks = BlockCompression::Encode(pixels.data(), width, height, 1, format, quality);
+        EXPECT_EQ(blocks.size(), BlockCompression::EncodedSize(width, height, 1, format));
+
+        std::vector<uint8> decoded(pixels.size());
+        EXPECT_TRUE(BlockCompression::Decode(blocks.data(), width, height, 1, format, decoded.data()));
+        return BlockCompression::PSNR(pixels.data(), decoded.data(), width * height, ComparedChannels(format));
+    }
+}
+
+TEST(BlockCompressionTest, DecodeTest)
+{
+    // BC1, red and blue endpoints, every pixel takes the color a third of the way to blue
+    uint8 bc1[8] = { 0x00, 0xF8, 0x1F, 0x00, 0xAA, 0xAA, 0xAA, 0xAA };
+    uint8 pixels[64];
+    ASSERT_TRUE(BlockCompression::DecodeBlock(bc1, EBlockFormat_BC1, pixels));
+    EXPECT_EQ(pixels[0], 170);
+    EXPECT_EQ(pixels[1], 0);
+    EXPECT_EQ(pixels[2], 85);
+    EXPECT_EQ(pixels[3], 255);
+
+    // the greater endpoint last is the 3 colors mode, index 3 is transparent black
+    uint8 bc1_transparent[8] = { 0x1F, 0x00, 0x00, 0xF8, 0xFF, 0xFF, 0xFF, 0xFF };
+    ASSERT_TRUE(BlockCompression::DecodeBlock(bc1_transparent, EBlockFormat_BC1, pixels));
+    EXPECT_EQ(pixels[60], 0);
+    EXPECT_EQ(pixels[63], 0);
+
+    // BC7 mode 6 with both endpoints at 0x7F and p bits set, every channel is 255
+    uint8 bc7[16] = {};
+    bc7[0] = 0x40;
+    for (uint32 bit = 7; bit < 65; bit++)
+    {
+        bc7[bit / 8] |= 1 << (bit % 8);
+    }
+    ASSERT_TRUE(BlockCompression::DecodeBlock(bc7, EBlockFormat_BC7, pixels));
+    for (uint32 i = 0; i < 64; i++)
+    {
+        EXPECT_EQ(pixels[i], 255) << i;
+    }
+
+    // the three subsets modes aren't decoded
+    uint8 bc7_mode0[16] = { 0x01 };
+    EXPECT_FALSE(BlockCompression::DecodeBlock(bc7_mode0, EBlockFormat_BC7, pixels));
+}
+
+TEST(BlockCompressionTest, FlatTest)
+{
+    // a flat color that 565 represents, and whose channels are all even for the shared p bit of BC7, is exact in every format, also in
+    // the mips smaller than a block
+    constexpr uint32 Width = 12;
+    constexpr uint32 Height = 8;
+    constexpr uint32 MipLevels = 4;
+    const uint8 color[4] = { 132, 48, 0, 76 };
+
+    std::vector<uint8> pixels;
+    for (uint32 mip = 0; mip < MipLevels; mip++)
+    {
+        for (uint32 i = 0; i < std::max(Width >> mip, 1u) * std::max(Height >> mip, 1u); i++)
+        {
+            pixels.insert(pixels.end(), color, color + 4);
+        }
+    }
+    uint32 num_pixels = static_cast<uint32>(pixels.size() / 4);
+
+    for (EBlockFormat format : { EBlockFormat_BC1, EBlockFormat_BC3, EBlockFormat_BC5, EBlockFormat_BC7 })
+    {
+        for (uint32 quality = 0; quality < EBlockQuality_Count; quality++)
+        {
+            std::vector<uint8> blocks = BlockCompression::Encode(pixels.data(), Width, Height, MipLevels, format, static_cast<EBlockQuality>(quality));
+            ASSERT_EQ(blocks.size(), BlockCompression::EncodedSize(Width, Height, MipLevels, format));
+
+            // 3x2, 2x1, 1x1 and 1x1 blocks
+            EXPECT_EQ(blocks.size(), 10 * BlockCompression::BlockSize(format));
+
+            std::vector<uint8> decoded(pixels.size());
+            ASSERT_TRUE(BlockCompression::Decode(blocks.data(), Width, Height, MipLevels, format, decoded.data()));
+            EXPECT_TRUE(std::isinf(BlockCompression::PSNR(pixels.data(), decoded.data(), num_pixels, ComparedChannels(format))))
+                << GetBlockFormatName(format) << " " << GetBlockQualityName(static_cast<EBlockQuality>(quality));
+        }
+    }
+}
+
+TEST(BlockCompressionTest, PSNRTest)
+{
+    constexpr uint32 Width = 128;
+    constexpr uint32 Height = 128;
+
+    // the least psnr of each format at the fast quality, the slower ones must not do worse
+    struct Case
+    {
+        EBlockFormat Format;
+        bool Opaque;
+        double MinPSNR;
+    };
+    const Case cases[] =
+    {
+        { EBlockFormat_BC1, true, 36.0 },
+        { EBlockFormat_BC3, false, 37.0 },
+        { EBlockFormat_BC5, true, 49.0 },
+        { EBlockFormat_BC7, true, 39.0 },
+        { EBlockFormat_BC7, false, 39.0 },
+    };
+
+    for (const Case& test : cases)
+    {
+        std::vector<uint8> pixels = GenerateImage(Width, Height, test.Opaque);
+
+        double previous = 0.0;
+        for (uint32 quality = 0; quality < EBlockQuality_Count; quality++)
+        {
+            double psnr = RoundTripPSNR(pixels, Width, Height, test.Format, static_cast<EBlockQuality>(quality));
+            printf("%s %s %s: %.2f dB\n", GetBlockFormatName(test.Format).data(), test.Opaque ? "opaque" : "alpha",
+                GetBlockQualityName(static_cast<EBlockQuality>(quality)).data(), psnr);
+
+            EXPECT_GE(psnr, test.MinPSNR) << GetBlockFormatName(test.Format);
+            EXPECT_GE(psnr, previous - 0.01) << GetBlockFormatName(test.Format);
+            previous = psnr;
+        }
+    }
+
+    // a color above the diagonal and two below aren't on a line, but each side fits a subset of a BC7 partition
+    std::vector<uint8> split(16 * 4);
+    for (uint32 i = 0; i < 16; i++)
+    {
+        const uint8 colors[3][4] = { { 250, 20, 30, 255 }, { 10, 200, 90, 255 }, { 60, 120, 200, 255 } };
+        uint32 color = i % 4 > i / 4 ? 0 : 1 + i % 2;
+        memcpy(split.data() + i * 4, colors[color], 4);
+    }
+    EXPECT_GT(RoundTripPSNR(split, 4, 4, EBlockFormat_BC7, EBlockQuality_Normal), RoundTripPSNR(split, 4, 4, EBlockFormat_BC7, EBlockQuality_Fast) + 3.0);
+}
+
+TEST(BlockCompressionTest, ThroughputTest)
+{
+    constexpr uint32 Width = 256;
+    constexpr uint32 Height = 256;
+    std::vector<uint8> pixels = GenerateImage(Width, Height, false);
+
+    for (EBlockFormat format : { EBlockFormat_BC1, EBlockFormat_BC3, EBlockFormat_BC5, EBlockFormat_BC7 })
+    {
+        for (uint32 quality = 0; quality < EBlockQuality_Count; quality++)
+        {
+            auto begin = std::chrono::high_resolution_clock::now();
+            std::vector<uint8> blocks = BlockCompression::Encode(pixels.data(), Width, Height, 1, format, static_cast<EBlockQuality>(quality));
+            double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+
+            std::vector<uint8> decoded(pixels.size());
+            begin = std::chrono::high_resolution_clock::now();
+            BlockCompression::Decode(blocks.data(), Width, Height, 1, format, decoded.data());
+            double decode_seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+
+            double mpixels = Width * Height / 1e6;
+            printf("%s %s: encode %.2f Mpix/s, decode %.2f Mpix/s\n", GetBlockFormatName(format).data(), GetBlockQualityName(static_cast<EBlockQuality>(quality)).data(),
+                mpixels / seconds, mpixels / decode_seconds);
+            EXPECT_GT(mpixels / seconds, 0.0);
+        }
+    }
+}
+
+TEST(BlockCompressionTest, BC6HDecodeTest)
+{
+    // mode 11 with the endpoints at 0 and 1023, the first pixel takes the weight of index 7 and the others the last endpoint, which is the
+    // largest half
+    uint8 block[16] = {};
+    block[0] = 0x03;
+    for (uint32 bit = 35; bit < 128; bit++)
+    {
+        block[bit / 8] |= 1 << (bit % 8);
+    }
+
+    uint16 pixels[64];
+    ASSERT_TRUE(BlockCompression::DecodeBlock(block, EBlockFormat_BC6H, reinterpret_cast<uint8*>(pixels)));
+    for (uint32 c = 0; c < 3; c++)
+    {
+        EXPECT_EQ(pixels[c], 14880);
+        EXPECT_EQ(pixels[4 + c], 0x7BFF);
+    }
+    EXPECT_EQ(pixels[3], FloatToHalf(1.0f));
+
+    // the reserved modes are decoded as black
+    for (uint8 code : { 0x13, 0x17, 0x1B, 0x1F })
+    {
+        uint8 reserved[16] = {};
+        reserved[0] = code;
+        EXPECT_FALSE(BlockCompression::DecodeBlock(reserved, EBlockFormat_BC6H, reinterpret_cast<uint8*>(pixels)));
+        EXPECT_TRUE(std::all_of(pixels, pixels + 64, [](uint16 half) { return half == 0; }));
+    }
+}
+
+TEST(BlockCompressionTest, BC6HModesTest)
+{
+    // the blocks packed from the bit layout tables of the reference, with random endpoints, partitions and indices, decode to the halves of
+    // the reference decoding. the deltas of the transformed modes are signed, and their sums wrap around the bits of the first endpoint
+    constexpr uint32 NumBlocks = 256;
+    const uint8 weights3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+    const uint8 weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    std::mt19937 rng(11);
+    for (uint32 m = 0; m < 14; m++)
+    {
+        const BC6HReferenceMode& mode = BC6HReferenceModes[m];
+
+        uint32 widths[4][3] = {};
+        ForEachBC6HLayoutBit(mode.Layout, [&](uint32 endpoint, uint32 c, uint32 bit) { widths[endpoint][c] = std::max(widths[endpoint][c], bit + 1); });
+        bool two_regions = widths[2][0] > 0;
+        uint32 num_endpoints = two_regions ? 4 : 2;
+
+        for (uint32 b = 0; b < NumBlocks; b++)
+        {
+            // the first blocks take the smallest and largest values of the fields
+            uint32 values[4][3] = {};
+            uint32 endpoints[4][3] = {};
+            for (uint32 e = 0; e < num_endpoints; e++)
+            {
+                for (uint32 c = 0; c < 3; c++)
+                {
+                    uint32 mask = (1u << widths[e][c]) - 1;
+                    values[e][c] = b == 0 ? 0 : (b == 1 ? mask : rng() & mask);
+
+                    uint32 value = values[e][c];
+                    if (mode.Transformed && e > 0)
+                    {
+                        int32 delta = values[e][c] >= (1u << (widths[e][c] - 1)) ? static_cast<int32>(values[e][c]) - static_cast<int32>(mask + 1) : static_cast<int32>(values[e][c]);
+                        value = static_cast<uint32>(static_cast<int32>(values[0][c]) + delta) & ((1u << widths[0][c]) - 1);
+                    }
+                    endpoints[e][c] = UnquantizeBC6HReference(value, widths[0][c]);
+                }
+            }
+
+            uint32 partition = two_regions ? rng() % 32 : 0;
+            uint32 indices[16];
+            for (uint32 p = 0; p < 16; p++)
+            {
+                bool anchor = p == 0 || (two_regions && p == BC6HReferenceAnchors[partition]);
+                indices[p] = rng() % ((two_regions ? 8 : 16) >> (anchor ? 1 : 0));
+            }
+
+            uint8 block[16];
+            EncodeBC6HReference(mode, values, partition, indices, block);
+
+            uint16 pixels[64];
+            ASSERT_TRUE(BlockCompression::DecodeBlock(block, EBlockFormat_BC6H, reinterpret_cast<uint8*>(pixels))) << "mode " << m + 1;
+            for (uint32 p = 0; p < 16; p++)
+            {
+                uint32 region = two_regions ? (BC6HReferencePartitions[partition] >> p) & 1 : 0;
+                uint32 weight = two_regions ? weights3[indices[p]] : weights4[indices[p]];
+                for (uint32 c = 0; c < 3; c++)
+                {
+                    uint32 interpolated = (endpoints[region * 2][c] * (64 - weight) + endpoints[region * 2 + 1][c] * weight + 32) >> 6;
+                    ASSERT_EQ(pixels[p * 4 + c], (interpolated * 31) >> 6) << "mode " << m + 1 << " block " << b << " pixel " << p;
+                }
+                ASSERT_EQ(pixels[p * 4 + 3], FloatToHalf(1.0f));
+            }
+        }
+    }
+}
+
+TEST(BlockCompressionTest, BC6HFlatTest)
+{
+    // the halves 31 * code + 15 are the ones a 10 bits endpoint decodes to, so a flat color of them is exact, also in the mips smaller
+    // than a block. the negatives are clamped to 0 by the unsigned format
+    constexpr uint32 Width = 12;
+    constexpr uint32 Height = 8;
+    constexpr uint32 MipLevels = 4;
+    const uint16 color[4] = { 31 * 500 + 15, 31 * 300 + 15, 0x8000 | 0x3C00, 0x3C00 };
+    const uint16 expected[4] = { color[0], color[1], 0, 0x3C00 };
+
+    std::vector<uint16> pixels;
+    for (uint32 mip = 0; mip < MipLevels; mip++)
+    {
+        for (uint32 i = 0; i < std::max(Width >> mip, 1u) * std::max(Height >> mip, 1u); i++)
+        {
+            pixels.insert(pixels.end(), color, color + 4);
+        }
+    }
+
+    for (uint32 quality = 0; quality < EBlockQuality_Count; quality++)
+    {
+        std::vector<uint8> blocks = BlockCompression::Encode(reinterpret_cast<const uint8*>(pixels.data()), Width, Height, MipLevels, EBlockFormat_BC6H, static_cast<EBlockQuality>(quality));
+        ASSERT_EQ(blocks.size(), 10 * BlockCompression::BlockSize(EBlockFormat_BC6H));
+
+        std::vector<uint16> decoded(pixels.size());
+        ASSERT_TRUE(BlockCompression::Decode(blocks.data(), Width, Height, MipLevels, EBlockFormat_BC6H, reinterpret_cast<uint8*>(decoded.data())));
+        for (uint32 i = 0; i < decoded.size(); i++)
+        {
+            ASSERT_EQ(decoded[i], expected[i % 4]) << GetBlockQualityName(static_cast<EBlockQuality>(quality)) << " " << i;
+        }
+    }
+}
+
+TEST(BlockCompressionTest, BC6HRMSETest)
+{
+    // the 6 faces of a cube map with their mips, as the cube maps are imported
+    constexpr uint32 Width = 128;
+    constexpr uint32 Height = 128;
+    constexpr uint32 MipLevels = 8;
+    constexpr uint32 NumFaces = 6;
+
+    // the least relative rmse of each quality, the slower ones must not do worse
+    const double max_rmse[EBlockQuality_Count] = { 0.035, 0.03, 0.03 };
+
+    std::vector<std::vector<uint16>> faces;
+    uint32 num_pixels = 0;
+    for (uint32 face = 0; face < NumFaces; face++)
+    {
+        std::vector<uint16> pixels;
+        for (uint32 mip = 0; mip < MipLevels; mip++)
+        {
+            std::vector<uint16> mip_pixels = GenerateHDRImage(std::max(Width >> mip, 1u), std::max(Height >> mip, 1u), face * MipLevels + mip);
+            pixels.insert(pixels.end(), mip_pixels.begin(), mip_pixels.end());
+        }
+        num_pixels = static_cast<uint32>(pixels.size() / 4);
+        faces.push_back(std::move(pixels));
+    }
+
+    double previous = std::numeric_limits<double>::infinity();
+    for (uint32 quality = 0; quality < EBlockQuality_Count; quality++)
+    {
+        double sum = 0.0;
+        double seconds = 0.0;
+        for (const std::vector<uint16>& pixels : faces)
+        {
+            auto begin = std::chrono::high_resolution_clock::now();
+            std::vector<uint8> blocks = BlockCompression::Encode(reinterpret_cast<const uint8*>(pixels.data()), Width, Height, MipLevels, EBlockFormat_BC6H, static_cast<EBlockQuality>(quality));
+            seconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+            ASSERT_EQ(blocks.size(), BlockCompression::EncodedSize(Width, Height, MipLevels, EBlockFormat_BC6H));
+
+            std::vector<uint16> decoded(pixels.size());
+            EXPECT_TRUE(BlockCompression::Decode(blocks.data(), Width, Height, MipLevels, EBlockFormat_BC6H, reinterpret_cast<uint8*>(decoded.data())));
+
+            double rmse = RelativeRMSE(pixels.data(), decoded.data(), num_pixels);
+            sum += rmse * rmse;
+        }
+
+        double rmse = std::sqrt(sum / NumFaces);
+        printf("BC6H %s: relative rmse %.4f, encode %.2f Mpix/s\n", GetBlockQualityName(static_cast<EBlockQuality>(quality)).data(), rmse,
+            num_pixels * NumFaces / 1e6 / seconds);
+
+        EXPECT_LE(rmse, max_rmse[quality]);
+        EXPECT_LE(rmse, previous + 1e-4);
+        previous = rmse;
+    }
+}
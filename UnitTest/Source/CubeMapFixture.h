@@ -0,0 +1,51 @@
+#pragma once
+#include "Resource/BasicStorage.h"
+#include "Resource/MipGenerator.h"
+#include "Utils/MathLib.h"
+#include <array>
+#include <cstring>
+#include <functional>
+
+namespace MRenderer
+{
+    // a cube map of float or half rgba whose texels are @radiance of the directions of their centers, with its box filtered mips if @generate_mips
+    inline std::array<TextureData, NumCubeMapFaces> MakeCubeMap(uint16 width, ETextureFormat format, const std::function<Vector3(const Vector3&)>& radiance,
+        bool generate_mips = false)
+    {
+        uint16 mip_levels = generate_mips ? static_cast<uint16>(CalculateMaxMipLevels(width, width)) : 1;
+        std::array<TextureData, NumCubeMapFaces> faces;
+        for (uint32 face = 0; face < NumCubeMapFaces; face++)
+        {
+            faces[face] = TextureData(width, width, mip_levels, format);
+            for (uint32 y = 0; y < width; y++)
+            {
+                for (uint32 x = 0; x < width; x++)
+                {
+                    float u = (2.0f * x + 1) / width - 1;
+                    float v = (2.0f * y + 1) / width - 1;
+                    Vector3 color = radiance(CalcCubeMapDirection(face, u, v));
+
+                    uint32 index = (y * width + x) * 4;
+                    if (format == ETextureFormat_R16G16B16A16_FLOAT)
+                    {
+                        uint16* pixels = static_cast<uint16*>(faces[face].mData.GetData());
+                        const uint16 pixel[4] = { FloatToHalf(color.x), FloatToHalf(color.y), FloatToHalf(color.z), FloatToHalf(1.0f) };
+                        memcpy(pixels + index, pixel, sizeof(pixel));
+                    }
+                    else
+                    {
+                        float* pixels = static_cast<float*>(faces[face].mData.GetData());
+                        const float pixel[4] = { color.x, color.y, color.z, 1.0f };
+                        memcpy(pixels + index, pixel, sizeof(pixel));
+                    }
+                }
+            }
+        }
+
+        if (generate_mips)
+        {
+            MipGenerator::GenerateCubeMap(faces, EMipFilter_Box, false);
+        }
+        return faces;
+    }
+}
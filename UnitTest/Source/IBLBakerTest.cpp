@@ -0,0 +1,151 @@
+#include "gtest/gtest.h"
+#include "CubeMapFixture.h"
+#include "Resource/IBLBaker.h"
+#include "Utils/MathLib.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+using namespace MRenderer;
+
+namespace
+{
+    Vector3 ReadTexel(const TextureData& face, uint32 mip, uint32 x, uint32 y)
+    {
+        MipmapLayout layout = CalculateMipmapLayout(face.Width(), face.Height(), face.MipLevels(), 8, mip);
+        const uint16* pixel = reinterpret_cast<const uint16*>(static_cast<const uint8*>(face.Data()) + layout.BaseOffset) + (y * layout.Width + x) * 4;
+        return Vector3(HalfToFloat(pixel[0]), HalfToFloat(pixel[1]), HalfToFloat(pixel[2]));
+    }
+}
+
+TEST(IBLBakerTest, BRDFLutTest)
+{
+    // a smooth surface reflects around the normal, its scale and bias are 1 - fresnel and fresnel of n.v
+    constexpr uint32 Size = 64;
+    BinaryData lut = IBLBaker::IntegrateBRDF(Size, 1024);
+    ASSERT_EQ(lut.GetSize(), Size * Size * 2 * sizeof(uint16));
+
+    const uint16* texels = static_cast<const uint16*>(lut.GetData());
+    for (uint32 y = 0; y < Size; y++)
+    {
+        float n_dot_v = static_cast<float>(y + 1) / Size;
+        float fresnel = std::pow(1 - n_dot_v, 5.0f);
+        EXPECT_NEAR(HalfToFloat(texels[y * Size * 2]), 1 - fresnel, 2e-3f) << y;
+        EXPECT_NEAR(HalfToFloat(texels[y * Size * 2 + 1]), fresnel, 2e-3f) << y;
+    }
+
+    // the reflected part of the light never exceeds it
+    for (uint32 i = 0; i < Size * Size; i++)
+    {
+        float scale = HalfToFloat(texels[i * 2]);
+        float bias = HalfToFloat(texels[i * 2 + 1]);
+        EXPECT_GE(scale, 0.0f) << i;
+        EXPECT_GE(bias, 0.0f) << i;
+        EXPECT_LE(scale + bias, 1.01f) << i;
+    }
+
+    // the avx lanes and the scalar tail integrate the same samples
+    BinaryData odd = IBLBaker::IntegrateBRDF(Size, 1024 + 3);
+    const uint16* odd_texels = static_cast<const uint16*>(odd.GetData());
+    for (uint32 i = 0; i < Size * Size * 2; i++)
+    {
+        EXPECT_NEAR(HalfToFloat(odd_texels[i]), HalfToFloat(texels[i]), 1e-2f) << i;
+    }
+}
+
+TEST(IBLBakerTest, ConstantTest)
+{
+    // every sample of a constant cube map is the constant, so is their weighted average on every mip
+    const Vector3 radiance(0.25f, 2.0f, 40.0f);
+    auto faces = MakeCubeMap(32, ETextureFormat_R32G32B32A32_FLOAT, [&](const Vector3&) { return radiance; }, true);
+    auto prefiltered = IBLBaker::PrefilterEnvironmentMap(faces, 16, 3, 64);
+
+    for (uint32 face = 0; face < NumCubeMapFaces; face++)
+    {
+        ASSERT_EQ(prefiltered[face].Format(), ETextureFormat_R16G16B16A16_FLOAT);
+        for (uint32 mip = 0; mip < 3; mip++)
+        {
+            uint32 size = 16 >> mip;
+            for (uint32 i = 0; i < size * size; i++)
+            {
+                Vector3 color = ReadTexel(prefiltered[face], mip, i % size, i / size);
+                for (uint32 c = 0; c < 3; c++)
+                {
+                    EXPECT_NEAR(color[c], radiance[c], radiance[c] * 2e-3f) << face << " " << mip << " " << i;
+                }
+            }
+        }
+    }
+}
+
+TEST(IBLBakerTest, MirrorTest)
+{
+    // the mirror mip of the same size as the cube map samples the centers of its texels
+    constexpr uint16 Width = 16;
+    auto faces = MakeCubeMap(Width, ETextureFormat_R32G32B32A32_FLOAT, [](const Vector3& dir) { return Vector3(dir.x + 1, dir.y * dir.y, dir.z > 0 ? 4.0f : 0.5f); }, true);
+    auto prefiltered = IBLBaker::PrefilterEnvironmentMap(faces, Width, 2, 64);
+
+    for (uint32 face = 0; face < NumCubeMapFaces; face++)
+    {
+        const float* pixels = static_cast<const float*>(faces[face].Data());
+        for (uint32 i = 0; i < Width * Width; i++)
+        {
+            Vector3 color = ReadTexel(prefiltered[face], 0, i % Width, i / Width);
+            for (uint32 c = 0; c < 3; c++)
+            {
+                EXPECT_NEAR(color[c], pixels[i * 4 + c], std::abs(pixels[i * 4 + c]) * 2e-3f + 1e-4f) << face << " " << i;
+            }
+        }
+    }
+}
+
+TEST(IBLBakerTest, RoughnessTest)
+{
+    // a white sky over a black ground, the rougher the mip the more the up and down directions blur towards each other
+    constexpr uint16 Width = 32;
+    constexpr uint32 MipLevels = 4;
+    auto faces = MakeCubeMap(Width, ETextureFormat_R32G32B32A32_FLOAT, [](const Vector3& dir) { return dir.y > 0 ? Vector3(1, 1, 1) : Vector3(0, 0, 0); }, true);
+    auto prefiltered = IBLBaker::PrefilterEnvironmentMap(faces, Width, MipLevels, 256);
+
+    float last_up = 1.0f;
+    float last_down = 0.0f;
+    for (uint32 mip = 0; mip < MipLevels; mip++)
+    {
+        uint32 center = (Width >> mip) / 2;
+        float up = ReadTexel(prefiltered[2], mip, center, center).x;
+        float down = ReadTexel(prefiltered[3], mip, center, center).x;
+        EXPECT_LE(up, last_up + 1e-3f) << mip;
+        EXPECT_GE(down, last_down - 1e-3f) << mip;
+        EXPECT_GT(up, down) << mip;
+        last_up = up;
+        last_down = down;
+
+        // the faces around the horizon are symmetric
+        for (uint32 face : { 1, 4, 5 })
+        {
+            EXPECT_NEAR(ReadTexel(prefiltered[face], mip, center, center / 2).x, ReadTexel(prefiltered[0], mip, center, center / 2).x, 2e-2f) << face << " " << mip;
+        }
+    }
+    EXPECT_NEAR(ReadTexel(prefiltered[2], 0, Width / 2, Width / 2).x, 1.0f, 1e-3f);
+    EXPECT_NEAR(ReadTexel(prefiltered[3], 0, Width / 2, Width / 2).x, 0.0f, 1e-3f);
+    EXPECT_LT(last_up, 0.99f);
+    EXPECT_GT(last_down, 0.01f);
+}
+
+TEST(IBLBakerTest, ThroughputTest)
+{
+    auto faces = MakeCubeMap(256, ETextureFormat_R32G32B32A32_FLOAT, [](const Vector3& dir) { return Vector3(dir.x * dir.x * 8, std::abs(dir.y), dir.z > 0.9f ? 100.0f : 0.1f); }, true);
+
+    auto begin = std::chrono::high_resolution_clock::now();
+    auto prefiltered = IBLBaker::PrefilterEnvironmentMap(faces, IBLBaker::PrefilteredMapSize, IBLBaker::PrefilteredMapMipLevels);
+    double prefilter_seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+
+    begin = std::chrono::high_resolution_clock::now();
+    BinaryData lut = IBLBaker::IntegrateBRDF(IBLBaker::BRDFLutSize);
+    double lut_seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+
+    printf("prefilter %u %u mips: %.1f ms, brdf lut %u: %.1f ms\n", IBLBaker::PrefilteredMapSize, IBLBaker::PrefilteredMapMipLevels, prefilter_seconds * 1000.0,
+        IBLBaker::BRDFLutSize, lut_seconds * 1000.0);
+    EXPECT_EQ(prefiltered[0].MipLevels(), IBLBaker::PrefilteredMapMipLevels);
+    EXPECT_FALSE(lut.Empty());
+}
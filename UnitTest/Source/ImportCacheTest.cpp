@@ -0,0 +1,124 @@
+#include "gtest/gtest.h"
+#include "Resource/ImportCache.h"
+#include <filesystem>
+#include <fstream>
+
+using namespace MRenderer;
+
+namespace
+{
+    void WriteText(const std::filesystem::path& path, std::string_view text)
+    {
+        std::ofstream file(path, std::ios::binary);
+        file.write(text.data(), text.size());
+    }
+}
+
+TEST(ImportCacheTest, HashTest)
+{
+    std::string text = "the quick brown fox jumps over the lazy dog";
+    uint64 hash = ImportCache::HashBytes(text.data(), text.size());
+    EXPECT_EQ(hash, ImportCache::HashBytes(text.data(), text.size()));
+
+    // every byte counts, the tail too
+    for (uint32 i = 0; i < text.size(); i++)
+    {
+        std::string changed = text;
+        changed[i] ^= 1;
+        EXPECT_NE(ImportCache::HashBytes(changed.data(), changed.size()), hash) << i;
+    }
+    EXPECT_NE(ImportCache::HashBytes(text.data(), text.size() - 1), hash);
+    EXPECT_NE(ImportCache::HashBytes(text.data(), text.size(), 1), hash);
+    EXPECT_NE(ImportCache::HashBytes(nullptr, 0), ImportCache::HashBytes(text.data(), 1));
+
+    EXPECT_NE(ImportCache::HashCombine(ImportCache::HashCombine(0, 1), 0), ImportCache::HashCombine(ImportCache::HashCombine(0, 0), 1));
+}
+
+TEST(ImportCacheTest, RecordTest)
+{
+    namespace fs = std::filesystem;
+
+    fs::path folder = fs::temp_directory_path() / "MRendererImportCacheTest";
+    fs::remove_all(folder);
+    fs::create_directories(folder);
+
+    std::string cache_path = (folder / "ImportCache.json").string();
+    std::string model = (folder / "Model.obj").string();
+    std::string texture = (folder / "Albedo.png").string();
+    std::string model_output = (folder / "Model_Mesh_data.bin").string();
+    std::string texture_output = (folder / "Albedo_data.bin").string();
+
+    // bigger than a chunk of @ImportCache::HashFile
+    WriteText(model, std::string(3 << 20, 'v'));
+    WriteText(texture, "pixels");
+    WriteText(model_output, "mesh");
+    WriteText(texture_output, "bc1");
+
+    {
+        ImportCache cache(cache_path);
+        EXPECT_FALSE(cache.IsUpToDate("Model", 7));
+
+        cache.Update("Texture", 0, { texture }, { texture_output });
+        cache.Update("Model", 7, { model }, { model_output }, { ImportChild{ .Source = texture, .RepoPath = "Texture" } });
+        EXPECT_TRUE(cache.IsUpToDate("Model", 7));
+        EXPECT_TRUE(cache.IsUpToDate("Texture", 0));
+
+        // the settings are part of the key
+        EXPECT_FALSE(cache.IsUpToDate("Model", 8));
+        EXPECT_FALSE(cache.IsUpToDate("Texture", 1));
+    }
+
+    // the records are kept on disk
+    {
+        ImportCache cache(cache_path);
+        EXPECT_TRUE(cache.IsUpToDate("Model", 7));
+
+        std::vector<ImportChild> children = cache.Children("Model");
+        ASSERT_EQ(children.size(), 1u);
+        EXPECT_EQ(children[0].Source, texture);
+        EXPECT_EQ(children[0].RepoPath, "Texture");
+        EXPECT_TRUE(cache.Children("Texture").empty());
+        EXPECT_TRUE(cache.Children("Missing").empty());
+
+        // touched but the same content
+        fs::last_write_time(model, fs::last_write_time(model) + std::chrono::seconds(10));
+        EXPECT_TRUE(cache.IsUpToDate("Model", 7));
+
+        // a changed texture outdates the texture only
+        WriteText(texture, "pixelz");
+        fs::last_write_time(texture, fs::last_write_time(texture) + std::chrono::seconds(10));
+        EXPECT_FALSE(cache.IsUpToDate("Texture", 0));
+        EXPECT_TRUE(cache.IsUpToDate("Model", 7));
+
+        cache.Update("Texture", 0, { texture }, { texture_output });
+        EXPECT_TRUE(cache.IsUpToDate("Texture", 0));
+
+        // a missing output is imported again
+        fs::remove(model_output);
+        EXPECT_FALSE(cache.IsUpToDate("Model", 7));
+        WriteText(model_output, "mesh");
+        EXPECT_TRUE(cache.IsUpToDate("Model", 7));
+
+        cache.Invalidate("Model");
+        EXPECT_FALSE(cache.IsUpToDate("Model", 7));
+
+        // a missing source isn't cached
+        cache.Update("Missing", 0, { (folder / "Missing.png").string() }, {});
+        EXPECT_FALSE(cache.IsUpToDate("Missing", 0));
+    }
+
+    {
+        ImportCache cache(cache_path);
+        EXPECT_FALSE(cache.IsUpToDate("Model", 7));
+        EXPECT_TRUE(cache.IsUpToDate("Texture", 0));
+    }
+
+    // a corrupted cache is empty
+    WriteText(cache_path, "{ \"Records\": [");
+    {
+        ImportCache cache(cache_path);
+        EXPECT_FALSE(cache.IsUpToDate("Texture", 0));
+    }
+
+    fs::remove_all(folder);
+}
@@ -0,0 +1,219 @@
+#include "gtest/gtest.h"
+#include "Utils/Thread.h"
+#include "format"
+#include <chrono>
+#include <numeric>
+#include <random>
+#include <algorithm>
+
+using namespace MRenderer;
+
+TEST(WorkStealingQueue, PushPopStealTest)
+{
+    WorkStealingQueue<int*, 16> queue;
+    int values[16];
+
+    for (int i = 0; i < 16; i++)
+    {
+        ASSERT_TRUE(queue.Push(&values[i]));
+    }
+
+    // should be full here
+    ASSERT_FALSE(queue.Push(&values[0]));
+    ASSERT_EQ(queue.Size(), 16);
+
+    // owner pops from the bottom, thieves steal from the top
+    ASSERT_EQ(queue.Pop(), &values[15]);
+    ASSERT_EQ(queue.Steal(), &values[0]);
+    ASSERT_EQ(queue.Size(), 14);
+
+    while (queue.Pop());
+    ASSERT_EQ(queue.Steal(), nullptr);
+    ASSERT_EQ(queue.Pop(), nullptr);
+}
+
+TEST(JobSystem, ParallelForTest)
+{
+    JobSystem jobs(8);
+
+    const uint32 count = 100000;
+    std::vector<uint32> data(count, 0);
+
+    JobHandle handle = jobs.ParallelFor(count, 64,
+        [&](uint32 begin, uint32 end)
+        {
+            for (uint32 i = begin; i < end; i++)
+            {
+                data[i] += i;
+            }
+        }
+    );
+
+    jobs.Wait(handle);
+    ASSERT_TRUE(handle.IsComplete());
+
+    for (uint32 i = 0; i < count; i++)
+    {
+        ASSERT_EQ(data[i], i);
+    }
+}
+
+TEST(JobSystem, DependencyTest)
+{
+    JobSystem jobs(4);
+
+    // each stage must observe the result of the previous one
+    std::atomic<uint32> stage = 0;
+    std::atomic<uint32> num_executed = 0;
+
+    JobHandle first = jobs.ParallelFor(1000, 1,
+        [&](uint32, uint32)
+        {
+            num_executed++;
+        }
+    );
+
+    JobHandle second = jobs.Schedule(
+        [&]()
+        {
+            ASSERT_EQ(num_executed.load(), 1000);
+            stage = 1;
+        },
+        first
+    );
+
+    JobHandle third = jobs.ParallelFor(1000, 10,
+        [&](uint32, uint32)
+        {
+            ASSERT_EQ(stage.load(), 1);
+        },
+        second
+    );
+
+    // depend on a completed handle and an empty handle
+    JobHandle deps[] = { first, third, JobHandle() };
+    JobHandle last = jobs.Schedule([&]() { stage = 2; }, deps);
+
+    jobs.Wait(last);
+    ASSERT_EQ(stage.load(), 2);
+}
+
+TEST(JobSystem, NestedScheduleTest)
+{
+    JobSystem jobs(4);
+    std::atomic<uint32> sum = 0;
+
+    // jobs scheduled from workers go to the local deque and get stolen by the others
+    JobHandle outer = jobs.ParallelFor(64, 1,
+        [&](uint32 begin, uint32)
+        {
+            JobHandle inner = jobs.ParallelFor(64, 1,
+                [&](uint32 i, uint32)
+                {
+                    sum += i;
+                }
+            );
+            jobs.Wait(inner);
+        }
+    );
+
+    jobs.Wait(outer);
+    ASSERT_EQ(sum.load(), 64 * (63 * 64 / 2));
+}
+
+TEST(JobSystem, ScheduleTaskTest)
+{
+    JobSystem jobs(2);
+
+    auto future = jobs.ScheduleTask([](int a, int b) { return a * b; }, 5, 6);
+    ASSERT_EQ(future.get(), 30);
+}
+
+// micro benchmark, tasks/sec as the worker count grows
+// the single mutex thread pool is measured as the baseline
+TEST(JobSystem, ThroughputBenchmark)
+{
+    using Clock = std::chrono::high_resolution_clock;
+
+    const uint32 num_tasks = 200000;
+    const uint32 max_workers = std::max(std::thread::hardware_concurrency(), 1u);
+
+    // tiny amount of work per task, so the scheduling overhead dominates
+    auto work = [](std::atomic<uint64>& sink, uint32 i)
+    {
+        uint64 x = i;
+        for (uint32 k = 0; k < 32; k++)
+        {
+            x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+        }
+        sink.fetch_add(x & 1, std::memory_order_relaxed);
+    };
+
+    for (uint32 num_workers = 1; num_workers <= max_workers; num_workers *= 2)
+    {
+        std::atomic<uint64> sink = 0;
+
+        double thread_pool_rate = 0;
+        {
+            ThreadPool pool(num_workers);
+            std::vector<TaskFuture<void>> futures;
+            futures.reserve(num_tasks);
+
+            auto begin = Clock::now();
+            for (uint32 i = 0; i < num_tasks; i++)
+            {
+                futures.push_back(pool.Schedule([&, i]() { work(sink, i); }));
+            }
+            for (auto& future : futures)
+            {
+                future.wait();
+            }
+            double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+            thread_pool_rate = num_tasks / seconds;
+        }
+
+        double job_system_rate = 0;
+        {
+            JobSystem jobs(num_workers);
+
+            auto begin = Clock::now();
+            JobHandle handle = jobs.ParallelFor(num_tasks, 1,
+                [&](uint32 i, uint32)
+                {
+                    work(sink, i);
+                }
+            );
+            jobs.Wait(handle);
+            double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+            job_system_rate = num_tasks / seconds;
+        }
+
+        std::cout << std::format("workers: {:2}  ThreadPool: {:12.0f} tasks/s  JobSystem: {:12.0f} tasks/s\n", num_workers, thread_pool_rate, job_system_rate);
+        ASSERT_GT(sink.load(), 0);
+    }
+}
+
+TEST(JobSystem, ParallelRadixSortTest)
+{
+    std::mt19937_64 rng(11);
+
+    for (uint32 size : { 0u, 1u, 1000u, 300000u })
+    {
+        std::vector<uint64> items(size);
+        for (uint64& item : items)
+        {
+            // only the high 20 bits are the key, the low bits keep the original order to check stability
+            item = (rng() & 0xfffff00000000000ull);
+        }
+        for (uint32 i = 0; i < size; i++)
+        {
+            items[i] |= i;
+        }
+
+        std::vector<uint64> expected = items;
+        std::stable_sort(expected.begin(), expected.end(), [](uint64 a, uint64 b) { return (a >> 44) < (b >> 44); });
+
+        ParallelRadixSort(items, 44, 64);
+        ASSERT_EQ(items, expected);
+    }
+}
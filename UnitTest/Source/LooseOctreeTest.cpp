@@ -0,0 +1,264 @@
+#include "gtest/gtest.h"
+#include "Utils/LooseOctree.h"
+#include <random>
+#include <algorithm>
+#include <chrono>
+
+using namespace MRenderer;
+
+static AABB RandomBound(std::mt19937& rng, float world_size)
+{
+    std::uniform_real_distribution<float> position(-world_size * 0.45f, world_size * 0.45f);
+    std::uniform_real_distribution<float> extent(0.1f, 4.0f);
+
+    Vector3 center = { position(rng), position(rng), position(rng) };
+    Vector3 half_size = { extent(rng), extent(rng), extent(rng) };
+    return AABB(center - half_size, center + half_size);
+}
+
+static FrustumVolume RandomFrustum(std::mt19937& rng)
+{
+    std::uniform_real_distribution<float> angle(0, 2 * PI);
+    std::uniform_real_distribution<float> position(-100, 100);
+
+    Matrix4x4 projection = ProjectionMatrix1(Deg2Rad * 60.0f, 16.0f / 9.0f, 0.1f, 300.0f);
+    Matrix4x4 view = Matrix4x4::Identity();
+    view.SetRotation(angle(rng), angle(rng), angle(rng));
+    view.SetTranslation(Vector3(position(rng), position(rng), position(rng)));
+    return FrustumVolume::FromMatrix(projection * view);
+}
+
+// the SIMD plane test must agree with the scalar one
+TEST(LooseOctree, Contains8Test)
+{
+    std::mt19937 rng(7);
+
+    AABBSoA bounds;
+    bounds.Resize(64);
+
+    std::vector<AABB> scalar(64);
+    for (uint32 i = 0; i < 64; i++)
+    {
+        scalar[i] = RandomBound(rng, 200.0f);
+        bounds.Set(i, scalar[i]);
+    }
+
+    for (uint32 n = 0; n < 16; n++)
+    {
+        FrustumVolume frustum = RandomFrustum(rng);
+        for (uint32 begin = 0; begin < 64; begin += AABBSoA::Stride)
+        {
+            uint32 inside_mask;
+            uint32 visible_mask = frustum.Contains8(bounds, begin, inside_mask);
+
+            for (uint32 i = 0; i < AABBSoA::Stride; i++)
+            {
+                ASSERT_EQ(bool(visible_mask & (1u << i)), frustum.Contains(scalar[begin + i]));
+
+                // inside implies visible
+                if (inside_mask & (1u << i))
+                {
+                    ASSERT_TRUE(visible_mask & (1u << i));
+                }
+            }
+        }
+    }
+}
+
+// the batched culling path must produce the same set of objects as the callback one
+TEST(LooseOctree, FrustumCullTest)
+{
+    constexpr float WorldSize = 400.0f;
+    std::mt19937 rng(42);
+
+    LooseOctree<int> octree(WorldSize);
+    LooseOctree<int>::OctreeElement* element = nullptr;
+    AABB bound;
+    for (int i = 0; i < 10000; i++)
+    {
+        bound = RandomBound(rng, WorldSize);
+        element = octree.AddObject(bound, i);
+    }
+
+    auto check = [&]()
+    {
+        for (uint32 n = 0; n < 4; n++)
+        {
+            FrustumVolume frustum = RandomFrustum(rng);
+
+            std::vector<int> expected;
+            octree.FrustumCull(frustum, [&](int index) { expected.push_back(index); });
+
+            std::vector<int> result;
+            octree.FrustumCull(frustum, result);
+
+            std::sort(expected.begin(), expected.end());
+            std::sort(result.begin(), result.end());
+            ASSERT_EQ(expected, result);
+        }
+    };
+
+    check();
+
+    // move the last object around, small steps keep it in its node and patch the cull cache in place,
+    // large steps move it to another node and rebuild the cache.
+    // note: only the last element is moved, since subdividing a node reallocates the elements in it
+    std::uniform_real_distribution<float> step(-0.05f, 0.05f);
+    for (uint32 i = 0; i < 32; i++)
+    {
+        if (i % 4 == 3)
+        {
+            bound = RandomBound(rng, WorldSize);
+        }
+        else
+        {
+            Vector3 offset = { step(rng), step(rng), step(rng) };
+            bound = AABB(bound.Min + offset, bound.Max + offset);
+        }
+
+        element = octree.UpdateElement(element, bound);
+        ASSERT_TRUE(element);
+
+        check();
+    }
+}
+
+// views culled at the same time from workers must each get their own objects, the first of them rebuilding the cull cache
+TEST(LooseOctree, ConcurrentCullTest)
+{
+    constexpr float WorldSize = 400.0f;
+    constexpr uint32 NumViews = 16;
+    std::mt19937 rng(11);
+
+    LooseOctree<int> octree(WorldSize);
+    for (int i = 0; i < 10000; i++)
+    {
+        octree.AddObject(RandomBound(rng, WorldSize), i);
+    }
+
+    std::vector<FrustumVolume> frustums;
+    std::vector<std::vector<int>> expected(NumViews);
+    for (uint32 n = 0; n < NumViews; n++)
+    {
+        frustums.push_back(RandomFrustum(rng));
+        octree.FrustumCull(frustums[n], [&](int index) { expected[n].push_back(index); });
+        std::sort(expected[n].begin(), expected[n].end());
+    }
+
+    std::vector<std::vector<int>> results(NumViews);
+    TaskScheduler& scheduler = TaskScheduler::Instance();
+    scheduler.Wait(scheduler.ParallelFor(NumViews, 1,
+        [&](uint32 begin, uint32 end)
+        {
+            for (uint32 n = begin; n < end; n++)
+            {
+                octree.FrustumCull(frustums[n], results[n]);
+            }
+        }
+    ));
+
+    for (uint32 n = 0; n < NumViews; n++)
+    {
+        std::sort(results[n].begin(), results[n].end());
+        EXPECT_EQ(expected[n], results[n]) << n;
+    }
+}
+
+// the bulk built tree must cull the same objects as a brute force test, and keep working with incremental updates
+TEST(LooseOctree, BuildTest)
+{
+    using Clock = std::chrono::high_resolution_clock;
+
+    constexpr float WorldSize = 400.0f;
+    constexpr int NumObjects = 100000;
+    std::mt19937 rng(3);
+
+    std::vector<AABB> bounds(NumObjects);
+    std::vector<int> indices(NumObjects);
+    for (int i = 0; i < NumObjects; i++)
+    {
+        bounds[i] = RandomBound(rng, WorldSize);
+        indices[i] = i;
+    }
+
+    // one object outside of the world
+    bounds.back() = AABB({ WorldSize, WorldSize, WorldSize }, { WorldSize + 1, WorldSize + 1, WorldSize + 1 });
+
+    auto begin = Clock::now();
+    LooseOctree<int> incremental(WorldSize);
+    for (int i = 0; i < NumObjects - 1; i++)
+    {
+        incremental.AddObject(bounds[i], i);
+    }
+    auto incremental_time = Clock::now() - begin;
+
+    begin = Clock::now();
+    LooseOctree<int> octree(WorldSize);
+    std::vector<LooseOctree<int>::OctreeElement*> elements = octree.Build(bounds, indices);
+    auto build_time = Clock::now() - begin;
+
+    std::cout << "incremental: " << std::chrono::duration<double, std::milli>(incremental_time).count() << " ms, "
+        << "bulk build: " << std::chrono::duration<double, std::milli>(build_time).count() << " ms\n";
+
+    ASSERT_EQ(elements.size(), NumObjects);
+    ASSERT_EQ(elements.back(), nullptr);
+    for (int i = 0; i < NumObjects - 1; i++)
+    {
+        ASSERT_NE(elements[i], nullptr);
+    }
+
+    // the incremental tree is only compared before any object moves
+    auto check = [&](int num_objects, bool compare_incremental)
+    {
+        for (uint32 n = 0; n < 4; n++)
+        {
+            FrustumVolume frustum = RandomFrustum(rng);
+
+            std::vector<int> expected;
+            for (int i = 0; i < num_objects; i++)
+            {
+                if (frustum.Contains(bounds[i]))
+                {
+                    expected.push_back(i);
+                }
+            }
+
+            std::vector<int> result;
+            octree.FrustumCull(frustum, result);
+            std::sort(result.begin(), result.end());
+            ASSERT_EQ(expected, result);
+
+            if (compare_incremental)
+            {
+                std::vector<int> incremental_result;
+                incremental.FrustumCull(frustum, incremental_result);
+                std::sort(incremental_result.begin(), incremental_result.end());
+                ASSERT_EQ(expected, incremental_result);
+            }
+        }
+    };
+
+    check(NumObjects - 1, true);
+
+    // nudge some objects within their nodes
+    std::uniform_real_distribution<float> step(-0.01f, 0.01f);
+    for (int i = 0; i < NumObjects - 1; i += 101)
+    {
+        Vector3 offset = { step(rng), step(rng), step(rng) };
+        bounds[i] = AABB(bounds[i].Min + offset, bounds[i].Max + offset);
+        elements[i] = octree.UpdateElement(elements[i], bounds[i]);
+        ASSERT_NE(elements[i], nullptr);
+    }
+
+    check(NumObjects - 1, false);
+
+    // then move one far away and add a new one
+    bounds[0] = RandomBound(rng, WorldSize);
+    elements[0] = octree.UpdateElement(elements[0], bounds[0]);
+    ASSERT_NE(elements[0], nullptr);
+
+    bounds.back() = RandomBound(rng, WorldSize);
+    ASSERT_NE(octree.AddObject(bounds.back(), NumObjects - 1), nullptr);
+
+    check(NumObjects, false);
+}
@@ -0,0 +1,474 @@
+#include "gtest/gtest.h"
+#include "Utils/MathLib.h"
+#include <random>
+#include <chrono>
+#include <iomanip>
+
+using namespace MRenderer;
+
+static Matrix4x4 RandomTRSMatrix(std::mt19937& rng)
+{
+    std::uniform_real_distribution<float> position(-100, 100);
+    std::uniform_real_distribution<float> angle(-PI, PI);
+    std::uniform_real_distribution<float> scale(0.5f, 2.0f);
+
+    Matrix4x4 matrix = Matrix4x4::Identity();
+    matrix.SetRotation(angle(rng), angle(rng), angle(rng));
+    matrix.SetTranslation(Vector3(position(rng), position(rng), position(rng)));
+    matrix.SetScale(Vector3(scale(rng), scale(rng), scale(rng)));
+    return matrix;
+}
+
+static Matrix4x4 RandomMatrix(std::mt19937& rng)
+{
+    std::uniform_real_distribution<float> value(-2, 2);
+
+    Matrix4x4 matrix;
+    for (uint32 r = 0; r < 4; r++)
+    {
+        for (uint32 c = 0; c < 4; c++)
+        {
+            matrix.At(r, c) = value(rng);
+        }
+    }
+    return matrix;
+}
+
+static void ExpectMatrixNear(const Matrix4x4& lhs, const Matrix4x4& rhs, float tolerance)
+{
+    for (uint32 r = 0; r < 4; r++)
+    {
+        for (uint32 c = 0; c < 4; c++)
+        {
+            ASSERT_NEAR(lhs.At(r, c), rhs.At(r, c), tolerance) << "at (" << r << ", " << c << ")";
+        }
+    }
+}
+
+TEST(MathLib, InverseMatrixBatchTest)
+{
+    std::mt19937 rng(3);
+
+    // odd count to cover the unpaired matrix
+    std::vector<Matrix4x4> matrices(33);
+    for (auto& matrix : matrices)
+    {
+        matrix = RandomMatrix(rng);
+    }
+    matrices[5] = ProjectionMatrix1(Deg2Rad * 60.0f, 16.0f / 9.0f, 0.1f, 1000.0f);
+    matrices[6] = RandomTRSMatrix(rng);
+    matrices[7] = Matrix4x4();
+
+    std::vector<Matrix4x4> inverse(matrices.size());
+    InverseMatrixBatch(matrices.data(), inverse.data(), static_cast<uint32>(matrices.size()));
+
+    for (uint32 i = 0; i < matrices.size(); i++)
+    {
+        Matrix4x4 expected = matrices[i].Inverse();
+
+        // relative tolerance, random matrices can be close to singular
+        float max_element = 1;
+        for (uint32 r = 0; r < 4; r++)
+        {
+            for (uint32 c = 0; c < 4; c++)
+            {
+                max_element = std::max(max_element, std::abs(expected.At(r, c)));
+            }
+        }
+        ExpectMatrixNear(inverse[i], expected, max_element * 1e-3f);
+    }
+
+    // in place
+    std::vector<Matrix4x4> in_place = matrices;
+    InverseMatrixBatch(in_place.data(), in_place.data(), static_cast<uint32>(in_place.size()));
+    for (uint32 i = 0; i < matrices.size(); i++)
+    {
+        ExpectMatrixNear(in_place[i], inverse[i], 0);
+    }
+}
+
+TEST(MathLib, InverseTRSMatrixBatchTest)
+{
+    std::mt19937 rng(4);
+
+    std::vector<Matrix4x4> matrices(17);
+    for (auto& matrix : matrices)
+    {
+        matrix = RandomTRSMatrix(rng);
+    }
+
+    std::vector<Matrix4x4> inverse(matrices.size());
+    InverseTRSMatrixBatch(matrices.data(), inverse.data(), static_cast<uint32>(matrices.size()));
+
+    for (uint32 i = 0; i < matrices.size(); i++)
+    {
+        ExpectMatrixNear(inverse[i], matrices[i].Inverse(), 1e-3f);
+        ExpectMatrixNear(inverse[i], matrices[i].QuickInverse(), 1e-3f);
+    }
+}
+
+TEST(MathLib, TransformBatchTest)
+{
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<float> value(-100, 100);
+
+    Matrix4x4 matrix = RandomMatrix(rng);
+
+    // not a multiple of 8 to cover the scalar tail
+    std::vector<Vector3> points(29);
+    std::vector<Vector4> vectors(29);
+    for (uint32 i = 0; i < points.size(); i++)
+    {
+        points[i] = Vector3(value(rng), value(rng), value(rng));
+        vectors[i] = Vector4(value(rng), value(rng), value(rng), value(rng));
+    }
+
+    std::vector<Vector3> transformed_points = points;
+    TransformPointBatch(matrix, transformed_points.data(), transformed_points.data(), static_cast<uint32>(points.size()));
+
+    std::vector<Vector4> transformed_vectors(vectors.size());
+    TransformVectorBatch(matrix, vectors.data(), transformed_vectors.data(), static_cast<uint32>(vectors.size()));
+
+    for (uint32 i = 0; i < points.size(); i++)
+    {
+        Vector4 expected_point = matrix * Vector4(points[i], 1);
+        ASSERT_NEAR(transformed_points[i].x, expected_point.x, 1e-3f);
+        ASSERT_NEAR(transformed_points[i].y, expected_point.y, 1e-3f);
+        ASSERT_NEAR(transformed_points[i].z, expected_point.z, 1e-3f);
+
+        Vector4 expected_vector = matrix * vectors[i];
+        ASSERT_NEAR(transformed_vectors[i].x, expected_vector.x, 1e-3f);
+        ASSERT_NEAR(transformed_vectors[i].y, expected_vector.y, 1e-3f);
+        ASSERT_NEAR(transformed_vectors[i].z, expected_vector.z, 1e-3f);
+        ASSERT_NEAR(transformed_vectors[i].w, expected_vector.w, 1e-3f);
+    }
+}
+
+// batch kernels against the MatrixOperation code they replace, best of a few rounds
+TEST(MathLib, BatchBenchmark)
+{
+    using Clock = std::chrono::high_resolution_clock;
+
+    constexpr uint32 NumItems = 100000;
+    constexpr uint32 NumRounds = 5;
+
+    std::mt19937 rng(6);
+    std::uniform_real_distribution<float> value(-100, 100);
+
+    std::vector<Matrix4x4> matrices(NumItems);
+    std::vector<Matrix4x4> output(NumItems);
+    std::vector<Vector3> points(NumItems), transformed_points(NumItems);
+    std::vector<Vector4> vectors(NumItems), transformed_vectors(NumItems);
+    for (uint32 i = 0; i < NumItems; i++)
+    {
+        matrices[i] = RandomTRSMatrix(rng);
+        points[i] = Vector3(value(rng), value(rng), value(rng));
+        vectors[i] = Vector4(points[i], 1);
+    }
+    Matrix4x4 transform = RandomTRSMatrix(rng);
+
+    auto measure = [&](const char* name, auto&& func)
+    {
+        double best = std::numeric_limits<double>::max();
+        for (uint32 round = 0; round < NumRounds; round++)
+        {
+            auto begin = Clock::now();
+            func();
+            best = std::min(best, std::chrono::duration<double, std::nano>(Clock::now() - begin).count());
+        }
+
+        std::cout << std::setw(28) << std::left << name << std::setw(10) << std::right << std::fixed << std::setprecision(2) << best / NumItems << " ns/item\n";
+        return best;
+    };
+
+    double inverse = measure("Matrix4x4::Inverse", [&]() { for (uint32 i = 0; i < NumItems; i++) output[i] = matrices[i].Inverse(); });
+    double inverse_batch = measure("InverseMatrixBatch", [&]() { InverseMatrixBatch(matrices.data(), output.data(), NumItems); });
+    double quick_inverse = measure("Matrix4x4::QuickInverse", [&]() { for (uint32 i = 0; i < NumItems; i++) output[i] = matrices[i].QuickInverse(); });
+    double trs_inverse_batch = measure("InverseTRSMatrixBatch", [&]() { InverseTRSMatrixBatch(matrices.data(), output.data(), NumItems); });
+    double point = measure("Matrix4x4 * Vector4(p, 1)", [&]() { for (uint32 i = 0; i < NumItems; i++) transformed_points[i] = transform * Vector4(points[i], 1); });
+    double point_batch = measure("TransformPointBatch", [&]() { TransformPointBatch(transform, points.data(), transformed_points.data(), NumItems); });
+    measure("Matrix4x4 * Vector4", [&]() { for (uint32 i = 0; i < NumItems; i++) transformed_vectors[i] = transform * vectors[i]; });
+    measure("TransformVectorBatch", [&]() { TransformVectorBatch(transform, vectors.data(), transformed_vectors.data(), NumItems); });
+
+    EXPECT_LT(inverse_batch, inverse);
+    EXPECT_LT(trs_inverse_batch, quick_inverse);
+    EXPECT_LT(point_batch, point);
+
+    // Matrix4x4 * Vector4 uses the same transposed kernel as TransformVectorBatch since @Vec4f, both are bound by memory so they are only reported
+}
+
+TEST(MathLib, Vec4fTest)
+{
+    Vec4f a(1, 2, 3, 4);
+    Vec4f b(-5, 6, 0.5f, 8);
+
+    Vector3 cross = Vector3::FromVec4f(a.Cross3(b));
+    EXPECT_FLOAT_EQ(cross.x, 2 * 0.5f - 3 * 6);
+    EXPECT_FLOAT_EQ(cross.y, 3 * -5 - 1 * 0.5f);
+    EXPECT_FLOAT_EQ(cross.z, 1 * 6 - 2 * -5);
+    EXPECT_EQ(a.Cross3(b).W(), 0);
+
+    EXPECT_FLOAT_EQ(a.Dot3(b).X(), -5 + 12 + 1.5f);
+    EXPECT_FLOAT_EQ(a.Dot3(b).W(), -5 + 12 + 1.5f);
+    EXPECT_FLOAT_EQ(a.Dot4(b).Y(), -5 + 12 + 1.5f + 32);
+    EXPECT_FLOAT_EQ(a.Normalize3().Length3().Z(), 1);
+    EXPECT_FLOAT_EQ(b.Abs().X(), 5);
+    EXPECT_EQ(Vec4f::LessMask(a, b), 0b1010u);
+
+    // partial loads and stores don't touch the neighbouring floats
+    float memory[5] = { 1, 2, 3, 4, 5 };
+    Vec4f loaded = Vec4f::Load3(memory + 1);
+    EXPECT_EQ(loaded.X(), 2);
+    EXPECT_EQ(loaded.Z(), 4);
+    EXPECT_EQ(loaded.W(), 0);
+    Vec4f::Splat(9).Store3(memory + 1);
+    EXPECT_EQ(memory[0], 1);
+    EXPECT_EQ(memory[3], 9);
+    EXPECT_EQ(memory[4], 5);
+}
+
+TEST(MathLib, MatrixOperationTest)
+{
+    std::mt19937 rng(7);
+    Matrix4x4 lhs = RandomMatrix(rng);
+    Matrix4x4 rhs = RandomMatrix(rng);
+    Vector4 vec(1, -2, 3, 0.5f);
+
+    Matrix4x4 product = lhs * rhs;
+    Vector4 transformed = lhs * vec;
+    for (uint32 r = 0; r < 4; r++)
+    {
+        float expected_vector = 0;
+        for (uint32 k = 0; k < 4; k++)
+        {
+            expected_vector += lhs.At(r, k) * vec[k];
+        }
+        EXPECT_NEAR(transformed[r], expected_vector, 1e-5f);
+
+        for (uint32 c = 0; c < 4; c++)
+        {
+            float expected = 0;
+            for (uint32 k = 0; k < 4; k++)
+            {
+                expected += lhs.At(r, k) * rhs.At(k, c);
+            }
+            EXPECT_NEAR(product.At(r, c), expected, 1e-5f);
+        }
+    }
+
+    Matrix3x3 rotation = Matrix3x3::FromEulerAngle(0.3f, -1.2f, 2.0f);
+    Matrix3x3 identity = rotation * Matrix3x3(
+        rotation.At(0, 0), rotation.At(1, 0), rotation.At(2, 0),
+        rotation.At(0, 1), rotation.At(1, 1), rotation.At(2, 1),
+        rotation.At(0, 2), rotation.At(1, 2), rotation.At(2, 2)
+    );
+    Vector3 rotated = rotation * Vector3(0, 0, 1);
+    for (uint32 r = 0; r < 3; r++)
+    {
+        EXPECT_NEAR(rotated[r], rotation.At(r, 2), 1e-6f);
+        for (uint32 c = 0; c < 3; c++)
+        {
+            EXPECT_NEAR(identity.At(r, c), r == c ? 1 : 0, 1e-5f);
+        }
+    }
+}
+
+// the transformed bound must be the tight bound of the 8 transformed corners
+TEST(MathLib, AABBTransformTest)
+{
+    std::mt19937 rng(8);
+    std::uniform_real_distribution<float> value(-10, 10);
+
+    for (uint32 n = 0; n < 100; n++)
+    {
+        Vector3 a(value(rng), value(rng), value(rng));
+        Vector3 b(value(rng), value(rng), value(rng));
+        AABB bound(Vector3::Min(a, b), Vector3::Max(a, b));
+        Matrix4x4 matrix = RandomTRSMatrix(rng);
+
+        Vector3 min(FLT_MAX, FLT_MAX, FLT_MAX), max(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+        for (uint32 corner = 0; corner < 8; corner++)
+        {
+            Vector3 p(corner & 1 ? bound.Max.x : bound.Min.x, corner & 2 ? bound.Max.y : bound.Min.y, corner & 4 ? bound.Max.z : bound.Min.z);
+            Vector3 transformed = matrix * Vector4(p, 1);
+            min = Vector3::Min(min, transformed);
+            max = Vector3::Max(max, transformed);
+        }
+
+        AABB transformed = matrix * bound;
+        for (uint32 axis = 0; axis < 3; axis++)
+        {
+            ASSERT_NEAR(transformed.Min[axis], min[axis], 1e-3f);
+            ASSERT_NEAR(transformed.Max[axis], max[axis], 1e-3f);
+        }
+    }
+}
+
+TEST(MathLib, FrustumContainsTest)
+{
+    std::mt19937 rng(9);
+    std::uniform_real_distribution<float> position(-150, 150);
+    std::uniform_real_distribution<float> extent(0.1f, 20);
+
+    FrustumVolume frustum = FrustumVolume::FromMatrix(ProjectionMatrix1(Deg2Rad * 60.0f, 16.0f / 9.0f, 0.1f, 100.0f));
+
+    AABBSoA bounds;
+    bounds.Resize(1000);
+    for (uint32 i = 0; i < bounds.Size(); i++)
+    {
+        Vector3 center(position(rng), position(rng), position(rng));
+        Vector3 half_size(extent(rng), extent(rng), extent(rng));
+        bounds.Set(i, AABB(center - half_size, center + half_size));
+    }
+
+    uint32 num_visible = 0;
+    for (uint32 begin = 0; begin < bounds.Size(); begin += AABBSoA::Stride)
+    {
+        uint32 inside_mask;
+        uint32 visible_mask = frustum.Contains8(bounds, begin, inside_mask);
+        for (uint32 i = begin; i < std::min(begin + AABBSoA::Stride, bounds.Size()); i++)
+        {
+            bool visible = frustum.Contains(bounds.Get(i));
+            ASSERT_EQ(visible, (visible_mask >> (i - begin) & 1) != 0) << "at " << i;
+            num_visible += visible;
+        }
+    }
+
+    ASSERT_GT(num_visible, 0u);
+    ASSERT_LT(num_visible, bounds.Size());
+}
+
+// the thread_local staging buffer round trip that @VectorOperation and @MatrixOperation used to do
+static float* StagingBuffer()
+{
+    static thread_local struct alignas(16) {
+        float m[4];
+    } staging;
+
+    return staging.m;
+}
+
+static Vector4 StagingTransform(const Matrix4x4& matrix, const Vector4& vec)
+{
+    Vector4 ret;
+    for (uint32 r = 0; r < 4; r++)
+    {
+        __m128 dp = _mm_dp_ps(_mm_load_ps(&matrix.At(r, 0)), _mm_load_ps(&vec.x), 0xF1);
+        float* staging = StagingBuffer();
+        _mm_store_ps(staging, dp);
+        ret.At(r) = staging[0];
+    }
+    return ret;
+}
+
+static Matrix4x4 StagingMultiply(const Matrix4x4& lhs, const Matrix4x4& rhs)
+{
+    Matrix4x4 ret;
+    for (uint32 r = 0; r < 4; r++)
+    {
+        for (uint32 c = 0; c < 4; c++)
+        {
+            float* staging = StagingBuffer();
+            for (uint32 i = 0; i < 4; i++)
+            {
+                staging[i] = rhs.At(i, c);
+            }
+            __m128 dp = _mm_dp_ps(_mm_load_ps(&lhs.At(r, 0)), _mm_load_ps(staging), 0xF1);
+            _mm_store_ps(staging, dp);
+            ret.At(r, c) = staging[0];
+        }
+    }
+    return ret;
+}
+
+static Vector3 StagingVector3(const Vector3& vec, float scale)
+{
+    float* staging = StagingBuffer();
+    memcpy(staging, &vec, sizeof(Vector3));
+    __m128 m = _mm_mul_ps(_mm_load_ps(staging), _mm_set1_ps(scale));
+    _mm_store_ps(staging, m);
+
+    return Vector3(staging[0], staging[1], staging[2]);
+}
+
+// the min / max corner transform and the per plane frustum test before @Vec4f
+static AABB StagingAABBTransform(const Matrix4x4& matrix, const AABB& bound)
+{
+    Vector3 min = StagingTransform(matrix, Vector4(bound.Min, 1));
+    Vector3 max = StagingTransform(matrix, Vector4(bound.Max, 1));
+    return AABB(Vector3::Min(min, max), Vector3::Max(min, max));
+}
+
+static bool StagingContains(const FrustumVolume& frustum, const AABB& bound)
+{
+    Vector3 center = StagingVector3(bound.Min + bound.Max, 0.5f);
+    Vector3 extent = StagingVector3(bound.Max - bound.Min, 0.5f);
+    for (uint32 i = 0; i < 6; i++)
+    {
+        const Vector4& plane = frustum.Planes[i];
+        float half_diagnoal_projection = abs(plane.x * extent.x) + abs(plane.y * extent.y) + abs(plane.z * extent.z);
+
+        Vector4 point(center, 1);
+        __m128 dp = _mm_dp_ps(_mm_load_ps(&plane.x), _mm_load_ps(&point.x), 0xF1);
+        float* staging = StagingBuffer();
+        _mm_store_ps(staging, dp);
+        if (staging[0] < -half_diagnoal_projection)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+TEST(MathLib, Vec4fBenchmark)
+{
+    using Clock = std::chrono::high_resolution_clock;
+
+    constexpr uint32 NumItems = 100000;
+    constexpr uint32 NumRounds = 5;
+
+    std::mt19937 rng(10);
+    std::uniform_real_distribution<float> value(-100, 100);
+
+    std::vector<Matrix4x4> matrices(NumItems), output(NumItems);
+    std::vector<Vector4> vectors(NumItems), transformed_vectors(NumItems);
+    std::vector<AABB> bounds(NumItems), transformed_bounds(NumItems);
+    for (uint32 i = 0; i < NumItems; i++)
+    {
+        matrices[i] = RandomTRSMatrix(rng);
+        vectors[i] = Vector4(value(rng), value(rng), value(rng), 1);
+        Vector3 center(value(rng), value(rng), value(rng));
+        bounds[i] = AABB(center - Vector3(1, 2, 3), center + Vector3(3, 2, 1));
+    }
+    Matrix4x4 transform = RandomTRSMatrix(rng);
+    FrustumVolume frustum = FrustumVolume::FromMatrix(ProjectionMatrix1(Deg2Rad * 60.0f, 16.0f / 9.0f, 0.1f, 100.0f));
+    std::vector<uint8> visible(NumItems);
+
+    auto measure = [&](const char* name, auto&& func)
+    {
+        double best = std::numeric_limits<double>::max();
+        for (uint32 round = 0; round < NumRounds; round++)
+        {
+            auto begin = Clock::now();
+            func();
+            best = std::min(best, std::chrono::duration<double, std::nano>(Clock::now() - begin).count());
+        }
+
+        std::cout << std::setw(28) << std::left << name << std::setw(10) << std::right << std::fixed << std::setprecision(2) << best / NumItems << " ns/item\n";
+        return best;
+    };
+
+    double staging_vector = measure("staging Matrix4x4 * Vector4", [&]() { for (uint32 i = 0; i < NumItems; i++) transformed_vectors[i] = StagingTransform(transform, vectors[i]); });
+    double vector = measure("Matrix4x4 * Vector4", [&]() { for (uint32 i = 0; i < NumItems; i++) transformed_vectors[i] = transform * vectors[i]; });
+    double staging_matrix = measure("staging Matrix4x4 * Matrix4x4", [&]() { for (uint32 i = 0; i < NumItems; i++) output[i] = StagingMultiply(transform, matrices[i]); });
+    double matrix = measure("Matrix4x4 * Matrix4x4", [&]() { for (uint32 i = 0; i < NumItems; i++) output[i] = transform * matrices[i]; });
+    double staging_bound = measure("staging Matrix4x4 * AABB", [&]() { for (uint32 i = 0; i < NumItems; i++) transformed_bounds[i] = StagingAABBTransform(matrices[i], bounds[i]); });
+    double bound = measure("Matrix4x4 * AABB", [&]() { for (uint32 i = 0; i < NumItems; i++) transformed_bounds[i] = matrices[i] * bounds[i]; });
+    double staging_contains = measure("staging Contains(AABB)", [&]() { for (uint32 i = 0; i < NumItems; i++) visible[i] = StagingContains(frustum, bounds[i]); });
+    double contains = measure("FrustumVolume::Contains", [&]() { for (uint32 i = 0; i < NumItems; i++) visible[i] = frustum.Contains(bounds[i]); });
+
+    EXPECT_LT(vector, staging_vector);
+    EXPECT_LT(matrix, staging_matrix);
+    EXPECT_LT(bound, staging_bound);
+    EXPECT_LT(contains, staging_contains);
+}
@@ -0,0 +1,404 @@
+#include "gtest/gtest.h"
+#include "Resource/MeshOptimizer.h"
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <map>
+#include <cstring>
+
+using namespace MRenderer;
+
+// triangle list of a grid of quads without any vertex sharing, like the output of the obj importer.
+// the tangents are per face, tilted alternately so that their average is along the x axis
+static std::vector<StandardVertex> GridTriangleList(uint32 size, float spacing = 1.0f)
+{
+    std::vector<StandardVertex> vertices;
+    vertices.reserve(size * size * 6);
+
+    auto corner = [&](uint32 x, uint32 y, float tilt)
+    {
+        StandardVertex vertex;
+        vertex.Position = Vector3(x * spacing, y * spacing, 0);
+        vertex.Normal = Vector3(0, 0, 1);
+        vertex.Tangent = Vector3(1, tilt, 0).GetNormalized();
+        vertex.Color = Vector3(1, 1, 1);
+        vertex.TexCoord0 = Vector2(static_cast<float>(x) / size, static_cast<float>(y) / size);
+        vertices.push_back(vertex);
+    };
+
+    for (uint32 y = 0; y < size; y++)
+    {
+        for (uint32 x = 0; x < size; x++)
+        {
+            corner(x, y, 0.5f); corner(x + 1, y, 0.5f); corner(x + 1, y + 1, 0.5f);
+            corner(x, y, -0.5f); corner(x + 1, y + 1, -0.5f); corner(x, y + 1, -0.5f);
+        }
+    }
+    return vertices;
+}
+
+static void ExpectSameVertex(const StandardVertex& a, const StandardVertex& b, float tolerance)
+{
+    ASSERT_NEAR(a.Position.x, b.Position.x, tolerance);
+    ASSERT_NEAR(a.Position.y, b.Position.y, tolerance);
+    ASSERT_NEAR(a.Position.z, b.Position.z, tolerance);
+    ASSERT_NEAR(a.Normal.x, b.Normal.x, tolerance);
+    ASSERT_NEAR(a.Normal.y, b.Normal.y, tolerance);
+    ASSERT_NEAR(a.Normal.z, b.Normal.z, tolerance);
+    ASSERT_NEAR(a.TexCoord0.x, b.TexCoord0.x, tolerance);
+    ASSERT_NEAR(a.TexCoord0.y, b.TexCoord0.y, tolerance);
+}
+
+TEST(MeshOptimizerTest, WeldGridTest)
+{
+    // big enough to be split into several jobs
+    constexpr uint32 Size = 128;
+    std::vector<StandardVertex> vertices = GridTriangleList(Size);
+    ASSERT_GT(vertices.size(), 4 * MeshOptimizer::MinVerticesPerJob);
+
+    std::vector<StandardVertex> welded;
+    std::vector<uint32> indices;
+    MeshOptimizer::WeldVertices(vertices, WeldTolerance(), welded, indices);
+
+    ASSERT_EQ(welded.size(), (Size + 1) * (Size + 1));
+    ASSERT_EQ(indices.size(), vertices.size());
+
+    for (uint32 i = 0; i < indices.size(); i++)
+    {
+        ASSERT_LT(indices[i], welded.size());
+        ExpectSameVertex(welded[indices[i]], vertices[i], 1e-6f);
+    }
+
+    // welded vertices are in the order of their first occurrence
+    for (uint32 i = 0, next = 0; i < indices.size(); i++)
+    {
+        ASSERT_LE(indices[i], next);
+        next += indices[i] == next;
+    }
+
+    // the corners shared by both tilts are averaged to the x axis, the bottom right corner only has one tilt
+    for (uint32 i = 0; i < indices.size(); i++)
+    {
+        const StandardVertex& vertex = welded[indices[i]];
+        ASSERT_NEAR(vertex.Tangent.Dot(vertex.Normal), 0, 1e-6f);
+        ASSERT_NEAR(vertex.Tangent.Length(), 1, 1e-5f);
+    }
+    ASSERT_NEAR(welded[indices[0]].Tangent.x, 1, 1e-5f);
+    ASSERT_NEAR(welded[indices[(Size - 1) * 6 + 1]].Tangent.y, Vector3(1, 0.5f, 0).GetNormalized().y, 1e-5f);
+}
+
+TEST(MeshOptimizerTest, ToleranceTest)
+{
+    std::vector<StandardVertex> vertices = GridTriangleList(4, 0.5f);
+
+    // jitter within the tolerance is welded
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> jitter(-1e-4f, 1e-4f);
+    for (StandardVertex& vertex : vertices)
+    {
+        vertex.Position = vertex.Position + Vector3(jitter(rng), jitter(rng), jitter(rng));
+    }
+
+    // align the grid so that the jittered positions don't straddle a cell boundary
+    WeldTolerance tolerance;
+    tolerance.Position = 0.25f;
+
+    std::vector<StandardVertex> welded;
+    std::vector<uint32> indices;
+    MeshOptimizer::WeldVertices(vertices, tolerance, welded, indices);
+    ASSERT_EQ(welded.size(), 25u);
+
+    // but not with a tight tolerance
+    tolerance.Position = 1e-6f;
+    MeshOptimizer::WeldVertices(vertices, tolerance, welded, indices);
+    ASSERT_EQ(welded.size(), vertices.size());
+
+    // vertices with the same position but different texture coordinates or normals stay apart
+    vertices = GridTriangleList(4);
+    vertices[1].TexCoord0.x += 0.1f;
+    vertices[2].Normal = Vector3(0, 1, 0);
+    MeshOptimizer::WeldVertices(vertices, WeldTolerance(), welded, indices);
+    ASSERT_EQ(welded.size(), 27u);
+    ExpectSameVertex(welded[indices[1]], vertices[1], 0);
+    ExpectSameVertex(welded[indices[2]], vertices[2], 0);
+
+    // empty mesh
+    MeshOptimizer::WeldVertices({}, WeldTolerance(), welded, indices);
+    ASSERT_TRUE(welded.empty());
+    ASSERT_TRUE(indices.empty());
+}
+
+// indexed grid with the triangles shuffled, like a mesh without any locality
+static void ShuffledGrid(uint32 size, std::mt19937& rng, std::vector<StandardVertex>& vertices, std::vector<uint32>& indices)
+{
+    std::vector<StandardVertex> triangle_list = GridTriangleList(size);
+    MeshOptimizer::WeldVertices(triangle_list, WeldTolerance(), vertices, indices);
+
+    std::vector<std::array<uint32, 3>> triangles(indices.size() / 3);
+    std::memcpy(triangles.data(), indices.data(), indices.size() * sizeof(uint32));
+    std::shuffle(triangles.begin(), triangles.end(), rng);
+    std::memcpy(indices.data(), triangles.data(), indices.size() * sizeof(uint32));
+}
+
+// the triangles of @indices, sorted, the corners are kept in order so that the winding is checked as well
+static std::vector<std::array<uint32, 3>> SortedTriangles(std::span<const uint32> indices)
+{
+    std::vector<std::array<uint32, 3>> triangles(indices.size() / 3);
+    std::memcpy(triangles.data(), indices.data(), indices.size() * sizeof(uint32));
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+
+TEST(MeshOptimizerTest, AnalyzeVertexCacheTest)
+{
+    // 2 triangles sharing an edge
+    std::vector<uint32> indices = { 0, 1, 2, 2, 1, 3 };
+    VertexCacheStatistics statistics = MeshOptimizer::AnalyzeVertexCache(indices);
+    ASSERT_EQ(statistics.NumTransformed, 4u);
+    ASSERT_FLOAT_EQ(statistics.ACMR, 2.0f);
+    ASSERT_FLOAT_EQ(statistics.ATVR, 1.0f);
+
+    // with a cache of 3 vertices, vertex 0 is evicted by vertex 3
+    indices = { 0, 1, 2, 1, 2, 3, 0, 1, 3 };
+    statistics = MeshOptimizer::AnalyzeVertexCache(indices, 3);
+    ASSERT_EQ(statistics.NumTransformed, 6u);
+    ASSERT_FLOAT_EQ(statistics.ATVR, 6.0f / 4.0f);
+
+    // the ratios don't depend on the offset of the vertices
+    for (uint32& index : indices)
+    {
+        index += 1000;
+    }
+    ASSERT_EQ(MeshOptimizer::AnalyzeVertexCache(indices, 3).NumTransformed, 6u);
+}
+
+TEST(MeshOptimizerTest, OptimizeVertexCacheTest)
+{
+    std::mt19937 rng(1);
+    std::vector<StandardVertex> vertices;
+    std::vector<uint32> indices;
+    ShuffledGrid(64, rng, vertices, indices);
+
+    auto expected_triangles = SortedTriangles(indices);
+    VertexCacheStatistics before = MeshOptimizer::AnalyzeVertexCache(indices);
+
+    MeshOptimizer::OptimizeVertexCache(indices);
+    VertexCacheStatistics after = MeshOptimizer::AnalyzeVertexCache(indices);
+    ASSERT_EQ(SortedTriangles(indices), expected_triangles);
+
+    std::cout << "ACMR " << before.ACMR << " -> " << after.ACMR << ", ATVR " << before.ATVR << " -> " << after.ATVR << "\n";
+
+    // a shuffled grid misses almost every vertex, the optimized one is close to the 0.5 of an infinite grid
+    ASSERT_GT(before.ACMR, 2.0f);
+    ASSERT_LT(after.ACMR, 0.8f);
+    ASSERT_LT(after.ATVR, 1.6f);
+}
+
+// closed cube made of gridded faces with the triangles facing outwards
+static void AddCube(float half_size, std::vector<StandardVertex>& vertices, std::vector<uint32>& indices)
+{
+    constexpr uint32 Size = 16;
+    for (uint32 face = 0; face < 6; face++)
+    {
+        uint32 axis = face / 2;
+        float side = face % 2 ? half_size : -half_size;
+        uint32 base = static_cast<uint32>(vertices.size());
+        for (uint32 y = 0; y <= Size; y++)
+        {
+            for (uint32 x = 0; x <= Size; x++)
+            {
+                float p[3];
+                p[axis] = side;
+                p[(axis + 1) % 3] = half_size * (2.0f * x / Size - 1);
+                p[(axis + 2) % 3] = half_size * (2.0f * y / Size - 1);
+
+                StandardVertex vertex;
+                vertex.Position = Vector3(p[0], p[1], p[2]);
+                vertices.push_back(vertex);
+            }
+        }
+
+        for (uint32 y = 0; y < Size; y++)
+        {
+            for (uint32 x = 0; x < Size; x++)
+            {
+                uint32 v = base + y * (Size + 1) + x;
+                std::array<uint32, 6> quad = side > 0 ? std::array<uint32, 6>{ v, v + 1, v + Size + 2, v, v + Size + 2, v + Size + 1 } : std::array<uint32, 6>{ v, v + Size + 2, v + 1, v, v + Size + 1, v + Size + 2 };
+                indices.insert(indices.end(), quad.begin(), quad.end());
+            }
+        }
+    }
+}
+
+TEST(MeshOptimizerTest, OptimizeOverdrawTest)
+{
+    // a cube inside another one, the inner cube is drawn first in the input order
+    std::vector<StandardVertex> vertices;
+    std::vector<uint32> indices;
+    AddCube(0.5f, vertices, indices);
+    uint32 num_inner_vertices = static_cast<uint32>(vertices.size());
+    AddCube(1.0f, vertices, indices);
+
+    for (uint32 t = 0; t < indices.size() / 3; t++)
+    {
+        Vec4f p0 = vertices[indices[t * 3]].Position.ToVec4f(), p1 = vertices[indices[t * 3 + 1]].Position.ToVec4f(), p2 = vertices[indices[t * 3 + 2]].Position.ToVec4f();
+        ASSERT_GT((p1 - p0).Cross3(p2 - p0).Dot3(p0).X(), 0) << "triangle " << t << " faces inwards";
+    }
+
+    MeshOptimizer::OptimizeVertexCache(indices);
+    auto expected_triangles = SortedTriangles(indices);
+    VertexCacheStatistics cache_optimized = MeshOptimizer::AnalyzeVertexCache(indices);
+
+    MeshOptimizer::OptimizeOverdraw(indices, vertices);
+    VertexCacheStatistics overdraw_optimized = MeshOptimizer::AnalyzeVertexCache(indices);
+    ASSERT_EQ(SortedTriangles(indices), expected_triangles);
+
+    std::cout << "ACMR " << cache_optimized.ACMR << " -> " << overdraw_optimized.ACMR << "\n";
+    ASSERT_LT(overdraw_optimized.ACMR, cache_optimized.ACMR * 1.2f);
+
+    // the outer cube occludes the inner one from any view outside, all of its triangles are drawn first
+    uint32 num_outer_indices = static_cast<uint32>(indices.size() / 2);
+    for (uint32 i = 0; i < indices.size(); i++)
+    {
+        ASSERT_EQ(indices[i] >= num_inner_vertices, i < num_outer_indices) << "at index " << i;
+    }
+}
+
+TEST(MeshOptimizerTest, OptimizeMeshTest)
+{
+    std::mt19937 rng(2);
+    std::vector<StandardVertex> vertices;
+    std::vector<uint32> indices;
+    ShuffledGrid(32, rng, vertices, indices);
+
+    // the sub meshes are the lower and upper half of the grid
+    std::vector<std::array<uint32, 3>> triangles(indices.size() / 3);
+    std::memcpy(triangles.data(), indices.data(), indices.size() * sizeof(uint32));
+    auto upper = std::stable_partition(triangles.begin(), triangles.end(), [&vertices](const std::array<uint32, 3>& triangle) { return vertices[triangle[0]].Position.y < 16; });
+    std::memcpy(indices.data(), triangles.data(), indices.size() * sizeof(uint32));
+
+    std::vector<StandardVertex> original_vertices = vertices;
+    std::vector<uint32> original_indices = indices;
+
+    uint32 split = static_cast<uint32>(upper - triangles.begin()) * 3;
+    std::vector<SubMeshData> sub_meshes = { SubMeshData{ 0, split }, SubMeshData{ split, static_cast<uint32>(indices.size()) - split } };
+    MeshOptimizer::OptimizeMesh(vertices, indices, sub_meshes);
+
+    // each sub mesh keeps its triangles, the vertices are mapped back to the original ones by their unique positions
+    auto vertex_key = [](const StandardVertex& vertex) { return std::make_pair(vertex.Position.x, vertex.Position.y); };
+    std::map<std::pair<float, float>, uint32> original_vertex;
+    for (uint32 i = 0; i < original_vertices.size(); i++)
+    {
+        original_vertex[vertex_key(original_vertices[i])] = i;
+    }
+    ASSERT_EQ(original_vertex.size(), original_vertices.size());
+
+    for (const SubMeshData& sub_mesh : sub_meshes)
+    {
+        std::vector<uint32> range(indices.begin() + sub_mesh.Index, indices.begin() + sub_mesh.Index + sub_mesh.IndicesCount);
+        for (uint32& index : range)
+        {
+            index = original_vertex[vertex_key(vertices[index])];
+        }
+        ASSERT_EQ(SortedTriangles(range), SortedTriangles(std::span<const uint32>(original_indices.data() + sub_mesh.Index, sub_mesh.IndicesCount)));
+    }
+
+    // vertices are in the order of their first reference
+    ASSERT_EQ(vertices.size(), original_vertices.size());
+    for (uint32 i = 0, next = 0; i < indices.size(); i++)
+    {
+        ASSERT_LE(indices[i], next);
+        next += indices[i] == next;
+    }
+
+    ASSERT_LT(MeshOptimizer::AnalyzeVertexCache(indices).ACMR, 0.8f);
+}
+
+TEST(MeshOptimizerTest, BuildMeshletsTest)
+{
+    std::mt19937 rng(3);
+    std::vector<StandardVertex> vertices;
+    std::vector<uint32> indices;
+    ShuffledGrid(64, rng, vertices, indices);
+
+    // bend the grid into a half cylinder so that the normal cones are not all the same
+    for (StandardVertex& vertex : vertices)
+    {
+        float angle = vertex.Position.x / 64 * PI;
+        vertex.Position = Vector3(std::cos(angle) * 20, vertex.Position.y, std::sin(angle) * 20);
+    }
+
+    // the sub meshes are the lower third and the rest of the grid
+    std::vector<std::array<uint32, 3>> triangles(indices.size() / 3);
+    std::memcpy(triangles.data(), indices.data(), indices.size() * sizeof(uint32));
+    auto upper = std::stable_partition(triangles.begin(), triangles.end(), [&vertices](const std::array<uint32, 3>& triangle) { return vertices[triangle[0]].Position.y < 21; });
+    std::memcpy(indices.data(), triangles.data(), indices.size() * sizeof(uint32));
+
+    uint32 split = static_cast<uint32>(upper - triangles.begin()) * 3;
+    std::vector<SubMeshData> sub_meshes = { SubMeshData{ 0, split }, SubMeshData{ split, static_cast<uint32>(indices.size()) - split } };
+    std::vector<MeshletData> meshlets;
+    MeshOptimizer::OptimizeMesh(vertices, indices, sub_meshes, &meshlets);
+
+    // the meshlets cover the index buffer in order without crossing the sub meshes
+    uint32 next_index = 0;
+    for (const MeshletData& meshlet : meshlets)
+    {
+        ASSERT_EQ(meshlet.Index, next_index);
+        ASSERT_TRUE(meshlet.Index >= split || meshlet.Index + meshlet.IndicesCount <= split);
+        next_index += meshlet.IndicesCount;
+
+        ASSERT_GT(meshlet.IndicesCount, 0u);
+        ASSERT_LE(meshlet.IndicesCount, MeshletData::MaxTriangles * 3);
+
+        std::vector<uint32> meshlet_vertices(indices.begin() + meshlet.Index, indices.begin() + meshlet.Index + meshlet.IndicesCount);
+        std::sort(meshlet_vertices.begin(), meshlet_vertices.end());
+        ASSERT_LE(std::unique(meshlet_vertices.begin(), meshlet_vertices.end()) - meshlet_vertices.begin(), MeshletData::MaxVertices);
+
+        // bounds contain the vertices, the normal cone contains the triangle normals
+        float cone_cos = std::sqrt(1 - meshlet.ConeCutoff * meshlet.ConeCutoff);
+        for (uint32 i = meshlet.Index; i < meshlet.Index + meshlet.IndicesCount; i += 3)
+        {
+            for (uint32 k = 0; k < 3; k++)
+            {
+                const Vector3& position = vertices[indices[i + k]].Position;
+                ASSERT_LE((position - meshlet.Center).Length(), meshlet.Radius * 1.0001f);
+                ASSERT_TRUE(meshlet.Bound.Min.x <= position.x && position.x <= meshlet.Bound.Max.x);
+                ASSERT_TRUE(meshlet.Bound.Min.z <= position.z && position.z <= meshlet.Bound.Max.z);
+            }
+
+            if (meshlet.ConeCutoff < 1)
+            {
+                Vec4f p0 = vertices[indices[i]].Position.ToVec4f();
+                Vec4f normal = (vertices[indices[i + 1]].Position.ToVec4f() - p0).Cross3(vertices[indices[i + 2]].Position.ToVec4f() - p0).Normalize3();
+                ASSERT_GE(normal.Dot3(meshlet.ConeAxis.ToVec4f()).X(), cone_cos - 1e-4f);
+            }
+        }
+    }
+    ASSERT_EQ(next_index, indices.size());
+
+    // most of the meshlets are full, a 7x7 patch of the grid has 64 vertices and 98 triangles
+    float triangles_per_meshlet = static_cast<float>(indices.size()) / 3 / meshlets.size();
+    std::cout << meshlets.size() << " meshlets, " << triangles_per_meshlet << " triangles per meshlet, ACMR " << MeshOptimizer::AnalyzeVertexCache(indices).ACMR << "\n";
+    ASSERT_GT(triangles_per_meshlet, 80);
+    ASSERT_LT(MeshOptimizer::AnalyzeVertexCache(indices).ACMR, 0.8f);
+}
+
+// six million vertices, too slow for the unit suite, run it with --gtest_also_run_disabled_tests
+TEST(MeshOptimizerTest, DISABLED_Benchmark)
+{
+    using Clock = std::chrono::high_resolution_clock;
+
+    constexpr uint32 Size = 1024;
+    std::vector<StandardVertex> vertices = GridTriangleList(Size);
+
+    std::vector<StandardVertex> welded;
+    std::vector<uint32> indices;
+    auto begin = Clock::now();
+    MeshOptimizer::WeldVertices(vertices, WeldTolerance(), welded, indices);
+    auto weld_time = Clock::now() - begin;
+
+    std::cout << vertices.size() << " -> " << welded.size() << " vertices, "
+        << std::chrono::duration<double, std::milli>(weld_time).count() << " ms\n";
+    ASSERT_EQ(welded.size(), (Size + 1) * (Size + 1));
+    ASSERT_EQ(indices.size(), vertices.size());
+}
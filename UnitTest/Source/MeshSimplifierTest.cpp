@@ -0,0 +1,265 @@
+#include "gtest/gtest.h"
+#include "Resource/MeshOptimizer.h"
+#include "Resource/MeshSimplifier.h"
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cstring>
+
+using namespace MRenderer;
+
+// welded grid of @size x @size quads in the xy plane, facing +z
+static void IndexedGrid(uint32 size, std::vector<StandardVertex>& vertices, std::vector<uint32>& indices)
+{
+    std::vector<StandardVertex> triangle_list;
+    auto corner = [&](uint32 x, uint32 y)
+    {
+        StandardVertex vertex{};
+        vertex.Position = Vector3(static_cast<float>(x), static_cast<float>(y), 0);
+        vertex.Normal = Vector3(0, 0, 1);
+        vertex.TexCoord0 = Vector2(static_cast<float>(x) / size, static_cast<float>(y) / size);
+        triangle_list.push_back(vertex);
+    };
+
+    for (uint32 y = 0; y < size; y++)
+    {
+        for (uint32 x = 0; x < size; x++)
+        {
+            corner(x, y); corner(x + 1, y); corner(x + 1, y + 1);
+            corner(x, y); corner(x + 1, y + 1); corner(x, y + 1);
+        }
+    }
+    MeshOptimizer::WeldVertices(triangle_list, WeldTolerance(), vertices, indices);
+}
+
+// welded unit sphere facing outwards, the first and the last slice share their positions but not their texture coordinates
+static void IndexedSphere(uint32 slices, uint32 stacks, std::vector<StandardVertex>& vertices, std::vector<uint32>& indices)
+{
+    std::vector<StandardVertex> triangle_list;
+    auto corner = [&](uint32 slice, uint32 stack)
+    {
+        StandardVertex vertex{};
+        vertex.Position = FromSphericalCoordinate(PI * stack / stacks, 2 * PI * (slice % slices) / slices);
+        vertex.Normal = vertex.Position;
+        vertex.TexCoord0 = Vector2(static_cast<float>(slice) / slices, static_cast<float>(stack) / stacks);
+        triangle_list.push_back(vertex);
+    };
+
+    for (uint32 stack = 0; stack < stacks; stack++)
+    {
+        for (uint32 slice = 0; slice < slices; slice++)
+        {
+            corner(slice, stack); corner(slice, stack + 1); corner(slice + 1, stack + 1);
+            corner(slice, stack); corner(slice + 1, stack + 1); corner(slice + 1, stack);
+        }
+    }
+    MeshOptimizer::WeldVertices(triangle_list, WeldTolerance(), vertices, indices);
+}
+
+static Vec4f TriangleNormal(const std::vector<StandardVertex>& vertices, const uint32* triangle)
+{
+    Vec4f p0 = vertices[triangle[0]].Position.ToVec4f();
+    return (vertices[triangle[1]].Position.ToVec4f() - p0).Cross3(vertices[triangle[2]].Position.ToVec4f() - p0);
+}
+
+static bool IsReferenced(std::span<const uint32> indices, uint32 vertex)
+{
+    return std::find(indices.begin(), indices.end(), vertex) != indices.end();
+}
+
+TEST(MeshSimplifierTest, FlatGridTest)
+{
+    std::vector<StandardVertex> vertices;
+    std::vector<uint32> indices;
+    IndexedGrid(32, vertices, indices);
+
+    uint32 target = static_cast<uint32>(indices.size() / 10 / 3 * 3);
+    std::vector<uint32> simplified;
+    float error = MeshSimplifier::Simplify(vertices, indices, target, FLT_MAX, simplified);
+    ASSERT_LE(simplified.size(), target);
+    ASSERT_GT(simplified.size(), 0u);
+    ASSERT_LT(error, 1e-3f);
+
+    // the border slides along itself, so the triangles still cover the grid exactly without folding over
+    float area = 0;
+    for (uint32 i = 0; i < simplified.size(); i += 3)
+    {
+        Vec4f normal = TriangleNormal(vertices, simplified.data() + i);
+        ASSERT_GT(normal.Z(), 0);
+        area += normal.Z() * 0.5f;
+    }
+    ASSERT_NEAR(area, 32.0f * 32.0f, 1e-2f);
+
+    // nothing to do
+    float no_error = MeshSimplifier::Simplify(vertices, indices, static_cast<uint32>(indices.size()), FLT_MAX, simplified);
+    ASSERT_EQ(no_error, 0);
+    ASSERT_EQ(simplified, indices);
+}
+
+TEST(MeshSimplifierTest, SphereTest)
+{
+    std::vector<StandardVertex> vertices;
+    std::vector<uint32> indices;
+    IndexedSphere(64, 32, vertices, indices);
+
+    // the vertices are offset to check that the indices don't need to start at 0
+    std::vector<StandardVertex> offset_vertices(100);
+    offset_vertices.insert(offset_vertices.end(), vertices.begin(), vertices.end());
+    for (uint32& index : indices)
+    {
+        index += 100;
+    }
+
+    uint32 target = static_cast<uint32>(indices.size() / 4 / 3 * 3);
+    std::vector<uint32> simplified;
+    float error = MeshSimplifier::Simplify(offset_vertices, indices, target, FLT_MAX, simplified);
+    ASSERT_LE(simplified.size(), target);
+    ASSERT_GT(error, 0);
+    ASSERT_LT(error, 0.05f);
+
+    // the triangles still face outwards and stay close to the sphere, the degenerate triangles at the poles come from the input
+    for (uint32 i = 0; i < simplified.size(); i += 3)
+    {
+        ASSERT_GE(*std::min_element(simplified.begin() + i, simplified.begin() + i + 3), 100u);
+
+        Vec4f centroid = (offset_vertices[simplified[i]].Position.ToVec4f() + offset_vertices[simplified[i + 1]].Position.ToVec4f() + offset_vertices[simplified[i + 2]].Position.ToVec4f()) * (1.0f / 3.0f);
+        Vec4f normal = TriangleNormal(offset_vertices, simplified.data() + i);
+        if (normal.Length3().X() > 1e-6f)
+        {
+            ASSERT_GT(normal.Normalize3().Dot3(centroid.Normalize3()).X(), 0);
+        }
+        ASSERT_GT(centroid.Length3().X(), 1 - 4 * error);
+    }
+
+    // the vertices of the texture seam are kept, the poles are left out since sin(PI) is not exactly 0
+    for (uint32 v = 100; v < offset_vertices.size(); v++)
+    {
+        const Vector2& uv = offset_vertices[v].TexCoord0;
+        if ((uv.x == 0 || uv.x == 1) && uv.y > 0 && uv.y < 1)
+        {
+            ASSERT_TRUE(IsReferenced(simplified, v));
+        }
+    }
+
+    // a small error limit stops the simplification early
+    std::vector<uint32> limited;
+    float limited_error = MeshSimplifier::Simplify(offset_vertices, indices, target, 1e-3f, limited);
+    ASSERT_GT(limited.size(), simplified.size());
+    ASSERT_LT(limited.size(), indices.size());
+    ASSERT_LE(limited_error, 1e-3f);
+}
+
+TEST(MeshSimplifierTest, BuildLodsTest)
+{
+    std::vector<StandardVertex> vertices;
+    std::vector<uint32> indices;
+    IndexedGrid(64, vertices, indices);
+
+    // bend the grid so that the simplification has an error, the sub meshes are the lower third and the rest of the grid
+    for (StandardVertex& vertex : vertices)
+    {
+        vertex.Position.z = std::sin(vertex.Position.x / 64 * PI) * 8;
+    }
+
+    std::vector<std::array<uint32, 3>> triangles(indices.size() / 3);
+    std::memcpy(triangles.data(), indices.data(), indices.size() * sizeof(uint32));
+    auto upper = std::stable_partition(triangles.begin(), triangles.end(), [&vertices](const std::array<uint32, 3>& triangle) { return vertices[triangle[0]].Position.y < 21; });
+    std::memcpy(indices.data(), triangles.data(), indices.size() * sizeof(uint32));
+
+    uint32 split = static_cast<uint32>(upper - triangles.begin()) * 3;
+    std::vector<SubMeshData> sub_meshes = { SubMeshData{ 0, split }, SubMeshData{ split, static_cast<uint32>(indices.size()) - split } };
+    std::vector<uint32> original_indices = indices;
+
+    MeshLodChunk lods;
+    MeshSimplifier::BuildLods(vertices, indices, sub_meshes, MeshSimplifier::DefaultLodRatios, lods);
+    ASSERT_EQ(lods.Lods.size(), MeshSimplifier::DefaultLodRatios.size());
+    ASSERT_EQ(lods.SubMeshes.size(), lods.Lods.size() * sub_meshes.size());
+
+    // the full resolution triangles are kept, the lods are appended after them
+    ASSERT_TRUE(std::equal(original_indices.begin(), original_indices.end(), indices.begin()));
+
+    uint32 next_index = static_cast<uint32>(original_indices.size());
+    uint32 previous_count = static_cast<uint32>(original_indices.size());
+    float previous_screen_size = 1;
+    for (uint32 lod = 0; lod < lods.Lods.size(); lod++)
+    {
+        uint32 lod_count = 0;
+        for (uint32 i = 0; i < sub_meshes.size(); i++)
+        {
+            const SubMeshData& sub_mesh = lods.SubMeshes[lod * sub_meshes.size() + i];
+            ASSERT_EQ(sub_mesh.Index, next_index);
+            ASSERT_LE(sub_mesh.IndicesCount, sub_meshes[i].IndicesCount * MeshSimplifier::DefaultLodRatios[lod] + 3);
+            next_index += sub_mesh.IndicesCount;
+            lod_count += sub_mesh.IndicesCount;
+
+            // the vertices between the sub meshes are kept on both sides, no crack opens
+            std::span<const uint32> lod_indices(indices.data() + sub_mesh.Index, sub_mesh.IndicesCount);
+            for (uint32 x = 0; x <= 64; x++)
+            {
+                auto seam_vertex = std::find_if(vertices.begin(), vertices.end(), [x](const StandardVertex& vertex) { return vertex.Position.x == x && vertex.Position.y == 21; });
+                ASSERT_TRUE(IsReferenced(lod_indices, static_cast<uint32>(seam_vertex - vertices.begin())));
+            }
+        }
+        ASSERT_LT(lod_count, previous_count);
+        previous_count = lod_count;
+
+        ASSERT_LE(lods.Lods[lod].ScreenSize, previous_screen_size);
+        ASSERT_LE(lods.Lods[lod].ScreenSize, MeshSimplifier::DefaultLodRatios[lod]);
+        previous_screen_size = lods.Lods[lod].ScreenSize;
+    }
+    ASSERT_EQ(next_index, indices.size());
+
+    // the lod gets coarser as the mesh gets smaller on screen
+    ASSERT_EQ(lods.SelectLod(1), 0u);
+    ASSERT_EQ(lods.SelectLod(0), lods.Lods.size());
+    for (uint32 lod = 0; lod < lods.Lods.size(); lod++)
+    {
+        ASSERT_EQ(lods.SelectLod(lods.Lods[lod].ScreenSize), lod);
+        ASSERT_EQ(lods.SelectLod(lods.Lods[lod].ScreenSize * 0.99f), lod + 1);
+    }
+
+    // serialization round trip, the meshes dumped before the lods end without the chunk
+    RingBuffer rb;
+    MeshLodChunk::BinarySerialize(rb, lods);
+
+    MeshLodChunk loaded;
+    MeshLodChunk::BinaryDeserialize(rb, loaded);
+    ASSERT_EQ(rb.Occupied(), 0u);
+    ASSERT_EQ(loaded.Lods.size(), lods.Lods.size());
+    ASSERT_EQ(loaded.SubMeshes.size(), lods.SubMeshes.size());
+    ASSERT_EQ(loaded.Lods.back().ScreenSize, lods.Lods.back().ScreenSize);
+    ASSERT_EQ(loaded.SubMeshes.back().Index, lods.SubMeshes.back().Index);
+
+    MeshLodChunk::BinaryDeserialize(rb, loaded);
+    ASSERT_TRUE(loaded.Lods.empty());
+}
+
+// a million triangles, too slow for the unit suite, run it with --gtest_also_run_disabled_tests
+TEST(MeshSimplifierTest, DISABLED_Benchmark)
+{
+    using Clock = std::chrono::high_resolution_clock;
+
+    std::vector<StandardVertex> vertices;
+    std::vector<uint32> indices;
+    IndexedSphere(1024, 512, vertices, indices);
+    std::vector<SubMeshData> sub_meshes = { SubMeshData::Whole(static_cast<uint32>(indices.size())) };
+
+    MeshLodChunk lods;
+    auto begin = Clock::now();
+    MeshSimplifier::BuildLods(vertices, indices, sub_meshes, MeshSimplifier::DefaultLodRatios, lods);
+    auto time = Clock::now() - begin;
+
+    std::cout << sub_meshes[0].IndicesCount / 3 << " triangles, " << lods.Lods.size() << " lods in " << std::chrono::duration<double, std::milli>(time).count() << " ms\n";
+    ASSERT_EQ(lods.Lods.size(), MeshSimplifier::DefaultLodRatios.size());
+
+    // each lod reaches its ratio, and a sphere this dense stays within a thousandth of its radius
+    float previous_error = 0;
+    for (uint32 lod = 0; lod < lods.Lods.size(); lod++)
+    {
+        std::cout << "    lod " << lod + 1 << ": " << lods.SubMeshes[lod].IndicesCount / 3 << " triangles, error " << lods.Lods[lod].Error << ", screen size " << lods.Lods[lod].ScreenSize << "\n";
+        EXPECT_LE(lods.SubMeshes[lod].IndicesCount, sub_meshes[0].IndicesCount * MeshSimplifier::DefaultLodRatios[lod] + 3);
+        EXPECT_GE(lods.Lods[lod].Error, previous_error);
+        EXPECT_LT(lods.Lods[lod].Error, 1e-3f);
+        previous_error = lods.Lods[lod].Error;
+    }
+}
@@ -0,0 +1,185 @@
+#include "gtest/gtest.h"
+#include "Resource/MeshOptimizer.h"
+#include "Utils/MeshletCulling.h"
+#include <random>
+#include <chrono>
+
+using namespace MRenderer;
+
+// unit sphere with the triangles facing outwards, welded, optimized and split into meshlets like an imported mesh
+static void SphereMesh(uint32 slices, uint32 stacks, std::vector<StandardVertex>& vertices, std::vector<uint32>& indices, std::vector<MeshletData>& meshlets)
+{
+    std::vector<StandardVertex> triangle_list;
+    auto corner = [&](uint32 slice, uint32 stack)
+    {
+        StandardVertex vertex{};
+        vertex.Position = FromSphericalCoordinate(PI * stack / stacks, 2 * PI * slice / slices);
+        vertex.Normal = vertex.Position;
+        vertex.TexCoord0 = Vector2(static_cast<float>(slice) / slices, static_cast<float>(stack) / stacks);
+        triangle_list.push_back(vertex);
+    };
+
+    for (uint32 stack = 0; stack < stacks; stack++)
+    {
+        for (uint32 slice = 0; slice < slices; slice++)
+        {
+            corner(slice, stack); corner(slice, stack + 1); corner(slice + 1, stack + 1);
+            corner(slice, stack); corner(slice + 1, stack + 1); corner(slice + 1, stack);
+        }
+    }
+
+    MeshOptimizer::WeldVertices(triangle_list, WeldTolerance(), vertices, indices);
+    std::vector<SubMeshData> sub_meshes = { SubMeshData::Whole(static_cast<uint32>(indices.size())) };
+    MeshOptimizer::OptimizeMesh(vertices, indices, sub_meshes, &meshlets);
+}
+
+// camera at @distance from the origin looking at a random direction near the origin, returns the camera position
+static Vector3 RandomCamera(std::mt19937& rng, float distance, FrustumVolume& out_frustum)
+{
+    std::uniform_real_distribution<float> angle(0, 2 * PI);
+    std::uniform_real_distribution<float> offset(-0.5f, 0.5f);
+
+    Matrix4x4 projection = ProjectionMatrix1(Deg2Rad * 60.0f, 16.0f / 9.0f, 0.1f, 100.0f);
+    Matrix4x4 view = Matrix4x4::Identity();
+    view.SetRotation(angle(rng), angle(rng), angle(rng));
+    view.SetTranslation(Vector3(offset(rng), offset(rng), distance));
+
+    out_frustum = FrustumVolume::FromMatrix(projection * view);
+    return view.Inverse().GetTranslation();
+}
+
+static bool IsTriangleVisible(const Vector3& p0, const Vector3& p1, const Vector3& p2, const FrustumVolume& frustum, const Vector3& camera)
+{
+    Vec4f a = p0.ToVec4f(), b = p1.ToVec4f(), c = p2.ToVec4f();
+    Vec4f normal = (b - a).Cross3(c - a);
+    bool front_facing = normal.Dot3(camera.ToVec4f() - a).X() > 0;
+    return front_facing && (frustum.Contains(p0) || frustum.Contains(p1) || frustum.Contains(p2));
+}
+
+TEST(MeshletCulling, ConservativeTest)
+{
+    std::vector<StandardVertex> vertices;
+    std::vector<uint32> indices;
+    std::vector<MeshletData> meshlets;
+    SphereMesh(64, 32, vertices, indices, meshlets);
+
+    std::mt19937 rng(1);
+    for (uint32 round = 0; round < 50; round++)
+    {
+        // from far away the whole sphere is in the frustum, close to it only a part is
+        FrustumVolume frustum;
+        Vector3 camera = RandomCamera(rng, round % 2 ? 5.0f : 1.5f, frustum);
+        MeshletCulling culling(frustum, camera);
+
+        MeshletCullStatus status;
+        std::vector<SubMeshData> ranges;
+        culling.Cull(meshlets, SubMeshData::Whole(static_cast<uint32>(indices.size())), ranges, status);
+        ASSERT_EQ(status.NumMeshlets, meshlets.size());
+        ASSERT_EQ(status.NumRanges, ranges.size());
+
+        // the ranges are the visible meshlets, merged when they are adjacent
+        std::vector<bool> drawn(indices.size() / 3, false);
+        uint32 num_indices = 0;
+        for (uint32 i = 0; i < ranges.size(); i++)
+        {
+            ASSERT_TRUE(i == 0 || ranges[i].Index > ranges[i - 1].Index + ranges[i - 1].IndicesCount);
+            std::fill(drawn.begin() + ranges[i].Index / 3, drawn.begin() + (ranges[i].Index + ranges[i].IndicesCount) / 3, true);
+            num_indices += ranges[i].IndicesCount;
+        }
+        ASSERT_EQ(num_indices, status.NumIndices);
+
+        // no visible triangle is culled
+        for (uint32 t = 0; t < drawn.size(); t++)
+        {
+            if (!drawn[t])
+            {
+                ASSERT_FALSE(IsTriangleVisible(vertices[indices[t * 3]].Position, vertices[indices[t * 3 + 1]].Position, vertices[indices[t * 3 + 2]].Position, frustum, camera))
+                    << "triangle " << t << " in round " << round;
+            }
+        }
+
+        // half of the sphere faces away from the camera, the meshlets near the silhouette can't be culled by their cones
+        if (round % 2)
+        {
+            ASSERT_GT(status.NumBackfaceCulled, meshlets.size() / 8) << "in round " << round;
+        }
+    }
+}
+
+TEST(MeshletCulling, SerializationTest)
+{
+    MeshletChunk chunk;
+    chunk.Meshlets.resize(3);
+    for (uint32 i = 0; i < 3; i++)
+    {
+        chunk.Meshlets[i].Index = i * 30;
+        chunk.Meshlets[i].IndicesCount = 30;
+        chunk.Meshlets[i].Radius = static_cast<float>(i);
+        chunk.Meshlets[i].ConeCutoff = 0.5f;
+    }
+
+    RingBuffer rb;
+    MeshletChunk::BinarySerialize(rb, chunk);
+
+    MeshletChunk loaded;
+    MeshletChunk::BinaryDeserialize(rb, loaded);
+    ASSERT_EQ(rb.Occupied(), 0u);
+    ASSERT_EQ(loaded.Meshlets.size(), 3u);
+    for (uint32 i = 0; i < 3; i++)
+    {
+        ASSERT_EQ(loaded.Meshlets[i].Index, i * 30);
+        ASSERT_EQ(loaded.Meshlets[i].Radius, static_cast<float>(i));
+        ASSERT_EQ(loaded.Meshlets[i].ConeCutoff, 0.5f);
+    }
+
+    // meshes dumped before the meshlets end without the chunk
+    MeshletChunk::BinaryDeserialize(rb, loaded);
+    ASSERT_TRUE(loaded.Meshlets.empty());
+}
+
+// the cones and the frustum leave a small part of a sphere seen from outside to draw, each round is timed
+TEST(MeshletCulling, CullRateTest)
+{
+    using Clock = std::chrono::high_resolution_clock;
+
+    std::vector<StandardVertex> vertices;
+    std::vector<uint32> indices;
+    std::vector<MeshletData> meshlets;
+    SphereMesh(256, 128, vertices, indices, meshlets);
+
+    constexpr uint32 NumRounds = 100;
+    std::mt19937 rng(2);
+    uint64 num_indices = 0;
+    std::vector<SubMeshData> ranges;
+    Clock::duration cull_time{};
+    for (uint32 round = 0; round < NumRounds; round++)
+    {
+        FrustumVolume frustum;
+        Vector3 camera = RandomCamera(rng, 1.5f, frustum);
+        MeshletCulling culling(frustum, camera);
+
+        auto begin = Clock::now();
+        MeshletCullStatus status;
+        ranges.clear();
+        culling.Cull(meshlets, SubMeshData::Whole(static_cast<uint32>(indices.size())), ranges, status);
+        cull_time += Clock::now() - begin;
+
+        uint32 range_indices = 0;
+        for (const SubMeshData& range : ranges)
+        {
+            range_indices += range.IndicesCount;
+        }
+        ASSERT_EQ(status.NumMeshlets, meshlets.size());
+        ASSERT_EQ(status.NumRanges, ranges.size());
+        ASSERT_EQ(status.NumIndices, range_indices);
+
+        num_indices += status.NumIndices;
+    }
+
+    // from 1.5 radii away a sixth of the sphere faces the camera, the cones are conservative but less than a quarter is left to draw
+    double drawn = static_cast<double>(num_indices) / NumRounds / indices.size();
+    std::cout << indices.size() / 3 << " triangles, " << meshlets.size() << " meshlets, "
+        << std::chrono::duration<double, std::milli>(cull_time).count() / NumRounds << " ms per cull, "
+        << 100.0 * drawn << "% of the triangles drawn\n";
+    EXPECT_LT(drawn, 0.25);
+}
@@ -0,0 +1,215 @@
+#include "gtest/gtest.h"
+#include "Resource/MipGenerator.h"
+#include "Utils/MathLib.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+using namespace MRenderer;
+
+namespace
+{
+    template<typename T>
+    std::vector<T> FlatChain(uint32 width, uint32 height, uint32 mip_levels, const T* pixel, uint32 num_channels)
+    {
+        std::vector<T> chain(CalculateTextureSize(width, height, mip_levels, num_channels));
+        for (uint32 i = 0; i < width * height; i++)
+        {
+            memcpy(chain.data() + i * num_channels, pixel, num_channels * sizeof(T));
+        }
+        return chain;
+    }
+}
+
+TEST(MipGeneratorTest, BoxTest)
+{
+    // each texel of the mips is the average of the 2x2 texels above it
+    const uint8 mip_0[16] =
+    {
+        0, 4, 10, 20,
+        8, 12, 30, 40,
+        100, 100, 7, 9,
+        200, 200, 11, 13,
+    };
+
+    std::vector<uint8> chain(CalculateTextureSize(4, 4, 3, 1));
+    memcpy(chain.data(), mip_0, sizeof(mip_0));
+    MipGenerator::Generate(chain.data(), 4, 4, 3, ETextureFormat_R8_UNORM, EMipFilter_Box, false);
+
+    const uint8 expected[5] = { 6, 25, 150, 10, 48 };
+    for (uint32 i = 0; i < 5; i++)
+    {
+        EXPECT_EQ(chain[16 + i], expected[i]) << i;
+    }
+}
+
+TEST(MipGeneratorTest, FlatTest)
+{
+    // the filters are normalized, so a flat texture stays flat in every mip whatever the format
+    constexpr uint32 Width = 32;
+    constexpr uint32 Height = 16;
+    constexpr uint32 MipLevels = 5;
+
+    for (uint32 filter = 0; filter < EMipFilter_Count; filter++)
+    {
+        EMipFilter mip_filter = static_cast<EMipFilter>(filter);
+        for (bool srgb : { false, true })
+        {
+            const uint8 color[4] = { 17, 128, 250, 77 };
+            for (ETextureFormat format : { ETextureFormat_R8G8B8A8_UNORM, ETextureFormat_R8G8_UNORM, ETextureFormat_R8_UNORM })
+            {
+                uint32 num_channels = GetChannelCount(format);
+                std::vector<uint8> chain = FlatChain(Width, Height, MipLevels, color, num_channels);
+                MipGenerator::Generate(chain.data(), Width, Height, MipLevels, format, mip_filter, srgb);
+                for (uint32 i = 0; i < chain.size(); i++)
+                {
+                    ASSERT_EQ(chain[i], color[i % num_channels]) << GetMipFilterName(mip_filter) << " " << srgb << " " << i;
+                }
+            }
+        }
+
+        const uint16 half_color[4] = { FloatToHalf(0.25f), FloatToHalf(3.5f), FloatToHalf(1000.0f), FloatToHalf(1.0f) };
+        std::vector<uint16> half_chain = FlatChain(Width, Height, MipLevels, half_color, 4);
+        MipGenerator::Generate(half_chain.data(), Width, Height, MipLevels, ETextureFormat_R16G16B16A16_FLOAT, mip_filter, false);
+        for (uint32 i = 0; i < half_chain.size(); i++)
+        {
+            ASSERT_EQ(half_chain[i], half_color[i % 4]) << GetMipFilterName(mip_filter) << " " << i;
+        }
+
+        const float float_color[4] = { 0.25f, 3.5f, 1000.0f, 1.0f };
+        std::vector<float> float_chain = FlatChain(Width, Height, MipLevels, float_color, 4);
+        MipGenerator::Generate(float_chain.data(), Width, Height, MipLevels, ETextureFormat_R32G32B32A32_FLOAT, mip_filter, false);
+        for (uint32 i = 0; i < float_chain.size(); i++)
+        {
+            ASSERT_NEAR(float_chain[i], float_color[i % 4], float_color[i % 4] * 1e-5f) << GetMipFilterName(mip_filter) << " " << i;
+        }
+    }
+}
+
+TEST(MipGeneratorTest, RampTest)
+{
+    // the filters are symmetric around the center of the 2 texels they halve, so a ramp stays a ramp away from the edges
+    constexpr uint32 Width = 64;
+    constexpr uint32 Height = 16;
+    constexpr uint32 MipLevels = 2;
+
+    std::vector<float> chain(CalculateTextureSize(Width, Height, MipLevels, 4));
+    for (uint32 i = 0; i < Width * Height; i++)
+    {
+        float x = static_cast<float>(i % Width);
+        float y = static_cast<float>(i / Width);
+        float pixel[4] = { x, y, x + y, 1.0f };
+        memcpy(chain.data() + i * 4, pixel, sizeof(pixel));
+    }
+
+    for (uint32 filter = 0; filter < EMipFilter_Count; filter++)
+    {
+        MipGenerator::Generate(chain.data(), Width, Height, MipLevels, ETextureFormat_R32G32B32A32_FLOAT, static_cast<EMipFilter>(filter), false);
+        for (uint32 y = 3; y < Height / 2 - 3; y++)
+        {
+            for (uint32 x = 3; x < Width / 2 - 3; x++)
+            {
+                const float* pixel = chain.data() + (Width * Height + y * Width / 2 + x) * 4;
+                EXPECT_NEAR(pixel[0], 2 * x + 0.5f, 1e-3f) << GetMipFilterName(static_cast<EMipFilter>(filter));
+                EXPECT_NEAR(pixel[1], 2 * y + 0.5f, 1e-3f) << GetMipFilterName(static_cast<EMipFilter>(filter));
+                EXPECT_NEAR(pixel[2], 2 * x + 2 * y + 1.0f, 1e-3f) << GetMipFilterName(static_cast<EMipFilter>(filter));
+            }
+        }
+    }
+}
+
+TEST(MipGeneratorTest, SRGBTest)
+{
+    // half black and half white is half the light, which is brighter than half of the 8 bits in srgb. the alpha is linear
+    const uint8 mip_0[16] =
+    {
+        0, 0, 0, 0, 255, 255, 255, 255,
+        0, 0, 0, 0, 255, 255, 255, 255,
+    };
+
+    for (bool srgb : { false, true })
+    {
+        std::vector<uint8> chain(CalculateTextureSize(2, 2, 2, 4));
+        memcpy(chain.data(), mip_0, sizeof(mip_0));
+        MipGenerator::Generate(chain.data(), 2, 2, 2, ETextureFormat_R8G8B8A8_UNORM, EMipFilter_Box, srgb);
+
+        EXPECT_EQ(chain[16], srgb ? 188 : 128);
+        EXPECT_EQ(chain[19], 128);
+    }
+
+    // every 8 bits value survives the conversions to linear and back
+    constexpr uint32 Width = 32;
+    std::vector<uint8> chain(CalculateTextureSize(Width, Width, 2, 1));
+    for (uint32 y = 0; y < Width; y++)
+    {
+        for (uint32 x = 0; x < Width; x++)
+        {
+            chain[y * Width + x] = static_cast<uint8>((y / 2) * (Width / 2) + x / 2);
+        }
+    }
+    MipGenerator::Generate(chain.data(), Width, Width, 2, ETextureFormat_R8_UNORM, EMipFilter_Box, true);
+    for (uint32 i = 0; i < 256; i++)
+    {
+        EXPECT_EQ(chain[Width * Width + i], i);
+    }
+}
+
+TEST(MipGeneratorTest, CubeMapTest)
+{
+    // the faces are filtered like the textures on their own, and don't bleed into each other
+    constexpr uint16 Width = 16;
+    constexpr uint16 MipLevels = 5;
+
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> random(0.0f, 8.0f);
+
+    std::array<TextureData, NumCubeMapFaces> faces;
+    std::vector<std::vector<float>> expected(NumCubeMapFaces);
+    for (uint32 face = 0; face < NumCubeMapFaces; face++)
+    {
+        faces[face] = TextureData(Width, Width, MipLevels, ETextureFormat_R32G32B32A32_FLOAT);
+        float* pixels = static_cast<float*>(faces[face].mData.GetData());
+        for (uint32 i = 0; i < Width * Width * 4; i++)
+        {
+            pixels[i] = random(rng);
+        }
+
+        expected[face].assign(pixels, pixels + faces[face].DataSize() / sizeof(float));
+        MipGenerator::Generate(expected[face].data(), Width, Width, MipLevels, ETextureFormat_R32G32B32A32_FLOAT, EMipFilter_Lanczos, false);
+    }
+
+    MipGenerator::GenerateCubeMap(faces, EMipFilter_Lanczos, false);
+    for (uint32 face = 0; face < NumCubeMapFaces; face++)
+    {
+        EXPECT_EQ(memcmp(faces[face].Data(), expected[face].data(), faces[face].DataSize()), 0) << face;
+    }
+}
+
+TEST(MipGeneratorTest, ThroughputTest)
+{
+    for (uint32 width : { 4096u, 8192u })
+    {
+        uint32 mip_levels = CalculateMaxMipLevels(width, width);
+        std::vector<uint8> chain(CalculateTextureSize(width, width, mip_levels, 4));
+        for (uint32 i = 0; i < width * width * 4; i++)
+        {
+            chain[i] = static_cast<uint8>(i * 2654435761u >> 24);
+        }
+
+        for (uint32 filter = 0; filter < EMipFilter_Count; filter++)
+        {
+            for (bool srgb : { false, true })
+            {
+                auto begin = std::chrono::high_resolution_clock::now();
+                MipGenerator::Generate(chain.data(), width, width, mip_levels, ETextureFormat_R8G8B8A8_UNORM, static_cast<EMipFilter>(filter), srgb);
+                double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+
+                double mpixels = static_cast<double>(width) * width / 1e6;
+                printf("%ux%u %s%s: %.1f ms, %.1f Mpix/s\n", width, width, GetMipFilterName(static_cast<EMipFilter>(filter)).data(), srgb ? " srgb" : "",
+                    seconds * 1000.0, mpixels / seconds);
+                EXPECT_GT(mpixels / seconds, 0.0);
+            }
+        }
+    }
+}
@@ -0,0 +1,192 @@
+#include "gtest/gtest.h"
+#include "Resource/ObjParser.h"
+#include <random>
+#include <chrono>
+#include <sstream>
+#include <fstream>
+#include <filesystem>
+
+using namespace MRenderer;
+
+// random obj file with triangles and quads, relative indices, missing attributes and material switches
+static std::string RandomObjFile(std::mt19937& rng, uint32 num_faces)
+{
+    std::uniform_real_distribution<float> value(-100, 100);
+    std::uniform_int_distribution<uint32> corners(3, 4);
+    std::uniform_int_distribution<uint32> percent(0, 99);
+
+    std::stringstream ss;
+    ss << "# random obj\nmtllib random.mtl\n";
+
+    uint32 num_vertices = 0;
+    for (uint32 face = 0; face < num_faces; face++)
+    {
+        uint32 num_corners = corners(rng);
+        for (uint32 i = 0; i < num_corners; i++)
+        {
+            ss << "v " << value(rng) << " " << value(rng) << " " << value(rng) << "\n";
+            ss << "vt " << value(rng) << " " << value(rng) << "\n";
+            ss << "vn " << value(rng) << " " << value(rng) << " " << value(rng) << "\r\n";
+        }
+        num_vertices += num_corners;
+
+        uint32 roll = percent(rng);
+        if (roll < 2)
+        {
+            ss << "usemtl " << (roll == 0 ? "red" : "green") << "\n";
+        }
+        else if (roll < 3)
+        {
+            ss << "o object" << face << "\ns 1\n";
+        }
+
+        // refer to the last vertices with relative or absolute indices
+        bool relative = percent(rng) < 30;
+        bool position_only = percent(rng) < 10;
+        ss << "f";
+        for (uint32 i = 0; i < num_corners; i++)
+        {
+            int32 index = relative ? -static_cast<int32>(num_corners - i) : static_cast<int32>(num_vertices - num_corners + i + 1);
+            if (position_only)
+            {
+                ss << " " << index;
+            }
+            else
+            {
+                ss << " " << index << "/" << index << "/" << index;
+            }
+        }
+        ss << "\n";
+    }
+    return ss.str();
+}
+
+static void ExpectSameAsTinyObj(const std::string& obj_text, const std::filesystem::path& folder)
+{
+    std::filesystem::path obj_path = folder / "random.obj";
+    std::ofstream(obj_path, std::ios::binary) << obj_text;
+
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string warn, err;
+    ASSERT_TRUE(tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, obj_path.string().data(), folder.string().data()));
+
+    ObjMesh mesh;
+    ASSERT_TRUE(ObjParser::Parse(obj_text, folder.string(), mesh));
+
+    ASSERT_EQ(mesh.Positions, attrib.vertices);
+    ASSERT_EQ(mesh.Normals, attrib.normals);
+    ASSERT_EQ(mesh.TexCoords, attrib.texcoords);
+
+    // tinyobj uses -1 for the faces without material, they use the appended default material in @ObjMesh
+    ASSERT_EQ(mesh.Materials.size(), materials.size() + 1);
+    for (uint32 i = 0; i < materials.size(); i++)
+    {
+        ASSERT_EQ(mesh.Materials[i].name, materials[i].name);
+    }
+
+    uint32 triangle = 0;
+    for (const auto& shape : shapes)
+    {
+        for (uint32 i = 0; i < shape.mesh.material_ids.size(); i++, triangle++)
+        {
+            ASSERT_LT(triangle, mesh.NumTriangles());
+
+            int32 expected_material = shape.mesh.material_ids[i] < 0 ? static_cast<int32>(materials.size()) : shape.mesh.material_ids[i];
+            ASSERT_EQ(mesh.MaterialIds[triangle], expected_material) << "at triangle " << triangle;
+
+            for (uint32 k = 0; k < 3; k++)
+            {
+                const tinyobj::index_t& expected = shape.mesh.indices[i * 3 + k];
+                const ObjIndex& index = mesh.Indices[triangle * 3 + k];
+                ASSERT_EQ(index.Position, expected.vertex_index) << "at triangle " << triangle;
+                ASSERT_EQ(index.TexCoord, expected.texcoord_index) << "at triangle " << triangle;
+                ASSERT_EQ(index.Normal, expected.normal_index) << "at triangle " << triangle;
+            }
+        }
+    }
+    ASSERT_EQ(triangle, mesh.NumTriangles());
+}
+
+class ObjParserTest : public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        mFolder = std::filesystem::temp_directory_path() / "ObjParserTest";
+        std::filesystem::create_directories(mFolder);
+        std::ofstream(mFolder / "random.mtl") << "newmtl red\nKd 1 0 0\nmap_Kd red.png\n\nnewmtl green\nKd 0 1 0\n";
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove_all(mFolder);
+    }
+
+    std::filesystem::path mFolder;
+};
+
+TEST_F(ObjParserTest, SmallFileTest)
+{
+    std::mt19937 rng(1);
+    ExpectSameAsTinyObj(RandomObjFile(rng, 200), mFolder);
+
+    // corner cases, a file without newline at the end, a degenerated face and unknown statements
+    ExpectSameAsTinyObj("v 0 0 0\nv 1 0 0\nv 0 1 0\nv 1 1 0\nf 1 2\nusemtl red\ncstype bezier\nf 1 2 3 4\nf -1 -2 -3", mFolder);
+
+    // polygons with more than 4 corners are triangulated as a fan
+    ObjMesh mesh;
+    ASSERT_TRUE(ObjParser::Parse("mtllib random.mtl\nusemtl green\nv 0 0 0\nv 1 0 0\nv 2 1 0\nv 1 2 0\nv 0 1 0\nf 1 2 3 4 5\n", mFolder.string(), mesh));
+    ASSERT_EQ(mesh.NumTriangles(), 3u);
+    ASSERT_EQ(mesh.Materials.size(), 2u);
+    for (uint32 i = 0; i < 3; i++)
+    {
+        ASSERT_EQ(mesh.MaterialIds[i], 1);
+        ASSERT_EQ(mesh.Indices[i * 3].Position, 0);
+        ASSERT_EQ(mesh.Indices[i * 3 + 1].Position, static_cast<int32>(i + 1));
+        ASSERT_EQ(mesh.Indices[i * 3 + 2].Position, static_cast<int32>(i + 2));
+        ASSERT_EQ(mesh.Indices[i * 3].Normal, -1);
+    }
+
+    // out of range index
+    ASSERT_FALSE(ObjParser::Parse("v 0 0 0\nf 1 2 3\n", mFolder.string(), mesh));
+}
+
+// big enough to be split into several chunks
+TEST_F(ObjParserTest, ChunkTest)
+{
+    std::mt19937 rng(2);
+    std::string text = RandomObjFile(rng, 20000);
+    ASSERT_GT(text.size(), 2 * ObjParser::MinChunkSize);
+    ExpectSameAsTinyObj(text, mFolder);
+}
+
+TEST_F(ObjParserTest, Benchmark)
+{
+    using Clock = std::chrono::high_resolution_clock;
+
+    std::mt19937 rng(3);
+    std::string text = RandomObjFile(rng, 100000);
+    std::filesystem::path obj_path = mFolder / "random.obj";
+    std::ofstream(obj_path, std::ios::binary) << text;
+
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string warn, err;
+    auto begin = Clock::now();
+    tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, obj_path.string().data(), mFolder.string().data());
+    auto tinyobj_time = Clock::now() - begin;
+
+    ObjMesh mesh;
+    begin = Clock::now();
+    ObjParser::Load(obj_path.string(), mFolder.string(), mesh);
+    auto parser_time = Clock::now() - begin;
+
+    std::cout << text.size() / (1 << 20) << " MB, " << mesh.NumTriangles() << " triangles, "
+        << "tinyobj: " << std::chrono::duration<double, std::milli>(tinyobj_time).count() << " ms, "
+        << "ObjParser: " << std::chrono::duration<double, std::milli>(parser_time).count() << " ms\n";
+
+    EXPECT_LT(parser_time, tinyobj_time);
+}
@@ -0,0 +1,219 @@
+#include "gtest/gtest.h"
+#include "Utils/Occlusion.h"
+#include <algorithm>
+#include <random>
+#include <chrono>
+#include <vector>
+
+using namespace MRenderer;
+
+// camera at the origin looking at +z, same aspect ratio as the occlusion buffer
+static Matrix4x4 DefaultViewProjection()
+{
+    float aspect = static_cast<float>(OcclusionBuffer::Width) / OcclusionBuffer::Height;
+    return ProjectionMatrix1(Deg2Rad * 60.0f, aspect, 0.1f, 300.0f);
+}
+
+TEST(Occlusion, WallTest)
+{
+    OcclusionBuffer buffer;
+    buffer.Clear(DefaultViewProjection());
+    buffer.RasterizeOccluder(OccluderMesh::FromBound(AABB({ -5, -5, 10 }, { 5, 5, 11 })), Matrix4x4::Identity());
+    buffer.BuildHierarchy();
+
+    // behind the wall
+    ASSERT_TRUE(buffer.IsOccluded(AABB({ -1, -1, 20 }, { 1, 1, 22 })));
+    ASSERT_TRUE(buffer.IsOccluded(AABB({ -9, -9, 100 }, { 9, 9, 120 })));
+
+    // in front of the wall, beside the wall, partially behind the wall, intersecting the wall
+    ASSERT_FALSE(buffer.IsOccluded(AABB({ -1, -1, 5 }, { 1, 1, 6 })));
+    ASSERT_FALSE(buffer.IsOccluded(AABB({ 12, -1, 20 }, { 14, 1, 22 })));
+    ASSERT_FALSE(buffer.IsOccluded(AABB({ 3, -1, 20 }, { 12, 1, 22 })));
+    ASSERT_FALSE(buffer.IsOccluded(AABB({ -1, -1, 9 }, { 1, 1, 12 })));
+
+    // camera inside of the bound
+    ASSERT_FALSE(buffer.IsOccluded(AABB({ -1, -1, -1 }, { 1, 1, 1 })));
+
+    // the same wall moved by the world matrix
+    Matrix4x4 world = Matrix4x4::Identity();
+    world.SetTranslation(Vector3(5, 0, 0));
+    buffer.Clear(DefaultViewProjection());
+    buffer.RasterizeOccluder(OccluderMesh::FromBound(AABB({ -5, -5, 10 }, { 5, 5, 11 })), world);
+    buffer.BuildHierarchy();
+    ASSERT_FALSE(buffer.IsOccluded(AABB({ -3, -1, 20 }, { -1, 1, 22 })));
+    ASSERT_TRUE(buffer.IsOccluded(AABB({ 9, -1, 20 }, { 11, 1, 22 })));
+}
+
+// triangles crossing the near plane are clipped instead of dropped
+TEST(Occlusion, NearPlaneClippingTest)
+{
+    OcclusionBuffer buffer;
+    buffer.Clear(DefaultViewProjection());
+    buffer.RasterizeOccluder(OccluderMesh::FromBound(AABB({ 1, -50, -10 }, { 3, 50, 30 })), Matrix4x4::Identity());
+    buffer.BuildHierarchy();
+
+    ASSERT_TRUE(buffer.IsOccluded(AABB({ 10, -1, 15 }, { 12, 1, 17 })));
+    ASSERT_FALSE(buffer.IsOccluded(AABB({ -12, -1, 15 }, { -10, 1, 17 })));
+}
+
+// the rasterized depth must match a ray cast against the occluder at every pixel center,
+// and each mip texel must be the max of the 2x2 texels below it
+TEST(Occlusion, DepthBufferTest)
+{
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<float> position(-20, 20);
+    std::uniform_real_distribution<float> distance(5, 60);
+    std::uniform_real_distribution<float> extent(1, 8);
+
+    Matrix4x4 view_projection = DefaultViewProjection();
+    Matrix4x4 inverse_view_projection = view_projection.Inverse();
+
+    auto unproject = [&](float ndc_x, float ndc_y, float ndc_z)
+    {
+        Vector4 p = inverse_view_projection * Vector4(ndc_x, ndc_y, ndc_z, 1);
+        return Vector3(p.x / p.w, p.y / p.w, p.z / p.w);
+    };
+
+    for (uint32 n = 0; n < 8; n++)
+    {
+        Vector3 center = { position(rng), position(rng), distance(rng) };
+        Vector3 half_size = { extent(rng), extent(rng), extent(rng) };
+        AABB occluder(center - half_size, center + half_size);
+
+        OcclusionBuffer buffer;
+        buffer.Clear(view_projection);
+        buffer.RasterizeOccluder(OccluderMesh::FromBound(occluder), Matrix4x4::Identity());
+        buffer.BuildHierarchy();
+
+        // the depth of the ray cast at every pixel center, 1 where it misses
+        std::vector<float> expected(OcclusionBuffer::Width * OcclusionBuffer::Height, 1.0f);
+        for (uint32 y = 0; y < OcclusionBuffer::Height; y++)
+        {
+            for (uint32 x = 0; x < OcclusionBuffer::Width; x++)
+            {
+                float ndc_x = (x + 0.5f) / OcclusionBuffer::Width * 2 - 1;
+                float ndc_y = 1 - (y + 0.5f) / OcclusionBuffer::Height * 2;
+
+                // slab test of the view ray
+                Vector3 origin = unproject(ndc_x, ndc_y, 0);
+                Vector3 direction = unproject(ndc_x, ndc_y, 1) - origin;
+                float t_near = 0, t_far = 1;
+                for (uint32 axis = 0; axis < 3; axis++)
+                {
+                    float t0 = (occluder.Min[axis] - origin[axis]) / direction[axis];
+                    float t1 = (occluder.Max[axis] - origin[axis]) / direction[axis];
+                    t_near = std::max(t_near, std::min(t0, t1));
+                    t_far = std::min(t_far, std::max(t0, t1));
+                }
+
+                if (t_near <= t_far)
+                {
+                    Vector3 hit = origin + direction * t_near;
+                    Vector4 clip = view_projection * Vector4(hit, 1);
+                    expected[y * OcclusionBuffer::Width + x] = clip.z / clip.w;
+                }
+            }
+        }
+
+        // the pixel centers within a pixel of the silhouette may go either way depending on the rounding of the edge functions,
+        // which changes with the codegen (fma contraction for one). the others must match
+        auto covered = [&](int32 x, int32 y)
+        {
+            x = std::clamp(x, 0, static_cast<int32>(OcclusionBuffer::Width) - 1);
+            y = std::clamp(y, 0, static_cast<int32>(OcclusionBuffer::Height) - 1);
+            return expected[y * OcclusionBuffer::Width + x] < 1.0f;
+        };
+
+        uint32 num_mismatch = 0;
+        for (int32 y = 0; y < static_cast<int32>(OcclusionBuffer::Height); y++)
+        {
+            for (int32 x = 0; x < static_cast<int32>(OcclusionBuffer::Width); x++)
+            {
+                bool silhouette = false;
+                for (int32 dy = -1; dy <= 1; dy++)
+                {
+                    for (int32 dx = -1; dx <= 1; dx++)
+                    {
+                        silhouette |= covered(x + dx, y + dy) != covered(x, y);
+                    }
+                }
+
+                float depth = buffer.GetDepth(x, y);
+                if (!silhouette && std::abs(depth - expected[y * OcclusionBuffer::Width + x]) > 1e-4f)
+                {
+                    num_mismatch++;
+                }
+            }
+        }
+        ASSERT_EQ(num_mismatch, 0u);
+
+        for (uint32 mip = 1; mip < OcclusionBuffer::NumMips; mip++)
+        {
+            for (uint32 y = 0; y < OcclusionBuffer::MipHeight(mip); y++)
+            {
+                for (uint32 x = 0; x < OcclusionBuffer::MipWidth(mip); x++)
+                {
+                    float expected = std::max(
+                        std::max(buffer.GetDepth(x * 2, y * 2, mip - 1), buffer.GetDepth(x * 2 + 1, y * 2, mip - 1)),
+                        std::max(buffer.GetDepth(x * 2, y * 2 + 1, mip - 1), buffer.GetDepth(x * 2 + 1, y * 2 + 1, mip - 1))
+                    );
+                    ASSERT_EQ(buffer.GetDepth(x, y, mip), expected);
+                }
+            }
+        }
+    }
+}
+
+TEST(Occlusion, Benchmark)
+{
+    using Clock = std::chrono::high_resolution_clock;
+
+    constexpr uint32 NumOccluders = 64;
+    constexpr uint32 NumBounds = 10000;
+
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<float> position(-40, 40);
+    std::uniform_real_distribution<float> distance(10, 150);
+    std::uniform_real_distribution<float> extent(0.5f, 4.0f);
+
+    std::vector<OccluderMesh> occluders(NumOccluders);
+    for (auto& occluder : occluders)
+    {
+        // thin walls facing the camera
+        Vector3 center = { position(rng), position(rng) * 0.25f, distance(rng) };
+        Vector3 half_size = { extent(rng) * 2, extent(rng), 0.2f };
+        occluder = OccluderMesh::FromBound(AABB(center - half_size, center + half_size));
+    }
+
+    std::vector<AABB> bounds(NumBounds);
+    for (auto& bound : bounds)
+    {
+        Vector3 center = { position(rng), position(rng) * 0.25f, distance(rng) };
+        Vector3 half_size = { extent(rng), extent(rng), extent(rng) };
+        bound = AABB(center - half_size, center + half_size);
+    }
+
+    OcclusionBuffer buffer;
+    auto begin = Clock::now();
+    buffer.Clear(DefaultViewProjection());
+    for (const auto& occluder : occluders)
+    {
+        buffer.RasterizeOccluder(occluder, Matrix4x4::Identity());
+    }
+    buffer.BuildHierarchy();
+    auto rasterize_time = Clock::now() - begin;
+
+    begin = Clock::now();
+    uint32 num_occluded = 0;
+    for (const auto& bound : bounds)
+    {
+        num_occluded += buffer.IsOccluded(bound);
+    }
+    auto test_time = Clock::now() - begin;
+
+    std::cout << "rasterize " << NumOccluders << " occluders: " << std::chrono::duration<double, std::milli>(rasterize_time).count() << " ms, "
+        << "test " << NumBounds << " bounds: " << std::chrono::duration<double, std::milli>(test_time).count() << " ms, "
+        << num_occluded << " occluded\n";
+
+    ASSERT_GT(num_occluded, 0u);
+}
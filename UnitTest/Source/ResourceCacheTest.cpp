@@ -0,0 +1,107 @@
+#include "gtest/gtest.h"
+#include "Resource/ResourceCache.h"
+
+using namespace MRenderer;
+
+namespace
+{
+    struct CountedResource : public IResource
+    {
+        CountedResource(uint64 size, int* num_alive)
+            :mNumAlive(num_alive)
+        {
+            mResidentSize = size;
+            (*mNumAlive)++;
+        }
+
+        ~CountedResource()
+        {
+            (*mNumAlive)--;
+        }
+
+        std::shared_ptr<IResource> mChild;
+        int* mNumAlive;
+    };
+}
+
+TEST(ResourceCacheTest, EvictionTest)
+{
+    int num_alive = 0;
+    ResourceCache cache(100);
+
+    std::shared_ptr<IResource> a = cache.Insert("A", std::make_shared<CountedResource>(40, &num_alive), EResourceCategory_Mesh);
+    std::shared_ptr<IResource> b = cache.Insert("B", std::make_shared<CountedResource>(40, &num_alive), EResourceCategory_Texture);
+    std::shared_ptr<IResource> c = cache.Insert("C", std::make_shared<CountedResource>(40, &num_alive), EResourceCategory_Texture);
+    EXPECT_EQ(num_alive, 3);
+
+    // the referenced resources stay over the budget
+    EXPECT_EQ(cache.Trim(), 0u);
+    EXPECT_EQ(cache.GetStats().Bytes, 120u);
+
+    // the handles are shared while someone holds them
+    EXPECT_EQ(cache.Find("A"), a);
+    EXPECT_EQ(cache.Find("Missing"), nullptr);
+
+    // released in the order b, a, so b is the least recently used
+    b.reset();
+    a.reset();
+    ResourceCacheStats stats = cache.GetStats();
+    EXPECT_EQ(stats.UnreferencedBytes, 80u);
+    EXPECT_EQ(stats.Categories[EResourceCategory_Texture].NumResources, 2u);
+    EXPECT_EQ(stats.Categories[EResourceCategory_Texture].NumUnreferenced, 1u);
+    EXPECT_EQ(stats.NumHits, 1u);
+    EXPECT_EQ(stats.NumMisses, 1u);
+    EXPECT_EQ(num_alive, 3);
+
+    EXPECT_EQ(cache.Trim(), 1u);
+    EXPECT_EQ(num_alive, 2);
+    EXPECT_EQ(cache.Find("B"), nullptr);
+
+    // an unreferenced resource is handed out again until it's evicted
+    a = cache.Find("A");
+    ASSERT_NE(a, nullptr);
+    a.reset();
+
+    cache.SetBudget(0);
+    EXPECT_EQ(cache.Trim(), 1u);
+    EXPECT_EQ(num_alive, 1);
+    EXPECT_EQ(cache.GetStats().Bytes, 40u);
+
+    c.reset();
+    EXPECT_EQ(cache.Trim(), 1u);
+    EXPECT_EQ(num_alive, 0);
+
+    stats = cache.GetStats();
+    EXPECT_EQ(stats.Bytes, 0u);
+    EXPECT_EQ(stats.NumEvictions, 3u);
+    EXPECT_EQ(stats.EvictedBytes, 120u);
+}
+
+TEST(ResourceCacheTest, DependencyTest)
+{
+    int num_alive = 0;
+    ResourceCache cache(0);
+
+    // a model holds the handle of its mesh, so the mesh is evicted after the model
+    std::shared_ptr<CountedResource> model = std::make_shared<CountedResource>(10, &num_alive);
+    model->mChild = cache.Insert("Mesh", std::make_shared<CountedResource>(1000, &num_alive), EResourceCategory_Mesh);
+    std::shared_ptr<IResource> model_handle = cache.Insert("Model", model, EResourceCategory_Model);
+    model.reset();
+
+    EXPECT_EQ(cache.Trim(), 0u);
+    EXPECT_EQ(cache.GetStats().Categories[EResourceCategory_Mesh].NumUnreferenced, 0u);
+
+    model_handle.reset();
+    EXPECT_EQ(cache.Trim(), 2u);
+    EXPECT_EQ(num_alive, 0);
+
+    // a reloaded resource replaces the cached one
+    std::shared_ptr<IResource> first = cache.Insert("Texture", std::make_shared<CountedResource>(5, &num_alive), EResourceCategory_Texture);
+    std::shared_ptr<IResource> second = cache.Insert("Texture", std::make_shared<CountedResource>(7, &num_alive), EResourceCategory_Texture);
+    EXPECT_NE(first, second);
+    EXPECT_EQ(cache.Find("Texture"), second);
+    EXPECT_EQ(cache.GetStats().Bytes, 7u);
+
+    first.reset();
+    EXPECT_EQ(num_alive, 1);
+}
@@ -0,0 +1,94 @@
+#include "gtest/gtest.h"
+#include "CubeMapFixture.h"
+#include "Resource/BasicStorage.h"
+#include "Utils/SH.h"
+#include <cmath>
+#include <cstring>
+
+using namespace MRenderer;
+
+namespace
+{
+    const Vector3 Normals[] =
+    {
+        Vector3(1, 0, 0), Vector3(-1, 0, 0), Vector3(0, 1, 0), Vector3(0, -1, 0), Vector3(0, 0, 1), Vector3(0, 0, -1),
+        Vector3(1, 1, 1).GetNormalized(), Vector3(-1, 2, -3).GetNormalized(),
+    };
+}
+
+TEST(SHTest, ConstantTest)
+{
+    // the solid angles of the texels add up to the sphere, so a constant radiance is the irradiance over pi of every normal
+    const Vector3 radiance(0.5f, 2.0f, 8.0f);
+    for (uint16 width : { 4, 12, 16, 36 })
+    {
+        CubeMapTextureData cube_map(MakeCubeMap(width, ETextureFormat_R32G32B32A32_FLOAT, [&](const Vector3&) { return radiance; }));
+        for (const Vector3& normal : Normals)
+        {
+            Vector3 irradiance = SHBaker::CalcIrradiance(cube_map.GetSHCoefficients(), normal);
+            for (uint32 c = 0; c < 3; c++)
+            {
+                EXPECT_NEAR(irradiance[c], radiance[c], radiance[c] * 1e-4f) << width << " " << c;
+            }
+        }
+    }
+}
+
+TEST(SHTest, LinearTest)
+{
+    // a radiance of a + b * dir is in the first 2 bands, its irradiance over pi is a + 2 / 3 * b * normal
+    auto radiance = [](const Vector3& dir) { return Vector3(1.0f + 0.5f * dir.x, 1.0f - 0.75f * dir.y, 2.0f + dir.z); };
+    CubeMapTextureData cube_map(MakeCubeMap(64, ETextureFormat_R32G32B32A32_FLOAT, radiance));
+    for (const Vector3& normal : Normals)
+    {
+        Vector3 irradiance = SHBaker::CalcIrradiance(cube_map.GetSHCoefficients(), normal);
+        EXPECT_NEAR(irradiance.x, 1.0f + 0.5f * normal.x * 2 / 3, 1e-3f);
+        EXPECT_NEAR(irradiance.y, 1.0f - 0.75f * normal.y * 2 / 3, 1e-3f);
+        EXPECT_NEAR(irradiance.z, 2.0f + normal.z * 2 / 3, 1e-3f);
+    }
+}
+
+TEST(SHTest, SkyTest)
+{
+    // a white upper hemisphere over a black one, its exact coefficients are known in closed form
+    auto radiance = [](const Vector3& dir) { return dir.y > 0 ? Vector3(1, 1, 1) : Vector3(0, 0, 0); };
+    auto faces = MakeCubeMap(64, ETextureFormat_R32G32B32A32_FLOAT, radiance);
+
+    SH2Coefficients shr, shg, shb;
+    SHBaker::ProjectEnvironmentMap(faces, shr, shg, shb);
+
+    // L00 = 2pi * 0.282095 and L1-1 = pi * 0.488603, which are scaled by A(l) * sqrt(4pi / (2l + 1)) / pi = 1 and 2 / 3
+    EXPECT_NEAR(shr.Data[0], 0.282095f * 2 * PI, 1e-3f);
+    EXPECT_NEAR(shr.Data[1], 0.488603f * PI * 2 / 3, 1e-3f);
+    for (uint32 n : { 2, 3, 4, 5, 6, 7, 8 })
+    {
+        EXPECT_NEAR(shr.Data[n], 0.0f, 1e-4f) << n;
+    }
+    EXPECT_EQ(memcmp(shr.Data.data(), shg.Data.data(), sizeof(shr.Data)), 0);
+    EXPECT_EQ(memcmp(shr.Data.data(), shb.Data.data(), sizeof(shr.Data)), 0);
+}
+
+TEST(SHTest, DeterministicTest)
+{
+    // the projections of a cube map are the same bit by bit, and the halves are close to the floats
+    auto radiance = [](const Vector3& dir) { return Vector3(1.0f + dir.x * dir.y, 3.0f * dir.z * dir.z, dir.y > 0.5f ? 10.0f : 0.1f); };
+    auto faces = MakeCubeMap(96, ETextureFormat_R32G32B32A32_FLOAT, radiance);
+
+    SH2CoefficientsPack first = CubeMapTextureData::GenerateSHCoefficients(faces);
+    for (uint32 i = 0; i < 4; i++)
+    {
+        SH2CoefficientsPack pack = CubeMapTextureData::GenerateSHCoefficients(faces);
+        EXPECT_EQ(memcmp(&pack, &first, sizeof(pack)), 0);
+    }
+
+    SH2CoefficientsPack half = CubeMapTextureData::GenerateSHCoefficients(MakeCubeMap(96, ETextureFormat_R16G16B16A16_FLOAT, radiance));
+    for (const Vector3& normal : Normals)
+    {
+        Vector3 expected = SHBaker::CalcIrradiance(first, normal);
+        Vector3 irradiance = SHBaker::CalcIrradiance(half, normal);
+        for (uint32 c = 0; c < 3; c++)
+        {
+            EXPECT_NEAR(irradiance[c], expected[c], std::abs(expected[c]) * 1e-3f + 1e-4f) << c;
+        }
+    }
+}
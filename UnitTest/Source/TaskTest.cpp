@@ -0,0 +1,277 @@
+#include "gtest/gtest.h"
+#include "Utils/Thread.h"
+#include "format"
+#include <chrono>
+
+using namespace MRenderer;
+
+// count heap allocations of the whole test executable
+static std::atomic<uint64> gNumAllocations = 0;
+
+void* operator new(size_t size)
+{
+    gNumAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = malloc(size ? size : 1))
+    {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    free(ptr);
+}
+
+
+TEST(Task, InlineAndHeapStorageTest)
+{
+    int counter = 0;
+
+    // small callable is stored in place
+    uint64 allocations = gNumAllocations.load();
+    Task small([&counter]() { counter += 1; });
+    ASSERT_EQ(gNumAllocations.load(), allocations);
+
+    // callable bigger than the inline buffer falls back to heap
+    std::array<uint8, Task::InlineSize + 1> payload = {};
+    payload[Task::InlineSize] = 10;
+    Task big([&counter, payload]() { counter += payload[Task::InlineSize]; });
+
+    // moved-from task is empty
+    Task moved_small = std::move(small);
+    Task moved_big = std::move(big);
+    ASSERT_FALSE(small);
+    ASSERT_FALSE(big);
+
+    moved_small();
+    moved_big();
+    ASSERT_EQ(counter, 11);
+
+    // destructor of the captured object is called exactly once
+    auto shared = std::make_shared<int>(0);
+    {
+        Task task([shared]() {});
+        Task other = std::move(task);
+        ASSERT_EQ(shared.use_count(), 2);
+    }
+    ASSERT_EQ(shared.use_count(), 1);
+}
+
+TEST(Task, FutureTest)
+{
+    TaskThread thread;
+
+    auto value = thread.Schedule([](int a, int b) { return a + b; }, 3, 4);
+    ASSERT_EQ(value.get(), 7);
+    ASSERT_FALSE(value.valid());
+
+    auto move_only = thread.Schedule([]() { return std::make_unique<int>(42); });
+    ASSERT_EQ(*move_only.get(), 42);
+
+    auto exception = thread.Schedule([]() -> int { throw std::runtime_error("failed"); });
+    ASSERT_THROW(exception.get(), std::runtime_error);
+
+    // the future outlives the promise
+    int output = 0;
+    auto reference = thread.Schedule([](int& out) { out = 5; }, std::ref(output));
+    reference.wait();
+    ASSERT_TRUE(reference.IsReady());
+    ASSERT_EQ(output, 5);
+
+    // the promise outlives the future
+    std::atomic<bool> done = false;
+    thread.Schedule([&]() { done = true; });
+    while (!done)
+    {
+        std::this_thread::yield();
+    }
+}
+
+TEST(Task, BrokenPromiseTest)
+{
+    TaskFuture<int> future;
+    {
+        TaskPromise<int> promise;
+        future = promise.GetFuture();
+    }
+
+    ASSERT_THROW(future.get(), std::future_error);
+}
+
+TEST(Task, DispatchTest)
+{
+    TaskThread thread;
+    std::atomic<uint32> sum = 0;
+
+    for (uint32 i = 0; i < 1000; i++)
+    {
+        thread.Dispatch([&sum](uint32 value) { sum += value; }, i);
+    }
+
+    // tasks are executed in order, so the last future implies the others are done
+    thread.Schedule([]() {}).wait();
+    ASSERT_EQ(sum.load(), 999 * 1000 / 2);
+}
+
+
+// the scheduling path before the small buffer task, kept here as the baseline of the benchmark
+class LegacyTaskThread
+{
+public:
+    LegacyTaskThread()
+    {
+        mThread = std::thread(
+            [this]()
+            {
+                while (true)
+                {
+                    std::unique_lock guard(mMutex);
+                    mEvent.wait(guard, [this]() { return mClosed || !mTasks.empty(); });
+                    if (mClosed && mTasks.empty())
+                    {
+                        return;
+                    }
+
+                    auto task = mTasks.front();
+                    mTasks.pop();
+                    guard.unlock();
+
+                    task();
+                }
+            }
+        );
+    }
+
+    ~LegacyTaskThread()
+    {
+        {
+            std::lock_guard guard(mMutex);
+            mClosed = true;
+        }
+        mEvent.notify_one();
+        mThread.join();
+    }
+
+    template<typename Fn, typename... Args>
+    auto Schedule(Fn func, Args&&... args)
+    {
+        using ReturnType = std::invoke_result_t<Fn, Args...>;
+
+        auto ptr = std::make_shared<std::packaged_task<ReturnType(Args...)>>(func);
+        {
+            std::lock_guard guard(mMutex);
+            mTasks.push([=]() mutable { (*ptr)(args...); });
+        }
+        mEvent.notify_one();
+
+        return ptr->get_future();
+    }
+
+protected:
+    bool mClosed = false;
+    std::queue<std::function<void()>> mTasks;
+    std::mutex mMutex;
+    std::condition_variable mEvent;
+    std::thread mThread;
+};
+
+// allocations and ns per task of the legacy path, @Schedule and @Dispatch
+TEST(Task, ScheduleBenchmark)
+{
+    using Clock = std::chrono::high_resolution_clock;
+
+    constexpr uint32 NumTasks = 100000;
+    constexpr uint32 NumRounds = 3;
+
+    struct Result
+    {
+        double NanosecondsPerTask;
+        double AllocationsPerTask;
+    };
+
+    auto measure = [&](auto&& submit_all)
+    {
+        Result best = { std::numeric_limits<double>::max(), 0 };
+
+        // the first round warms up the pools and the ring buffers
+        for (uint32 round = 0; round < NumRounds; round++)
+        {
+            uint64 allocations = gNumAllocations.load();
+            auto begin = Clock::now();
+
+            submit_all();
+
+            double nanoseconds = std::chrono::duration<double, std::nano>(Clock::now() - begin).count();
+            Result result = { nanoseconds / NumTasks, double(gNumAllocations.load() - allocations) / NumTasks };
+            if (result.NanosecondsPerTask < best.NanosecondsPerTask)
+            {
+                best = result;
+            }
+        }
+
+        return best;
+    };
+
+    std::atomic<uint64> sink = 0;
+
+    Result legacy;
+    {
+        LegacyTaskThread thread;
+        legacy = measure(
+            [&]()
+            {
+                std::future<void> last;
+                for (uint32 i = 0; i < NumTasks; i++)
+                {
+                    last = thread.Schedule([&sink](uint32 value) { sink += value; }, i);
+                }
+                last.wait();
+            }
+        );
+    }
+
+    Result schedule;
+    {
+        TaskThread thread;
+        schedule = measure(
+            [&]()
+            {
+                TaskFuture<void> last;
+                for (uint32 i = 0; i < NumTasks; i++)
+                {
+                    last = thread.Schedule([&sink](uint32 value) { sink += value; }, i);
+                }
+                last.wait();
+            }
+        );
+    }
+
+    Result dispatch;
+    {
+        TaskThread thread;
+        dispatch = measure(
+            [&]()
+            {
+                for (uint32 i = 0; i < NumTasks; i++)
+                {
+                    thread.Dispatch([&sink](uint32 value) { sink += value; }, i);
+                }
+                thread.Schedule([]() {}).wait();
+            }
+        );
+    }
+
+    std::cout << std::format("legacy   : {:8.1f} ns/task {:6.2f} allocations/task\n", legacy.NanosecondsPerTask, legacy.AllocationsPerTask);
+    std::cout << std::format("schedule : {:8.1f} ns/task {:6.2f} allocations/task\n", schedule.NanosecondsPerTask, schedule.AllocationsPerTask);
+    std::cout << std::format("dispatch : {:8.1f} ns/task {:6.2f} allocations/task\n", dispatch.NanosecondsPerTask, dispatch.AllocationsPerTask);
+
+    // once warmed up, only the occasional cross-thread pool refill should hit the heap
+    ASSERT_LT(schedule.AllocationsPerTask, legacy.AllocationsPerTask);
+    ASSERT_LT(dispatch.AllocationsPerTask, 0.01);
+}
@@ -39,7 +39,7 @@ TEST(ThreadPool, ScheduleTest)
     int res = future2.get();
     ASSERT_EQ(res, 5 * 3);
 
-    std::vector<std::pair<std::future<int>, int>> futures(100);
+    std::vector<std::pair<MRenderer::TaskFuture<int>, int>> futures(100);
     for (size_t i = 0; i < 100; i++) 
     {
         int a = std::rand() % 10;
@@ -0,0 +1,184 @@
+#include "gtest/gtest.h"
+#include "Utils/Transform.h"
+#include <random>
+#include <chrono>
+#include <algorithm>
+
+using namespace MRenderer;
+
+// the matrix built the way @SceneObject did before the transform store
+static Matrix4x4 ReferenceWorldMatrix(const Vector3& translation, const Vector3& rotation, const Vector3& scale)
+{
+    Matrix4x4 matrix = Matrix4x4::Identity();
+    matrix.SetRotation(rotation.x, rotation.y, rotation.z);
+    matrix.SetTranslation(translation);
+    matrix.SetScale(scale);
+    return matrix;
+}
+
+static void ExpectMatrixNear(const Matrix4x4& lhs, const Matrix4x4& rhs, float tolerance = 1e-4f)
+{
+    for (uint32 r = 0; r < 4; r++)
+    {
+        for (uint32 c = 0; c < 4; c++)
+        {
+            ASSERT_NEAR(lhs.At(r, c), rhs.At(r, c), tolerance) << "at (" << r << ", " << c << ")";
+        }
+    }
+}
+
+struct RandomTransform
+{
+    Vector3 Translation;
+    Vector3 Rotation;
+    Vector3 Scale;
+};
+
+static RandomTransform MakeRandomTransform(std::mt19937& rng)
+{
+    std::uniform_real_distribution<float> position(-100, 100);
+    std::uniform_real_distribution<float> angle(-PI, PI);
+    std::uniform_real_distribution<float> scale(0.5f, 2.0f);
+
+    return RandomTransform{
+        .Translation = { position(rng), position(rng), position(rng) },
+        .Rotation = { angle(rng), angle(rng), angle(rng) },
+        .Scale = { scale(rng), scale(rng), scale(rng) },
+    };
+}
+
+TEST(Transform, UpdateTest)
+{
+    std::mt19937 rng(1);
+    TransformStore store;
+
+    // a count that is not a multiple of the SIMD width
+    std::vector<TransformHandle> handles(13);
+    std::vector<RandomTransform> transforms(handles.size());
+    for (uint32 i = 0; i < handles.size(); i++)
+    {
+        handles[i] = store.Allocate();
+        ExpectMatrixNear(store.GetWorldMatrix(handles[i]), Matrix4x4::Identity());
+
+        transforms[i] = MakeRandomTransform(rng);
+        store.SetTranslation(handles[i], transforms[i].Translation);
+        store.SetRotation(handles[i], transforms[i].Rotation);
+        store.SetScale(handles[i], transforms[i].Scale);
+        ASSERT_TRUE(store.IsDirty(handles[i]));
+    }
+
+    ASSERT_EQ(store.Update().size(), handles.size());
+    for (uint32 i = 0; i < handles.size(); i++)
+    {
+        ASSERT_FALSE(store.IsDirty(handles[i]));
+
+        Matrix4x4 expected = ReferenceWorldMatrix(transforms[i].Translation, transforms[i].Rotation, transforms[i].Scale);
+        ExpectMatrixNear(store.GetWorldMatrix(handles[i]), expected);
+        ExpectMatrixNear(store.GetInverseWorldMatrix(handles[i]), expected.Inverse());
+    }
+
+    // only the dirty entries are updated
+    store.SetTranslation(handles[3], Vector3(1, 2, 3));
+    store.SetScale(handles[7], Vector3(2, 2, 2));
+    std::vector<TransformHandle> updated = store.Update();
+    std::sort(updated.begin(), updated.end());
+    ASSERT_EQ(updated, (std::vector<TransformHandle>{ handles[3], handles[7] }));
+    ASSERT_EQ(store.GetWorldMatrix(handles[3]).GetTranslation().x, 1.0f);
+    ASSERT_TRUE(store.Update().empty());
+
+    // decompose and recompose
+    Matrix4x4 expected = ReferenceWorldMatrix(transforms[0].Translation, transforms[0].Rotation, transforms[0].Scale);
+    store.SetWorldMatrix(handles[5], expected);
+    store.Update();
+    ExpectMatrixNear(store.GetWorldMatrix(handles[5]), expected);
+}
+
+TEST(Transform, AllocateTest)
+{
+    TransformStore store;
+    int owner_a = 0, owner_b = 0;
+
+    TransformHandle a = store.Allocate(&owner_a);
+    TransformHandle b = store.Allocate(&owner_b);
+    ASSERT_EQ(store.GetOwner(a), &owner_a);
+    ASSERT_EQ(store.GetOwner(b), &owner_b);
+    ASSERT_EQ(store.Size(), 2u);
+
+    // a freed dirty entry is not updated, and the handle is reused with an identity transform
+    store.SetTranslation(a, Vector3(1, 1, 1));
+    store.Free(a);
+    ASSERT_EQ(store.Size(), 1u);
+    ASSERT_TRUE(store.Update().empty());
+
+    TransformHandle c = store.Allocate();
+    ASSERT_EQ(c, a);
+    ASSERT_EQ(store.GetOwner(c), nullptr);
+    ASSERT_FALSE(store.IsDirty(c));
+    ExpectMatrixNear(store.GetWorldMatrix(c), Matrix4x4::Identity());
+    ASSERT_EQ(store.Capacity(), 2u);
+}
+
+// batch update against the eager per object path that it replaces
+TEST(Transform, Benchmark)
+{
+    using Clock = std::chrono::high_resolution_clock;
+
+    constexpr uint32 NumObjects = 100000;
+    std::mt19937 rng(2);
+
+    std::vector<RandomTransform> transforms(NumObjects);
+    for (auto& transform : transforms)
+    {
+        transform = MakeRandomTransform(rng);
+    }
+
+    // each setter rebuilds part of the matrix, and the inverse is calculated when the model is drawn
+    std::vector<Matrix4x4> world(NumObjects, Matrix4x4::Identity()), inverse_world(NumObjects);
+    auto begin = Clock::now();
+    for (uint32 i = 0; i < NumObjects; i++)
+    {
+        world[i].SetRotation(transforms[i].Rotation.x, transforms[i].Rotation.y, transforms[i].Rotation.z);
+        world[i].SetTranslation(transforms[i].Translation);
+        world[i].SetScale(transforms[i].Scale);
+        inverse_world[i] = world[i].Inverse();
+    }
+    auto eager_time = Clock::now() - begin;
+
+    TransformStore store;
+    std::vector<TransformHandle> handles(NumObjects);
+    for (uint32 i = 0; i < NumObjects; i++)
+    {
+        handles[i] = store.Allocate();
+    }
+
+    // move every object, then every 10th object
+    auto measure = [&](uint32 step)
+    {
+        for (uint32 i = 0; i < NumObjects; i += step)
+        {
+            store.SetTranslation(handles[i], transforms[i].Translation);
+            store.SetRotation(handles[i], transforms[i].Rotation);
+            store.SetScale(handles[i], transforms[i].Scale);
+        }
+
+        auto begin = Clock::now();
+        size_t num_updated = store.Update().size();
+        auto time = Clock::now() - begin;
+
+        EXPECT_EQ(num_updated, (NumObjects + step - 1) / step);
+        return time;
+    };
+
+    auto batch_time = measure(1);
+    auto sparse_time = measure(10);
+
+    std::cout << "eager: " << std::chrono::duration<double, std::milli>(eager_time).count() << " ms, "
+        << "batch: " << std::chrono::duration<double, std::milli>(batch_time).count() << " ms, "
+        << "batch 10% dirty: " << std::chrono::duration<double, std::milli>(sparse_time).count() << " ms\n";
+
+    for (uint32 i = 0; i < NumObjects; i += 997)
+    {
+        ExpectMatrixNear(store.GetWorldMatrix(handles[i]), world[i]);
+        ExpectMatrixNear(store.GetInverseWorldMatrix(handles[i]), inverse_world[i]);
+    }
+}
@@ -0,0 +1,219 @@
+#include "gtest/gtest.h"
+#include "Resource/VertexCompression.h"
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+
+using namespace MRenderer;
+
+TEST(VertexCompressionTest, HalfTest)
+{
+    // exactly representable values
+    EXPECT_EQ(FloatToHalf(0.0f), 0x0000);
+    EXPECT_EQ(FloatToHalf(-0.0f), 0x8000);
+    EXPECT_EQ(FloatToHalf(1.0f), 0x3C00);
+    EXPECT_EQ(FloatToHalf(-2.0f), 0xC000);
+    EXPECT_EQ(FloatToHalf(65504.0f), 0x7BFF);
+    EXPECT_EQ(FloatToHalf(std::ldexp(1.0f, -14)), 0x0400);
+    EXPECT_EQ(FloatToHalf(std::ldexp(1.0f, -24)), 0x0001);
+
+    // rounding to nearest even, at the ties and at the overflow and underflow boundaries
+    EXPECT_EQ(FloatToHalf(1.0f + std::ldexp(1.0f, -11)), 0x3C00);
+    EXPECT_EQ(FloatToHalf(1.0f + 3 * std::ldexp(1.0f, -11)), 0x3C02);
+    EXPECT_EQ(FloatToHalf(65519.0f), 0x7BFF);
+    EXPECT_EQ(FloatToHalf(65520.0f), 0x7C00);
+    EXPECT_EQ(FloatToHalf(std::ldexp(1.0f, -25)), 0x0000);
+    EXPECT_EQ(FloatToHalf(std::ldexp(1.5f, -25)), 0x0001);
+    EXPECT_EQ(FloatToHalf(std::ldexp(1.0f, -15) - std::ldexp(1.0f, -26)), 0x0200);
+
+    // special values
+    EXPECT_EQ(FloatToHalf(std::numeric_limits<float>::infinity()), 0x7C00);
+    EXPECT_EQ(FloatToHalf(-std::numeric_limits<float>::infinity()), 0xFC00);
+    EXPECT_TRUE(std::isnan(HalfToFloat(FloatToHalf(std::numeric_limits<float>::quiet_NaN()))));
+
+    // every half but nan survives a round trip
+    for (uint32 bits = 0; bits <= 0xFFFF; bits++)
+    {
+        uint16 half = static_cast<uint16>(bits);
+        if ((half & 0x7C00) == 0x7C00 && (half & 0x3FF) != 0)
+        {
+            continue;
+        }
+        ASSERT_EQ(FloatToHalf(HalfToFloat(half)), half) << bits;
+    }
+
+    // half an ulp at most
+    std::mt19937 generator(7);
+    std::uniform_real_distribution<float> distribution(-60000.0f, 60000.0f);
+    for (uint32 i = 0; i < 100000; i++)
+    {
+        float value = distribution(generator);
+        float decoded = HalfToFloat(FloatToHalf(value));
+        ASSERT_LE(std::abs(decoded - value), std::abs(value) * std::ldexp(1.0f, -11)) << value;
+    }
+}
+
+TEST(VertexCompressionTest, OctahedralTest)
+{
+    // fibonacci sphere, plus the axes and the octant boundaries where the folding flips
+    std::vector<Vector3> directions = {
+        Vector3(1, 0, 0), Vector3(-1, 0, 0), Vector3(0, 1, 0), Vector3(0, -1, 0), Vector3(0, 0, 1), Vector3(0, 0, -1),
+        Vector3(1, 1, 0), Vector3(-1, 1, 0), Vector3(1, -1, 0), Vector3(1, 0, -1), Vector3(0, -1, -1), Vector3(-1, -1, -1),
+    };
+    const uint32 NumSamples = 100000;
+    for (uint32 i = 0; i < NumSamples; i++)
+    {
+        float z = 1 - 2 * (i + 0.5f) / NumSamples;
+        float r = std::sqrt(1 - z * z);
+        float phi = i * PI * (3 - std::sqrt(5.0f));
+        directions.push_back(Vector3(r * std::cos(phi), r * std::sin(phi), z));
+    }
+
+    float max_error = 0;
+    for (const Vector3& direction : directions)
+    {
+        Vector3 n = direction.GetNormalized();
+        int16 encoded[2];
+        VertexCompression::EncodeOctahedral(n, encoded);
+        Vector3 decoded = VertexCompression::DecodeOctahedral(encoded);
+
+        ASSERT_NEAR(decoded.Length(), 1.0f, 1e-5f);
+        max_error = std::max(max_error, (decoded - n).Length());
+    }
+
+    // 2 snorm16 are precise to about 4e-5 radians, the chord is about the angle
+    EXPECT_LT(max_error, 6e-5f);
+
+    int16 encoded[2];
+    VertexCompression::EncodeOctahedral(Vector3(0, 0, 0), encoded);
+    EXPECT_EQ(VertexCompression::DecodeOctahedral(encoded).z, 1.0f);
+}
+
+TEST(VertexCompressionTest, VertexTest)
+{
+    static_assert(sizeof(CompactVertex) == 20);
+    EXPECT_EQ(GetVertexLayout(CompactVertexFormat).VertexSize, sizeof(CompactVertex));
+
+    // flat along z, the degenerate axis of the bound must not divide by zero
+    AABB bound(Vector3(-3, 10, 5), Vector3(7, 12.5f, 5));
+    Vector3 extent = bound.Size();
+
+    std::mt19937 generator(11);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::uniform_real_distribution<float> signed_unit(-1.0f, 1.0f);
+
+    std::vector<StandardVertex> vertices(5000);
+    for (StandardVertex& vertex : vertices)
+    {
+        vertex.Position = bound.Min + Vector3(unit(generator) * extent.x, unit(generator) * extent.y, 0);
+        vertex.Normal = Vector3(signed_unit(generator), signed_unit(generator), signed_unit(generator)).GetNormalized();
+        vertex.Tangent = Vector3(signed_unit(generator), signed_unit(generator), signed_unit(generator)).GetNormalized();
+        vertex.Color = Vector3(1, 1, 1);
+        vertex.TexCoord0 = Vector2(signed_unit(generator) * 4, unit(generator));
+    }
+
+    BinaryData encoded = VertexCompression::EncodeVertices(vertices, bound);
+    ASSERT_EQ(encoded.GetSize(), vertices.size() * sizeof(CompactVertex));
+
+    const CompactVertex* compact = static_cast<const CompactVertex*>(encoded.GetData());
+    for (uint32 i = 0; i < vertices.size(); i++)
+    {
+        const StandardVertex& vertex = vertices[i];
+        StandardVertex decoded = VertexCompression::DecodeVertex(compact[i], bound);
+
+        // half a quantization step, plus the float error of the bound
+        EXPECT_NEAR(decoded.Position.x, vertex.Position.x, extent.x / 65535 * 0.5f + 1e-5f);
+        EXPECT_NEAR(decoded.Position.y, vertex.Position.y, extent.y / 65535 * 0.5f + 1e-5f);
+        EXPECT_EQ(decoded.Position.z, 5.0f);
+        EXPECT_LT((decoded.Normal - vertex.Normal).Length(), 6e-5f);
+        EXPECT_LT((decoded.Tangent - vertex.Tangent).Length(), 6e-5f);
+        EXPECT_NEAR(decoded.TexCoord0.x, vertex.TexCoord0.x, 4 * std::ldexp(1.0f, -11));
+        EXPECT_NEAR(decoded.TexCoord0.y, vertex.TexCoord0.y, std::ldexp(1.0f, -11));
+        EXPECT_EQ(decoded.Color.x, 1.0f);
+        EXPECT_EQ(decoded.Color.y, 1.0f);
+        EXPECT_EQ(decoded.Color.z, 1.0f);
+    }
+
+    // the bound corners are exact
+    StandardVertex corner{};
+    corner.Position = bound.Max;
+    Vector3 decoded_corner = VertexCompression::DecodeVertex(VertexCompression::EncodeVertex(corner, bound), bound).Position;
+    EXPECT_EQ(decoded_corner.x, bound.Max.x);
+    EXPECT_EQ(decoded_corner.y, bound.Max.y);
+    EXPECT_EQ(decoded_corner.z, bound.Max.z);
+}
+
+TEST(VertexCompressionTest, IndicesTest)
+{
+    // 2 sub meshes far apart in the vertex buffer, each of them spans less than 65536 vertices, the second has a lod
+    std::mt19937 generator(13);
+    std::uniform_int_distribution<uint32> first(0, 40000);
+    std::uniform_int_distribution<uint32> second(100000, 100000 + 65534);
+
+    std::vector<uint32> indices;
+    std::vector<SubMeshData> sub_meshes(2);
+    MeshLodChunk lods;
+    lods.Lods.push_back(MeshLodData{ .ScreenSize = 0.5f, .Error = 0.01f });
+
+    sub_meshes[0] = SubMeshData{ .Index = 0, .IndicesCount = 3000 };
+    for (uint32 i = 0; i < 3000; i++)
+    {
+        indices.push_back(first(generator));
+    }
+
+    sub_meshes[1] = SubMeshData{ .Index = 3000, .IndicesCount = 6000 };
+    for (uint32 i = 0; i < 6000; i++)
+    {
+        indices.push_back(second(generator));
+    }
+    indices[3000] = 100000;
+    indices[3001] = 100000 + 65534;
+
+    // lod of the first sub mesh is empty
+    lods.SubMeshes.push_back(SubMeshData{ .Index = 9000, .IndicesCount = 0 });
+    lods.SubMeshes.push_back(SubMeshData{ .Index = 9000, .IndicesCount = 300 });
+    for (uint32 i = 0; i < 300; i++)
+    {
+        indices.push_back(second(generator));
+    }
+
+    IndexFormatChunk format;
+    BinaryData encoded = VertexCompression::EncodeIndices(indices, sub_meshes, lods, format);
+    ASSERT_EQ(format.IndexStride, sizeof(uint16));
+    ASSERT_EQ(encoded.GetSize(), indices.size() * sizeof(uint16));
+    EXPECT_EQ(format.GetBaseVertex(1), 100000u);
+    EXPECT_EQ(format.GetBaseVertex(3), 100000u);
+
+    // decode through a mesh, the vertices are only there for the count
+    std::vector<StandardVertex> vertices(100000 + 65535);
+    BinaryData vertex_data(vertices.data(), static_cast<uint32>(vertices.size() * sizeof(StandardVertex)));
+    MeshData mesh(StandardVertexFormat, std::move(vertex_data), std::move(encoded), sub_meshes, AABB());
+    mesh.SetLods(lods);
+    mesh.SetIndexFormat(format);
+    EXPECT_EQ(mesh.IndiciesCount(), indices.size());
+
+    std::vector<uint32> decoded;
+    VertexCompression::DecodeIndices(mesh, decoded);
+    EXPECT_EQ(decoded, indices);
+
+    // the chunk is written only for the narrowed indices
+    RingBuffer rb;
+    IndexFormatChunk::BinarySerialize(rb, format);
+
+    IndexFormatChunk loaded;
+    IndexFormatChunk::BinaryDeserialize(rb, loaded);
+    EXPECT_EQ(loaded.IndexStride, format.IndexStride);
+    EXPECT_EQ(loaded.BaseVertices, format.BaseVertices);
+
+    // a sub mesh spanning 65536 vertices keeps the 32 bits indices
+    indices[3002] = 100000 + 65535;
+    BinaryData wide = VertexCompression::EncodeIndices(indices, sub_meshes, lods, format);
+    EXPECT_EQ(format.IndexStride, sizeof(uint32));
+    EXPECT_TRUE(format.BaseVertices.empty());
+    ASSERT_EQ(wide.GetSize(), indices.size() * sizeof(uint32));
+    EXPECT_EQ(memcmp(wide.GetData(), indices.data(), wide.GetSize()), 0);
+
+    IndexFormatChunk::BinarySerialize(rb, format);
+    EXPECT_EQ(rb.Occupied(), 0u);
+}